@@ -1,11 +1,17 @@
 #include "CompositeViewerModeller.hpp"
 #include "MainFrame.hpp"
+#include "utility/Logger.hpp"
 #include <wx/image.h>
+#include <cstdlib>
 
 IMPLEMENT_APP(CompositeViewerModeller)
 
 bool CompositeViewerModeller::OnInit() {
 
+    // the log is written to a file as well if CVM_LOG_FILE is set
+    const char* log_file = std::getenv("CVM_LOG_FILE");
+    if(log_file != nullptr) Logger::Instance().SetLogFile(log_file);
+
     // initialize all available image handlers
     wxInitAllImageHandlers();
 
@@ -1,13 +1,19 @@
 #include "MainFrame.hpp"
 #include "image/gui/ImageFrame.hpp"
 #include "osg/OsgWxFrame.hpp"
+#include "osg/SharedViewer.hpp"
 #include "wx/WxGuiId.hpp"
+#include "utility/MemoryRegistry.hpp"
+#include "utility/Profiler.hpp"
 #include <wx/statusbr.h>
 #include <wx/menu.h>
 #include <wx/filedlg.h>
 #include <wx/datetime.h>
 #include <wx/panel.h>
 #include <wx/sizer.h>
+#include <wx/button.h>
+#include <wx/checkbox.h>
+#include <wx/stattext.h>
 #include <iostream>
 
 BEGIN_EVENT_TABLE(MainFrame, wxFrame)
@@ -19,12 +25,31 @@ BEGIN_EVENT_TABLE(MainFrame, wxFrame)
     EVT_MENU(wxID_SAVE, MainFrame::OnSaveLog)
     EVT_MENU(wxID_EDIT_CLEAR_LOG, MainFrame::OnClearLog)
     EVT_MENU(wxID_MODEL_IMAGE, MainFrame::OnModelFromSingleImage)
+    EVT_MENU(wxID_MODEL_SHARED_VIEWER, MainFrame::OnToggleSharedViewer)
     EVT_NOTEBOOK_PAGE_CHANGED(wxID_ANY, MainFrame::OnNotebookPageChange)
+    EVT_CHECKBOX(wxID_PROFILER_ENABLE, MainFrame::OnToggleProfiler)
+    EVT_BUTTON(wxID_PROFILER_CLEAR, MainFrame::OnClearProfiler)
+    EVT_BUTTON(wxID_PROFILER_EXPORT, MainFrame::OnExportProfilerTrace)
+    EVT_TIMER(wxID_PROFILER_TIMER, MainFrame::OnProfilerTimer)
+    EVT_SPINCTRL(wxID_MEMORY_BUDGET, MainFrame::OnMemoryBudget)
 END_EVENT_TABLE()
 
 const wxString MainFrame::frame_text = wxT("Frame Id: ");
+
+// the profiler page shows the scopes of the last seconds
+static const double profiler_window = 5.0;
+static const int profiler_refresh_period = 500;     // ms
+static const int max_memory_budget = 1 << 20;       // MB
+static const size_t megabyte = 1024 * 1024;
+
+static wxString memory_text(const char* name, size_t bytes) {
+    return wxString::Format(wxT("%s %.1f MB"), name, bytes / static_cast<double>(megabyte));
+}
+
 MainFrame::MainFrame(wxWindow* parent, wxWindowID id, const wxString& title, const wxPoint& pos, const wxSize& size, long style, const wxString& name) :
-    wxFrame(parent, id, title, pos, size, style, name), m_id(0) {
+    wxFrame(parent, id, title, pos, size, style, name),
+    m_profiler_timer(this, wxID_PROFILER_TIMER),
+    m_id(0) {
 
     SetTitle(wxT("Composite Viewer and Modeller"));
     UsrInitNotebook();
@@ -32,11 +57,16 @@ MainFrame::MainFrame(wxWindow* parent, wxWindowID id, const wxString& title, con
     CreateStatusBar(1);
     SetStatusText(wxT("CVM"), 0);
     Centre();
+
+    // the memory line and the budget do not depend on the profiler
+    m_profiler_timer.Start(profiler_refresh_period);
 }
 
 MainFrame::~MainFrame() {
 
-    delete m_tdirector;
+    // the log page is gone, the records pending in the event queue are deleted with the frame
+    Logger::Instance().SetSink(nullptr);
+    Logger::Instance().RestoreStandardStreams();
 }
 
 void MainFrame::OnOpenImage(wxCommandEvent& event) {
@@ -55,7 +85,16 @@ void MainFrame::OnOpenImage(wxCommandEvent& event) {
 
 void MainFrame::OnOpenPointCloud(wxCommandEvent& event) {
 
-    std::cout << "This menu has not been implemented yet!" << std::endl;
+    OsgWxFrame* sgFrame = new OsgWxFrame(this, wxPoint(50, 50), wxSize(600, 450), operation_mode::displaying);
+    sgFrame->UsrSetFrameId(++m_id);
+    if(sgFrame->UsrOpenPointCloudFile()) {
+        m_sgraph_frames.insert(std::pair<int, OsgWxFrame*>(m_id, sgFrame));
+        sgFrame->Show();
+    }
+    else {
+        --m_id;
+        sgFrame->Destroy();
+    }
 }
 
 void MainFrame::OnOpenModel(wxCommandEvent& event) {
@@ -86,6 +125,14 @@ void MainFrame::OnModelFromSingleImage(wxCommandEvent& event) {
     }
 }
 
+void MainFrame::OnToggleSharedViewer(wxCommandEvent& event) {
+
+    bool shared = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    SharedViewer::SetEnabled(shared);
+    if(shared) std::cout << "\t-New model windows are rendered by the shared viewer" << std::endl;
+    else       std::cout << "\t-New model windows are rendered by their own viewers" << std::endl;
+}
+
 void MainFrame::OnSaveLog(wxCommandEvent& event) {
 
     wxFileDialog save_filedialog(this, wxT("Save log to a file"), wxT(""), wxT(""), wxT("*.txt"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
@@ -111,10 +158,67 @@ void MainFrame::OnNotebookPageChange(wxNotebookEvent& event) {
     std::cout << "INFO: Page Changed: " << event.GetSelection() << std::endl;
 }
 
+void MainFrame::OnToggleProfiler(wxCommandEvent& event) {
+
+    Profiler::SetEnabled(event.IsChecked());
+}
+
+void MainFrame::OnClearProfiler(wxCommandEvent& event) {
+
+    Profiler::Instance().Clear();
+    m_profiler_list->DeleteAllItems();
+}
+
+void MainFrame::OnExportProfilerTrace(wxCommandEvent& event) {
+
+    wxFileDialog dialog(this, wxT("Export the profiler events"), wxEmptyString, wxEmptyString, wxT("*.json"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if(dialog.ShowModal() == wxID_CANCEL) return;
+    Profiler::Instance().WriteChromeTrace(dialog.GetPath().ToStdString());
+}
+
+void MainFrame::OnProfilerTimer(wxTimerEvent& event) {
+
+    // Step-1: the caches are evicted by the UI thread, it owns the wx images and requests the redraws
+    MemoryRegistry& registry = MemoryRegistry::Instance();
+    registry.Enforce();
+    wxString text = memory_text("Total", registry.GetTotalBytes());
+    for(size_t i = 0; i < MemoryRegistry::num_categories; ++i) {
+        memory_category category = static_cast<memory_category>(i);
+        text += wxT(" | ") + memory_text(MemoryRegistry::GetCategoryName(category), registry.GetBytes(category));
+    }
+    text += wxT(" | ") + memory_text("Peak", registry.GetPeakBytes()) + wxT(" | ") + memory_text("Evicted", registry.GetEvictedBytes());
+    m_memory_text->SetLabel(text);
+
+    // Step-2: the profiler scopes
+    if(!Profiler::IsEnabled()) return;
+    std::vector<Profiler::Statistics> statistics;
+    Profiler::Instance().GetStatistics(profiler_window, statistics);
+
+    m_profiler_list->Freeze();
+    m_profiler_list->DeleteAllItems();
+    for(size_t i = 0; i < statistics.size(); ++i) {
+        const Profiler::Statistics& s = statistics[i];
+        long item = m_profiler_list->InsertItem(static_cast<long>(i), wxString::FromUTF8(s.name));
+        m_profiler_list->SetItem(item, 1, wxString::Format(wxT("%u"), s.calls));
+        m_profiler_list->SetItem(item, 2, wxString::Format(wxT("%.3f"), s.last));
+        m_profiler_list->SetItem(item, 3, wxString::Format(wxT("%.3f"), s.mean));
+        m_profiler_list->SetItem(item, 4, wxString::Format(wxT("%.3f"), s.max));
+        m_profiler_list->SetItem(item, 5, wxString::Format(wxT("%.1f"), s.total));
+    }
+    m_profiler_list->Thaw();
+}
+
+void MainFrame::OnMemoryBudget(wxSpinEvent& event) {
+
+    MemoryRegistry::Instance().SetBudget(static_cast<size_t>(event.GetPosition()) * megabyte);
+    std::cout << "INFO: Memory budget: " << event.GetPosition() << " MB" << (event.GetPosition() == 0 ? " (none)" : "") << std::endl;
+}
+
 void MainFrame::UsrInitNotebook() {
     m_notebook = new wxNotebook(this, wxID_ANY);
     UsrInitLogPage();
     UsrInitFilesPage();
+    UsrInitProfilerPage();
 }
 
 void MainFrame::UsrInitLogPage() {
@@ -122,17 +226,35 @@ void MainFrame::UsrInitLogPage() {
     wxPanel* panel1 = new wxPanel(m_notebook, wxID_ANY);
     long tstyle = (wxTE_READONLY | wxTE_MULTILINE | wxTE_LEFT | wxTE_BESTWRAP | wxTE_RICH);
     m_textctrl = new wxTextCtrl(panel1, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, tstyle);
-    m_tdirector = new wxStreamToTextRedirector(m_textctrl);
     m_default_style = m_textctrl->GetDefaultStyle();
     m_textctrl->SetDefaultStyle(wxTextAttr(*wxCYAN));
     wxDateTime dt = dt.Now();
-    std::cout << dt.Format().char_str() << std::endl;
+    m_textctrl->AppendText(dt.Format() + wxT("\n"));
     m_textctrl->SetDefaultStyle(m_default_style);
-    std::cout << "*****************************************************" << std::endl;
+    m_textctrl->AppendText(wxT("*****************************************************\n"));
     wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
     sizer->Add(m_textctrl, 1, wxEXPAND);
     panel1->SetSizer(sizer);
     m_notebook->AddPage(panel1, wxT("Log"));
+
+    // the standard streams are logged asynchronously, the drain thread passes the records to the UI thread
+    Logger::Instance().SetSink([this](const std::vector<LogRecord>& records) {
+        CallAfter([this, records]() { UsrAppendLogRecords(records); });
+    });
+    Logger::Instance().RedirectStandardStreams();
+}
+
+void MainFrame::UsrAppendLogRecords(const std::vector<LogRecord>& records) {
+
+    m_textctrl->Freeze();
+    for(const LogRecord& record : records) {
+        if(record.level == log_level::error)        UsrSetLogMode(log_type::ERROR);
+        else if(record.level == log_level::warning) UsrSetLogMode(log_type::WARNING);
+        else                                        UsrSetLogMode(log_type::DEFAULT);
+        m_textctrl->AppendText(wxString::FromUTF8(record.message.c_str()) + wxT("\n"));
+    }
+    UsrSetLogMode(log_type::DEFAULT);
+    m_textctrl->Thaw();
 }
 
 void MainFrame::UsrInitFilesPage() {
@@ -150,6 +272,39 @@ void MainFrame::UsrInitFilesPage() {
     m_roots['p'] = m_filetree->AppendItem(m_roots['r'], wxT("Point Clouds"));
 }
 
+void MainFrame::UsrInitProfilerPage() {
+
+    wxPanel* panel3 = new wxPanel(m_notebook, wxID_ANY);
+    wxBoxSizer* controls = new wxBoxSizer(wxHORIZONTAL);
+    controls->Add(new wxCheckBox(panel3, wxID_PROFILER_ENABLE, wxT("Enable")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+    controls->Add(new wxButton(panel3, wxID_PROFILER_CLEAR, wxT("Clear")), 0, wxALL, 4);
+    controls->Add(new wxButton(panel3, wxID_PROFILER_EXPORT, wxT("Export Chrome Trace...")), 0, wxALL, 4);
+    controls->Add(new wxStaticText(panel3, wxID_ANY, wxString::Format(wxT("Times of the last %.0f s in ms"), profiler_window)), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+
+    // the budget evicts the cold caches, see MemoryRegistry
+    wxBoxSizer* memory = new wxBoxSizer(wxHORIZONTAL);
+    memory->Add(new wxStaticText(panel3, wxID_ANY, wxT("Memory budget (MB, 0 for none)")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+    size_t budget = MemoryRegistry::Instance().GetBudget() / megabyte;
+    memory->Add(new wxSpinCtrl(panel3, wxID_MEMORY_BUDGET, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, max_memory_budget, static_cast<int>(budget)), 0, wxALL, 4);
+    m_memory_text = new wxStaticText(panel3, wxID_ANY, wxEmptyString);
+    memory->Add(m_memory_text, 1, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+
+    m_profiler_list = new wxListCtrl(panel3, wxID_ANY, wxDefaultPosition, wxDefaultSize, wxLC_REPORT | wxLC_SINGLE_SEL);
+    m_profiler_list->InsertColumn(0, wxT("Scope"), wxLIST_FORMAT_LEFT, 260);
+    m_profiler_list->InsertColumn(1, wxT("Calls"), wxLIST_FORMAT_RIGHT, 60);
+    m_profiler_list->InsertColumn(2, wxT("Last"), wxLIST_FORMAT_RIGHT, 70);
+    m_profiler_list->InsertColumn(3, wxT("Mean"), wxLIST_FORMAT_RIGHT, 70);
+    m_profiler_list->InsertColumn(4, wxT("Max"), wxLIST_FORMAT_RIGHT, 70);
+    m_profiler_list->InsertColumn(5, wxT("Total"), wxLIST_FORMAT_RIGHT, 80);
+
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(controls, 0, wxEXPAND);
+    sizer->Add(memory, 0, wxEXPAND);
+    sizer->Add(m_profiler_list, 1, wxEXPAND);
+    panel3->SetSizer(sizer);
+    m_notebook->AddPage(panel3, wxT("Profiler"));
+}
+
 void MainFrame::UsrInitMenubar() {
 
     wxMenuBar* menubar = new wxMenuBar;
@@ -169,16 +324,15 @@ void MainFrame::UsrInitMenubar() {
 
     wxMenu* model = new wxMenu;
     model->Append(wxID_MODEL_IMAGE, wxT("Model from Single Image"));
+    model->AppendSeparator();
+    model->AppendCheckItem(wxID_MODEL_SHARED_VIEWER, wxT("Render New Windows with a Shared Viewer"));
     menubar->Append(model, wxT("&Model"));
 
     SetMenuBar(menubar);
 }
 
 void MainFrame::UsrLogErrorMessage(const std::string& str) {
-
-    UsrSetLogMode(log_type::ERROR);
-    std::cout << str << std::endl;
-    UsrSetLogMode(log_type::DEFAULT);
+    Logger::Instance().Log(log_level::error, str);
 }
 
 void MainFrame::UsrAppendFileTree(char c, const wxArrayString& keyVal) {
@@ -2,18 +2,22 @@
 #define MAIN_FRAME_HPP
 
 #include "wx/WxUtility.hpp"
+#include "utility/Logger.hpp"
 #include <wx/frame.h>
 #include <wx/textctrl.h>
 #include <wx/notebook.h>
 #include <wx/treectrl.h>
+#include <wx/listctrl.h>
+#include <wx/timer.h>
+#include <wx/spinctrl.h>
 #include <map>
 #include <vector>
 
 class ImageFrame;
 class OsgWxFrame;
 class wxTextCtrl;
-class wxStreamToTextRedirector;
 class wxNotebook;
+class wxStaticText;
 
 class MainFrame : public wxFrame {
 
@@ -26,8 +30,10 @@ private:
     wxNotebook* m_notebook;
     wxTextCtrl* m_textctrl;
     wxTreeCtrl* m_filetree;
-    wxStreamToTextRedirector* m_tdirector;
     wxTextAttr m_default_style;
+    wxListCtrl* m_profiler_list;        // rolling timings of the profiler scopes
+    wxStaticText* m_memory_text;        // bytes of the MemoryRegistry by category
+    wxTimer m_profiler_timer;           // refreshes the page and enforces the memory budget
     int m_id;
 
 public:
@@ -47,13 +53,16 @@ private:
     inline void UsrInitNotebook();
     inline void UsrInitLogPage();
     inline void UsrInitFilesPage();
+    inline void UsrInitProfilerPage();
     inline void UsrInitMenubar();
+    void UsrAppendLogRecords(const std::vector<LogRecord>& records);
     bool UsrFindFrameInTheFileTree(const wxString& label, wxTreeItemId& itemId);
     void UsrDeleteFromFileTree(int m_id);
 
     // Event Handlers
     void OnOpenImage(wxCommandEvent& event);
     void OnModelFromSingleImage(wxCommandEvent& event);
+    void OnToggleSharedViewer(wxCommandEvent& event);
     void OnOpenPointCloud(wxCommandEvent& event);
     void OnOpenModel(wxCommandEvent& event);
     void OnSaveLog(wxCommandEvent& event);
@@ -61,6 +70,11 @@ private:
     void OnClose(wxCloseEvent& event);
     void OnExit(wxCommandEvent& event);
     void OnNotebookPageChange(wxBookCtrlEvent& event);
+    void OnToggleProfiler(wxCommandEvent& event);
+    void OnClearProfiler(wxCommandEvent& event);
+    void OnExportProfilerTrace(wxCommandEvent& event);
+    void OnProfilerTimer(wxTimerEvent& event);
+    void OnMemoryBudget(wxSpinEvent& event);
     DECLARE_EVENT_TABLE()
 };
 
@@ -0,0 +1,285 @@
+#include "BatchJob.hpp"
+#include "InteractionTrace.hpp"
+#include "../modeller/HeadlessView.hpp"
+#include "../modeller/ProjectionParameters.hpp"
+#include "../image/algorithms/GradientCache.hpp"
+#include "../osg/CompactModel.hpp"
+#include "../osg/OsgOffscreenRenderer.hpp"
+#include "../utility/LatencyProbe.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+static std::string directory_of(const std::string& path) {
+
+    size_t pos = path.find_last_of('/');
+    return (pos == std::string::npos) ? std::string(".") : path.substr(0, pos);
+}
+
+static std::string resolve_path(const std::string& dir, const std::string& path) {
+    return (path.empty() || path[0] == '/') ? path : dir + "/" + path;
+}
+
+static bool read_switch(std::istringstream& line, bool& flag) {
+
+    std::string value;
+    if(!(line >> value)) return false;
+    if(value == "on")       flag = true;
+    else if(value == "off") flag = false;
+    else                    return false;
+    return true;
+}
+
+static bool read_points(std::istringstream& line, batch_event_type type, int num, std::vector<BatchEvent>& events) {
+
+    for(int i = 0; i < num; ++i) {
+        BatchEvent event;
+        event.type = type;
+        event.time = 0.0;
+        if(!(line >> event.x >> event.y)) return false;
+        events.push_back(event);
+    }
+    return true;
+}
+
+static bool read_time(std::istringstream& line, size_t first, std::vector<BatchEvent>& events) {
+
+    // the optional @t of an input, every event of the input gets the time
+    std::string value;
+    if(!(line >> value)) return true;
+    if(value.size() < 2 || value[0] != '@' || first == events.size()) return false;
+    std::istringstream time(value.substr(1));
+    double t;
+    if(!(time >> t)) return false;
+    for(size_t i = first; i < events.size(); ++i)
+        events[i].time = t;
+    return true;
+}
+
+static const char* to_string(bool flag) {
+    return flag ? "on" : "off";
+}
+
+BatchJob::BatchJob() :
+    image_coordinates(true),
+    ax_constraints(axis_constraints::planar),
+    sc_constraints(section_constraints::none),
+    symmetric_profiles(false),
+    snap_to_edges(false),
+    fit_ellipses(false),
+    subpixel_snapping(false),
+    multi_start(false),
+    right_cylinder(false),
+    double_circle(false),
+    max_export_error(0.0) { }
+
+bool ReadBatchJob(const std::string& path, BatchJob& job) {
+
+    std::ifstream file(path);
+    if(!file.good()) {
+        std::cout << "ERROR: Job file cannot be opened: " << path << std::endl;
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    job.name = path.substr((slash == std::string::npos) ? 0 : slash + 1);
+    job.name = job.name.substr(0, job.name.find_last_of('.'));
+    std::string dir = directory_of(path);
+
+    std::string text;
+    for(int num = 1; std::getline(file, text); ++num) {
+
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string key;
+        if(!(line >> key)) continue;
+
+        bool ok = true;
+        size_t num_events = job.events.size();
+        if(key == "image" || key == "output") {
+            std::string value;
+            ok = static_cast<bool>(line >> value);
+            if(key == "image") job.image_path = resolve_path(dir, value);
+            else               job.output_path = resolve_path(dir, value);
+        }
+        else if(key == "coordinates") {
+            std::string value;
+            ok = (line >> value) && (value == "image" || value == "logical");
+            job.image_coordinates = (value == "image");
+        }
+        else if(key == "axis") {
+            std::string value;
+            line >> value;
+            if(value == "none")                job.ax_constraints = axis_constraints::none;
+            else if(value == "planar")         job.ax_constraints = axis_constraints::planar;
+            else if(value == "linear")         job.ax_constraints = axis_constraints::linear;
+            else if(value == "constant_depth") job.ax_constraints = axis_constraints::constant_depth;
+            else                               ok = false;
+        }
+        else if(key == "sections") {
+            std::string value;
+            line >> value;
+            if(value == "none")                job.sc_constraints = section_constraints::none;
+            else if(value == "constant")       job.sc_constraints = section_constraints::constant;
+            else if(value == "linear_scaling") job.sc_constraints = section_constraints::linear_scaling;
+            else                               ok = false;
+        }
+        else if(key == "symmetric_profiles") ok = read_switch(line, job.symmetric_profiles);
+        else if(key == "snap_to_edges")      ok = read_switch(line, job.snap_to_edges);
+        else if(key == "fit_ellipses")       ok = read_switch(line, job.fit_ellipses);
+        else if(key == "subpixel_snapping")  ok = read_switch(line, job.subpixel_snapping);
+        else if(key == "multi_start")        ok = read_switch(line, job.multi_start);
+        else if(key == "right_cylinder")     ok = read_switch(line, job.right_cylinder);
+        else if(key == "double_circle")      ok = read_switch(line, job.double_circle);
+        else if(key == "simplify")           ok = (line >> job.max_export_error) && job.max_export_error >= 0.0;
+        else if(key == "move")               ok = read_points(line, batch_event_type::move, 1, job.events);
+        else if(key == "left")               ok = read_points(line, batch_event_type::left_click, 1, job.events);
+        else if(key == "right")              ok = read_points(line, batch_event_type::right_click, 1, job.events);
+        else if(key == "ellipse")            ok = read_points(line, batch_event_type::left_click, 3, job.events);
+        else if(key == "escape")             job.events.push_back(BatchEvent{batch_event_type::escape, 0.0, 0.0, 0.0});
+        else if(key == "delete_last_section") job.events.push_back(BatchEvent{batch_event_type::delete_last_section, 0.0, 0.0, 0.0});
+        else if(key == "scale_up")           job.events.push_back(BatchEvent{batch_event_type::scale_up, 0.0, 0.0, 0.0});
+        else if(key == "scale_down")         job.events.push_back(BatchEvent{batch_event_type::scale_down, 0.0, 0.0, 0.0});
+        else                                 ok = false;
+        if(ok && num_events < job.events.size()) ok = read_time(line, num_events, job.events);
+
+        if(!ok) {
+            std::cout << "ERROR: " << path << ":" << num << ": invalid line: " << text << std::endl;
+            return false;
+        }
+    }
+
+    if(job.image_path.empty()) {
+        std::cout << "ERROR: " << path << ": no image" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WriteBatchJob(const std::string& path, const BatchJob& job) {
+
+    std::ofstream file(path);
+    if(!file.good()) {
+        std::cout << "ERROR: Job file cannot be written: " << path << std::endl;
+        return false;
+    }
+
+    static const char* axis[] = { "none", "constant_depth", "linear", "planar" };
+    static const char* sections[] = { "none", "constant", "linear_scaling" };
+    file << "image " << job.image_path << "\n";
+    if(!job.output_path.empty()) file << "output " << job.output_path << "\n";
+    file << "coordinates " << (job.image_coordinates ? "image" : "logical") << "\n";
+    file << "axis " << axis[static_cast<int>(job.ax_constraints)] << "\n";
+    file << "sections " << sections[static_cast<int>(job.sc_constraints)] << "\n";
+    file << "symmetric_profiles " << to_string(job.symmetric_profiles) << "\n";
+    file << "snap_to_edges " << to_string(job.snap_to_edges) << "\n";
+    file << "fit_ellipses " << to_string(job.fit_ellipses) << "\n";
+    file << "subpixel_snapping " << to_string(job.subpixel_snapping) << "\n";
+    file << "multi_start " << to_string(job.multi_start) << "\n";
+    file << "right_cylinder " << to_string(job.right_cylinder) << "\n";
+    file << "double_circle " << to_string(job.double_circle) << "\n";
+    if(job.max_export_error > 0.0) file << "simplify " << job.max_export_error << "\n";
+
+    static const char* events[] = { "move", "left", "right", "escape", "delete_last_section", "scale_up", "scale_down" };
+    file.precision(10);
+    for(const BatchEvent& event : job.events) {
+        file << events[static_cast<int>(event.type)];
+        if(event.type == batch_event_type::move || event.type == batch_event_type::left_click || event.type == batch_event_type::right_click)
+            file << " " << event.x << " " << event.y;
+        file << " @" << event.time << "\n";
+    }
+
+    file.close();
+    if(file.fail()) {
+        std::cout << "ERROR: Job file cannot be written: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RunBatchJob(const BatchJob& job, const std::string& output_dir, unsigned int& num_components, LatencyReport* latency,
+                 OsgOffscreenRenderer* thumbnails, const std::string& thumbnail_dir) {
+
+    num_components = 0;
+
+    // Step-1: the gradient image from the cache, it is computed and cached if it is not there yet
+    OtbImageType::Pointer gimg = GradientCache::Instance().Load(job.image_path);
+    if(gimg.IsNull()) {
+        std::cout << "ERROR: Gradient image cannot be generated: " << job.image_path << std::endl;
+        return false;
+    }
+    OtbImageType::SizeType size = gimg->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    int height = static_cast<int>(size[1]);
+
+    // Step-2: the modeller in a view of the image, as OsgWxFrame::usrLoadImageFile sets it up
+    std::shared_ptr<ProjectionParameters> pp(new ProjectionParameters(45, width, height, 1.0, 100.0));
+    HeadlessView view(*pp);
+    ImageModeller modeller(job.image_path, pp, &view);
+    if(!modeller.HasGradientImage()) modeller.SetGradientImage(gimg);
+    modeller.Initialize2DDrawingInterface(view.GetDrawingNode());
+    modeller.ax_constraints = job.ax_constraints;
+    modeller.sc_constraints = job.sc_constraints;
+    modeller.SetSymmetricProfile(job.symmetric_profiles);
+    modeller.SetProfileSnappingMode(job.snap_to_edges ? profile_snapping_mode::nearest_edge : profile_snapping_mode::gradient_maximum);
+    modeller.SetEllipseFitting(job.fit_ellipses);
+    modeller.SetSubpixelSnapping(job.subpixel_snapping);
+    modeller.SetMultiStartSolving(job.multi_start);
+    modeller.SetRightGeneralizedCylinderConstraint(job.right_cylinder);
+    modeller.SetDoubleCircleDrawingForLinaerAxisPrior(job.double_circle);
+
+    // Step-3: replay of the inputs in logical coordinates, as fast as the modeller can take them
+    for(const BatchEvent& event : job.events) {
+        double x = event.x;
+        double y = job.image_coordinates ? height - event.y - 1.0 : event.y;
+        if(event.type == batch_event_type::left_click || event.type == batch_event_type::right_click)
+            modeller.OnMouseMove(x, y);
+
+        // only the input itself is timed, not the move to its point
+        LatencySample sample;
+        if(latency != nullptr) LatencyProbe::Attach(&sample);
+        switch(event.type) {
+        case batch_event_type::move:
+            modeller.OnMouseMove(x, y);
+            break;
+        case batch_event_type::left_click:
+            modeller.OnLeftClick(x, y);
+            break;
+        case batch_event_type::right_click:
+            modeller.OnRightClick(x, y);
+            break;
+        case batch_event_type::escape:
+            modeller.EscapeKeyPressed();
+            break;
+        case batch_event_type::delete_last_section:
+            modeller.DeleteLastSection();
+            break;
+        case batch_event_type::scale_up:
+            modeller.IncrementScaleFactor();
+            break;
+        case batch_event_type::scale_down:
+            modeller.DecrementScaleFactor();
+            break;
+        }
+        if(latency != nullptr) {
+            LatencyProbe::Detach();
+            latency->Add(sample);
+        }
+    }
+
+    // Step-4: the components are written as the model of the GUI
+    num_components = view.GetModel()->getNumChildren();
+    if(num_components == 0) {
+        std::cout << "ERROR: No component is modelled: " << job.name << std::endl;
+        return false;
+    }
+    std::string output_path = job.output_path.empty() ? output_dir + "/" + job.name + ".ply" : job.output_path;
+    if(!write_model_file(*view.GetModel(), output_path, job.max_export_error)) return false;
+
+    // Step-5: the model is not modified anymore, the renderer keeps it until it is drawn
+    if(thumbnails != nullptr)
+        thumbnails->Submit(view.GetModel(), job.image_path, *pp, thumbnail_dir + "/" + job.name + ".png");
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef BATCH_JOB_HPP
+#define BATCH_JOB_HPP
+
+#include "../modeller/ImageModeller.hpp"
+#include <string>
+#include <vector>
+
+/*
+ * A modelling job of cvm_batch.
+ *
+ * A job file (.cvmjob) is a line based text file, '#' starts a comment. The settings come first:
+ *
+ *   image <path>                        image to model, relative to the job file
+ *   output <path>                       model file, <output dir>/<job name>.ply by default
+ *   coordinates image|logical           the input points are in image coordinates (origin at the
+ *                                       top left, the default) or in logical coordinates (origin
+ *                                       at the bottom left, as ImageModeller receives them)
+ *   axis none|planar|linear|constant_depth
+ *   sections none|constant|linear_scaling
+ *   symmetric_profiles on|off
+ *   snap_to_edges on|off
+ *   fit_ellipses on|off
+ *   subpixel_snapping on|off
+ *   multi_start on|off
+ *   right_cylinder on|off
+ *   double_circle on|off
+ *   simplify <error>                    maximum geometric error of the exported surfaces, 0 (the
+ *                                       default) keeps the full resolution (see CompactModel.hpp)
+ *
+ * followed by the inputs, they are replayed through the ImageModeller as the mouse and the keys
+ * of the GUI (a click moves the pointer to its point first):
+ *
+ *   move x y | left x y | right x y     mouse move, left click, right click
+ *   escape | delete_last_section        the escape and the space keys
+ *   scale_up | scale_down               the mouse wheel
+ *   ellipse x0 y0 x1 y1 x2 y2           the three left clicks of a profile: the end points of
+ *                                       the major axis and a point on the minor axis
+ *
+ * An input may end with @t, the time of the input in seconds from the start of the recording. The
+ * interaction traces of the GUI (InteractionTrace.hpp) are written in this format.
+ */
+enum class batch_event_type : unsigned char {
+    move,
+    left_click,
+    right_click,
+    escape,
+    delete_last_section,
+    scale_up,
+    scale_down
+};
+
+struct BatchEvent {
+    batch_event_type type;
+    double x, y;
+    double time;                        // seconds from the start of the recording, 0 if unknown
+};
+
+struct LatencyReport;
+class OsgOffscreenRenderer;
+
+struct BatchJob {
+    std::string name;                   // name of the job file without the extension
+    std::string image_path;
+    std::string output_path;
+    bool image_coordinates;
+    axis_constraints ax_constraints;
+    section_constraints sc_constraints;
+    bool symmetric_profiles;
+    bool snap_to_edges;
+    bool fit_ellipses;
+    bool subpixel_snapping;
+    bool multi_start;
+    bool right_cylinder;
+    bool double_circle;
+    double max_export_error;
+    std::vector<BatchEvent> events;
+
+    BatchJob();
+};
+
+bool ReadBatchJob(const std::string& path, BatchJob& job);
+bool WriteBatchJob(const std::string& path, const BatchJob& job);
+
+// models the image of the job and writes the components into the output file, the output file
+// of a job without an output path is <output_dir>/<job name>.ply. The latencies of the inputs
+// are added to the report if there is one. The model is submitted to the thumbnail renderer if
+// there is one, the thumbnail of a job is <thumbnail_dir>/<job name>.png.
+bool RunBatchJob(const BatchJob& job, const std::string& output_dir, unsigned int& num_components, LatencyReport* latency = nullptr,
+                 OsgOffscreenRenderer* thumbnails = nullptr, const std::string& thumbnail_dir = std::string());
+
+#endif // BATCH_JOB_HPP
@@ -0,0 +1,93 @@
+#include "InteractionTrace.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+InteractionTraceRecorder::InteractionTraceRecorder() : m_recording(false) { }
+
+void InteractionTraceRecorder::Start(const BatchJob& settings) {
+
+    m_trace = settings;
+    m_trace.image_coordinates = false;
+    m_trace.events.clear();
+    m_trace.events.reserve(4096);
+    m_start = std::chrono::steady_clock::now();
+    m_recording = true;
+}
+
+void InteractionTraceRecorder::Stop() {
+    m_recording = false;
+}
+
+bool InteractionTraceRecorder::IsRecording() const {
+    return m_recording;
+}
+
+void InteractionTraceRecorder::Record(batch_event_type type, double x, double y) {
+
+    if(!m_recording) return;
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    m_trace.events.push_back(BatchEvent{type, x, y, time});
+}
+
+const BatchJob& InteractionTraceRecorder::GetTrace() const {
+    return m_trace;
+}
+
+LatencyReport::LatencyReport() : num_events(0) { }
+
+void LatencyReport::Add(const LatencySample& sample) {
+
+    ++num_events;
+    const double* stage = sample.stage;
+    if(stage[static_cast<int>(latency_stage::model_update)] > 0.0)
+        model_update.push_back(1000.0 * stage[static_cast<int>(latency_stage::model_update)]);
+    if(stage[static_cast<int>(latency_stage::ray_cast)] > 0.0)
+        ray_cast.push_back(1000.0 * stage[static_cast<int>(latency_stage::ray_cast)]);
+    if(stage[static_cast<int>(latency_stage::geometry_update)] > 0.0)
+        geometry_update.push_back(1000.0 * stage[static_cast<int>(latency_stage::geometry_update)]);
+}
+
+void LatencyReport::Merge(const LatencyReport& other) {
+
+    num_events += other.num_events;
+    model_update.insert(model_update.end(), other.model_update.begin(), other.model_update.end());
+    ray_cast.insert(ray_cast.end(), other.ray_cast.begin(), other.ray_cast.end());
+    geometry_update.insert(geometry_update.end(), other.geometry_update.begin(), other.geometry_update.end());
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+
+    // nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static void print_stage(const char* name, std::vector<double> times) {
+
+    std::cout << "\t" << std::left << std::setw(16) << name << std::right;
+    if(times.empty()) {
+        std::cout << "-" << std::endl;
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(3)
+              << "n=" << times.size()
+              << "  p50=" << percentile(times, 0.50)
+              << "  p90=" << percentile(times, 0.90)
+              << "  p99=" << percentile(times, 0.99)
+              << "  max=" << times.back() << " ms" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout.precision(precision);
+}
+
+void PrintLatencyReport(const std::string& title, const LatencyReport& report) {
+
+    std::cout << "INFO: Latency of " << title << " (" << report.num_events << " inputs)" << std::endl;
+    print_stage("model_update", report.model_update);
+    print_stage("ray_cast", report.ray_cast);
+    print_stage("geometry_update", report.geometry_update);
+}
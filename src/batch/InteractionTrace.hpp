@@ -0,0 +1,51 @@
+#ifndef INTERACTION_TRACE_HPP
+#define INTERACTION_TRACE_HPP
+
+#include "BatchJob.hpp"
+#include "../utility/LatencyProbe.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+/*
+ * Recording of the inputs that the GUI forwards to the ImageModeller.
+ *
+ * The trace is a batch job: the settings of the modeller when the recording starts, followed by
+ * the inputs in logical coordinates with their times. A recorded operator session is replayed by
+ * cvm_batch --latency, which runs the inputs through a headless modeller at full speed and reports
+ * the latencies of the interactive loop.
+ */
+class InteractionTraceRecorder {
+public:
+    InteractionTraceRecorder();
+    // settings holds the image and the modelling settings, its inputs are discarded
+    void Start(const BatchJob& settings);
+    void Stop();
+    bool IsRecording() const;
+    void Record(batch_event_type type, double x = 0.0, double y = 0.0);
+    const BatchJob& GetTrace() const;
+private:
+    bool m_recording;
+    BatchJob m_trace;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/*
+ * Latencies of the replayed inputs in milliseconds. Every input adds its model_update time and the
+ * ray casting and geometry updates within it, a stage is only added if the input has reached it.
+ */
+struct LatencyReport {
+    std::vector<double> model_update;
+    std::vector<double> ray_cast;
+    std::vector<double> geometry_update;
+    unsigned int num_events;
+
+    LatencyReport();
+    void Add(const LatencySample& sample);
+    void Merge(const LatencyReport& other);
+};
+
+// p50, p90, p99 and the maximum of every stage
+void PrintLatencyReport(const std::string& title, const LatencyReport& report);
+
+#endif // INTERACTION_TRACE_HPP
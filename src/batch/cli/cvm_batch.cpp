@@ -0,0 +1,197 @@
+#include "../BatchJob.hpp"
+#include "../InteractionTrace.hpp"
+#include "../../image/algorithms/GradientCache.hpp"
+#include "../../osg/OsgOffscreenRenderer.hpp"
+#include "../../utility/Logger.hpp"
+#include "../../utility/MemoryRegistry.hpp"
+#include "../../utility/RandomNumberGenerator.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * cvm_batch: models the images of a set of job files without the GUI.
+ *
+ *   cvm_batch [--threads n] [--seed n] [--output dir] [--cache dir] [--thumbnails dir] [--thumbnail-size n]
+ *             [--latency] [--log file] [--verbose] <job file | job directory>...
+ *
+ * The .cvmjob files of a directory are processed in parallel, see BatchJob.hpp for the format.
+ * The exit status is 0 only if every job has written its model.
+ *
+ * With --latency the jobs, usually the interaction traces recorded in the GUI, are replayed one at
+ * a time so that they do not compete for the cores, and the latency percentiles of every job and
+ * of all of them are printed.
+ *
+ * With --thumbnails the models are rendered over their images into PNG files without a window,
+ * see OsgOffscreenRenderer.hpp; the jobs go on without the thumbnails if there is no offscreen
+ * context.
+ *
+ * The peak of the images, gradients and components of the running jobs (see MemoryRegistry) is
+ * printed at the end, a job releases them once it is done.
+ *
+ * The messages of the jobs go through the asynchronous logger to the console and, with --log, to a
+ * file as well; --verbose adds the debug messages, e.g. the reports of the solver.
+ */
+
+static const std::string job_extension = ".cvmjob";
+
+static void print_usage() {
+
+    std::cout << "usage: cvm_batch [--threads n] [--seed n] [--output dir] [--cache dir] [--thumbnails dir] [--thumbnail-size n]" << std::endl;
+    std::cout << "                 [--latency] [--log file] [--verbose] <job file | job directory>..." << std::endl;
+    std::cout << "  --threads n   number of jobs modelled in parallel, the number of cores by default" << std::endl;
+    std::cout << "  --seed n      seed of the random numbers, e.g. of the RANSAC ellipse fits, fixed by default" << std::endl;
+    std::cout << "  --output dir  directory of the models of the jobs without an output, the current directory by default" << std::endl;
+    std::cout << "  --cache dir   directory of the gradient cache" << std::endl;
+    std::cout << "  --thumbnails dir     render the models over their images into the directory" << std::endl;
+    std::cout << "  --thumbnail-size n   maximum width and height of the thumbnails, 512 by default" << std::endl;
+    std::cout << "  --latency     replay the jobs one at a time and report the latencies of the inputs" << std::endl;
+    std::cout << "  --log file    append the messages to the file as well" << std::endl;
+    std::cout << "  --verbose     print the debug messages as well" << std::endl;
+}
+
+static bool has_extension(const std::string& name, const std::string& ext) {
+    return name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+static void collect_job_files(const std::string& path, std::vector<std::string>& files) {
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) {
+        std::cout << "ERROR: No such job file or directory: " << path << std::endl;
+        return;
+    }
+    if(!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr) {
+        std::cout << "ERROR: Job directory cannot be read: " << path << std::endl;
+        return;
+    }
+    std::vector<std::string> names;
+    for(struct dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+        std::string name(entry->d_name);
+        if(has_extension(name, job_extension)) names.push_back(path + "/" + name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    files.insert(files.end(), names.begin(), names.end());
+}
+
+int main(int argc, char** argv) {
+
+    // Step-1: arguments
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output_dir(".");
+    bool report_latency = false;
+    std::string log_file;
+    bool verbose = false;
+    std::string thumbnail_dir;
+    int thumbnail_size = OsgOffscreenRenderer::default_thumbnail_size;
+    std::vector<std::string> files;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if(arg == "--threads" && i + 1 < argc)     num_threads = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--seed" && i + 1 < argc)   RandomNumberGenerator::SetGlobalSeed(std::strtoull(argv[++i], nullptr, 10));
+        else if(arg == "--output" && i + 1 < argc) output_dir = argv[++i];
+        else if(arg == "--cache" && i + 1 < argc)  GradientCache::Instance().SetCacheDirectory(argv[++i]);
+        else if(arg == "--thumbnails" && i + 1 < argc)     thumbnail_dir = argv[++i];
+        else if(arg == "--thumbnail-size" && i + 1 < argc) thumbnail_size = std::atoi(argv[++i]);
+        else if(arg == "--latency")                report_latency = true;
+        else if(arg == "--log" && i + 1 < argc)    log_file = argv[++i];
+        else if(arg == "--verbose")                verbose = true;
+        else if(arg == "-h" || arg == "--help") {
+            print_usage();
+            return EXIT_SUCCESS;
+        }
+        else if(!arg.empty() && arg[0] == '-') {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+        else collect_job_files(arg, files);
+    }
+    if(files.empty()) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // Step-2: the workers do not wait for the console
+    Logger& logger = Logger::Instance();
+    if(verbose) logger.SetLevel(log_level::debug);
+    if(!log_file.empty() && !logger.SetLogFile(log_file))
+        std::cout << "WARNING: Log file cannot be opened: " << log_file << std::endl;
+    logger.SetConsoleOutput(true);
+    logger.RedirectStandardStreams();
+
+    // Step-3: a single offscreen context renders the thumbnails of all the workers
+    std::unique_ptr<OsgOffscreenRenderer> thumbnails;
+    if(!thumbnail_dir.empty()) {
+        thumbnails.reset(new OsgOffscreenRenderer(thumbnail_size));
+        if(!thumbnails->Start()) {
+            std::cout << "WARNING: Thumbnails are not rendered without an offscreen context" << std::endl;
+            thumbnails.reset();
+        }
+    }
+
+    // Step-4: the jobs are shared by the workers, every worker models one image at a time
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> num_failed(0);
+    std::mutex report_mutex;
+    LatencyReport total_latency;
+    auto worker = [&]() {
+        for(size_t i = next++; i < files.size(); i = next++) {
+            BatchJob job;
+            LatencyReport latency;
+            unsigned int num_components = 0;
+            bool done = false;
+            try {
+                done = ReadBatchJob(files[i], job) && RunBatchJob(job, output_dir, num_components, report_latency ? &latency : nullptr,
+                                                                 thumbnails.get(), thumbnail_dir);
+            }
+            catch(const std::exception& e) {
+                // e.g. an image that cannot be read, the other jobs go on
+                std::cout << "ERROR: " << files[i] << ": " << e.what() << std::endl;
+            }
+            if(!done) ++num_failed;
+            std::lock_guard<std::mutex> lock(report_mutex);
+            std::cout << (done ? "INFO: Done: " : "ERROR: Failed: ") << files[i];
+            if(done) std::cout << " (" << num_components << " components)";
+            std::cout << std::endl;
+            if(report_latency) {
+                PrintLatencyReport(files[i], latency);
+                total_latency.Merge(latency);
+            }
+        }
+    };
+
+    if(report_latency) num_threads = 1;
+    num_threads = std::min<size_t>(num_threads, files.size());
+    std::vector<std::thread> workers;
+    for(unsigned int t = 1; t < num_threads; ++t)
+        workers.push_back(std::thread(worker));
+    worker();
+    for(std::thread& t : workers)
+        t.join();
+
+    if(report_latency && files.size() > 1) PrintLatencyReport("all jobs", total_latency);
+    if(thumbnails) std::cout << "INFO: " << thumbnails->Finish() << " thumbnails are rendered" << std::endl;
+    std::cout << "INFO: " << files.size() - num_failed << " of " << files.size() << " jobs are modelled" << std::endl;
+    std::cout << "INFO: Peak memory of the images, gradients and components: " << MemoryRegistry::Instance().GetPeakBytes() / (1024 * 1024) << " MB" << std::endl;
+    logger.RestoreStandardStreams();
+    logger.Flush();
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
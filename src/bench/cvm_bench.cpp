@@ -0,0 +1,625 @@
+#include "../geometry/Circle3D.hpp"
+#include "../geometry/Ellipse2D.hpp"
+#include "../geometry/Primitives.hpp"
+#include "../geometry/Rectangle2D.hpp"
+#include "../image/algorithms/Algorithms.hpp"
+#include "../image/algorithms/RayCast.hpp"
+#include "../image/algorithms/RegionGrower.hpp"
+#include "../modeller/ProjectionParameters.hpp"
+#include "../modeller/components/GeneralizedCylinder.hpp"
+#include "../modeller/components/GeneralizedCylinderGeometry.hpp"
+#include "../modeller/optimization/CircleEstimator.hpp"
+#include "../modeller/optimization/ComponentSolver.hpp"
+#include "../modeller/optimization/ExtractPlaneNormals.hpp"
+#include "../utility/AlgebraicKernel.hpp"
+#include "../utility/RandomNumberGenerator.hpp"
+
+#include <benchmark/benchmark.h>
+#include <osg/ref_ptr>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * cvm_bench: Google Benchmark suite of the geometry and estimation hot paths.
+ *
+ *   cvm_bench [benchmark flags] [--images dir]
+ *
+ * The image benchmarks (ray casts, region growing) run on every image of data/images, the
+ * others on random but reproducible input. The solvers print their ceres reports, the standard
+ * output is muted while they run. The analytic jacobians of the solvers are checked against
+ * autodiff first, the run fails without benchmarking if one of them does not match.
+ */
+
+static const int image_width = 800;
+static const int image_height = 600;
+static const size_t num_ellipses = 256;
+static const double fixed_depth = -(1.0 + 100.0) / 2.0;    // the fixed depth of ImageModeller
+
+// Step-1: inputs
+
+// ellipses drawn in logical device coordinates (as the user draws them) and their projected versions
+struct ellipse_set {
+    std::vector<Ellipse2D> device;
+    std::vector<Ellipse2D> projected;
+};
+
+static ProjectionParameters& projection_parameters() {
+
+    static ProjectionParameters pp(45, image_width, image_height, 1.0, 100.0);
+    return pp;
+}
+
+static const ellipse_set& ellipses() {
+
+    static ellipse_set set;
+    if(!set.device.empty()) return set;
+
+    std::mt19937 engine(7);
+    std::uniform_real_distribution<double> cx(100.0, image_width - 100.0), cy(100.0, image_height - 100.0);
+    std::uniform_real_distribution<double> smj(20.0, 90.0), ratio(0.15, 0.9), rot(0.0, M_PI);
+    for(size_t i = 0; i < num_ellipses; ++i) {
+        double a = smj(engine);
+        Ellipse2D ellipse(a, a * ratio(engine), rot(engine), osg::Vec2d(cx(engine), cy(engine)));
+        ellipse.calculate_axes_end_points();
+        ellipse.calculate_coefficients_from_parameters();
+        Ellipse2D projected;
+        projection_parameters().convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(ellipse, projected);
+        set.device.push_back(ellipse);
+        set.projected.push_back(projected);
+    }
+    return set;
+}
+
+// sections of a generalized cylinder along a slightly curved axis in front of the camera
+static void cylinder_sections(size_t num_sections, std::vector<Circle3D>& sections) {
+
+    sections.clear();
+    for(size_t i = 0; i < num_sections; ++i) {
+        double t = static_cast<double>(i) / num_sections;
+        Eigen::Vector3d center(0.2 * std::sin(3.0 * t), -1.0 + 2.0 * t, -10.0);
+        Eigen::Vector3d normal(0.6 * std::cos(3.0 * t), 2.0, 0.0);
+        sections.push_back(Circle3D(center, normal, 0.5 + 0.1 * std::sin(5.0 * t)));
+    }
+}
+
+struct bench_image {
+    std::string name;
+    int width, height;
+    std::vector<unsigned char> rgb;
+    OtbImageType::Pointer gradient;
+    std::vector<RaySegment> rays;
+};
+
+static std::vector<bench_image>& images() {
+
+    static std::vector<bench_image> imgs;
+    return imgs;
+}
+
+static bool load_image(const std::string& dir, const std::string& name, bench_image& img) {
+
+    OtbVectorImageType::Pointer vimg = LoadImage<OtbVectorImageType>(dir + "/" + name);
+    if(vimg.IsNull()) return false;
+    OtbVectorImageType::SizeType size = vimg->GetLargestPossibleRegion().GetSize();
+    img.name = name;
+    img.width = static_cast<int>(size[0]);
+    img.height = static_cast<int>(size[1]);
+
+    // interleaved rgb, gray and rgba images are expanded or cut
+    unsigned int num_components = vimg->GetNumberOfComponentsPerPixel();
+    const unsigned char* src = vimg->GetBufferPointer();
+    size_t num_pixels = static_cast<size_t>(img.width) * img.height;
+    img.rgb.resize(3 * num_pixels);
+    for(size_t i = 0; i < num_pixels; ++i)
+        for(unsigned int k = 0; k < 3; ++k)
+            img.rgb[3*i + k] = src[num_components * i + std::min(k, num_components - 1)];
+    img.gradient = GradientMagnitudeImage(vimg);
+
+    // profile rays: short segments across the image, as the ray casts of the modeller
+    std::mt19937 engine(11);
+    std::uniform_int_distribution<int> x(0, img.width - 1), y(0, img.height - 1), d(-60, 60);
+    for(int i = 0; i < 4096; ++i) {
+        Point2D<int> start(x(engine), y(engine));
+        Point2D<int> end(std::max(0, std::min(img.width - 1, start.x + d(engine))),
+                         std::max(0, std::min(img.height - 1, start.y + d(engine))));
+        img.rays.push_back(RaySegment(start, end));
+    }
+    return true;
+}
+
+// the solvers print their reports
+class mute_stdout {
+public:
+    mute_stdout() : m_buffer(std::cout.rdbuf(nullptr)) { }
+    ~mute_stdout() { std::cout.rdbuf(m_buffer); }
+private:
+    std::streambuf* m_buffer;
+};
+
+// Step-2: geometry and estimation
+
+static void BM_ProjectionLogicalToProjected(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().device;
+    std::vector<osg::Vec2d> logical, projected(4 * elps.size());
+    for(const Ellipse2D& e : elps)
+        logical.insert(logical.end(), e.points, e.points + 4);
+    const ProjectionParameters& pp = projection_parameters();
+    for(auto _ : state) {
+        pp.convert_from_logical_device_coordinates_to_projected_coordinates(logical.data(), projected.data(), logical.size());
+        benchmark::DoNotOptimize(projected.data());
+    }
+    state.SetItemsProcessed(state.iterations() * logical.size());
+}
+BENCHMARK(BM_ProjectionLogicalToProjected);
+
+static void BM_EllipseCoefficientsFromParameters(benchmark::State& state) {
+
+    std::vector<Ellipse2D> elps = ellipses().device;
+    size_t i = 0;
+    for(auto _ : state) {
+        Ellipse2D& e = elps[i++ % elps.size()];
+        e.calculate_coefficients_from_parameters();
+        benchmark::DoNotOptimize(e.get_coefficients());
+    }
+}
+BENCHMARK(BM_EllipseCoefficientsFromParameters);
+
+static void BM_EllipseParametersFromCoefficients(benchmark::State& state) {
+
+    std::vector<Ellipse2D> elps = ellipses().device;
+    size_t i = 0;
+    for(auto _ : state) {
+        Ellipse2D& e = elps[i++ % elps.size()];
+        e.calculate_parameters_from_coeffients();
+        benchmark::DoNotOptimize(e.center);
+    }
+}
+BENCHMARK(BM_EllipseParametersFromCoefficients);
+
+// profile rays from inside the image to anywhere around it, as the outward ray casts of the modeller
+struct clip_rays {
+    std::vector<int> x0, y0, x1, y1;
+};
+
+static const clip_rays& rays_to_clip() {
+
+    static clip_rays rays;
+    if(!rays.x0.empty()) return rays;
+
+    std::mt19937 engine(13);
+    std::uniform_int_distribution<int> x(0, image_width - 1), y(0, image_height - 1), d(-image_width, image_width);
+    for(int i = 0; i < 1024; ++i) {
+        rays.x0.push_back(x(engine));
+        rays.y0.push_back(y(engine));
+        rays.x1.push_back(rays.x0.back() + d(engine));
+        rays.y1.push_back(rays.y0.back() + d(engine));
+    }
+    return rays;
+}
+
+static void BM_Rectangle2DIntersect(benchmark::State& state) {
+
+    const clip_rays& rays = rays_to_clip();
+    Rectangle2D rect(0, 0, image_width - 1, image_height - 1);
+    mute_stdout mute;
+    for(auto _ : state) {
+        for(size_t i = 0; i < rays.x0.size(); ++i) {
+            Point2D<int> start(rays.x0[i], rays.y0[i]), end(rays.x1[i], rays.y1[i]);
+            benchmark::DoNotOptimize(rect.intersect(start, end));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * rays.x0.size());
+}
+BENCHMARK(BM_Rectangle2DIntersect);
+
+static void BM_Rectangle2DClipBatch(benchmark::State& state) {
+
+    const clip_rays& rays = rays_to_clip();
+    Rectangle2D rect(0, 0, image_width - 1, image_height - 1);
+    clip_rays clipped = rays;
+    std::vector<unsigned char> inside(rays.x0.size());
+    for(auto _ : state) {
+        state.PauseTiming();
+        clipped = rays;
+        state.ResumeTiming();
+        rect.clip(rays.x0.size(), clipped.x0.data(), clipped.y0.data(), clipped.x1.data(), clipped.y1.data(), inside.data());
+        benchmark::DoNotOptimize(inside.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rays.x0.size());
+}
+BENCHMARK(BM_Rectangle2DClipBatch);
+
+// cone matrices of the projected ellipses, the input of the plane normal extraction of Method-1
+static const std::vector<Eigen::Matrix3d>& cone_matrices() {
+
+    static std::vector<Eigen::Matrix3d> cones;
+    if(!cones.empty()) return cones;
+
+    double near = -projection_parameters().near;
+    for(const Ellipse2D& e : ellipses().projected) {
+        const double* coeff = e.get_coefficients();
+        Eigen::Matrix3d M;
+        M << coeff[0],          coeff[1]/2.0,      coeff[3]/(2*near),
+             coeff[1]/2.0,      coeff[2],          coeff[4]/(2*near),
+             coeff[3]/(2*near), coeff[4]/(2*near), coeff[5]/(near*near);
+        cones.push_back(M);
+    }
+    return cones;
+}
+
+static void BM_PlaneNormalsClosedForm(benchmark::State& state) {
+
+    const std::vector<Eigen::Matrix3d>& cones = cone_matrices();
+    Eigen::Vector3d n1, n2;
+    size_t i = 0;
+    for(auto _ : state) {
+        solve_for_normals(cones[i++ % cones.size()], n1, n2);
+        benchmark::DoNotOptimize(n1.data());
+        benchmark::DoNotOptimize(n2.data());
+    }
+}
+BENCHMARK(BM_PlaneNormalsClosedForm);
+
+static void BM_PlaneNormalsLeastSquares(benchmark::State& state) {
+
+    const std::vector<Eigen::Matrix3d>& cones = cone_matrices();
+    Eigen::Vector3d n1, n2;
+    size_t i = 0;
+    for(auto _ : state) {
+        solve_for_normals_least_squares(cones[i++ % cones.size()], n1, n2);
+        benchmark::DoNotOptimize(n1.data());
+        benchmark::DoNotOptimize(n2.data());
+    }
+}
+BENCHMARK(BM_PlaneNormalsLeastSquares);
+
+static void BM_CircleEstimatorFixedRadius(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    CircleEstimator estimator;
+    Circle3D circles[2];
+    size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(estimator.estimate_3d_circles_with_fixed_radius(elps[i++ % elps.size()], circles, &projection_parameters(), 1.0));
+}
+BENCHMARK(BM_CircleEstimatorFixedRadius);
+
+static void BM_CircleEstimatorFixedDepth(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    CircleEstimator estimator;
+    Circle3D circles[2];
+    size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(estimator.estimate_3d_circles_with_fixed_depth(elps[i++ % elps.size()], circles, &projection_parameters(), fixed_depth));
+}
+BENCHMARK(BM_CircleEstimatorFixedDepth);
+
+static void BM_CircleEstimatorUnitCircles(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    CircleEstimator estimator;
+    Circle3D circles[2];
+    size_t i = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(estimator.estimate_unit_3d_circles(elps[i++ % elps.size()], circles, &projection_parameters()));
+}
+BENCHMARK(BM_CircleEstimatorUnitCircles);
+
+static void BM_CircleEstimatorOrthographic(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    CircleEstimator estimator;
+    Circle3D circle;
+    size_t i = 0;
+    for(auto _ : state) {
+        estimator.estimate_3d_circles_under_orthographic_projection(elps[i++ % elps.size()], circle, -projection_parameters().near);
+        benchmark::DoNotOptimize(circle.radius);
+    }
+}
+BENCHMARK(BM_CircleEstimatorOrthographic);
+
+static void BM_CircleEstimatorOrthogonalityConstraint(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    CircleEstimator estimator;
+    Circle3D circles[2];
+    size_t i = 0;
+    for(auto _ : state) {
+        estimator.estimate_3d_circles_using_orthogonality_constraint(elps[i++ % elps.size()], -projection_parameters().near, circles, false);
+        benchmark::DoNotOptimize(circles[0].radius);
+    }
+}
+BENCHMARK(BM_CircleEstimatorOrthogonalityConstraint);
+
+// polynomials of degree range(0) with real roots in [-2, 2] and one complex pair
+static void BM_AlgebraicKernelSolve(benchmark::State& state) {
+
+    int degree = static_cast<int>(state.range(0));
+    std::mt19937 engine(3);
+    std::uniform_real_distribution<double> root(-2.0, 2.0);
+    std::vector<std::vector<double>> polys(64);
+    for(std::vector<double>& p : polys) {
+        // (x^2 + 1) * prod(x - r_i)
+        p = { 1.0, 0.0, 1.0 };
+        for(int i = 2; i < degree; ++i) {
+            double r = root(engine);
+            std::vector<double> q(p.size() + 1, 0.0);
+            for(size_t k = 0; k < p.size(); ++k) {
+                q[k] += p[k];
+                q[k + 1] -= r * p[k];
+            }
+            p.swap(q);
+        }
+    }
+
+    AlgebraicKernel kernel;
+    std::vector<double> roots;
+    size_t i = 0;
+    for(auto _ : state) {
+        kernel.solve(polys[i++ % polys.size()], roots);
+        benchmark::DoNotOptimize(roots.data());
+    }
+}
+BENCHMARK(BM_AlgebraicKernelSolve)->Arg(4)->Arg(6)->Arg(8);
+
+static void BM_GeneralizedCylinderAddPlanarSection(benchmark::State& state) {
+
+    std::vector<Circle3D> sections;
+    cylinder_sections(static_cast<size_t>(state.range(0)), sections);
+    for(auto _ : state) {
+        osg::ref_ptr<GeneralizedCylinderGeometry> geometry = new GeneralizedCylinderGeometry(sections[0], 40, osg::Vec4(1, 1, 0, 1), rendering_type::triangle_strip);
+        for(size_t i = 1; i < sections.size(); ++i)
+            geometry->AddPlanarSection(sections[i]);
+        benchmark::DoNotOptimize(geometry->GetNumberOfSections());
+    }
+    state.SetItemsProcessed(state.iterations() * (sections.size() - 1));
+}
+BENCHMARK(BM_GeneralizedCylinderAddPlanarSection)->Arg(16)->Arg(128)->Arg(1024);
+
+static void BM_GeneralizedCylinderRecalculate(benchmark::State& state) {
+
+    std::vector<Circle3D> sections;
+    cylinder_sections(static_cast<size_t>(state.range(0)), sections);
+    osg::ref_ptr<GeneralizedCylinderGeometry> geometry = new GeneralizedCylinderGeometry(sections[0], 40, osg::Vec4(1, 1, 0, 1), rendering_type::triangle_strip);
+    for(size_t i = 1; i < sections.size(); ++i)
+        geometry->AddPlanarSection(sections[i]);
+    for(auto _ : state) {
+        geometry->Recalculate();
+        benchmark::DoNotOptimize(geometry->GetNumberOfSections());
+    }
+    state.SetItemsProcessed(state.iterations() * sections.size());
+}
+BENCHMARK(BM_GeneralizedCylinderRecalculate)->Arg(16)->Arg(128)->Arg(1024);
+
+// Step-3: solvers
+
+static void BM_ComponentSolverSingleCircle(benchmark::State& state) {
+
+    const std::vector<Ellipse2D>& elps = ellipses().projected;
+    const double near = projection_parameters().near;
+    CircleEstimator estimator;
+    ComponentSolver solver(-near);
+    solver.SetAnalyticJacobians(state.range(0) != 0);
+    osg::ref_ptr<osg::Vec2dArray> proj = new osg::Vec2dArray(2);
+    mute_stdout mute;
+    size_t i = 0;
+    for(auto _ : state) {
+        state.PauseTiming();
+        const Ellipse2D& e = elps[i++ % elps.size()];
+        Circle3D circles[2];
+        int count = estimator.estimate_3d_circles_with_fixed_depth(e, circles, &projection_parameters(), fixed_depth);
+        Circle3D circle = (count > 0) ? circles[0] : Circle3D(Eigen::Vector3d(0, 0, -10), Eigen::Vector3d(0, 1, 1), 1.0);
+        (*proj)[0] = e.points[0];
+        (*proj)[1] = e.points[1];
+        state.ResumeTiming();
+        solver.SolveForSingleCircle(proj.get(), circle);
+        benchmark::DoNotOptimize(circle.radius);
+    }
+}
+BENCHMARK(BM_ComponentSolverSingleCircle)->Arg(0)->Arg(1);
+
+// residuals and jacobians of the Sampson distances of range(0) edge points of a projected ellipse
+static void BM_SampsonCircleResidual(benchmark::State& state) {
+
+    const Ellipse2D& e = ellipses().projected[0];
+    const double near = projection_parameters().near;
+    CircleEstimator estimator;
+    Circle3D circles[2];
+    int count = estimator.estimate_3d_circles_with_fixed_depth(e, circles, &projection_parameters(), fixed_depth);
+    Circle3D circle = (count > 0) ? circles[0] : Circle3D(Eigen::Vector3d(0, 0, -10), Eigen::Vector3d(0, 1, 1), 1.0);
+    const int num_points = static_cast<int>(state.range(0));
+    std::vector<osg::Vec2d> points(num_points);
+    double c = std::cos(e.rot_angle), s = std::sin(e.rot_angle);
+    for(int i = 0; i < num_points; ++i) {
+        double t = 2.0 * M_PI * i / num_points;
+        double x = e.smj_axis * std::cos(t), y = e.smn_axis * std::sin(t);
+        points[i] = e.center + osg::Vec2d(c * x - s * y, s * x + c * y);
+    }
+    SampsonCircleCostFunction cost(points, circle.radius, -near);
+    double params[6] = { circle.center[0], circle.center[1], circle.center[2], circle.normal[0], circle.normal[1], circle.normal[2] };
+    const double* parameters[1] = { params };
+    std::vector<double> residuals(num_points + 1), jacobian(6 * (num_points + 1));
+    double* jacobians[1] = { jacobian.data() };
+    for(auto _ : state) {
+        cost.Evaluate(parameters, residuals.data(), jacobians);
+        benchmark::DoNotOptimize(jacobian.data());
+    }
+    state.SetItemsProcessed(state.iterations() * num_points);
+}
+BENCHMARK(BM_SampsonCircleResidual)->Arg(64)->Arg(360);
+
+static void BM_ComponentSolverDepth(benchmark::State& state) {
+
+    std::vector<Circle3D> sections;
+    cylinder_sections(64, sections);
+    ComponentSolver solver(-projection_parameters().near);
+    solver.SetAnalyticJacobians(state.range(0) != 0);
+    size_t i = 0;
+    for(auto _ : state) {
+        size_t k = 1 + i++ % (sections.size() - 1);
+        Circle3D current = sections[k];
+        current.center *= 1.3;
+        current.radius *= 1.3;
+        benchmark::DoNotOptimize(solver.SolveDepth(sections[k - 1], current, 1.0));
+    }
+}
+BENCHMARK(BM_ComponentSolverDepth)->Arg(0)->Arg(1);
+
+// the sections are scaled randomly and solved from scratch, items are sections
+static void BM_ComponentSolverGeneralizedCylinder(benchmark::State& state) {
+
+    std::vector<Circle3D> sections;
+    cylinder_sections(static_cast<size_t>(state.range(0)), sections);
+    ComponentSolver solver(-projection_parameters().near);
+    solver.SetAnalyticJacobians(state.range(1) != 0);
+    osg::ref_ptr<GeneralizedCylinder> gcyl = new GeneralizedCylinder(0, sections[0], rendering_type::triangle_strip);
+    std::mt19937 engine(5);
+    std::uniform_real_distribution<double> scale(0.7, 1.4);
+    mute_stdout mute;
+    for(auto _ : state) {
+        state.PauseTiming();
+        solver.ForgetAllComponents();
+        SectionStore& store = gcyl->GetGeometry()->GetSections();
+        store.clear();
+        for(const Circle3D& circle : sections)
+            store.push_back(circle);
+        for(size_t i = 1; i < store.size(); ++i)
+            store.scale(i, scale(engine));
+        state.ResumeTiming();
+        solver.SolveGeneralizedCylinder(gcyl.get());
+    }
+    state.SetItemsProcessed(state.iterations() * sections.size());
+}
+BENCHMARK(BM_ComponentSolverGeneralizedCylinder)->Args({16, 1})->Args({128, 1})->Args({128, 0});
+
+// the same problem reduced to the radius profile of a section constraint, items are sections
+static void BM_ComponentSolverSectionProfile(benchmark::State& state) {
+
+    std::vector<Circle3D> sections;
+    cylinder_sections(static_cast<size_t>(state.range(0)), sections);
+    std::mt19937 engine(5);
+    std::uniform_real_distribution<double> scale(0.7, 1.4);
+    SectionStore store;
+    for(auto _ : state) {
+        state.PauseTiming();
+        store.clear();
+        for(const Circle3D& circle : sections)
+            store.push_back(circle);
+        for(size_t i = 1; i < store.size(); ++i)
+            store.scale(i, scale(engine));
+        state.ResumeTiming();
+        if(state.range(1) == 0) benchmark::DoNotOptimize(ComponentSolver::SolveSectionProfile<section_constraints::constant>(store));
+        else                    benchmark::DoNotOptimize(ComponentSolver::SolveSectionProfile<section_constraints::linear_scaling>(store));
+    }
+    state.SetItemsProcessed(state.iterations() * sections.size());
+}
+BENCHMARK(BM_ComponentSolverSectionProfile)->Args({128, 0})->Args({128, 1});
+
+// uniform doubles from the scalar generator (0) or the bulk fill (1), items are numbers
+static void BM_RandomNumberGeneratorDoubles(benchmark::State& state) {
+
+    RandomNumberGenerator rng(1, 0);
+    std::vector<double> values;
+    values.reserve(4096);
+    for(auto _ : state) {
+        values.clear();
+        if(state.range(0) == 0) {
+            for(int i = 0; i < 4096; ++i)
+                values.push_back(rng.generate_double());
+        }
+        else {
+            rng.generate_double(values, 4096);
+        }
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 4096);
+}
+BENCHMARK(BM_RandomNumberGeneratorDoubles)->Arg(0)->Arg(1);
+
+// Step-4: image algorithms, registered for every loaded image
+
+static void BM_GradientImageRayCast(benchmark::State& state, const bench_image* img) {
+
+    Point2D<int> hit;
+    size_t i = 0;
+    for(auto _ : state) {
+        const RaySegment& ray = img->rays[i++ % img->rays.size()];
+        benchmark::DoNotOptimize(GradientImageRayCast(img->gradient, ray.start, ray.end, hit));
+    }
+}
+
+static void BM_GradientImageRayCastSubpixel(benchmark::State& state, const bench_image* img) {
+
+    Point2D<int> hit;
+    Point2D<double> subpixel_hit;
+    size_t i = 0;
+    for(auto _ : state) {
+        const RaySegment& ray = img->rays[i++ % img->rays.size()];
+        benchmark::DoNotOptimize(GradientImageRayCast(img->gradient, ray.start, ray.end, hit, subpixel_hit));
+    }
+}
+
+// items are rays
+static void BM_GradientImageRayCastBatch(benchmark::State& state, const bench_image* img) {
+
+    std::vector<RayHit> hits;
+    for(auto _ : state) {
+        GradientImageRayCast(img->gradient, img->rays, hits, false, static_cast<unsigned int>(state.range(0)));
+        benchmark::DoNotOptimize(hits.data());
+    }
+    state.SetItemsProcessed(state.iterations() * img->rays.size());
+}
+
+// region growing from the center of the image, items are pixels of the image
+static void BM_RegionGrow(benchmark::State& state, const bench_image* img) {
+
+    RegionGrower grower;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(grower.Grow(img->rgb.data(), img->width, img->height, img->width / 2, img->height / 2, static_cast<int>(state.range(0))));
+    state.SetItemsProcessed(state.iterations() * img->width * img->height);
+    state.counters["selected"] = grower.GetNumSelected();
+}
+
+int main(int argc, char** argv) {
+
+    // Step-1: our own arguments, the rest is for the benchmark library
+    std::string image_dir(CVM_BENCH_IMAGE_DIR);
+    std::vector<char*> args;
+    for(int i = 0; i < argc; ++i) {
+        if(std::string(argv[i]) == "--images" && i + 1 < argc) image_dir = argv[++i];
+        else args.push_back(argv[i]);
+    }
+    int num_args = static_cast<int>(args.size());
+    benchmark::Initialize(&num_args, args.data());
+
+    // the analytic cost functions are timed below, a mismatch with their autodiff reference fails the run
+    if(!ComponentSolver::CheckAnalyticJacobians()) return EXIT_FAILURE;
+
+    // Step-2: images, a missing one only disables its benchmarks
+    static const char* names[] = { "cylinder.jpg", "menorah.png", "stacked_cylinders.png", "walllamp.png" };
+    for(const char* name : names) {
+        bench_image img;
+        try {
+            if(load_image(image_dir, name, img)) images().push_back(img);
+        }
+        catch(const std::exception& e) {
+            std::cout << "ERROR: " << image_dir << "/" << name << " cannot be loaded: " << e.what() << std::endl;
+        }
+    }
+    for(const bench_image& img : images()) {
+        benchmark::RegisterBenchmark(("BM_GradientImageRayCast/" + img.name).c_str(), BM_GradientImageRayCast, &img);
+        benchmark::RegisterBenchmark(("BM_GradientImageRayCastSubpixel/" + img.name).c_str(), BM_GradientImageRayCastSubpixel, &img);
+        benchmark::RegisterBenchmark(("BM_GradientImageRayCastBatch/" + img.name).c_str(), BM_GradientImageRayCastBatch, &img)->Arg(1)->Arg(0)->UseRealTime();
+        benchmark::RegisterBenchmark(("BM_RegionGrow/" + img.name).c_str(), BM_RegionGrow, &img)->Arg(10)->Arg(40);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    return EXIT_SUCCESS;
+}
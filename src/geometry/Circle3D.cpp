@@ -2,7 +2,7 @@
 #include <cmath>
 
 #include "Circle3D.hpp"
-#include "../utility/RandomNumberGenerator.hpp"
+#include "SectionFrame.hpp"
 #include "../utility/Utility.hpp"
 #include "../osg/OsgUtility.hpp"
 
@@ -46,18 +46,17 @@ void Circle3D::get_matrix_representation(Eigen::Matrix4d& mat) const {
     mat = Nx4 + C4*C4.transpose();
 }
 
-void Circle3D::generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, int num_points, bool random) const {
+void Circle3D::generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, int num_points) const {
 
     Eigen::Vector3d e1, e2;
-    if(random) find_random_orthonomal_basis(e1, e2);
-    else       find_orthonomal_basis(e1, e2);
+    find_orthonomal_basis(e1, e2);
 
     // Construct the data points for the given planar section
-    const double step = TWO_PI/static_cast<double>(num_points);
+    std::shared_ptr<const RingTable> ring = RingTable::Get(num_points);
     Eigen::Vector3d n, pos;
 
-    for(double t = 0.0; t < TWO_PI; t += step) {
-        n = e1*(radius*cos(t)) + e2*(radius*sin(t));
+    for(int i = 0; i < num_points; ++i) {
+        n = e1*(radius*ring->Cos()[i]) + e2*(radius*ring->Sin()[i]);
         pos = center + n;
         vertices->push_back(osg::Vec3(pos[0], pos[1], pos[2]));
         n.normalize();
@@ -65,17 +64,16 @@ void Circle3D::generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_pt
     }
 }
 
-void Circle3D::generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, int num_points, bool random) const {
+void Circle3D::generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, int num_points) const {
 
     Eigen::Vector3d e1, e2;
-    if(random) find_random_orthonomal_basis(e1, e2);
-    else find_orthonomal_basis(e1, e2);
+    find_orthonomal_basis(e1, e2);
 
-    const double step = TWO_PI/static_cast<double>(num_points);
+    std::shared_ptr<const RingTable> ring = RingTable::Get(num_points);
     Eigen::Vector3d pos;
 
-    for(double t = 0.0; t < TWO_PI; t+= step) {
-        pos = center + (radius*cos(t))*e1 + (radius*sin(t))*e2;
+    for(int i = 0; i < num_points; ++i) {
+        pos = center + (radius*ring->Cos()[i])*e1 + (radius*ring->Sin()[i])*e2;
         vertices->push_back(osg::Vec3(pos[0], pos[1], pos[2]));
     }
 }
@@ -100,44 +98,36 @@ void Circle3D::generate_aligned_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg
     }
 }
 
-void Circle3D::find_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d& e2) const {
+void Circle3D::generate_frame(Eigen::Vector3d& u, Eigen::Vector3d& v) const {
 
-    // Find 3 othonormal basis vectors for the planar section: 2 vectors
-    // in the plane of the section and 1 vector along the direction of the normal
-    if(normal[0] != 0 || normal[1] != 0) {
-        e1 = Eigen::Vector3d(-normal[1], normal[0], 0);
-        e1.normalize();
-    }
-    else {
-        e1 = Eigen::Vector3d(1, 0, 0);
-    }
-    e2 = normal.cross(e1);
+    find_orthonomal_basis(u, v);
+    u *= radius;
+    v *= radius;
+}
 
-#ifdef DEBUG
-    // Check that e1 and e2 is on the plane:
-    Eigen::Vector4d plane(normal(0), normal(1), normal(2), - normal.dot(center));
-    Eigen::Vector3d v1 = e1 + center;
-    Eigen::Vector3d v2 = e2 + center;
-    assert(plane.dot(Eigen::Vector4d(v1(0), v1(1), v1(2), 1)) < 0.00001);
-    assert(plane.dot(Eigen::Vector4d(v2(0), v2(1), v2(2), 1)) < 0.00001);
-#endif // DEBUG
+void Circle3D::generate_aligned_frame(Eigen::Vector3d& u, Eigen::Vector3d& v, const Circle3D& circle) const {
+
+    // same alignment as generate_aligned_data: the frame of the given circle is transformed onto this one
+    Eigen::Vector3d u1, v1;
+    circle.generate_frame(u1, v1);
+
+    osg::Matrixd mat;
+    calculate_transformation_matrix(circle, *this, mat);
 
+    osg::Vec3d ctr(center[0], center[1], center[2]);
+    osg::Vec3d pu = mat * osg::Vec3d(circle.center[0] + u1[0], circle.center[1] + u1[1], circle.center[2] + u1[2]) - ctr;
+    osg::Vec3d pv = mat * osg::Vec3d(circle.center[0] + v1[0], circle.center[1] + v1[1], circle.center[2] + v1[2]) - ctr;
+    u = Eigen::Vector3d(pu.x(), pu.y(), pu.z());
+    v = Eigen::Vector3d(pv.x(), pv.y(), pv.z());
 }
 
-void Circle3D::find_random_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d& e2) const {
+void Circle3D::find_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d& e2) const {
 
     // Find 3 othonormal basis vectors for the planar section: 2 vectors
     // in the plane of the section and 1 vector along the direction of the normal
-    RandomNumberGenerator gen;
-    gen.initialize_uniform_double_distributor(-2.0, 2.0);
-    Eigen::Vector3d random_vec(gen.generate_double(), gen.generate_double(), gen.generate_double());
-    e1 = normal.cross(random_vec);
-    e1.normalize();
-    e2 = normal.cross(e1);
-    e2.normalize();
+    orthonormal_basis(normal, e1, e2);
+
 #ifdef DEBUG
-    // Check that e1 is not a zero vector plane:
-    assert(e1 != Eigen::Vector3d::Zero());
     // Check that e1 and e2 is on the plane:
     Eigen::Vector4d plane(normal(0), normal(1), normal(2), - normal.dot(center));
     Eigen::Vector3d v1 = e1 + center;
@@ -145,6 +135,7 @@ void Circle3D::find_random_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d
     assert(plane.dot(Eigen::Vector4d(v1(0), v1(1), v1(2), 1)) < 0.00001);
     assert(plane.dot(Eigen::Vector4d(v2(0), v2(1), v2(2), 1)) < 0.00001);
 #endif // DEBUG
+
 }
 
 std::ostream& operator<<(std::ostream& out, const Circle3D& circle) {
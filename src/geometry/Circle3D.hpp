@@ -23,10 +23,14 @@ public:
     Circle3D& operator=(const Circle3D& rhs);
 
     // data generators
-    void generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, int num_points, bool random = false) const;
-    void generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, int num_points, bool random = false) const;
+    void generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, int num_points) const;
+    void generate_data(osg::ref_ptr<osg::Vec3Array>& vertices, int num_points) const;
     void generate_aligned_data(osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3Array>& normals, int num_points, const Circle3D& circle) const;
 
+    // in-plane axes scaled by the radius, the generated points are center + cos(t)*u + sin(t)*v
+    void generate_frame(Eigen::Vector3d& u, Eigen::Vector3d& v) const;
+    void generate_aligned_frame(Eigen::Vector3d& u, Eigen::Vector3d& v, const Circle3D& circle) const;
+
     // A 3D circle can be represented by a dual quadrics
     void get_matrix_representation(Eigen::Matrix4d& mat) const;
 
@@ -37,7 +41,6 @@ public:
 
 private:
     void find_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d& e2) const;
-    void find_random_orthonomal_basis(Eigen::Vector3d& e1, Eigen::Vector3d& e2) const;
 };
 
 std::ostream& operator<<(std::ostream& out, const Circle3D& circle);
@@ -0,0 +1,62 @@
+#include "CurveSimplifier.hpp"
+
+// samples closer than that to the previous one do not change the curve
+static const double min_sample_distance = 1.0;
+
+CurveSimplifier::CurveSimplifier(double tolerance, double min_chord_length, double max_chord_length) :
+    m_tolerance(tolerance),
+    m_min_chord_length(min_chord_length),
+    m_max_chord_length(max_chord_length) { }
+
+void CurveSimplifier::Reset(const osg::Vec2d& start) {
+
+    m_anchor = start;
+    m_pending.clear();
+}
+
+bool CurveSimplifier::Add(const osg::Vec2d& sample, osg::Vec2d& retained) {
+
+    // Step-1: drop the samples that do not move
+    const osg::Vec2d& last = m_pending.empty() ? m_anchor : m_pending.back();
+    if((sample - last).length() < min_sample_distance) return false;
+
+    // Step-2: the chord to the new sample must stay within the tolerance of the buffered samples
+    double chord_length = (sample - m_anchor).length();
+    bool split = chord_length > m_max_chord_length;
+    if(!split && chord_length >= m_min_chord_length) {
+        for(size_t i = 0; i < m_pending.size() && !split; ++i)
+            split = distance_to_chord(m_pending[i], sample) > m_tolerance;
+    }
+
+    // Step-3: the previous sample is the last one the chord of which was within the tolerance
+    if(split && !m_pending.empty()) {
+        retained = m_pending.back();
+        m_anchor = retained;
+        m_pending.clear();
+        m_pending.push_back(sample);
+        return true;
+    }
+    m_pending.push_back(sample);
+    return false;
+}
+
+bool CurveSimplifier::Flush(osg::Vec2d& retained) {
+
+    if(m_pending.empty()) return false;
+    retained = m_pending.back();
+    m_anchor = retained;
+    m_pending.clear();
+    return true;
+}
+
+double CurveSimplifier::distance_to_chord(const osg::Vec2d& pt, const osg::Vec2d& end) const {
+
+    // distance to the segment, the samples behind the anchor or beyond the end are not on the chord
+    osg::Vec2d chord = end - m_anchor;
+    double length2 = chord.length2();
+    if(length2 == 0.0) return (pt - m_anchor).length();
+    double t = ((pt - m_anchor) * chord) / length2;
+    if(t < 0.0) t = 0.0;
+    else if(t > 1.0) t = 1.0;
+    return (pt - (m_anchor + chord * t)).length();
+}
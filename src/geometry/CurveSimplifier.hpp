@@ -0,0 +1,38 @@
+#ifndef CURVE_SIMPLIFIER_HPP
+#define CURVE_SIMPLIFIER_HPP
+
+#include <osg/Vec2d>
+#include <vector>
+
+/*
+ * Online simplification of a sampled curve, e.g. the axis drawn with the mouse.
+ *
+ * The samples after the last retained point are buffered. Every new sample closes a chord from the
+ * retained point: if a buffered sample is farther than the tolerance from the chord, or the chord
+ * is longer than the maximum length, the previous sample is retained and starts the next chord (the
+ * streaming, greedy form of Douglas-Peucker). Chords shorter than the minimum length are not split,
+ * samples closer than a pixel to the previous one are dropped. A point is thus retained one sample
+ * late, straight parts of the curve give few points and the bends many, spaced by the minimum length.
+ */
+class CurveSimplifier {
+public:
+    CurveSimplifier(double tolerance, double min_chord_length, double max_chord_length);
+
+    void Reset(const osg::Vec2d& start);
+    // true if the sample retains a point, the previous sample
+    bool Add(const osg::Vec2d& sample, osg::Vec2d& retained);
+    // retains the last sample, e.g. a corner or the end of the curve, false if there is none
+    bool Flush(osg::Vec2d& retained);
+    const osg::Vec2d& GetLastRetained() const { return m_anchor; }
+
+private:
+    double distance_to_chord(const osg::Vec2d& pt, const osg::Vec2d& end) const;
+
+    double m_tolerance;
+    double m_min_chord_length;
+    double m_max_chord_length;
+    osg::Vec2d m_anchor;                    // last retained point
+    std::vector<osg::Vec2d> m_pending;      // samples after the anchor
+};
+
+#endif // CURVE_SIMPLIFIER_HPP
@@ -1,32 +1,14 @@
 #include "Ellipse2D.hpp"
 
-Ellipse2D::Ellipse2D(const Ellipse2D& other) : Ellipse2DLight(other) {
-
-    for(int i = 0; i < 4; ++i)
-        points[i] = other.points[i];
-
-    for(int i = 0; i < 6; ++i)
-        coeff[i] = other.coeff[i];
-
-}
-
-Ellipse2D& Ellipse2D::operator=(const Ellipse2D& rhs) {
-
-    if(this != &rhs) {
-        Ellipse2DLight::operator =(rhs);
-        for(int i = 0; i < 4; ++i)
-            points[i] = rhs.points[i];
-        for(int i = 0; i < 6; ++i)
-            coeff[i] = rhs.coeff[i];
-    }
-    return *this;
-}
+Ellipse2D::Ellipse2D(double smj, double smn, double rot, const osg::Vec2d& center_pt) :
+    center(center_pt), rot_angle(rot), smn_axis(smn), smj_axis(smj), m_coeff_valid(false) { }
 
 void Ellipse2D::translate(const osg::Vec2d& translation_vec) {
 
     center += translation_vec;
     for(int i = 0; i < 4; ++i)
         points[i] += translation_vec;
+    m_coeff_valid = false;
 }
 
 // "angle" is the angle value in radian which is used to rotate the ellipse around its center in
@@ -50,6 +32,7 @@ void Ellipse2D::rotate(double angle) {
     }
 
     translate(current_center);
+    m_coeff_valid = false;
 }
 
 void Ellipse2D::update_major_axis(const osg::Vec2d& pt0, const osg::Vec2d& pt1) {
@@ -71,6 +54,7 @@ void Ellipse2D::update_major_axis(const osg::Vec2d& pt0, const osg::Vec2d& pt1)
         rot_angle = -std::acos(vec_mj.x() / vec_mj.length());
     else
         rot_angle = std::acos(vec_mj.x() / vec_mj.length());
+    m_coeff_valid = false;
 }
 
 void Ellipse2D::update_minor_axis(const osg::Vec2d& pt2) {
@@ -79,10 +63,26 @@ void Ellipse2D::update_minor_axis(const osg::Vec2d& pt2) {
     osg::Vec2d vec = center - points[2];
     points[3] = center + vec;
     smn_axis = vec.length();
+    m_coeff_valid = false;
+}
+
+const double* Ellipse2D::get_coefficients() const {
+
+    if(!m_coeff_valid) update_coefficients();
+    return m_coeff;
+}
+
+void Ellipse2D::set_coefficients(const double* coeff) {
+
+    for(int i = 0; i < 6; ++i)
+        m_coeff[i] = coeff[i];
+    m_coeff_valid = true;
+    calculate_parameters_from_coeffients();
 }
 
-void Ellipse2D::calculate_coefficients_from_parameters() {
+void Ellipse2D::update_coefficients() const {
 
+    double* coeff = m_coeff;
     double as = smj_axis*smj_axis;
     double bs = smn_axis*smn_axis;
     coeff[0] = 0.5 * (as + bs + cos(2*rot_angle) * (bs - as));
@@ -91,11 +91,13 @@ void Ellipse2D::calculate_coefficients_from_parameters() {
     coeff[3] = -2 * center.x() * coeff[0] - center.y() * coeff[1];
     coeff[4] = -2 * center.y() * coeff[2] - center.x() * coeff[1];
     coeff[5] = center.x() * center.x() * coeff[0] + center.x() * center.y() * coeff[1] + center.y() * center.y() * coeff[2] - as * bs;
+    m_coeff_valid = true;
 }
 
-// the coefficents mmust be updated before calling this function
+// the parameters follow the coefficients, without a change of the conic
 void Ellipse2D::calculate_parameters_from_coeffients() {
 
+    const double* coeff = get_coefficients();
     double v1 = coeff[1] * coeff[1] - 4 * coeff[0] * coeff[2];
     double v2 = 2.0 * coeff[2] * coeff[3] - coeff[1] * coeff[4];
     double v3 = 2.0 * coeff[0] * coeff[4] - coeff[1] * coeff[3];
@@ -135,6 +137,7 @@ void Ellipse2D::calculate_parameters_from_coeffients() {
 
 void Ellipse2D::calculate_center_from_coefficients() {
 
+    const double* coeff = get_coefficients();
     double v1 = coeff[1] * coeff[1] - 4 * coeff[0] * coeff[2];
     double v2 = 2.0 * coeff[2] * coeff[3] - coeff[1] * coeff[4];
     double v3 = 2.0 * coeff[0] * coeff[4] - coeff[1] * coeff[3];
@@ -144,6 +147,7 @@ void Ellipse2D::calculate_center_from_coefficients() {
 
 void Ellipse2D::calculate_semiaxes_from_coefficients() {
 
+    const double* coeff = get_coefficients();
     double v1 = coeff[1] * coeff[1] - 4 * coeff[0] * coeff[2];
     double v4 = 0.5 * coeff[0] * coeff[4] * coeff[4] +
             0.5 * coeff[2] * coeff[3] * coeff[3] +
@@ -159,6 +163,7 @@ void Ellipse2D::calculate_semiaxes_from_coefficients() {
 
 void Ellipse2D::calculate_theta_from_coefficients() {
 
+    const double* coeff = get_coefficients();
     double v5 = coeff[0] - coeff[2];
     double v8 = coeff[1] / v5;
 
@@ -203,6 +208,7 @@ void Ellipse2D::get_tangent_points(const osg::Vec2d& dir, osg::Vec2d& left, osg:
     }
 
     // if the ellipse axes and the coordinate axes are parallel
+    const double* coeff = get_coefficients();
     double k1 = 4*coeff[0]*coeff[2] - coeff[1]*coeff[1];
     double k2 = 2*coeff[2]*coeff[3] - coeff[1]*coeff[4];
     double k3 = 4*coeff[2]*coeff[5] - coeff[4]*coeff[4];
@@ -282,18 +288,68 @@ void Ellipse2D::get_tangent_points(const osg::Vec2d& dir, osg::Vec2d& left, osg:
         std::swap(left, right);
 }
 
+void Ellipse2D::generate_points_on_the_ellipse(osg::Vec2Array* data, int num) const {
+
+    double step = TWO_PI/num;
+    osg::Vec2d e1(cos(rot_angle), sin(rot_angle));
+    osg::Vec2d e2(-sin(rot_angle), cos(rot_angle));
+    for(double d = 0.0; d < TWO_PI; d += step)
+        data->push_back(center + e1*smj_axis*cos(d) + e2*smn_axis*sin(d));
+}
+
+void Ellipse2D::generate_points_on_the_ellipse(osg::Vec2Array* data, int start, int num) const {
+
+    double step = TWO_PI/num;
+    osg::Vec2d e1(cos(rot_angle), sin(rot_angle));
+    osg::Vec2d e2(-sin(rot_angle), cos(rot_angle));
+    // exactly num points, the slots after them belong to other overlays
+    for(int i = 0; i < num; ++i) {
+        double d = i * step;
+        (*data)[start++] = center + e1*smj_axis*cos(d) + e2*smn_axis*sin(d);
+    }
+}
+
+void Ellipse2D::generate_points_on_the_ellipse(std::vector<osg::Vec2d>& data, int num) const {
+
+    double step = TWO_PI/num;
+    osg::Vec2d e1(cos(rot_angle), sin(rot_angle));
+    osg::Vec2d e2(-sin(rot_angle), cos(rot_angle));
+
+    if(data.size() != num) {
+        for(double d = 0.0; d < TWO_PI; d += step)
+            data.push_back(center + e1*smj_axis*cos(d) + e2*smn_axis*sin(d));
+    }
+    else {
+        int count = 0;
+        for(double d = 0.0; d < TWO_PI; d += step)
+            data[count++] = center + e1*smj_axis*cos(d) + e2*smn_axis*sin(d);
+    }
+}
+
+void Ellipse2D::get_major_axis_end_points(osg::Vec2d& p1, osg::Vec2d& p2) const {
+
+    osg::Vec2d dir = osg::Vec2d(cos(rot_angle), sin(rot_angle));
+    dir *= smj_axis;
+    p1 = osg::Vec2d(center.x(), center.y()) + dir;
+    p2 = osg::Vec2d(center.x(), center.y()) - dir;
+}
+
 std::ostream& operator<<(std::ostream& out, const Ellipse2D& ellipse) {
 
-    out << static_cast<const Ellipse2DLight&>(ellipse);
+    out << "center  : " << ellipse.center.x() << " " << ellipse.center.y() << std::endl;
+    out << "smj-axis: " << ellipse.smj_axis << std::endl;
+    out << "smn-axis: " << ellipse.smn_axis << std::endl;
+    out << "rotation: " << ellipse.rot_angle << std::endl;
     for(int i = 0; i < 4; ++i)
         out << "point-" << i << ": " << ellipse.points[i].x() << " " << ellipse.points[i].y() << std::endl;
 
-    out << " a: " << ellipse.coeff[0]
-        << " b: " << ellipse.coeff[1]
-        << " c: " << ellipse.coeff[2]
-        << " d: " << ellipse.coeff[3]
-        << " e: " << ellipse.coeff[4]
-        << " f: " << ellipse.coeff[5]
+    const double* coeff = ellipse.get_coefficients();
+    out << " a: " << coeff[0]
+        << " b: " << coeff[1]
+        << " c: " << coeff[2]
+        << " d: " << coeff[3]
+        << " e: " << coeff[4]
+        << " f: " << coeff[5]
         << std::endl;
     return out;
 }
@@ -1,34 +1,63 @@
 #ifndef ELLIPSE2D_HPP
 #define ELLIPSE2D_HPP
 
-#include "Ellipse2DLight.hpp"
+#include "Primitives.hpp"
+#include <vector>
+#include <osg/Array>
 
-struct Ellipse2D : public Ellipse2DLight {
-
-    Ellipse2D(double smj = 0.0, double smn = 0.0, double rot = 0.0, const osg::Vec2d& center_pt = osg::Vec2d(0,0)) :
-        Ellipse2DLight(smj, smn, rot, center_pt) { }
-
-    Ellipse2D(const Ellipse2D& other);
-
-    Ellipse2D& operator=(const Ellipse2D& rhs);
+/*
+ * Ellipse on the image plane, by its parameters (center, semi axes, rotation angle) and the end
+ * points of its axes.
+ *
+ * The coefficients of the conic are derived from the parameters on their first access after a
+ * change of the parameters, not on every change: the ellipses of the interaction are updated on
+ * every mouse move and drawn from their parameters, only the circle estimation reads the conic. The
+ * mutators of the parameters mark the coefficients out of date, a caller that writes the parameters
+ * directly calls calculate_coefficients_from_parameters to do the same. The opposite direction,
+ * set_coefficients, derives the parameters and the end points at once, they are public members.
+ * The first access of the coefficients writes the cache, a shared ellipse is not accessed from
+ * several threads before that. (This was Ellipse2DLight, the ellipse without the conic.)
+ */
+struct Ellipse2D {
+public:
+    Ellipse2D(double smj = 0.0, double smn = 0.0, double rot = 0.0, const osg::Vec2d& center_pt = osg::Vec2d(0,0));
 
     void update_major_axis(const osg::Vec2d& pt0, const osg::Vec2d& pt1);
     void update_minor_axis(const osg::Vec2d& pt2);
-    void calculate_coefficients_from_parameters();
+    void rotate(double angle);
+    void translate(const osg::Vec2d& translation_vec);
+
+    /* ax^2 + bxy + cy^2 + dx + ey + f = 0
+     * coefficients[0] : a; [1] : b; [2] : c; [3] : d; [4] : e; [5] : f
+    */
+    const double* get_coefficients() const;
+    // the parameters and the end points are calculated from the coefficients
+    void set_coefficients(const double* coeff);
+    // after the parameters are written directly, the coefficients are recalculated on their next access
+    void calculate_coefficients_from_parameters() { m_coeff_valid = false; }
     void calculate_parameters_from_coeffients();
     void calculate_center_from_coefficients();
     void calculate_semiaxes_from_coefficients();
     void calculate_theta_from_coefficients();
     void calculate_axes_end_points();
-    void rotate(double angle);
-    void translate(const osg::Vec2d& translation_vec);
+
+    void get_major_axis_end_points(osg::Vec2d& p1, osg::Vec2d& p2) const;
     void get_tangent_points(const osg::Vec2d& dir, osg::Vec2d& left, osg::Vec2d& right) const;
+    void generate_points_on_the_ellipse(osg::Vec2Array* data, int num) const;
+    void generate_points_on_the_ellipse(osg::Vec2Array* data, int start, int num) const;
+    void generate_points_on_the_ellipse(std::vector<osg::Vec2d>& data, int num) const;
+
+    osg::Vec2d center;
+    double rot_angle;
+    double smn_axis;
+    double smj_axis;
     osg::Vec2d points[4];
 
-    /* ax^2 + bxy + cy^2 + dx + ey + f = 0
-     * coeff[0] : a; coeff[1] : b; coeff[2] : c; coeff[3] : d; coeff[4] : e; coeff[5] : f
-    */
-    double coeff[6];
+private:
+    mutable double m_coeff[6];
+    mutable bool m_coeff_valid;
+
+    void update_coefficients() const;
 };
 
 std::ostream& operator<<(std::ostream& out, const Ellipse2D& ellipse);
@@ -0,0 +1,252 @@
+#include "MeshDecimator.hpp"
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+// weight of the planes along the boundary edges against the planes of the triangles
+static const double boundary_weight = 100.0;
+// a triangle the normal of which turns by more than about 78 degrees in a collapse is flipped
+static const double min_normal_cosine = 0.2;
+
+typedef Eigen::Matrix4d quadric;
+
+struct collapse_candidate {
+    double cost;
+    unsigned int v0, v1;
+    unsigned int version0, version1;
+    Eigen::Vector3d target;
+
+    bool operator<(const collapse_candidate& other) const { return cost > other.cost; }
+};
+
+struct position_hash {
+    size_t operator()(const osg::Vec3& p) const {
+
+        // FNV-1a over the bytes of the position
+        unsigned char bytes[sizeof(osg::Vec3)];
+        std::memcpy(bytes, p.ptr(), sizeof(bytes));
+        uint64_t h = 14695981039346656037ull;
+        for(unsigned char b : bytes) {
+            h ^= b;
+            h *= 1099511628211ull;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+static inline quadric plane_quadric(const Eigen::Vector3d& normal, const Eigen::Vector3d& point, double weight) {
+
+    Eigen::Vector4d plane(normal[0], normal[1], normal[2], -normal.dot(point));
+    return weight * plane * plane.transpose();
+}
+
+static inline double quadric_error(const quadric& q, const Eigen::Vector3d& p) {
+
+    Eigen::Vector4d h(p[0], p[1], p[2], 1.0);
+    return std::max(0.0, h.dot(q * h));
+}
+
+// the point of the least error, or the best of the end points and the midpoint if the quadric is singular
+static double optimal_target(const quadric& q, const Eigen::Vector3d& p0, const Eigen::Vector3d& p1, Eigen::Vector3d& target) {
+
+    Eigen::Matrix3d a = q.topLeftCorner<3, 3>();
+    Eigen::FullPivLU<Eigen::Matrix3d> lu(a);
+    if(lu.isInvertible() && std::abs(lu.determinant()) > 1e-12 * std::max(1.0, a.norm())) {
+        target = lu.solve(-q.topRightCorner<3, 1>());
+        // the solution far from the edge of a nearly flat neighbourhood is not trusted
+        if((target - 0.5 * (p0 + p1)).norm() <= (p1 - p0).norm())
+            return quadric_error(q, target);
+    }
+    Eigen::Vector3d candidates[3] = { p0, p1, 0.5 * (p0 + p1) };
+    double best = HUGE_VAL;
+    for(const Eigen::Vector3d& c : candidates) {
+        double error = quadric_error(q, c);
+        if(error < best) {
+            best = error;
+            target = c;
+        }
+    }
+    return best;
+}
+
+MeshDecimator::MeshDecimator(double max_error) : m_max_error(max_error) { }
+
+size_t MeshDecimator::Decimate(osg::Vec3Array* vertices, std::vector<unsigned int>& triangles) const {
+
+    if(m_max_error <= 0.0 || triangles.size() < 3) return 0;
+
+    // Step-1: the vertices equal in position are welded, the degenerate triangles are dropped
+    std::unordered_map<osg::Vec3, unsigned int, position_hash> welded;
+    std::vector<Eigen::Vector3d> points;
+    std::vector<unsigned int> remap(vertices->size());
+    for(size_t i = 0; i < vertices->size(); ++i) {
+        auto it = welded.insert(std::make_pair((*vertices)[i], static_cast<unsigned int>(points.size()))).first;
+        if(it->second == points.size()) {
+            const osg::Vec3& p = (*vertices)[i];
+            points.push_back(Eigen::Vector3d(p.x(), p.y(), p.z()));
+        }
+        remap[i] = it->second;
+    }
+    std::vector<unsigned int> faces;
+    faces.reserve(triangles.size());
+    for(size_t k = 0; k + 2 < triangles.size(); k += 3) {
+        unsigned int a = remap[triangles[k]], b = remap[triangles[k + 1]], c = remap[triangles[k + 2]];
+        if(a == b || b == c || a == c) continue;
+        faces.push_back(a);
+        faces.push_back(b);
+        faces.push_back(c);
+    }
+    size_t num_faces = faces.size() / 3;
+    size_t num_points = points.size();
+
+    // Step-2: the triangles of every vertex and the quadrics of the planes
+    std::vector<std::vector<unsigned int>> vertex_faces(num_points);
+    std::vector<quadric> quadrics(num_points, quadric::Zero());
+    std::vector<bool> face_alive(num_faces, true);
+    std::unordered_map<uint64_t, int> edge_faces;
+    for(size_t f = 0; f < num_faces; ++f) {
+        const unsigned int* v = &faces[3 * f];
+        Eigen::Vector3d n = (points[v[1]] - points[v[0]]).cross(points[v[2]] - points[v[0]]);
+        double area = n.norm();
+        if(area > 0.0) n /= area;
+        quadric q = plane_quadric(n, points[v[0]], 1.0);
+        for(int j = 0; j < 3; ++j) {
+            vertex_faces[v[j]].push_back(static_cast<unsigned int>(f));
+            quadrics[v[j]] += q;
+            unsigned int a = std::min(v[j], v[(j + 1) % 3]), b = std::max(v[j], v[(j + 1) % 3]);
+            ++edge_faces[(static_cast<uint64_t>(a) << 32) | b];
+        }
+    }
+    for(size_t f = 0; f < num_faces; ++f) {
+        const unsigned int* v = &faces[3 * f];
+        Eigen::Vector3d n = (points[v[1]] - points[v[0]]).cross(points[v[2]] - points[v[0]]);
+        for(int j = 0; j < 3; ++j) {
+            unsigned int a = v[j], b = v[(j + 1) % 3];
+            if(edge_faces[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)] != 1) continue;
+            Eigen::Vector3d side = n.cross(points[b] - points[a]);
+            if(side.norm() <= 0.0) continue;
+            quadric q = plane_quadric(side.normalized(), points[a], boundary_weight);
+            quadrics[a] += q;
+            quadrics[b] += q;
+        }
+    }
+
+    // Step-3: a candidate per edge
+    std::vector<unsigned int> version(num_points, 0);
+    std::vector<bool> vertex_alive(num_points, true);
+    std::priority_queue<collapse_candidate> heap;
+    double max_cost = m_max_error * m_max_error;
+    auto push_candidate = [&](unsigned int v0, unsigned int v1) {
+        collapse_candidate c;
+        c.v0 = v0;
+        c.v1 = v1;
+        c.version0 = version[v0];
+        c.version1 = version[v1];
+        c.cost = optimal_target(quadrics[v0] + quadrics[v1], points[v0], points[v1], c.target);
+        if(c.cost <= max_cost) heap.push(c);
+    };
+    for(const auto& edge : edge_faces)
+        push_candidate(static_cast<unsigned int>(edge.first >> 32), static_cast<unsigned int>(edge.first & 0xffffffff));
+
+    // Step-4: the collapses from the cheapest, v1 is merged into v0
+    size_t num_collapses = 0;
+    std::vector<unsigned int> neighbours0, neighbours1;
+    auto collect_neighbours = [&](unsigned int v, std::vector<unsigned int>& neighbours) {
+        neighbours.clear();
+        for(unsigned int f : vertex_faces[v]) {
+            if(!face_alive[f]) continue;
+            for(int j = 0; j < 3; ++j)
+                if(faces[3 * f + j] != v) neighbours.push_back(faces[3 * f + j]);
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    };
+    while(!heap.empty()) {
+        collapse_candidate c = heap.top();
+        heap.pop();
+        if(!vertex_alive[c.v0] || !vertex_alive[c.v1] || version[c.v0] != c.version0 || version[c.v1] != c.version1) continue;
+
+        // the link condition: an edge has at most two common neighbours of its end points
+        collect_neighbours(c.v0, neighbours0);
+        collect_neighbours(c.v1, neighbours1);
+        if(!std::binary_search(neighbours0.begin(), neighbours0.end(), c.v1)) continue;
+        std::vector<unsigned int> common;
+        std::set_intersection(neighbours0.begin(), neighbours0.end(), neighbours1.begin(), neighbours1.end(), std::back_inserter(common));
+        if(common.size() > 2) continue;
+
+        // the triangles that keep one of the end points must not flip or degenerate
+        bool valid = true;
+        for(unsigned int v : { c.v0, c.v1 }) {
+            for(unsigned int f : vertex_faces[v]) {
+                if(!face_alive[f] || !valid) continue;
+                const unsigned int* fv = &faces[3 * f];
+                if((fv[0] == c.v0 || fv[1] == c.v0 || fv[2] == c.v0) && (fv[0] == c.v1 || fv[1] == c.v1 || fv[2] == c.v1)) continue;
+                Eigen::Vector3d p[3], q[3];
+                for(int j = 0; j < 3; ++j) {
+                    p[j] = points[fv[j]];
+                    q[j] = (fv[j] == v) ? c.target : p[j];
+                }
+                Eigen::Vector3d n0 = (p[1] - p[0]).cross(p[2] - p[0]);
+                Eigen::Vector3d n1 = (q[1] - q[0]).cross(q[2] - q[0]);
+                double l0 = n0.norm(), l1 = n1.norm();
+                valid = l0 <= 0.0 || (l1 > 0.0 && n0.dot(n1) >= min_normal_cosine * l0 * l1);
+            }
+        }
+        if(!valid) continue;
+
+        // the collapse: the shared triangles are removed, the ones of v1 move to v0
+        points[c.v0] = c.target;
+        quadrics[c.v0] += quadrics[c.v1];
+        vertex_alive[c.v1] = false;
+        for(unsigned int f : vertex_faces[c.v1]) {
+            if(!face_alive[f]) continue;
+            unsigned int* fv = &faces[3 * f];
+            bool shared = fv[0] == c.v0 || fv[1] == c.v0 || fv[2] == c.v0;
+            if(shared) {
+                face_alive[f] = false;
+                continue;
+            }
+            for(int j = 0; j < 3; ++j)
+                if(fv[j] == c.v1) fv[j] = c.v0;
+            vertex_faces[c.v0].push_back(f);
+        }
+        vertex_faces[c.v1].clear();
+        ++version[c.v0];
+        ++num_collapses;
+
+        collect_neighbours(c.v0, neighbours0);
+        for(unsigned int v : neighbours0) {
+            ++version[v];
+            // the other edges of the neighbour are pushed again with its new version
+            collect_neighbours(v, neighbours1);
+            for(unsigned int w : neighbours1)
+                if(w != c.v0) push_candidate(std::min(v, w), std::max(v, w));
+            push_candidate(std::min(v, c.v0), std::max(v, c.v0));
+        }
+    }
+
+    // Step-5: the remaining triangles over the referenced vertices
+    std::vector<unsigned int> index(num_points, 0xffffffff);
+    osg::ref_ptr<osg::Vec3Array> result = new osg::Vec3Array;
+    triangles.clear();
+    for(size_t f = 0; f < num_faces; ++f) {
+        if(!face_alive[f]) continue;
+        for(int j = 0; j < 3; ++j) {
+            unsigned int v = faces[3 * f + j];
+            if(index[v] == 0xffffffff) {
+                index[v] = static_cast<unsigned int>(result->size());
+                result->push_back(osg::Vec3(points[v][0], points[v][1], points[v][2]));
+            }
+            triangles.push_back(index[v]);
+        }
+    }
+    vertices->assign(result->begin(), result->end());
+    return num_collapses;
+}
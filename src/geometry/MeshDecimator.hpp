@@ -0,0 +1,31 @@
+#ifndef MESH_DECIMATOR_HPP
+#define MESH_DECIMATOR_HPP
+
+#include <osg/Array>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Quadric error decimation of a triangle mesh (Garland and Heckbert) within a geometric error, for
+ * the export of the geometries that have no sections, e.g. the merged or loaded models.
+ *
+ * The vertices equal in position are welded first. Every vertex has the quadric of the planes of its
+ * triangles, the boundary edges add a plane orthogonal to their triangle so that the outline of an
+ * open mesh is kept. The edges are collapsed from the cheapest, into the point of the least error
+ * of the summed quadrics, while the error, the squared distance to the planes, is within the squared
+ * maximum error. A collapse that flips a triangle or would make the mesh non-manifold is rejected.
+ * The heap holds an entry per edge and collapse, the entries of the changed vertices are skipped by
+ * their version.
+ */
+class MeshDecimator {
+public:
+    explicit MeshDecimator(double max_error);
+
+    // the mesh is replaced by the decimated one, the unreferenced vertices are removed; the number of collapses
+    size_t Decimate(osg::Vec3Array* vertices, std::vector<unsigned int>& triangles) const;
+
+private:
+    double m_max_error;
+};
+
+#endif // MESH_DECIMATOR_HPP
@@ -1,4 +1,5 @@
 #include "Rectangle2D.hpp"
+#include <algorithm>
 
 Rectangle2D::Rectangle2D(int x_0, int y_0, int x_1, int y_1) {
 
@@ -28,6 +29,43 @@ bool Rectangle2D::intersect(Point2D<int>& pt0, Point2D<int>& pt1) const {
     return false;
 }
 
+void Rectangle2D::clip(size_t n, int* x0, int* y0, int* x1, int* y1, unsigned char* inside) const {
+
+    const double xmin = corner_points[0].x, ymin = corner_points[0].y;
+    const double xmax = corner_points[2].x, ymax = corner_points[2].y;
+    for(size_t i = 0; i < n; ++i) {
+
+        // Step-1: the segment is p + t d, t in [0, 1], each border gives p_k t <= q_k
+        double px = x0[i], py = y0[i];
+        double dx = x1[i] - px, dy = y1[i] - py;
+        double p[4] = { -dx, dx, -dy, dy };
+        double q[4] = { px - xmin, xmax - px, py - ymin, ymax - py };
+
+        // Step-2: entering borders (p < 0) raise t0, leaving ones (p > 0) lower t1, a segment parallel
+        // to a border (p = 0) is rejected when it is outside of it; r is not used for p = 0
+        double t0 = 0.0, t1 = 1.0;
+        bool rejected = false;
+        for(int k = 0; k < 4; ++k) {
+            double r = q[k] / (p[k] != 0.0 ? p[k] : 1.0);
+            rejected = rejected | (p[k] == 0.0 && q[k] < 0.0);
+            t0 = (p[k] < 0.0) ? std::max(t0, r) : t0;
+            t1 = (p[k] > 0.0) ? std::min(t1, r) : t1;
+        }
+        bool accepted = !rejected && t0 <= t1;
+
+        // Step-3: truncated as intersect does, clamped against the rounding at the borders
+        int cx0 = static_cast<int>(std::min(std::max(px + t0 * dx, xmin), xmax));
+        int cy0 = static_cast<int>(std::min(std::max(py + t0 * dy, ymin), ymax));
+        int cx1 = static_cast<int>(std::min(std::max(px + t1 * dx, xmin), xmax));
+        int cy1 = static_cast<int>(std::min(std::max(py + t1 * dy, ymin), ymax));
+        x0[i] = accepted ? cx0 : x0[i];
+        y0[i] = accepted ? cy0 : y0[i];
+        x1[i] = accepted ? cx1 : x1[i];
+        y1[i] = accepted ? cy1 : y1[i];
+        inside[i] = accepted ? 1 : 0;
+    }
+}
+
 // including the borders of the rectangle
 bool Rectangle2D::is_point_inside(const Point2D<int>& pt) const {
     return pt.x >= corner_points[0].x && pt.x <= corner_points[2].x && pt.y >= corner_points[0].y && pt.y <= corner_points[2].y;
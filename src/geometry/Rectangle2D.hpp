@@ -2,6 +2,7 @@
 #define RECTANGLE2D_HPP
 
 #include "Primitives.hpp"
+#include <cstddef>
 
 enum class intersection_zone : unsigned char {
     top_left,
@@ -26,6 +27,15 @@ public:
     Point2D<int> corner_points[4];
     Rectangle2D(int x_0 = 0, int y_0 = 0, int x_1 = 0, int y_1 = 0);
     bool intersect(Point2D<int>& pt0, Point2D<int>& pt1) const;
+
+    /*
+     * Liang-Barsky clipping of n segments (x0[i], y0[i]) - (x1[i], y1[i]) against the rectangle,
+     * including its borders. The end points of a segment are replaced by the clipped ones and
+     * inside[i] is 1, a segment outside of the rectangle is left as is and inside[i] is 0. Unlike
+     * intersect, neither end point has to be inside. The coordinates are structure of arrays and the
+     * loop has no branches, it is vectorized by the compiler.
+     */
+    void clip(size_t n, int* x0, int* y0, int* x1, int* y1, unsigned char* inside) const;
 private:
     intersection_zone query_zone(const Point2D<int>& pt) const;
     bool perfom_intersection(const Point2D<int>& pt_in, Point2D<int>& pt_out) const;
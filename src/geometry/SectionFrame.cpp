@@ -0,0 +1,59 @@
+#include "SectionFrame.hpp"
+#include "../utility/Utility.hpp"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+
+std::shared_ptr<const RingTable> RingTable::Get(int num_points) {
+
+    static std::mutex mutex;
+    static std::map<int, std::shared_ptr<const RingTable>> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const RingTable>& table = tables[num_points];
+    if(!table) table = std::make_shared<RingTable>(num_points);
+    return table;
+}
+
+RingTable::RingTable(int num_points) : m_cos(num_points), m_sin(num_points) {
+
+    const double step = TWO_PI / static_cast<double>(num_points);
+    for(int i = 0; i < num_points; ++i) {
+        m_cos[i] = std::cos(i * step);
+        m_sin[i] = std::sin(i * step);
+    }
+}
+
+void orthonormal_basis(const Eigen::Vector3d& n, Eigen::Vector3d& b1, Eigen::Vector3d& b2) {
+
+    // no branch on the direction of n, the sign removes the singularity at n = (0, 0, -1)
+    double sign = std::copysign(1.0, n[2]);
+    double a = -1.0 / (sign + n[2]);
+    double b = n[0] * n[1] * a;
+    b1 = Eigen::Vector3d(1.0 + sign * n[0] * n[0] * a, sign * b, -sign * n[0]);
+    b2 = Eigen::Vector3d(b, sign + n[1] * n[1] * a, -n[1]);
+}
+
+void parallel_transport(const Eigen::Vector3d& n0, const Eigen::Vector3d& n1, Eigen::Vector3d& u) {
+
+    // Step-1: rotation of n0 onto n1 about n0 x n1 (Rodrigues without the angle): R*x = c*x + k×x + k*(k.x)/(1 + c),
+    // for opposite normals the rotation by pi about u keeps u
+    Eigen::Vector3d a = n0.normalized();
+    Eigen::Vector3d b = n1.normalized();
+    double c = a.dot(b);
+    if(c > -1.0 + 1e-9) {
+        Eigen::Vector3d k = a.cross(b);
+        u = c * u + k.cross(u) + k * (k.dot(u) / (1.0 + c));
+    }
+
+    // Step-2: remove the drift of the long sweeps
+    u -= b * b.dot(u);
+    double len = u.norm();
+    if(len < 1e-9) {
+        Eigen::Vector3d v;
+        orthonormal_basis(b, u, v);
+    }
+    else {
+        u /= len;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SECTION_FRAME_HPP
+#define SECTION_FRAME_HPP
+
+#include <Eigen/Dense>
+#include <memory>
+#include <vector>
+
+/*
+ * Tessellation kernel of the planar sections.
+ *
+ * The ring point i of a section is center + r*(cos(t_i)*u + sin(t_i)*v) with t_i = 2*pi*i/n, the
+ * cosines and the sines are computed once per number of points and shared by all the rings. The in-plane
+ * axis u of a section is the axis of the previous section moved by the smallest rotation between the two
+ * normals (parallel transport) and v = normal x u, thus the point i of consecutive sections lies on the
+ * same line along the sweep and the vertical lines do not twist. The axis of the first section is the
+ * branch-free orthonormal basis of its normal (Duff et al., "Building an Orthonormal Basis, Revisited").
+ */
+class RingTable {
+public:
+    // shared by the callers with the same number of points, thread safe
+    static std::shared_ptr<const RingTable> Get(int num_points);
+
+    explicit RingTable(int num_points);
+    int GetNumPoints() const { return static_cast<int>(m_cos.size()); }
+    const double* Cos() const { return m_cos.data(); }
+    const double* Sin() const { return m_sin.data(); }
+
+private:
+    std::vector<double> m_cos;
+    std::vector<double> m_sin;
+};
+
+// b1, b2 and the unit vector n form a right-handed orthonormal basis
+void orthonormal_basis(const Eigen::Vector3d& n, Eigen::Vector3d& b1, Eigen::Vector3d& b2);
+
+// the unit axis u of a section with the normal n0 moved onto the section with the normal n1, orthogonal to n1
+void parallel_transport(const Eigen::Vector3d& n0, const Eigen::Vector3d& n1, Eigen::Vector3d& u);
+
+#endif // SECTION_FRAME_HPP
@@ -0,0 +1,82 @@
+#include "SectionSimplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+SectionSimplifier::SectionSimplifier(double max_error) : m_max_error(max_error) { }
+
+void SectionSimplifier::Simplify(const SectionStore& sections, std::vector<size_t>& retained) const {
+
+    retained.clear();
+    size_t n = sections.size();
+    if(n < 3 || m_max_error <= 0.0) {
+        for(size_t i = 0; i < n; ++i)
+            retained.push_back(i);
+        return;
+    }
+
+    // Step-1: chord length of the centers, the parameter of the interpolation
+    std::vector<double> arc(n, 0.0);
+    for(size_t i = 1; i < n; ++i)
+        arc[i] = arc[i-1] + (sections[i].center - sections[i-1].center).norm();
+
+    // Step-2: Douglas-Peucker over the sections, the spans are split at their worst section
+    std::vector<bool> keep(n, false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<size_t, size_t>> spans(1, std::make_pair(size_t(0), n - 1));
+    while(!spans.empty()) {
+        size_t first = spans.back().first;
+        size_t last = spans.back().second;
+        spans.pop_back();
+        if(last - first < 2) continue;
+        size_t worst = first;
+        double worst_error = m_max_error;
+        for(size_t i = first + 1; i < last; ++i) {
+            double error = interpolation_error(sections, arc, first, last, i);
+            if(error > worst_error) {
+                worst_error = error;
+                worst = i;
+            }
+        }
+        if(worst == first) continue;
+        keep[worst] = true;
+        spans.push_back(std::make_pair(first, worst));
+        spans.push_back(std::make_pair(worst, last));
+    }
+
+    for(size_t i = 0; i < n; ++i)
+        if(keep[i]) retained.push_back(i);
+}
+
+int SectionSimplifier::RingResolution(const SectionStore& sections, const std::vector<size_t>& retained, int max_points) const {
+
+    if(m_max_error <= 0.0) return max_points;
+    double radius = 0.0;
+    for(size_t i : retained)
+        radius = std::max(radius, sections.radius(i));
+    if(radius <= m_max_error) return std::min(3, max_points);
+
+    // r * (1 - cos(pi / n)) <= error
+    double n = std::ceil(M_PI / std::acos(1.0 - m_max_error / radius));
+    return static_cast<int>(std::max(3.0, std::min(n, static_cast<double>(max_points))));
+}
+
+double SectionSimplifier::interpolation_error(const SectionStore& sections, const std::vector<double>& arc, size_t first, size_t last, size_t i) const {
+
+    double span = arc[last] - arc[first];
+    double t = (span > 0.0) ? (arc[i] - arc[first]) / span : static_cast<double>(i - first) / (last - first);
+    SectionStore::const_reference a = sections[first];
+    SectionStore::const_reference b = sections[last];
+    SectionStore::const_reference s = sections[i];
+
+    Eigen::Vector3d center = (1.0 - t) * a.center + t * b.center;
+    double radius = (1.0 - t) * a.radius + t * b.radius;
+    Eigen::Vector3d normal = (1.0 - t) * a.normal + t * b.normal;
+    double length = normal.norm();
+    // opposite normals do not interpolate, the section is kept
+    if(length < 1e-9) return HUGE_VAL;
+    normal /= length;
+
+    double angle = std::acos(std::max(-1.0, std::min(1.0, normal.dot(s.normal))));
+    return (center - s.center).norm() + std::abs(radius - s.radius) + std::max(radius, s.radius) * angle;
+}
@@ -0,0 +1,36 @@
+#ifndef SECTION_SIMPLIFIER_HPP
+#define SECTION_SIMPLIFIER_HPP
+
+#include "SectionStore.hpp"
+#include <vector>
+
+/*
+ * Simplification of the sections of a generalized cylinder within a geometric error, e.g. for the
+ * export of the model.
+ *
+ * The sections are merged as the points of a polyline by Douglas-Peucker: a section between two
+ * retained ones is dropped if the section interpolated between them, at its chord length along the
+ * axis, is within the error. The error of two sections bounds the distance of their circles: the
+ * distance of the centers, the difference of the radii and the radius times the angle of the normals.
+ * The straight and the conical parts of a sweep keep their end sections, the bends keep one section
+ * per error.
+ *
+ * The ring resolution is the fewest points for which the polygon of the largest retained section is
+ * within the error of its circle: its sagitta r * (1 - cos(pi / n)) is at most the error.
+ */
+class SectionSimplifier {
+public:
+    explicit SectionSimplifier(double max_error);
+
+    // indices of the retained sections in increasing order, the first and the last section are always retained
+    void Simplify(const SectionStore& sections, std::vector<size_t>& retained) const;
+    // points per ring for the retained sections, at least 3 and at most max_points
+    int RingResolution(const SectionStore& sections, const std::vector<size_t>& retained, int max_points) const;
+
+private:
+    double interpolation_error(const SectionStore& sections, const std::vector<double>& arc, size_t first, size_t last, size_t i) const;
+
+    double m_max_error;
+};
+
+#endif // SECTION_SIMPLIFIER_HPP
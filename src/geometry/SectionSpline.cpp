@@ -0,0 +1,133 @@
+#include "SectionSpline.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// keeps the normal equations regular where there are no sections over the support of a control point
+static const double regularization = 1e-9;
+
+bool SectionSpline::Fit(const SectionStore& sections, size_t num_control_points) {
+
+    // Step-1: dimensions
+    size_t num_sections = sections.size();
+    if(num_sections <= static_cast<size_t>(degree)) return false;
+    size_t k = std::max(static_cast<size_t>(degree + 1), std::min(num_control_points, num_sections));
+    m_controls.resize(k, 7);
+
+    // Step-2: normal equations of the banded collocation matrix, a section touches degree + 1 controls
+    Eigen::VectorXd t;
+    chord_length_parameters(sections, t);
+    Eigen::MatrixXd AtA = Eigen::MatrixXd::Identity(k, k) * regularization;
+    Eigen::Matrix<double, Eigen::Dynamic, 7> AtY = Eigen::Matrix<double, Eigen::Dynamic, 7>::Zero(k, 7);
+    double values[degree + 1];
+    for(size_t i = 0; i < num_sections; ++i) {
+        size_t first = basis(t[i], values);
+        Eigen::Matrix<double, 1, 7> y;
+        y << sections.center(i)[0], sections.center(i)[1], sections.center(i)[2],
+             sections.normal(i)[0], sections.normal(i)[1], sections.normal(i)[2],
+             sections.radius(i);
+        for(int a = 0; a <= degree; ++a) {
+            AtY.row(first + a) += values[a] * y;
+            for(int b = 0; b <= degree; ++b)
+                AtA(first + a, first + b) += values[a] * values[b];
+        }
+    }
+
+    // Step-3: symmetric positive definite
+    m_controls = AtA.ldlt().solve(AtY);
+    return true;
+}
+
+bool SectionSpline::Fit(const SectionStore& sections, double tolerance) {
+
+    size_t num_sections = sections.size();
+    for(size_t k = degree + 1; ; k *= 2) {
+        if(!Fit(sections, k)) return false;
+        if(k >= num_sections || GetMaxDeviation(sections) <= tolerance) return true;
+    }
+}
+
+Circle3D SectionSpline::Evaluate(double t) const {
+
+    double values[degree + 1];
+    size_t first = basis(t, values);
+    Eigen::Matrix<double, 1, 7> p = Eigen::Matrix<double, 1, 7>::Zero();
+    for(int a = 0; a <= degree; ++a)
+        p += values[a] * m_controls.row(first + a);
+
+    Circle3D circle;
+    circle.center = Eigen::Vector3d(p[0], p[1], p[2]);
+    circle.normal = Eigen::Vector3d(p[3], p[4], p[5]).normalized();
+    circle.radius = p[6];
+    return circle;
+}
+
+void SectionSpline::Sample(size_t num_sections, SectionStore& sections) const {
+
+    sections.clear();
+    if(!IsValid() || num_sections == 0) return;
+    sections.reserve(num_sections);
+    if(num_sections == 1) {
+        sections.push_back(Evaluate(0.0));
+        return;
+    }
+    for(size_t i = 0; i < num_sections; ++i)
+        sections.push_back(Evaluate(static_cast<double>(i) / static_cast<double>(num_sections - 1)));
+}
+
+double SectionSpline::GetMaxDeviation(const SectionStore& sections) const {
+
+    if(!IsValid()) return 0.0;
+    Eigen::VectorXd t;
+    chord_length_parameters(sections, t);
+    double max_deviation = 0.0;
+    for(size_t i = 0; i < sections.size(); ++i) {
+        Circle3D circle = Evaluate(t[i]);
+        double d = (circle.center - Eigen::Map<const Eigen::Vector3d>(sections.center(i))).norm();
+        double r = std::max(std::abs(sections.radius(i)), 1e-12);
+        max_deviation = std::max(max_deviation, d / r);
+    }
+    return max_deviation;
+}
+
+void SectionSpline::chord_length_parameters(const SectionStore& sections, Eigen::VectorXd& t) {
+
+    // uniform if the centers coincide
+    size_t n = sections.size();
+    t.resize(n);
+    if(n == 0) return;
+    t[0] = 0.0;
+    for(size_t i = 1; i < n; ++i)
+        t[i] = t[i - 1] + (Eigen::Map<const Eigen::Vector3d>(sections.center(i)) - Eigen::Map<const Eigen::Vector3d>(sections.center(i - 1))).norm();
+    if(n == 1) return;
+    if(t[n - 1] > 0.0) t /= t[n - 1];
+    else               t = Eigen::VectorXd::LinSpaced(n, 0.0, 1.0);
+}
+
+size_t SectionSpline::basis(double t, double* values) const {
+
+    // Step-1: knot span of the clamped uniform knot vector, the interior knots are i / num_spans
+    size_t num_spans = GetNumControlPoints() - degree;
+    t = std::min(std::max(t, 0.0), 1.0);
+    size_t span = std::min(static_cast<size_t>(t * num_spans), num_spans - 1);
+    auto knot = [num_spans](long j) {
+        return std::min(std::max(static_cast<double>(j - degree) / static_cast<double>(num_spans), 0.0), 1.0);
+    };
+
+    // Step-2: Cox-de Boor (The NURBS Book, A2.2), the knot index of the span is span + degree
+    long s = static_cast<long>(span) + degree;
+    double left[degree + 1], right[degree + 1];
+    values[0] = 1.0;
+    for(int j = 1; j <= degree; ++j) {
+        left[j] = t - knot(s + 1 - j);
+        right[j] = knot(s + j) - t;
+        double saved = 0.0;
+        for(int r = 0; r < j; ++r) {
+            double temp = values[r] / (right[r + 1] + left[j - r]);
+            values[r] = saved + right[r + 1] * temp;
+            saved = left[j - r] * temp;
+        }
+        values[j] = saved;
+    }
+    return span;
+}
@@ -0,0 +1,47 @@
+#ifndef SECTION_SPLINE_HPP
+#define SECTION_SPLINE_HPP
+
+#include "SectionStore.hpp"
+#include <Eigen/Dense>
+
+/*
+ * Compact representation of the sections of a generalized cylinder: a cubic B-spline of the axis
+ * with the radius and the normal profiles along it.
+ *
+ * A smooth component (a bottle, a pipe) is drawn with one section per click or per axis point, far
+ * more sections than the shape needs. Fit approximates the centers, the normals and the radii by
+ * the least squares cubic B-spline with a clamped uniform knot vector over the chord length of the
+ * axis, one control point holds a center, a normal and a radius. The sections are sampled from the
+ * spline at the density the consumer asks for, uniformly along the axis: coarse for the levels of
+ * detail or the solver, dense for the export. The normals of the samples are normalized.
+ */
+class SectionSpline {
+public:
+    static const int degree = 3;
+
+    SectionSpline() { }
+
+    // least squares fit with the given number of control points (at least degree + 1, at most the
+    // number of sections), false if there are too few sections
+    bool Fit(const SectionStore& sections, size_t num_control_points);
+    // the fewest control points, doubled from degree + 1, for which no center deviates more than
+    // tolerance times its radius from the spline
+    bool Fit(const SectionStore& sections, double tolerance);
+
+    bool IsValid() const { return m_controls.rows() > degree; }
+    size_t GetNumControlPoints() const { return static_cast<size_t>(m_controls.rows()); }
+    // t in [0, 1] along the axis
+    Circle3D Evaluate(double t) const;
+    void Sample(size_t num_sections, SectionStore& sections) const;
+    // largest distance of a center from the spline at its parameter, relative to its radius
+    double GetMaxDeviation(const SectionStore& sections) const;
+
+private:
+    static void chord_length_parameters(const SectionStore& sections, Eigen::VectorXd& t);
+    // the degree + 1 non-zero basis functions at t, the index of the first one is returned
+    size_t basis(double t, double* values) const;
+
+    Eigen::Matrix<double, Eigen::Dynamic, 7> m_controls;   // center, normal, radius
+};
+
+#endif // SECTION_SPLINE_HPP
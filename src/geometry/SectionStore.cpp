@@ -0,0 +1,79 @@
+#include "SectionStore.hpp"
+
+SectionStore::reference& SectionStore::reference::operator=(const Circle3D& circle) {
+
+    center = circle.center;
+    normal = circle.normal;
+    radius = circle.radius;
+    return *this;
+}
+
+SectionStore::reference& SectionStore::reference::operator=(const reference& other) {
+
+    // the values are copied, as the assignment of a Circle3D
+    center = other.center;
+    normal = other.normal;
+    radius = other.radius;
+    return *this;
+}
+
+SectionStore::reference::operator Circle3D() const {
+
+    // the members are copied as they are, the constructor of Circle3D would normalize the normal
+    Circle3D circle;
+    circle.center = center;
+    circle.normal = normal;
+    circle.radius = radius;
+    return circle;
+}
+
+SectionStore::const_reference::operator Circle3D() const {
+
+    Circle3D circle;
+    circle.center = center;
+    circle.normal = normal;
+    circle.radius = radius;
+    return circle;
+}
+
+SectionStore::SectionStore(const Circle3D& circle) {
+    push_back(circle);
+}
+
+void SectionStore::reserve(size_t num_sections) {
+
+    m_centers.reserve(3 * num_sections);
+    m_normals.reserve(3 * num_sections);
+    m_radii.reserve(num_sections);
+}
+
+void SectionStore::clear() {
+
+    m_centers.clear();
+    m_normals.clear();
+    m_radii.clear();
+}
+
+void SectionStore::push_back(const Circle3D& circle) {
+
+    for(int k = 0; k < 3; ++k) {
+        m_centers.push_back(circle.center[k]);
+        m_normals.push_back(circle.normal[k]);
+    }
+    m_radii.push_back(circle.radius);
+}
+
+void SectionStore::pop_back() {
+
+    m_centers.resize(m_centers.size() - 3);
+    m_normals.resize(m_normals.size() - 3);
+    m_radii.pop_back();
+}
+
+void SectionStore::scale(size_t i, double s) {
+
+    m_centers[3*i]     *= s;
+    m_centers[3*i + 1] *= s;
+    m_centers[3*i + 2] *= s;
+    m_radii[i] *= s;
+}
@@ -0,0 +1,80 @@
+#ifndef SECTION_STORE_HPP
+#define SECTION_STORE_HPP
+
+#include "Circle3D.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+/*
+ * Planar sections of a generalized cylinder in structure of arrays layout.
+ *
+ * The centers, the normals and the radii are kept in three separate contiguous (16 byte aligned)
+ * arrays, the center and the normal of the section i are the doubles [3*i, 3*i+3) of their arrays.
+ * The tessellation and the cost functors of the solvers read the raw arrays, a pass over the
+ * centers does not touch the normals and the radii.
+ *
+ * operator[] returns a proxy with Eigen maps over the arrays, so that the sections are read and
+ * written as sections[i].center, sections[i].normal and sections[i].radius. The proxies convert
+ * to and from Circle3D. A proxy is invalidated by push_back, as an iterator of std::vector.
+ */
+class SectionStore {
+public:
+
+    struct reference {
+        Eigen::Map<Eigen::Vector3d> center;
+        Eigen::Map<Eigen::Vector3d> normal;
+        double& radius;
+
+        reference(double* c, double* n, double& r) : center(c), normal(n), radius(r) { }
+        reference(const reference& other) = default;
+        reference& operator=(const Circle3D& circle);
+        reference& operator=(const reference& other);
+        operator Circle3D() const;
+    };
+
+    struct const_reference {
+        Eigen::Map<const Eigen::Vector3d> center;
+        Eigen::Map<const Eigen::Vector3d> normal;
+        const double& radius;
+
+        const_reference(const double* c, const double* n, const double& r) : center(c), normal(n), radius(r) { }
+        operator Circle3D() const;
+    };
+
+    SectionStore() { }
+    SectionStore(const Circle3D& circle);
+
+    size_t size() const { return m_radii.size(); }
+    bool empty() const { return m_radii.empty(); }
+    void reserve(size_t num_sections);
+    void clear();
+    void push_back(const Circle3D& circle);
+    void pop_back();
+
+    reference operator[](size_t i) { return reference(&m_centers[3*i], &m_normals[3*i], m_radii[i]); }
+    const_reference operator[](size_t i) const { return const_reference(&m_centers[3*i], &m_normals[3*i], m_radii[i]); }
+    reference front() { return (*this)[0]; }
+    const_reference front() const { return (*this)[0]; }
+    reference back() { return (*this)[size() - 1]; }
+    const_reference back() const { return (*this)[size() - 1]; }
+
+    // raw arrays
+    const double* center(size_t i) const { return &m_centers[3*i]; }
+    const double* normal(size_t i) const { return &m_normals[3*i]; }
+    double radius(size_t i) const { return m_radii[i]; }
+    const double* centers() const { return m_centers.data(); }
+    const double* normals() const { return m_normals.data(); }
+    const double* radii() const { return m_radii.data(); }
+
+    // center and radius of the section i are multiplied by s
+    void scale(size_t i, double s);
+
+private:
+
+    typedef std::vector<double, Eigen::aligned_allocator<double>> array_type;
+    array_type m_centers;
+    array_type m_normals;
+    array_type m_radii;
+};
+
+#endif // SECTION_STORE_HPP
@@ -1,23 +1,19 @@
 
-#include <list>
 #include <map>
 #include <cmath>
+#include <cstdlib>
 
 #include "Algorithms.hpp"
+#include "RayCast.hpp"
+#include "TiledGradient.hpp"
 #include "../../geometry/Primitives.hpp"
-
-#include <wx/image.h>
+#include "../../utility/Logger.hpp"
 
 #include <otbImageFileWriter.h>
-#include <otbImportVectorImageFilter.h>
-#include <otbVectorImageToImageListFilter.h>
 #include <otbVectorImageToIntensityImageFilter.h>
-#include <otbImageList.h>
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkNeighborhoodIterator.h>
-#include <itkRescaleIntensityImageFilter.h>
-#include <itkGradientMagnitudeImageFilter.h>
 
 typedef itk::ImageRegionIterator<OtbImageType>      ItkImgIt_IteratorType;
 typedef itk::ImageRegionConstIterator<OtbImageType> ItkImgIt_ConstIteratorType;
@@ -26,132 +22,11 @@ typedef otb::ImageFileWriter<OtbImageType>          OtbImageWriterType;
 
 void CopyToWxImageData(OtbImageType::Pointer image, unsigned char* data) {
 
-    OtbImageType::IndexType index;
-    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
-    typedef itk::ImageRegionIterator<OtbImageType> ImageRegionIteratorType;
-    ImageRegionIteratorType it(image, image->GetLargestPossibleRegion());
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it) {
-        index = it.GetIndex();
-        long pos = (index[1]* size[0] + index[0])*3;
-        data[pos] = data[pos+1] = data[pos+2] = it.Get();
-    }
-}
-
-bool RegionGrowSegmentation(const wxImage& wxImg, wxImage& segImg, const wxPoint& pt, int threshold) {
-
-    // execute the region grow algorithm
-    OtbImageType::Pointer img = RegionGrow(wxImg, pt, threshold);
-
-    // convert the output to wxImg
-    int numPixels = 3*wxImg.GetWidth()*wxImg.GetHeight();
-    PixelTypeUC* pxdt = new PixelTypeUC[numPixels];
-    CopyToWxImageData(img, pxdt);
-    segImg = wxImage(wxImg.GetWidth(), wxImg.GetHeight(), pxdt, true);
-
-    return true;
-}
-
-OtbImageType::Pointer RegionGrow(const wxImage& wxImg, const wxPoint& pt, int threshold) {
-
-    // Step-1: Convert wxImage to OtbVectorImage
-    typedef otb::ImportVectorImageFilter<OtbVectorImageType> ImporterType;
-    ImporterType::Pointer importFilter = ImporterType::New();
-    ImporterType::SizeType size;
-    size[0] = wxImg.GetWidth();
-    size[1] = wxImg.GetHeight();
-    ImporterType::IndexType start;
-    start.Fill(0);
-    ImporterType::RegionType region;
-    region.SetIndex(start);
-    region.SetSize(size);
-    importFilter->SetRegion(region);
-    double origin[2] = {0, 0};
-    importFilter->SetOrigin(origin);
-    double spacing[2] = {1.0, 1.0};
-    importFilter->SetSpacing(spacing);
-    int numPixels(3*size[0]*size[1]);
-    PixelTypeUC* dt = wxImg.GetData();
-    PixelTypeUC* data = new PixelTypeUC[numPixels];
-    std::copy(dt, dt + numPixels, data);
-    importFilter->SetImportPointer(data, numPixels, true);
-    OtbVectorImageType::Pointer vecImg = OtbVectorImageType::New();
-    vecImg = dynamic_cast<OtbVectorImageType*>(importFilter->GetOutput());  
-
-    // Step-2: Convert OtbVectorImage to OtbImage
-    OtbImageType::Pointer intensity_image = OtbImageType::New();
-    typedef otb::VectorImageToIntensityImageFilter<OtbVectorImageType, OtbImageType> IntensityFilter;
-    IntensityFilter::Pointer filter = IntensityFilter::New();
-    filter->SetInput(vecImg);
-    filter->Update();
-    intensity_image = filter->GetOutput();
-
-    // Step-3: Create and initialize the labels image
-    OtbImageType::Pointer labels_image = OtbImageType::New();
-    labels_image->SetRegions(intensity_image->GetLargestPossibleRegion());
-    labels_image->Allocate();
-    ItkImgIt_IteratorType it(labels_image, labels_image->GetLargestPossibleRegion());
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it) {
-        it.Set(static_cast<PixelTypeUC>(PxlValues::UNKNOWN));
-    }
-
-    // Step-4: Define the neighborhood iterators for the intensity and labels images
-    ItkImgIt_NeighborhoodIteratorType::RadiusType radius;
-    radius.Fill(1);
-    ItkImgIt_NeighborhoodIteratorType it1(radius, intensity_image, intensity_image->GetLargestPossibleRegion());
-    ItkImgIt_NeighborhoodIteratorType it2(radius, labels_image, labels_image->GetLargestPossibleRegion());
-    it1.NeedToUseBoundaryConditionOff();
-    it2.NeedToUseBoundaryConditionOff();
-
-    // Step-5: Define the containers and variables required for the analysis
-    std::list<OtbImageType::IndexType> process;
-    std::set<OtbImageType::IndexType, IndexCompare> processed;
-
-    // Step-6: Push the seed pixel into the process list and m_processed set
-    OtbImageType::IndexType seed;
-    seed[0] = pt.x;
-    seed[1] = pt.y;
-    process.push_back(seed);
-    processed.insert(seed);
-
-    // Step-7: Execute the region growing process
-    OtbImageType::IndexType center_index;
-    it1.SetLocation(seed);
-    int seed_val = static_cast<int>(it1.GetCenterPixel());
-    int w = wxImg.GetWidth();
-    int h = wxImg.GetHeight();
-    while(!process.empty()) {
-        // Update center_index
-        center_index[0] = (process.front())[0];
-        center_index[1] = (process.front())[1];
-
-        // Update iterator locations by center_index
-        it1.SetLocation(center_index);
-        it2.SetLocation(center_index);
-
-        // Update the value of the pixel (indicated by the center_index) with "SELECTED".
-        it2.SetCenterPixel(static_cast<PixelTypeUC>(PxlValues::SELECTED));
-        OtbImageType::IndexType idx = it2.GetIndex();
-        if(idx[0] == 0 || idx[1] == 0 || idx[0] == w-1 || idx[1] == h-1) {
-            process.pop_front();
-            continue;
-        }
-
-        // Iterate over the neighbors of the center pixel and decide SELECTED or REFUSED
-        for(unsigned int i = 0; i < it1.Size(); ++i) {
-            if(i == 4) { continue; }
-            if(processed.insert(it1.GetIndex(i)).second) {
-                int pix_val = static_cast<int>(it1.GetPixel(i));
-                if(std::abs( pix_val - seed_val) <= threshold) {
-                    process.push_back(it1.GetIndex(i));
-                }
-                else {
-                    it2.SetPixel(i, static_cast<PixelTypeUC>(PxlValues::REFUSED));
-                }
-            }
-        }
-        process.pop_front();
-    }
-    return labels_image;
+    // the buffer of an otb image is already in the row major order of wxImage
+    const PixelTypeUC* px = image->GetBufferPointer();
+    size_t numPixels = image->GetBufferedRegion().GetNumberOfPixels();
+    for(size_t i = 0; i < numPixels; ++i, data += 3)
+        data[0] = data[1] = data[2] = px[i];
 }
 
 // image is a binary image: pixel_values are either 255 or 0
@@ -204,7 +79,7 @@ bool BinaryImageRayCast(const OtbImageType::Pointer& image, const Point2D<int>&
         }
 
         if(pixelIndex[0] < 0 || pixelIndex[1] < 0) {
-            std::cerr << "ERROR: NEGATIVE INDEX!" << std::endl;
+            Logger::Instance().Log(log_level::error, "ERROR: NEGATIVE INDEX!");
             break;
         }
     }
@@ -220,98 +95,78 @@ OtbImageType::PixelType GradientImageRayCast(const OtbImageType::Pointer& image,
                                              const Point2D<int>& end,
                                              Point2D<int>& hit) {
 
-    int delta_x = end.x - start.x;
-    int delta_y = end.y - start.y;
-    int dx_1(0), dy_1(0), dx_2(0), dy_2(0);
+    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    return GradientRayCastKernel(image->GetBufferPointer(), width, static_cast<int>(size[1]), width, start, end, hit);
+}
 
-    if(delta_x < 0)         dx_1 = -1;
-    else if (delta_x > 0)   dx_1 = 1;
-    if(delta_y < 0)         dy_1 = -1;
-    else if (delta_y > 0)   dy_1 = 1;
-    dx_2 = dx_1;
+OtbImageType::PixelType GradientImageRayCast(const OtbImageType::Pointer& image,
+                                             const Point2D<int>& start,
+                                             const Point2D<int>& end,
+                                             Point2D<int>& hit,
+                                             Point2D<double>& subpixel_hit) {
 
-    int longest = std::abs(delta_x);  // driving axis
-    int shortest = std::abs(delta_y); // passive axis
-    if(shortest > longest) {
-        std::swap(longest, shortest);
-        dy_2 = dy_1;
-        dx_2 = 0;
-    }
+    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    return GradientRayCastKernel(image->GetBufferPointer(), width, static_cast<int>(size[1]), width, start, end, hit, &subpixel_hit);
+}
 
-    int numerator = longest >> 1;
-    OtbImageType::IndexType curr;
-    curr[0] = start.x;
-    curr[1] = start.y;
+OtbImageType::PixelType OrientedGradientImageRayCast(const OtbImageType::Pointer& image, const OtbImageType::Pointer& orientation,
+                                                     const Point2D<int>& start, const Point2D<int>& end, double tolerance,
+                                                     OtbImageType::PixelType strong_value, Point2D<int>& hit, Point2D<double>& subpixel_hit) {
 
-    OtbImageType::PixelType max_val = 0;
-    OtbImageType::PixelType curr_val = 0;
+    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    return OrientedGradientRayCastKernel(image->GetBufferPointer(), orientation->GetBufferPointer(), width, static_cast<int>(size[1]), width,
+                                         start, end, tolerance, strong_value, hit, &subpixel_hit);
+}
 
-    for(int i = 0; i < longest; i++) {
+void BinaryImageRayCast(const OtbImageType::Pointer& image, const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, unsigned int num_threads) {
 
-        curr_val = image->GetPixel(curr);
-        if(curr_val > max_val) {
-            max_val = curr_val;
-            hit.x = curr[0];
-            hit.y = curr[1];
-        }
+    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    BinaryRayCastBatch(image->GetBufferPointer(), width, static_cast<int>(size[1]), width, rays, hits, num_threads);
+}
 
-        numerator += shortest;
-        if(numerator >= longest) {
-            // increment/decrement passive and driving axis by 1
-            numerator -= longest;
-            curr[0] += dx_1;
-            curr[1] += dy_1;
-        } else {
-            // increment/decrement only driving axis
-            curr[0] += dx_2;
-            curr[1] += dy_2;
-        }
-    }
+void GradientImageRayCast(const OtbImageType::Pointer& image, const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, bool subpixel, unsigned int num_threads) {
 
-    return max_val;
+    OtbImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    GradientRayCastBatch(image->GetBufferPointer(), width, static_cast<int>(size[1]), width, rays, hits, subpixel, num_threads);
 }
 
-void GradientMagnitudeImage(OtbFloatVectorImageType::Pointer img, wxImage& gradImg) {
-
-    OtbImageType::Pointer gImg = GradientMagnitudeImage(img);
-    // convert the output to wxImg
+template <typename VectorImType>
+static OtbImageType::Pointer allocate_like(typename VectorImType::Pointer image) {
 
-    int numPixels = 3*gradImg.GetWidth()*gradImg.GetHeight();
-    PixelTypeUC* pxdt = new PixelTypeUC[numPixels];
-    CopyToWxImageData(gImg, pxdt);
-    gradImg = wxImage(gradImg.GetWidth(), gradImg.GetHeight(), pxdt, true);
+    OtbImageType::Pointer img = OtbImageType::New();
+    img->SetRegions(image->GetBufferedRegion());
+    img->SetSpacing(image->GetSpacing());
+    img->SetOrigin(image->GetOrigin());
+    img->Allocate();
+    return img;
 }
 
-OtbImageType::Pointer GradientMagnitudeImage(OtbFloatVectorImageType::Pointer image) {
+template <typename VectorImType>
+static OtbImageType::Pointer gradient_magnitude(typename VectorImType::Pointer image, unsigned int num_threads, OtbImageType::Pointer* orientation) {
 
-    OtbFloatImageType::Pointer float_img;
-    if(image->GetNumberOfComponentsPerPixel() == 1) {
-        typedef otb::ImageList<OtbFloatImageType> FloatImageListType;
-        typedef otb::VectorImageToImageListFilter<OtbFloatVectorImageType, FloatImageListType> VectorImageToImageListFilterType;
-        VectorImageToImageListFilterType::Pointer image_list_filter = VectorImageToImageListFilterType::New();
-        image_list_filter->SetInput(image);
-        image_list_filter->Update();
-        float_img = image_list_filter->GetOutput()->Back();
-    }
-    else {
-        typedef otb::VectorImageToIntensityImageFilter<OtbFloatVectorImageType, OtbFloatImageType> VectorImageToIntensityImageFilterType;
-        VectorImageToIntensityImageFilterType::Pointer intensity_filter = VectorImageToIntensityImageFilterType::New();
-        intensity_filter->SetInput(image);
-        intensity_filter->Update();
-        float_img = intensity_filter->GetOutput();
-    }
+    // the outputs are the only full size images allocated, intensity and gradient are fused per band of rows
+    OtbImageType::Pointer gimg = allocate_like<VectorImType>(image);
+    if(orientation != nullptr) *orientation = allocate_like<VectorImType>(image);
 
-    typedef itk::GradientMagnitudeImageFilter<OtbFloatImageType, OtbImageType> GradientMagnitudeImageFilterType;
-    GradientMagnitudeImageFilterType::Pointer gradient_filter = GradientMagnitudeImageFilterType::New();
-    gradient_filter->SetInput(float_img);
-    gradient_filter->Update();
-
-    typedef itk::RescaleIntensityImageFilter<OtbImageType, OtbImageType> RescaleIntensityImageFilterType;
-    RescaleIntensityImageFilterType::Pointer rescaler = RescaleIntensityImageFilterType::New();
-    rescaler->SetOutputMinimum(0);
-    rescaler->SetOutputMaximum(255);
-    rescaler->SetInput(gradient_filter->GetOutput());
-    rescaler->Update();
-    return rescaler->GetOutput();
+    typename VectorImType::SizeType size = image->GetBufferedRegion().GetSize();
+    typename VectorImType::SpacingType spacing = image->GetSpacing();
+    TiledGradientMagnitude(image->GetBufferPointer(), static_cast<int>(image->GetNumberOfComponentsPerPixel()),
+                           static_cast<int>(size[0]), static_cast<int>(size[1]), spacing[0], spacing[1],
+                           gimg->GetBufferPointer(), num_threads, (orientation != nullptr) ? (*orientation)->GetBufferPointer() : nullptr);
+    return gimg;
 }
 
+OtbImageType::Pointer GradientMagnitudeImage(OtbFloatVectorImageType::Pointer image, unsigned int num_threads, OtbImageType::Pointer* orientation) {
+
+    return gradient_magnitude<OtbFloatVectorImageType>(image, num_threads, orientation);
+}
+
+OtbImageType::Pointer GradientMagnitudeImage(OtbVectorImageType::Pointer image, unsigned int num_threads, OtbImageType::Pointer* orientation) {
+
+    return gradient_magnitude<OtbVectorImageType>(image, num_threads, orientation);
+}
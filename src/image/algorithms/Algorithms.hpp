@@ -5,10 +5,11 @@
 #include <otbVectorImage.h>
 #include <otbImageFileReader.h>
 #include <otbImageFileWriter.h>
+#include <vector>
 
-class wxImage;
-class wxPoint;
 template <typename T> class Point2D;
+struct RaySegment;
+struct RayHit;
 
 // pixel type
 typedef unsigned char PixelTypeUC;
@@ -20,13 +21,22 @@ typedef otb::VectorImage<PixelTypeUC, 2>   OtbVectorImageType;
 typedef otb::Image<PixelTypeFL,2>          OtbFloatImageType;
 typedef otb::VectorImage<PixelTypeFL,2>    OtbFloatVectorImageType;
 
-OtbImageType::Pointer RegionGrow(const wxImage& wxImg, const wxPoint& pt, int threshold);
-bool RegionGrowSegmentation(const wxImage& wxImg, wxImage& segImg, const wxPoint& pt, int threshold);
 bool BinaryImageRayCast(const OtbImageType::Pointer& image, const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& first_hit);
 OtbImageType::PixelType GradientImageRayCast(const OtbImageType::Pointer& image, const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit);
+OtbImageType::PixelType GradientImageRayCast(const OtbImageType::Pointer& image, const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit, Point2D<double>& subpixel_hit);
+// the direction aware ray cast over the gradient image and its orientation image, see RayCast.hpp
+OtbImageType::PixelType OrientedGradientImageRayCast(const OtbImageType::Pointer& image, const OtbImageType::Pointer& orientation,
+                                                     const Point2D<int>& start, const Point2D<int>& end, double tolerance,
+                                                     OtbImageType::PixelType strong_value, Point2D<int>& hit, Point2D<double>& subpixel_hit);
+
+// batch ray casts, see RayCast.hpp
+void BinaryImageRayCast(const OtbImageType::Pointer& image, const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, unsigned int num_threads = 0);
+void GradientImageRayCast(const OtbImageType::Pointer& image, const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, bool subpixel = false, unsigned int num_threads = 0);
+
 void CopyToWxImageData(OtbImageType::Pointer image, unsigned char* data);
-void GradientMagnitudeImage(OtbFloatVectorImageType::Pointer img, wxImage& gradImg);
-OtbImageType::Pointer GradientMagnitudeImage(OtbFloatVectorImageType::Pointer image);
+// orientation, if not null, receives the quantized orientations of the gradient (see TiledGradient.hpp)
+OtbImageType::Pointer GradientMagnitudeImage(OtbFloatVectorImageType::Pointer image, unsigned int num_threads = 0, OtbImageType::Pointer* orientation = nullptr);
+OtbImageType::Pointer GradientMagnitudeImage(OtbVectorImageType::Pointer image, unsigned int num_threads = 0, OtbImageType::Pointer* orientation = nullptr);
 
 enum class PxlValues : PixelTypeUC {
     UNKNOWN = 127,
@@ -0,0 +1,193 @@
+#include "EdgeMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// an edge closer than this to a sample of the ray is hit by the ray
+static const float ray_hit_distance = 1.5f;
+
+EdgeMap::EdgeMap() :
+    m_width(0),
+    m_height(0),
+    m_num_edges(0) { }
+
+void EdgeMap::Build(const unsigned char* gradient, int width, int height, unsigned char min_magnitude) {
+
+    Clear();
+    if(gradient == nullptr || width <= 0 || height <= 0) return;
+
+    m_width = width;
+    m_height = height;
+    non_maximum_suppression(gradient, min_magnitude);
+    distance_transform();
+}
+
+void EdgeMap::Clear() {
+
+    m_width = 0;
+    m_height = 0;
+    m_num_edges = 0;
+    m_edges.clear();
+    m_nearest.clear();
+    m_distance.clear();
+}
+
+bool EdgeMap::IsEdge(int x, int y) const {
+
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return false;
+    return m_edges[y * m_width + x] != 0;
+}
+
+bool EdgeMap::NearestEdge(int x, int y, Point2D<int>& edge) const {
+
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return false;
+    int off = m_nearest[y * m_width + x];
+    if(off < 0) return false;
+    edge.x = off % m_width;
+    edge.y = off / m_width;
+    return true;
+}
+
+float EdgeMap::DistanceToEdge(int x, int y) const {
+
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return -1.0f;
+    return m_distance[y * m_width + x];
+}
+
+bool EdgeMap::RayCast(const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit) const {
+
+    if(m_num_edges == 0) return false;
+
+    double ux = end.x - start.x;
+    double uy = end.y - start.y;
+    double len = std::sqrt(ux*ux + uy*uy);
+    if(len == 0.0) return false;
+    ux /= len;
+    uy /= len;
+
+    // sphere tracing: no edge is closer than the distance of the current sample, the empty
+    // part of the ray is skipped at once. Steps are integers so that the visited samples are a
+    // subset of the dense walk, the margin accounts for the rounding of the samples.
+    int t = 0;
+    while(t < len) {
+        int x = static_cast<int>(std::floor(start.x + t * ux + 0.5));
+        int y = static_cast<int>(std::floor(start.y + t * uy + 0.5));
+        if(x < 0 || y < 0 || x >= m_width || y >= m_height) return false;
+
+        int pos = y * m_width + x;
+        float d = m_distance[pos];
+        if(d < ray_hit_distance) {
+            hit.x = m_nearest[pos] % m_width;
+            hit.y = m_nearest[pos] / m_width;
+            return true;
+        }
+        t += std::max(1, static_cast<int>(d - ray_hit_distance - 1.5f));
+    }
+    return false;
+}
+
+void EdgeMap::non_maximum_suppression(const unsigned char* gradient, unsigned char min_magnitude) {
+
+    m_edges.assign(static_cast<size_t>(m_width) * m_height, 0);
+
+    // neighbour offsets of the 4 directions
+    const int w = m_width;
+    const int dirs[4] = { 1, w, w + 1, w - 1 };
+
+    for(int y = 1; y < m_height - 1; ++y) {
+        for(int x = 1; x < m_width - 1; ++x) {
+
+            int pos = y * w + x;
+            int val = gradient[pos];
+            if(val < min_magnitude || val == 0) continue;
+
+            // direction across the ridge: strongest curvature
+            int best_curv = std::numeric_limits<int>::min();
+            int best_dir = 0;
+            for(int i = 0; i < 4; ++i) {
+                int curv = 2 * val - gradient[pos - dirs[i]] - gradient[pos + dirs[i]];
+                if(curv > best_curv) {
+                    best_curv = curv;
+                    best_dir = dirs[i];
+                }
+            }
+
+            // asymmetric comparison thins plateaus of two pixels to a single pixel
+            if(val >= gradient[pos - best_dir] && val > gradient[pos + best_dir]) {
+                m_edges[pos] = 1;
+                ++m_num_edges;
+            }
+        }
+    }
+}
+
+void EdgeMap::distance_transform() {
+
+    const int w = m_width;
+    const int h = m_height;
+    const size_t num_pixels = static_cast<size_t>(w) * h;
+    m_nearest.assign(num_pixels, -1);
+    m_distance.assign(num_pixels, -1.0f);
+    if(m_num_edges == 0) return;
+
+    // Step-1: nearest edge column within each row
+    std::vector<int> col(num_pixels, -1);
+    for(int y = 0; y < h; ++y) {
+        int* row = &col[static_cast<size_t>(y) * w];
+        const unsigned char* edges = &m_edges[static_cast<size_t>(y) * w];
+        int last = -1;
+        for(int x = 0; x < w; ++x) {
+            if(edges[x]) last = x;
+            row[x] = last;
+        }
+        last = -1;
+        for(int x = w - 1; x >= 0; --x) {
+            if(edges[x]) last = x;
+            if(last >= 0 && (row[x] < 0 || last - x < x - row[x]))
+                row[x] = last;
+        }
+    }
+
+    // Step-2: lower envelope of the parabolas (y - q)^2 + f(q) along each column (Felzenszwalb & Huttenlocher)
+    std::vector<double> f(h);
+    std::vector<int> v(h);
+    std::vector<double> z(h + 1);
+    for(int x = 0; x < w; ++x) {
+
+        int k = -1;
+        for(int q = 0; q < h; ++q) {
+            int c = col[static_cast<size_t>(q) * w + x];
+            if(c < 0) continue;
+            f[q] = static_cast<double>(x - c) * (x - c);
+
+            if(k < 0) {
+                k = 0;
+                v[0] = q;
+                z[0] = -std::numeric_limits<double>::infinity();
+                z[1] = std::numeric_limits<double>::infinity();
+                continue;
+            }
+            double s;
+            while(true) {
+                s = ((f[q] + static_cast<double>(q) * q) - (f[v[k]] + static_cast<double>(v[k]) * v[k])) / (2.0 * (q - v[k]));
+                if(s > z[k]) break;
+                --k;
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = std::numeric_limits<double>::infinity();
+        }
+        if(k < 0) continue; // no edge in any row
+
+        k = 0;
+        for(int q = 0; q < h; ++q) {
+            while(z[k+1] < q) ++k;
+            int r = v[k];
+            size_t pos = static_cast<size_t>(q) * w + x;
+            m_nearest[pos] = r * w + col[static_cast<size_t>(r) * w + x];
+            m_distance[pos] = static_cast<float>(std::sqrt(static_cast<double>(q - r) * (q - r) + f[r]));
+        }
+    }
+}
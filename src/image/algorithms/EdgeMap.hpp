@@ -0,0 +1,52 @@
+#ifndef EDGE_MAP_HPP
+#define EDGE_MAP_HPP
+
+#include "../../geometry/Primitives.hpp"
+#include <vector>
+
+/*
+ * Thinned edge map and nearest edge index of a gradient magnitude image, built once per image.
+ *
+ * Edges are the gradient magnitude ridges: a pixel is kept if it is not smaller than its two
+ * neighbours across the ridge (non-maximum suppression) and its magnitude is at least
+ * min_magnitude. The ridge direction is the one of the 4 neighbour directions (horizontal,
+ * vertical and the diagonals) with the strongest curvature.
+ *
+ * For every pixel the nearest edge pixel is stored (exact Euclidean distance transform), so a
+ * nearest edge query is O(1) and a ray cast skips the empty regions in steps of the distance
+ * to the nearest edge.
+ */
+class EdgeMap {
+public:
+
+    EdgeMap();
+    void Build(const unsigned char* gradient, int width, int height, unsigned char min_magnitude = 32);
+    void Clear();
+    bool IsEmpty() const { return m_num_edges == 0; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetNumEdgePixels() const { return m_num_edges; }
+    size_t GetByteSize() const { return m_edges.capacity() + m_nearest.capacity() * sizeof(int) + m_distance.capacity() * sizeof(float); }
+    bool IsEdge(int x, int y) const;
+
+    // nearest edge pixel of (x, y), false if there is no edge
+    bool NearestEdge(int x, int y, Point2D<int>& edge) const;
+    // Euclidean distance of (x, y) to the nearest edge pixel, negative if there is no edge
+    float DistanceToEdge(int x, int y) const;
+    // first edge pixel along the ray from start (included) to end (excluded)
+    bool RayCast(const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit) const;
+
+private:
+
+    int m_width;
+    int m_height;
+    int m_num_edges;
+    std::vector<unsigned char> m_edges;     // 1 for edge pixels
+    std::vector<int> m_nearest;             // buffer offset of the nearest edge pixel, -1 if none
+    std::vector<float> m_distance;          // distance to the nearest edge pixel
+
+    void non_maximum_suppression(const unsigned char* gradient, unsigned char min_magnitude);
+    void distance_transform();
+};
+
+#endif // EDGE_MAP_HPP
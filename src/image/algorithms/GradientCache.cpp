@@ -0,0 +1,224 @@
+#include "GradientCache.hpp"
+#include "ImageRepository.hpp"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Any change in the gradient computation must be reflected here to invalidate the old entries
+static const std::string gradient_filter_parameters = "intensity|GradientMagnitudeImageFilter|rescale[0,255]|v1";
+// entry of the quantized orientations next to the gradient image of the same key
+static const std::string orientation_extension = "_orientation.png";
+
+// 64-bit FNV-1a
+static void fnv1a_update(unsigned long long& hash, const char* data, size_t size) {
+
+    for(size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+}
+
+static bool is_regular_file(const std::string& path, struct stat* st = nullptr) {
+
+    struct stat buf;
+    if(st == nullptr) st = &buf;
+    return stat(path.c_str(), st) == 0 && S_ISREG(st->st_mode);
+}
+
+// creates the directory and its missing parents
+static bool make_directories(const std::string& dir) {
+
+    struct stat st;
+    if(dir.empty() || (stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode))) return true;
+    size_t pos = dir.find_last_of('/');
+    if(pos != std::string::npos && pos > 0 && !make_directories(dir.substr(0, pos))) return false;
+    return mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+static bool hash_file_content(const std::string& path, unsigned long long& hash) {
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if(!file.good()) return false;
+
+    std::vector<char> buffer(1 << 20);
+    while(file) {
+        file.read(buffer.data(), buffer.size());
+        fnv1a_update(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    return true;
+}
+
+GradientCache& GradientCache::Instance() {
+
+    static GradientCache cache;
+    return cache;
+}
+
+GradientCache::GradientCache() {
+
+    const char* env_dir = std::getenv("CVM_GRADIENT_CACHE_DIR");
+    if(env_dir != nullptr && env_dir[0] != '\0')
+        m_cache_dir = env_dir;
+    else {
+        // the user local data directory of the application, ~/.cvm
+        const char* home = std::getenv("HOME");
+        m_cache_dir = std::string((home != nullptr) ? home : ".") + "/.cvm/gradient_cache";
+    }
+}
+
+void GradientCache::SetCacheDirectory(const std::string& dir) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cache_dir = dir;
+}
+
+std::string GradientCache::GetCacheDirectory() const {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cache_dir;
+}
+
+std::string GradientCache::GetCacheFilePath(const std::string& img_path) {
+    return GetCacheFilePath(img_path, ".png");
+}
+
+std::string GradientCache::GetCacheFilePath(const std::string& img_path, const std::string& extension) {
+
+    std::string key = get_key(img_path);
+    if(key.empty()) return std::string();
+    return GetCacheDirectory() + "/" + key + extension;
+}
+
+bool GradientCache::MakeCacheDirectory() const {
+
+    std::string dir = GetCacheDirectory();
+    if(make_directories(dir)) return true;
+    std::cout << "ERROR: Cache directory cannot be created: " << dir << std::endl;
+    return false;
+}
+
+bool GradientCache::Lookup(const std::string& img_path, OtbImageType::Pointer& gimg) {
+
+    std::string cache_path = GetCacheFilePath(img_path);
+    if(cache_path.empty() || !is_regular_file(cache_path))
+        return false;
+
+    gimg = LoadImage<OtbImageType>(cache_path);
+    return gimg.IsNotNull();
+}
+
+bool GradientCache::LookupOrientation(const std::string& img_path, OtbImageType::Pointer& orientation) {
+
+    std::string cache_path = GetCacheFilePath(img_path, orientation_extension);
+    if(cache_path.empty() || !is_regular_file(cache_path))
+        return false;
+
+    orientation = LoadImage<OtbImageType>(cache_path);
+    return orientation.IsNotNull();
+}
+
+OtbImageType::Pointer GradientCache::Load(const std::string& img_path) {
+
+    // the entries cached before the orientation images are computed once more
+    OtbImageType::Pointer gimg;
+    std::string orientation_path = GetCacheFilePath(img_path, orientation_extension);
+    if(!orientation_path.empty() && is_regular_file(orientation_path) && Lookup(img_path, gimg))
+        return gimg;
+
+    OtbImageType::Pointer orientation;
+    return compute(img_path, orientation);
+}
+
+OtbImageType::Pointer GradientCache::LoadOrientation(const std::string& img_path) {
+
+    OtbImageType::Pointer orientation;
+    if(LookupOrientation(img_path, orientation)) return orientation;
+    compute(img_path, orientation);
+    return orientation;
+}
+
+OtbImageType::Pointer GradientCache::compute(const std::string& img_path, OtbImageType::Pointer& orientation) {
+
+    // the gradient of the 8-bit pixels of the shared image, the file is not decoded again
+    std::shared_ptr<const SharedImage> img = ImageRepository::Instance().Acquire(img_path);
+    if(!img) return OtbImageType::Pointer();
+    OtbImageType::Pointer gimg = GradientMagnitudeImage(img->GetOtbView(), 0, &orientation);
+
+    // the gradient image is still usable even if it cannot be cached, e.g. read-only cache directory
+    std::string cache_path = GetCacheFilePath(img_path);
+    std::string orientation_path = GetCacheFilePath(img_path, orientation_extension);
+    if(!cache_path.empty() && store(gimg, cache_path) && store(orientation, orientation_path))
+        std::cout << "INFO: Gradient image is calculated and cached: " << cache_path << std::endl;
+    return gimg;
+}
+
+Job<OtbImageType::Pointer> GradientCache::LoadAsync(const std::string& img_path, CancellationToken token) {
+
+    return ThreadPool::Instance().Submit([this, img_path](const CancellationToken&) { return Load(img_path); }, token);
+}
+
+std::string GradientCache::get_key(const std::string& img_path) {
+
+    struct stat st;
+    if(!is_regular_file(img_path, &st)) {
+        std::cout << "ERROR: Image file does not exist: " << img_path << std::endl;
+        return std::string();
+    }
+
+    cache_key key;
+    key.file_size = static_cast<unsigned long long>(st.st_size);
+    key.mod_time = static_cast<long long>(st.st_mtime);
+
+    // the content is hashed only once as long as the file is not modified
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_keys.find(img_path);
+        if(it != m_keys.end() && it->second.file_size == key.file_size && it->second.mod_time == key.mod_time)
+            return it->second.hash;
+    }
+
+    unsigned long long hash = 14695981039346656037ULL;
+    if(!hash_file_content(img_path, hash)) {
+        std::cout << "ERROR: Image file cannot be read: " << img_path << std::endl;
+        return std::string();
+    }
+    fnv1a_update(hash, gradient_filter_parameters.c_str(), gradient_filter_parameters.size());
+
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", hash);
+    key.hash = hex;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys[img_path] = key;
+    return key.hash;
+}
+
+bool GradientCache::store(OtbImageType::Pointer gimg, const std::string& cache_path) const {
+
+    size_t pos = cache_path.find_last_of('/');
+    std::string dir = (pos == std::string::npos) ? std::string() : cache_path.substr(0, pos);
+    if(!make_directories(dir)) {
+        std::cout << "ERROR: Gradient cache directory cannot be created: " << dir << std::endl;
+        return false;
+    }
+
+    // write to a temporary file first, then rename: other threads never read a partially written entry
+    std::string tmp_path = cache_path.substr(0, cache_path.size() - 4) + "_" +
+            std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".png";
+    SaveImage<OtbImageType>(gimg, tmp_path);
+    if(std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+        std::cout << "ERROR: Gradient image cannot be cached: " << cache_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
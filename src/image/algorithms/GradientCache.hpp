@@ -0,0 +1,74 @@
+#ifndef GRADIENT_CACHE_HPP
+#define GRADIENT_CACHE_HPP
+
+#include "Algorithms.hpp"
+#include "../../utility/ThreadPool.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+/*
+ * On-disk cache of the gradient magnitude images.
+ *
+ * A cache entry is keyed by the hash of the image file content and the parameters of the
+ * gradient filter, thus renamed or copied images share the same entry and an edited image
+ * never hits a stale one. The entries are stored in a cache directory instead of next to
+ * the source image. The directory is, in order of precedence:
+ *  1) the one given with SetCacheDirectory,
+ *  2) CVM_GRADIENT_CACHE_DIR environment variable,
+ *  3) ~/.cvm/gradient_cache, the user local data directory of the application.
+ */
+class GradientCache {
+public:
+
+    static GradientCache& Instance();
+
+    void SetCacheDirectory(const std::string& dir);
+    std::string GetCacheDirectory() const;
+
+    // path of the cache entry for the given image, the entry may not exist yet
+    std::string GetCacheFilePath(const std::string& img_path);
+    // path of another entry of the same image, e.g. the decoded pixels of ImageRepository
+    std::string GetCacheFilePath(const std::string& img_path, const std::string& extension);
+    bool MakeCacheDirectory() const;
+
+    // loads the gradient image, only if it is in the cache
+    bool Lookup(const std::string& img_path, OtbImageType::Pointer& gimg);
+
+    // loads the quantized gradient orientations (see TiledGradient.hpp), only if they are in the cache,
+    // they are stored next to the gradient image by Load
+    bool LookupOrientation(const std::string& img_path, OtbImageType::Pointer& orientation);
+
+    // loads the gradient image from the cache or computes and stores it with its orientations (blocking)
+    OtbImageType::Pointer Load(const std::string& img_path);
+
+    // loads the orientations from the cache or computes and stores them with the gradient image (blocking),
+    // e.g. for the gradient images cached without them
+    OtbImageType::Pointer LoadOrientation(const std::string& img_path);
+
+    // same as Load, executed by the shared thread pool
+    Job<OtbImageType::Pointer> LoadAsync(const std::string& img_path, CancellationToken token = CancellationToken());
+
+private:
+
+    struct cache_key {
+        unsigned long long file_size;
+        long long mod_time;
+        std::string hash;
+    };
+
+    GradientCache();
+    GradientCache(const GradientCache&) = delete;
+    GradientCache& operator=(const GradientCache&) = delete;
+
+    std::string get_key(const std::string& img_path);
+    bool store(OtbImageType::Pointer gimg, const std::string& cache_path) const;
+    OtbImageType::Pointer compute(const std::string& img_path, OtbImageType::Pointer& orientation);
+
+    mutable std::mutex m_mutex;
+    std::string m_cache_dir;
+    std::map<std::string, cache_key> m_keys;    // memoized content hashes
+};
+
+#endif // GRADIENT_CACHE_HPP
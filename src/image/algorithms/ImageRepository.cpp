@@ -0,0 +1,223 @@
+#include "ImageRepository.hpp"
+#include "GradientCache.hpp"
+
+#include <otbImportVectorImageFilter.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// pixel cache file: magic, width and height as 32-bit little endian integers, the RGB rows
+static const char pixel_cache_magic[8] = { 'C', 'V', 'M', 'R', 'G', 'B', '1', '\0' };
+static const size_t pixel_cache_header_size = 16;
+
+static void write_uint32(unsigned char* dst, unsigned int value) {
+
+    for(int i = 0; i < 4; ++i)
+        dst[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+}
+
+static unsigned int read_uint32(const unsigned char* src) {
+
+    unsigned int value = 0;
+    for(int i = 0; i < 4; ++i)
+        value |= static_cast<unsigned int>(src[i]) << (8 * i);
+    return value;
+}
+
+// an RGB row of a decoded image with any number of bands, gray images are replicated
+static void to_rgb_row(const PixelTypeUC* src, unsigned int num_bands, int width, unsigned char* dst) {
+
+    if(num_bands >= 3) {
+        for(int x = 0; x < width; ++x, src += num_bands, dst += 3) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+    else {
+        for(int x = 0; x < width; ++x, src += num_bands, dst += 3)
+            dst[0] = dst[1] = dst[2] = src[0];
+    }
+}
+
+SharedImage::SharedImage() : m_width(0), m_height(0), m_data(nullptr), m_map(nullptr), m_map_size(0), m_memory(memory_category::images) { }
+
+SharedImage::~SharedImage() {
+
+    if(m_map != nullptr) munmap(m_map, m_map_size);
+}
+
+OtbVectorImageType::Pointer SharedImage::GetOtbView() const {
+
+    typedef otb::ImportVectorImageFilter<OtbVectorImageType> ImporterType;
+    ImporterType::Pointer importFilter = ImporterType::New();
+    ImporterType::SizeType size;
+    size[0] = m_width;
+    size[1] = m_height;
+    ImporterType::IndexType start;
+    start.Fill(0);
+    ImporterType::RegionType region;
+    region.SetIndex(start);
+    region.SetSize(size);
+    importFilter->SetRegion(region);
+    double origin[2] = {0, 0};
+    importFilter->SetOrigin(origin);
+    double spacing[2] = {1.0, 1.0};
+    importFilter->SetSpacing(spacing);
+    // the filters only read their input, a write would hit a copy-on-write page of the mapping
+    importFilter->SetImportPointer(m_data, GetByteSize(), false);
+    importFilter->Update();
+
+    OtbVectorImageType::Pointer view = importFilter->GetOutput();
+    view->DisconnectPipeline();
+    return view;
+}
+
+ImageRepository& ImageRepository::Instance() {
+
+    static ImageRepository repository;
+    return repository;
+}
+
+std::shared_ptr<const SharedImage> ImageRepository::Acquire(const std::string& img_path) {
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_images.find(img_path);
+        if(it != m_images.end()) {
+            std::shared_ptr<const SharedImage> image = it->second.lock();
+            if(image) return image;
+        }
+    }
+
+    // decoded without the lock, if two threads decode the same file the first image is kept
+    std::shared_ptr<SharedImage> decoded = decode(img_path);
+    if(!decoded) return nullptr;
+    decoded->m_memory.Set(decoded->GetByteSize());
+    std::shared_ptr<const SharedImage> image = decoded;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::weak_ptr<const SharedImage>& entry = m_images[img_path];
+    std::shared_ptr<const SharedImage> existing = entry.lock();
+    if(existing) return existing;
+    entry = image;
+
+    // drop the expired entries
+    for(auto it = m_images.begin(); it != m_images.end(); ) {
+        if(it->second.expired()) it = m_images.erase(it);
+        else ++it;
+    }
+    return image;
+}
+
+std::shared_ptr<SharedImage> ImageRepository::map_pixel_cache(const std::string& cache_path) const {
+
+    int fd = open(cache_path.c_str(), O_RDONLY);
+    if(fd < 0) return std::shared_ptr<SharedImage>();
+    struct stat st;
+    if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < pixel_cache_header_size) {
+        close(fd);
+        return std::shared_ptr<SharedImage>();
+    }
+
+    // private and writable: the views need a non-const pointer, a write is never seen by the file
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return std::shared_ptr<SharedImage>();
+
+    std::shared_ptr<SharedImage> image = std::make_shared<SharedImage>();
+    image->m_map = map;
+    image->m_map_size = size;
+    const unsigned char* header = static_cast<const unsigned char*>(map);
+    image->m_width = static_cast<int>(read_uint32(header + 8));
+    image->m_height = static_cast<int>(read_uint32(header + 12));
+    image->m_data = static_cast<unsigned char*>(map) + pixel_cache_header_size;
+    if(std::memcmp(header, pixel_cache_magic, sizeof(pixel_cache_magic)) != 0 ||
+       size != pixel_cache_header_size + image->GetByteSize()) {
+        std::cout << "WARNING: Pixel cache entry is corrupt, the image is decoded again: " << cache_path << std::endl;
+        return std::shared_ptr<SharedImage>();
+    }
+    return image;
+}
+
+bool ImageRepository::write_pixel_cache(OtbVectorImageType::Pointer decoded, const std::string& cache_path) const {
+
+    if(!GradientCache::Instance().MakeCacheDirectory()) return false;
+
+    // write to a temporary file first, then rename: other threads never map a partially written entry
+    std::string tmp_path = cache_path + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.good()) return false;
+
+    OtbVectorImageType::SizeType size = decoded->GetBufferedRegion().GetSize();
+    int width = static_cast<int>(size[0]);
+    int height = static_cast<int>(size[1]);
+    unsigned int num_bands = decoded->GetNumberOfComponentsPerPixel();
+    unsigned char header[pixel_cache_header_size];
+    std::memcpy(header, pixel_cache_magic, sizeof(pixel_cache_magic));
+    write_uint32(header + 8, static_cast<unsigned int>(width));
+    write_uint32(header + 12, static_cast<unsigned int>(height));
+    file.write(reinterpret_cast<const char*>(header), pixel_cache_header_size);
+
+    std::vector<unsigned char> row(3 * static_cast<size_t>(width));
+    const PixelTypeUC* src = decoded->GetBufferPointer();
+    for(int y = 0; y < height && file.good(); ++y, src += static_cast<size_t>(num_bands) * width) {
+        to_rgb_row(src, num_bands, width, row.data());
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    file.close();
+    if(file.fail() || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<SharedImage> ImageRepository::decode(const std::string& img_path) const {
+
+    // Step-1: the pixels of a file that has been decoded before
+    std::string cache_path = GradientCache::Instance().GetCacheFilePath(img_path, ".rgb");
+    std::shared_ptr<SharedImage> image;
+    if(!cache_path.empty()) {
+        image = map_pixel_cache(cache_path);
+        if(image) return image;
+    }
+
+    // Step-2: decode, the decoded image is released once its pixels are in the cache file
+    OtbVectorImageType::Pointer decoded;
+    try {
+        decoded = LoadImage<OtbVectorImageType>(img_path);
+    }
+    catch(const itk::ExceptionObject& e) {
+        std::cout << "ERROR: Image file cannot be decoded: " << img_path << ": " << e.GetDescription() << std::endl;
+        return image;
+    }
+    if(!cache_path.empty() && write_pixel_cache(decoded, cache_path)) {
+        image = map_pixel_cache(cache_path);
+        if(image) return image;
+    }
+
+    // Step-3: the cache directory is not writable, the pixels are kept in memory
+    std::cout << "WARNING: Pixels are not cached, the image is kept in memory: " << img_path << std::endl;
+    OtbVectorImageType::SizeType size = decoded->GetBufferedRegion().GetSize();
+    image = std::make_shared<SharedImage>();
+    image->m_width = static_cast<int>(size[0]);
+    image->m_height = static_cast<int>(size[1]);
+    image->m_pixels.resize(image->GetByteSize());
+    image->m_data = image->m_pixels.data();
+    unsigned int num_bands = decoded->GetNumberOfComponentsPerPixel();
+    const PixelTypeUC* src = decoded->GetBufferPointer();
+    for(int y = 0; y < image->m_height; ++y, src += static_cast<size_t>(num_bands) * image->m_width)
+        to_rgb_row(src, num_bands, image->m_width, image->m_data + 3 * static_cast<size_t>(y) * image->m_width);
+    return image;
+}
@@ -0,0 +1,76 @@
+#ifndef IMAGE_REPOSITORY_HPP
+#define IMAGE_REPOSITORY_HPP
+
+#include "Algorithms.hpp"
+#include "../../utility/MemoryRegistry.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Decoded pixels of an image file: 8-bit RGB, interleaved, the top row first.
+ *
+ * The pixels are either a private mapping of the pixel cache file (see ImageRepository) or, if the
+ * file cannot be written, a buffer in memory. The views do not copy the pixels: the otb view refers
+ * to the buffer and the shared image must outlive it (as WxImageToOtbImageView), the osg and wx views
+ * of OsgUtility and WxImageAlgorithms keep a reference to the shared image.
+ */
+class SharedImage {
+public:
+    SharedImage();
+    ~SharedImage();
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    const unsigned char* GetData() const { return m_data; }
+    size_t GetByteSize() const { return 3 * static_cast<size_t>(m_width) * m_height; }
+    bool IsMapped() const { return m_map != nullptr; }
+    OtbVectorImageType::Pointer GetOtbView() const;
+
+private:
+    friend class ImageRepository;
+    int m_width;
+    int m_height;
+    unsigned char* m_data;
+    void* m_map;
+    size_t m_map_size;
+    std::vector<unsigned char> m_pixels;    // if the pixels are not mapped
+    MemoryRegistry::Allocation m_memory;    // the mapped pages count as well, they are resident once viewed
+
+    SharedImage(const SharedImage&) = delete;
+    SharedImage& operator=(const SharedImage&) = delete;
+};
+
+/*
+ * Shared images by the path of the image file, the image frames, the background textures and the
+ * gradient generation use the same pixels instead of decoding the file each.
+ *
+ * A file is decoded once: the RGB pixels are written to the pixel cache file next to the gradient
+ * cache entry of the image (same key, see GradientCache) and the file is mapped. The pages of the
+ * mapping are backed by the file, the system drops them instead of swapping them out under memory
+ * pressure, and the next session maps the file without decoding the image again. The repository
+ * only holds weak references, the pixels are released with the last view.
+ */
+class ImageRepository {
+public:
+    static ImageRepository& Instance();
+
+    // nullptr if the image cannot be decoded
+    std::shared_ptr<const SharedImage> Acquire(const std::string& img_path);
+
+private:
+    ImageRepository() { }
+    ImageRepository(const ImageRepository&) = delete;
+    ImageRepository& operator=(const ImageRepository&) = delete;
+
+    std::shared_ptr<SharedImage> map_pixel_cache(const std::string& cache_path) const;
+    bool write_pixel_cache(OtbVectorImageType::Pointer decoded, const std::string& cache_path) const;
+    std::shared_ptr<SharedImage> decode(const std::string& img_path) const;
+
+    std::mutex m_mutex;
+    std::map<std::string, std::weak_ptr<const SharedImage>> m_images;
+};
+
+#endif // IMAGE_REPOSITORY_HPP
@@ -0,0 +1,210 @@
+#include "LazyGradient.hpp"
+#include "ImageRepository.hpp"
+#include "TiledGradient.hpp"
+#include "../../utility/Logger.hpp"
+#include "../../utility/ThreadPool.hpp"
+
+#include <algorithm>
+
+// pixels around the bounding box of a ray, the samples of the sub-pixel refinement are within it
+static const int ray_window_border = 2;
+// tiles kept by the eviction, the ones around the drawing
+static const size_t min_cached_tiles = 4;
+static const size_t tile_bytes = static_cast<size_t>(LazyGradientImage::tile_size) * LazyGradientImage::tile_size;
+
+std::shared_ptr<LazyGradientImage> LazyGradientImage::Create(std::shared_ptr<const SharedImage> image, size_t max_tiles) {
+
+    if(!image || image->GetWidth() <= 0 || image->GetHeight() <= 0) return std::shared_ptr<LazyGradientImage>();
+    std::shared_ptr<LazyGradientImage> gradient(new LazyGradientImage(image, max_tiles));
+
+    // the evictor does not keep the gradient alive
+    std::weak_ptr<LazyGradientImage> weak = gradient;
+    gradient->m_evictor = MemoryRegistry::Instance().RegisterEvictor(eviction_order::gradient_tiles, [weak](size_t bytes) {
+        std::shared_ptr<LazyGradientImage> owner = weak.lock();
+        return owner ? owner->evict(bytes) : static_cast<size_t>(0);
+    });
+    return gradient;
+}
+
+LazyGradientImage::LazyGradientImage(std::shared_ptr<const SharedImage> image, size_t max_tiles) :
+    m_image(image),
+    m_width(image->GetWidth()),
+    m_height(image->GetHeight()),
+    m_tiles_x((image->GetWidth() + tile_size - 1) / tile_size),
+    m_tiles_y((image->GetHeight() + tile_size - 1) / tile_size),
+    m_max_tiles(std::max(max_tiles, min_cached_tiles)),
+    m_memory(memory_category::gradients),
+    m_evictor(-1) { }
+
+LazyGradientImage::~LazyGradientImage() {
+    if(m_evictor >= 0) MemoryRegistry::Instance().UnregisterEvictor(m_evictor);
+}
+
+unsigned char LazyGradientImage::GetPixel(int x, int y) {
+
+    if(x < 0 || y < 0 || x >= m_width || y >= m_height) return 0;
+    tile_ptr pixels = get_tile(x / tile_size, y / tile_size);
+    return (*pixels)[(y % tile_size) * tile_size + x % tile_size];
+}
+
+unsigned char LazyGradientImage::RayCast(const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit, Point2D<double>* subpixel_hit) {
+
+    if(start.x < 0 || start.y < 0 || start.x >= m_width || start.y >= m_height ||
+       end.x < 0 || end.y < 0 || end.x >= m_width || end.y >= m_height) {
+        Logger::Instance().Log(log_level::error, "ERROR: Ray cast is out of the image bounds!");
+        return 0;
+    }
+
+    // Step-1: the window of the ray, reused by the casts of the thread
+    static thread_local std::vector<unsigned char> window;
+    int x0 = std::max(std::min(start.x, end.x) - ray_window_border, 0);
+    int y0 = std::max(std::min(start.y, end.y) - ray_window_border, 0);
+    int x1 = std::min(std::max(start.x, end.x) + ray_window_border, m_width - 1);
+    int y1 = std::min(std::max(start.y, end.y) + ray_window_border, m_height - 1);
+    copy_window(x0, y0, x1, y1, window);
+
+    // Step-2: the kernel in the coordinates of the window, the window is clamped to the image as the kernel
+    Point2D<int> local_hit(hit.x - x0, hit.y - y0);
+    unsigned char value = GradientRayCastKernel(window.data(), x1 - x0 + 1, y1 - y0 + 1, x1 - x0 + 1,
+                                                Point2D<int>(start.x - x0, start.y - y0), Point2D<int>(end.x - x0, end.y - y0),
+                                                local_hit, subpixel_hit);
+    hit.x = local_hit.x + x0;
+    hit.y = local_hit.y + y0;
+    if(subpixel_hit != nullptr && value > 0) {
+        subpixel_hit->x += x0;
+        subpixel_hit->y += y0;
+    }
+    return value;
+}
+
+void LazyGradientImage::RayCast(const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, bool subpixel) {
+
+    hits.assign(rays.size(), RayHit());
+    for(size_t i = 0; i < rays.size(); ++i) {
+        RayHit& h = hits[i];
+        h.value = RayCast(rays[i].start, rays[i].end, h.hit, subpixel ? &h.subpixel_hit : nullptr);
+        h.found = (h.value > 0);
+    }
+}
+
+void LazyGradientImage::Prefetch(int x0, int y0, int x1, int y1) {
+
+    // Step-1: the missing tiles of the rectangle are marked as pending, the cached ones are touched
+    int tx0 = std::max(std::min(x0, x1), 0) / tile_size;
+    int ty0 = std::max(std::min(y0, y1), 0) / tile_size;
+    int tx1 = std::min(std::max(x0, x1), m_width - 1) / tile_size;
+    int ty1 = std::min(std::max(y0, y1), m_height - 1) / tile_size;
+    if(tx0 > tx1 || ty0 > ty1) return;
+    std::vector<int> missing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(int ty = ty0; ty <= ty1; ++ty) {
+            for(int tx = tx0; tx <= tx1; ++tx) {
+                int key = ty * m_tiles_x + tx;
+                auto it = m_tiles.find(key);
+                if(it != m_tiles.end()) m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+                else if(m_pending.insert(key).second) missing.push_back(key);
+            }
+        }
+    }
+
+    // Step-2: a task per tile, the image may be released before they run
+    std::weak_ptr<LazyGradientImage> weak = shared_from_this();
+    for(int key : missing) {
+        ThreadPool::Instance().Submit([weak, key](const CancellationToken&) {
+            std::shared_ptr<LazyGradientImage> image = weak.lock();
+            if(image) image->insert_tile(key, image->compute_tile(key % image->m_tiles_x, key / image->m_tiles_x));
+            return 0;
+        });
+    }
+}
+
+size_t LazyGradientImage::GetNumberOfCachedTiles() const {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tiles.size();
+}
+
+LazyGradientImage::tile_ptr LazyGradientImage::get_tile(int tx, int ty) {
+
+    // Step-1: a cached tile, or the one being computed by a prefetch
+    int key = ty * m_tiles_x + tx;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_computed.wait(lock, [this, key]() { return m_pending.count(key) == 0; });
+        auto it = m_tiles.find(key);
+        if(it != m_tiles.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.position);
+            return it->second.pixels;
+        }
+        m_pending.insert(key);
+    }
+
+    // Step-2: computed by the calling thread
+    tile_ptr pixels = compute_tile(tx, ty);
+    insert_tile(key, pixels);
+    return pixels;
+}
+
+LazyGradientImage::tile_ptr LazyGradientImage::compute_tile(int tx, int ty) const {
+
+    // the pixels outside the image of the border tiles stay zero
+    std::shared_ptr<tile> pixels = std::make_shared<tile>(static_cast<size_t>(tile_size) * tile_size, 0);
+    int x0 = tx * tile_size;
+    int y0 = ty * tile_size;
+    GradientMagnitudeRegion(m_image->GetData(), 3, m_width, m_height, 1.0, 1.0, x0, y0,
+                            std::min(tile_size, m_width - x0), std::min(tile_size, m_height - y0), pixels->data(), tile_size);
+    return pixels;
+}
+
+void LazyGradientImage::insert_tile(int key, const tile_ptr& pixels) {
+
+    // the least recently used tiles are dropped, the ones in use are held by their users
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.erase(key);
+        if(m_tiles.find(key) == m_tiles.end()) {
+            m_lru.push_front(key);
+            cached_tile& cached = m_tiles[key];
+            cached.pixels = pixels;
+            cached.position = m_lru.begin();
+        }
+        while(m_tiles.size() > m_max_tiles) {
+            m_tiles.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+        m_memory.Set(m_tiles.size() * tile_bytes);
+    }
+    m_computed.notify_all();
+}
+
+size_t LazyGradientImage::evict(size_t bytes) {
+
+    // the least recently used tiles beyond the ones around the drawing
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t freed = 0;
+    while(freed < bytes && m_tiles.size() > min_cached_tiles) {
+        m_tiles.erase(m_lru.back());
+        m_lru.pop_back();
+        freed += tile_bytes;
+    }
+    m_memory.Set(m_tiles.size() * tile_bytes);
+    return freed;
+}
+
+void LazyGradientImage::copy_window(int x0, int y0, int x1, int y1, std::vector<unsigned char>& window) {
+
+    int w = x1 - x0 + 1;
+    window.resize(static_cast<size_t>(w) * (y1 - y0 + 1));
+    for(int ty = y0 / tile_size; ty <= y1 / tile_size; ++ty) {
+        for(int tx = x0 / tile_size; tx <= x1 / tile_size; ++tx) {
+            tile_ptr pixels = get_tile(tx, ty);
+            int cx0 = std::max(x0, tx * tile_size), cx1 = std::min(x1, (tx + 1) * tile_size - 1);
+            int cy0 = std::max(y0, ty * tile_size), cy1 = std::min(y1, (ty + 1) * tile_size - 1);
+            for(int y = cy0; y <= cy1; ++y)
+                std::copy(pixels->begin() + (y - ty * tile_size) * tile_size + (cx0 - tx * tile_size),
+                          pixels->begin() + (y - ty * tile_size) * tile_size + (cx1 - tx * tile_size) + 1,
+                          window.begin() + static_cast<size_t>(y - y0) * w + (cx0 - x0));
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef LAZY_GRADIENT_HPP
+#define LAZY_GRADIENT_HPP
+
+#include "RayCast.hpp"
+#include "../../utility/MemoryRegistry.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class SharedImage;
+
+/*
+ * Gradient magnitude image of a shared image, computed by tiles on demand.
+ *
+ * A tile is computed by the first access, a ray cast or a pixel, or in the background by Prefetch,
+ * e.g. around the segment being drawn, and kept in a cache of the least recently used tiles: the
+ * modelling starts without waiting for the gradient of the whole image and the memory follows the
+ * area that is touched.
+ *
+ * The tiles hold the truncated magnitudes of TiledGradientMagnitude without its rescaling to
+ * [0, 255], which needs the statistics of every pixel. The ray casts only compare the values along
+ * and across the rays: the rescaling has a factor of at least one and keeps their order, so the hits
+ * are the ones of the full gradient image, the values and the sub-pixel refinement differ by the
+ * scale.
+ *
+ * A ray cast copies the tiles under the bounding box of the ray (and the border of the sub-pixel
+ * refinement) into a window and runs the kernel of RayCast.hpp on it. The object is shared
+ * (Create), the prefetching tasks only hold a weak reference. The tiles are reported to the
+ * MemoryRegistry, its budget evicts them down to the ones around the drawing.
+ */
+class LazyGradientImage : public std::enable_shared_from_this<LazyGradientImage> {
+public:
+    static const int tile_size = 256;
+    static const size_t default_max_tiles = 256;        // 16 MB of tiles
+
+    static std::shared_ptr<LazyGradientImage> Create(std::shared_ptr<const SharedImage> image, size_t max_tiles = default_max_tiles);
+    ~LazyGradientImage();
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    unsigned char GetPixel(int x, int y);
+    // as GradientRayCastKernel on the whole image
+    unsigned char RayCast(const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit, Point2D<double>* subpixel_hit = nullptr);
+    // as GradientRayCastBatch, the rays are cast by the calling thread
+    void RayCast(const std::vector<RaySegment>& rays, std::vector<RayHit>& hits, bool subpixel = false);
+    // the missing tiles of the pixels [x0, x1] x [y0, y1] are computed by the shared thread pool
+    void Prefetch(int x0, int y0, int x1, int y1);
+    size_t GetNumberOfCachedTiles() const;
+
+private:
+    typedef std::vector<unsigned char> tile;
+    typedef std::shared_ptr<const tile> tile_ptr;
+    typedef std::list<int> lru_list;
+
+    struct cached_tile {
+        tile_ptr pixels;
+        lru_list::iterator position;
+    };
+
+    LazyGradientImage(std::shared_ptr<const SharedImage> image, size_t max_tiles);
+
+    tile_ptr get_tile(int tx, int ty);
+    tile_ptr compute_tile(int tx, int ty) const;
+    void insert_tile(int key, const tile_ptr& pixels);
+    void copy_window(int x0, int y0, int x1, int y1, std::vector<unsigned char>& window);
+    size_t evict(size_t bytes);
+
+    std::shared_ptr<const SharedImage> m_image;
+    int m_width, m_height;
+    int m_tiles_x, m_tiles_y;
+    size_t m_max_tiles;
+    mutable std::mutex m_mutex;                             // guards the cache
+    std::condition_variable m_computed;                     // a pending tile is cached
+    std::unordered_map<int, cached_tile> m_tiles;
+    lru_list m_lru;                                         // most recently used first
+    std::unordered_set<int> m_pending;                      // being computed
+    MemoryRegistry::Allocation m_memory;                    // bytes of the cached tiles
+    int m_evictor;
+};
+
+#endif // LAZY_GRADIENT_HPP
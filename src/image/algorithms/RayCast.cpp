@@ -0,0 +1,387 @@
+#include "RayCast.hpp"
+#include "TiledGradient.hpp"
+#include "../../utility/Logger.hpp"
+#include "../../utility/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// number of strided samples gathered before a SIMD reduction
+static const int block_size = 256;
+
+// shorter runs of a ray driven by x are gathered into a block rather than reduced on their own
+static const int min_run_length = 16;
+
+// a batch is split into chunks of at least this many rays
+static const size_t min_rays_per_chunk = 16;
+
+// Bresenham line walk over the buffer offsets
+struct bresenham_walk {
+
+    bresenham_walk(int stride, const Point2D<int>& start, const Point2D<int>& end) {
+
+        int delta_x = end.x - start.x;
+        int delta_y = end.y - start.y;
+        int dx_1(0), dy_1(0), dx_2(0), dy_2(0);
+
+        if(delta_x < 0)         dx_1 = -1;
+        else if (delta_x > 0)   dx_1 = 1;
+        if(delta_y < 0)         dy_1 = -1;
+        else if (delta_y > 0)   dy_1 = 1;
+        dx_2 = dx_1;
+
+        longest = std::abs(delta_x);  // driving axis
+        shortest = std::abs(delta_y); // passive axis
+        if(shortest > longest) {
+            std::swap(longest, shortest);
+            dy_2 = dy_1;
+            dx_2 = 0;
+        }
+
+        step_1 = dx_1 + static_cast<long>(dy_1) * stride;
+        step_2 = dx_2 + static_cast<long>(dy_2) * stride;
+        numerator = longest >> 1;
+        offset = start.x + static_cast<long>(start.y) * stride;
+    }
+
+    inline void next() {
+
+        numerator += shortest;
+        if(numerator >= longest) {
+            numerator -= longest;
+            offset += step_1;   // increment/decrement passive and driving axis by 1
+        } else {
+            offset += step_2;   // increment/decrement only driving axis
+        }
+    }
+
+    // number of pixels from the current one up to the next passive axis step, all of them step_2 apart
+    inline int run_length() const {
+
+        if(shortest == 0) return longest;
+        return (longest - numerator + shortest - 1) / shortest;
+    }
+
+    // same as count calls to next(), count must not exceed run_length()
+    inline void advance(int count) {
+
+        numerator += count * shortest;
+        if(numerator >= longest) {
+            numerator -= longest;
+            offset += (count - 1) * step_2 + step_1;
+        } else {
+            offset += count * step_2;
+        }
+    }
+
+    int longest;        // number of pixels on the ray
+    int shortest;
+    int numerator;
+    long step_1;
+    long step_2;
+    long offset;        // offset of the current pixel
+};
+
+static inline bool is_inside(int width, int height, const Point2D<int>& start, const Point2D<int>& end) {
+
+    if(start.x < 0 || start.y < 0 || start.x >= width || start.y >= height ||
+       end.x < 0 || end.y < 0 || end.x >= width || end.y >= height) {
+        Logger::Instance().Log(log_level::error, "ERROR: Ray cast is out of the image bounds!");
+        return false;
+    }
+    return true;
+}
+
+// calls kernel(i) for i in [0, n), in contiguous chunks on the thread pool, at most num_threads of them
+template <typename Kernel>
+static void run_batch(size_t n, unsigned int num_threads, Kernel kernel) {
+
+    size_t grain_size = min_rays_per_chunk;
+    if(num_threads > 0) grain_size = std::max(grain_size, (n + num_threads - 1) / num_threads);
+    ThreadPool::Instance().ParallelFor(0, n, grain_size, [&kernel](size_t first, size_t last) {
+        for(size_t i = first; i < last; ++i)
+            kernel(i);
+    });
+}
+
+// maximum value of block[0, n)
+static unsigned char block_max(const unsigned char* block, int n) {
+
+    unsigned char max_val = 0;
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i vmax = _mm_setzero_si128();
+    for(; i + 16 <= n; i += 16)
+        vmax = _mm_max_epu8(vmax, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)));
+
+    // horizontal reduction of the 16 lanes
+    vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 8));
+    vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 4));
+    vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 2));
+    vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 1));
+    max_val = static_cast<unsigned char>(_mm_cvtsi128_si32(vmax) & 0xFF);
+#endif
+
+    for(; i < n; ++i)
+        if(block[i] > max_val) max_val = block[i];
+    return max_val;
+}
+
+// maximum value of block[0, n) and the index of its first occurrence
+static unsigned char block_max(const unsigned char* block, int n, int& first_index) {
+
+    unsigned char max_val = block_max(block, n);
+
+    // locate the first occurrence of the maximum
+    first_index = 0;
+#if defined(__SSE2__)
+    __m128i vcmp = _mm_set1_epi8(static_cast<char>(max_val));
+    for(; first_index + 16 <= n; first_index += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(vcmp, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + first_index))));
+        if(mask != 0) {
+            int bit = 0;
+            while(!(mask & (1 << bit))) ++bit;
+            first_index += bit;
+            return max_val;
+        }
+    }
+#endif
+    while(first_index < n && block[first_index] != max_val)
+        ++first_index;
+    return max_val;
+}
+
+// maximum value of block[0, n) and the index of its last occurrence
+static unsigned char block_max_last(const unsigned char* block, int n, int& last_index) {
+
+    unsigned char max_val = block_max(block, n);
+
+    // locate the last occurrence of the maximum
+    last_index = n;
+#if defined(__SSE2__)
+    __m128i vcmp = _mm_set1_epi8(static_cast<char>(max_val));
+    for(; last_index >= 16; last_index -= 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(vcmp, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + last_index - 16))));
+        if(mask != 0) {
+            int bit = 15;
+            while(!(mask & (1 << bit))) --bit;
+            last_index += bit - 16;
+            return max_val;
+        }
+    }
+#endif
+    while(last_index > 0 && block[last_index - 1] != max_val)
+        --last_index;
+    last_index = std::max(last_index - 1, 0);
+    return max_val;
+}
+
+double BilinearSample(const unsigned char* buffer, int width, int height, int stride, double x, double y) {
+
+    x = std::min(std::max(x, 0.0), static_cast<double>(width - 1));
+    y = std::min(std::max(y, 0.0), static_cast<double>(height - 1));
+    int x0 = static_cast<int>(x);
+    int y0 = static_cast<int>(y);
+    int x1 = std::min(x0 + 1, width - 1);
+    int y1 = std::min(y0 + 1, height - 1);
+    double fx = x - x0;
+    double fy = y - y0;
+
+    const unsigned char* r0 = buffer + static_cast<long>(y0) * stride;
+    const unsigned char* r1 = buffer + static_cast<long>(y1) * stride;
+    double top = r0[x0] + fx * (r0[x1] - r0[x0]);
+    double bottom = r1[x0] + fx * (r1[x1] - r1[x0]);
+    return top + fy * (bottom - top);
+}
+
+// parabola fit through the samples at s-1, s, s+1 along the ray
+static void refine_subpixel_hit(const unsigned char* buffer, int width, int height, int stride,
+                                const Point2D<int>& start, const Point2D<int>& end,
+                                const Point2D<int>& hit, Point2D<double>& subpixel_hit) {
+
+    subpixel_hit.x = hit.x;
+    subpixel_hit.y = hit.y;
+
+    double ux = end.x - start.x;
+    double uy = end.y - start.y;
+    double len = std::sqrt(ux*ux + uy*uy);
+    if(len == 0.0) return;
+    ux /= len;
+    uy /= len;
+
+    // parameter of the hit pixel on the ray
+    double s = (hit.x - start.x) * ux + (hit.y - start.y) * uy;
+    double a = BilinearSample(buffer, width, height, stride, start.x + (s - 1) * ux, start.y + (s - 1) * uy);
+    double b = BilinearSample(buffer, width, height, stride, start.x + s * ux, start.y + s * uy);
+    double c = BilinearSample(buffer, width, height, stride, start.x + (s + 1) * ux, start.y + (s + 1) * uy);
+
+    double denom = a - 2*b + c;
+    if(denom >= 0) return; // not a peak
+    double delta = std::min(0.5, std::max(-0.5, 0.5 * (a - c) / denom));
+    subpixel_hit.x = start.x + (s + delta) * ux;
+    subpixel_hit.y = start.y + (s + delta) * uy;
+}
+
+unsigned char GradientRayCastKernel(const unsigned char* buffer, int width, int height, int stride,
+                                    const Point2D<int>& start, const Point2D<int>& end,
+                                    Point2D<int>& hit, Point2D<double>* subpixel_hit) {
+
+    if(!is_inside(width, height, start, end)) return 0;
+
+    bresenham_walk walk(stride, start, end);
+    unsigned char values[block_size];
+    long offsets[block_size];
+    int num_values = 0;
+    unsigned char max_val = 0;
+    long max_offset = -1;
+
+    // only a strictly greater value updates the hit: the first maximum is kept
+    auto update = [&](unsigned char value, long offset) {
+        if(value > max_val) {
+            max_val = value;
+            max_offset = offset;
+        }
+    };
+    auto flush = [&]() {
+        if(num_values == 0) return;
+        int idx;
+        unsigned char bmax = block_max(values, num_values, idx);
+        update(bmax, offsets[idx]);
+        num_values = 0;
+    };
+
+    // a ray driven by x whose runs of pixels between two steps of the passive axis are long enough is
+    // reduced run by run straight from the rows of the buffer, the others are gathered with strided loads
+    bool by_runs = (walk.step_2 == 1 || walk.step_2 == -1) &&
+                   walk.longest >= static_cast<long>(min_run_length) * walk.shortest;
+    for(int remaining = walk.longest; remaining > 0; ) {
+
+        int count = remaining;
+        if(by_runs) {
+            int run = std::min(walk.run_length(), remaining);
+            if(run >= min_run_length) {
+                // the samples before the run come first along the ray
+                flush();
+                int idx;
+                if(walk.step_2 == 1) {
+                    unsigned char rmax = block_max(buffer + walk.offset, run, idx);
+                    update(rmax, walk.offset + idx);
+                }
+                else {
+                    // the run goes backwards in memory, its first sample along the ray is the last one
+                    long first = walk.offset - (run - 1);
+                    unsigned char rmax = block_max_last(buffer + first, run, idx);
+                    update(rmax, first + idx);
+                }
+                walk.advance(run);
+                remaining -= run;
+                continue;
+            }
+            count = run;
+        }
+
+        // strided gather of the next samples into the block
+        count = std::min(count, block_size - num_values);
+        for(int k = 0; k < count; ++k) {
+            values[num_values + k] = buffer[walk.offset];
+            offsets[num_values + k] = walk.offset;
+            walk.next();
+        }
+        num_values += count;
+        remaining -= count;
+        if(num_values == block_size) flush();
+    }
+    flush();
+
+    if(max_offset >= 0) {
+        hit.x = static_cast<int>(max_offset % stride);
+        hit.y = static_cast<int>(max_offset / stride);
+        if(subpixel_hit != nullptr)
+            refine_subpixel_hit(buffer, width, height, stride, start, end, hit, *subpixel_hit);
+    }
+    return max_val;
+}
+
+unsigned char OrientedGradientRayCastKernel(const unsigned char* magnitude, const unsigned char* orientation,
+                                            int width, int height, int stride,
+                                            const Point2D<int>& start, const Point2D<int>& end,
+                                            double tolerance, unsigned char strong_value,
+                                            Point2D<int>& hit, Point2D<double>* subpixel_hit) {
+
+    if(!is_inside(width, height, start, end)) return 0;
+
+    // the orientation of the ray in the bins of the gradient orientations, the bins wrap around at pi
+    int ray_bin = QuantizeOrientation(end.x - start.x, end.y - start.y);
+    int tolerance_bins = static_cast<int>(tolerance * orientation_bins_per_radian);
+
+    bresenham_walk walk(stride, start, end);
+    unsigned char max_val = 0;
+    long max_offset = -1;
+    for(int i = 0; i < walk.longest; ++i, walk.next()) {
+        unsigned char value = magnitude[walk.offset];
+        int diff = std::abs(static_cast<int>(orientation[walk.offset]) - ray_bin);
+        bool climbs = value > max_val && std::min(diff, 256 - diff) <= tolerance_bins;
+        if(climbs) {
+            max_val = value;
+            max_offset = walk.offset;
+        }
+        else if(max_val >= strong_value) {
+            break;
+        }
+    }
+
+    if(max_offset >= 0) {
+        hit.x = static_cast<int>(max_offset % stride);
+        hit.y = static_cast<int>(max_offset / stride);
+        if(subpixel_hit != nullptr)
+            refine_subpixel_hit(magnitude, width, height, stride, start, end, hit, *subpixel_hit);
+    }
+    return max_val;
+}
+
+bool BinaryRayCastKernel(const unsigned char* buffer, int width, int height, int stride,
+                         const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& first_hit) {
+
+    if(!is_inside(width, height, start, end)) return false;
+
+    bresenham_walk walk(stride, start, end);
+    for(int i = 0; i < walk.longest; ++i) {
+        if(buffer[walk.offset] == 0) {
+            first_hit.x = static_cast<int>(walk.offset % stride);
+            first_hit.y = static_cast<int>(walk.offset / stride);
+            return true;
+        }
+        walk.next();
+    }
+    return false;
+}
+
+void GradientRayCastBatch(const unsigned char* buffer, int width, int height, int stride,
+                          const std::vector<RaySegment>& rays, std::vector<RayHit>& hits,
+                          bool subpixel, unsigned int num_threads) {
+
+    hits.assign(rays.size(), RayHit());
+    run_batch(rays.size(), num_threads, [&](size_t i) {
+        RayHit& h = hits[i];
+        h.value = GradientRayCastKernel(buffer, width, height, stride, rays[i].start, rays[i].end,
+                                        h.hit, subpixel ? &h.subpixel_hit : nullptr);
+        h.found = (h.value > 0);
+    });
+}
+
+void BinaryRayCastBatch(const unsigned char* buffer, int width, int height, int stride,
+                        const std::vector<RaySegment>& rays, std::vector<RayHit>& hits,
+                        unsigned int num_threads) {
+
+    hits.assign(rays.size(), RayHit());
+    run_batch(rays.size(), num_threads, [&](size_t i) {
+        RayHit& h = hits[i];
+        h.found = BinaryRayCastKernel(buffer, width, height, stride, rays[i].start, rays[i].end, h.hit);
+    });
+}
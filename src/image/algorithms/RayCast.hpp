@@ -0,0 +1,80 @@
+#ifndef RAY_CAST_HPP
+#define RAY_CAST_HPP
+
+#include "../../geometry/Primitives.hpp"
+#include <vector>
+
+/*
+ * Gradient ray cast kernel working directly on an 8-bit single channel buffer.
+ *
+ * buffer : first pixel of the image
+ * stride : number of bytes between two consecutive rows
+ * start  : first pixel of the ray (included)
+ * end    : last pixel of the ray (excluded)
+ * hit    : first pixel with the maximum value along the ray, untouched if all the values are zero
+ * subpixel_hit : if not null, sub-pixel location of the maximum along the ray. It is refined by
+ *                a parabola fit on bilinearly interpolated samples around the integer maximum.
+ *
+ * The result is identical to GradientImageRayCast. The pixels are visited in the Bresenham order. The
+ * runs of a ray driven by x between two steps of the passive axis are contiguous in the row and are
+ * reduced in place when they are long enough, the other pixels are gathered with strided loads into
+ * blocks. The maximum of a run or a block is found with SIMD instructions (SSE2).
+ *
+ * returns the maximum pixel value along the ray
+ */
+unsigned char GradientRayCastKernel(const unsigned char* buffer, int width, int height, int stride,
+                                    const Point2D<int>& start, const Point2D<int>& end,
+                                    Point2D<int>& hit, Point2D<double>* subpixel_hit = nullptr);
+
+/*
+ * Direction aware gradient ray cast over a magnitude and a quantized orientation buffer of the same
+ * layout (see TiledGradientMagnitude). Only the pixels whose gradient orientation is within the
+ * tolerance (radians) of the ray direction are considered, the edges along the ray do not stop it.
+ * The cast stops at the peak of the first considered pixel with at least the strong value: the
+ * following pixels are read only while they climb. A ray without a strong edge is scanned to its
+ * end as GradientRayCastKernel, over the considered pixels.
+ *
+ * returns the value of the hit, 0 if no considered pixel is hit
+ */
+unsigned char OrientedGradientRayCastKernel(const unsigned char* magnitude, const unsigned char* orientation,
+                                            int width, int height, int stride,
+                                            const Point2D<int>& start, const Point2D<int>& end,
+                                            double tolerance, unsigned char strong_value,
+                                            Point2D<int>& hit, Point2D<double>* subpixel_hit = nullptr);
+// bilinear interpolation with border clamping
+double BilinearSample(const unsigned char* buffer, int width, int height, int stride, double x, double y);
+
+// first zero pixel along the ray from start (included) to end (excluded), false if there is none
+bool BinaryRayCastKernel(const unsigned char* buffer, int width, int height, int stride,
+                         const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& first_hit);
+
+// ray of a batch ray cast: start is included, end is excluded
+struct RaySegment {
+    RaySegment() { }
+    RaySegment(const Point2D<int>& s, const Point2D<int>& e) : start(s), end(e) { }
+    Point2D<int> start;
+    Point2D<int> end;
+};
+
+struct RayHit {
+    RayHit() : value(0), found(false) { }
+    unsigned char value;            // maximum value along the ray (gradient ray cast)
+    bool found;                     // false if no pixel is hit
+    Point2D<int> hit;
+    Point2D<double> subpixel_hit;   // only set by the gradient ray cast with subpixel = true
+};
+
+/*
+ * Batch versions of the kernels above: hits[i] is the result of rays[i].
+ * The rays are split into contiguous chunks processed in parallel by the ThreadPool, small batches
+ * run on the calling thread. num_threads limits the number of chunks, 0 uses all the workers.
+ */
+void GradientRayCastBatch(const unsigned char* buffer, int width, int height, int stride,
+                          const std::vector<RaySegment>& rays, std::vector<RayHit>& hits,
+                          bool subpixel = false, unsigned int num_threads = 0);
+
+void BinaryRayCastBatch(const unsigned char* buffer, int width, int height, int stride,
+                        const std::vector<RaySegment>& rays, std::vector<RayHit>& hits,
+                        unsigned int num_threads = 0);
+
+#endif // RAY_CAST_HPP
@@ -0,0 +1,246 @@
+#include "RegionGrower.hpp"
+#include "Algorithms.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+void RegionGrower::bounding_box::Extend(int xmin, int ymin, int xmax, int ymax) {
+
+    if(IsEmpty()) {
+        x0 = xmin; y0 = ymin; x1 = xmax; y1 = ymax;
+        return;
+    }
+    x0 = std::min(x0, xmin);
+    y0 = std::min(y0, ymin);
+    x1 = std::max(x1, xmax);
+    y1 = std::max(y1, ymax);
+}
+
+RegionGrower::RegionGrower() : m_width(0), m_height(0), m_seed_val(0), m_threshold(0), m_num_selected(0), m_rgb(nullptr) { }
+
+bool RegionGrower::Grow(const unsigned char* rgb, int width, int height, int seed_x, int seed_y, int threshold) {
+
+    if(rgb == nullptr || width <= 0 || height <= 0) {
+        std::cout << "ERROR: Region growing requires a valid image!" << std::endl;
+        return false;
+    }
+
+    // Step-1: Initialize the labels buffer, it is reused from the previous call whenever possible
+    m_rgb = rgb;
+    m_width = width;
+    m_height = height;
+    if(!check_seed(seed_x, seed_y)) return false;
+    m_threshold = threshold;
+    m_num_selected = 0;
+    m_labels.assign(static_cast<size_t>(width) * height, static_cast<unsigned char>(PxlValues::UNKNOWN));
+    m_refused.clear();
+    m_bbox = bounding_box();
+    m_changed = bounding_box();
+    grow_from(seed_x, seed_y);
+    return true;
+}
+
+bool RegionGrower::Update(int seed_x, int seed_y, int threshold) {
+
+    if(m_rgb == nullptr) {
+        std::cout << "ERROR: Region growing is updated before it is grown!" << std::endl;
+        return false;
+    }
+    if(!check_seed(seed_x, seed_y)) return false;
+    m_changed = bounding_box();
+
+    // Step-1: the same region with a larger threshold, only the frontier can be accepted now
+    int seed_pos = seed_y * m_width + seed_x;
+    if(threshold >= m_threshold && !is_border(seed_x, seed_y) && intensity(seed_pos) == m_seed_val &&
+       m_labels[seed_pos] == static_cast<unsigned char>(PxlValues::SELECTED)) {
+        m_threshold = threshold;
+        std::vector<int> frontier;
+        frontier.swap(m_refused);
+        for(int pos : frontier) {
+            if(accept(pos)) m_labels[pos] = static_cast<unsigned char>(PxlValues::UNKNOWN);
+            else            m_refused.push_back(pos);
+        }
+        for(int pos : frontier) {
+            if(m_labels[pos] == static_cast<unsigned char>(PxlValues::UNKNOWN))
+                visit(pos % m_width, pos / m_width);
+        }
+        fill_stack();
+        return true;
+    }
+
+    // Step-2: a smaller threshold or another seed, the region is grown again within the cleared labels
+    // (a smaller region is within the labelled box, the changed box includes the previous one)
+    const bounding_box previous = m_bbox;
+    if(!previous.IsEmpty()) {
+        for(int y = previous.y0; y <= previous.y1; ++y)
+            std::fill(m_labels.begin() + y * m_width + previous.x0, m_labels.begin() + y * m_width + previous.x1 + 1,
+                      static_cast<unsigned char>(PxlValues::UNKNOWN));
+    }
+    m_threshold = threshold;
+    m_num_selected = 0;
+    m_refused.clear();
+    m_bbox = bounding_box();
+    m_changed = previous;
+    grow_from(seed_x, seed_y);
+    return true;
+}
+
+void RegionGrower::CopyToRGB(unsigned char* rgb) const {
+
+    for(size_t i = 0; i < m_labels.size(); ++i) {
+        rgb[3*i] = rgb[3*i+1] = rgb[3*i+2] = m_labels[i];
+    }
+}
+
+void RegionGrower::CopyToRGB(unsigned char* rgb, const bounding_box& box) const {
+
+    for(int y = box.y0; y <= box.y1; ++y) {
+        for(int x = box.x0; x <= box.x1; ++x) {
+            size_t i = static_cast<size_t>(y) * m_width + x;
+            rgb[3*i] = rgb[3*i+1] = rgb[3*i+2] = m_labels[i];
+        }
+    }
+}
+
+bool RegionGrower::check_seed(int seed_x, int seed_y) const {
+
+    if(seed_x < 0 || seed_y < 0 || seed_x >= m_width || seed_y >= m_height) {
+        std::cout << "ERROR: Region growing seed is outside of the image!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RegionGrower::grow_from(int seed_x, int seed_y) {
+
+    // Step-2: The region does not grow from the border pixels
+    m_stack.clear();
+    int seed_pos = seed_y * m_width + seed_x;
+    m_seed_val = intensity(seed_pos);
+    if(is_border(seed_x, seed_y)) {
+        m_labels[seed_pos] = static_cast<unsigned char>(PxlValues::SELECTED);
+        m_num_selected = 1;
+        touch(seed_x, seed_y, seed_x, seed_y);
+        return;
+    }
+
+    // Step-3: Fill the spans until there is no seed left
+    m_stack.push_back(span_seed{seed_x, seed_y});
+    fill_stack();
+}
+
+void RegionGrower::fill_stack() {
+
+    while(!m_stack.empty()) {
+        span_seed s = m_stack.back();
+        m_stack.pop_back();
+        if(m_labels[s.y * m_width + s.x] == static_cast<unsigned char>(PxlValues::UNKNOWN))
+            fill_span(s.x, s.y);
+    }
+}
+
+int RegionGrower::intensity(int pos) const {
+
+    const unsigned char* px = m_rgb + 3 * pos;
+    return (static_cast<int>(px[0]) + static_cast<int>(px[1]) + static_cast<int>(px[2])) / 3;
+}
+
+bool RegionGrower::accept(int pos) const {
+
+    return std::abs(intensity(pos) - m_seed_val) <= m_threshold;
+}
+
+bool RegionGrower::is_border(int x, int y) const {
+
+    return x == 0 || y == 0 || x == m_width - 1 || y == m_height - 1;
+}
+
+void RegionGrower::touch(int x0, int y0, int x1, int y1) {
+
+    m_bbox.Extend(x0, y0, x1, y1);
+    m_changed.Extend(x0, y0, x1, y1);
+}
+
+void RegionGrower::refuse(int pos) {
+
+    m_labels[pos] = static_cast<unsigned char>(PxlValues::REFUSED);
+    m_refused.push_back(pos);
+    touch(pos % m_width, pos / m_width, pos % m_width, pos / m_width);
+}
+
+// (x, y) is an interior, accepted and unvisited pixel
+void RegionGrower::fill_span(int x, int y) {
+
+    unsigned char* row = &m_labels[y * m_width];
+    const unsigned char unknown = static_cast<unsigned char>(PxlValues::UNKNOWN);
+    int offset = y * m_width;
+
+    // extend the span to the left and to the right within the interior pixels
+    int xl = x;
+    while(xl - 1 >= 1 && row[xl - 1] == unknown && accept(offset + xl - 1))
+        --xl;
+    int xr = x;
+    while(xr + 1 <= m_width - 2 && row[xr + 1] == unknown && accept(offset + xr + 1))
+        ++xr;
+
+    for(int i = xl; i <= xr; ++i)
+        row[i] = static_cast<unsigned char>(PxlValues::SELECTED);
+    m_num_selected += xr - xl + 1;
+    touch(xl, y, xr, y);
+
+    // 8-neighbourhood of the span
+    visit(xl - 1, y);
+    visit(xr + 1, y);
+    scan_neighbour_row(xl - 1, xr + 1, y - 1);
+    scan_neighbour_row(xl - 1, xr + 1, y + 1);
+}
+
+void RegionGrower::scan_neighbour_row(int x0, int x1, int y) {
+
+    const unsigned char unknown = static_cast<unsigned char>(PxlValues::UNKNOWN);
+    int offset = y * m_width;
+    bool border_row = (y == 0 || y == m_height - 1);
+    bool in_run = false;
+
+    for(int x = x0; x <= x1; ++x) {
+        int pos = offset + x;
+        if(m_labels[pos] != unknown) {
+            in_run = false;
+            continue;
+        }
+        if(border_row || is_border(x, y)) {
+            visit(x, y);
+            in_run = false;
+        }
+        else if(accept(pos)) {
+            // a single seed is enough for a run of accepted pixels, fill_span covers all of it
+            if(!in_run)
+                m_stack.push_back(span_seed{x, y});
+            in_run = true;
+        }
+        else {
+            refuse(pos);
+            in_run = false;
+        }
+    }
+}
+
+void RegionGrower::visit(int x, int y) {
+
+    int pos = y * m_width + x;
+    if(m_labels[pos] != static_cast<unsigned char>(PxlValues::UNKNOWN))
+        return;
+
+    if(!accept(pos)) {
+        refuse(pos);
+    }
+    else if(is_border(x, y)) {
+        m_labels[pos] = static_cast<unsigned char>(PxlValues::SELECTED);
+        ++m_num_selected;
+        touch(x, y, x, y);
+    }
+    else {
+        m_stack.push_back(span_seed{x, y});
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef REGION_GROWER_HPP
+#define REGION_GROWER_HPP
+
+#include <vector>
+
+/*
+ * Scanline (span) flood fill over a raw interleaved RGB buffer (e.g. wxImage::GetData()).
+ *
+ * The visited state is kept in a flat per-pixel label buffer holding PxlValues:
+ * UNKNOWN  : not reached,
+ * SELECTED : inside the region (|intensity - seed_intensity| <= threshold),
+ * REFUSED  : neighbour of the region failing the threshold test.
+ *
+ * The result is identical to the 8-connected region growing of RegionGrow: border pixels
+ * can be selected but the region is not grown any further from them.
+ *
+ * Grow starts a session on an image, Update re-seeds or changes the threshold on the same image and
+ * keeps the labels. A larger threshold for a seed within the region (with the intensity of the first
+ * seed) only retests the refused frontier and grows from it. Otherwise only the bounding box of the
+ * labelled pixels is cleared and the region is grown again. Both return the bounding box of the changed
+ * labels, e.g. the part of a preview to redraw.
+ */
+class RegionGrower {
+public:
+
+    // inclusive pixel bounds, empty if x0 > x1
+    struct bounding_box {
+        int x0, y0, x1, y1;
+        bounding_box() : x0(0), y0(0), x1(-1), y1(-1) { }
+        bool IsEmpty() const { return x0 > x1 || y0 > y1; }
+        void Extend(int xmin, int ymin, int xmax, int ymax);
+    };
+
+    RegionGrower();
+    bool Grow(const unsigned char* rgb, int width, int height, int seed_x, int seed_y, int threshold);
+    bool Update(int seed_x, int seed_y, int threshold);
+    const std::vector<unsigned char>& GetLabels() const { return m_labels; }
+    const bounding_box& GetChangedBox() const { return m_changed; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetThreshold() const { return m_threshold; }
+    int GetNumSelected() const { return m_num_selected; }
+    void CopyToRGB(unsigned char* rgb) const;
+    // only the pixels of the box, rgb is the whole image
+    void CopyToRGB(unsigned char* rgb, const bounding_box& box) const;
+
+private:
+
+    struct span_seed {
+        int x;
+        int y;
+    };
+
+    int m_width;
+    int m_height;
+    int m_seed_val;
+    int m_threshold;
+    int m_num_selected;
+    const unsigned char* m_rgb;
+    std::vector<unsigned char> m_labels;
+    std::vector<span_seed> m_stack;
+    std::vector<int> m_refused;             // frontier of the region
+    bounding_box m_bbox;                    // labelled pixels
+    bounding_box m_changed;                 // labels changed by the last call
+
+    inline int intensity(int pos) const;
+    inline bool accept(int pos) const;
+    inline bool is_border(int x, int y) const;
+    inline void touch(int x0, int y0, int x1, int y1);
+    inline void refuse(int pos);
+    bool check_seed(int seed_x, int seed_y) const;
+    void grow_from(int seed_x, int seed_y);
+    void fill_stack();
+    void fill_span(int x, int y);
+    void scan_neighbour_row(int x0, int x1, int y);
+    void visit(int x, int y);
+};
+
+#endif // REGION_GROWER_HPP
@@ -0,0 +1,219 @@
+#include "TiledGradient.hpp"
+#include "../../utility/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// number of rows processed by a task at once
+static const int band_height = 64;
+
+template <typename T>
+struct gradient_job {
+    const T* buffer;
+    int num_comp;
+    int width;
+    int height;
+    double half_inv_sx;     // 0.5 / spacing_x
+    double half_inv_sy;     // 0.5 / spacing_y
+    unsigned char* output;
+    unsigned char* orientation;  // quantized orientations, optional and written with the output
+};
+
+template <typename T>
+static void intensity_row(const gradient_job<T>& job, int y, float* row) {
+
+    const T* px = job.buffer + static_cast<size_t>(y) * job.width * job.num_comp;
+    if(job.num_comp == 1) {
+        for(int x = 0; x < job.width; ++x)
+            row[x] = static_cast<float>(px[x]);
+        return;
+    }
+
+    double inv = 1.0 / job.num_comp;
+    for(int x = 0; x < job.width; ++x, px += job.num_comp) {
+        double sum = 0.0;
+        for(int c = 0; c < job.num_comp; ++c)
+            sum += static_cast<double>(px[c]);
+        row[x] = static_cast<float>(sum * inv);
+    }
+}
+
+// processes the rows [y0, y1): writes the truncated magnitudes and gathers their min/max
+template <typename T>
+static void process_band(const gradient_job<T>& job, int y0, int y1, std::vector<float>& rows, int& min_val, int& max_val) {
+
+    int w = job.width;
+    int h = job.height;
+    float* prev = &rows[0];
+    float* curr = &rows[w];
+    float* next = &rows[2*w];
+
+    // zero flux Neumann boundary condition: outside pixels replicate the border
+    intensity_row(job, std::max(y0 - 1, 0), prev);
+    intensity_row(job, y0, curr);
+    intensity_row(job, std::min(y0 + 1, h - 1), next);
+
+    for(int y = y0; y < y1; ++y) {
+
+        unsigned char* out = job.output + static_cast<size_t>(y) * w;
+        unsigned char* orient = (job.orientation != nullptr) ? job.orientation + static_cast<size_t>(y) * w : nullptr;
+        for(int x = 0; x < w; ++x) {
+            double dx = (static_cast<double>(curr[std::min(x + 1, w - 1)]) - curr[std::max(x - 1, 0)]) * job.half_inv_sx;
+            double dy = (static_cast<double>(next[x]) - prev[x]) * job.half_inv_sy;
+            double mag = std::sqrt(dx*dx + dy*dy);
+            int val = (mag >= 255.0) ? 255 : static_cast<int>(mag);
+            out[x] = static_cast<unsigned char>(val);
+            if(val < min_val) min_val = val;
+            if(val > max_val) max_val = val;
+            if(orient != nullptr) orient[x] = QuantizeOrientation(dx, dy);
+        }
+
+        // slide the three row window
+        if(y + 1 < y1) {
+            std::swap(prev, curr);
+            std::swap(curr, next);
+            intensity_row(job, std::min(y + 2, h - 1), next);
+        }
+    }
+}
+
+template <typename T>
+static void run_pass(const gradient_job<T>& job, size_t num_bands, size_t grain_size, int& min_val, int& max_val) {
+
+    // the statistics of each band, reduced once all of them are done
+    std::vector<int> mins(num_bands, 255);
+    std::vector<int> maxs(num_bands, 0);
+    ThreadPool::Instance().ParallelFor(0, num_bands, grain_size, [&](size_t first, size_t last) {
+        std::vector<float> rows(3 * static_cast<size_t>(job.width));
+        for(size_t band = first; band < last; ++band) {
+            int y0 = static_cast<int>(band) * band_height;
+            int y1 = std::min(y0 + band_height, job.height);
+            process_band(job, y0, y1, rows, mins[band], maxs[band]);
+        }
+    });
+
+    min_val = *std::min_element(mins.begin(), mins.end());
+    max_val = *std::max_element(maxs.begin(), maxs.end());
+}
+
+// the truncated magnitudes of the bands are replaced by their rescaled values in place
+static void rescale_pass(unsigned char* output, int width, int height, const unsigned char* lut, size_t num_bands, size_t grain_size) {
+
+    ThreadPool::Instance().ParallelFor(0, num_bands, grain_size, [&](size_t first, size_t last) {
+        int y0 = static_cast<int>(first) * band_height;
+        int y1 = std::min(static_cast<int>(last) * band_height, height);
+        unsigned char* out = output + static_cast<size_t>(y0) * width;
+        unsigned char* end = output + static_cast<size_t>(y1) * width;
+        for(; out != end; ++out)
+            *out = lut[*out];
+    });
+}
+
+template <typename T>
+void TiledGradientMagnitude(const T* buffer, int num_comp, int width, int height,
+                            double spacing_x, double spacing_y, unsigned char* output,
+                            unsigned int num_threads, unsigned char* orientation) {
+
+    if(buffer == nullptr || output == nullptr || num_comp <= 0 || width <= 0 || height <= 0)
+        return;
+
+    gradient_job<T> job;
+    job.buffer = buffer;
+    job.num_comp = num_comp;
+    job.width = width;
+    job.height = height;
+    job.half_inv_sx = 0.5 / std::abs(spacing_x);
+    job.half_inv_sy = 0.5 / std::abs(spacing_y);
+    job.output = output;
+    job.orientation = orientation;
+    size_t num_bands = static_cast<size_t>((height + band_height - 1) / band_height);
+    size_t grain_size = (num_threads > 0) ? (num_bands + num_threads - 1) / num_threads : 1;
+
+    // Pass-1: the truncated magnitudes, the orientations and the statistics of the magnitude image
+    int min_val(255), max_val(0);
+    run_pass(job, num_bands, grain_size, min_val, max_val);
+
+    // same factor and offset as itk::RescaleIntensityImageFilter
+    double factor = 0.0;
+    if(max_val != min_val)
+        factor = 255.0 / (max_val - min_val);
+    else if(max_val != 0)
+        factor = 255.0 / max_val;
+    double offset = -min_val * factor;
+    unsigned char lut[256];
+    for(int v = 0; v < 256; ++v)
+        lut[v] = static_cast<unsigned char>(std::min(255.0, std::max(0.0, v * factor + offset)));
+
+    // Pass-2: the rescaled values, one lookup per pixel
+    rescale_pass(output, width, height, lut, num_bands, grain_size);
+}
+
+// the intensities of the pixels [xa, xb] of the row y, row[0] is the pixel xa
+template <typename T>
+static void intensity_span(const gradient_job<T>& job, int y, int xa, int xb, float* row) {
+
+    const T* px = job.buffer + (static_cast<size_t>(y) * job.width + xa) * job.num_comp;
+    double inv = 1.0 / job.num_comp;
+    for(int x = xa; x <= xb; ++x, px += job.num_comp) {
+        double sum = 0.0;
+        for(int c = 0; c < job.num_comp; ++c)
+            sum += static_cast<double>(px[c]);
+        row[x - xa] = (job.num_comp == 1) ? static_cast<float>(px[0]) : static_cast<float>(sum * inv);
+    }
+}
+
+template <typename T>
+void GradientMagnitudeRegion(const T* buffer, int num_comp, int width, int height,
+                             double spacing_x, double spacing_y, int x0, int y0, int w, int h,
+                             unsigned char* output, int stride) {
+
+    if(buffer == nullptr || output == nullptr || num_comp <= 0 || w <= 0 || h <= 0 ||
+       x0 < 0 || y0 < 0 || x0 + w > width || y0 + h > height)
+        return;
+
+    gradient_job<T> job;
+    job.buffer = buffer;
+    job.num_comp = num_comp;
+    job.width = width;
+    job.height = height;
+    job.half_inv_sx = 0.5 / std::abs(spacing_x);
+    job.half_inv_sy = 0.5 / std::abs(spacing_y);
+    job.output = output;
+    job.orientation = nullptr;
+
+    // the columns of the region and its border, clamped as the zero flux Neumann boundary condition
+    int xa = std::max(x0 - 1, 0);
+    int xb = std::min(x0 + w, width - 1);
+    int span = xb - xa + 1;
+    std::vector<float> rows(3 * static_cast<size_t>(span));
+    float* prev = &rows[0];
+    float* curr = &rows[span];
+    float* next = &rows[2*span];
+    intensity_span(job, std::max(y0 - 1, 0), xa, xb, prev);
+    intensity_span(job, y0, xa, xb, curr);
+    intensity_span(job, std::min(y0 + 1, height - 1), xa, xb, next);
+
+    for(int y = y0; y < y0 + h; ++y) {
+
+        unsigned char* out = output + static_cast<size_t>(y - y0) * stride;
+        for(int x = x0; x < x0 + w; ++x) {
+            int i = x - xa;
+            double dx = (static_cast<double>(curr[std::min(x + 1, width - 1) - xa]) - curr[std::max(x - 1, 0) - xa]) * job.half_inv_sx;
+            double dy = (static_cast<double>(next[i]) - prev[i]) * job.half_inv_sy;
+            double mag = std::sqrt(dx*dx + dy*dy);
+            out[x - x0] = (mag >= 255.0) ? 255 : static_cast<unsigned char>(mag);
+        }
+
+        if(y + 1 < y0 + h) {
+            std::swap(prev, curr);
+            std::swap(curr, next);
+            intensity_span(job, std::min(y + 2, height - 1), xa, xb, next);
+        }
+    }
+}
+
+template void TiledGradientMagnitude<float>(const float*, int, int, int, double, double, unsigned char*, unsigned int, unsigned char*);
+template void TiledGradientMagnitude<unsigned char>(const unsigned char*, int, int, int, double, double, unsigned char*, unsigned int, unsigned char*);
+template void GradientMagnitudeRegion<float>(const float*, int, int, int, double, double, int, int, int, int, unsigned char*, int);
+template void GradientMagnitudeRegion<unsigned char>(const unsigned char*, int, int, int, double, double, int, int, int, int, unsigned char*, int);
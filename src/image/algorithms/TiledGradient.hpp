@@ -0,0 +1,54 @@
+#ifndef TILED_GRADIENT_HPP
+#define TILED_GRADIENT_HPP
+
+#include <cmath>
+
+// the orientation of the gradient modulo pi quantized to 256 bins, the polarity of the edges is ignored
+static const double orientation_bins_per_radian = 256.0 / M_PI;
+
+inline unsigned char QuantizeOrientation(double dx, double dy) {
+
+    double angle = std::atan2(dy, dx);
+    if(angle < 0.0) angle += M_PI;
+    return static_cast<unsigned char>(static_cast<int>(angle * orientation_bins_per_radian) & 0xff);
+}
+
+/*
+ * Fused intensity -> gradient magnitude -> rescale [0, 255] pipeline working on an interleaved
+ * pixel buffer with num_comp components per pixel.
+ *
+ * The steps follow the chain of otb::VectorImageToIntensityImageFilter,
+ * itk::GradientMagnitudeImageFilter<float, unsigned char> and itk::RescaleIntensityImageFilter:
+ *  - intensity is the mean of the components (the component itself for single band images),
+ *  - central differences with zero flux Neumann boundary condition,
+ *  - magnitude truncated to an integer and saturated at 255, then linearly rescaled to [0, 255].
+ * The ITK filter casts the magnitude to unsigned char without saturating it, thus the pixels whose
+ * magnitude is 255 or more (and the rescaling if there are any) differ from the ITK chain.
+ *
+ * The image is processed in bands of rows, in parallel on the ThreadPool. Only three rows of
+ * intensities per task are materialized. The first pass writes the saturated magnitudes into the
+ * output and gathers the min/max statistics for the rescaling, the second one remaps the output in
+ * place through a table of the 256 rescaled values.
+ *
+ * num_threads limits the number of tasks, 0 uses all the workers of the pool.
+ *
+ * orientation, if not null, receives the quantized orientation of the gradient of every pixel
+ * (QuantizeOrientation) in the first pass, in the layout of the output.
+ */
+template <typename T>
+void TiledGradientMagnitude(const T* buffer, int num_comp, int width, int height,
+                            double spacing_x, double spacing_y, unsigned char* output,
+                            unsigned int num_threads = 0, unsigned char* orientation = nullptr);
+
+/*
+ * Truncated gradient magnitudes of the region [x0, x0 + w) x [y0, y0 + h) of the image, the values
+ * of TiledGradientMagnitude before the rescaling, which needs the statistics of the whole image.
+ * The rows of the region are written stride bytes apart, only the intensities of the region and
+ * of its one pixel border are computed, e.g. for the tiles of LazyGradientImage.
+ */
+template <typename T>
+void GradientMagnitudeRegion(const T* buffer, int num_comp, int width, int height,
+                             double spacing_x, double spacing_y, int x0, int y0, int w, int h,
+                             unsigned char* output, int stride);
+
+#endif // TILED_GRADIENT_HPP
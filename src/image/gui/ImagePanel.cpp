@@ -1,7 +1,11 @@
 #include "ImagePanel.hpp"
 #include "ImageFrame.hpp"
-#include "../algorithms/Algorithms.hpp"
+#include "WxImageAlgorithms.hpp"
+#include "../algorithms/RegionGrower.hpp"
+#include "../algorithms/ImageRepository.hpp"
+#include "../../wx/WxGuiId.hpp"
 #include <wx/dcclient.h>
+#include <wx/dcmemory.h>
 #include <wx/msgdlg.h>
 #include <wx/string.h>
 #include <iostream>
@@ -10,6 +14,7 @@
 BEGIN_EVENT_TABLE(ImagePanel, wxPanel)
 EVT_PAINT(ImagePanel::PaintEvent)
 EVT_SIZE(ImagePanel::OnSize)
+EVT_TIMER(wxID_IMAGE_PANEL_REFINE_TIMER, ImagePanel::OnRefineTimer)
 EVT_MOTION(ImagePanel::OnMouseMoved)
 EVT_LEFT_DOWN(ImagePanel::OnLeftClick)
 EVT_RIGHT_DOWN(ImagePanel::OnRightClick)
@@ -24,9 +29,16 @@ EVT_KEY_DOWN(ImagePanel::OnKeyPressed)
  */
 END_EVENT_TABLE()
 
+// the rgb pixels and the alpha channel
+static size_t image_byte_size(const wxImage& img) {
+    return img.IsOk() ? static_cast<size_t>(img.GetWidth()) * img.GetHeight() * (img.HasAlpha() ? 4 : 3) : 0;
+}
+
 ImagePanel::ImagePanel(ImageFrame* parent, wxString file_path) : wxScrolledWindow(parent),
     m_minImg(wxSize(0,0)), m_dimgRect(), m_dpmode(image_display_mode(image_display_mode::VARYING)),
-    m_opmode(image_operation_mode::Default), m_path("") {
+    m_opmode(image_operation_mode::Default), m_path(""), m_region_threshold(9),
+    m_refine_timer(this, wxID_IMAGE_PANEL_REFINE_TIMER), m_memory(memory_category::images) {
+    m_evictor = MemoryRegistry::Instance().RegisterEvictor(eviction_order::pyramid_levels, [this](size_t bytes) { return usrEvictPyramidLevels(bytes); });
     SetBackgroundColour(*wxWHITE);
     SetScrollRate(1, 1);
     if(file_path != wxEmptyString) {
@@ -37,16 +49,25 @@ ImagePanel::ImagePanel(ImageFrame* parent, wxString file_path) : wxScrolledWindo
     m_parent = parent;
 }
 
+ImagePanel::~ImagePanel() {
+
+    MemoryRegistry::Instance().UnregisterEvictor(m_evictor);
+    m_region_job.Cancel();
+    m_gradient_job.Cancel();
+}
+
 // Public Member Functions
 bool ImagePanel::UsrLoadFile(const wxString& path) {
 
+    // the pixels are shared with the scene graph frames and the gradient generation of the same image,
+    // the files that cannot be decoded by otb are loaded by the wx image handlers
     m_img.Destroy();
-    if(m_img.LoadFile(path)) {
-        m_path = path.ToStdString();
-        usrUpdateImage();
-        return true;
-    }
-    return false;
+    m_shared_img = ImageRepository::Instance().Acquire(path.ToStdString());
+    if(m_shared_img) m_img = SharedImageToWxImageView(*m_shared_img);
+    else if(!m_img.LoadFile(path)) return false;
+    m_path = path.ToStdString();
+    usrUpdateImage();
+    return true;
 }
 void ImagePanel::UsrSetDisplayMode(image_display_mode mode) {
 
@@ -56,6 +77,7 @@ void ImagePanel::UsrSetDisplayMode(image_display_mode mode) {
 }
 void ImagePanel::UsrSetUIOperationMode(image_operation_mode mode) {
 
+    if(mode != image_operation_mode::RegionGrowing) usrEndRegionGrowing();
     m_opmode = mode;
 }
 
@@ -71,18 +93,33 @@ wxSize ImagePanel::UsrGetImageSize() const {
 
 void ImagePanel::UsrDisplayGraidentImage() {
 
-    if(!m_img.IsOk()) return;
-
-    if(m_path.empty()) {
-        std::cerr << "Image file path is empty" << std::endl;
-        return;
-    }
-
-    wxImage gradImg(m_dimg.ConvertToImage());
-    OtbFloatVectorImageType::Pointer img = LoadImage<OtbFloatVectorImageType>(m_path);
-    GradientMagnitudeImage(img, gradImg);
-    m_dimg = wxBitmap(gradImg);
-    Refresh();
+    if(!m_img.IsOk() || m_gradient_job.IsValid()) return;
+
+    // the gradient is computed on a view of the shared pixels or, for a rotated image, of a copy;
+    // the images are owned by shared pointers, the reference counts of wxImage are not thread safe
+    std::shared_ptr<const SharedImage> shared;
+    std::shared_ptr<wxImage> img;
+    if(m_shared_img && m_img.GetData() == m_shared_img->GetData()) shared = m_shared_img;
+    else                                                           img = std::make_shared<wxImage>(m_img.Copy());
+    wxSize size = m_dimgRect.GetSize();
+    m_gradient_job = ThreadPool::Instance().Submit([shared, img, size](const CancellationToken&) {
+        std::shared_ptr<wxImage> gradImg = std::make_shared<wxImage>();
+        OtbVectorImageType::Pointer view = shared ? shared->GetOtbView() : WxImageToOtbImageView(*img);
+        OtbImageToWxImage(GradientMagnitudeImage(view), *gradImg);
+        if(gradImg->IsOk() && gradImg->GetSize() != size)
+            *gradImg = gradImg->Scale(size.GetWidth(), size.GetHeight(), wxIMAGE_QUALITY_HIGH);
+        return gradImg;
+    });
+
+    // the result is dropped if the display image is resized meanwhile
+    m_gradient_job.Then([this, size](const std::shared_ptr<wxImage>& gradImg) {
+        m_gradient_job.Reset();
+        if(!gradImg->IsOk() || m_dimgRect.GetSize() != size) return;
+        usrEndRegionGrowing();
+        m_dimg = wxBitmap(*gradImg);
+        usrReportMemory();
+        Refresh();
+    }, utilityUIExecutor());
 }
 
 void ImagePanel::UsrViewInOriginalSize() {
@@ -136,17 +173,71 @@ void ImagePanel::usrCalculateDisplayImageSize(double percentage) {
     m_dimgRect.SetSize(m_img.GetSize());
 }
 
-void ImagePanel::usrUpdateDisplayImage() {
+void ImagePanel::usrUpdateDisplayImage(bool high_quality) {
 
     if(!m_img.IsOk()) return;
+    usrEndRegionGrowing();
     if((m_img.GetWidth() == m_dimgRect.GetWidth()) && (m_img.GetHeight() == m_dimgRect.GetHeight()))
         m_dimg = wxBitmap(m_img);
-    else
-        m_dimg = wxBitmap(m_img.Scale(m_dimgRect.GetWidth(), m_dimgRect.GetHeight(), wxIMAGE_QUALITY_HIGH));
+    else {
+        // the levels are box filtered, a fast scaling of the nearest larger level is good enough while resizing
+        const wxImage& level = usrGetPyramidLevel(m_dimgRect.GetSize());
+        wxImageResizeQuality quality = high_quality ? wxIMAGE_QUALITY_HIGH : wxIMAGE_QUALITY_NORMAL;
+        m_dimg = wxBitmap(level.Scale(m_dimgRect.GetWidth(), m_dimgRect.GetHeight(), quality));
+    }
+    usrReportMemory();
+}
+
+void ImagePanel::usrBuildPyramid() {
+
+    // halved down to the size of a thumbnail, the first level shares the data of m_img
+    static const int min_level_size = 64;
+    m_pyramid.clear();
+    if(!m_img.IsOk()) return;
+    m_pyramid.push_back(m_img);
+    while(m_pyramid.back().GetWidth() >= 2 * min_level_size && m_pyramid.back().GetHeight() >= 2 * min_level_size)
+        m_pyramid.push_back(m_pyramid.back().ShrinkBy(2, 2));
+}
+
+const wxImage& ImagePanel::usrGetPyramidLevel(const wxSize& size) const {
+
+    size_t k = 0;
+    while(k + 1 < m_pyramid.size() && m_pyramid[k + 1].GetWidth() >= size.GetWidth() && m_pyramid[k + 1].GetHeight() >= size.GetHeight())
+        ++k;
+    return m_pyramid.empty() ? m_img : m_pyramid[k];
+}
+
+size_t ImagePanel::usrEvictPyramidLevels(size_t bytes) {
+
+    // the first level is m_img, the display image is scaled from a larger level without the others
+    // until the image is loaded or rotated again
+    if(m_pyramid.size() < 2) return 0;
+    size_t used = static_cast<size_t>(&usrGetPyramidLevel(m_dimgRect.GetSize()) - m_pyramid.data());
+    size_t freed = 0;
+    for(size_t k = m_pyramid.size() - 1; k > 0 && freed < bytes; --k) {
+        if(k == used) continue;
+        freed += image_byte_size(m_pyramid[k]);
+        m_pyramid.erase(m_pyramid.begin() + k);
+    }
+    usrReportMemory();
+    return freed;
+}
+
+void ImagePanel::usrReportMemory() {
+
+    // the image that views the shared pixels is reported by the repository
+    size_t bytes = (m_shared_img && m_img.GetData() == m_shared_img->GetData()) ? 0 : image_byte_size(m_img);
+    for(size_t k = 1; k < m_pyramid.size(); ++k)
+        bytes += image_byte_size(m_pyramid[k]);
+    if(m_dimg.IsOk()) bytes += static_cast<size_t>(m_dimg.GetWidth()) * m_dimg.GetHeight() * m_dimg.GetDepth() / 8;
+    if(m_region_rgb) bytes += m_region_rgb->size();
+    bytes += image_byte_size(m_region_img);
+    m_memory.Set(bytes);
 }
 
 void ImagePanel::usrUpdateImage() {
 
+    usrBuildPyramid();
     m_minImg = utilitySimplify(wxSize(m_img.GetWidth(), m_img.GetHeight()));
     usrCalculateDisplayImageSize(0.6);
     m_parent->SetClientSize(m_dimgRect.GetSize());
@@ -163,6 +254,73 @@ void ImagePanel::usrOnOperationModeUpdated() {
     }
 }
 
+void ImagePanel::usrGrowRegion() {
+
+    // one update at a time, the session is only modified by its job
+    if(m_region_job.IsValid()) return;
+
+    // Step-1: a session segments a copy of the display image
+    bool start = !m_grower;
+    if(start) {
+        wxImage dimg(m_dimg.ConvertToImage());
+        m_region_rgb = std::make_shared<std::vector<unsigned char>>(dimg.GetData(), dimg.GetData() + 3 * dimg.GetWidth() * dimg.GetHeight());
+        m_region_img.Create(dimg.GetWidth(), dimg.GetHeight(), false);
+        m_grower = std::make_shared<RegionGrower>();
+        usrReportMemory();
+    }
+
+    // Step-2: the first click grows the region, the next ones re-seed or change the threshold from the kept labels
+    std::shared_ptr<RegionGrower> grower = m_grower;
+    std::shared_ptr<std::vector<unsigned char>> rgb = m_region_rgb;
+    int w = m_region_img.GetWidth();
+    int h = m_region_img.GetHeight();
+    wxPoint seed = m_region_seed;
+    int threshold = m_region_threshold;
+    m_region_job = ThreadPool::Instance().Submit([grower, rgb, w, h, seed, threshold, start](const CancellationToken&) {
+        if(start) return grower->Grow(rgb->data(), w, h, seed.x, seed.y, threshold);
+        return grower->Update(seed.x, seed.y, threshold);
+    });
+
+    // Step-3: only the changed labels are drawn, the result is dropped if the session ended meanwhile
+    m_region_job.Then([this, grower, start, w, h](const bool& grown) {
+        m_region_job.Reset();
+        if(grower != m_grower) return;
+        if(!grown) {
+            if(start) usrEndRegionGrowing();
+            return;
+        }
+        if(start) {
+            usrUpdateRegionPreview(wxRect(0, 0, w, h));
+            return;
+        }
+        const RegionGrower::bounding_box& box = grower->GetChangedBox();
+        if(!box.IsEmpty())
+            usrUpdateRegionPreview(wxRect(box.x0, box.y0, box.x1 - box.x0 + 1, box.y1 - box.y0 + 1));
+    }, utilityUIExecutor());
+}
+
+void ImagePanel::usrUpdateRegionPreview(const wxRect& rect) {
+
+    RegionGrower::bounding_box box;
+    box.Extend(rect.GetLeft(), rect.GetTop(), rect.GetRight(), rect.GetBottom());
+    m_grower->CopyToRGB(m_region_img.GetData(), box);
+
+    // the changed part of the display bitmap is drawn in place and refreshed
+    wxMemoryDC dc(m_dimg);
+    dc.DrawBitmap(wxBitmap(m_region_img.GetSubImage(rect)), rect.GetPosition());
+    dc.SelectObject(wxNullBitmap);
+    RefreshRect(wxRect(CalcScrolledPosition(m_dimgRect.GetPosition() + rect.GetPosition()), rect.GetSize()));
+}
+
+void ImagePanel::usrEndRegionGrowing() {
+
+    // a running job keeps its own references, its result is dropped
+    m_grower.reset();
+    m_region_rgb.reset();
+    m_region_img.Destroy();
+    usrReportMemory();
+}
+
 // Event Handlers
 void ImagePanel::PaintEvent(wxPaintEvent& event) {
     wxPaintDC dc(this);  // may use double-buffered dcs
@@ -191,13 +349,22 @@ void ImagePanel::OnSize(wxSizeEvent& event) {
         else                     m_dimgRect.x = 0;
         if(diff.GetHeight() > 0) m_dimgRect.y = diff.GetHeight() / 2;
         else                     m_dimgRect.y = 0;
-        usrUpdateDisplayImage();
+
+        // a fast display image on every size event, refined once no size event arrives for a while
+        usrUpdateDisplayImage(false);
+        m_refine_timer.Start(200, wxTIMER_ONE_SHOT);
     }
     m_parent->SetStatusText(utilityToString("disp img size: ", m_dimgRect.GetSize()), 1);
     Refresh();
     event.Skip();
 }
 
+void ImagePanel::OnRefineTimer(wxTimerEvent& event) {
+
+    usrUpdateDisplayImage();
+    Refresh();
+}
+
 void ImagePanel::OnMouseMoved(wxMouseEvent& event) {
 
     if(!m_img.IsOk()) return;
@@ -211,15 +378,9 @@ void ImagePanel::OnLeftClick(wxMouseEvent& event) {
     if(!m_img.IsOk()) return;
     wxPoint mouse_pos = event.GetPosition();
     if(m_opmode == image_operation_mode::RegionGrowing) {
-        if(m_dimgRect.Contains(mouse_pos)) {
-            wxPoint imgCoord = mouse_pos - m_dimgRect.GetPosition() + wxPoint(GetScrollPos(wxHORIZONTAL), GetScrollPos(wxVERTICAL));
-            wxImage dummy(m_dimg.ConvertToImage());
-            unsigned char* data = dummy.GetData();
-            unsigned char* dcopy = new unsigned char[dummy.GetWidth()*dummy.GetHeight()*3];
-            std::copy(data, data + dummy.GetWidth()*dummy.GetHeight()*3, dcopy);
-            RegionGrowSegmentation(m_dimg.ConvertToImage(), dummy, imgCoord, 9);
-            m_dimg = wxBitmap(dummy);
-            Refresh();
+        if(m_dimgRect.Contains(mouse_pos) && !m_region_job.IsValid()) {
+            m_region_seed = mouse_pos - m_dimgRect.GetPosition() + wxPoint(GetScrollPos(wxHORIZONTAL), GetScrollPos(wxVERTICAL));
+            usrGrowRegion();
         }
     }
 }
@@ -232,4 +393,19 @@ void ImagePanel::OnRightClick(wxMouseEvent& event) {
 void ImagePanel::OnKeyPressed(wxKeyEvent& event) {
 
     if(!m_img.IsOk()) return;
+
+    // +/- tune the threshold of the region growing session at its last seed
+    if(m_opmode == image_operation_mode::RegionGrowing && !m_region_job.IsValid()) {
+        int key = event.GetKeyCode();
+        int threshold = m_region_threshold;
+        if(key == '+' || key == '=' || key == WXK_NUMPAD_ADD)               ++threshold;
+        else if((key == '-' || key == WXK_NUMPAD_SUBTRACT) && threshold > 0) --threshold;
+        if(threshold != m_region_threshold) {
+            m_region_threshold = threshold;
+            std::cout << "INFO: Region growing threshold: " << m_region_threshold << std::endl;
+            if(m_grower) usrGrowRegion();
+            return;
+        }
+    }
+    event.Skip();
 }
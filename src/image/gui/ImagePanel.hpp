@@ -2,18 +2,25 @@
 #define _IMAGE_PANEL_HPP
 
 #include "../../wx/WxUtility.hpp"
+#include "../../utility/MemoryRegistry.hpp"
+#include "../../utility/ThreadPool.hpp"
 
 #include <wx/scrolwin.h>
 #include <wx/image.h>
 #include <wx/bitmap.h>
+#include <wx/timer.h>
+#include <memory>
 #include <vector>
 
 class ImageFrame;
 class DrawingLayer;
+class SharedImage;
+class RegionGrower;
 
 class ImagePanel : public wxScrolledWindow {
 public:
     ImagePanel(ImageFrame* parent, wxString file = wxEmptyString);
+    ~ImagePanel();
     // Member functions:
     bool UsrLoadFile(const wxString& path);
     bool UsrSaveImage(const wxString& path);
@@ -27,24 +34,44 @@ public:
 private:
     ImageFrame* m_parent;
     wxImage m_img;
+    std::vector<wxImage> m_pyramid;         // m_img halved per level, the display image is scaled from the nearest larger level
+    std::shared_ptr<const SharedImage> m_shared_img;   // pixels of m_img unless it is rotated
     wxBitmap m_dimg;
     wxSize m_minImg;
     wxRect m_dimgRect;
     image_display_mode m_dpmode;
     image_operation_mode m_opmode;
     std::string m_path;
+    Job<bool> m_region_job;                 // region growing on the thread pool
+    std::shared_ptr<RegionGrower> m_grower; // region growing session, the labels are kept between the clicks
+    std::shared_ptr<std::vector<unsigned char>> m_region_rgb;  // display image the session segments
+    wxImage m_region_img;                   // labels of the session, the display image shows them
+    wxPoint m_region_seed;
+    int m_region_threshold;
+    Job<std::shared_ptr<wxImage>> m_gradient_job;
+    wxTimer m_refine_timer;                 // high quality display image once the resizing settles
+    MemoryRegistry::Allocation m_memory;    // copies of the image, the pyramid, the display and the region images
+    int m_evictor;                          // drops the pyramid levels the display image is not scaled from
 
     // Member functions:
     void usrCalculateDisplayImageSize(double percentage);
-    inline void usrUpdateDisplayImage();
+    inline void usrUpdateDisplayImage(bool high_quality = true);
     inline void usrUpdateImage();
+    void usrBuildPyramid();
+    const wxImage& usrGetPyramidLevel(const wxSize& size) const;
+    size_t usrEvictPyramidLevels(size_t bytes);
+    void usrReportMemory();
     void usrOnOperationModeUpdated();
+    void usrGrowRegion();
+    void usrUpdateRegionPreview(const wxRect& rect);
+    void usrEndRegionGrowing();
     // Event handlers:
     void PaintEvent(wxPaintEvent& event);
     void OnMouseMoved(wxMouseEvent& event);
     void OnLeftClick(wxMouseEvent& event);
     void OnRightClick(wxMouseEvent& event);
     void OnSize(wxSizeEvent& event);
+    void OnRefineTimer(wxTimerEvent& event);
     void OnKeyPressed(wxKeyEvent& event);
     // some useful events
     /*
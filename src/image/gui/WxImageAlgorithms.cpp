@@ -0,0 +1,103 @@
+#include "WxImageAlgorithms.hpp"
+#include "../algorithms/RegionGrower.hpp"
+#include "../algorithms/ImageRepository.hpp"
+
+#include <wx/image.h>
+
+#include <otbImportVectorImageFilter.h>
+#include <algorithm>
+
+// The returned image does not own its pixels, it is a view on the RGB buffer of the wxImage.
+// Therefore, wxImg must outlive the returned image and must not be reallocated meanwhile.
+OtbVectorImageType::Pointer WxImageToOtbImageView(const wxImage& wxImg) {
+
+    typedef otb::ImportVectorImageFilter<OtbVectorImageType> ImporterType;
+    ImporterType::Pointer importFilter = ImporterType::New();
+    ImporterType::SizeType size;
+    size[0] = wxImg.GetWidth();
+    size[1] = wxImg.GetHeight();
+    ImporterType::IndexType start;
+    start.Fill(0);
+    ImporterType::RegionType region;
+    region.SetIndex(start);
+    region.SetSize(size);
+    importFilter->SetRegion(region);
+    double origin[2] = {0, 0};
+    importFilter->SetOrigin(origin);
+    double spacing[2] = {1.0, 1.0};
+    importFilter->SetSpacing(spacing);
+    importFilter->SetImportPointer(wxImg.GetData(), 3*size[0]*size[1], false);
+    importFilter->Update();
+
+    OtbVectorImageType::Pointer view = importFilter->GetOutput();
+    view->DisconnectPipeline();
+    return view;
+}
+
+wxImage SharedImageToWxImageView(const SharedImage& image) {
+
+    // static data: wx never frees nor reallocates the pixels, the operations of wxImage return new images
+    return wxImage(image.GetWidth(), image.GetHeight(), const_cast<unsigned char*>(image.GetData()), true);
+}
+
+// Writes the image into the buffer of wxImg, wxImg is (re)created only if its size does not match
+void OtbImageToWxImage(OtbImageType::Pointer image, wxImage& wxImg) {
+
+    OtbImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    int w = static_cast<int>(size[0]);
+    int h = static_cast<int>(size[1]);
+    if(!wxImg.IsOk() || wxImg.GetWidth() != w || wxImg.GetHeight() != h)
+        wxImg.Create(w, h, false);
+    CopyToWxImageData(image, wxImg.GetData());
+}
+
+bool RegionGrowSegmentation(const wxImage& wxImg, wxImage& segImg, const wxPoint& pt, int threshold) {
+
+    // execute the region grow algorithm directly on the wxImage buffer
+    RegionGrower grower;
+    if(!grower.Grow(wxImg.GetData(), wxImg.GetWidth(), wxImg.GetHeight(), pt.x, pt.y, threshold))
+        return false;
+
+    // write the output directly into the buffer of segImg
+    if(!segImg.IsOk() || segImg.GetWidth() != wxImg.GetWidth() || segImg.GetHeight() != wxImg.GetHeight())
+        segImg.Create(wxImg.GetWidth(), wxImg.GetHeight(), false);
+    grower.CopyToRGB(segImg.GetData());
+
+    return true;
+}
+
+OtbImageType::Pointer RegionGrow(const wxImage& wxImg, const wxPoint& pt, int threshold) {
+
+    // Step-1: Grow the region on the flat labels buffer
+    RegionGrower grower;
+    if(!grower.Grow(wxImg.GetData(), wxImg.GetWidth(), wxImg.GetHeight(), pt.x, pt.y, threshold))
+        return OtbImageType::Pointer();
+
+    // Step-2: Copy the labels into an otb image
+    OtbImageType::SizeType size;
+    size[0] = wxImg.GetWidth();
+    size[1] = wxImg.GetHeight();
+    OtbImageType::IndexType start;
+    start.Fill(0);
+    OtbImageType::RegionType region;
+    region.SetIndex(start);
+    region.SetSize(size);
+    OtbImageType::Pointer labels_image = OtbImageType::New();
+    labels_image->SetRegions(region);
+    labels_image->Allocate();
+    const std::vector<unsigned char>& labels = grower.GetLabels();
+    std::copy(labels.begin(), labels.end(), labels_image->GetBufferPointer());
+    return labels_image;
+}
+
+void GradientMagnitudeImage(OtbFloatVectorImageType::Pointer img, wxImage& gradImg) {
+
+    OtbImageType::Pointer gImg = GradientMagnitudeImage(img);
+    OtbImageToWxImage(gImg, gradImg);
+}
+
+void GradientMagnitudeImage(const wxImage& img, wxImage& gradImg) {
+
+    OtbImageType::Pointer gImg = GradientMagnitudeImage(WxImageToOtbImageView(img));
+    OtbImageToWxImage(gImg, gradImg);
+}
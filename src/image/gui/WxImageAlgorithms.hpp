@@ -0,0 +1,22 @@
+#ifndef WX_IMAGE_ALGORITHMS_HPP
+#define WX_IMAGE_ALGORITHMS_HPP
+
+#include "../algorithms/Algorithms.hpp"
+#include <memory>
+
+class wxImage;
+class wxPoint;
+class SharedImage;
+
+// wxImage <-> otb image bridge, the image algorithms themselves do not depend on wx
+OtbVectorImageType::Pointer WxImageToOtbImageView(const wxImage& wxImg);
+void OtbImageToWxImage(OtbImageType::Pointer image, wxImage& wxImg);
+// the returned image does not own its pixels, the caller keeps the shared image alive as long as it is used
+wxImage SharedImageToWxImageView(const SharedImage& image);
+
+OtbImageType::Pointer RegionGrow(const wxImage& wxImg, const wxPoint& pt, int threshold);
+bool RegionGrowSegmentation(const wxImage& wxImg, wxImage& segImg, const wxPoint& pt, int threshold);
+void GradientMagnitudeImage(OtbFloatVectorImageType::Pointer img, wxImage& gradImg);
+void GradientMagnitudeImage(const wxImage& img, wxImage& gradImg);
+
+#endif // WX_IMAGE_ALGORITHMS_HPP
@@ -0,0 +1,92 @@
+#include "BatchProjector.hpp"
+#include "ProjectionParameters.hpp"
+#include "../osg/OsgUtility.hpp"
+#include <algorithm>
+
+// points per block, the block arrays stay in the L1 cache
+static const size_t block_size = 128;
+
+template <typename Scalar>
+static void project_block(const Scalar* m, const Scalar* xyz, size_t num, Scalar* xy) {
+
+    // Step-1: split the interleaved points
+    Scalar x[block_size], y[block_size], z[block_size], u[block_size], v[block_size];
+    for(size_t i = 0; i < num; ++i) {
+        x[i] = xyz[3*i];
+        y[i] = xyz[3*i + 1];
+        z[i] = xyz[3*i + 2];
+    }
+
+    // Step-2: projection and perspective division, x' = x*m(0,0) + y*m(1,0) + z*m(2,0) + m(3,0)
+    for(size_t i = 0; i < num; ++i) {
+        Scalar inv_w = Scalar(1) / (x[i] * m[3] + y[i] * m[7] + z[i] * m[11] + m[15]);
+        u[i] = (x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + m[12]) * inv_w;
+        v[i] = (x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + m[13]) * inv_w;
+    }
+
+    // Step-3: interleave the projections
+    for(size_t i = 0; i < num; ++i) {
+        xy[2*i]     = u[i];
+        xy[2*i + 1] = v[i];
+    }
+}
+
+template <typename Scalar>
+static void project_blocks(const Scalar* m, const Scalar* xyz, size_t num, Scalar* xy) {
+
+    for(size_t first = 0; first < num; first += block_size)
+        project_block(m, xyz + 3 * first, std::min(block_size, num - first), xy + 2 * first);
+}
+
+BatchProjector::BatchProjector() {
+    SetTransform(osg::Matrixd::identity(), osg::Matrixd::identity(), osg::Matrixd::identity());
+}
+
+void BatchProjector::SetTransform(const osg::Matrixd& model, const osg::Matrixd& projection, const osg::Matrixd& window) {
+
+    m_transform = model * projection * window;
+    const double* ptr = m_transform.ptr();
+    for(int i = 0; i < 16; ++i) {
+        m_matrix[i] = ptr[i];
+        m_matrix_f[i] = static_cast<float>(ptr[i]);
+    }
+}
+
+void BatchProjector::SetTransform(const osg::Matrixd& model, const ProjectionParameters& pp) {
+
+    // the matrices of the projection parameters act on column vectors
+    osg::Matrixd proj, vp, proj_tr, vp_tr;
+    pp.construct_perpective_projection_matrix(proj);
+    pp.construct_viewport_mapping_matrix(vp);
+    transpose<4, 4>(proj, proj_tr);
+    transpose<4, 4>(vp, vp_tr);
+    SetTransform(model, proj_tr, vp_tr);
+}
+
+const osg::Matrixd& BatchProjector::GetTransform() const {
+    return m_transform;
+}
+
+void BatchProjector::Project(const double* xyz, size_t num, double* xy) const {
+    project_blocks(m_matrix, xyz, num, xy);
+}
+
+void BatchProjector::Project(const float* xyz, size_t num, float* xy) const {
+    project_blocks(m_matrix_f, xyz, num, xy);
+}
+
+void BatchProjector::Project(const osg::Vec3dArray* points, osg::Vec2dArray* projected) const {
+
+    if(points->empty()) return;
+    size_t offset = projected->size();
+    projected->resize(offset + points->size());
+    Project(points->front().ptr(), points->size(), (*projected)[offset].ptr());
+}
+
+void BatchProjector::Project(const osg::Vec3Array* points, osg::Vec2Array* projected) const {
+
+    if(points->empty()) return;
+    size_t offset = projected->size();
+    projected->resize(offset + points->size());
+    Project(points->front().ptr(), points->size(), (*projected)[offset].ptr());
+}
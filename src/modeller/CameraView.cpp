@@ -0,0 +1,115 @@
+#include "CameraView.hpp"
+#include "../image/algorithms/GradientCache.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+CameraView::CameraView(const std::string& image_path, const std::shared_ptr<ProjectionParameters>& pp,
+                       const Eigen::Matrix3d& rotation, const Eigen::Vector3d& translation) :
+    m_image_path(image_path),
+    m_pp(pp),
+    m_rotation(rotation),
+    m_translation(translation) { }
+
+bool CameraView::Project(const Eigen::Vector3d& world, osg::Vec2d& projected) const {
+
+    // onto the near plane z = -near
+    Eigen::Vector3d pt = m_rotation * world + m_translation;
+    if(pt.z() >= 0.0) return false;
+    double s = -m_pp->near / pt.z();
+    projected.set(s * pt.x(), s * pt.y());
+    return true;
+}
+
+void CameraView::PixelToProjected(int x, int y, osg::Vec2d& projected) const {
+
+    // the rows of the gradient image are top down, the logical coordinates bottom up
+    osg::Vec2d logical(x, m_pp->height - y - 1);
+    m_pp->convert_from_logical_device_coordinates_to_projected_coordinates(logical, projected);
+}
+
+bool CameraView::ProjectedToPixel(const osg::Vec2d& projected, Point2D<int>& pixel) const {
+
+    osg::Vec2d logical;
+    m_pp->convert_from_projected_coordinates_to_logical_device_coordinates(projected, logical);
+    pixel.x = static_cast<int>(std::floor(logical.x() + 0.5));
+    pixel.y = m_pp->height - 1 - static_cast<int>(std::floor(logical.y() + 0.5));
+    return pixel.x >= 0 && pixel.y >= 0 && pixel.x < m_pp->width && pixel.y < m_pp->height;
+}
+
+bool CameraView::Prepare() {
+
+    if(IsPrepared()) return true;
+    OtbImageType::Pointer gimg = GradientCache::Instance().Load(m_image_path);
+    if(gimg.IsNull()) {
+        std::cout << "ERROR: Gradient image of the view cannot be loaded: " << m_image_path << std::endl;
+        return false;
+    }
+    OtbImageType::SizeType size = gimg->GetLargestPossibleRegion().GetSize();
+    if(static_cast<int>(size[0]) != m_pp->width || static_cast<int>(size[1]) != m_pp->height) {
+        std::cout << "ERROR: Image size differs from the calibration of the view: " << m_image_path << std::endl;
+        return false;
+    }
+    m_edge_map.Build(gimg->GetBufferPointer(), static_cast<int>(size[0]), static_cast<int>(size[1]));
+    return !m_edge_map.IsEmpty();
+}
+
+static std::string directory_of(const std::string& path) {
+
+    size_t pos = path.find_last_of('/');
+    return (pos == std::string::npos) ? std::string(".") : path.substr(0, pos);
+}
+
+bool ReadCameraViews(const std::string& path, double near, double far, std::vector<std::shared_ptr<CameraView>>& views) {
+
+    std::ifstream file(path);
+    if(!file.good()) {
+        std::cout << "ERROR: View file cannot be opened: " << path << std::endl;
+        return false;
+    }
+
+    // Step-1: the poses of the computer vision convention to the one of the scene, y up and -z forward
+    const Eigen::Matrix3d flip = Eigen::Vector3d(1.0, -1.0, -1.0).asDiagonal();
+    std::string dir = directory_of(path);
+    std::vector<std::shared_ptr<CameraView>> read;
+    std::string text;
+    for(int num = 1; std::getline(file, text); ++num) {
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string image;
+        if(!(line >> image)) continue;
+        int width = 0, height = 0;
+        double focal = 0.0;
+        Eigen::Matrix3d R;
+        Eigen::Vector3d t;
+        bool ok = static_cast<bool>(line >> width >> height >> focal);
+        for(int i = 0; ok && i < 9; ++i)
+            ok = static_cast<bool>(line >> R(i / 3, i % 3));
+        for(int i = 0; ok && i < 3; ++i)
+            ok = static_cast<bool>(line >> t[i]);
+        if(!ok || width <= 0 || height <= 0 || focal <= 0.0) {
+            std::cout << "ERROR: " << path << ":" << num << ": invalid view" << std::endl;
+            return false;
+        }
+        std::shared_ptr<ProjectionParameters> pp(new ProjectionParameters(ProjectionParameters::fovy_of_focal_length(focal, height), width, height, near, far));
+        if(image[0] != '/') image = dir + "/" + image;
+        read.push_back(std::make_shared<CameraView>(image, pp, flip * R, flip * t));
+    }
+    if(read.empty()) {
+        std::cout << "ERROR: " << path << ": no views" << std::endl;
+        return false;
+    }
+
+    // Step-2: the world frame becomes the camera frame of the reference view
+    Eigen::Matrix3d R0t = read.front()->GetRotation().transpose();
+    Eigen::Vector3d t0 = read.front()->GetTranslation();
+    views.clear();
+    for(const std::shared_ptr<CameraView>& view : read) {
+        Eigen::Matrix3d R = view->GetRotation() * R0t;
+        Eigen::Vector3d t = view->GetTranslation() - R * t0;
+        views.push_back(std::make_shared<CameraView>(view->GetImagePath(), view->GetProjectionParameters(), R, t));
+    }
+    return true;
+}
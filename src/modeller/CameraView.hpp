@@ -0,0 +1,66 @@
+#ifndef CAMERA_VIEW_HPP
+#define CAMERA_VIEW_HPP
+
+#include "ProjectionParameters.hpp"
+#include "../image/algorithms/Algorithms.hpp"
+#include "../image/algorithms/EdgeMap.hpp"
+#include <Eigen/Dense>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Calibrated oriented image of a multi-view session.
+ *
+ * The world frame is the camera frame of the reference view, the image being modelled, thus the
+ * components keep the coordinates of the single image modelling and the pose of the reference
+ * view is the identity. A point is mapped to the camera frame of the view by x_c = R x_w + t, the
+ * camera looks down -z as the main camera of the scene. The intrinsics are the projection
+ * parameters of the view, the field of view follows from the focal length (the principal point is
+ * the center of the image).
+ *
+ * The gradient image and the edge map are loaded on demand by Prepare, which may run on a worker.
+ */
+class CameraView {
+public:
+    CameraView(const std::string& image_path, const std::shared_ptr<ProjectionParameters>& pp,
+               const Eigen::Matrix3d& rotation, const Eigen::Vector3d& translation);
+
+    const std::string& GetImagePath() const { return m_image_path; }
+    const std::shared_ptr<ProjectionParameters>& GetProjectionParameters() const { return m_pp; }
+    const Eigen::Matrix3d& GetRotation() const { return m_rotation; }
+    const Eigen::Vector3d& GetTranslation() const { return m_translation; }
+    Eigen::Vector3d GetCameraCenter() const { return -m_rotation.transpose() * m_translation; }
+
+    // the point in projected coordinates of the view, false if it is not in front of the camera
+    bool Project(const Eigen::Vector3d& world, osg::Vec2d& projected) const;
+    // pixel of the gradient image <<->> projected coordinates of the view
+    void PixelToProjected(int x, int y, osg::Vec2d& projected) const;
+    bool ProjectedToPixel(const osg::Vec2d& projected, Point2D<int>& pixel) const;
+
+    // the gradient image from the cache (computed and cached if it is not there) and its edge map
+    bool Prepare();
+    bool IsPrepared() const { return !m_edge_map.IsEmpty(); }
+    const EdgeMap& GetEdgeMap() const { return m_edge_map; }
+
+private:
+    std::string m_image_path;
+    std::shared_ptr<ProjectionParameters> m_pp;
+    Eigen::Matrix3d m_rotation;
+    Eigen::Vector3d m_translation;
+    EdgeMap m_edge_map;
+};
+
+/*
+ * A view file (.cvmviews) is a line based text file, '#' starts a comment, one view per line:
+ *
+ *   <image> <width> <height> <focal length> <r00 r01 r02 r10 r11 r12 r20 r21 r22> <t0 t1 t2>
+ *
+ * with the image relative to the view file, the focal length in pixels and the world to camera pose
+ * x_c = R x_w + t of the computer vision convention (x right, y down, z forward), as the calibration
+ * and structure from motion tools write it. The first view is the reference view, the poses are
+ * converted to the camera frame (y up, -z forward) of the reference view.
+ */
+bool ReadCameraViews(const std::string& path, double near, double far, std::vector<std::shared_ptr<CameraView>>& views);
+
+#endif // CAMERA_VIEW_HPP
@@ -0,0 +1,47 @@
+#include "HeadlessView.hpp"
+#include "ProjectionParameters.hpp"
+#include "../geometry/Primitives.hpp"
+
+#include <osg/ValueObject>
+
+HeadlessView::HeadlessView(const ProjectionParameters& pp) :
+    m_camera(new osg::Camera),
+    m_model(new osg::Group),
+    m_drawing(new osg::Geode),
+    m_height(pp.height) {
+
+    m_camera->setViewport(0, 0, pp.width, pp.height);
+    m_camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    m_camera->setViewMatrix(osg::Matrixd::identity());
+    m_camera->setProjectionMatrixAsPerspective(pp.fovy, pp.aspect, pp.near, pp.far);
+    m_camera->addChild(m_model.get());
+}
+
+void HeadlessView::UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id) {
+
+    // the same user values as the components of an OsgWxFrame
+    node->setUserValue("Selection", false);
+    node->setUserValue("Selection_Box_Id", -1);
+    node->setUserValue("Component_Id", static_cast<int>(component_id));
+    m_model->addChild(node);
+}
+
+void HeadlessView::UsrDeviceToLogical(Point2D<int>& pt) const {
+    pt.y = m_height - pt.y - 1;
+}
+
+void HeadlessView::UsrDeviceToLogical(osg::Vec2d& p) const {
+    p.y() = m_height - p.y() - 1;
+}
+
+const osg::Camera* const HeadlessView::UsrGetMainCamera() const {
+    return m_camera.get();
+}
+
+osg::Group* HeadlessView::GetModel() {
+    return m_model.get();
+}
+
+osg::Geode* HeadlessView::GetDrawingNode() {
+    return m_drawing.get();
+}
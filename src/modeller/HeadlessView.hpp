@@ -0,0 +1,36 @@
+#ifndef HEADLESS_VIEW_HPP
+#define HEADLESS_VIEW_HPP
+
+#include "ModellerView.hpp"
+#include <osg/Geode>
+#include <osg/Group>
+
+struct ProjectionParameters;
+
+/*
+ * A view of the image without a window or a graphics context, for modelling in batch.
+ *
+ * The camera is set up as the main camera of an OsgWxFrame for the image (viewport of the image
+ * size, identity view, perspective of the projection parameters) but never rendered. The components
+ * are collected under the model group and the 2D drawings of the modeller under the drawing node.
+ */
+class HeadlessView : public ModellerView {
+public:
+    HeadlessView(const ProjectionParameters& pp);
+
+    void UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id) override;
+    void UsrDeviceToLogical(Point2D<int>& pt) const override;
+    void UsrDeviceToLogical(osg::Vec2d& p) const override;
+    const osg::Camera* const UsrGetMainCamera() const override;
+
+    osg::Group* GetModel();
+    osg::Geode* GetDrawingNode();
+
+private:
+    osg::ref_ptr<osg::Camera> m_camera;
+    osg::ref_ptr<osg::Group> m_model;
+    osg::ref_ptr<osg::Geode> m_drawing;
+    int m_height;
+};
+
+#endif // HEADLESS_VIEW_HPP
@@ -1,32 +1,71 @@
 #include "ImageModeller.hpp"
 #include "optimization/CircleEstimator.hpp"
 #include "optimization/ComponentSolver.hpp"
+#include "optimization/EllipseFitter.hpp"
 #include "optimization/ModelSolver.hpp"
+#include "optimization/MultiStartSearch.hpp"
+#include "BatchProjector.hpp"
+#include "ModelHistory.hpp"
+#include "ModellerView.hpp"
+#include "ProjectFile.hpp"
 #include "ProjectionParameters.hpp"
 #include "UIHelper.hpp"
+#include "components/Sphere.hpp"
 #include "../geometry/Circle3D.hpp"
+#include "../geometry/CurveSimplifier.hpp"
 #include "../geometry/Rectangle2D.hpp"
 #include "../geometry/Ellipse2D.hpp"
 #include "../geometry/Segment2D.hpp"
 #include "../geometry/Plane3D.hpp"
 #include "../geometry/Ray3D.hpp"
-#include "../osg/OsgWxGLCanvas.hpp"
+#include "../osg/CompactModel.hpp"
 #include "../osg/OsgUtility.hpp"
+#include "../utility/LatencyProbe.hpp"
+#include "../utility/Profiler.hpp"
+#include "../utility/ThreadPool.hpp"
 #include "../utility/Utility.hpp"
-#include "../wx/WxUtility.hpp"
 #include "../image/algorithms/Algorithms.hpp"
+#include "../image/algorithms/GradientCache.hpp"
 
-#include <osgDB/WriteFile>
 #include <otbImageFileReader.h>
-
-ImageModeller::ImageModeller(const wxString& fpath, const std::shared_ptr<ProjectionParameters>& pp, OsgWxGLCanvas* canvas) :
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <set>
+
+// continuous axis drawing: deviation of the drawn axis from its sections and their spacing, in pixels
+static const double axis_tolerance = 2.0;
+static const double min_axis_spacing = 8.0;
+static const double max_axis_spacing = 40.0;
+// direction aware snapping: deviation of the gradient from the profile ray, in radians, and the
+// gradient magnitude of an edge stopping the ray
+static const double snapping_orientation_tolerance = M_PI / 6.0;
+static const OtbImageType::PixelType snapping_strong_edge = 96;
+
+// sections per range of the parallel section estimation
+static const size_t parallel_sections_grain = 32;
+
+// the active generalized cylinder and its drawing before the first input of a gesture
+struct ImageModeller::section_gesture {
+    osg::ref_ptr<GeneralizedCylinder> gcyl;
+    SectionStore sections;
+    std::vector<Segment2D> segments;
+    std::vector<osg::Vec2d> axis_points;
+    Segment2D lsegment;
+};
+
+ImageModeller::ImageModeller(const std::string& fpath, const std::shared_ptr<ProjectionParameters>& pp, ModellerView* canvas) :
     m_pp(pp),
+    m_image_path(fpath),
     m_canvas(canvas),
     m_gcyl(nullptr),
     m_rect(nullptr),
     m_rtype(rendering_type::triangle_strip),
+    m_procedural_sweep(false),
     m_solver(new ModelSolver()),
     m_component_solver(new ComponentSolver(-pp->near)),
+    m_history(new ModelHistory),
     m_gcyl_dmode(gcyl_drawing_mode::mode_0),
     m_left_click(false),
     m_right_click(false),
@@ -44,38 +83,49 @@ ImageModeller::ImageModeller(const wxString& fpath, const std::shared_ptr<Projec
     m_circle_estimator(new CircleEstimator),
     m_display_raycast(false),
     m_symmetric_profile(false),
+    m_subpixel_snapping(false),
+    m_snapping_mode(profile_snapping_mode::gradient_maximum),
     m_raycast(nullptr),
     m_scale_factor(0.35),
     m_num_right_click(0),
+    m_axis_simplifier(new CurveSimplifier(axis_tolerance, min_axis_spacing, max_axis_spacing)),
     m_double_circle_drawing(false),
-    m_rgcc(false) {
-
-    std::string grad_img_path = utilityInsertAfter(fpath, wxT('.'), wxT("_grad"));
-    std::ifstream grad_file(grad_img_path);
-    if(grad_file.good()) {
-        m_gimage = LoadImage<OtbImageType>(grad_img_path);
+    m_multi_start(false),
+    m_fit_ellipses(false),
+    m_memory(memory_category::gradients),
+    m_rgcc(false),
+    m_cuboid_instances(std::make_shared<PrimitiveInstances>(primitive_kind::cuboid)),
+    m_sphere_instances(std::make_shared<PrimitiveInstances>(primitive_kind::sphere)) {
+
+    // the gradient image is set later by SetGradientImage if it is not cached yet
+    if(GradientCache::Instance().Lookup(fpath, m_gimage)) {
         std::cout << "INFO: Gradient image is loaded" << std::endl;
+        request_orientation();
+        request_edge_map();
+        report_memory();
     }
-    else {
-        OtbFloatVectorImageType::Pointer img = LoadImage<OtbFloatVectorImageType>(fpath.ToStdString());
-        m_gimage = GradientMagnitudeImage(img);
-        SaveImage<OtbImageType>(m_gimage, grad_img_path);
-        std::cout << "INFO: No gradient image! Gradient image is calculated and saved to the path: " << grad_img_path << std::endl;
-    }
+    else
+        m_gimage = nullptr;
 
-    OtbImageType::SizeType size = m_gimage->GetLargestPossibleRegion().GetSize();
-    m_rect = std::unique_ptr<Rectangle2D>(new Rectangle2D(0, 0, size[0] - 1, size[1] - 1));
+    m_rect = std::unique_ptr<Rectangle2D>(new Rectangle2D(0, 0, m_pp->width - 1, m_pp->height - 1));
     m_fixed_depth = -(m_pp->near + m_pp->far)/2.0;
 }
 
 ImageModeller::~ImageModeller() {
+
+    // the search solves with the component solver, its continuation is not called once cancelled
+    m_orientation_search.Cancel();
+    if(m_orientation_search.IsValid()) m_orientation_search.Wait();
+    m_orientation_job.Cancel();
+    m_edge_job.Cancel();
     delete m_last_circle;
     delete m_first_circle;
 }
 
-unsigned int ImageModeller::GenerateComponentId() {
+// shared by the modellers of the parallel batch jobs
+static std::atomic<unsigned int> component_id_source(0);
 
-    static unsigned int component_id_source = 0;
+unsigned int ImageModeller::GenerateComponentId() {
     return ++component_id_source;
 }
 
@@ -83,6 +133,118 @@ ModelSolver* ImageModeller::GetModelSolver() {
     return m_solver.get();
 }
 
+PrimitiveInstances* ImageModeller::GetPrimitiveInstances(primitive_kind kind) {
+    return (kind == primitive_kind::cuboid) ? m_cuboid_instances.get() : m_sphere_instances.get();
+}
+
+GeneralizedCylinder* ImageModeller::GetActiveComponent() {
+    return m_gcyl.get();
+}
+
+void ImageModeller::SetGradientImage(OtbImageType::Pointer gimg) {
+    m_gimage = gimg;
+    if(m_gimage.IsNotNull()) m_lazy_gradient.reset();
+
+    request_orientation();
+    reset_edge_map();
+    report_memory();
+}
+
+void ImageModeller::SetLazyGradientImage(std::shared_ptr<LazyGradientImage> gradient) {
+    m_lazy_gradient = gradient;
+}
+
+void ImageModeller::request_orientation() {
+
+    // the orientations are cached by GradientCache::Load, the entries cached before them and the
+    // gradient images of the projects are completed on the thread pool, without them until then
+    m_orientation_job.Cancel();
+    m_orientation_job.Reset();
+    set_orientation(nullptr);
+    if(m_gimage.IsNull()) return;
+    OtbImageType::Pointer orientation;
+    if(GradientCache::Instance().LookupOrientation(m_image_path, orientation)) {
+        set_orientation(orientation);
+        return;
+    }
+    std::string path = m_image_path;
+    m_orientation_job = ThreadPool::Instance().Submit([path](const CancellationToken&) {
+        return GradientCache::Instance().LoadOrientation(path);
+    });
+}
+
+void ImageModeller::update_orientation() {
+
+    // the job is not waited for, the profiles are snapped by the magnitude meanwhile
+    if(!m_orientation_job.IsValid() || !m_orientation_job.IsReady()) return;
+    OtbImageType::Pointer orientation = m_orientation_job.HasFailed() ? OtbImageType::Pointer() : m_orientation_job.Get();
+    m_orientation_job.Reset();
+    set_orientation(orientation);
+    if(m_gorientation.IsNotNull()) std::cout << "INFO: Gradient orientations are loaded" << std::endl;
+}
+
+void ImageModeller::set_orientation(OtbImageType::Pointer orientation) {
+
+    // the orientations of another gradient image, e.g. of a project of a resized image, are dropped
+    m_gorientation = orientation;
+    if(m_gorientation.IsNotNull() && (m_gimage.IsNull() ||
+       m_gorientation->GetLargestPossibleRegion().GetSize() != m_gimage->GetLargestPossibleRegion().GetSize())) {
+        std::cout << "WARNING: Gradient orientations do not match the gradient image, they are not used" << std::endl;
+        m_gorientation = nullptr;
+    }
+    report_memory();
+}
+
+void ImageModeller::reset_edge_map() {
+
+    // the job of the previous gradient image is dropped
+    m_edge_job.Cancel();
+    m_edge_job.Reset();
+    m_edge_map.reset();
+    request_edge_map();
+}
+
+void ImageModeller::request_edge_map() {
+
+    // the non-maximum suppression and the distance transform of the whole image only for the nearest
+    // edge snapping and the ellipse fitting, on the thread pool
+    if(m_gimage.IsNull() || m_edge_map || m_edge_job.IsValid()) return;
+    if(m_snapping_mode != profile_snapping_mode::nearest_edge && !m_fit_ellipses) return;
+    OtbImageType::Pointer gimg = m_gimage;
+    m_edge_job = ThreadPool::Instance().Submit([gimg](const CancellationToken&) {
+        OtbImageType::SizeType size = gimg->GetLargestPossibleRegion().GetSize();
+        std::shared_ptr<EdgeMap> edges = std::make_shared<EdgeMap>();
+        edges->Build(gimg->GetBufferPointer(), static_cast<int>(size[0]), static_cast<int>(size[1]));
+        return std::shared_ptr<const EdgeMap>(edges);
+    });
+}
+
+const EdgeMap* ImageModeller::get_edge_map() {
+
+    // the job is started once the mode is switched on, the first use waits for it if it is still running
+    request_edge_map();
+    if(!m_edge_map && m_edge_job.IsValid()) {
+        m_edge_map = m_edge_job.Get();
+        m_edge_job.Reset();
+        if(m_edge_map) std::cout << "INFO: Edge map is built with " << m_edge_map->GetNumEdgePixels() << " edge pixels" << std::endl;
+        report_memory();
+    }
+    return m_edge_map.get();
+}
+
+void ImageModeller::report_memory() {
+
+    // the tiles of the lazy gradient report themselves
+    size_t bytes = m_edge_map ? m_edge_map->GetByteSize() : 0;
+    if(m_gimage.IsNotNull())       bytes += m_gimage->GetPixelContainer()->Size() * sizeof(OtbImageType::PixelType);
+    if(m_gorientation.IsNotNull()) bytes += m_gorientation->GetPixelContainer()->Size() * sizeof(OtbImageType::PixelType);
+    m_memory.Set(bytes);
+}
+
+bool ImageModeller::HasGradientImage() const {
+    return m_gimage.IsNotNull();
+}
+
 void ImageModeller::Initialize2DDrawingInterface(osg::Geode* geode) {
     m_uihelper = std::unique_ptr<UIHelper>(new UIHelper(geode));
 }
@@ -93,29 +255,124 @@ void ImageModeller::SaveModel(const std::string& path) {
         std::cout << "ERROR: Generalized cylinder is not valid" << std::endl;
         return;
     }
-    osgDB::writeNodeFile(*m_gcyl, path);
+    write_model_file(*m_gcyl, path);
+}
+
+bool ImageModeller::SaveProject(const std::string& path) const {
+
+    ProjectFile::contents project;
+    project.image_path = m_image_path;
+    project.pp = m_pp.get();
+    std::vector<ComponentBase*> components;
+    m_solver->GetComponents(components);
+    for(ComponentBase* comp : components) {
+        const GeneralizedCylinder* gcyl = dynamic_cast<const GeneralizedCylinder*>(comp);
+        if(gcyl) project.components.push_back(gcyl);
+    }
+    m_solver->GetAllConstraints(project.constraints);
+    project.active_component = m_gcyl.valid() ? m_gcyl->GetComponentId() : 0;
+    if(m_gcyl.valid()) project.active_segments = m_segments;
+    project.gradient = m_gimage;
+    if(!ProjectFile::Write(path, project)) return false;
+    std::cout << "INFO: Project is saved with " << project.components.size() << " components and "
+              << project.constraints.size() << " constrained pairs" << std::endl;
+    return true;
+}
+
+void ImageModeller::RestoreProject(const ProjectFile& project) {
+
+    m_history->Clear();
+    std::vector<geosemcon> constraints;
+    project.GetConstraints(constraints);
+    for(const geosemcon& con : constraints)
+        m_solver->UpdateOrCreateConstraints(con.component_1, con.component_2, con.constraints);
+
+    // the components are added later, a component drawn in between gets an id after all of theirs
+    unsigned int max_id = 0;
+    for(size_t i = 0; i < project.GetNumberOfComponents(); ++i)
+        max_id = std::max(max_id, project.GetComponentId(i));
+    unsigned int last_id = component_id_source.load();
+    while(last_id < max_id && !component_id_source.compare_exchange_weak(last_id, max_id)) { }
+
+    // the gradient image of the project, if it is not in the cache of this machine, unless it is
+    // of another image: it is then computed again as for an image without a project
+    if(m_gimage.IsNull() && project.HasGradientImage()) {
+        OtbImageType::Pointer gimg = project.GetGradientImage();
+        OtbImageType::SizeType size = gimg->GetLargestPossibleRegion().GetSize();
+        if(static_cast<int>(size[0]) != m_pp->width || static_cast<int>(size[1]) != m_pp->height) {
+            std::cout << "WARNING: Gradient image of the project is " << size[0] << "x" << size[1] << " for an image of "
+                      << m_pp->width << "x" << m_pp->height << ", it is recomputed" << std::endl;
+        }
+        else {
+            std::cout << "INFO: Gradient image is loaded from the project" << std::endl;
+            SetGradientImage(gimg);
+        }
+    }
+}
+
+void ImageModeller::AddProjectComponent(const ProjectFile& project, size_t i) {
+
+    osg::ref_ptr<GeneralizedCylinder> gcyl = project.CreateComponent(i);
+    unsigned int id = gcyl->GetComponentId();
+    if(m_procedural_sweep) gcyl->SetProceduralSweep(true);
+    m_canvas->UsrAddSelectableNodeToDisplay(gcyl.get(), id);
+    m_solver->AddComponent(gcyl.get());
+
+    // the last sections of the active component can still be deleted
+    if(id == project.GetActiveComponentId()) {
+        m_gcyl = gcyl;
+        m_segments.clear();
+        project.GetActiveSegments(m_segments);
+    }
 }
 
 void ImageModeller::DeleteModel() {
+    m_cuboid = nullptr;
     m_solver->DeleteAllComponents();
+    m_component_solver->ForgetAllComponents();
+    m_history->Clear();
 }
 
 void ImageModeller::DeleteSelectedComopnents(std::vector<int>& index_vector) {
     m_solver->DeleteSelectedComponents(index_vector);
+    for(int i : index_vector)
+        m_component_solver->ForgetComponent(static_cast<unsigned int>(i));
 }
 
 void ImageModeller::SetRenderingType(rendering_type rtype) {
     m_rtype = rtype;
 }
 
+void ImageModeller::SetProceduralSweep(bool flag) {
+    m_procedural_sweep = flag;
+}
+
 void ImageModeller::SetSymmetricProfile(bool sym) {
     m_symmetric_profile = sym;
 }
 
+void ImageModeller::SetSubpixelSnapping(bool flag) {
+    m_subpixel_snapping = flag;
+}
+
+void ImageModeller::SetProfileSnappingMode(profile_snapping_mode mode) {
+    m_snapping_mode = mode;
+    request_edge_map();
+}
+
 void ImageModeller::SetDoubleCircleDrawingForLinaerAxisPrior(bool dc) {
     m_double_circle_drawing = dc;
 }
 
+void ImageModeller::SetMultiStartSolving(bool flag) {
+    m_multi_start = flag;
+}
+
+void ImageModeller::SetEllipseFitting(bool flag) {
+    m_fit_ellipses = flag;
+    request_edge_map();
+}
+
 void ImageModeller::SetRightGeneralizedCylinderConstraint(bool rgc) {
     m_rgcc = rgc;
 }
@@ -128,40 +385,6 @@ void ImageModeller::EnableRayCastDisplay(bool flag) {
     else                  m_raycast.release();
 }
 
-osg::Geode* ImageModeller::CreateLocalFramesNode() {
-
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-    osg::Vec3dArray* vertices = new osg::Vec3dArray;
-    // fill the vertices here
-    vertices->push_back(osg::Vec3d(0,0,-50));
-    vertices->push_back(osg::Vec3d(100,100,-50));
-    geom->setVertexArray(vertices);
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(osg::Vec4(1.0f, 0.0f, 0.0f, 1.0f));
-    geom->setColorArray(colors, osg::Array::BIND_OVERALL);
-    geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, 2));
-    geode->addDrawable(geom.get());
-    return geode.release();
-}
-
-osg::Geode* ImageModeller::CreateVertexNormalsNode() {
-
-    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-    osg::Vec3dArray* vertices = new osg::Vec3dArray;
-    // fill the vertices here
-    vertices->push_back(osg::Vec3d(0,0,-50));
-    vertices->push_back(osg::Vec3d(100,100,-50));
-    geom->setVertexArray(vertices);
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(osg::Vec4(1.0f, 0.0f, 0.0f, 1.0f));
-    geom->setColorArray(colors, osg::Array::BIND_OVERALL);
-    geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, 2));
-    geode->addDrawable(geom.get());
-    return geode.release();
-}
-
 void ImageModeller::DebugPrint() {
     m_solver->Print();
 }
@@ -178,11 +401,13 @@ void ImageModeller::EscapeKeyPressed() {
 
 void ImageModeller::reset_2d_drawing_interface() {
 
+    end_gesture();
     m_gcyl_dmode = gcyl_drawing_mode::mode_0;
     m_left_click = false;
     m_right_click = false;
     m_num_right_click = 0;
     m_segments.clear();
+    m_cuboid = nullptr;
     m_uihelper->Reset();
 }
 
@@ -199,9 +424,12 @@ void ImageModeller::reset_second_ellipse_drawing() {
 void ImageModeller::DeleteLastSection() {
 
     if(m_gcyl.valid()) {
-        m_gcyl->DeleteLastSection();
-        m_uihelper->DeleteLastAxisPoint();
-        m_segments.pop_back();
+        end_gesture();
+        edit_sections([this]() {
+            m_gcyl->DeleteLastSection();
+            m_uihelper->DeleteLastAxisPoint();
+            if(!m_segments.empty()) m_segments.pop_back();
+        });
         // think a method to update the m_lsegmet, etc..
     }
 }
@@ -210,7 +438,9 @@ void ImageModeller::OnLeftClick(double x, double y) {
 
     m_left_click = true;
     m_mouse.set(x,y);
+    begin_gesture();
     model_update();
+    end_gesture();
 }
 
 void ImageModeller::OnRightClick(double x, double y) {
@@ -218,7 +448,9 @@ void ImageModeller::OnRightClick(double x, double y) {
     if(m_gcyl_dmode == gcyl_drawing_mode::mode_3 || m_gcyl_dmode == gcyl_drawing_mode::mode_4) {
         m_right_click = true;
         m_mouse.set(x,y);
+        begin_gesture();
         model_update();
+        end_gesture();
     }
 }
 
@@ -226,10 +458,179 @@ void ImageModeller::OnMouseMove(double x, double y) {
 
     if(m_gcyl_dmode != gcyl_drawing_mode::mode_0) {
         m_mouse.set(x,y);
+        // only the continuous axis drawing adds sections while the mouse moves, the stroke up to the
+        // next click is one step of the history
+        if(m_gcyl_dmode == gcyl_drawing_mode::mode_3 && axis_dmode == axis_drawing_mode::continuous)
+            begin_gesture();
         model_update();
     }
 }
 
+void ImageModeller::edit_sections(const std::function<void()>& edit) {
+
+    // the edit is one step of the history, or a part of the open gesture
+    bool own = !m_gesture;
+    begin_gesture();
+    edit();
+    if(own) end_gesture();
+}
+
+void ImageModeller::begin_gesture() {
+
+    // the state of the active component before the first input, a new component is not recorded
+    if(m_gesture || !m_gcyl.valid()) return;
+    m_gesture.reset(new section_gesture);
+    m_gesture->gcyl = m_gcyl;
+    m_gesture->sections = m_gcyl->GetGeometry()->GetSections();
+    m_gesture->segments = m_segments;
+    m_uihelper->GetAxisPoints(m_gesture->axis_points);
+    m_gesture->lsegment = *m_lsegment;
+}
+
+void ImageModeller::end_gesture() {
+
+    if(!m_gesture) return;
+    std::unique_ptr<section_gesture> gesture(std::move(m_gesture));
+    if(m_gcyl == gesture->gcyl) record_sections(*gesture->gcyl, gesture->sections, gesture.get());
+}
+
+void ImageModeller::record_sections(const GeneralizedCylinder& gcyl, const SectionStore& before, const section_gesture* drawing) {
+
+    // Step-1: the delta, the closures find the component by its id
+    const SectionStore& after = gcyl.GetGeometry()->GetSections();
+    std::shared_ptr<SectionDelta> delta = std::make_shared<SectionDelta>(before, after);
+    if(delta->IsEmpty()) return;
+    const char* name = (after.size() > before.size()) ? "add section" :
+                       (after.size() < before.size()) ? "delete section" : "edit sections";
+    unsigned int id = gcyl.GetComponentId();
+    size_t size = delta->GetByteSize();
+
+    // Step-2: the axis segments and the drawn axis of the component, if it is being drawn
+    std::shared_ptr<TailDelta<Segment2D>> segments;
+    std::shared_ptr<TailDelta<osg::Vec2d>> axis_points;
+    std::pair<Segment2D, Segment2D> lsegment;
+    if(drawing) {
+        std::vector<osg::Vec2d> pts;
+        m_uihelper->GetAxisPoints(pts);
+        segments = std::make_shared<TailDelta<Segment2D>>(drawing->segments, m_segments);
+        axis_points = std::make_shared<TailDelta<osg::Vec2d>>(drawing->axis_points, pts);
+        lsegment = std::make_pair(drawing->lsegment, *m_lsegment);
+        size += segments->GetByteSize() + axis_points->GetByteSize();
+    }
+
+    auto apply = [this, id, delta, segments, axis_points, lsegment](bool forward) {
+        GeneralizedCylinder* component = find_generalized_cylinder(id);
+        if(!component) {
+            std::cout << "INFO: Component " << id << " has been deleted" << std::endl;
+            return;
+        }
+        component->UpdateSections(delta->Apply(component->GetGeometry()->GetSections(), forward));
+
+        // the segments are kept while the sections of the active component can be deleted, the axis while it is drawn
+        if(m_gcyl.get() != component || !segments) return;
+        segments->Apply(m_segments, forward);
+        std::vector<osg::Vec2d> pts;
+        m_uihelper->GetAxisPoints(pts);
+        if(m_gcyl_dmode == gcyl_drawing_mode::mode_3 && axis_points->Apply(pts, forward)) {
+            m_uihelper->SetAxisPoints(pts);
+            *m_lsegment = forward ? lsegment.second : lsegment.first;
+            m_axis_simplifier->Reset(m_lsegment->mid_point());
+        }
+    };
+    m_history->Record(name, [apply]() { apply(false); }, [apply]() { apply(true); }, size);
+}
+
+bool ImageModeller::ReplaceSections(unsigned int id, const SectionStore& sections) {
+
+    GeneralizedCylinder* gcyl = find_generalized_cylinder(id);
+    if(!gcyl) return false;
+    SectionStore before = gcyl->GetGeometry()->GetSections();
+    gcyl->GetGeometry()->GetSections() = sections;
+    gcyl->UpdateSections(0);
+    record_sections(*gcyl, before);
+    return true;
+}
+
+GeneralizedCylinder* ImageModeller::find_generalized_cylinder(unsigned int id) const {
+    return dynamic_cast<GeneralizedCylinder*>(m_solver->GetComponent(id));
+}
+
+void ImageModeller::SetConstraints(unsigned int cp1, unsigned int cp2, const std::vector<geosemantic_constraints>& gsc) {
+
+    std::vector<geosemantic_constraints> before;
+    m_solver->GetConstraints(cp1, cp2, before);
+    m_solver->UpdateOrCreateConstraints(cp1, cp2, gsc);
+    if(before == gsc) return;
+
+    // the constraints of a deleted component are not restored
+    auto apply = [this, cp1, cp2](const std::vector<geosemantic_constraints>& con) {
+        if(m_solver->GetComponent(cp1) && m_solver->GetComponent(cp2))
+            m_solver->UpdateOrCreateConstraints(cp1, cp2, con);
+    };
+    size_t size = (before.size() + gsc.size()) * sizeof(geosemantic_constraints);
+    m_history->Record("edit constraints", [apply, before]() { apply(before); }, [apply, gsc]() { apply(gsc); }, size);
+}
+
+void ImageModeller::AddConstraints(const std::vector<geosemcon>& relations) {
+
+    // Step-1: the constraints of each pair before and after
+    typedef std::vector<geosemcon> relation_list;
+    std::shared_ptr<relation_list> before = std::make_shared<relation_list>();
+    std::shared_ptr<relation_list> after = std::make_shared<relation_list>();
+    size_t size = 0;
+    for(const geosemcon& rel : relations) {
+        std::vector<geosemantic_constraints> gsc;
+        m_solver->GetConstraints(rel.component_1, rel.component_2, gsc);
+        std::vector<geosemantic_constraints> added = gsc;
+        for(geosemantic_constraints c : rel.constraints)
+            if(std::find(added.begin(), added.end(), c) == added.end()) added.push_back(c);
+        if(added == gsc) continue;
+        m_solver->UpdateOrCreateConstraints(rel.component_1, rel.component_2, added);
+        size += (gsc.size() + added.size()) * sizeof(geosemantic_constraints) + 2 * sizeof(geosemcon);
+        before->push_back(geosemcon(rel.component_1, rel.component_2, gsc));
+        after->push_back(geosemcon(rel.component_1, rel.component_2, added));
+    }
+    if(after->empty()) return;
+
+    // Step-2: one step of the history, the constraints of a deleted component are not restored
+    auto apply = [this](const relation_list& list) {
+        for(const geosemcon& rel : list)
+            if(m_solver->GetComponent(rel.component_1) && m_solver->GetComponent(rel.component_2))
+                m_solver->UpdateOrCreateConstraints(rel.component_1, rel.component_2, rel.constraints);
+    };
+    m_history->Record("add constraints", [apply, before]() { apply(*before); }, [apply, after]() { apply(*after); }, size);
+}
+
+void ImageModeller::RecordComponentTransforms(const std::vector<std::pair<unsigned int, osg::Matrixd>>& transforms) {
+
+    if(transforms.empty()) return;
+    typedef std::vector<std::pair<unsigned int, osg::Matrixd>> transform_list;
+    std::shared_ptr<transform_list> forward = std::make_shared<transform_list>(transforms);
+    auto apply = [this, forward](bool inverse) {
+        for(const auto& item : *forward) {
+            ComponentBase* component = m_solver->GetComponent(item.first);
+            if(component) component->ApplyTransform(inverse ? osg::Matrixd::inverse(item.second) : item.second);
+        }
+    };
+    m_history->Record("solve constraints", [apply]() { apply(true); }, [apply]() { apply(false); },
+                      transforms.size() * sizeof(transform_list::value_type));
+}
+
+bool ImageModeller::Undo() {
+
+    // the axis drawing steps back with the sections, the other drawings are ended
+    end_gesture();
+    if(m_gcyl_dmode != gcyl_drawing_mode::mode_0 && m_gcyl_dmode != gcyl_drawing_mode::mode_3) reset_2d_drawing_interface();
+    return m_history->Undo();
+}
+
+bool ImageModeller::Redo() {
+
+    end_gesture();
+    if(m_gcyl_dmode != gcyl_drawing_mode::mode_0 && m_gcyl_dmode != gcyl_drawing_mode::mode_3) reset_2d_drawing_interface();
+    return m_history->Redo();
+}
+
 void ImageModeller::IncrementScaleFactor() {
 
     if(m_scale_factor < 0.1)    m_scale_factor += 0.01;
@@ -247,8 +648,82 @@ void ImageModeller::DecrementScaleFactor() {
 // Execution of the modelling process is done within this function.
 void ImageModeller::model_update() {
 
+    LatencyProbe::Scope probe(latency_stage::model_update, "ImageModeller::model_update");
     if(comp_type == component_type::generalized_cylinder) model_generalized_cylinder();
-    else                                                  std::cout << "Component type is unknown" << std::endl;
+    else                                                  model_primitive();
+}
+
+osg::Vec3d ImageModeller::back_project_at_fixed_depth(const osg::Vec2d& pt) const {
+
+    osg::Vec2d prj;
+    m_pp->convert_from_logical_device_coordinates_to_projected_coordinates(pt, prj);
+    return osg::Vec3d(prj.x(), prj.y(), -m_pp->near) * (m_fixed_depth / -m_pp->near);
+}
+
+/*
+ * The primitives are drawn on the plane of the fixed depth. A sphere is its center and a point of
+ * its outline. A cuboid is the segment of its axis, then its width follows the mouse until the third
+ * click; its depth is its width.
+ */
+void ImageModeller::model_primitive() {
+
+    if(m_gcyl_dmode == gcyl_drawing_mode::mode_0) {
+        if(m_left_click) {
+            m_left_click = false;
+            m_primitive_points[0] = m_mouse;
+            m_uihelper->InitializeMajorAxisDrawing(m_mouse);
+            m_gcyl_dmode = gcyl_drawing_mode::mode_1;
+        }
+    }
+    else if(m_gcyl_dmode == gcyl_drawing_mode::mode_1) {
+        if(!m_left_click) {
+            m_uihelper->Updatep1(m_mouse);
+            return;
+        }
+        m_left_click = false;
+        m_primitive_points[1] = m_mouse;
+        if((m_primitive_points[1] - m_primitive_points[0]).length() < 1.0) return;
+
+        if(comp_type == component_type::sphere) {
+            osg::Vec3d center = back_project_at_fixed_depth(m_primitive_points[0]);
+            double radius = (back_project_at_fixed_depth(m_primitive_points[1]) - center).length();
+            osg::ref_ptr<Sphere> sphere = new Sphere(GenerateComponentId(), m_sphere_instances, center, radius);
+            m_canvas->UsrAddSelectableNodeToDisplay(sphere.get(), sphere->GetComponentId());
+            m_solver->AddComponent(sphere.get());
+            reset_2d_drawing_interface();
+            return;
+        }
+        m_uihelper->InitializeMinorAxisDrawing(m_mouse);
+        m_cuboid = new Cuboid(GenerateComponentId(), m_cuboid_instances, osg::Vec3d(), osg::Vec3d(1.0, 1.0, 1.0), osg::Quat());
+        update_cuboid();
+        m_canvas->UsrAddSelectableNodeToDisplay(m_cuboid.get(), m_cuboid->GetComponentId());
+        m_solver->AddComponent(m_cuboid.get());
+        m_gcyl_dmode = gcyl_drawing_mode::mode_2;
+    }
+    else if(m_gcyl_dmode == gcyl_drawing_mode::mode_2) {
+        if(m_cuboid.valid()) update_cuboid();
+        if(m_left_click) reset_2d_drawing_interface();
+    }
+}
+
+void ImageModeller::update_cuboid() {
+
+    // Step-1: the axis is the z axis of the cuboid, its x axis is on the plane of the fixed depth
+    osg::Vec3d p0 = back_project_at_fixed_depth(m_primitive_points[0]);
+    osg::Vec3d p1 = back_project_at_fixed_depth(m_primitive_points[1]);
+    osg::Vec3d z = p1 - p0;
+    double half_length = 0.5 * z.normalize();
+    osg::Vec3d x(-z.y(), z.x(), 0.0);
+    osg::Vec3d y = z ^ x;
+
+    // Step-2: the half width is the distance of the mouse to the axis, at least half a pixel
+    double half_width = std::fabs((back_project_at_fixed_depth(m_mouse) - p0) * x);
+    half_width = std::max(half_width, half_length / (m_primitive_points[1] - m_primitive_points[0]).length());
+    osg::Matrixd rotation(x.x(), x.y(), x.z(), 0.0,
+                          y.x(), y.y(), y.z(), 0.0,
+                          z.x(), z.y(), z.z(), 0.0,
+                          0.0, 0.0, 0.0, 1.0);
+    m_cuboid->Set((p0 + p1) * 0.5, osg::Vec3d(half_width, half_width, half_length), rotation.getRotate());
 }
 
 void ImageModeller::model_generalized_cylinder() {
@@ -292,6 +767,8 @@ void ImageModeller::model_generalized_cylinder() {
         if(m_left_click) {
             // third click: base ellipse (m_first_ellipse) has been determined.
             m_left_click = false;
+            if(fit_ellipse_to_edges(m_first_ellipse))
+                m_uihelper->UpdateEllipse(m_first_ellipse);
             initialize_axis_drawing_mode(projection_type::perspective);
             m_uihelper->InitializeAxisDrawing(m_first_ellipse);
             m_gcyl_dmode = gcyl_drawing_mode::mode_3;
@@ -327,6 +804,7 @@ void ImageModeller::model_generalized_cylinder() {
             }
             else if(m_num_right_click == 3) {
                 calculate_ellipse(m_final_ellipse);
+                fit_ellipse_to_edges(m_final_ellipse);
                 m_uihelper->UpdateEllipse(m_final_ellipse, false);
                 compute_generalized_cylinder();
                 reset_2d_drawing_interface();
@@ -354,14 +832,7 @@ void ImageModeller::operate_piecewise_linear_axis_drawing_mode() {
         m_left_click = false;                              // toggle the flag
         *m_lsegment = *m_dsegment;                         // update the last segment
         m_uihelper->AddAxisPoint(m_dsegment->mid_point()); // update the user interface
-
-        if(ax_constraints == axis_constraints::linear && !m_double_circle_drawing) {
-            add_planar_section_to_the_straight_generalized_cylinder_under_perspective_projection();
-        }
-        else {
-            // add_planar_section_to_the_generalized_cylinder_under_perspective_projection();
-            add_planar_section_to_the_generalized_cylinder_under_orthographic_projection();
-        }
+        add_planar_section_at_the_axis_point();
     }
     else if(m_right_click) {
         m_right_click = false;
@@ -396,7 +867,62 @@ void ImageModeller::operate_piecewise_linear_axis_drawing_mode() {
 }
 
 void ImageModeller::operate_continuous_axis_drawing_mode() {
-    std::cout << "Continuous mode is not implemented yet!" << std::endl;
+
+    // the mouse samples are simplified while they stream in, a section is estimated only at the
+    // retained axis points instead of at every mouse event
+    osg::Vec2d pt;
+    if(m_left_click) { // a left click keeps the current point, e.g. at a corner of the axis
+
+        m_left_click = false;
+        if(m_axis_simplifier->Add(m_mouse, pt)) add_continuous_axis_point(pt);
+        if(m_axis_simplifier->Flush(pt))        add_continuous_axis_point(pt);
+    }
+    else if(m_right_click) { // right click ends the axis at the current point
+
+        m_right_click = false;
+        if(m_axis_simplifier->Add(m_mouse, pt)) add_continuous_axis_point(pt);
+        if(m_axis_simplifier->Flush(pt))        add_continuous_axis_point(pt);
+
+        if(ax_constraints == axis_constraints::planar ||
+           (ax_constraints == axis_constraints::linear && m_double_circle_drawing)) {
+            m_gcyl_dmode = gcyl_drawing_mode::mode_4;
+            m_uihelper->ResetSweepCurve();
+            if(m_display_raycast)
+                m_uihelper->ResetRayCastDisplay();
+        }
+        else {
+            reset_2d_drawing_interface();
+        }
+    }
+    else {
+        if(m_axis_simplifier->Add(m_mouse, pt)) add_continuous_axis_point(pt);
+        update_dynamic_segment();
+        m_uihelper->UpdateSweepCurve(m_dsegment);
+        m_uihelper->AxisPointCandidate(m_dsegment->mid_point());
+    }
+}
+
+void ImageModeller::add_continuous_axis_point(const osg::Vec2d& pt) {
+
+    // the dynamic segment of the retained sample, the mouse has already moved on
+    osg::Vec2d mouse = m_mouse;
+    m_mouse = pt;
+    update_dynamic_segment();
+    *m_lsegment = *m_dsegment;
+    m_uihelper->AddAxisPoint(m_dsegment->mid_point());
+    add_planar_section_at_the_axis_point();
+    m_mouse = mouse;
+}
+
+void ImageModeller::add_planar_section_at_the_axis_point() {
+
+    if(ax_constraints == axis_constraints::linear && !m_double_circle_drawing) {
+        add_planar_section_to_the_straight_generalized_cylinder_under_perspective_projection();
+    }
+    else {
+        // add_planar_section_to_the_generalized_cylinder_under_perspective_projection();
+        add_planar_section_to_the_generalized_cylinder_under_orthographic_projection();
+    }
 }
 
 void ImageModeller::estimate_first_circle_under_persective_projection() {
@@ -410,7 +936,10 @@ void ImageModeller::estimate_first_circle_under_persective_projection() {
     else if (count == 1) *m_first_circle = circles[0];
     else                  std::cout << "ERROR: Perspective 3D circle estimation error " << std::endl;
 
-    // 3) copy the first circle to the last circle
+    // 3) Refine the circle against all the edge points around the ellipse
+    if(count > 0) refine_circle_to_edges(m_first_ellipse, *m_first_circle);
+
+    // 4) copy the first circle to the last circle
     *m_last_circle = *m_first_circle;
 }
 
@@ -425,6 +954,7 @@ void ImageModeller::estimate_first_circle_under_orthographic_projection() {
 
 void ImageModeller::estimate_first_circle_under_orthogonality_constraint() {
 
+    Profiler::Scope scope("CircleEstimator::orthogonality_constraint");
     Circle3D circles[2];
     Ellipse2D elp_prj;
     m_pp->convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(*m_first_ellipse, elp_prj);
@@ -446,9 +976,12 @@ void ImageModeller::compute_generalized_cylinder() {
     int count = estimate_3d_circles_with_fixed_depth(m_final_ellipse, circles, m_fixed_depth);
 
     Circle3D final_circle;
+    executor_type executor;             // of the multi-start search, if it runs in the background
+    SectionStore before;                // the sections before the straightening, for the search
     // 2) Select one of the two estimated circles based on how the user drew the ellipse
     if(count == 2) final_circle = circles[select_correctly_oriented_3d_circle(circles, m_final_ellipse->points[2])];
     else           final_circle = circles[0];
+    refine_circle_to_edges(m_final_ellipse, final_circle);
 
     if(ax_constraints == axis_constraints::planar) {
 
@@ -457,79 +990,109 @@ void ImageModeller::compute_generalized_cylinder() {
         n.normalize();
         Plane3D main_axis_plane(n, m_first_circle->center);
 
-        // update the sections
-        std::vector<Circle3D>& sections = m_gcyl->GetGeometry()->GetSections();
-        for(int i = 1; i < sections.size(); ++i) {
-            // update the normal
-            sections[i].normal = sections[i].normal - sections[i].normal.dot(n) * n;
-            // sections[i].normal[2] = (-n[0]*sections[i].normal[0] - n[1]*sections[i].normal[1]) / n[2];
-            sections[i].normal.normalize();
-
-            m_circle_estimator->estimate_unit_3d_circle_from_major_axis(m_segments[i], -m_pp->near, sections[i]);
-            double factor =  (- main_axis_plane.get_plane().w()) / (n.dot(sections[i].center));
-            sections[i].center *= factor;
-            sections[i].radius *= factor;
-        }
-
-        if(m_rgcc) {
-
-            for(int i = 1; i < sections.size(); ++i) {
-                // update the normal
-                sections[i].normal = sections[i-1].center - sections[i].center;
-                sections[i].normal.normalize();
-                if(sections[i].normal.dot(sections[i-1].normal) < 0)
-                    sections[i].normal *= -1;
-
-                m_circle_estimator->estimate_unit_3d_circle_from_major_axis(m_segments[i], -m_pp->near, sections[i]);
-                double factor =  (- main_axis_plane.get_plane().w()) / (n.dot(sections[i].center));
-                sections[i].center *= factor;
-                sections[i].radius *= factor;
-            }
-
-            m_gcyl->Recalculate();
-        }
-
+        // update the sections, the geometry is rebuilt once
+        compute_planar_axis_sections(n, -main_axis_plane.get_plane().w());
         m_gcyl->Recalculate();
 
         // scale the last circle so that it's center lies on the computed plane
         double scale = m_first_circle->center.dot(n) / final_circle.center.dot(n);
         final_circle.radius *= scale;
         final_circle.center *= scale;
-        if(final_circle.normal.dot(sections.back().normal) < 0)
+        if(final_circle.normal.dot(m_gcyl->GetGeometry()->GetSections().back().normal) < 0)
             final_circle.normal *= -1;
 
     }
     else if(ax_constraints == axis_constraints::linear && m_double_circle_drawing) {
 
-        m_component_solver->SolveDepth(*m_first_circle, final_circle);
+        // the interactive view shows the selected orientations until the multi-start search is done, the batch waits for it
+        if(m_multi_start && count == 2) executor = m_canvas->UsrGetModellingExecutor();
+        if(m_multi_start && count == 2 && !executor) solve_circle_orientations(circles, final_circle);
+        else                                         m_component_solver->SolveDepth(*m_first_circle, final_circle);
+        if(executor) before = m_gcyl->GetGeometry()->GetSections();
+        straighten_linear_axis(*m_first_circle, final_circle);
+    }
 
-        Eigen::Vector3d vec = m_first_circle->center - final_circle.center;
-        Eigen::MatrixXd A = Eigen::MatrixXd(3, 2);
-        Eigen::Vector2d sol;
-        A(0,1) = vec[0];
-        A(1,1) = vec[1];
-        A(2,1) = vec[2];
+    m_gcyl->AddPlanarSection(final_circle);
+    m_gcyl->Update();
 
-        vec.normalize();
-        if(vec.dot(m_first_circle->normal) < 0) vec *= -1;
+    // the scales of the sections follow the radius profile of the section constraint
+    if(sc_constraints != section_constraints::none)
+        m_component_solver->SolveGeneralizedCylinder(m_gcyl.get(), sc_constraints);
+    if(executor) start_orientation_search(circles, before, executor);
+}
 
-        std::vector<Circle3D>& sections = m_gcyl->GetGeometry()->GetSections();
-        for(int i = 1; i < sections.size(); ++i) {
+void ImageModeller::straighten_linear_axis(const Circle3D& first_circle, const Circle3D& final_circle) {
 
-            A(0,0) = sections[i].center[0];
-            A(1,0) = sections[i].center[1];
-            A(2,0) = sections[i].center[2];
-            sol = A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(m_first_circle->center);
-            std::cout << "sol[0]: " << sol[0] << std::endl;
+    Eigen::Vector3d vec = first_circle.center - final_circle.center;
+    Eigen::MatrixXd A = Eigen::MatrixXd(3, 2);
+    A(0,1) = vec[0];
+    A(1,1) = vec[1];
+    A(2,1) = vec[2];
+
+    vec.normalize();
+    if(vec.dot(first_circle.normal) < 0) vec *= -1;
+
+    // the sections are independent, every range solves with its own matrix
+    SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
+    const Eigen::Vector3d first_center = first_circle.center;
+    ThreadPool::Instance().ParallelFor(1, sections.size(), parallel_sections_grain, [&](size_t begin, size_t end) {
+        Eigen::MatrixXd B = A;
+        for(size_t i = begin; i < end; ++i) {
+            B(0,0) = sections[i].center[0];
+            B(1,0) = sections[i].center[1];
+            B(2,0) = sections[i].center[2];
+            Eigen::Vector2d sol = B.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(first_center);
             sections[i].center *= sol[0];
             sections[i].radius *= sol[0];
             sections[i].normal = vec;
         }
-        m_gcyl->Recalculate();
-    }
+    });
+    m_gcyl->Recalculate();
+}
 
-    m_gcyl->AddPlanarSection(final_circle);
-    m_gcyl->Update();
+void ImageModeller::compute_planar_axis_sections(const Eigen::Vector3d& n, double depth) {
+
+    // A section is moved onto the plane of the axis: its normal is projected onto the plane, the
+    // circle is estimated from its major axis and scaled to the plane. The sections are independent,
+    // they are estimated in parallel. Under the right generalized cylinder constraint the normal is
+    // then the direction from the center of the previous section, final already, to that center, and
+    // the section is estimated once more: that pass depends on the previous sections and is sequential.
+    // The plane of the axis is n.x = depth.
+    SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
+    const double near = -m_pp->near;
+    CircleEstimator* estimator = m_circle_estimator.get();
+    const std::vector<Segment2D>& segments = m_segments;
+
+    // Step-1: normal in the plane of the axis, every index written by one range only
+    ThreadPool::Instance().ParallelFor(1, sections.size(), parallel_sections_grain, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+            Circle3D section = sections[i];
+            section.normal = section.normal - section.normal.dot(n) * n;
+            section.normal.normalize();
+            estimator->estimate_unit_3d_circle_from_major_axis(segments[i], near, section);
+            double factor = depth / n.dot(section.center);
+            section.center *= factor;
+            section.radius *= factor;
+            sections[i] = section;
+        }
+    });
+
+    // Step-2: normal along the axis
+    if(!m_rgcc) return;
+    for(size_t i = 1; i < sections.size(); ++i) {
+        Circle3D section = sections[i];
+        const Circle3D previous = sections[i - 1];
+        section.normal = previous.center - section.center;
+        section.normal.normalize();
+        if(section.normal.dot(previous.normal) < 0)
+            section.normal *= -1;
+
+        estimator->estimate_unit_3d_circle_from_major_axis(segments[i], near, section);
+        double factor = depth / n.dot(section.center);
+        section.center *= factor;
+        section.radius *= factor;
+        sections[i] = section;
+    }
 }
 
 void ImageModeller::add_planar_section_to_the_generalized_cylinder_under_perspective_projection() {
@@ -538,7 +1101,7 @@ void ImageModeller::add_planar_section_to_the_generalized_cylinder_under_perspec
     m_last_circle->normal[0] = m_tvec.x();
     m_last_circle->normal[1] = m_tvec.y();
     m_last_circle->normal[2] = 0;
-    const std::vector<Circle3D>& sections = m_gcyl->GetGeometry()->GetSections();
+    const SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
     if(m_last_circle->normal.dot(sections.back().normal) < 0) m_last_circle->normal *= -1;
 
     // set the depth of the last circle
@@ -603,7 +1166,7 @@ void ImageModeller::add_planar_section_to_the_generalized_cylinder_under_orthogr
     m_last_circle->normal[0] = m_tvec.x();
     m_last_circle->normal[1] = m_tvec.y();
     m_last_circle->normal[2] = 0;
-    std::vector<Circle3D>& sections = m_gcyl->GetGeometry()->GetSections();
+    SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
     if(m_last_circle->normal.dot(sections.back().normal) < 0)
         m_last_circle->normal *= -1;
 
@@ -630,7 +1193,7 @@ void ImageModeller::add_planar_section_to_the_generalized_cylinder_under_orthogo
     m_pp->convert_segment_from_logical_device_coordinates_to_projected_coordinates(*m_lsegment, seg);
     m_segments.push_back(seg);
 
-    std::vector<Circle3D>& sections = m_gcyl->GetGeometry()->GetSections();
+    SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
     if(sections.size() == 1) {
 
         Circle3D circles[2];
@@ -692,8 +1255,13 @@ void ImageModeller::initialize_axis_drawing_mode(projection_type pt) {
         estimate_first_circle_under_orthogonality_constraint();
     }
 
+    // the continuous axis starts at the center of the base ellipse
+    m_axis_simplifier->Reset(m_lsegment->mid_point());
+
     m_gcyl = new GeneralizedCylinder(GenerateComponentId(), *m_first_circle, m_rtype);
+    if(m_procedural_sweep) m_gcyl->SetProceduralSweep(true);
     m_canvas->UsrAddSelectableNodeToDisplay(m_gcyl.get(), m_gcyl->GetComponentId());
+    m_solver->AddComponent(m_gcyl.get());
 }
 
 void ImageModeller::calculate_ellipse(std::unique_ptr<Ellipse2D>& ellipse) {
@@ -720,6 +1288,96 @@ void ImageModeller::calculate_ellipse(std::unique_ptr<Ellipse2D>& ellipse) {
     }
 }
 
+bool ImageModeller::fit_ellipse_to_edges(std::unique_ptr<Ellipse2D>& ellipse) {
+
+    Profiler::Scope scope("ImageModeller::fit_ellipse_to_edges");
+    if(!m_fit_ellipses || get_edge_map() == nullptr || m_edge_map->IsEmpty()) return false;
+
+    // Step-1: the nearest edges of the points of the drawn ellipse, within a band around it
+    double band = std::max(3.0, 0.25 * ellipse->smn_axis);
+    std::vector<osg::Vec2d> edge_points;
+    collect_edge_points(*ellipse, band, edge_points);
+
+    // Step-2: robust conic fit
+    EllipseFitter fitter;
+    double coeff[6];
+    Ellipse2D fitted(*ellipse);
+    if(!fitter.Fit(edge_points, coeff) || !EllipseFitter::ConicToEllipse(coeff, fitted)) {
+        std::cout << "INFO: Drawn ellipse is kept" << std::endl;
+        return false;
+    }
+
+    // Step-3: the fit must stay close to the drawn ellipse
+    if((fitted.center - ellipse->center).length() > band ||
+       std::abs(fitted.smj_axis - ellipse->smj_axis) > band ||
+       std::abs(fitted.smn_axis - ellipse->smn_axis) > band) {
+        std::cout << "INFO: Fitted ellipse is too far from the drawn ellipse, drawn ellipse is kept" << std::endl;
+        return false;
+    }
+
+    // Step-4: the end points keep the order of the drawn ones, points[2] is the orientation cue of the circle estimation
+    fitted.calculate_axes_end_points();
+    if((fitted.points[0] - ellipse->points[0]).length2() > (fitted.points[1] - ellipse->points[0]).length2())
+        std::swap(fitted.points[0], fitted.points[1]);
+    if((fitted.points[2] - ellipse->points[2]).length2() > (fitted.points[3] - ellipse->points[2]).length2())
+        std::swap(fitted.points[2], fitted.points[3]);
+    osg::Vec2d vec_mj = fitted.points[1] - fitted.points[0];
+    fitted.rot_angle = std::atan2(vec_mj.y(), vec_mj.x());
+    fitted.calculate_coefficients_from_parameters();
+    *ellipse = fitted;
+
+    std::cout << "INFO: Ellipse is fitted to " << fitter.GetNumberOfInliers() << " of " << edge_points.size()
+              << " edge points in " << fitter.GetNumberOfIterations() << " iterations" << std::endl;
+    return true;
+}
+
+void ImageModeller::collect_edge_points(const Ellipse2D& ellipse, double band, std::vector<osg::Vec2d>& edge_points) {
+
+    const int num_samples = 360;
+    double c = std::cos(ellipse.rot_angle), s = std::sin(ellipse.rot_angle);
+    std::set<std::pair<int, int>> visited;
+    for(int i = 0; i < num_samples; ++i) {
+        double t = TWO_PI * i / num_samples;
+        double x = ellipse.smj_axis * std::cos(t), y = ellipse.smn_axis * std::sin(t);
+        Point2D<int> p(static_cast<int>(ellipse.center.x() + c * x - s * y),
+                       static_cast<int>(ellipse.center.y() + s * x + c * y));
+        m_canvas->UsrDeviceToLogical(p);                            // convert to pixel coordinates
+        if(p.x < 0 || p.y < 0 || p.x >= m_edge_map->GetWidth() || p.y >= m_edge_map->GetHeight()) continue;
+        Point2D<int> edge;
+        if(!m_edge_map->NearestEdge(p.x, p.y, edge) || m_edge_map->DistanceToEdge(p.x, p.y) > band) continue;
+        if(!visited.insert(std::make_pair(edge.x, edge.y)).second) continue;
+        osg::Vec2d pt(edge.x, edge.y);
+        m_canvas->UsrDeviceToLogical(pt);                           // convert back to logical coordinates
+        edge_points.push_back(pt);
+    }
+}
+
+bool ImageModeller::refine_circle_to_edges(const std::unique_ptr<Ellipse2D>& ellipse, Circle3D& circle) {
+
+    Profiler::Scope scope("ImageModeller::refine_circle_to_edges");
+    if(!m_fit_ellipses || get_edge_map() == nullptr || m_edge_map->IsEmpty()) return false;
+
+    // Step-1: the edge points around the (fitted) ellipse, in projected coordinates
+    std::vector<osg::Vec2d> edge_points;
+    collect_edge_points(*ellipse, std::max(3.0, 0.25 * ellipse->smn_axis), edge_points);
+    m_pp->convert_from_logical_device_coordinates_to_projected_coordinates(edge_points.data(), edge_points.data(), edge_points.size());
+
+    // Step-2: the outliers are the points more than two pixels away from the projection of the circle
+    osg::Vec2d p0, p1;
+    m_pp->convert_from_logical_device_coordinates_to_projected_coordinates(osg::Vec2d(0.0, 0.0), p0);
+    m_pp->convert_from_logical_device_coordinates_to_projected_coordinates(osg::Vec2d(1.0, 0.0), p1);
+    Circle3D refined(circle);
+    if(!m_component_solver->RefineCircleToEdges(edge_points, 2.0 * (p1 - p0).length(), refined)) {
+        std::cout << "INFO: Circle is not refined to the edges" << std::endl;
+        return false;
+    }
+
+    // Step-3: keep the orientation of the estimated circle
+    if(refined.normal.dot(circle.normal) < 0) refined.normal *= -1;
+    circle = refined;
+    return true;
+}
+
 void ImageModeller::update_dynamic_segment() {
 
     // copy the last segment into the dynamic segment
@@ -755,6 +1413,7 @@ void ImageModeller::update_dynamic_segment() {
 
 int ImageModeller::estimate_3d_circles_with_fixed_radius(std::unique_ptr<Ellipse2D>& ellipse, Circle3D* circles, double desired_radius) {
 
+    Profiler::Scope scope("CircleEstimator::fixed_radius");
     Ellipse2D elp_prj;
     m_pp->convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(*ellipse, elp_prj);
     return m_circle_estimator->estimate_3d_circles_with_fixed_radius(elp_prj, circles, m_pp.get(), desired_radius);
@@ -762,6 +1421,7 @@ int ImageModeller::estimate_3d_circles_with_fixed_radius(std::unique_ptr<Ellipse
 
 int ImageModeller::estimate_3d_circles_with_fixed_depth(std::unique_ptr<Ellipse2D>& ellipse, Circle3D* circles, double desired_depth) {
 
+    Profiler::Scope scope("CircleEstimator::fixed_depth");
     Ellipse2D elp_prj;
     m_pp->convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(*ellipse, elp_prj);
     return m_circle_estimator->estimate_3d_circles_with_fixed_depth(elp_prj, circles, m_pp.get(), desired_depth);
@@ -769,6 +1429,7 @@ int ImageModeller::estimate_3d_circles_with_fixed_depth(std::unique_ptr<Ellipse2
 
 int ImageModeller::estimate_unit_3d_circles(std::unique_ptr<Ellipse2D>& ellipse, Circle3D* circles) {
 
+    Profiler::Scope scope("CircleEstimator::unit_circles");
     Ellipse2D elp_prj;
     m_pp->convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(*ellipse, elp_prj);
     return m_circle_estimator->estimate_unit_3d_circles(elp_prj, circles, m_pp.get());
@@ -776,6 +1437,7 @@ int ImageModeller::estimate_unit_3d_circles(std::unique_ptr<Ellipse2D>& ellipse,
 
 void ImageModeller::estimate_3d_circle_under_orthographic_projection(std::unique_ptr<Ellipse2D>& ellipse, Circle3D& circle) {
 
+    Profiler::Scope scope("CircleEstimator::orthographic");
     Ellipse2D elp_prj;
     m_pp->convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(*ellipse, elp_prj);
     m_circle_estimator->estimate_3d_circles_under_orthographic_projection(elp_prj, circle, -m_pp->near);
@@ -810,14 +1472,152 @@ size_t ImageModeller::select_correctly_oriented_3d_circle(const Circle3D* const
     return (vec1.dot(vec2) < 0) ? 0 : 1;
 }
 
+// the solved first and final circles of the combination with the lowest cost, none if the search fails
+static std::vector<Circle3D> search_circle_orientations(const ComponentSolver* solver, const std::vector<std::vector<Circle3D>>& candidates) {
+
+    // the depth of the final circle is solved for every combination
+    MultiStartSearch search([solver](const Circle3D& previous, Circle3D& current) {
+        double cost = solver->SolveDepth(previous, current, 1.0);
+        return (cost < 0.0) ? std::numeric_limits<double>::max() : cost;
+    }, 1e-12);
+    std::vector<Circle3D> solution;
+    std::vector<size_t> choice;
+    double cost = search.Search(candidates, solution, choice);
+    if(solution.size() != 2) {
+        std::cout << "ERROR: Multi-start solving failed, the selected orientations are used" << std::endl;
+        return std::vector<Circle3D>();
+    }
+    std::cout << "INFO: Multi-start solving: " << search.GetNumberOfSolves() << " solves, "
+              << search.GetNumberOfPrunedBranches() << " pruned, cost: " << cost << std::endl;
+    return solution;
+}
+
+void ImageModeller::orientation_candidates(const Circle3D* const final_circles, std::vector<std::vector<Circle3D>>& candidates) {
+
+    // both orientations of the first and of the final circle instead of the ones picked by the mouse
+    candidates.assign(2, std::vector<Circle3D>());
+    Circle3D first_circles[2];
+    if(estimate_3d_circles_with_fixed_depth(m_first_ellipse, first_circles, m_fixed_depth) == 2)
+        candidates[0].assign(first_circles, first_circles + 2);
+    else
+        candidates[0].push_back(*m_first_circle);
+    candidates[1].assign(final_circles, final_circles + 2);
+}
+
+void ImageModeller::solve_circle_orientations(const Circle3D* const final_circles, Circle3D& final_circle) {
+
+    // Step-1: the search on the calling thread
+    std::vector<std::vector<Circle3D>> candidates;
+    orientation_candidates(final_circles, candidates);
+    std::vector<Circle3D> solution = search_circle_orientations(m_component_solver.get(), candidates);
+    if(solution.size() != 2) {
+        m_component_solver->SolveDepth(*m_first_circle, final_circle);
+        return;
+    }
+
+    // Step-2: the first section of the generalized cylinder is the first circle
+    *m_first_circle = solution[0];
+    SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
+    if(!sections.empty()) sections[0] = solution[0];
+    final_circle = solution[1];
+}
+
+void ImageModeller::start_orientation_search(const Circle3D* const final_circles, const SectionStore& before, const executor_type& executor) {
+
+    // Step-1: the candidates of the drawing, which is reset once this returns
+    std::vector<std::vector<Circle3D>> candidates;
+    orientation_candidates(final_circles, candidates);
+    const ComponentSolver* solver = m_component_solver.get();
+    unsigned int id = m_gcyl->GetComponentId();
+    SectionStore expected = m_gcyl->GetGeometry()->GetSections();
+
+    // Step-2: the search on the thread pool, the solution replaces the sections by the executor of the view
+    m_orientation_search.Cancel();
+    m_orientation_search = ThreadPool::Instance().Submit([solver, candidates](const CancellationToken&) {
+        return search_circle_orientations(solver, candidates);
+    });
+    m_orientation_search.Then([this, id, before, expected](const std::vector<Circle3D>& solution) {
+        apply_circle_orientations(id, before, expected, solution);
+    }, executor);
+}
+
+void ImageModeller::apply_circle_orientations(unsigned int id, const SectionStore& before, const SectionStore& expected,
+                                              const std::vector<Circle3D>& solution) {
+
+    // the component is kept as it is if it has been edited or deleted meanwhile
+    if(solution.size() != 2) return;
+    GeneralizedCylinder* gcyl = find_generalized_cylinder(id);
+    if(gcyl == nullptr || m_gcyl.get() != gcyl || !SectionDelta(expected, gcyl->GetGeometry()->GetSections()).IsEmpty()) {
+        std::cout << "INFO: Component " << id << " is edited before the multi-start solving is done, its orientations are kept" << std::endl;
+        return;
+    }
+
+    // the sections are computed again from the solved circles, one step of the history
+    edit_sections([&]() {
+        SectionStore& sections = m_gcyl->GetGeometry()->GetSections();
+        sections = before;
+        if(!sections.empty()) sections[0] = solution[0];
+        straighten_linear_axis(solution[0], solution[1]);
+        m_gcyl->AddPlanarSection(solution[1]);
+        m_gcyl->Update();
+        if(sc_constraints != section_constraints::none)
+            m_component_solver->SolveGeneralizedCylinder(m_gcyl.get(), sc_constraints);
+    });
+}
+
+OtbImageType::PixelType ImageModeller::profile_ray_cast(const Point2D<int>& start, const Point2D<int>& end,
+                                                        Point2D<int>& hit, Point2D<double>& subpixel_hit) {
+
+    // the tiles until the gradient image is generated, the edges need the whole image
+    if(m_gimage.IsNull())
+        return m_lazy_gradient->RayCast(start, end, hit, &subpixel_hit);
+    if(m_snapping_mode == profile_snapping_mode::gradient_maximum) {
+        // the pixels whose gradient is not along the normal of the profile are not its silhouette
+        if(m_gorientation.IsNotNull())
+            return OrientedGradientImageRayCast(m_gimage, m_gorientation, start, end, snapping_orientation_tolerance,
+                                                snapping_strong_edge, hit, subpixel_hit);
+        return GradientImageRayCast(m_gimage, start, end, hit, subpixel_hit);
+    }
+
+    // the value of the first edge on the ray is compared to the gradient at the profile end point
+    const EdgeMap* edges = get_edge_map();
+    if(edges == nullptr || !edges->RayCast(start, end, hit)) return 0;
+    subpixel_hit.x = hit.x;
+    subpixel_hit.y = hit.y;
+    OtbImageType::IndexType idx;
+    idx[0] = hit.x; idx[1] = hit.y;
+    return m_gimage->GetPixel(idx);
+}
+
+OtbImageType::PixelType ImageModeller::gradient_value(const Point2D<int>& p) {
+
+    if(m_gimage.IsNull()) return m_lazy_gradient->GetPixel(p.x, p.y);
+    OtbImageType::IndexType idx;
+    idx[0] = p.x; idx[1] = p.y;
+    return m_gimage->GetPixel(idx);
+}
+
 void ImageModeller::ray_cast_within_gradient_image_for_profile_match() {
 
+    LatencyProbe::Scope probe(latency_stage::ray_cast, "ImageModeller::ray_cast");
+
+    // profiles are not snapped until the gradient image is generated or its tiles are available
+    if(m_gimage.IsNull() && !m_lazy_gradient) return;
+    update_orientation();
+
     // 1) transform the point coordinates to pixel coordinates
     Point2D<int> p1(static_cast<int>(m_dsegment->pt1.x()), static_cast<int>(m_dsegment->pt1.y()));
     m_canvas->UsrDeviceToLogical(p1);
     Point2D<int> p2(static_cast<int>(m_dsegment->pt2.x()), static_cast<int>(m_dsegment->pt2.y()));
     m_canvas->UsrDeviceToLogical(p2);
 
+    // the tiles the rays of the next moves may reach are computed in the background
+    if(m_gimage.IsNull()) {
+        int reach = static_cast<int>(std::ceil(std::max(m_scale_factor, 1.0) * std::hypot(p2.x - p1.x, p2.y - p1.y)));
+        m_lazy_gradient->Prefetch(std::min(p1.x, p2.x) - reach, std::min(p1.y, p2.y) - reach,
+                                  std::max(p1.x, p2.x) + reach, std::max(p1.y, p2.y) + reach);
+    }
+
     // 2) calculate the vectors for ray casting in both directions.
     //    The length of the inward vector should not be larger than the half of the current segment length
     //    No limit for the outward vector length (only limited by the scale factor)
@@ -828,48 +1628,33 @@ void ImageModeller::ray_cast_within_gradient_image_for_profile_match() {
         inward_vec *= (0.5 / m_scale_factor);
     }
 
-    // 3) perform ray casts and display shot rays variables for ray casting
+    // 3) clip the four rays against the image in one call: from p1 to the center and outside, from p2
+    //    to the center and outside
+    int x0[4] = { p1.x, p1.x, p2.x, p2.x };
+    int y0[4] = { p1.y, p1.y, p2.y, p2.y };
+    int x1[4] = { p1.x + inward_vec.x, p1.x - outward_vec.x, p2.x - inward_vec.x, p2.x + outward_vec.x };
+    int y1[4] = { p1.y + inward_vec.y, p1.y - outward_vec.y, p2.y - inward_vec.y, p2.y + outward_vec.y };
+    unsigned char inside[4];
+    m_rect->clip(4, x0, y0, x1, y1, inside);
+
+    // 4) perform the ray casts, a ray outside of the image hits nothing
     OtbImageType::PixelType hit_val[4];
     Point2D<int> hit_idx[4];
-
-    // 3.1) ray cast from p1-center direction
-    Point2D<int> end = p1 + inward_vec;
-    if(m_rect->intersect(p1, end))
-        hit_val[0] = GradientImageRayCast(m_gimage, p1, end, hit_idx[0]);
-
-    if(m_display_raycast) {
-        m_raycast->at(0).x() = end.x;
-        m_raycast->at(0).y() = end.y;
-    }
-
-    // 3.2) ray cast from p1-outside direction
-    end = p1 - outward_vec;
-    if(m_rect->intersect(p1, end))
-        hit_val[1] = GradientImageRayCast(m_gimage, p1, end, hit_idx[1]);
-
-    if(m_display_raycast) {
-        m_raycast->at(1).x() = end.x;
-        m_raycast->at(1).y() = end.y;
-    }
-
-    // 3.3) ray cast from p2-center direction
-    end = p2 - inward_vec;
-    if(m_rect->intersect(p2, end))
-        hit_val[2] = GradientImageRayCast(m_gimage, p2, end, hit_idx[2]);
-
-    if(m_display_raycast) {
-        m_raycast->at(2).x() = end.x;
-        m_raycast->at(2).y() = end.y;
+    Point2D<double> hit_sub[4];                                 // sub-pixel locations of the hits
+    for(size_t i = 0; i < 4; ++i) {
+        Point2D<int> start(x0[i], y0[i]), end(x1[i], y1[i]);
+        hit_val[i] = 0;
+        hit_idx[i] = start;
+        hit_sub[i] = Point2D<double>(start.x, start.y);
+        if(inside[i])
+            hit_val[i] = profile_ray_cast(start, end, hit_idx[i], hit_sub[i]);
     }
 
-    // 3.4) ray cast from p2-outside direction
-    end = p2 + outward_vec;
-    if(m_rect->intersect(p2, end))
-        hit_val[3] = GradientImageRayCast(m_gimage, p2, end, hit_idx[3]);
-
     if(m_display_raycast) {
-        m_raycast->at(3).x() = end.x;
-        m_raycast->at(3).y() = end.y;
+        for(size_t i = 0; i < 4; ++i) {
+            m_raycast->at(i).x() = x1[i];
+            m_raycast->at(i).y() = y1[i];
+        }
 
         for(size_t i = 0; i < 4; ++i) {
             m_raycast->at(i+4).x() = hit_idx[i].x;
@@ -882,59 +1667,72 @@ void ImageModeller::ray_cast_within_gradient_image_for_profile_match() {
         m_uihelper->DisplayRayCast(m_raycast);
     }
 
-    // 4) analyze the result of the ray casts
-    OtbImageType::IndexType p1Idx, p2Idx;
-    p1Idx[0] = p1.x; p1Idx[1] = p1.y;                           // coordinates of p1
-    OtbImageType::PixelType p1val = m_gimage->GetPixel(p1Idx);  // pixel value of p1
-    p2Idx[0] = p2.x; p2Idx[1] = p2.y;                           // coordinates of p2
-    OtbImageType::PixelType p2val = m_gimage->GetPixel(p2Idx);  // pixel value of p2
+    // 5) analyze the result of the ray casts
+    OtbImageType::PixelType p1val = gradient_value(p1);         // pixel value of p1
+    OtbImageType::PixelType p2val = gradient_value(p2);         // pixel value of p2
 
     OtbImageType::PixelType p1_hit_val = p1val;
     Point2D<int> p1_hit = p1;
+    Point2D<double> p1_sub(p1.x, p1.y);
     if(hit_val[0] > p1val && hit_val[1] > p1val) {              // both side hit
         if(hit_val[0] > hit_val[1]) {                           // select based on the value of the hit
             p1_hit = hit_idx[0];
+            p1_sub = hit_sub[0];
             p1_hit_val = hit_val[0];
         }
         else {
             p1_hit = hit_idx[1];
+            p1_sub = hit_sub[1];
             p1_hit_val = hit_val[1];
         }
     }
     else if(hit_val[0] > p1val) {                               // only one side hit
         p1_hit = hit_idx[0];
+        p1_sub = hit_sub[0];
         p1_hit_val = hit_val[0];
     }
     else if(hit_val[1] > p1val) {                               // only one side hit
         p1_hit = hit_idx[1];
+        p1_sub = hit_sub[1];
         p1_hit_val = hit_val[1];
     }
     m_canvas->UsrDeviceToLogical(p1_hit);                       // convert hit point to logical coordinates
 
     OtbImageType::PixelType p2_hit_val = p2val;
     Point2D<int> p2_hit = p2;
+    Point2D<double> p2_sub(p2.x, p2.y);
     if(hit_val[2] > p2val && hit_val[3] > p2val) {              // both side hit
         if(hit_val[2] > hit_val[3]) {                           // select based on the value of the hit
             p2_hit = hit_idx[2];
+            p2_sub = hit_sub[2];
             p2_hit_val = hit_val[2];
         }
         else {
             p2_hit = hit_idx[3];
+            p2_sub = hit_sub[3];
             p2_hit_val = hit_val[3];
         }
     }
     else if(hit_val[2] > p2val) {                               // only one side hit
         p2_hit = hit_idx[2];
+        p2_sub = hit_sub[2];
         p2_hit_val = hit_val[2];
     }
     else if(hit_val[3] > p2val) {                               // only one side hit
         p2_hit = hit_idx[3];
+        p2_sub = hit_sub[3];
         p2_hit_val = hit_val[3];
     }
     m_canvas->UsrDeviceToLogical(p2_hit);                       // convert hit point to logical coordinates
 
     osg::Vec2d new_p1(p1_hit.x, p1_hit.y);
     osg::Vec2d new_p2(p2_hit.x, p2_hit.y);
+    if(m_subpixel_snapping) {
+        new_p1.set(p1_sub.x, p1_sub.y);
+        m_canvas->UsrDeviceToLogical(new_p1);
+        new_p2.set(p2_sub.x, p2_sub.y);
+        m_canvas->UsrDeviceToLogical(new_p2);
+    }
     osg::Vec2d mid_p = m_dsegment->mid_point();
 
     if(p1_hit_val != p1val && p2_hit_val != p2val) { // both points are updated
@@ -963,31 +1761,30 @@ void ImageModeller::ray_cast_within_gradient_image_for_profile_match() {
     }
 }
 
+void ImageModeller::initialize_projector(BatchProjector& projector) const {
+
+    const osg::Camera* cam = m_canvas->UsrGetMainCamera();
+    projector.SetTransform(osg::Matrixd::identity(), cam->getProjectionMatrix(), cam->getViewport()->computeWindowMatrix());
+}
+
 void ImageModeller::project_point(const osg::Vec3d& pt3d, osg::Vec2d& pt2d) const {
 
-    osg::Vec4d pt4d(pt3d,1);
-    const osg::Matrixd& Mproj = m_canvas->UsrGetMainCamera()->getProjectionMatrix();
-    osg::Matrixd Mvp = m_canvas->UsrGetMainCamera()->getViewport()->computeWindowMatrix();
-    osg::Vec4d pt_vp = pt4d * Mproj * Mvp;
-    pt2d.x() = pt_vp.x() / pt_vp.w();
-    pt2d.y() = pt_vp.y() / pt_vp.w();
+    BatchProjector projector;
+    initialize_projector(projector);
+    projector.Project(pt3d.ptr(), 1, pt2d.ptr());
 }
 
 void ImageModeller::project_points(const osg::Vec3dArray * const pt3darr, osg::Vec2dArray * const pt2darr) const {
 
-    osg::Matrixd M = m_canvas->UsrGetMainCamera()->getProjectionMatrix() *
-            m_canvas->UsrGetMainCamera()->getViewport()->computeWindowMatrix();
-    osg::Vec4d pt4d;
-    for(auto it = pt3darr->begin(); it != pt3darr->end(); ++it) {
-        pt4d = osg::Vec4d(*it, 1) * M;
-        pt2darr->push_back(osg::Vec2d(pt4d.x()/pt4d.w(), pt4d.y()/pt4d.w()));
-    }
+    BatchProjector projector;
+    initialize_projector(projector);
+    projector.Project(pt3darr, pt2darr);
 }
 
 void ImageModeller::project_circle(const Circle3D& circle, Ellipse2D& ellipse) const {
 
     osg::Matrixd M = m_canvas->UsrGetMainCamera()->getProjectionMatrix();
-    transpose(M,4);
+    transpose<4>(M);
     Eigen::Matrix<double, 3, 4> Mprj;
     for(size_t i = 0; i < 4; ++i) {
         Mprj(0,i) = M(0,i);
@@ -1002,13 +1799,8 @@ void ImageModeller::project_circle(const Circle3D& circle, Ellipse2D& ellipse) c
     if(dConic.determinant() != 0) {
         Eigen::Matrix3d conic = dConic.inverse();
         conic /= conic(0,0);
-        ellipse.coeff[0] = conic(0,0);
-        ellipse.coeff[1] = 2*conic(0,1);
-        ellipse.coeff[2] = conic(1,1);
-        ellipse.coeff[3] = 2*conic(0,2);
-        ellipse.coeff[4] = 2*conic(1,2);
-        ellipse.coeff[5] = conic(2,2);
-        ellipse.calculate_parameters_from_coeffients();
+        double coeff[6] = { conic(0,0), 2*conic(0,1), conic(1,1), 2*conic(0,2), 2*conic(1,2), conic(2,2) };
+        ellipse.set_coefficients(coeff);
     }
     else {
         std::cout << "camera::project_camera_circle3d: dual conic is degenerate" << std::endl;
@@ -1035,17 +1827,18 @@ void ImageModeller::project_circle(const Circle3D& circle, Ellipse2D& ellipse) c
 void ImageModeller::project_generalized_cylinder(const GeneralizedCylinder& gcyl)  const {
 
     std::vector<Ellipse2D> ellipses;
-    const std::vector<Circle3D>& circles =  gcyl.GetGeometry()->GetSections();
-    osg::ref_ptr<osg::Vec3dArray> main_axis = new osg::Vec3dArray;
+    const SectionStore& circles =  gcyl.GetGeometry()->GetSections();
     Ellipse2D elp;
     for(size_t i = 0; i < circles.size(); ++i) {
-        main_axis->push_back(osg::Vec3d(circles[i].center[0], circles[i].center[1], circles[i].center[2]));
         project_circle(circles[i], elp);
         ellipses.push_back(elp);
     }
 
-    osg::ref_ptr<osg::Vec2dArray> main_axis_prj = new osg::Vec2dArray;
-    project_points(main_axis.get(), main_axis_prj.get());
+    // the centers of the sections are projected in place
+    BatchProjector projector;
+    initialize_projector(projector);
+    osg::ref_ptr<osg::Vec2dArray> main_axis_prj = new osg::Vec2dArray(circles.size());
+    if(!circles.empty()) projector.Project(circles.centers(), circles.size(), main_axis_prj->front().ptr());
 
     osg::Vec2d left, right, dir;
     std::vector<osg::Vec2d> left_silhouette;
@@ -3,11 +3,19 @@
 
 #include <vector>
 #include <memory>
+#include <string>
+#include <functional>
+#include <utility>
 #include "../image/algorithms/Algorithms.hpp"
+#include "../image/algorithms/EdgeMap.hpp"
+#include "../image/algorithms/LazyGradient.hpp"
+#include "../utility/MemoryRegistry.hpp"
+#include "../utility/ThreadPool.hpp"
+#include "components/Cuboid.hpp"
 #include "components/GeneralizedCylinder.hpp"
+#include "optimization/Constraints.hpp"
 #include <osg/Geometry>
 #include <otbImage.h>
-#include <wx/gdicmn.h>
 
 class Rectangle2D;
 class UIHelper;
@@ -19,8 +27,12 @@ class ModelSolver;
 class ComponentSolver;
 class GeneralizedCylinder;
 class ProjectionParameters;
-class OsgWxGLCanvas;
+class ModellerView;
 class CircleEstimator;
+class BatchProjector;
+class CurveSimplifier;
+class ProjectFile;
+class ModelHistory;
 
 enum class gcyl_drawing_mode : unsigned char {
     mode_0,     // do nothing
@@ -43,17 +55,16 @@ enum class axis_constraints : unsigned char {
     planar            // axis is a piecewise linear line on a plane
 };
 
-enum class section_constraints : unsigned char {
-    none,             // no constraint
-    constant,         // same size
-    linear_scaling    // linear scaling
-};
-
 enum class axis_drawing_mode : unsigned char {
     continuous,
     piecewise_linear
 };
 
+enum class profile_snapping_mode : unsigned char {
+    gradient_maximum,   // strongest gradient along the rays
+    nearest_edge        // first edge of the precomputed edge map along the rays
+};
+
 enum class projection_type : unsigned char {
     perspective,
     orthographic,
@@ -62,7 +73,7 @@ enum class projection_type : unsigned char {
 
 class ImageModeller {
 public:
-    ImageModeller(const wxString& fpath, const std::shared_ptr<ProjectionParameters>& pp, OsgWxGLCanvas* canvas);
+    ImageModeller(const std::string& fpath, const std::shared_ptr<ProjectionParameters>& pp, ModellerView* canvas);
     ~ImageModeller();
 
     component_type comp_type;           // type of the component being modelled
@@ -74,9 +85,17 @@ private:
 
     // otb related data members
     OtbImageType::Pointer m_gimage;                         // for gradient image
+    OtbImageType::Pointer m_gorientation;                   // quantized orientations of the gradient, if they are cached
+    std::shared_ptr<const EdgeMap> m_edge_map;              // thinned edges of the gradient image, once they are needed
+    Job<std::shared_ptr<const EdgeMap>> m_edge_job;         // builds m_edge_map on the thread pool
+    Job<OtbImageType::Pointer> m_orientation_job;           // the orientations of a gradient image cached without them
+    Job<std::vector<Circle3D>> m_orientation_search;        // multi-start search of the last straight generalized cylinder
+    std::shared_ptr<LazyGradientImage> m_lazy_gradient;     // tiles of the gradient until m_gimage is set
+    MemoryRegistry::Allocation m_memory;                    // gradient image, orientations and edge map
 
     // osg related data members
-    OsgWxGLCanvas* m_canvas;
+    std::string m_image_path;                               // image being modelled
+    ModellerView* m_canvas;                                 // OsgWxGLCanvas, or a HeadlessView for the batch modelling
     osg::ref_ptr<GeneralizedCylinder> m_gcyl;               // for generalized cylinder modelling
     osg::Vec2d m_mouse;                                     // current position of the mouse updated by osgWxGLCanvas
     gcyl_drawing_mode m_gcyl_dmode;                         // current drawing mode of the generalized cylinder
@@ -84,6 +103,7 @@ private:
     bool m_left_click;                                      // set to true in the case of user left click
 
     rendering_type m_rtype;                                 // rendering type for generalized cylinders
+    bool m_procedural_sweep;                                // generalized cylinders are swept in the vertex shader
 
     Circle3D* m_first_circle;                               // first modelled 3D circle
     Circle3D* m_last_circle;                                // most recetly modelled 3D circle
@@ -99,6 +119,8 @@ private:
     std::unique_ptr<Rectangle2D> m_rect;                    // for ray casting
     bool m_display_raycast;
     bool m_symmetric_profile;
+    bool m_subpixel_snapping;                               // snap the profiles to the sub-pixel gradient maxima
+    profile_snapping_mode m_snapping_mode;
     osg::ref_ptr<osg::Vec2dArray> m_raycast;
 
     std::shared_ptr<ProjectionParameters> m_pp;             // for 3D circle estimation
@@ -111,10 +133,21 @@ private:
 
     int m_num_right_click;
     std::vector<Segment2D> m_segments;                      // array of major axis segments on the image plane (in projected coordinates)
+    std::unique_ptr<CurveSimplifier> m_axis_simplifier;     // axis points of the continuous axis drawing mode
     bool m_double_circle_drawing;                           // double circle drawing mode for straight axis generalized cylinders
+    bool m_multi_start;                                     // solve every orientation of the ambiguous circles, keep the best
+    bool m_fit_ellipses;                                    // fit the drawn ellipses to the edges around them
 
     std::unique_ptr<ModelSolver> m_solver;
     std::unique_ptr<ComponentSolver> m_component_solver;
+    std::unique_ptr<ModelHistory> m_history;                // undo and redo of the section edits, constraints and solutions
+    struct section_gesture;
+    std::unique_ptr<section_gesture> m_gesture;             // the state before the inputs of the open gesture, one step of the history
+
+    osg::Vec2d m_primitive_points[2];                       // first clicks of the cuboid and sphere drawing
+    osg::ref_ptr<Cuboid> m_cuboid;                          // cuboid whose width follows the mouse
+    std::shared_ptr<PrimitiveInstances> m_cuboid_instances; // instanced batches of the primitives of this model
+    std::shared_ptr<PrimitiveInstances> m_sphere_instances;
 public:
 
     // Public member functions
@@ -125,31 +158,79 @@ public:
     void OnMouseMove(double x, double y);
     void DebugPrint();
     void SaveModel(const std::string& path);
+    // the session: components, constraints, projection parameters, image and gradient image
+    bool SaveProject(const std::string& path) const;
+    // the constraints and the gradient image of an open project, the components are added one
+    // by one with AddProjectComponent
+    void RestoreProject(const ProjectFile& project);
+    void AddProjectComponent(const ProjectFile& project, size_t i);
     void DeleteModel();
     void DeleteSelectedComopnents(std::vector<int>& index_vector);
     void SetRenderingType(rendering_type rtype);
+    void SetProceduralSweep(bool flag);
     void SetSymmetricProfile(bool sym);
+    void SetSubpixelSnapping(bool flag);
+    void SetProfileSnappingMode(profile_snapping_mode mode);
     void SetDoubleCircleDrawingForLinaerAxisPrior(bool dc);
     void SetRightGeneralizedCylinderConstraint(bool rgc);
+    void SetMultiStartSolving(bool flag);
+    void SetEllipseFitting(bool flag);
     void EnableRayCastDisplay(bool flag);
     void IncrementScaleFactor();
     void DecrementScaleFactor();
     void DeleteLastSection();
-    osg::Geode* CreateLocalFramesNode();
-    osg::Geode* CreateVertexNormalsNode();
     unsigned int GenerateComponentId();
     ModelSolver* GetModelSolver();
+    // the batch of the primitives of the kind, a shared node of the model of the frame
+    PrimitiveInstances* GetPrimitiveInstances(primitive_kind kind);
+    // the generalized cylinder being modelled, nullptr before the first one
+    GeneralizedCylinder* GetActiveComponent();
+    void SetGradientImage(OtbImageType::Pointer gimg);
+    bool HasGradientImage() const;
+    // the profiles are snapped on the tiles of the gradient until the gradient image is set
+    void SetLazyGradientImage(std::shared_ptr<LazyGradientImage> gradient);
+    // the sections of a generalized cylinder replaced by a solution, e.g. of the multi-view solver, recorded in the history
+    bool ReplaceSections(unsigned int id, const SectionStore& sections);
+    // the constraints between two components, recorded in the history
+    void SetConstraints(unsigned int cp1, unsigned int cp2, const std::vector<geosemantic_constraints>& gsc);
+    // the constraints added to the ones of several pairs, e.g. the accepted proposals of RelationDetector, as one step of the history
+    void AddConstraints(const std::vector<geosemcon>& relations);
+    // records the transformations that ModelSolver::ApplySolution applied to the components
+    void RecordComponentTransforms(const std::vector<std::pair<unsigned int, osg::Matrixd>>& transforms);
+    // the axis drawing steps back with its sections, the other drawings are ended first, false if there is nothing to undo or redo
+    bool Undo();
+    bool Redo();
 
 private:
 
     void model_update();
+    void edit_sections(const std::function<void()>& edit);
+    void begin_gesture();
+    void end_gesture();
+    void record_sections(const GeneralizedCylinder& gcyl, const SectionStore& before, const section_gesture* drawing = nullptr);
+    GeneralizedCylinder* find_generalized_cylinder(unsigned int id) const;
     void model_generalized_cylinder();
+    void model_primitive();
+    void update_cuboid();
+    osg::Vec3d back_project_at_fixed_depth(const osg::Vec2d& pt) const;
     void calculate_ellipse(std::unique_ptr<Ellipse2D>& ellipse);
+    bool fit_ellipse_to_edges(std::unique_ptr<Ellipse2D>& ellipse);
+    void collect_edge_points(const Ellipse2D& ellipse, double band, std::vector<osg::Vec2d>& edge_points);
+    bool refine_circle_to_edges(const std::unique_ptr<Ellipse2D>& ellipse, Circle3D& circle);
     void update_dynamic_segment();
     void initialize_axis_drawing_mode(projection_type pt);
 
     // ray cast
     void ray_cast_within_gradient_image_for_profile_match();
+    OtbImageType::PixelType profile_ray_cast(const Point2D<int>& start, const Point2D<int>& end, Point2D<int>& hit, Point2D<double>& subpixel_hit);
+    OtbImageType::PixelType gradient_value(const Point2D<int>& p);
+    void reset_edge_map();
+    void request_edge_map();
+    const EdgeMap* get_edge_map();
+    void request_orientation();
+    void update_orientation();
+    void set_orientation(OtbImageType::Pointer orientation);
+    void report_memory();
 
     // reset
     inline void reset_2d_drawing_interface();
@@ -158,6 +239,8 @@ private:
     // generalized cylinder modelling steps
     inline void operate_piecewise_linear_axis_drawing_mode();
     inline void operate_continuous_axis_drawing_mode();
+    inline void add_continuous_axis_point(const osg::Vec2d& pt);
+    inline void add_planar_section_at_the_axis_point();
 
     // estimation of the other circles
     inline void add_planar_section_to_the_generalized_cylinder_under_perspective_projection();
@@ -166,6 +249,7 @@ private:
     inline void add_planar_section_to_the_generalized_cylinder_under_orthogonality_constraint();
 
     inline void compute_generalized_cylinder();
+    inline void compute_planar_axis_sections(const Eigen::Vector3d& n, double depth);
     inline void compute_right_generalized_cylinder();
 
     // estimation of the first circle
@@ -181,8 +265,14 @@ private:
 
     // selection of the estimated circles under perspective projection
     inline size_t select_correctly_oriented_3d_circle(const Circle3D* const circles, const osg::Vec2d& pt);
+    void orientation_candidates(const Circle3D* const final_circles, std::vector<std::vector<Circle3D>>& candidates);
+    void solve_circle_orientations(const Circle3D* const final_circles, Circle3D& final_circle);
+    void start_orientation_search(const Circle3D* const final_circles, const SectionStore& before, const executor_type& executor);
+    void apply_circle_orientations(unsigned int id, const SectionStore& before, const SectionStore& expected, const std::vector<Circle3D>& solution);
+    void straighten_linear_axis(const Circle3D& first_circle, const Circle3D& final_circle);
 
     // projection functions
+    void initialize_projector(BatchProjector& projector) const;
     void project_point(const osg::Vec3d& pt3d, osg::Vec2d& pt2d) const;
     void project_points(const osg::Vec3dArray * const pt3darr, osg::Vec2dArray* const pt2darr) const;
     void project_circle(const Circle3D& circle, Ellipse2D& ellipse) const;
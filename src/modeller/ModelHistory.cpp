@@ -0,0 +1,163 @@
+#include "ModelHistory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// relative deviation of a scaled section from the scale of its radius
+static const double scale_tolerance = 1e-12;
+
+static bool is_same_section(const SectionStore& s1, const SectionStore& s2, size_t i) {
+
+    return std::memcmp(s1.center(i), s2.center(i), 3 * sizeof(double)) == 0 &&
+           std::memcmp(s1.normal(i), s2.normal(i), 3 * sizeof(double)) == 0 &&
+           s1.radius(i) == s2.radius(i);
+}
+
+// the scale s if the section i of s2 is the section i of s1 scaled by s, 0 otherwise
+static double section_scale(const SectionStore& s1, const SectionStore& s2, size_t i) {
+
+    if(s1.radius(i) <= 0.0 || std::memcmp(s1.normal(i), s2.normal(i), 3 * sizeof(double)) != 0) return 0.0;
+    double s = s2.radius(i) / s1.radius(i);
+    Eigen::Map<const Eigen::Vector3d> c1(s1.center(i)), c2(s2.center(i));
+    return ((s * c1 - c2).norm() <= scale_tolerance * c2.norm()) ? s : 0.0;
+}
+
+static void append_section(const SectionStore& sections, size_t i, std::vector<double>& values) {
+
+    values.insert(values.end(), sections.center(i), sections.center(i) + 3);
+    values.insert(values.end(), sections.normal(i), sections.normal(i) + 3);
+    values.push_back(sections.radius(i));
+}
+
+// the values are written as they are, a Circle3D would normalize the normal again
+static void assign_section(SectionStore::reference section, const double* v) {
+
+    section.center = Eigen::Map<const Eigen::Vector3d>(v);
+    section.normal = Eigen::Map<const Eigen::Vector3d>(v + 3);
+    section.radius = v[6];
+}
+
+SectionDelta::SectionDelta(const SectionStore& before, const SectionStore& after) :
+    m_before_size(before.size()),
+    m_after_size(after.size()),
+    m_common(std::min(before.size(), after.size())) {
+
+    // Step-1: the common range, the scaled sections first
+    for(size_t i = 0; i < m_common; ++i) {
+        if(is_same_section(before, after, i)) continue;
+        double s = section_scale(before, after, i);
+        if(s > 0.0) {
+            m_scaled.push_back(static_cast<unsigned int>(i));
+            m_scales.push_back(s);
+        }
+        else {
+            m_changed.push_back(static_cast<unsigned int>(i));
+            append_section(before, i, m_before);
+            append_section(after, i, m_after);
+        }
+    }
+
+    // Step-2: the tails
+    for(size_t i = m_common; i < m_before_size; ++i)
+        append_section(before, i, m_before);
+    for(size_t i = m_common; i < m_after_size; ++i)
+        append_section(after, i, m_after);
+}
+
+bool SectionDelta::IsEmpty() const {
+    return m_before_size == m_after_size && m_scaled.empty() && m_changed.empty();
+}
+
+size_t SectionDelta::GetByteSize() const {
+
+    return sizeof(SectionDelta) + (m_scaled.size() + m_changed.size()) * sizeof(unsigned int) +
+           (m_scales.size() + m_before.size() + m_after.size()) * sizeof(double);
+}
+
+size_t SectionDelta::Apply(SectionStore& sections, bool forward) const {
+
+    // Step-1: the tail of the other state is removed
+    while(sections.size() > m_common)
+        sections.pop_back();
+
+    // Step-2: the common range
+    size_t first = m_common;
+    for(size_t k = 0; k < m_scaled.size(); ++k) {
+        sections.scale(m_scaled[k], forward ? m_scales[k] : 1.0 / m_scales[k]);
+        first = std::min(first, static_cast<size_t>(m_scaled[k]));
+    }
+    const std::vector<double>& values = forward ? m_after : m_before;
+    const double* v = values.data();
+    for(size_t k = 0; k < m_changed.size(); ++k, v += 7) {
+        assign_section(sections[m_changed[k]], v);
+        first = std::min(first, static_cast<size_t>(m_changed[k]));
+    }
+
+    // Step-3: the tail of this state
+    size_t size = forward ? m_after_size : m_before_size;
+    for(size_t i = m_common; i < size; ++i, v += 7) {
+        sections.push_back(Circle3D());
+        assign_section(sections.back(), v);
+    }
+    return first;
+}
+
+ModelHistory::ModelHistory(size_t memory_budget) : m_size(0), m_budget(memory_budget) { }
+
+void ModelHistory::Record(const std::string& name, action undo, action redo, size_t size) {
+
+    // Step-1: the entries that could be redone do not follow from the new state
+    for(const entry& e : m_redo)
+        m_size -= e.size;
+    m_redo.clear();
+
+    // Step-2: the oldest entries beyond the budget, the new one is always kept
+    entry e;
+    e.name = name;
+    e.undo = std::move(undo);
+    e.redo = std::move(redo);
+    e.size = size + sizeof(entry) + name.size();
+    m_size += e.size;
+    m_undo.push_back(std::move(e));
+    while(m_size > m_budget && m_undo.size() > 1) {
+        m_size -= m_undo.front().size;
+        m_undo.pop_front();
+    }
+}
+
+bool ModelHistory::Undo() {
+
+    if(m_undo.empty()) {
+        std::cout << "INFO: There is nothing to undo" << std::endl;
+        return false;
+    }
+    entry e = std::move(m_undo.back());
+    m_undo.pop_back();
+    std::cout << "INFO: Undo " << e.name << std::endl;
+    e.undo();
+    m_redo.push_back(std::move(e));
+    return true;
+}
+
+bool ModelHistory::Redo() {
+
+    if(m_redo.empty()) {
+        std::cout << "INFO: There is nothing to redo" << std::endl;
+        return false;
+    }
+    entry e = std::move(m_redo.back());
+    m_redo.pop_back();
+    std::cout << "INFO: Redo " << e.name << std::endl;
+    e.redo();
+    m_undo.push_back(std::move(e));
+    return true;
+}
+
+void ModelHistory::Clear() {
+
+    m_undo.clear();
+    m_redo.clear();
+    m_size = 0;
+}
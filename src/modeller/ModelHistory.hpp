@@ -0,0 +1,121 @@
+#ifndef MODEL_HISTORY_HPP
+#define MODEL_HISTORY_HPP
+
+#include "../geometry/SectionStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Difference of the sections of a generalized cylinder between two states.
+ *
+ * The sections of the common range that differ and the tails of both states are kept, a section
+ * that is only scaled about the camera center (the solutions of the section scales) is kept as its
+ * scale instead of its two states. Adding or deleting a section is thus one section, a solve of the
+ * scales one double per section.
+ */
+class SectionDelta {
+public:
+    SectionDelta(const SectionStore& before, const SectionStore& after);
+    bool IsEmpty() const;
+    size_t GetByteSize() const;
+    // patches the sections from one state into the other, returns the first changed section
+    size_t Apply(SectionStore& sections, bool forward) const;
+
+private:
+    size_t m_before_size;
+    size_t m_after_size;
+    size_t m_common;                        // size of the common range
+    std::vector<unsigned int> m_scaled;     // scaled sections of the common range
+    std::vector<double> m_scales;
+    std::vector<unsigned int> m_changed;    // other changed sections of the common range
+    std::vector<double> m_before;           // 7 doubles per changed section then per tail section
+    std::vector<double> m_after;
+};
+
+/*
+ * Difference of a vector between two states that differ at its end, e.g. the axis segments of a
+ * generalized cylinder that is being drawn once sections are added or deleted: the size of the
+ * common prefix and both tails. The elements are compared bytewise, as the sections are.
+ */
+template <typename T>
+class TailDelta {
+public:
+    TailDelta(const std::vector<T>& before, const std::vector<T>& after);
+    bool IsEmpty() const { return m_before.empty() && m_after.empty(); }
+    size_t GetByteSize() const { return sizeof(TailDelta) + (m_before.size() + m_after.size()) * sizeof(T); }
+    // patches the values from one state into the other, false if they are not of the size of the first
+    bool Apply(std::vector<T>& values, bool forward) const;
+
+private:
+    size_t m_common;                        // size of the common prefix
+    std::vector<T> m_before;                // the tails
+    std::vector<T> m_after;
+};
+
+template <typename T>
+TailDelta<T>::TailDelta(const std::vector<T>& before, const std::vector<T>& after) : m_common(0) {
+
+    size_t n = std::min(before.size(), after.size());
+    while(m_common < n && std::memcmp(&before[m_common], &after[m_common], sizeof(T)) == 0) ++m_common;
+    m_before.assign(before.begin() + m_common, before.end());
+    m_after.assign(after.begin() + m_common, after.end());
+}
+
+template <typename T>
+bool TailDelta<T>::Apply(std::vector<T>& values, bool forward) const {
+
+    const std::vector<T>& from = forward ? m_before : m_after;
+    const std::vector<T>& to = forward ? m_after : m_before;
+    if(values.size() != m_common + from.size()) return false;
+    values.erase(values.begin() + m_common, values.end());
+    values.insert(values.end(), to.begin(), to.end());
+    return true;
+}
+
+/*
+ * Undo and redo of the modelling operations.
+ *
+ * An operation is not recorded as a snapshot of the model but as a delta held by the two closures
+ * that apply it backwards and forwards: the sections an input added, removed or moved (see
+ * SectionDelta), the constraints of a pair of components before and after an edit, the
+ * transformations a solution of the geosemantic constraints applied to the components. The
+ * closures find the components by their ids and skip the ones that have been deleted since.
+ *
+ * The oldest entries are dropped once the deltas exceed the memory budget, a new entry drops the
+ * entries that could be redone.
+ */
+class ModelHistory {
+public:
+    static const size_t default_memory_budget = 64 << 20;     // bytes
+
+    typedef std::function<void()> action;
+
+    explicit ModelHistory(size_t memory_budget = default_memory_budget);
+    void Record(const std::string& name, action undo, action redo, size_t size);
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const { return !m_undo.empty(); }
+    bool CanRedo() const { return !m_redo.empty(); }
+    void Clear();
+    size_t GetMemoryUsage() const { return m_size; }
+
+private:
+    struct entry {
+        std::string name;
+        action undo;
+        action redo;
+        size_t size;                        // of the delta
+    };
+
+    std::deque<entry> m_undo;               // the most recent last
+    std::vector<entry> m_redo;
+    size_t m_size;                          // of the entries of both lists
+    size_t m_budget;
+};
+
+#endif // MODEL_HISTORY_HPP
@@ -0,0 +1,33 @@
+#ifndef MODELLER_VIEW_HPP
+#define MODELLER_VIEW_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Camera>
+#include <osg/Vec2d>
+
+template <typename T> class Point2D;
+
+/*
+ * The view the ImageModeller works in: the main camera of the image, the conversion between
+ * the device coordinates (origin at the top left) and the logical coordinates of the image
+ * (origin at the bottom left), and the display of the modelled components.
+ *
+ * OsgWxGLCanvas is the interactive view. HeadlessView has a camera without a graphics context
+ * for the batch modelling, see cvm_batch.
+ *
+ * The modelling executor runs the continuations of the jobs of the modeller, e.g. of the multi-start
+ * search, where the inputs of the modeller run. A view without one, the headless view, waits for
+ * the jobs instead, thus the batch modelling stays deterministic.
+ */
+class ModellerView {
+public:
+    virtual ~ModellerView() { }
+
+    virtual void UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id) = 0;
+    virtual void UsrDeviceToLogical(Point2D<int>& pt) const = 0;
+    virtual void UsrDeviceToLogical(osg::Vec2d& p) const = 0;
+    virtual const osg::Camera* const UsrGetMainCamera() const = 0;
+    virtual executor_type UsrGetModellingExecutor() { return executor_type(); }
+};
+
+#endif // MODELLER_VIEW_HPP
@@ -0,0 +1,374 @@
+#include "ProjectFile.hpp"
+#include "ProjectionParameters.hpp"
+#include "../geometry/Circle3D.hpp"
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char project_magic[8] = { 'C', 'V', 'M', 'P', 'R', 'O', 'J', '\0' };
+static const unsigned long long table_alignment = 8;
+static const unsigned long long gradient_alignment = 4096;     // the rows start on a page of the mapping
+
+struct project_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    double fovy, near, far;
+    int32_t width, height;
+    uint32_t active_component;
+    uint32_t image_path_size;
+    uint64_t image_path_offset;
+    uint64_t components_offset;
+    uint64_t num_components;
+    uint64_t sections_offset;              // centers, normals and radii of all the sections
+    uint64_t num_sections;
+    uint64_t constraints_offset;
+    uint64_t num_constraints;
+    uint64_t segments_offset;              // pt1 and pt2 of each segment
+    uint64_t num_segments;
+    uint64_t gradient_offset;
+    int32_t gradient_width, gradient_height;  // 0 without a gradient image
+};
+static_assert(sizeof(project_header) == 144, "the header is written as it is");
+
+struct project_component {
+    uint32_t component_id;
+    uint32_t rtype;
+    uint32_t num_points;
+    uint32_t num_sections;
+    uint64_t first_section;
+    float color[4];
+};
+static_assert(sizeof(project_component) == 40, "component records are written as they are");
+
+struct project_constraint {
+    uint32_t component_1;
+    uint32_t component_2;
+    uint32_t constraints;                  // bit to_int(c) for each geosemantic constraint c
+};
+static_assert(sizeof(project_constraint) == 12, "constraint records are written as they are");
+
+static const project_header& header_of(const void* map) {
+    return *static_cast<const project_header*>(map);
+}
+
+static unsigned long long align(unsigned long long offset, unsigned long long alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static void write_padding(std::ofstream& file, unsigned long long offset) {
+
+    static const char zeros[gradient_alignment] = { 0 };
+    unsigned long long pos = static_cast<unsigned long long>(file.tellp());
+    if(offset > pos) file.write(zeros, static_cast<std::streamsize>(offset - pos));
+}
+
+bool ProjectFile::Write(const std::string& path, const contents& project) {
+
+    // Step-1: the layout of the tables
+    project_header hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, project_magic, sizeof(project_magic));
+    hdr.version = version;
+    hdr.header_size = sizeof(project_header);
+    hdr.fovy = project.pp->fovy;
+    hdr.near = project.pp->near;
+    hdr.far = project.pp->far;
+    hdr.width = project.pp->width;
+    hdr.height = project.pp->height;
+    hdr.active_component = project.active_component;
+    hdr.image_path_size = static_cast<uint32_t>(project.image_path.size());
+    hdr.num_components = project.components.size();
+    for(const GeneralizedCylinder* gcyl : project.components)
+        hdr.num_sections += gcyl->GetGeometry()->GetSections().size();
+    hdr.num_constraints = project.constraints.size();
+    hdr.num_segments = project.active_segments.size();
+    if(project.gradient.IsNotNull()) {
+        OtbImageType::SizeType size = project.gradient->GetLargestPossibleRegion().GetSize();
+        hdr.gradient_width = static_cast<int32_t>(size[0]);
+        hdr.gradient_height = static_cast<int32_t>(size[1]);
+    }
+
+    hdr.image_path_offset = sizeof(project_header);
+    hdr.components_offset = align(hdr.image_path_offset + hdr.image_path_size, table_alignment);
+    hdr.sections_offset = align(hdr.components_offset + hdr.num_components * sizeof(project_component), table_alignment);
+    hdr.constraints_offset = align(hdr.sections_offset + hdr.num_sections * 7 * sizeof(double), table_alignment);
+    hdr.segments_offset = align(hdr.constraints_offset + hdr.num_constraints * sizeof(project_constraint), table_alignment);
+    hdr.gradient_offset = align(hdr.segments_offset + hdr.num_segments * 4 * sizeof(double), gradient_alignment);
+
+    // Step-2: the tables, to a temporary file first: an open project is never overwritten halfway
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.good()) {
+        std::cout << "ERROR: Project file cannot be written: " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    file.write(project.image_path.data(), project.image_path.size());
+
+    write_padding(file, hdr.components_offset);
+    uint64_t first_section = 0;
+    for(const GeneralizedCylinder* gcyl : project.components) {
+        const GeneralizedCylinderGeometry* geometry = gcyl->GetGeometry();
+        project_component rec;
+        rec.component_id = gcyl->GetComponentId();
+        rec.rtype = static_cast<uint32_t>(geometry->GetRenderingType());
+        rec.num_points = static_cast<uint32_t>(geometry->GetNumberOfPointsPerSection());
+        rec.num_sections = static_cast<uint32_t>(geometry->GetSections().size());
+        rec.first_section = first_section;
+        for(int i = 0; i < 4; ++i) rec.color[i] = geometry->GetColor()[i];
+        file.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+        first_section += rec.num_sections;
+    }
+
+    write_padding(file, hdr.sections_offset);
+    for(const GeneralizedCylinder* gcyl : project.components) {
+        const SectionStore& sections = gcyl->GetGeometry()->GetSections();
+        file.write(reinterpret_cast<const char*>(sections.centers()), 3 * sections.size() * sizeof(double));
+    }
+    for(const GeneralizedCylinder* gcyl : project.components) {
+        const SectionStore& sections = gcyl->GetGeometry()->GetSections();
+        file.write(reinterpret_cast<const char*>(sections.normals()), 3 * sections.size() * sizeof(double));
+    }
+    for(const GeneralizedCylinder* gcyl : project.components) {
+        const SectionStore& sections = gcyl->GetGeometry()->GetSections();
+        file.write(reinterpret_cast<const char*>(sections.radii()), sections.size() * sizeof(double));
+    }
+
+    write_padding(file, hdr.constraints_offset);
+    for(const geosemcon& con : project.constraints) {
+        project_constraint rec;
+        rec.component_1 = con.component_1;
+        rec.component_2 = con.component_2;
+        rec.constraints = 0;
+        for(geosemantic_constraints c : con.constraints)
+            rec.constraints |= 1u << to_int(c);
+        file.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    }
+
+    write_padding(file, hdr.segments_offset);
+    for(const Segment2D& seg : project.active_segments) {
+        double pts[4] = { seg.pt1.x(), seg.pt1.y(), seg.pt2.x(), seg.pt2.y() };
+        file.write(reinterpret_cast<const char*>(pts), sizeof(pts));
+    }
+
+    write_padding(file, hdr.gradient_offset);
+    if(project.gradient.IsNotNull())
+        file.write(reinterpret_cast<const char*>(project.gradient->GetBufferPointer()),
+                   static_cast<std::streamsize>(hdr.gradient_width) * hdr.gradient_height * sizeof(OtbImageType::PixelType));
+
+    file.close();
+    if(file.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        std::cout << "ERROR: Project file cannot be written: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ProjectFile::ProjectFile() : m_map(nullptr), m_map_size(0) { }
+
+ProjectFile::~ProjectFile() {
+    Close();
+}
+
+bool ProjectFile::Open(const std::string& path) {
+
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        std::cout << "ERROR: Project file cannot be opened: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(project_header)) {
+        close(fd);
+        std::cout << "ERROR: Not a project file: " << path << std::endl;
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return false;
+    m_map = map;
+    m_map_size = size;
+    m_path = path;
+
+    if(!validate()) {
+        std::cout << "ERROR: Not a project file of version " << version << " or corrupt: " << path << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ProjectFile::Close() {
+
+    if(m_map != nullptr) munmap(m_map, m_map_size);
+    m_map = nullptr;
+    m_map_size = 0;
+}
+
+const unsigned char* ProjectFile::at(unsigned long long offset) const {
+    return static_cast<const unsigned char*>(m_map) + offset;
+}
+
+bool ProjectFile::validate() const {
+
+    // Step-1: the header
+    const project_header& hdr = header_of(m_map);
+    if(std::memcmp(hdr.magic, project_magic, sizeof(project_magic)) != 0 || hdr.version != version || hdr.header_size != sizeof(project_header))
+        return false;
+    if(hdr.width <= 0 || hdr.height <= 0 || hdr.gradient_width < 0 || hdr.gradient_height < 0)
+        return false;
+
+    // Step-2: every table lies within the file, the counts are bounded by the file size first
+    unsigned long long size = m_map_size;
+    if(hdr.num_components > size || hdr.num_sections > size || hdr.num_constraints > size || hdr.num_segments > size)
+        return false;
+    struct table { unsigned long long offset, size, alignment; };
+    table tables[] = {
+        { hdr.image_path_offset, hdr.image_path_size, 1 },
+        { hdr.components_offset, hdr.num_components * sizeof(project_component), table_alignment },
+        { hdr.sections_offset, hdr.num_sections * 7 * sizeof(double), table_alignment },
+        { hdr.constraints_offset, hdr.num_constraints * sizeof(project_constraint), table_alignment },
+        { hdr.segments_offset, hdr.num_segments * 4 * sizeof(double), table_alignment },
+        { hdr.gradient_offset, static_cast<unsigned long long>(hdr.gradient_width) * hdr.gradient_height * sizeof(OtbImageType::PixelType), 1 }
+    };
+    for(const table& t : tables)
+        if(t.offset % t.alignment != 0 || t.offset > size || t.size > size - t.offset)
+            return false;
+
+    // Step-3: the section ranges of the components
+    const project_component* components = reinterpret_cast<const project_component*>(at(hdr.components_offset));
+    for(uint64_t i = 0; i < hdr.num_components; ++i) {
+        const project_component& rec = components[i];
+        if(rec.first_section > hdr.num_sections || rec.num_sections > hdr.num_sections - rec.first_section)
+            return false;
+        if(rec.rtype > static_cast<uint32_t>(rendering_type::triangle_strip) || rec.num_points < 3)
+            return false;
+    }
+    return true;
+}
+
+std::string ProjectFile::GetImagePath() const {
+
+    const project_header& hdr = header_of(m_map);
+    std::string image_path(reinterpret_cast<const char*>(at(hdr.image_path_offset)), hdr.image_path_size);
+    if(osgDB::fileExists(image_path)) return image_path;
+
+    // the project and the image have been moved together
+    std::string moved = osgDB::concatPaths(osgDB::getFilePath(m_path), osgDB::getSimpleFileName(image_path));
+    return osgDB::fileExists(moved) ? moved : image_path;
+}
+
+double ProjectFile::GetFovy() const {
+    return header_of(m_map).fovy;
+}
+
+double ProjectFile::GetNear() const {
+    return header_of(m_map).near;
+}
+
+double ProjectFile::GetFar() const {
+    return header_of(m_map).far;
+}
+
+int ProjectFile::GetWidth() const {
+    return header_of(m_map).width;
+}
+
+int ProjectFile::GetHeight() const {
+    return header_of(m_map).height;
+}
+
+size_t ProjectFile::GetNumberOfComponents() const {
+    return static_cast<size_t>(header_of(m_map).num_components);
+}
+
+unsigned int ProjectFile::GetComponentId(size_t i) const {
+    return reinterpret_cast<const project_component*>(at(header_of(m_map).components_offset))[i].component_id;
+}
+
+GeneralizedCylinder* ProjectFile::CreateComponent(size_t i) const {
+
+    const project_header& hdr = header_of(m_map);
+    const project_component& rec = reinterpret_cast<const project_component*>(at(hdr.components_offset))[i];
+    const double* centers = reinterpret_cast<const double*>(at(hdr.sections_offset));
+    const double* normals = centers + 3 * hdr.num_sections;
+    const double* radii = normals + 3 * hdr.num_sections;
+
+    // the sections are filled in at once and the geometry is built once, as for the sampled splines
+    osg::Vec4 color(rec.color[0], rec.color[1], rec.color[2], rec.color[3]);
+    GeneralizedCylinder* gcyl = new GeneralizedCylinder(rec.component_id, static_cast<rendering_type>(rec.rtype), rec.num_points, color);
+    SectionStore& sections = gcyl->GetGeometry()->GetSections();
+    sections.reserve(rec.num_sections);
+    for(uint64_t j = rec.first_section; j < rec.first_section + rec.num_sections; ++j)
+        sections.push_back(Circle3D(Eigen::Map<const Eigen::Vector3d>(centers + 3 * j),
+                                    Eigen::Map<const Eigen::Vector3d>(normals + 3 * j), radii[j]));
+    gcyl->Recalculate();
+    return gcyl;
+}
+
+void ProjectFile::GetConstraints(std::vector<geosemcon>& constraints) const {
+
+    const project_header& hdr = header_of(m_map);
+    const project_constraint* records = reinterpret_cast<const project_constraint*>(at(hdr.constraints_offset));
+    constraints.reserve(constraints.size() + hdr.num_constraints);
+    for(uint64_t i = 0; i < hdr.num_constraints; ++i) {
+        std::vector<geosemantic_constraints> gsc;
+        for(int c = 0; c <= to_int(geosemantic_constraints::coplanar_axes); ++c)
+            if(records[i].constraints & (1u << c))
+                gsc.push_back(static_cast<geosemantic_constraints>(c));
+        if(!gsc.empty()) constraints.push_back(geosemcon(records[i].component_1, records[i].component_2, gsc));
+    }
+}
+
+unsigned int ProjectFile::GetActiveComponentId() const {
+    return header_of(m_map).active_component;
+}
+
+void ProjectFile::GetActiveSegments(std::vector<Segment2D>& segments) const {
+
+    const project_header& hdr = header_of(m_map);
+    const double* pts = reinterpret_cast<const double*>(at(hdr.segments_offset));
+    segments.reserve(segments.size() + hdr.num_segments);
+    for(uint64_t i = 0; i < hdr.num_segments; ++i, pts += 4)
+        segments.push_back(Segment2D(osg::Vec2d(pts[0], pts[1]), osg::Vec2d(pts[2], pts[3])));
+}
+
+bool ProjectFile::HasGradientImage() const {
+    return header_of(m_map).gradient_width > 0 && header_of(m_map).gradient_height > 0;
+}
+
+OtbImageType::Pointer ProjectFile::GetGradientImage() const {
+
+    if(!HasGradientImage()) return nullptr;
+    const project_header& hdr = header_of(m_map);
+    OtbImageType::Pointer gimg = OtbImageType::New();
+    OtbImageType::IndexType start;
+    start.Fill(0);
+    OtbImageType::SizeType size;
+    size[0] = hdr.gradient_width;
+    size[1] = hdr.gradient_height;
+    OtbImageType::RegionType region;
+    region.SetIndex(start);
+    region.SetSize(size);
+    gimg->SetRegions(region);
+    gimg->Allocate();
+    std::memcpy(gimg->GetBufferPointer(), at(hdr.gradient_offset),
+                static_cast<size_t>(hdr.gradient_width) * hdr.gradient_height * sizeof(OtbImageType::PixelType));
+    return gimg;
+}
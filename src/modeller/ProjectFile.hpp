@@ -0,0 +1,89 @@
+#ifndef PROJECT_FILE_HPP
+#define PROJECT_FILE_HPP
+
+#include "../image/algorithms/Algorithms.hpp"
+#include "../geometry/Segment2D.hpp"
+#include "components/GeneralizedCylinder.hpp"
+#include "optimization/Constraints.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ProjectionParameters;
+
+/*
+ * Binary project file (.cvmproj) of a modelling session.
+ *
+ * SaveModel only writes the geometry of the components, a project file holds what the modeller
+ * needs to continue the session: the path of the image, the projection parameters, the sections
+ * of the generalized cylinders, the geosemantic constraints between them, the axis segments of the
+ * active component and the gradient image, which is thus not recomputed if the gradient cache has
+ * been cleared or the project is opened on another machine.
+ *
+ * The file is a fixed size header and tables at the offsets given in the header, in the byte
+ * order of the host (as the compact model files): the components (id, rendering type, points per
+ * section, color and their range of sections), the sections as three arrays (centers, normals,
+ * radii), the constraints (the pair of ids and a bit per geosemantic constraint), the segments and
+ * the rows of the gradient image at a page aligned offset. A reader rejects a file of another
+ * version, a version with other tables gets a new number and offsets of its own.
+ *
+ * Open maps the file and only checks the header and the bounds of the tables, the components are
+ * created from the mapping one at a time by CreateComponent when they are needed (the frame does it
+ * in batches while idle), the mapping is released by Close or the destructor.
+ */
+class ProjectFile {
+public:
+    static const unsigned int version = 1;
+
+    // what a project is written from
+    struct contents {
+        std::string image_path;
+        const ProjectionParameters* pp;
+        std::vector<const GeneralizedCylinder*> components;
+        std::vector<geosemcon> constraints;
+        unsigned int active_component;              // id of the component being modelled, 0 if none
+        std::vector<Segment2D> active_segments;     // its axis segments in projected coordinates
+        OtbImageType::Pointer gradient;             // may be null
+    };
+
+    static bool Write(const std::string& path, const contents& project);
+
+    ProjectFile();
+    ~ProjectFile();
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_map != nullptr; }
+
+    // the image path as it is written, or the file of the same name next to the project file
+    std::string GetImagePath() const;
+    double GetFovy() const;
+    double GetNear() const;
+    double GetFar() const;
+    int GetWidth() const;
+    int GetHeight() const;
+
+    size_t GetNumberOfComponents() const;
+    unsigned int GetComponentId(size_t i) const;
+    // a new generalized cylinder with the sections of the component i
+    GeneralizedCylinder* CreateComponent(size_t i) const;
+    void GetConstraints(std::vector<geosemcon>& constraints) const;
+    unsigned int GetActiveComponentId() const;
+    void GetActiveSegments(std::vector<Segment2D>& segments) const;
+    bool HasGradientImage() const;
+    // a copy of the mapped rows, the image outlives the mapping
+    OtbImageType::Pointer GetGradientImage() const;
+
+private:
+    std::string m_path;
+    void* m_map;
+    size_t m_map_size;
+
+    ProjectFile(const ProjectFile&) = delete;
+    ProjectFile& operator=(const ProjectFile&) = delete;
+
+    const unsigned char* at(unsigned long long offset) const;
+    bool validate() const;
+};
+
+#endif // PROJECT_FILE_HPP
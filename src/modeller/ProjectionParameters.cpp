@@ -6,6 +6,20 @@ ProjectionParameters::ProjectionParameters(double fy, int w, int h, double n, do
 
     aspect = static_cast<double>(width) / static_cast<double>(height);
     c1 = (near * tan(deg2rad(fovy/2.0)));
+
+    // vp = log - size/2, ndc = 2/size vp, prj = ndc (aspect c1, c1)
+    m_log_to_prj[0] = 2.0 * aspect * c1 / static_cast<double>(width);
+    m_log_to_prj[1] = -aspect * c1;
+    m_log_to_prj[2] = 2.0 * c1 / static_cast<double>(height);
+    m_log_to_prj[3] = -c1;
+    m_prj_to_log[0] = 1.0 / m_log_to_prj[0];
+    m_prj_to_log[1] = static_cast<double>(width) / 2.0;
+    m_prj_to_log[2] = 1.0 / m_log_to_prj[2];
+    m_prj_to_log[3] = static_cast<double>(height) / 2.0;
+}
+
+double ProjectionParameters::fovy_of_focal_length(double focal_length, int h) {
+    return rad2deg(2.0 * std::atan(0.5 * static_cast<double>(h) / focal_length));
 }
 
 void ProjectionParameters::convert_from_image_coordinates_to_logical_device_coordinates(const osg::Vec2d& img_coord, osg::Vec2d& log_coord) {
@@ -56,33 +70,28 @@ void ProjectionParameters::convert_from_normalized_device_coordinates_to_project
     prj_coord.y() = ndc_coord.y() * c1;
 }
 
-void ProjectionParameters::convert_from_logical_device_coordinates_to_projected_coordinates(const osg::Vec2d& log_coord, osg::Vec2d& prj_coord) {
+void ProjectionParameters::convert_from_logical_device_coordinates_to_projected_coordinates(const osg::Vec2d* log_coords, osg::Vec2d* prj_coords, size_t n) const {
 
-    // logical device coord >> viewport coordinates
-    osg::Vec2d vp_coord, ndc_coord;
-    convert_from_logical_device_coordinates_to_viewport_coordinates(log_coord, vp_coord);
-    // viewport coord >> normalized device coordinates
-    convert_from_viewport_coordinates_to_normalized_device_coordinates(vp_coord, ndc_coord);
-    // normalized device coord >> projected coordinates
-    convert_from_normalized_device_coordinates_to_projected_coordinates(ndc_coord, prj_coord);
+    const double sx = m_log_to_prj[0], tx = m_log_to_prj[1], sy = m_log_to_prj[2], ty = m_log_to_prj[3];
+    for(size_t i = 0; i < n; ++i) {
+        prj_coords[i].x() = sx * log_coords[i].x() + tx;
+        prj_coords[i].y() = sy * log_coords[i].y() + ty;
+    }
 }
 
-void ProjectionParameters::convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(const Ellipse2D& elp_dev, Ellipse2D& elp_prj,  bool with_coeffs) {
+void ProjectionParameters::convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(const Ellipse2D& elp_dev, Ellipse2D& elp_prj) {
 
     // rot angle (angle between the major axis and the positive x-axis) does not change
     elp_prj.rot_angle = elp_dev.rot_angle;
 
-    for(size_t i = 0; i < 4; ++i)
-        convert_from_logical_device_coordinates_to_projected_coordinates(elp_dev.points[i], elp_prj.points[i]);
+    convert_from_logical_device_coordinates_to_projected_coordinates(elp_dev.points, elp_prj.points, 4);
 
-    // calculate the remaining parameters and the coefficients
+    // calculate the remaining parameters, the coefficients follow on their first access
     elp_prj.center.x() = (elp_prj.points[0].x() + elp_prj.points[1].x())/2.0;
     elp_prj.center.y() = (elp_prj.points[0].y() + elp_prj.points[1].y())/2.0;
     elp_prj.smj_axis = (elp_prj.points[0] - elp_prj.center).length();
     elp_prj.smn_axis = (elp_prj.points[2] - elp_prj.center).length();
-
-    if(with_coeffs)
-        elp_prj.calculate_coefficients_from_parameters();
+    elp_prj.calculate_coefficients_from_parameters();
 }
 
 void ProjectionParameters::convert_segment_from_logical_device_coordinates_to_projected_coordinates(const Segment2D& seg_dev, Segment2D& seg_prj) {
@@ -91,7 +100,7 @@ void ProjectionParameters::convert_segment_from_logical_device_coordinates_to_pr
     convert_from_logical_device_coordinates_to_projected_coordinates(seg_dev.pt2, seg_prj.pt2);
 }
 
-void ProjectionParameters::construct_perpective_projection_matrix(osg::Matrixd& proj_mat) {
+void ProjectionParameters::construct_perpective_projection_matrix(osg::Matrixd& proj_mat) const {
 
     proj_mat = osg::Matrixd::identity();
     double half_fov = deg2rad(0.5*fovy);
@@ -103,7 +112,7 @@ void ProjectionParameters::construct_perpective_projection_matrix(osg::Matrixd&
     proj_mat(3,3) = 0;
 }
 
-void ProjectionParameters::construct_viewport_mapping_matrix(osg::Matrixd& vp_mat) {
+void ProjectionParameters::construct_viewport_mapping_matrix(osg::Matrixd& vp_mat) const {
 
     double fVal = 1.0;
     double nVal = 0.0;
@@ -45,6 +45,9 @@ struct ProjectionParameters {
 
     ProjectionParameters(double fy, int w, int h, double n, double f);
 
+    // vertical field of view of a calibrated camera, the focal length is in pixels
+    static double fovy_of_focal_length(double focal_length, int h);
+
     // logical device coordinates <<->> image coordinates
     inline void convert_from_image_coordinates_to_logical_device_coordinates(const osg::Vec2d& img_coord, osg::Vec2d& log_coord);
     inline void convert_from_logical_device_coordinates_to_image_coordinates(const osg::Vec2d& log_coord, osg::Vec2d& img_coord);
@@ -61,19 +64,30 @@ struct ProjectionParameters {
     inline void convert_from_normalized_device_coordinates_to_projected_coordinates(const osg::Vec2d& ndc_coord, osg::Vec2d& prj_coord);
     inline void convert_from_projected_coordinates_to_normalized_device_coordinates(const osg::Vec2d& prj_coord, osg::Vec2d& ndc_coord);
 
-    // combined transformations
-    void convert_from_logical_device_coordinates_to_projected_coordinates(const osg::Vec2d& log_coord, osg::Vec2d& prj_coord);
+    // combined transformations: the chain logical device >> viewport >> NDC >> projected is precomposed into
+    // one scale and offset per axis, a conversion is a multiply-add per coordinate
+    void convert_from_logical_device_coordinates_to_projected_coordinates(const osg::Vec2d& log_coord, osg::Vec2d& prj_coord) const {
+        prj_coord.x() = m_log_to_prj[0] * log_coord.x() + m_log_to_prj[1];
+        prj_coord.y() = m_log_to_prj[2] * log_coord.y() + m_log_to_prj[3];
+    }
+    void convert_from_projected_coordinates_to_logical_device_coordinates(const osg::Vec2d& prj_coord, osg::Vec2d& log_coord) const {
+        log_coord.x() = m_prj_to_log[0] * prj_coord.x() + m_prj_to_log[1];
+        log_coord.y() = m_prj_to_log[2] * prj_coord.y() + m_prj_to_log[3];
+    }
+    void convert_from_logical_device_coordinates_to_projected_coordinates(const osg::Vec2d* log_coords, osg::Vec2d* prj_coords, size_t n) const;
 
     // other conversions
-    void convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(const Ellipse2D& elp_dev, Ellipse2D& elp_prj, bool with_coeffs = true);
+    void convert_ellipse_from_logical_device_coordinates_to_projected_coordinates(const Ellipse2D& elp_dev, Ellipse2D& elp_prj);
     void convert_segment_from_logical_device_coordinates_to_projected_coordinates(const Segment2D& seg_dev, Segment2D& seg_prj);
 
     // perspective projection related functions
-    void construct_perpective_projection_matrix(osg::Matrixd& proj_mat);
-    void construct_viewport_mapping_matrix(osg::Matrixd& vp_mat);
+    void construct_perpective_projection_matrix(osg::Matrixd& proj_mat) const;
+    void construct_viewport_mapping_matrix(osg::Matrixd& vp_mat) const;
 
 private:
     double c1;
+    double m_log_to_prj[4];     // x scale, x offset, y scale, y offset
+    double m_prj_to_log[4];
 
 };
 
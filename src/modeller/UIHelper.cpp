@@ -6,8 +6,13 @@
 #include <memory>
 #include <osg/Geometry>
 
+// preallocated points of the axis drawing and of the projection arena, they grow if they are exceeded
+static const size_t axis_capacity = 512;
+static const size_t projection_capacity = 8192;
+static const size_t projection_arrays = 64;
+
 UIHelper::UIHelper(osg::Geode* geode) : m_geode(geode), m_sweepline_vertices(nullptr), m_first_elp_vertices(nullptr),
-    m_axis_vertices(nullptr), m_sweep_type(sweep_curve_type::line){
+    m_axis_vertices(nullptr), m_num_proj_arrays(0), m_sweep_type(sweep_curve_type::line){
 
     m_geode->addDrawable(initialize_first_ellipse_display());        // 0
     m_geode->addDrawable(initialize_axis_display());               // 1
@@ -20,6 +25,7 @@ UIHelper::UIHelper(osg::Geode* geode) : m_geode(geode), m_sweepline_vertices(nul
     else if(m_sweep_type == sweep_curve_type::ellipse)
         sweep_geom = initialize_sweep_ellipse_display();
     m_geode->addDrawable(sweep_geom);                               // 4
+    m_geode->addDrawable(initialize_projection_display());          // 5
 
     // for smooth lines
     m_geode->getOrCreateStateSet()->setMode(GL_LINE_SMOOTH, osg::StateAttribute::ON);
@@ -38,7 +44,7 @@ osg::Geometry* UIHelper::initialize_sweepline_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_sweepline_vertices = new osg::Vec2dArray(32);
+    m_sweepline_vertices = new osg::Vec2Array(32);
     geom->setVertexArray(m_sweepline_vertices);
 
     m_sweepline_arrays.push_back(new osg::DrawArrays(osg::PrimitiveSet::LINES));
@@ -72,7 +78,7 @@ osg::Geometry* UIHelper::initialize_sweep_ellipse_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_sweep_ellipse_vertices = new osg::Vec2dArray(74);
+    m_sweep_ellipse_vertices = new osg::Vec2Array(74);
     geom->setVertexArray(m_sweep_ellipse_vertices);
 
 
@@ -109,7 +115,7 @@ osg::Geometry* UIHelper::initialize_first_ellipse_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_first_elp_vertices = new osg::Vec2dArray(84);
+    m_first_elp_vertices = new osg::Vec2Array(84);
     geom->setVertexArray(m_first_elp_vertices);
 
     for(int i = 0; i < 2; ++i) {
@@ -151,7 +157,7 @@ osg::Geometry* UIHelper::initialize_second_ellipse_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_second_elp_vertices = new osg::Vec2dArray(84);
+    m_second_elp_vertices = new osg::Vec2Array(84);
     geom->setVertexArray(m_second_elp_vertices);
 
     for(int i = 0; i < 2; ++i) {
@@ -185,7 +191,8 @@ osg::Geometry* UIHelper::initialize_axis_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_axis_vertices = new osg::Vec2dArray;
+    m_axis_vertices = new osg::Vec2Array;
+    m_axis_vertices->reserve(axis_capacity);
     geom->setVertexArray(m_axis_vertices);
     m_axis_array = new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP);
     geom->addPrimitiveSet(m_axis_array);
@@ -211,7 +218,7 @@ osg::Geometry* UIHelper::initialize_ray_cast_display() {
     geom->setUseVertexBufferObjects(true);
     geom->setDataVariance(osg::Object::DYNAMIC);
 
-    m_ray_cast_vertices = new osg::Vec2dArray(44);
+    m_ray_cast_vertices = new osg::Vec2Array(44);
     geom->setVertexArray(m_ray_cast_vertices);
 
     for(int i = 0; i < 2; ++i) {
@@ -235,6 +242,30 @@ osg::Geometry* UIHelper::initialize_ray_cast_display() {
     return geom.release();
 }
 
+osg::Geometry* UIHelper::initialize_projection_display() {
+
+    // for projection display: line strips and line loops in a shared vertex array
+    m_proj_geometry = new osg::Geometry;
+    m_proj_geometry->setUseDisplayList(false);
+    m_proj_geometry->setUseVertexBufferObjects(true);
+    m_proj_geometry->setDataVariance(osg::Object::DYNAMIC);
+
+    m_proj_vertices = new osg::Vec2Array;
+    m_proj_vertices->reserve(projection_capacity);
+    m_proj_geometry->setVertexArray(m_proj_vertices);
+
+    m_proj_colors = new osg::Vec4Array;
+    m_proj_colors->reserve(projection_arrays);
+    m_proj_arrays.reserve(projection_arrays);
+    for(size_t i = 0; i < projection_arrays; ++i) {
+        m_proj_arrays.push_back(new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP));
+        m_proj_geometry->addPrimitiveSet(m_proj_arrays.back());
+        m_proj_colors->push_back(osg::Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    }
+    m_proj_geometry->setColorArray(m_proj_colors, osg::Array::BIND_PER_PRIMITIVE_SET);
+    return m_proj_geometry.get();
+}
+
 void UIHelper::Reset() {
 
     ResetSweepCurve();
@@ -245,23 +276,21 @@ void UIHelper::Reset() {
         (*it)->setCount(0);
     m_first_elp_vertices->dirty();
 
+    // the arena is rewound, its storage is kept
     for(auto it = m_proj_arrays.begin(); it != m_proj_arrays.end(); ++it)
         (*it)->setCount(0);
-
-    for(auto it = m_proj_vertices.begin(); it != m_proj_vertices.end(); ++it) {
-        (*it)->clear();
-        (*it)->dirty();
-    }
-    m_proj_vertices.clear();
-    m_proj_arrays.clear();
+    m_num_proj_arrays = 0;
+    m_proj_vertices->clear();
+    m_proj_vertices->dirty();
 
     m_axis_array->setCount(0);
     m_axis_vertices->clear();
     m_axis_vertices->dirty();
 
-    // for deleting the projected generalized cylinders if any
+    // for deleting the drawables added by others to m_geode if any
     // the numbers have to be updated if any other drawalble is added to the m_geode
-    m_geode->removeDrawables(5, m_geode->getNumDrawables() - 5);
+    if(m_geode->getNumDrawables() > 6)
+        m_geode->removeDrawables(6, m_geode->getNumDrawables() - 6);
 }
 
 void UIHelper::ResetSecondEllipse() {
@@ -303,7 +332,7 @@ void UIHelper::InitializeMajorAxisDrawing(const osg::Vec2d& pt, bool first) {
         m_first_elp_arrays[0]->setCount(2);
 
         // display a small circle at the first click(p0)
-        Ellipse2DLight tmp(3, 3, 0, pt);
+        Ellipse2D tmp(3, 3, 0, pt);
         tmp.generate_points_on_the_ellipse(m_first_elp_vertices, 44, 10);
         m_first_elp_arrays[3]->setFirst(44);
         m_first_elp_arrays[3]->setCount(10);
@@ -320,7 +349,7 @@ void UIHelper::InitializeMajorAxisDrawing(const osg::Vec2d& pt, bool first) {
         m_second_elp_arrays[0]->setCount(2);
 
         // display a small circle at the first click(p0)
-        Ellipse2DLight tmp(3, 3, 0, pt);
+        Ellipse2D tmp(3, 3, 0, pt);
         tmp.generate_points_on_the_ellipse(m_second_elp_vertices, 44, 10);
         m_second_elp_arrays[3]->setFirst(44);
         m_second_elp_arrays[3]->setCount(10);
@@ -349,19 +378,19 @@ void UIHelper::InitializeMinorAxisDrawing(const osg::Vec2d& pt, bool first) {
         m_first_elp_vertices->at(1) = pt;
 
         // display a small circle at the second clicked point (p1)
-        Ellipse2DLight tmp(3, 3, 0, pt);
+        Ellipse2D tmp(3, 3, 0, pt);
         tmp.generate_points_on_the_ellipse(m_first_elp_vertices, 54, 10);
         m_first_elp_arrays[4]->setFirst(54);
         m_first_elp_arrays[4]->setCount(10);
 
         // display a small cirle at the center of the ellipse
-        tmp.center = (m_first_elp_vertices->at(0) + m_first_elp_vertices->at(1)) / 2.0;
+        tmp.center = (osg::Vec2d(m_first_elp_vertices->at(0)) + osg::Vec2d(m_first_elp_vertices->at(1))) / 2.0;
         tmp.generate_points_on_the_ellipse(m_first_elp_vertices, 64, 10);
         m_first_elp_arrays[5]->setFirst(64);
         m_first_elp_arrays[5]->setCount(10);
 
         //display the minor axis guideline
-        osg::Vec2d vec1 = m_first_elp_vertices->at(1) - tmp.center;
+        osg::Vec2d vec1 = osg::Vec2d(m_first_elp_vertices->at(1)) - tmp.center;
         osg::Vec2d vec2(-vec1.y(), vec1.x());
         m_first_elp_vertices->at(2) = tmp.center - vec2;
         m_first_elp_vertices->at(3) = tmp.center + vec2;
@@ -381,19 +410,19 @@ void UIHelper::InitializeMinorAxisDrawing(const osg::Vec2d& pt, bool first) {
         m_second_elp_vertices->at(1) = pt;
 
         // display a small circle at the second clicked point (p1)
-        Ellipse2DLight tmp(3, 3, 0, pt);
+        Ellipse2D tmp(3, 3, 0, pt);
         tmp.generate_points_on_the_ellipse(m_second_elp_vertices, 54, 10);
         m_second_elp_arrays[4]->setFirst(54);
         m_second_elp_arrays[4]->setCount(10);
 
         // display a small cirle at the center of the ellipse
-        tmp.center = (m_second_elp_vertices->at(0) + m_second_elp_vertices->at(1)) / 2.0;
+        tmp.center = (osg::Vec2d(m_second_elp_vertices->at(0)) + osg::Vec2d(m_second_elp_vertices->at(1))) / 2.0;
         tmp.generate_points_on_the_ellipse(m_second_elp_vertices, 64, 10);
         m_second_elp_arrays[5]->setFirst(64);
         m_second_elp_arrays[5]->setCount(10);
 
         //display the minor axis guideline
-        osg::Vec2d vec1 = m_second_elp_vertices->at(1) - tmp.center;
+        osg::Vec2d vec1 = osg::Vec2d(m_second_elp_vertices->at(1)) - tmp.center;
         osg::Vec2d vec2(-vec1.y(), vec1.x());
         m_second_elp_vertices->at(2) = tmp.center - vec2;
         m_second_elp_vertices->at(3) = tmp.center + vec2;
@@ -413,7 +442,7 @@ void UIHelper::UpdateEllipse(const std::unique_ptr<Ellipse2D>& elp, bool first)
 
     if(first) {
         elp->generate_points_on_the_ellipse(m_first_elp_vertices, 4, 40);
-        Ellipse2DLight tmp(3, 3, 0, elp->points[2]);
+        Ellipse2D tmp(3, 3, 0, elp->points[2]);
         tmp.generate_points_on_the_ellipse(m_first_elp_vertices, 74, 10);
         m_first_elp_arrays[2]->setFirst(4);
         m_first_elp_arrays[2]->setCount(40);
@@ -421,7 +450,7 @@ void UIHelper::UpdateEllipse(const std::unique_ptr<Ellipse2D>& elp, bool first)
     }
     else {
         elp->generate_points_on_the_ellipse(m_second_elp_vertices, 4, 40);
-        Ellipse2DLight tmp(3, 3, 0, elp->points[2]);
+        Ellipse2D tmp(3, 3, 0, elp->points[2]);
         tmp.generate_points_on_the_ellipse(m_second_elp_vertices, 74, 10);
         m_second_elp_arrays[2]->setFirst(4);
         m_second_elp_arrays[2]->setCount(40);
@@ -447,7 +476,7 @@ void UIHelper::InitializeAxisDrawing(const std::unique_ptr<Ellipse2D>& ellipse)
         m_sweepline_arrays[0]->setCount(2);
 
         // display the center
-        Ellipse2DLight tmp(3, 3, 0, ellipse->center);
+        Ellipse2D tmp(3, 3, 0, ellipse->center);
         tmp.generate_points_on_the_ellipse(m_sweepline_vertices, 2, 10);
         m_sweepline_arrays[1]->setFirst(2);
         m_sweepline_arrays[1]->setCount(10);
@@ -482,7 +511,7 @@ void UIHelper::InitializeAxisDrawing(const std::unique_ptr<Ellipse2D>& ellipse)
         m_sweep_ellipse_arrays[1]->setCount(40);
 
         // display the center
-        Ellipse2DLight tmp(3, 3, 0, ellipse->center);
+        Ellipse2D tmp(3, 3, 0, ellipse->center);
         tmp.generate_points_on_the_ellipse(m_sweep_ellipse_vertices, 44, 10);
         m_sweep_ellipse_arrays[2]->setFirst(44);
         m_sweep_ellipse_arrays[2]->setCount(10);
@@ -508,7 +537,7 @@ void UIHelper::UpdateSweepCurve(const std::unique_ptr<Segment2D>& segment) {
     m_sweepline_vertices->at(0) = segment->pt1;
     m_sweepline_vertices->at(1) = segment->pt2;
 
-    Ellipse2DLight tmp(3, 3, 0, segment->mid_point());
+    Ellipse2D tmp(3, 3, 0, segment->mid_point());
     tmp.generate_points_on_the_ellipse(m_sweepline_vertices, 2, 10);
     tmp.center = segment->pt1;
     tmp.generate_points_on_the_ellipse(m_sweepline_vertices, 12, 10);
@@ -524,7 +553,7 @@ void UIHelper::UpdateSweepCurve(const std::unique_ptr<Ellipse2D>& ellipse) {
         m_sweepline_vertices->at(0) = ellipse->points[0];
         m_sweepline_vertices->at(1) = ellipse->points[1];
 
-        Ellipse2DLight tmp(3, 3, 0, ellipse->center);
+        Ellipse2D tmp(3, 3, 0, ellipse->center);
         tmp.generate_points_on_the_ellipse(m_sweepline_vertices, 2, 10);
         tmp.center = ellipse->points[0];
         tmp.generate_points_on_the_ellipse(m_sweepline_vertices, 12, 10);
@@ -545,7 +574,7 @@ void UIHelper::UpdateSweepCurve(const std::unique_ptr<Ellipse2D>& ellipse) {
         ellipse->generate_points_on_the_ellipse(m_sweep_ellipse_vertices, 4, 40);
 
         // display the center
-        Ellipse2DLight tmp(3, 3, 0, ellipse->center);
+        Ellipse2D tmp(3, 3, 0, ellipse->center);
         tmp.generate_points_on_the_ellipse(m_sweep_ellipse_vertices, 44, 10);
 
         // display p0
@@ -577,58 +606,58 @@ void UIHelper::AddAxisPoint(const osg::Vec2d& pt) {
 
 void UIHelper::DeleteLastAxisPoint() {
 
+    // the axis of a component restored from a project is not drawn
+    if(m_axis_vertices->empty()) return;
     m_axis_vertices->pop_back();
     m_axis_array->setFirst(0);
     m_axis_array->setCount(m_axis_vertices->size());
     m_axis_vertices->dirty();
 }
 
-void UIHelper::DisplayLineStrip(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color) {
-
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-    geom->setUseDisplayList(false);
-    geom->setUseVertexBufferObjects(true);
-    geom->setDataVariance(osg::Object::DYNAMIC);
+void UIHelper::GetAxisPoints(std::vector<osg::Vec2d>& pts) const {
+    pts.assign(m_axis_vertices->begin(), m_axis_vertices->end());
+}
 
-    osg::ref_ptr<osg::Vec2dArray> vertices = new osg::Vec2dArray(pts.begin(), pts.end());
-    m_proj_vertices.push_back(vertices);
-    geom->setVertexArray(vertices);
-    osg::ref_ptr<osg::DrawArrays>  darray = new osg::DrawArrays(osg::PrimitiveSet::LINE_STRIP);
-    m_proj_arrays.push_back(darray);
-    geom->addPrimitiveSet(darray);
+void UIHelper::SetAxisPoints(const std::vector<osg::Vec2d>& pts) {
 
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(color);
-    geom->setColorArray(colors, osg::Array::BIND_PER_PRIMITIVE_SET);
-    m_geode->addDrawable(geom.get());
+    m_axis_vertices->assign(pts.begin(), pts.end());
+    m_axis_array->setFirst(0);
+    m_axis_array->setCount(m_axis_vertices->size());
+    m_axis_vertices->dirty();
+}
 
-    darray->setFirst(0);
-    darray->setCount(pts.size());
-    vertices->dirty();
+void UIHelper::DisplayLineStrip(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color) {
+    display_projection(pts, color, osg::PrimitiveSet::LINE_STRIP);
 }
 
 void UIHelper::DisplayLineLoop(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color) {
+    display_projection(pts, color, osg::PrimitiveSet::LINE_LOOP);
+}
 
-    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
-    geom->setUseDisplayList(false);
-    geom->setUseVertexBufferObjects(true);
-    geom->setDataVariance(osg::Object::DYNAMIC);
-
-    osg::ref_ptr<osg::Vec2dArray> vertices = new osg::Vec2dArray(pts.begin(), pts.end());
-    m_proj_vertices.push_back(vertices);
-    geom->setVertexArray(vertices);
-    osg::ref_ptr<osg::DrawArrays>  darray = new osg::DrawArrays(osg::PrimitiveSet::LINE_LOOP);
-    m_proj_arrays.push_back(darray);
-    geom->addPrimitiveSet(darray);
+void UIHelper::display_projection(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color, GLenum mode) {
 
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(color);
-    geom->setColorArray(colors, osg::Array::BIND_PER_PRIMITIVE_SET);
-    m_geode->addDrawable(geom.get());
+    if(pts.empty()) return;
 
-    darray->setFirst(0);
+    // Step-1: a draw array from the pool, the pool only grows beyond its initial size
+    if(m_num_proj_arrays == m_proj_arrays.size()) {
+        m_proj_arrays.push_back(new osg::DrawArrays(mode));
+        m_proj_geometry->addPrimitiveSet(m_proj_arrays.back());
+        m_proj_colors->push_back(color);
+    }
+    osg::DrawArrays* darray = m_proj_arrays[m_num_proj_arrays];
+    (*m_proj_colors)[m_num_proj_arrays] = color;
+    ++m_num_proj_arrays;
+
+    // Step-2: the points are appended to the arena
+    size_t first = m_proj_vertices->size();
+    m_proj_vertices->insert(m_proj_vertices->end(), pts.begin(), pts.end());
+    darray->setMode(mode);
+    darray->setFirst(first);
     darray->setCount(pts.size());
-    vertices->dirty();
+    darray->dirty();
+    m_proj_colors->dirty();
+    m_proj_vertices->dirty();
+    m_proj_geometry->dirtyBound();
 }
 
 void UIHelper::DisplayRayCast(const osg::ref_ptr<osg::Vec2dArray>& pts) {
@@ -641,7 +670,7 @@ void UIHelper::DisplayRayCast(const osg::ref_ptr<osg::Vec2dArray>& pts) {
     m_ray_cast_arrays[1]->setFirst(2);
     m_ray_cast_arrays[1]->setCount(2);
 
-    Ellipse2DLight tmp(3, 3, 0, pts->at(4));
+    Ellipse2D tmp(3, 3, 0, pts->at(4));
     tmp.generate_points_on_the_ellipse(m_ray_cast_vertices, 4, 10);
     m_ray_cast_arrays[2]->setFirst(4);
     m_ray_cast_arrays[2]->setCount(10);
@@ -17,6 +17,19 @@ enum class sweep_curve_type : unsigned char {
     ellipse
 };
 
+/*
+ * 2D overlays of the drawing interface on the background geode.
+ *
+ * The overlays are updated on every mouse move, so none of them allocates there: every overlay
+ * is a geometry with a preallocated vertex array whose slots are overwritten in place, drawn from
+ * vertex buffer objects with dynamic data variance (no display lists to recompile). The axis
+ * drawing reserves room for its points up front. The line strips and loops of the projections
+ * share one arena: the points are appended to a single vertex array and the primitive sets come
+ * from a pool, Reset rewinds the arena and keeps its storage for the next gesture.
+ *
+ * The points of the modeller are in double precision, the vertex arrays are float: a point is
+ * converted once when it is written into its slot, the driver gets the arrays as they are.
+ */
 class UIHelper {
 public:
 
@@ -39,30 +52,36 @@ public:
     void DisplayLineLoop(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color);
     void DisplayRayCast(const osg::ref_ptr<osg::Vec2dArray>& pts);
     void DeleteLastAxisPoint();
+    // the drawn axis points, the last one is the candidate at the mouse
+    void GetAxisPoints(std::vector<osg::Vec2d>& pts) const;
+    void SetAxisPoints(const std::vector<osg::Vec2d>& pts);
 
 private:
 
     sweep_curve_type m_sweep_type;
-    osg::ref_ptr<osg::Vec2dArray>               m_sweep_ellipse_vertices; // for displaying the sweep ellipse
+    osg::ref_ptr<osg::Vec2Array>                m_sweep_ellipse_vertices; // for displaying the sweep ellipse
     std::vector<osg::ref_ptr<osg::DrawArrays>>  m_sweep_ellipse_arrays;   // draw arrays for sweep ellipse vertices
 
-    osg::ref_ptr<osg::Vec2dArray>               m_sweepline_vertices;     // for displaying the sweepline
+    osg::ref_ptr<osg::Vec2Array>                m_sweepline_vertices;     // for displaying the sweepline
     std::vector<osg::ref_ptr<osg::DrawArrays>>  m_sweepline_arrays;       // draw arrays for m_sweepline_vertices
 
-    osg::ref_ptr<osg::Vec2dArray>               m_second_elp_vertices;    // for displaying the second ellipse
+    osg::ref_ptr<osg::Vec2Array>                m_second_elp_vertices;    // for displaying the second ellipse
     std::vector<osg::ref_ptr<osg::DrawArrays>>  m_second_elp_arrays;      // draw arrays for second ellipse vertices
 
-    osg::ref_ptr<osg::Vec2dArray>               m_first_elp_vertices;     // for displaying the first ellipse
+    osg::ref_ptr<osg::Vec2Array>                m_first_elp_vertices;     // for displaying the first ellipse
     std::vector<osg::ref_ptr<osg::DrawArrays>>  m_first_elp_arrays;       // draw arrays for m_first_elp_vertices
 
-    osg::ref_ptr<osg::Vec2dArray>               m_axis_vertices;          // for displaying the base ellipse
+    osg::ref_ptr<osg::Vec2Array>                m_axis_vertices;          // for displaying the base ellipse
     osg::ref_ptr<osg::DrawArrays>               m_axis_array;             // draw arrays for m_first_elp_vertices
 
-    osg::ref_ptr<osg::Vec2dArray>               m_ray_cast_vertices;      // for displaying the ray_casts
+    osg::ref_ptr<osg::Vec2Array>                m_ray_cast_vertices;      // for displaying the ray_casts
     std::vector<osg::ref_ptr<osg::DrawArrays>>  m_ray_cast_arrays;        // draw arrays for m_ray_cast_vertices
 
-    std::vector<osg::ref_ptr<osg::Vec2dArray>>  m_proj_vertices;          // for displaying projections
-    std::vector<osg::ref_ptr<osg::DrawArrays>>  m_proj_arrays;            // draw arrays for m_proj_vertices
+    osg::ref_ptr<osg::Vec2Array>                m_proj_vertices;          // arena of the projection displays
+    osg::ref_ptr<osg::Vec4Array>                m_proj_colors;            // color of each draw array
+    std::vector<osg::ref_ptr<osg::DrawArrays>>  m_proj_arrays;            // pool of draw arrays for m_proj_vertices
+    size_t                                      m_num_proj_arrays;        // draw arrays in use
+    osg::ref_ptr<osg::Geometry>                 m_proj_geometry;
 
     inline osg::Geometry* initialize_sweepline_display();
     inline osg::Geometry* initialize_sweep_ellipse_display();
@@ -70,6 +89,8 @@ private:
     inline osg::Geometry* initialize_second_ellipse_display();
     inline osg::Geometry* initialize_axis_display();
     inline osg::Geometry* initialize_ray_cast_display();
+    inline osg::Geometry* initialize_projection_display();
+    void display_projection(const std::vector<osg::Vec2d>& pts, const osg::Vec4& color, GLenum mode);
 
     osg::Geode* m_geode;
 };
@@ -2,6 +2,8 @@
 #define COMPONENTBASE_HPP
 
 #include <osg/Group>
+#include <osg/Matrixd>
+#include <vector>
 
 class ComponentBase : public osg::Group {
 public:
@@ -11,6 +13,11 @@ public:
     virtual void DisplayVertexNormals(bool flag) = 0;
     virtual void Print() const;
 
+    // points along the axis of the component from the first to the last end, used by the model solver
+    virtual bool GetAxisPoints(std::vector<osg::Vec3d>& points) const { return false; }
+    // applies a similarity transformation (rotation, translation and uniform scale)
+    virtual void ApplyTransform(const osg::Matrixd& mat) { }
+
 protected:
 
     unsigned int m_component_id;                // id of the component
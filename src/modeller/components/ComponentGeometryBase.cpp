@@ -1,7 +1,11 @@
 #include "ComponentGeometryBase.hpp"
+#include "../../osg/OsgStateSetPool.hpp"
 #include <iostream>
 
-ComponentGeometryBase::ComponentGeometryBase(const osg::Vec4& color) {
+ComponentGeometryBase::ComponentGeometryBase(const osg::Vec4& color) :
+    m_revision(0),
+    m_color(color),
+    m_blend(false) {
 
     // general settings for dynamic modification
     setUseDisplayList(false);
@@ -16,24 +20,40 @@ ComponentGeometryBase::ComponentGeometryBase(const osg::Vec4& color) {
     m_normals = new osg::Vec3Array;
     setNormalArray(m_normals.get(), osg::Array::BIND_PER_VERTEX);
 
-    // set color
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
-    colors->push_back(color);
-    setColorArray(colors, osg::Array::BIND_OVERALL);
+    // the color is a shared state instead of a color array
+    update_state_set();
 }
 
 void ComponentGeometryBase::Update() {
     m_vertices->dirty();
+    ++m_revision;
 }
 
 void ComponentGeometryBase::SetColor(const osg::Vec4& color) {
-    osg::Vec4Array* colors = static_cast<osg::Vec4Array*>(getColorArray());
-    colors->back() = color;
+    m_color = color;
+    update_state_set();
     this->Update();
 }
 
-void ComponentGeometryBase::Print() const {
-    std::cout << "num_vertices: " << m_vertices->size() << std::endl;
+const osg::Vec4& ComponentGeometryBase::GetColor() const {
+    return m_color;
+}
+
+void ComponentGeometryBase::SetBlending(bool flag) {
+
+    if(m_blend == flag) return;
+    m_blend = flag;
+    update_state_set();
 }
 
+unsigned int ComponentGeometryBase::GetRevision() const {
+    return m_revision;
+}
 
+void ComponentGeometryBase::update_state_set() {
+    setStateSet(StateSetPool::Instance().Get(render_state(m_color, m_blend)));
+}
+
+void ComponentGeometryBase::Print() const {
+    std::cout << "num_vertices: " << m_vertices->size() << std::endl;
+}
@@ -8,10 +8,19 @@ public:
     ComponentGeometryBase(const osg::Vec4& color);
     virtual void Update();
     virtual void SetColor(const osg::Vec4& color);
+    const osg::Vec4& GetColor() const;
+    void SetBlending(bool flag);
+    unsigned int GetRevision() const;
     virtual void Print() const;
 protected:
     osg::ref_ptr<osg::Vec3Array> m_vertices;   // geometry
     osg::ref_ptr<osg::Vec3Array> m_normals;    // vertex normals for rendering
+    unsigned int m_revision;                   // incremented with every modification, for the derived data
+    osg::Vec4 m_color;
+    bool m_blend;
+
+    // the shared state set of the color, see StateSetPool
+    virtual void update_state_set();
 };
 
 #endif // COMPONENT_GEOMETRY_BASE_HPP
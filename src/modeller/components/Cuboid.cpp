@@ -0,0 +1,27 @@
+#include "Cuboid.hpp"
+
+Cuboid::Cuboid(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Vec3d& center, const osg::Vec3d& half_extents,
+               const osg::Quat& rotation, const osg::Vec4& color) :
+    PrimitiveComponent(component_id, instances, Matrix(center, half_extents, rotation), color) { }
+
+osg::Matrixd Cuboid::Matrix(const osg::Vec3d& center, const osg::Vec3d& half_extents, const osg::Quat& rotation) {
+
+    return osg::Matrixd::scale(half_extents) * osg::Matrixd::rotate(rotation) * osg::Matrixd::translate(center);
+}
+
+void Cuboid::Set(const osg::Vec3d& center, const osg::Vec3d& half_extents, const osg::Quat& rotation) {
+    SetMatrix(Matrix(center, half_extents, rotation));
+}
+
+osg::Vec3d Cuboid::GetCenter() const {
+    return GetMatrix().getTrans();
+}
+
+osg::Vec3d Cuboid::GetHalfExtents() const {
+
+    // the rows are the images of the unit axes
+    const osg::Matrixd& mat = GetMatrix();
+    return osg::Vec3d(osg::Vec3d(mat(0, 0), mat(0, 1), mat(0, 2)).length(),
+                      osg::Vec3d(mat(1, 0), mat(1, 1), mat(1, 2)).length(),
+                      osg::Vec3d(mat(2, 0), mat(2, 1), mat(2, 2)).length());
+}
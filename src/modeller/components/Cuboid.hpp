@@ -0,0 +1,21 @@
+#ifndef CUBOID_HPP
+#define CUBOID_HPP
+
+#include "PrimitiveComponent.hpp"
+#include <osg/Quat>
+
+/*
+ * Box with the given half extents along the axes of its rotation, the axis of the component is
+ * the third one (the half extents are scaled uniformly by the solutions of the model solver).
+ */
+class Cuboid : public PrimitiveComponent {
+public:
+    Cuboid(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Vec3d& center, const osg::Vec3d& half_extents, const osg::Quat& rotation,
+           const osg::Vec4& color = osg::Vec4(1.0f,1.0f,0.0f,0.2f));
+    void Set(const osg::Vec3d& center, const osg::Vec3d& half_extents, const osg::Quat& rotation);
+    osg::Vec3d GetCenter() const;
+    osg::Vec3d GetHalfExtents() const;
+    static osg::Matrixd Matrix(const osg::Vec3d& center, const osg::Vec3d& half_extents, const osg::Quat& rotation);
+};
+
+#endif // CUBOID_HPP
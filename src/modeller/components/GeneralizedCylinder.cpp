@@ -1,28 +1,28 @@
 
 #include "GeneralizedCylinder.hpp"
-#include "../../osg/OsgUtility.hpp"
+#include "GeneralizedCylinderLOD.hpp"
+#include "../../osg/OsgStateSetPool.hpp"
 #include "../../geometry/Circle3D.hpp"
+#include "../../utility/LatencyProbe.hpp"
 
 #include <osg/Geode>
-#include <osg/Switch>
-#include <osg/MatrixTransform>
 
 GeneralizedCylinder::GeneralizedCylinder(unsigned int component_id, rendering_type rtype, unsigned int numpoints_per_section, const osg::Vec4& color) :
     ComponentBase(component_id),
     m_geometry(new GeneralizedCylinderGeometry(numpoints_per_section, color, rtype)),
     m_snormals_color(osg::Vec4(1,1,0,1)),
     m_vnormals_color(osg::Vec4(1,1,1,1)),
-    m_snormals(new osg::Switch),
-    m_vnormals(new osg::Switch),
     m_display_section_normals(false),
-    m_display_vertex_normals(false) {
+    m_display_vertex_normals(false),
+    m_display_local_frames(false) {
 
-    // add the geometry
+    // add the geometry, the coarse levels of detail are selected while culling
     osg::Geode* geode = new osg::Geode;
     geode->addDrawable(m_geometry.get());
-    addChild(geode);
-    addChild(m_snormals.get());
-    addChild(m_vnormals.get());
+    osg::Group* lod = new osg::Group;
+    lod->addChild(geode);
+    lod->setCullCallback(new GeneralizedCylinderLOD(m_geometry.get()));
+    addChild(lod);
 }
 
 GeneralizedCylinder::GeneralizedCylinder(unsigned int component_id, const Circle3D& base_circle, rendering_type rtype, unsigned int numpoints_per_section, const osg::Vec4& color) :
@@ -30,53 +30,88 @@ GeneralizedCylinder::GeneralizedCylinder(unsigned int component_id, const Circle
     m_geometry(new GeneralizedCylinderGeometry(base_circle, numpoints_per_section, color, rtype)),
     m_snormals_color(osg::Vec4(1,1,0,1)),
     m_vnormals_color(osg::Vec4(1,1,1,1)),
-    m_snormals(new osg::Switch),
-    m_vnormals(new osg::Switch),
     m_display_section_normals(false),
-    m_display_vertex_normals(false) {
+    m_display_vertex_normals(false),
+    m_display_local_frames(false) {
 
-    // add the geometry
+    // add the geometry, the coarse levels of detail are selected while culling
     osg::Geode* geode = new osg::Geode;
     geode->addDrawable(m_geometry.get());
-    addChild(geode);
-
-    // add the section normal
-    add_to_section_normals(base_circle, 2);
-    addChild(m_snormals.get());
-
-    // add vertex normals
-    add_to_vertex_normals(0);
-    addChild(m_vnormals.get());
+    osg::Group* lod = new osg::Group;
+    lod->addChild(geode);
+    lod->setCullCallback(new GeneralizedCylinderLOD(m_geometry.get()));
+    addChild(lod);
 }
 
 void GeneralizedCylinder::SetSectionNormalsColor(const osg::Vec4& color) {
+
     m_snormals_color = color;
+    if(m_normals.valid()) m_normals->SetColors(m_vnormals_color, m_snormals_color);
 }
 
 void GeneralizedCylinder::SetVertexNormalsColor(const osg::Vec4& color) {
+
     m_vnormals_color = color;
+    if(m_normals.valid()) m_normals->SetColors(m_vnormals_color, m_snormals_color);
 }
 
 void GeneralizedCylinder::AddPlanarSection(const Circle3D& circle) {
 
-    m_geometry->AddPlanarSection(circle);                         // add the section
-    add_to_section_normals(circle, 2);                            // add the section normal
-    add_to_vertex_normals(m_geometry->GetNumberOfSections() - 1); // add vertex normals
+    LatencyProbe::Scope probe(latency_stage::geometry_update, "GeneralizedCylinder::AddPlanarSection");
+    m_geometry->AddPlanarSection(circle);
+    m_spline = SectionSpline();
+    SetTexture(nullptr);
+    update_normals();
 }
 
 void GeneralizedCylinder::Recalculate() {
 
-    // 1) Clear the existing geometry and section normals and vertex normals
+    LatencyProbe::Scope probe(latency_stage::geometry_update, "GeneralizedCylinder::Recalculate");
+
+    // 1) Clear the existing geometry
     Clear(false);
 
-    // 2) Recalculate the geometry
+    // 2) Recalculate the geometry, the normals are drawn from its sections
     m_geometry->Recalculate();
+    SetTexture(nullptr);
+    update_normals();
+}
+
+void GeneralizedCylinder::UpdateSections(size_t first) {
+
+    LatencyProbe::Scope probe(latency_stage::geometry_update, "GeneralizedCylinder::UpdateSections");
+    m_geometry->UpdateSections(first);
+    m_spline = SectionSpline();
+    SetTexture(nullptr);
+    update_normals();
+}
+
+bool GeneralizedCylinder::GetAxisPoints(std::vector<osg::Vec3d>& points) const {
 
-    // 3) Recalculate the vertex and section normals
-    for(int i = 0; i < m_geometry->GetSections().size(); ++i) {
-        add_to_section_normals(m_geometry->GetSections()[i], 2);
-        add_to_vertex_normals(i);
+    const SectionStore& sections = m_geometry->GetSections();
+    if(sections.size() < 2) return false;
+    for(size_t i = 0; i < sections.size(); ++i) {
+        const double* center = sections.center(i);
+        points.push_back(osg::Vec3d(center[0], center[1], center[2]));
     }
+    return true;
+}
+
+void GeneralizedCylinder::ApplyTransform(const osg::Matrixd& mat) {
+
+    double scale = mat.getScale().x();
+    SectionStore& sections = m_geometry->GetSections();
+    for(size_t i = 0; i < sections.size(); ++i) {
+        SectionStore::reference circle = sections[i];
+        osg::Vec3d center = osg::Vec3d(circle.center[0], circle.center[1], circle.center[2]) * mat;
+        osg::Vec3d normal = osg::Matrixd::transform3x3(osg::Vec3d(circle.normal[0], circle.normal[1], circle.normal[2]), mat);
+        normal.normalize();
+        circle.center = Eigen::Vector3d(center.x(), center.y(), center.z());
+        circle.normal = Eigen::Vector3d(normal.x(), normal.y(), normal.z());
+        circle.radius *= scale;
+    }
+    m_spline = SectionSpline();
+    Recalculate();
 }
 
 void GeneralizedCylinder::DeleteLastSection() {
@@ -84,62 +119,146 @@ void GeneralizedCylinder::DeleteLastSection() {
     // need a far better implementation but for now all the generalized cylinder is
     // recalculated.
     m_geometry->GetSections().pop_back();
+    m_spline = SectionSpline();
+    Recalculate();
+}
+
+bool GeneralizedCylinder::FitAxisSpline(double tolerance) {
+
+    return m_spline.Fit(m_geometry->GetSections(), tolerance);
+}
+
+bool GeneralizedCylinder::SampleAxisSpline(size_t num_sections) {
+
+    if(!m_spline.IsValid() || num_sections < 2) return false;
+    m_spline.Sample(num_sections, m_geometry->GetSections());
     Recalculate();
+    return true;
+}
+
+void GeneralizedCylinder::SetTexture(osg::Image* image) {
+
+    if(!image && !m_texture.valid()) return;
+    m_texture = image;
+    update_textured_mesh();
 }
 
 void GeneralizedCylinder::MakeTransparent() {
 
+    // one blending state set shared by all the transparent components, the colors are inherited
+    render_state state;
+    state.blend = true;
+    osg::StateSet* ss = StateSetPool::Instance().Get(state);
     unsigned int numch = getNumChildren();
-    for(int i = 0; i < numch; ++i) {
-        osg::Node* child = getChild(i);
-        osg::StateSet* pStateSet = child->getOrCreateStateSet();
-        pStateSet->setMode(GL_BLEND, osg::StateAttribute::ON);
-        pStateSet->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
-    }
+    for(int i = 0; i < numch; ++i)
+        getChild(i)->setStateSet(ss);
 }
 
 void GeneralizedCylinder::Clear(bool update_flag) {
 
-    m_snormals->removeChildren(0, m_snormals->getNumChildren());
-    m_vnormals->removeChildren(0, m_vnormals->getNumChildren());
     m_geometry->Clear(update_flag);
 }
 
 void GeneralizedCylinder::Update() {
+
+    LatencyProbe::Scope probe(latency_stage::geometry_update, "GeneralizedCylinder::Update");
     m_geometry->Update();
 }
 
 void GeneralizedCylinder::DisplaySectionNormals(bool flag) {
 
-    for(int i = 0;  i < m_snormals->getNumChildren(); ++i)
-        m_snormals->setValue(i, flag);
     m_display_section_normals = flag;
+    update_normals_display();
 }
 
 void GeneralizedCylinder::DisplayVertexNormals(bool flag) {
 
-    for(int i = 0;  i < m_snormals->getNumChildren(); ++i)
-        m_vnormals->setValue(i, flag);
     m_display_vertex_normals = flag;
+    update_normals_display();
+}
+
+void GeneralizedCylinder::DisplayLocalFrames(bool flag) {
+
+    m_display_local_frames = flag;
+    update_normals_display();
 }
 
 void GeneralizedCylinder::ChangeRenderingType(rendering_type rtype) {
 
     m_geometry->ChangeRenderingType(rtype);
     m_geometry->Update();
+    update_normals();
 }
 
-void GeneralizedCylinder::add_to_section_normals(const Circle3D& circle, unsigned int scale) {
+void GeneralizedCylinder::SetProceduralSweep(bool flag) {
+    m_geometry->SetProceduralSweep(flag);
+}
+
+void GeneralizedCylinder::update_normals_display() {
 
-    osg::Vec3d ctr(circle.center[0], circle.center[1], circle.center[2]);
-    osg::Vec3d nrm(circle.normal[0], circle.normal[1], circle.normal[2]);
-    nrm *= scale;
-    m_snormals->addChild(display_vector3d(ctr, nrm, m_snormals_color), m_display_section_normals);
+    bool display = m_display_section_normals || m_display_vertex_normals || m_display_local_frames;
+    if(!m_normals.valid()) {
+        if(!display) return;
+        m_normals = new GeneralizedCylinderNormals(m_geometry.get());
+        m_normals->SetColors(m_vnormals_color, m_snormals_color);
+        m_normals_geode = new osg::Geode;
+        m_normals_geode->addDrawable(m_normals.get());
+        addChild(m_normals_geode.get());
+    }
+
+    // the section frames are only maintained while something is displayed
+    m_geometry->SetSectionFrames(display);
+    m_normals->SetDisplay(m_display_vertex_normals, m_display_section_normals, m_display_local_frames);
+    m_normals->Update();
+    m_normals_geode->setNodeMask(display ? 0x1 : 0x0);
 }
 
-void GeneralizedCylinder::add_to_vertex_normals(size_t section_index) {
+void GeneralizedCylinder::update_normals() {
+
+    if(m_normals.valid() && m_normals_geode->getNodeMask() != 0x0) m_normals->Update();
+}
+
+void GeneralizedCylinder::update_textured_mesh() {
+
+    // the flat geometry is only drawn by the picking while the textured mesh is displayed, as the proxies of the primitives
+    osg::Node* flat = getChild(0);
+    if(!m_texture.valid()) {
+        if(m_textured_geode.valid()) {
+            removeChild(m_textured_geode.get());
+            m_textured_geode = nullptr;
+        }
+        m_texture_object = nullptr;
+        flat->setNodeMask(~0u);
+        return;
+    }
 
     osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
-    m_geometry->GetVertexNormals(section_index, vertices.get());
-    m_vnormals->addChild(display_lines(vertices.get(), m_vnormals_color), m_display_vertex_normals);
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+    std::vector<unsigned int> triangles;
+    m_geometry->GetTexturedMesh(vertices.get(), normals.get(), texcoords.get(), triangles);
+
+    m_texture_object = new osg::Texture2D(m_texture.get());
+    m_texture_object->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+    m_texture_object->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    m_texture_object->setResizeNonPowerOfTwoHint(false);
+
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+    geom->setUseDisplayList(false);
+    geom->setUseVertexBufferObjects(true);
+    geom->setVertexArray(vertices.get());
+    geom->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    geom->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+    geom->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, triangles.begin(), triangles.end()));
+    geom->getOrCreateStateSet()->setTextureAttributeAndModes(0, m_texture_object.get(), osg::StateAttribute::ON);
+
+    if(!m_textured_geode.valid()) {
+        m_textured_geode = new osg::Geode;
+        m_textured_geode->setNodeMask(0x1);
+        m_textured_geode->setStateSet(StateSetPool::Instance().Get(render_state(osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f))));
+        addChild(m_textured_geode.get());
+    }
+    m_textured_geode->removeDrawables(0, m_textured_geode->getNumDrawables());
+    m_textured_geode->addDrawable(geom.get());
+    flat->setNodeMask(0x2);
 }
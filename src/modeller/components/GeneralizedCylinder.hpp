@@ -3,6 +3,10 @@
 
 #include "ComponentBase.hpp"
 #include "GeneralizedCylinderGeometry.hpp"
+#include "GeneralizedCylinderNormals.hpp"
+#include "../../geometry/SectionSpline.hpp"
+#include <osg/Image>
+#include <osg/Texture2D>
 
 class GeneralizedCylinder : public ComponentBase {
 public:
@@ -13,27 +17,49 @@ public:
     void AddPlanarSection(const Circle3D& circle);
     void DisplaySectionNormals(bool flag);
     void DisplayVertexNormals(bool flag) override;
+    void DisplayLocalFrames(bool flag);
+    bool GetAxisPoints(std::vector<osg::Vec3d>& points) const override;
+    void ApplyTransform(const osg::Matrixd& mat) override;
     void ChangeRenderingType(rendering_type rtype);
+    void SetProceduralSweep(bool flag);
     void SetSectionNormalsColor(const osg::Vec4& color);
     void SetVertexNormalsColor(const osg::Vec4& color);
     void Update();
     void Clear(bool update_flag);
     void Recalculate();
+    // incremental Recalculate after the sections from the first one on have been edited
+    void UpdateSections(size_t first);
     void DeleteLastSection();
     void MakeTransparent();
+    // compact axis: the spline of the current sections, dropped when the sections are edited
+    bool FitAxisSpline(double tolerance);
+    const SectionSpline& GetAxisSpline() const { return m_spline; }
+    // the sections are replaced by samples of the spline
+    bool SampleAxisSpline(size_t num_sections);
+    // baked texture of the side surface (see OsgTextureBaker), dropped when the sections are edited; nullptr drops it
+    void SetTexture(osg::Image* image);
+    osg::Image* GetTexture() const { return m_texture.get(); }
+    // the texture of the display, its image may be replaced by a compressed one (see OsgTextureCompressor)
+    osg::Texture2D* GetTextureObject() { return m_texture_object.get(); }
     const GeneralizedCylinderGeometry* const GetGeometry() const { return m_geometry.get(); }
     GeneralizedCylinderGeometry* GetGeometry()                   { return m_geometry.get(); }
 protected:
     osg::ref_ptr<GeneralizedCylinderGeometry> m_geometry;
-    osg::ref_ptr<osg::Switch> m_snormals;
-    osg::ref_ptr<osg::Switch> m_vnormals;
+    osg::ref_ptr<osg::Geode> m_normals_geode;                      // display only, created by the first display
+    osg::ref_ptr<GeneralizedCylinderNormals> m_normals;
     osg::Vec4 m_snormals_color;
     osg::Vec4 m_vnormals_color;
     bool m_display_section_normals;
     bool m_display_vertex_normals;
+    bool m_display_local_frames;
+    SectionSpline m_spline;
+    osg::ref_ptr<osg::Image> m_texture;
+    osg::ref_ptr<osg::Texture2D> m_texture_object;
+    osg::ref_ptr<osg::Geode> m_textured_geode;                     // display only, while there is a texture
 private:
-    inline void add_to_section_normals(const Circle3D& circle, unsigned int scale = 1);
-    inline void add_to_vertex_normals(size_t section_index);
+    void update_normals_display();
+    void update_textured_mesh();
+    inline void update_normals();
 };
 
 #endif // GENERALIZEDCYLINDER_HPP
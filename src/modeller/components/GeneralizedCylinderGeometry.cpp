@@ -1,32 +1,135 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include "GeneralizedCylinderGeometry.hpp"
 #include "../../osg/OsgUtility.hpp"
+#include "../../osg/OsgStateSetPool.hpp"
 #include "../../geometry/Circle3D.hpp"
+#include "../../geometry/SectionSimplifier.hpp"
+#include "../../utility/Utility.hpp"
+#include "../../utility/ThreadPool.hpp"
 
 #include <osg/Geode>
 #include <osg/LineWidth>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+
+// sections per task of the parallel expansion, smaller sweeps are written by the calling thread
+static const size_t parallel_sections_grain = 64;
+
+// vertex kinds of the sweep template
+static const float sweep_radial = 0.0f;    // circle point with radial normal
+static const float sweep_planar = 1.0f;    // circle point with the section normal
+static const float sweep_center = 2.0f;    // center with the section normal
+
+// texels per section in the section texture: (center, radius), u, v, normal
+static const int sweep_texels_per_section = 4;
+static const int sweep_initial_capacity = 16;
+
+static const char* sweep_vertex_shader =
+    "#version 130\n"
+    "#extension GL_ARB_draw_instanced : require\n"
+    "uniform sampler2D sections;\n"
+    "uniform int num_points;\n"
+    "uniform bool picking;\n"
+    "uniform vec4 pick_color;\n"
+    "uniform vec4 component_color;\n"
+    "void main() {\n"
+    "    int section = gl_InstanceIDARB + int(gl_Vertex.y + 0.5);\n"
+    "    int kind = int(gl_Vertex.z + 0.5);\n"
+    "    float t = 6.28318530717958647692 * gl_Vertex.x / float(num_points);\n"
+    "    vec3 center = texelFetch(sections, ivec2(0, section), 0).xyz;\n"
+    "    vec3 u = texelFetch(sections, ivec2(1, section), 0).xyz;\n"
+    "    vec3 v = texelFetch(sections, ivec2(2, section), 0).xyz;\n"
+    "    vec3 normal = texelFetch(sections, ivec2(3, section), 0).xyz;\n"
+    "    vec3 radial = cos(t) * u + sin(t) * v;\n"
+    "    vec3 pos = (kind == 2) ? center : center + radial;\n"
+    "    vec3 nrm = (kind == 0) ? normalize(radial) : normal;\n"
+    "    vec3 n = normalize(gl_NormalMatrix * nrm);\n"
+    "    vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+    "    float diffuse = abs(dot(n, l));\n"
+    "    gl_FrontColor = picking ? pick_color : vec4(component_color.rgb * (0.2 + 0.8 * diffuse), component_color.a);\n"
+    "    gl_BackColor = gl_FrontColor;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 1.0);\n"
+    "}\n";
+
+// the weighted color and the coverage for the order independent transparency pass of OsgWxFrame
+static const char* sweep_fragment_shader =
+    "#version 130\n"
+    "uniform bool oit;\n"
+    "void main() {\n"
+    "    if(!oit) {\n"
+    "        gl_FragData[0] = gl_Color;\n"
+    "        return;\n"
+    "    }\n"
+    "    float a = gl_Color.a;\n"
+    "    float d = 1.0 - 0.9 * gl_FragCoord.z;\n"
+    "    float w = clamp(pow(min(1.0, 10.0 * a) + 0.01, 3.0) * 1e8 * d * d * d, 1e-2, 3e3);\n"
+    "    gl_FragData[0] = vec4(gl_Color.rgb * a, a) * w;\n"
+    "    gl_FragData[1] = vec4(a);\n"
+    "}\n";
+
+static osg::Program* create_sweep_program() {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, sweep_vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, sweep_fragment_shader));
+    return program;
+}
+
+// shared by all the generalized cylinders, created once also by the parallel batch jobs
+static osg::Program* sweep_program() {
+
+    static osg::ref_ptr<osg::Program> program = create_sweep_program();
+    return program.get();
+}
+
+// the vertex array holds the template, the bounding box is calculated from the sections
+struct sweep_bounding_box_callback : public osg::Drawable::ComputeBoundingBoxCallback {
+    osg::BoundingBox computeBound(const osg::Drawable& drawable) const override {
+        const GeneralizedCylinderGeometry* geom = dynamic_cast<const GeneralizedCylinderGeometry*>(&drawable);
+        return geom ? geom->ComputeSweepBoundingBox() : osg::BoundingBox();
+    }
+};
 
 GeneralizedCylinderGeometry::GeneralizedCylinderGeometry(int num_points_per_section, const osg::Vec4& color, rendering_type rtype) :
     ComponentGeometryBase(color),
     m_numpts(num_points_per_section),
-    m_rtype(rtype) { }
+    m_rtype(rtype),
+    m_ring(RingTable::Get(num_points_per_section)),
+    m_num_expanded_sections(0),
+    m_procedural(false),
+    m_section_frames(false),
+    m_memory(memory_category::geometry) {
+
+    create_primitive_sets();
+}
 
 GeneralizedCylinderGeometry::GeneralizedCylinderGeometry(const Circle3D& base_circle, int num_points_per_section, const osg::Vec4& color, rendering_type rtype) :
     ComponentGeometryBase(color),
-    m_sections {base_circle},
+    m_sections(base_circle),
     m_numpts(num_points_per_section),
-    m_rtype(rtype) {
+    m_rtype(rtype),
+    m_ring(RingTable::Get(num_points_per_section)),
+    m_num_expanded_sections(0),
+    m_procedural(false),
+    m_section_frames(false),
+    m_memory(memory_category::geometry) {
+
+    create_primitive_sets();
 
     // update geometry (vertices and normals) and indices
-    update_geometry_and_indices(0, base_circle);
+    update_geometry_and_indices(0);
 }
 
-const std::vector<Circle3D>& GeneralizedCylinderGeometry::GetSections() const {
+const SectionStore& GeneralizedCylinderGeometry::GetSections() const {
     return m_sections;
 }
 
-std::vector<Circle3D>& GeneralizedCylinderGeometry::GetSections() {
+SectionStore& GeneralizedCylinderGeometry::GetSections() {
     return m_sections;
 }
 
@@ -36,8 +139,60 @@ unsigned int GeneralizedCylinderGeometry::GetNumberOfSections() const {
 
 void GeneralizedCylinderGeometry::Recalculate() {
 
+    // Step-1: the axes are transported along the sweep, the only sequential part
+    ++m_revision;
     for(size_t i = 0; i < m_sections.size(); ++i)
-        update_geometry_and_indices(i, m_sections[i]);
+        update_section_axis(i);
+
+    // Step-2: all the sections at once, either into the section texture or into the vertex buffer
+    if(m_procedural) {
+        for(size_t i = 0; i < m_sections.size(); ++i)
+            update_section_frame(i);
+        m_num_expanded_sections = 0;
+        removePrimitiveSet(0, getNumPrimitiveSets());
+        update_sweep_instances();
+        attach_primitive_sets();
+    }
+    else {
+        if(m_section_frames) {
+            for(size_t i = 0; i < m_sections.size(); ++i)
+                update_section_frame(i);
+        }
+        m_num_expanded_sections = 0;
+        expand_sections();
+    }
+    Update();
+}
+
+void GeneralizedCylinderGeometry::UpdateSections(size_t first) {
+
+    // Step-1: the axes are transported from the first edited section on, the ones before are kept
+    ++m_revision;
+    m_axes.resize(m_sections.size());
+    for(size_t i = first; i < m_sections.size(); ++i)
+        update_section_axis(i);
+
+    // Step-2: the frames or the vertices of the edited sections, the arrays are cut at the first one
+    if(m_procedural || m_section_frames) {
+        for(size_t i = first; i < m_sections.size(); ++i)
+            update_section_frame(i);
+    }
+    if(m_procedural) {
+        m_num_expanded_sections = std::min(m_num_expanded_sections, first);
+        removePrimitiveSet(0, getNumPrimitiveSets());
+        update_sweep_instances();
+        attach_primitive_sets();
+    }
+    else {
+        if(m_num_expanded_sections > first) resize_section_geometry(first);
+        expand_sections();
+        m_vertices->dirty();
+        m_normals->dirty();
+        m_hindices->dirty();
+        m_vindices->dirty();
+        m_findices->dirty();
+        m_tindices->dirty();
+    }
     Update();
 }
 
@@ -45,12 +200,13 @@ void GeneralizedCylinderGeometry::Clear(bool update_flag) {
 
     m_vertices->clear();
     m_normals->clear();
-    for(int i = 0; i < m_hindices.size(); ++i) m_hindices[i]->clear();
-    for(int i = 0; i < m_vindices.size(); ++i) m_vindices[i]->clear();
-    for(int i = 0; i < m_tindices.size(); ++i) m_tindices[i]->clear();
-    m_hindices.clear();
-    m_vindices.clear();
-    m_tindices.clear();
+    m_hindices->clear();
+    m_vindices->clear();
+    m_findices->clear();
+    m_tindices->clear();
+    m_num_expanded_sections = 0;
+    report_memory();
+    ++m_revision;
     if(update_flag) Update();
 }
 
@@ -59,113 +215,101 @@ void GeneralizedCylinderGeometry::ChangeRenderingType(rendering_type rtype) {
     // Step-1: Desired rendering type must be different than the current one
     if(m_rtype == rtype) return;
 
-    // Step-2: Modify the geometry if necessary
-    if(m_rtype == rendering_type::triangle_fan) {
+    // Step-2: The vertex buffer is shared by all the rendering types, only the primitive sets are swapped
+    removePrimitiveSet(0, getNumPrimitiveSets());
+    m_rtype = rtype;
+    attach_primitive_sets();
+    ++m_revision;
+}
 
-        // delete the section centers
-        auto it1 = m_vertices->begin();
-        for(int i = 0; i < m_sections.size(); ++i) {
-            std::advance(it1, m_numpts);
-            it1 = m_vertices->erase(it1);
-        }
+rendering_type GeneralizedCylinderGeometry::GetRenderingType() const {
+    return m_rtype;
+}
 
-        // clear and regenerate the normals
-        m_normals->clear();
-        for(int i = 0; i < m_sections.size(); ++i) {
-            osg::Vec3 ctr(m_sections[i].center[0], m_sections[i].center[1], m_sections[i].center[2]);
-            for(int j = 0; j < m_numpts; ++j) {
-                osg::Vec3 nrm = m_vertices->at(j + i*m_numpts) - ctr;
-                nrm.normalize();
-                m_normals->push_back(nrm);
-            }
-        }
-    }
+int GeneralizedCylinderGeometry::GetNumberOfPointsPerSection() const {
+    return m_numpts;
+}
 
-    if(rtype == rendering_type::triangle_fan) {
-        // insert the section centers
-        auto it1 = m_vertices->begin();
-        for(int i = 0; i < m_sections.size(); ++i) {
-            i == 0 ? std::advance(it1, m_numpts) : std::advance(it1, m_numpts + 1);
-            it1 = m_vertices->insert(it1, osg::Vec3(m_sections[i].center[0], m_sections[i].center[1], m_sections[i].center[2]));
-        }
+void GeneralizedCylinderGeometry::SetProceduralSweep(bool flag) {
 
-        //clear and regenerate the normals
-        m_normals->clear();
-        for(int i = 0; i < m_sections.size(); ++i) {
-            osg::Vec3 nrm(m_sections[i].normal[0], m_sections[i].normal[1], m_sections[i].normal[2]);
-            for(int j = 0; j < m_numpts+1; ++j)
-                m_normals->push_back(nrm);
-        }
-    }
+    if(m_procedural == flag) return;
 
-    // Step-3: Clear and regenerate the indices
-    for(int i = 0; i < m_hindices.size(); ++i) m_hindices[i]->clear();
-    for(int i = 0; i < m_vindices.size(); ++i) m_vindices[i]->clear();
-    for(int i = 0; i < m_tindices.size(); ++i) m_tindices[i]->clear();
-    m_hindices.clear();
-    m_vindices.clear();
-    m_tindices.clear();
-
-    switch (rtype) {
-    case rendering_type::planar_sections: {
-        for(int i = 0; i < m_sections.size(); ++i) {
-            m_hindices.push_back(new osg::DrawElementsUInt(GL_LINE_LOOP));
-            addPrimitiveSet(m_hindices[i].get());
-            for(int j = 0; j < m_numpts; ++j)
-                m_hindices[i]->push_back(j + i * m_numpts);
-        }
-        break;
-    }
-    case rendering_type::planar_and_vertical_sections: {
-        for(int i = 0; i < m_sections.size(); ++i) {
-            m_hindices.push_back(new osg::DrawElementsUInt(GL_LINE_LOOP));
-            addPrimitiveSet(m_hindices[i].get());
-
-            if(i == 0) {
-                for(int j = 0; j < m_numpts; ++j) {
-                    m_vindices.push_back(new osg::DrawElementsUInt(GL_LINE_STRIP));
-                    addPrimitiveSet((m_vindices.back()).get());
-                }
-            }
-
-            for(int j = 0; j < m_numpts; ++j) {
-                m_hindices[i]->push_back(j + i * m_numpts);
-                m_vindices[j]->push_back(j + i * m_numpts);
-            }
-        }
-        break;
-    }
-    case rendering_type::triangle_fan: {
-        for(int i = 0; i < m_sections.size(); ++i) {
-            m_tindices.push_back(new osg::DrawElementsUInt(GL_TRIANGLE_FAN));
-            m_tindices[i]->push_back(i * m_numpts + i + m_numpts);
-            for(int j = 0; j < m_numpts; ++j)
-                m_tindices[i]->push_back(j + (m_numpts+1) * i);
-            m_tindices[i]->push_back((m_numpts+1)*i);
-            addPrimitiveSet(m_tindices[i].get());
-        }
-        break;
-    }
-    case rendering_type::triangle_strip: {
-        for(int i = 1; i < m_sections.size(); ++i) {
-            m_tindices.push_back(new osg::DrawElementsUInt(GL_TRIANGLE_STRIP));
-            int start_index = (i-1)*m_numpts;
-            for(int j = start_index; j < start_index + m_numpts; ++j) {
-                m_tindices[i-1]->push_back(j);
-                m_tindices[i-1]->push_back(j + m_numpts);
-            }
-            m_tindices[i-1]->push_back(start_index);
-            m_tindices[i-1]->push_back(start_index + m_numpts);
-            addPrimitiveSet(m_tindices[i-1].get());
-        }
-        break;
+    if(flag) {
+        // Step-1: upload the sections and swap the vertex buffer with the template
+        if(!m_template.valid()) create_sweep();
+        m_procedural = true;
+        for(size_t i = 0; i < m_sections.size(); ++i)
+            update_section_frame(i);
+        setVertexArray(m_template.get());
+        setNormalArray(nullptr);
+
+        // Step-2: the shader generates the vertices and the normals
+        update_state_set();
+        setComputeBoundingBoxCallback(new sweep_bounding_box_callback);
     }
-    default: {
-        std::cout << "ERROR: Unknown render type" << std::endl;
-        break;
+    else {
+        // Step-1: bring the vertex buffer up to date
+        expand_sections();
+        m_procedural = false;
+        setVertexArray(m_vertices.get());
+        setNormalArray(m_normals.get(), osg::Array::BIND_PER_VERTEX);
+
+        // Step-2: back to the fixed function pipeline and the shared state set
+        update_state_set();
+        setComputeBoundingBoxCallback(nullptr);
     }
+
+    removePrimitiveSet(0, getNumPrimitiveSets());
+    update_sweep_instances();
+    attach_primitive_sets();
+    dirtyBound();
+    Update();
+}
+
+bool GeneralizedCylinderGeometry::IsProceduralSweep() const {
+    return m_procedural;
+}
+
+void GeneralizedCylinderGeometry::SetSectionFrames(bool flag) {
+
+    if(m_section_frames == flag) return;
+    m_section_frames = flag;
+    if(!flag || m_procedural) return;
+
+    // the frames are not written while neither the sweep nor the normals display is on
+    if(!m_template.valid()) create_sweep();
+    for(size_t i = 0; i < m_sections.size(); ++i)
+        update_section_frame(i);
+}
+
+osg::Texture2D* GeneralizedCylinderGeometry::GetSectionTexture() {
+
+    if(!m_template.valid()) create_sweep();
+    return m_section_texture.get();
+}
+
+osg::Vec3Array* GeneralizedCylinderGeometry::GetSweepTemplate() {
+
+    if(!m_template.valid()) create_sweep();
+    return m_template.get();
+}
+
+void GeneralizedCylinderGeometry::update_state_set() {
+
+    if(!m_procedural) {
+        ComponentGeometryBase::update_state_set();
+        return;
     }
-    m_rtype = rtype;
+
+    // the section texture is per geometry: a copy of the shared state set with the sweep
+    // (protected from the flat program of the color id picker, the sweep writes the pick color itself)
+    osg::ref_ptr<osg::StateSet> ss = new osg::StateSet(*StateSetPool::Instance().Get(render_state(m_color, m_blend)), osg::CopyOp::SHALLOW_COPY);
+    ss->setDataVariance(osg::Object::DYNAMIC);
+    ss->setAttributeAndModes(sweep_program(), osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    ss->setTextureAttribute(0, m_section_texture.get());
+    ss->addUniform(new osg::Uniform("sections", 0));
+    ss->addUniform(new osg::Uniform("num_points", m_numpts));
+    setStateSet(ss.get());
 }
 
 void GeneralizedCylinderGeometry::AddPlanarSection(const Circle3D& section) {
@@ -174,104 +318,480 @@ void GeneralizedCylinderGeometry::AddPlanarSection(const Circle3D& section) {
     m_sections.push_back(section);
 
     // step-2: update geometry (vertices and normals) and indices
-    update_geometry_and_indices(m_sections.size() - 1, section);
+    update_geometry_and_indices(m_sections.size() - 1);
 }
 
-void GeneralizedCylinderGeometry::GetVertexNormals(size_t section_idx, osg::Vec3Array* vertices) {
+void GeneralizedCylinderGeometry::GetFirstCirclePoint(size_t section_idx, osg::Vec3d& pt) {
 
-    if(m_vertices->empty() || m_normals->empty()) {
-        std::cout << "ERROR: No vertices and/or normals " << std::endl;
+    if(m_procedural) {
+        const float* frame = section_frame(section_idx);
+        pt = osg::Vec3d(frame[0] + frame[4], frame[1] + frame[5], frame[2] + frame[6]);
         return;
     }
+    pt = m_vertices->at(section_offset(section_idx));
+}
 
-    size_t numpts(m_rtype == rendering_type::triangle_fan ? m_numpts + 1 : m_numpts);
-    size_t idx = 0;
-    for(int i = 0; i < numpts; ++i) {
-        idx = section_idx * numpts + i;
-        vertices->push_back(m_vertices->at(idx));
-        vertices->push_back(m_vertices->at(idx) + m_normals->at(idx));
+osg::BoundingBox GeneralizedCylinderGeometry::ComputeSweepBoundingBox() const {
+
+    // the extent of a circle along an axis is the length of the axis components of u and v
+    osg::BoundingBox bb;
+    if(!m_section_image.valid()) return bb;
+    size_t num_sections = std::min(m_sections.size(), static_cast<size_t>(m_section_image->t()));
+    for(size_t i = 0; i < num_sections; ++i) {
+        const float* frame = section_frame(i);
+        osg::Vec3 ctr(frame[0], frame[1], frame[2]);
+        osg::Vec3 ext(std::sqrt(frame[4]*frame[4] + frame[8]*frame[8]),
+                      std::sqrt(frame[5]*frame[5] + frame[9]*frame[9]),
+                      std::sqrt(frame[6]*frame[6] + frame[10]*frame[10]));
+        bb.expandBy(ctr - ext);
+        bb.expandBy(ctr + ext);
     }
+    return bb;
 }
 
-void GeneralizedCylinderGeometry::GetFirstCirclePoint(size_t section_idx, osg::Vec3d& pt) {
-
-    size_t numpts(m_rtype == rendering_type::triangle_fan ? m_numpts + 1 : m_numpts);
-    size_t idx = section_idx * numpts;
-    pt = m_vertices->at(idx);
+void GeneralizedCylinderGeometry::GetTriangleMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const {
+
+    // Step-1: side surface, the strip triangles over the whole vertex buffer (independent of the rendering type)
+    expand_sections();
+    if(m_sections.size() < 2) return;
+    unsigned int base = static_cast<unsigned int>(vertices->size());
+    vertices->insert(vertices->end(), m_vertices->begin(), m_vertices->end());
+    normals->insert(normals->end(), m_normals->begin(), m_normals->end());
+    for(unsigned int idx : *m_tindices)
+        triangles.push_back(base + idx);
+
+    // Step-2: caps facing away from the axis, the circle points run counterclockwise around the section normal
+    size_t last = m_sections.size() - 1;
+    SectionStore::const_reference caps[2] = { m_sections.front(), m_sections.back() };
+    Eigen::Vector3d dir[2] = { m_sections.front().center - m_sections[1].center, m_sections.back().center - m_sections[last - 1].center };
+    size_t offsets[2] = { section_offset(0), section_offset(last) };
+    for(int c = 0; c < 2; ++c) {
+        bool flip = caps[c].normal.dot(dir[c]) < 0;
+        osg::Vec3 nrm(caps[c].normal[0], caps[c].normal[1], caps[c].normal[2]);
+        if(flip) nrm = -nrm;
+        unsigned int first = static_cast<unsigned int>(vertices->size());
+        for(int i = 0; i <= m_numpts; ++i) {
+            vertices->push_back(m_vertices->at(offsets[c] + m_numpts + i));
+            normals->push_back(nrm);
+        }
+        unsigned int center = first + m_numpts;
+        for(int i = 0; i < m_numpts; ++i) {
+            unsigned int a = first + i;
+            unsigned int b = first + (i + 1) % m_numpts;
+            triangles.push_back(center);
+            triangles.push_back(flip ? b : a);
+            triangles.push_back(flip ? a : b);
+        }
+    }
 }
 
-void GeneralizedCylinderGeometry::update_geometry_and_indices(size_t section_index, const Circle3D& circle) {
+void GeneralizedCylinderGeometry::GetSimplifiedTriangleMesh(double max_error, osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const {
 
-    // update_geometry
-    if(m_rtype == rendering_type::triangle_fan) {
-        circle.generate_data(m_vertices, m_numpts);
-        m_vertices->push_back(osg::Vec3(circle.center[0], circle.center[1], circle.center[2]));
-        for(size_t i = 0; i < m_numpts + 1; ++i)
-            m_normals->push_back(osg::Vec3(circle.normal[0], circle.normal[1], circle.normal[2]));
-    }
-    else {
-        if(section_index == 0)
-            circle.generate_data(m_vertices, m_normals, m_numpts);
-        else
-            circle.generate_aligned_data(m_vertices, m_normals, m_numpts, m_sections[section_index - 1]);
+    // Step-1: the retained sections and the ring resolution
+    SectionSimplifier simplifier(max_error);
+    std::vector<size_t> retained;
+    simplifier.Simplify(m_sections, retained);
+    int numpts = simplifier.RingResolution(m_sections, retained, m_numpts);
+    if(retained.size() == m_sections.size() && numpts == m_numpts) {
+        GetTriangleMesh(vertices, normals, triangles);
+        return;
     }
 
-    // update indices
-    switch(m_rtype) {
-    case rendering_type::planar_sections: {
+    // Step-2: a geometry of the retained sections tessellates them as this one, the axes are transported again
+    osg::ref_ptr<GeneralizedCylinderGeometry> simplified = new GeneralizedCylinderGeometry(numpts, GetColor(), rendering_type::triangle_strip);
+    SectionStore& sections = simplified->GetSections();
+    sections.reserve(retained.size());
+    for(size_t i : retained)
+        sections.push_back(m_sections[i]);
+    simplified->Recalculate();
+    simplified->GetTriangleMesh(vertices, normals, triangles);
+}
 
-        m_hindices.push_back(new osg::DrawElementsUInt(GL_LINE_LOOP));
-        for(int i = 0; i < m_numpts; ++i)
-            m_hindices[section_index]->push_back(i + section_index * m_numpts);
-        addPrimitiveSet(m_hindices[section_index].get());
-        break;
+void GeneralizedCylinderGeometry::GetTexturedMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::Vec2Array* texcoords, std::vector<unsigned int>& triangles) const {
+
+    // Step-1: side surface, u follows the ring from its first point and v the sections
+    expand_sections();
+    if(m_sections.size() < 2) return;
+    size_t last = m_sections.size() - 1;
+    unsigned int base = static_cast<unsigned int>(vertices->size());
+    unsigned int row = static_cast<unsigned int>(m_numpts + 1);
+    for(size_t s = 0; s <= last; ++s) {
+        unsigned int offset = section_offset(s);
+        float v = static_cast<float>(s) / static_cast<float>(last);
+        for(int i = 0; i <= m_numpts; ++i) {
+            vertices->push_back(m_vertices->at(offset + i % m_numpts));
+            normals->push_back(m_normals->at(offset + i % m_numpts));
+            texcoords->push_back(osg::Vec2(static_cast<float>(i) / m_numpts, v));
+        }
     }
-    case rendering_type::planar_and_vertical_sections: {
-
-        m_hindices.push_back(new osg::DrawElementsUInt(GL_LINE_LOOP));
-        addPrimitiveSet(m_hindices[section_index].get());
-        if(section_index == 0) {
-            for(int i = 0; i < m_numpts; ++i) {
-                m_vindices.push_back(new osg::DrawElementsUInt(GL_LINE_STRIP));
-                addPrimitiveSet((m_vindices.back()).get());
-            }
+    for(unsigned int s = 1; s <= last; ++s) {
+        unsigned int prev = base + (s - 1) * row, curr = base + s * row;
+        for(unsigned int i = 0; i < static_cast<unsigned int>(m_numpts); ++i) {
+            // the winding of the strip triangles
+            unsigned int tri[6] = { prev + i, curr + i, prev + i + 1, prev + i + 1, curr + i, curr + i + 1 };
+            triangles.insert(triangles.end(), tri, tri + 6);
         }
+    }
+
+    // Step-2: caps as in GetTriangleMesh, textured with the ring of their section, the center with its middle
+    SectionStore::const_reference caps[2] = { m_sections.front(), m_sections.back() };
+    Eigen::Vector3d dir[2] = { m_sections.front().center - m_sections[1].center, m_sections.back().center - m_sections[last - 1].center };
+    size_t offsets[2] = { section_offset(0), section_offset(last) };
+    for(int c = 0; c < 2; ++c) {
+        bool flip = caps[c].normal.dot(dir[c]) < 0;
+        osg::Vec3 nrm(caps[c].normal[0], caps[c].normal[1], caps[c].normal[2]);
+        if(flip) nrm = -nrm;
+        float v = (c == 0) ? 0.0f : 1.0f;
+        unsigned int first = static_cast<unsigned int>(vertices->size());
+        for(int i = 0; i <= m_numpts; ++i) {
+            vertices->push_back(m_vertices->at(offsets[c] + m_numpts + i));
+            normals->push_back(nrm);
+            texcoords->push_back(osg::Vec2((i < m_numpts) ? static_cast<float>(i) / m_numpts : 0.5f, v));
+        }
+        unsigned int center = first + m_numpts;
         for(int i = 0; i < m_numpts; ++i) {
-            m_hindices[section_index]->push_back(i + section_index * m_numpts);
-            m_vindices[i]->push_back(i + section_index * m_numpts);
+            unsigned int a = first + i;
+            unsigned int b = first + (i + 1) % m_numpts;
+            triangles.push_back(center);
+            triangles.push_back(flip ? b : a);
+            triangles.push_back(flip ? a : b);
         }
-        break;
     }
-    case rendering_type::triangle_fan: {
-
-        m_tindices.push_back(new osg::DrawElementsUInt(GL_TRIANGLE_FAN)); 
-        m_tindices[section_index]->push_back(section_index * m_numpts + section_index + m_numpts);
-        for(int i = 0; i < m_numpts; ++i)
-            m_tindices[section_index]->push_back(i + (m_numpts+1) * section_index);
-        m_tindices[section_index]->push_back((m_numpts+1)*section_index);
-        addPrimitiveSet(m_tindices[section_index].get());
-        break;
+}
+
+void GeneralizedCylinderGeometry::accept(osg::PrimitiveFunctor& functor) const {
+
+    if(!m_procedural) {
+        osg::Geometry::accept(functor);
+        return;
     }
-    case rendering_type::triangle_strip: {
-
-        if(section_index == 0)
-            break;
-        m_tindices.push_back(new osg::DrawElementsUInt(GL_TRIANGLE_STRIP));
-        int start_index = (section_index-1)*m_numpts;
-        for(int i = start_index; i < start_index + m_numpts; ++i) {
-            m_tindices[section_index-1]->push_back(i);
-            m_tindices[section_index-1]->push_back(i + m_numpts);
-        }
-        m_tindices[section_index-1]->push_back(start_index);
-        m_tindices[section_index-1]->push_back(start_index + m_numpts);
-        addPrimitiveSet(m_tindices[section_index-1].get());
-        break;
+
+    expand_sections();
+    if(m_vertices->empty()) return;
+    functor.setVertexArray(m_vertices->size(), &(m_vertices->front()));
+    osg::DrawElementsUInt* sets[2];
+    int num_sets = current_primitive_sets(sets, false);
+    for(int i = 0; i < num_sets; ++i)
+        sets[i]->accept(functor);
+}
+
+void GeneralizedCylinderGeometry::accept(osg::PrimitiveIndexFunctor& functor) const {
+
+    if(!m_procedural) {
+        osg::Geometry::accept(functor);
+        return;
     }
-    default: {
+
+    expand_sections();
+    if(m_vertices->empty()) return;
+    functor.setVertexArray(m_vertices->size(), &(m_vertices->front()));
+    osg::DrawElementsUInt* sets[2];
+    int num_sets = current_primitive_sets(sets, false);
+    for(int i = 0; i < num_sets; ++i)
+        sets[i]->accept(functor);
+}
+
+const float* GeneralizedCylinderGeometry::section_frame(size_t section_index) const {
+
+    return reinterpret_cast<const float*>(m_section_image->data(0, static_cast<unsigned int>(section_index)));
+}
+
+unsigned int GeneralizedCylinderGeometry::section_offset(size_t section_index) const {
+
+    return static_cast<unsigned int>(section_index * (2 * m_numpts + 1));
+}
+
+void GeneralizedCylinderGeometry::create_primitive_sets() {
+
+    m_hindices = new osg::DrawElementsUInt(GL_LINES);
+    m_vindices = new osg::DrawElementsUInt(GL_LINES);
+    m_findices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    m_tindices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    attach_primitive_sets();
+}
+
+int GeneralizedCylinderGeometry::current_primitive_sets(osg::DrawElementsUInt** sets, bool sweep) const {
+
+    switch(m_rtype) {
+    case rendering_type::planar_sections:
+        sets[0] = sweep ? m_sweep_hindices.get() : m_hindices.get();
+        return 1;
+    case rendering_type::planar_and_vertical_sections:
+        sets[0] = sweep ? m_sweep_hindices.get() : m_hindices.get();
+        sets[1] = sweep ? m_sweep_vindices.get() : m_vindices.get();
+        return 2;
+    case rendering_type::triangle_fan:
+        sets[0] = sweep ? m_sweep_findices.get() : m_findices.get();
+        return 1;
+    case rendering_type::triangle_strip:
+        sets[0] = sweep ? m_sweep_tindices.get() : m_tindices.get();
+        return 1;
+    default:
         std::cout << "ERROR: Unknown render type" << std::endl;
-        break;
+        return 0;
+    }
+}
+
+void GeneralizedCylinderGeometry::attach_primitive_sets() {
+
+    osg::DrawElementsUInt* sets[2];
+    int num_sets = current_primitive_sets(sets, m_procedural);
+    for(int i = 0; i < num_sets; ++i) {
+        // zero instances would be drawn as a plain (non-instanced) draw call
+        if(m_procedural && sets[i]->getNumInstances() == 0) continue;
+        addPrimitiveSet(sets[i]);
+    }
+}
+
+void GeneralizedCylinderGeometry::update_geometry_and_indices(size_t section_index) {
+
+    ++m_revision;
+    update_section_axis(section_index);
+    if(m_procedural) {
+        // the vertex buffer is expanded on demand
+        update_section_frame(section_index);
+        m_num_expanded_sections = std::min(m_num_expanded_sections, section_index);
+
+        removePrimitiveSet(0, getNumPrimitiveSets());
+        update_sweep_instances();
+        attach_primitive_sets();
+        return;
+    }
+
+    if(m_section_frames) update_section_frame(section_index);
+    if(section_index < m_num_expanded_sections)
+        resize_section_geometry(section_index);
+    append_section_geometry(section_index);
+}
+
+void GeneralizedCylinderGeometry::append_section_geometry(size_t section_index) const {
+
+    resize_section_geometry(section_index + 1);
+    write_section_geometry(section_index);
+    m_hindices->dirty();
+    m_vindices->dirty();
+    m_findices->dirty();
+    m_tindices->dirty();
+}
+
+void GeneralizedCylinderGeometry::write_section_geometry(size_t section_index) const {
+
+    // the vertices and the indices of a section have fixed positions in the arrays, see section_offset,
+    // the sections are written concurrently by expand_sections
+    osg::Vec3Array& vertices = *m_vertices;
+    osg::Vec3Array& normals = *m_normals;
+
+    // update geometry: circle points with radial normals from the transported axis and the cached ring table
+    const Circle3D circle = m_sections[section_index];
+    unsigned int offset = section_offset(section_index);
+    const Eigen::Vector3d& u = m_axes[section_index];
+    Eigen::Vector3d v = circle.normal.cross(u);
+    const double* cs = m_ring->Cos();
+    const double* sn = m_ring->Sin();
+    for(int i = 0; i < m_numpts; ++i) {
+        Eigen::Vector3d radial = u * cs[i] + v * sn[i];
+        Eigen::Vector3d pos = circle.center + circle.radius * radial;
+        vertices[offset + i] = osg::Vec3(pos[0], pos[1], pos[2]);
+        normals[offset + i] = osg::Vec3(radial[0], radial[1], radial[2]);
+    }
+
+    // tail block: circle points and the center with the section normal
+    osg::Vec3 nrm(circle.normal[0], circle.normal[1], circle.normal[2]);
+    for(int i = 0; i < m_numpts; ++i) {
+        vertices[offset + m_numpts + i] = vertices[offset + i];
+        normals[offset + m_numpts + i] = nrm;
+    }
+    vertices[offset + 2 * m_numpts] = osg::Vec3(circle.center[0], circle.center[1], circle.center[2]);
+    normals[offset + 2 * m_numpts] = nrm;
+
+    // update indices of all the rendering types
+    unsigned int prev_offset = (section_index > 0) ? section_offset(section_index - 1) : 0;
+    unsigned int* hidx = &(*m_hindices)[2 * m_numpts * section_index];
+    unsigned int* fidx = &(*m_findices)[3 * m_numpts * section_index];
+    unsigned int* vidx = (section_index > 0) ? &(*m_vindices)[2 * m_numpts * (section_index - 1)] : nullptr;
+    unsigned int* tidx = (section_index > 0) ? &(*m_tindices)[6 * m_numpts * (section_index - 1)] : nullptr;
+    for(int i = 0; i < m_numpts; ++i) {
+        int next = (i + 1) % m_numpts;
+
+        // planar section: closed loop of lines
+        *hidx++ = offset + i;
+        *hidx++ = offset + next;
+
+        // fan: center and two consecutive points
+        *fidx++ = offset + 2 * m_numpts;
+        *fidx++ = offset + m_numpts + i;
+        *fidx++ = offset + m_numpts + next;
+
+        if(section_index == 0) continue;
+
+        // vertical section: line to the previous section
+        *vidx++ = prev_offset + i;
+        *vidx++ = offset + i;
+
+        // strip between the previous and the current sections, same winding as GL_TRIANGLE_STRIP
+        *tidx++ = prev_offset + i;
+        *tidx++ = offset + i;
+        *tidx++ = prev_offset + next;
+        *tidx++ = prev_offset + next;
+        *tidx++ = offset + i;
+        *tidx++ = offset + next;
+    }
+}
+
+void GeneralizedCylinderGeometry::resize_section_geometry(size_t num_sections) const {
+
+    m_vertices->resize(section_offset(num_sections));
+    m_normals->resize(section_offset(num_sections));
+    m_hindices->resize(2 * m_numpts * num_sections);
+    m_findices->resize(3 * m_numpts * num_sections);
+    m_vindices->resize(num_sections > 0 ? 2 * m_numpts * (num_sections - 1) : 0);
+    m_tindices->resize(num_sections > 0 ? 6 * m_numpts * (num_sections - 1) : 0);
+    m_num_expanded_sections = num_sections;
+    report_memory();
+}
+
+void GeneralizedCylinderGeometry::report_memory() const {
+
+    // the capacities, the arrays keep them when the sections are removed
+    size_t bytes = (m_vertices->capacity() + m_normals->capacity()) * sizeof(osg::Vec3) +
+                   (m_hindices->capacity() + m_vindices->capacity() + m_findices->capacity() + m_tindices->capacity()) * sizeof(GLuint);
+    if(m_section_image.valid()) bytes += m_section_image->getTotalSizeInBytes();
+    m_memory.Set(bytes);
+}
+
+void GeneralizedCylinderGeometry::expand_sections() const {
+
+    if(m_num_expanded_sections == m_sections.size()) return;
+
+    // Step-1: the arrays are sized once for all the sections
+    size_t first = std::min(m_num_expanded_sections, m_sections.size());
+    resize_section_geometry(m_sections.size());
+
+    // Step-2: the sections are independent, large sweeps are written by the thread pool
+    ThreadPool::Instance().ParallelFor(first, m_sections.size(), parallel_sections_grain, [this](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i)
+            write_section_geometry(i);
+    });
+
+    // Step-3: a single upload of the arrays
+    m_vertices->dirty();
+    m_normals->dirty();
+    m_hindices->dirty();
+    m_vindices->dirty();
+    m_findices->dirty();
+    m_tindices->dirty();
+}
+
+void GeneralizedCylinderGeometry::create_sweep() {
+
+    // Step-1: section texture, one row per section
+    m_section_image = new osg::Image;
+    m_section_image->allocateImage(sweep_texels_per_section, sweep_initial_capacity, 1, GL_RGBA, GL_FLOAT);
+    m_section_image->setInternalTextureFormat(GL_RGBA32F_ARB);
+    std::memset(m_section_image->data(), 0, m_section_image->getTotalSizeInBytes());
+
+    m_section_texture = new osg::Texture2D;
+    m_section_texture->setDataVariance(osg::Object::DYNAMIC);
+    m_section_texture->setResizeNonPowerOfTwoHint(false);
+    m_section_texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    m_section_texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    m_section_texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    m_section_texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    m_section_texture->setImage(m_section_image.get());
+    report_memory();
+
+    // Step-2: template: [ring of the section | ring of the next section | ring with the section normal | center]
+    m_template = new osg::Vec3Array;
+    for(int i = 0; i < m_numpts; ++i) m_template->push_back(osg::Vec3(i, 0, sweep_radial));
+    for(int i = 0; i < m_numpts; ++i) m_template->push_back(osg::Vec3(i, 1, sweep_radial));
+    for(int i = 0; i < m_numpts; ++i) m_template->push_back(osg::Vec3(i, 0, sweep_planar));
+    m_template->push_back(osg::Vec3(0, 0, sweep_center));
+
+    // Step-3: primitive sets of a single section (section pair for the vertical lines and the strips)
+    m_sweep_hindices = new osg::DrawElementsUInt(GL_LINES);
+    m_sweep_vindices = new osg::DrawElementsUInt(GL_LINES);
+    m_sweep_findices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    m_sweep_tindices = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(int i = 0; i < m_numpts; ++i) {
+        int next = (i + 1) % m_numpts;
+        m_sweep_hindices->push_back(i);
+        m_sweep_hindices->push_back(next);
+
+        m_sweep_vindices->push_back(i);
+        m_sweep_vindices->push_back(m_numpts + i);
+
+        m_sweep_findices->push_back(3 * m_numpts);
+        m_sweep_findices->push_back(2 * m_numpts + i);
+        m_sweep_findices->push_back(2 * m_numpts + next);
+
+        m_sweep_tindices->push_back(i);
+        m_sweep_tindices->push_back(m_numpts + i);
+        m_sweep_tindices->push_back(next);
+        m_sweep_tindices->push_back(next);
+        m_sweep_tindices->push_back(m_numpts + i);
+        m_sweep_tindices->push_back(m_numpts + next);
     }
+}
+
+void GeneralizedCylinderGeometry::update_section_axis(size_t section_index) {
+
+    // the axis of the previous section is transported, the first one is the basis of its normal
+    m_axes.resize(m_sections.size());
+    if(section_index == 0) {
+        Eigen::Vector3d v;
+        orthonormal_basis(m_sections[0].normal.normalized(), m_axes[0], v);
+        return;
     }
+    Eigen::Vector3d u = m_axes[section_index - 1];
+    parallel_transport(m_sections[section_index - 1].normal, m_sections[section_index].normal, u);
+    m_axes[section_index] = u;
+}
+
+void GeneralizedCylinderGeometry::update_section_frame(size_t section_index) {
+
+    // Step-1: grow the texture by doubling its rows
+    unsigned int rows = static_cast<unsigned int>(m_section_image->t());
+    if(section_index >= rows) {
+        while(section_index >= rows) rows *= 2;
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(sweep_texels_per_section, rows, 1, GL_RGBA, GL_FLOAT);
+        image->setInternalTextureFormat(GL_RGBA32F_ARB);
+        std::memset(image->data(), 0, image->getTotalSizeInBytes());
+        std::memcpy(image->data(), m_section_image->data(), m_section_image->getTotalSizeInBytes());
+        m_section_image = image;
+        m_section_texture->setImage(m_section_image.get());
+        m_section_texture->dirtyTextureObject();
+        report_memory();
+    }
+
+    // Step-2: frame with the same alignment as the vertex buffer
+    const Circle3D circle = m_sections[section_index];
+    Eigen::Vector3d u = circle.radius * m_axes[section_index];
+    Eigen::Vector3d v = circle.normal.cross(u);
+
+    float* frame = reinterpret_cast<float*>(m_section_image->data(0, static_cast<unsigned int>(section_index)));
+    for(int i = 0; i < 3; ++i) {
+        frame[i]      = static_cast<float>(circle.center[i]);
+        frame[4 + i]  = static_cast<float>(u[i]);
+        frame[8 + i]  = static_cast<float>(v[i]);
+        frame[12 + i] = static_cast<float>(circle.normal[i]);
+    }
+    frame[3] = static_cast<float>(circle.radius);
+    frame[7] = frame[11] = frame[15] = 0.0f;
+    m_section_image->dirty();
+    dirtyBound();
+}
+
+void GeneralizedCylinderGeometry::update_sweep_instances() {
+
+    if(!m_template.valid()) return;
+
+    unsigned int num_sections = static_cast<unsigned int>(m_sections.size());
+    unsigned int num_pairs = (num_sections > 0) ? num_sections - 1 : 0;
+    m_sweep_hindices->setNumInstances(num_sections);
+    m_sweep_findices->setNumInstances(num_sections);
+    m_sweep_vindices->setNumInstances(num_pairs);
+    m_sweep_tindices->setNumInstances(num_pairs);
 }
 
 void GeneralizedCylinderGeometry::Print() const {
@@ -281,4 +801,3 @@ void GeneralizedCylinderGeometry::Print() const {
     ComponentGeometryBase::Print();
     std::cout << "----------------------------" << std::endl;
 }
-
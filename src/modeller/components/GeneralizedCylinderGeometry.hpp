@@ -2,11 +2,14 @@
 #define GENERALIZED_CYLINDER_GEOMETRY_HPP
 
 #include "ComponentGeometryBase.hpp"
+#include "../../geometry/SectionStore.hpp"
+#include "../../geometry/SectionFrame.hpp"
+#include "../../utility/MemoryRegistry.hpp"
+#include <osg/Image>
+#include <osg/Texture2D>
 #include <memory>
 #include <vector>
 
-class Circle3D;
-
 enum class rendering_type : unsigned char {
     planar_sections,
     planar_and_vertical_sections,
@@ -18,25 +21,96 @@ class GeneralizedCylinderGeometry : public ComponentGeometryBase {
 protected:
     int m_numpts;                                                   // number of points for each planar section
     rendering_type m_rtype;                                         // rendering type for the generalized cylinder
-    std::vector<Circle3D> m_sections;                               // planar sections
-    std::vector<osg::ref_ptr<osg::DrawElementsUInt>> m_vindices;    // for vertical sections
-    std::vector<osg::ref_ptr<osg::DrawElementsUInt>> m_hindices;    // for horizontal sections
-    std::vector<osg::ref_ptr<osg::DrawElementsUInt>> m_tindices;    // for triangle strip and triangle fan rendering
+    SectionStore m_sections;                                        // planar sections
+    std::shared_ptr<const RingTable> m_ring;                        // cosines and sines of the ring points
+    std::vector<Eigen::Vector3d> m_axes;                            // unit first in-plane axis of each section, parallel transported
+
+    /*
+     * Vertex buffer layout of a section (2*m_numpts + 1 vertices):
+     * [0, m_numpts)            : circle points with radial normals
+     * [m_numpts, 2*m_numpts)   : tail block, circle points with the section normal for the fans
+     * 2*m_numpts               : tail block, center of the fan
+     *
+     * The indices of every rendering type are kept up to date as index-only views over the
+     * vertex buffer, only the ones of the current rendering type are attached to the geometry.
+     * Every view is a single list of independent lines or triangles for all the sections, so
+     * that a rendering type is drawn with one draw call (two for planar and vertical sections).
+     */
+    osg::ref_ptr<osg::DrawElementsUInt> m_vindices;                 // for vertical sections (GL_LINES)
+    osg::ref_ptr<osg::DrawElementsUInt> m_hindices;                 // for horizontal sections (GL_LINES)
+    osg::ref_ptr<osg::DrawElementsUInt> m_findices;                 // for triangle fan rendering (GL_TRIANGLES)
+    osg::ref_ptr<osg::DrawElementsUInt> m_tindices;                 // for triangle strip rendering (GL_TRIANGLES)
+    mutable size_t m_num_expanded_sections;                         // number of sections in the vertex buffer
+
+    /*
+     * Procedural sweep: the sections are uploaded as one row of a float texture each
+     * (center and radius, the two in-plane axes, the normal) and a vertex shader generates the
+     * circle points from a small template that does not depend on the number of sections.
+     * Every primitive set of the template is drawn once per section (or section pair) with
+     * instancing. The vertex buffer is only expanded on the CPU when it is needed, e.g. for
+     * the intersection tests of the picking.
+     */
+    bool m_procedural;
+    bool m_section_frames;                                          // section texture kept up to date for the vertex buffer too
+    osg::ref_ptr<osg::Image> m_section_image;
+    osg::ref_ptr<osg::Texture2D> m_section_texture;
+    osg::ref_ptr<osg::Vec3Array> m_template;                        // (point index, section offset, vertex kind)
+    osg::ref_ptr<osg::DrawElementsUInt> m_sweep_vindices;
+    osg::ref_ptr<osg::DrawElementsUInt> m_sweep_hindices;
+    osg::ref_ptr<osg::DrawElementsUInt> m_sweep_findices;
+    osg::ref_ptr<osg::DrawElementsUInt> m_sweep_tindices;
+
+    mutable MemoryRegistry::Allocation m_memory;                    // vertex buffer, indices and section texture
 public:
     GeneralizedCylinderGeometry(int num_points_per_section, const osg::Vec4& color, rendering_type rtype);
     GeneralizedCylinderGeometry(const Circle3D& base_circle, int num_points_per_section, const osg::Vec4& color, rendering_type rtype);
     void AddPlanarSection(const Circle3D& circle);
-    void GetVertexNormals(size_t section_idx, osg::Vec3Array* vertices);
     void GetFirstCirclePoint(size_t section_idx, osg::Vec3d& pt);
     void ChangeRenderingType(rendering_type rtype);
-    const std::vector<Circle3D>& GetSections() const;
-    std::vector<Circle3D>& GetSections();
+    rendering_type GetRenderingType() const;
+    int GetNumberOfPointsPerSection() const;
+    void SetProceduralSweep(bool flag);
+    bool IsProceduralSweep() const;
+    // the section texture and the template without the procedural sweep, e.g. for GeneralizedCylinderNormals
+    void SetSectionFrames(bool flag);
+    osg::Texture2D* GetSectionTexture();
+    osg::Vec3Array* GetSweepTemplate();
+    const SectionStore& GetSections() const;
+    SectionStore& GetSections();
     unsigned int GetNumberOfSections() const;
+    osg::BoundingBox ComputeSweepBoundingBox() const;
+    void GetTriangleMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const;
+    // the closed surface within the geometric error: the merged sections and the fewest points per ring (see SectionSimplifier)
+    void GetSimplifiedTriangleMesh(double max_error, osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const;
+    // the closed surface with the texture coordinates (ring angle, section index), the seam of the rings is duplicated
+    void GetTexturedMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::Vec2Array* texcoords, std::vector<unsigned int>& triangles) const;
     void Recalculate();
+    // the sections from the first one on have been edited, added or removed in the section store
+    void UpdateSections(size_t first);
     void Clear(bool update_flag);
     void Print() const;
+
+    // the procedural sweep is expanded for the functors (intersections, statistics)
+    using osg::Geometry::accept;
+    void accept(osg::PrimitiveFunctor& functor) const override;
+    void accept(osg::PrimitiveIndexFunctor& functor) const override;
 protected:
-    void update_geometry_and_indices(size_t section_index, const Circle3D& circle);
+    void update_geometry_and_indices(size_t section_index);
+    void append_section_geometry(size_t section_index) const;
+    void write_section_geometry(size_t section_index) const;
+    void resize_section_geometry(size_t num_sections) const;
+    void report_memory() const;
+    void expand_sections() const;
+    void create_primitive_sets();
+    void attach_primitive_sets();
+    int current_primitive_sets(osg::DrawElementsUInt** sets, bool sweep) const;
+    void create_sweep();
+    void update_section_axis(size_t section_index);
+    void update_section_frame(size_t section_index);
+    void update_sweep_instances();
+    inline const float* section_frame(size_t section_index) const;
+    inline unsigned int section_offset(size_t section_index) const;
+    void update_state_set() override;
 };
 
 #endif // GENERALIZED_CYLINDER_GEOMETRY_HPP
@@ -0,0 +1,126 @@
+#include "GeneralizedCylinderLOD.hpp"
+#include "GeneralizedCylinderGeometry.hpp"
+#include "../../geometry/Circle3D.hpp"
+#include "../../utility/Utility.hpp"
+
+#include <osgUtil/CullVisitor>
+#include <cmath>
+
+// coarser rings are not worth a level
+static const int min_points_per_section = 8;
+
+GeneralizedCylinderLOD::GeneralizedCylinderLOD(GeneralizedCylinderGeometry* geometry, float pixel_error) :
+    m_geometry(geometry),
+    m_pixel_error(pixel_error) {
+
+    create_levels();
+}
+
+void GeneralizedCylinderLOD::SetPixelError(float pixel_error) {
+
+    m_pixel_error = pixel_error;
+    create_levels();
+}
+
+void GeneralizedCylinderLOD::operator()(osg::Node* node, osg::NodeVisitor* nv) {
+
+    osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+    const osg::BoundingSphere& bs = node->getBound();
+    if(cv == nullptr || m_levels.empty() || !bs.valid()) {
+        traverse(node, nv);
+        return;
+    }
+
+    // Step-1: coarsest level within the pixel error
+    float pixel_diameter = cv->clampedPixelSize(bs) / cv->getLODScale();
+    int k = -1;
+    for(int i = 0; i < static_cast<int>(m_levels.size()); ++i)
+        if(pixel_diameter <= m_levels[i].max_pixel_diameter) k = i;
+    if(k < 0) {
+        traverse(node, nv);
+        return;
+    }
+
+    // Step-2: draw the coarse level instead of the children
+    level& lvl = m_levels[k];
+    update_level(lvl, 2.0f * bs.radius());
+    if(lvl.geode->getNumDrawables() == 0) {
+        traverse(node, nv);
+        return;
+    }
+    lvl.geode->accept(*nv);
+}
+
+void GeneralizedCylinderLOD::create_levels() {
+
+    // a chord of a ring with n points deviates r*(1 - cos(pi/n)) from the circle
+    m_levels.clear();
+    int numpts = m_geometry->GetNumberOfPointsPerSection();
+    for(int n = numpts / 2; n >= min_points_per_section; n /= 2) {
+        level lvl;
+        lvl.numpts = n;
+        lvl.max_pixel_diameter = static_cast<float>(2.0 * m_pixel_error / (1.0 - std::cos(PI / n)));
+        lvl.revision = 0;
+        lvl.valid = false;
+        lvl.geode = new osg::Geode;
+        m_levels.push_back(lvl);
+    }
+}
+
+void GeneralizedCylinderLOD::update_level(level& lvl, float diameter) {
+
+    if(lvl.valid && lvl.revision == m_geometry->GetRevision()) return;
+
+    lvl.retired = (lvl.geode->getNumDrawables() > 0) ? lvl.geode->getDrawable(0) : nullptr;
+    lvl.geode->removeDrawables(0, lvl.geode->getNumDrawables());
+    lvl.revision = m_geometry->GetRevision();
+    lvl.valid = true;
+
+    const SectionStore& sections = m_geometry->GetSections();
+    if(sections.empty()) return;
+
+    // the world space tolerance of the pixel error at the largest diameter of the level
+    std::vector<Circle3D> decimated;
+    decimate_sections(sections, m_pixel_error * diameter / lvl.max_pixel_diameter, decimated);
+
+    osg::ref_ptr<GeneralizedCylinderGeometry> geometry =
+            new GeneralizedCylinderGeometry(decimated.front(), lvl.numpts, m_geometry->GetColor(), m_geometry->GetRenderingType());
+    for(size_t i = 1; i < decimated.size(); ++i)
+        geometry->AddPlanarSection(decimated[i]);
+    lvl.geode->addDrawable(geometry.get());
+}
+
+void GeneralizedCylinderLOD::decimate_sections(const SectionStore& sections, double tolerance, std::vector<Circle3D>& decimated) const {
+
+    // arc length along the axis, the interpolation parameter of the dropped sections
+    std::vector<double> arc(sections.size(), 0.0);
+    for(size_t i = 1; i < sections.size(); ++i)
+        arc[i] = arc[i-1] + (sections[i].center - sections[i-1].center).norm();
+
+    decimated.push_back(sections.front());
+    size_t anchor = 0;
+    for(size_t i = 2; i < sections.size(); ++i) {
+
+        // can the sections between the anchor and i be interpolated?
+        bool ok = true;
+        SectionStore::const_reference a = sections[anchor];
+        SectionStore::const_reference b = sections[i];
+        double len = arc[i] - arc[anchor];
+        for(size_t j = anchor + 1; j < i && ok; ++j) {
+            double t = (len > 0) ? (arc[j] - arc[anchor]) / len : 0.5;
+            SectionStore::const_reference c = sections[j];
+            Eigen::Vector3d ctr = (1.0 - t) * a.center + t * b.center;
+            Eigen::Vector3d nrm = ((1.0 - t) * a.normal + t * b.normal).normalized();
+            double r = (1.0 - t) * a.radius + t * b.radius;
+            double error = (c.center - ctr).norm() + std::abs(c.radius - r) + c.radius * (c.normal - nrm).norm();
+            ok = (error <= tolerance);
+        }
+
+        if(!ok) {
+            anchor = i - 1;
+            decimated.push_back(sections[anchor]);
+        }
+    }
+    if(sections.size() > 1)
+        decimated.push_back(sections.back());
+}
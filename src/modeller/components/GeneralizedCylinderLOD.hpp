@@ -0,0 +1,47 @@
+#ifndef GENERALIZED_CYLINDER_LOD_HPP
+#define GENERALIZED_CYLINDER_LOD_HPP
+
+#include <osg/Geode>
+#include <osg/NodeCallback>
+#include <vector>
+
+class Circle3D;
+class SectionStore;
+class GeneralizedCylinderGeometry;
+
+/*
+ * Screen-space error driven level of detail for generalized cylinders, installed as the cull
+ * callback of the group that holds the full resolution geometry.
+ *
+ * Level k halves the number of points per section k times and drops the sections that can be
+ * interpolated from their neighbours (center, radius and tilt of the normal), so that straight
+ * and untapered parts of the axis are decimated first. A level is chosen if its error stays
+ * below the pixel error at the projected size of the bounding sphere. The coarse levels are
+ * generated when they are first drawn and regenerated when the geometry is modified. The
+ * intersection visitor does not call cull callbacks, picking always uses the full resolution.
+ */
+class GeneralizedCylinderLOD : public osg::NodeCallback {
+public:
+    GeneralizedCylinderLOD(GeneralizedCylinderGeometry* geometry, float pixel_error = 1.0f);
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override;
+    void SetPixelError(float pixel_error);
+private:
+    struct level {
+        int numpts;                      // number of points for each planar section
+        float max_pixel_diameter;        // largest projected diameter for the pixel error
+        unsigned int revision;           // revision of the geometry the level is generated from
+        bool valid;
+        osg::ref_ptr<osg::Geode> geode;
+        osg::ref_ptr<osg::Drawable> retired;    // previous geometry, may still be drawn by the draw thread
+    };
+
+    GeneralizedCylinderGeometry* m_geometry;   // full resolution, owned by the generalized cylinder
+    std::vector<level> m_levels;               // coarse levels, finest first
+    float m_pixel_error;
+
+    void create_levels();
+    void update_level(level& lvl, float diameter);
+    void decimate_sections(const SectionStore& sections, double tolerance, std::vector<Circle3D>& decimated) const;
+};
+
+#endif // GENERALIZED_CYLINDER_LOD_HPP
@@ -0,0 +1,188 @@
+#include "GeneralizedCylinderNormals.hpp"
+#include "GeneralizedCylinderGeometry.hpp"
+
+#include <osg/Program>
+#include <osg/Shader>
+
+// length of the section normals and of the axes of the local frames, the vertex normals are unit
+static const float section_normal_length = 2.0f;
+
+// one point per ring point and per center of the template, the instance is the section
+static const char* normals_vertex_shader =
+    "#version 150 compatibility\n"
+    "uniform sampler2D sections;\n"
+    "uniform int num_points;\n"
+    "out vec3 position;\n"
+    "out vec3 direction;\n"
+    "out vec3 axis_u;\n"
+    "out vec3 axis_v;\n"
+    "flat out int kind;\n"
+    "void main() {\n"
+    "    kind = int(gl_Vertex.z + 0.5);\n"
+    "    float t = 6.28318530717958647692 * gl_Vertex.x / float(num_points);\n"
+    "    vec3 center = texelFetch(sections, ivec2(0, gl_InstanceID), 0).xyz;\n"
+    "    vec3 u = texelFetch(sections, ivec2(1, gl_InstanceID), 0).xyz;\n"
+    "    vec3 v = texelFetch(sections, ivec2(2, gl_InstanceID), 0).xyz;\n"
+    "    vec3 normal = texelFetch(sections, ivec2(3, gl_InstanceID), 0).xyz;\n"
+    "    vec3 radial = cos(t) * u + sin(t) * v;\n"
+    "    position = (kind == 2) ? center : center + radial;\n"
+    "    direction = (kind == 0) ? normalize(radial) : normal;\n"
+    "    axis_u = normalize(u);\n"
+    "    axis_v = normalize(v);\n"
+    "    gl_Position = vec4(position, 1.0);\n"
+    "}\n";
+
+// a ring point becomes its normal, the center the section normal and the axes of the frame
+static const char* normals_geometry_shader =
+    "#version 150 compatibility\n"
+    "layout(points) in;\n"
+    "layout(line_strip, max_vertices = 8) out;\n"
+    "uniform bool vertex_normals;\n"
+    "uniform bool section_normals;\n"
+    "uniform bool local_frames;\n"
+    "uniform float section_normal_length;\n"
+    "uniform vec4 vertex_normals_color;\n"
+    "uniform vec4 section_normals_color;\n"
+    "in vec3 position[];\n"
+    "in vec3 direction[];\n"
+    "in vec3 axis_u[];\n"
+    "in vec3 axis_v[];\n"
+    "flat in int kind[];\n"
+    "out vec4 color;\n"
+    "void emit_line(vec3 p, vec3 d, vec4 c) {\n"
+    "    color = c;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 1.0);\n"
+    "    EmitVertex();\n"
+    "    color = c;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(p + d, 1.0);\n"
+    "    EmitVertex();\n"
+    "    EndPrimitive();\n"
+    "}\n"
+    "void main() {\n"
+    "    if(kind[0] != 2) {\n"
+    "        if(vertex_normals) emit_line(position[0], direction[0], vertex_normals_color);\n"
+    "        return;\n"
+    "    }\n"
+    "    float l = section_normal_length;\n"
+    "    if(section_normals) emit_line(position[0], l * direction[0], section_normals_color);\n"
+    "    if(local_frames) {\n"
+    "        emit_line(position[0], l * axis_u[0], vec4(1.0, 0.0, 0.0, 1.0));\n"
+    "        emit_line(position[0], l * axis_v[0], vec4(0.0, 1.0, 0.0, 1.0));\n"
+    "        emit_line(position[0], l * direction[0], vec4(0.0, 0.0, 1.0, 1.0));\n"
+    "    }\n"
+    "}\n";
+
+// opaque lines, the weight of the sweep program for a = 1 in the order independent transparency pass
+static const char* normals_fragment_shader =
+    "#version 150 compatibility\n"
+    "uniform bool oit;\n"
+    "in vec4 color;\n"
+    "void main() {\n"
+    "    if(!oit) {\n"
+    "        gl_FragData[0] = color;\n"
+    "        return;\n"
+    "    }\n"
+    "    float d = 1.0 - 0.9 * gl_FragCoord.z;\n"
+    "    float w = clamp(1.0303 * 1e8 * d * d * d, 1e-2, 3e3);\n"
+    "    gl_FragData[0] = vec4(color.rgb, 1.0) * w;\n"
+    "    gl_FragData[1] = vec4(1.0);\n"
+    "}\n";
+
+static osg::Program* create_normals_program() {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, normals_vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::GEOMETRY, normals_geometry_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, normals_fragment_shader));
+    return program;
+}
+
+// shared by all the generalized cylinders
+static osg::Program* normals_program() {
+
+    static osg::ref_ptr<osg::Program> program = create_normals_program();
+    return program.get();
+}
+
+// the sweep of the geometry grown by the length of the section normals
+struct normals_bounding_box_callback : public osg::Drawable::ComputeBoundingBoxCallback {
+    explicit normals_bounding_box_callback(const GeneralizedCylinderGeometry* geometry) : m_geometry(geometry) { }
+    osg::BoundingBox computeBound(const osg::Drawable&) const override {
+        osg::BoundingBox bb = m_geometry->ComputeSweepBoundingBox();
+        if(!bb.valid()) return bb;
+        osg::Vec3 ext(section_normal_length, section_normal_length, section_normal_length);
+        return osg::BoundingBox(bb._min - ext, bb._max + ext);
+    }
+    const GeneralizedCylinderGeometry* m_geometry;
+};
+
+GeneralizedCylinderNormals::GeneralizedCylinderNormals(GeneralizedCylinderGeometry* geometry) :
+    m_geometry(geometry),
+    m_ring(new osg::DrawArrays(GL_POINTS)),
+    m_center(new osg::DrawArrays(GL_POINTS)),
+    m_vertex_normals(new osg::Uniform("vertex_normals", false)),
+    m_section_normals(new osg::Uniform("section_normals", false)),
+    m_local_frames(new osg::Uniform("local_frames", false)),
+    m_vertex_normals_color(new osg::Uniform("vertex_normals_color", osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f))),
+    m_section_normals_color(new osg::Uniform("section_normals_color", osg::Vec4(1.0f, 1.0f, 0.0f, 1.0f))) {
+
+    // the section texture and the template are kept up to date by the geometry from now on
+    m_geometry->SetSectionFrames(true);
+    setVertexArray(m_geometry->GetSweepTemplate());
+    setUseDisplayList(false);
+    setUseVertexBufferObjects(true);
+    setDataVariance(osg::Object::DYNAMIC);
+    setComputeBoundingBoxCallback(new normals_bounding_box_callback(m_geometry));
+
+    // protected from the flat programs of the pickers and of the transparency pass
+    osg::StateSet* ss = getOrCreateStateSet();
+    ss->setDataVariance(osg::Object::DYNAMIC);
+    ss->setAttributeAndModes(normals_program(), osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    ss->setTextureAttribute(0, m_geometry->GetSectionTexture());
+    ss->addUniform(new osg::Uniform("sections", 0));
+    ss->addUniform(new osg::Uniform("num_points", m_geometry->GetNumberOfPointsPerSection()));
+    ss->addUniform(new osg::Uniform("section_normal_length", section_normal_length));
+    ss->addUniform(m_vertex_normals.get());
+    ss->addUniform(m_section_normals.get());
+    ss->addUniform(m_local_frames.get());
+    ss->addUniform(m_vertex_normals_color.get());
+    ss->addUniform(m_section_normals_color.get());
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    Update();
+}
+
+void GeneralizedCylinderNormals::SetDisplay(bool vertex_normals, bool section_normals, bool local_frames) {
+
+    m_vertex_normals->set(vertex_normals);
+    m_section_normals->set(section_normals);
+    m_local_frames->set(local_frames);
+}
+
+void GeneralizedCylinderNormals::SetColors(const osg::Vec4& vertex_normals, const osg::Vec4& section_normals) {
+
+    m_vertex_normals_color->set(vertex_normals);
+    m_section_normals_color->set(section_normals);
+}
+
+void GeneralizedCylinderNormals::Update() {
+
+    // Step-1: the template is [ring | ring of the next section | ring with the section normal | center],
+    // the fans are lit with the section normal
+    int numpts = m_geometry->GetNumberOfPointsPerSection();
+    bool fan = (m_geometry->GetRenderingType() == rendering_type::triangle_fan);
+    m_ring->setFirst(fan ? 2 * numpts : 0);
+    m_ring->setCount(numpts);
+    m_center->setFirst(3 * numpts);
+    m_center->setCount(1);
+
+    // Step-2: one instance per section, zero instances would be drawn as a plain draw call
+    unsigned int num_sections = m_geometry->GetNumberOfSections();
+    m_ring->setNumInstances(num_sections);
+    m_center->setNumInstances(num_sections);
+    removePrimitiveSet(0, getNumPrimitiveSets());
+    if(num_sections > 0) {
+        addPrimitiveSet(m_ring.get());
+        addPrimitiveSet(m_center.get());
+    }
+    dirtyBound();
+}
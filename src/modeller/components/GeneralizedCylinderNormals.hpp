@@ -0,0 +1,39 @@
+#ifndef GENERALIZED_CYLINDER_NORMALS_HPP
+#define GENERALIZED_CYLINDER_NORMALS_HPP
+
+#include <osg/Geometry>
+#include <osg/Uniform>
+
+class GeneralizedCylinderGeometry;
+
+/*
+ * Vertex normals, section normals and local frames of a generalized cylinder, drawn by a geometry
+ * shader.
+ *
+ * The normals used to be line geometries built on the CPU, one node per section with two vertices
+ * per normal, rebuilt with the whole cylinder. This drawable has no vertices of its own: it shares
+ * the sweep template and the section texture of the geometry (see
+ * GeneralizedCylinderGeometry::SetSectionFrames) and draws the ring points and the center of the
+ * template as points, instanced once per section. The geometry shader turns a ring point into its
+ * normal and the center into the section normal and the three axes of the local frame, the uniforms
+ * select what is displayed. The normals are display only (node mask 0x1 of the parent).
+ */
+class GeneralizedCylinderNormals : public osg::Geometry {
+public:
+    explicit GeneralizedCylinderNormals(GeneralizedCylinderGeometry* geometry);
+    void SetDisplay(bool vertex_normals, bool section_normals, bool local_frames);
+    void SetColors(const osg::Vec4& vertex_normals, const osg::Vec4& section_normals);
+    // after the sections or the rendering type of the geometry changed
+    void Update();
+private:
+    GeneralizedCylinderGeometry* m_geometry;   // owned by the generalized cylinder
+    osg::ref_ptr<osg::DrawArrays> m_ring;
+    osg::ref_ptr<osg::DrawArrays> m_center;
+    osg::ref_ptr<osg::Uniform> m_vertex_normals;
+    osg::ref_ptr<osg::Uniform> m_section_normals;
+    osg::ref_ptr<osg::Uniform> m_local_frames;
+    osg::ref_ptr<osg::Uniform> m_vertex_normals_color;
+    osg::ref_ptr<osg::Uniform> m_section_normals_color;
+};
+
+#endif // GENERALIZED_CYLINDER_NORMALS_HPP
@@ -0,0 +1,102 @@
+#include "PrimitiveComponent.hpp"
+
+#include <osg/TriangleIndexFunctor>
+#include <iostream>
+
+// the proxies are only drawn by the picking
+static osg::Geode* create_proxy(PrimitiveInstances& instances) {
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(instances.GetUnitMesh());
+    geode->setNodeMask(PrimitiveInstances::proxy_node_mask);
+    return geode;
+}
+
+struct unit_mesh_triangles {
+    void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+        triangles->push_back(i1);
+        triangles->push_back(i2);
+        triangles->push_back(i3);
+    }
+    std::vector<unsigned int>* triangles;
+};
+
+PrimitiveComponent::PrimitiveComponent(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Matrixd& mat, const osg::Vec4& color) :
+    ComponentBase(component_id),
+    m_kind(instances->GetKind()),
+    m_instances(instances),
+    m_instance(instances->Add(mat, color)),
+    m_transform(new osg::MatrixTransform(mat)),
+    m_color(color) {
+
+    m_transform->addChild(create_proxy(*m_instances));
+    addChild(m_transform.get());
+}
+
+PrimitiveComponent::~PrimitiveComponent() {
+    m_instances->Remove(m_instance);
+}
+
+void PrimitiveComponent::SetMatrix(const osg::Matrixd& mat) {
+
+    m_transform->setMatrix(mat);
+    m_instances->Update(m_instance, mat, m_color);
+}
+
+void PrimitiveComponent::SetColor(const osg::Vec4& color) {
+
+    m_color = color;
+    m_instances->Update(m_instance, GetMatrix(), m_color);
+}
+
+bool PrimitiveComponent::GetAxisPoints(std::vector<osg::Vec3d>& points) const {
+
+    // the middle point is the center, about which the model solver rotates the component
+    const osg::Matrixd& mat = GetMatrix();
+    points.push_back(osg::Vec3d(0.0, 0.0, -1.0) * mat);
+    points.push_back(osg::Vec3d(0.0, 0.0, 0.0) * mat);
+    points.push_back(osg::Vec3d(0.0, 0.0, 1.0) * mat);
+    return true;
+}
+
+void PrimitiveComponent::ApplyTransform(const osg::Matrixd& mat) {
+
+    // the transformation of the unit mesh is followed by the one of the model
+    SetMatrix(GetMatrix() * mat);
+}
+
+void PrimitiveComponent::GetTriangleMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const {
+
+    // Step-1: the vertices by the transformation, the normals by its inverse transpose
+    const osg::Geometry* mesh = m_instances->GetUnitMesh();
+    const osg::Vec3Array* unit_vertices = static_cast<const osg::Vec3Array*>(mesh->getVertexArray());
+    const osg::Vec3Array* unit_normals = static_cast<const osg::Vec3Array*>(mesh->getNormalArray());
+    const osg::Matrixd& mat = GetMatrix();
+    osg::Matrixd inverse = osg::Matrixd::inverse(mat);
+    unsigned int first = static_cast<unsigned int>(vertices->size());
+    for(size_t i = 0; i < unit_vertices->size(); ++i) {
+        vertices->push_back((*unit_vertices)[i] * mat);
+        // n * M^-T for the row vectors of osg is M^-1 * n
+        osg::Vec3 n = osg::Matrixd::transform3x3(inverse, osg::Vec3d((*unit_normals)[i]));
+        n.normalize();
+        normals->push_back(n);
+    }
+
+    // Step-2: the triangles of the unit mesh after the vertices given
+    std::vector<unsigned int> unit_triangles;
+    osg::TriangleIndexFunctor<unit_mesh_triangles> functor;
+    functor.triangles = &unit_triangles;
+    mesh->accept(functor);
+    for(unsigned int index : unit_triangles)
+        triangles.push_back(first + index);
+}
+
+void PrimitiveComponent::Print() const {
+
+    ComponentBase::Print();
+    const osg::Matrixd& mat = GetMatrix();
+    std::cout << (m_kind == primitive_kind::cuboid ? "cuboid" : "sphere") << " instance " << m_instance
+              << " of " << m_instances->GetNumInstances() << std::endl;
+    for(int i = 0; i < 4; ++i)
+        std::cout << mat(i, 0) << " " << mat(i, 1) << " " << mat(i, 2) << " " << mat(i, 3) << std::endl;
+}
@@ -0,0 +1,48 @@
+#ifndef PRIMITIVE_COMPONENT_HPP
+#define PRIMITIVE_COMPONENT_HPP
+
+#include "ComponentBase.hpp"
+#include "PrimitiveInstances.hpp"
+#include <osg/MatrixTransform>
+#include <memory>
+
+/*
+ * Component drawn as an instance of the unit mesh of its kind (see PrimitiveInstances).
+ *
+ * The component is the transformation of the unit mesh into the model and a color, both are
+ * written to the row of its instance in the batch given, the one of its kind in the model. The only child of the component
+ * is a matrix transform over the shared unit mesh, which the main camera does not draw, for the
+ * intersections, the id buffer of the picking and the export. Moving a primitive thus rewrites a
+ * row of the instance texture and a matrix instead of rebuilding a geometry.
+ *
+ * The axis of a primitive is the z axis of its unit mesh, from the bottom to the top, thus the
+ * model solver constrains the primitives and the generalized cylinders alike.
+ */
+class PrimitiveComponent : public ComponentBase {
+public:
+    PrimitiveComponent(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Matrixd& mat, const osg::Vec4& color);
+    ~PrimitiveComponent();
+
+    primitive_kind GetKind() const { return m_kind; }
+    // unit mesh -> model
+    const osg::Matrixd& GetMatrix() const { return m_transform->getMatrix(); }
+    void SetMatrix(const osg::Matrixd& mat);
+    const osg::Vec4& GetColor() const { return m_color; }
+    void SetColor(const osg::Vec4& color);
+    // the unit mesh is not a geometry of the component, there are no normals to display
+    void DisplayVertexNormals(bool flag) override { }
+    bool GetAxisPoints(std::vector<osg::Vec3d>& points) const override;
+    void ApplyTransform(const osg::Matrixd& mat) override;
+    // the unit mesh in the coordinates of the component's parent
+    void GetTriangleMesh(osg::Vec3Array* vertices, osg::Vec3Array* normals, std::vector<unsigned int>& triangles) const;
+    void Print() const override;
+
+protected:
+    primitive_kind m_kind;
+    std::shared_ptr<PrimitiveInstances> m_instances;
+    unsigned int m_instance;                        // handle of the instance in the batch
+    osg::ref_ptr<osg::MatrixTransform> m_transform;
+    osg::Vec4 m_color;
+};
+
+#endif // PRIMITIVE_COMPONENT_HPP
@@ -0,0 +1,326 @@
+#include "PrimitiveInstances.hpp"
+
+#include <osg/Program>
+#include <osg/Shader>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <utility>
+
+// texels per instance in the instance texture: the three rows of the affine transformation, the color
+static const int instance_texels = 4;
+static const int initial_capacity = 64;
+// subdivisions of the icosahedron of the unit sphere, 642 vertices
+static const int sphere_subdivisions = 3;
+
+// the unit mesh transformed by the rows of the instance, lit as the sweep of the generalized cylinders
+// (the silhouette pass of the reprojection error draws the batch with the pick color)
+static const char* instances_vertex_shader =
+    "#version 150 compatibility\n"
+    "uniform sampler2D instances;\n"
+    "uniform bool picking;\n"
+    "uniform vec4 pick_color;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    vec4 r0 = texelFetch(instances, ivec2(0, gl_InstanceID), 0);\n"
+    "    vec4 r1 = texelFetch(instances, ivec2(1, gl_InstanceID), 0);\n"
+    "    vec4 r2 = texelFetch(instances, ivec2(2, gl_InstanceID), 0);\n"
+    "    vec4 c = texelFetch(instances, ivec2(3, gl_InstanceID), 0);\n"
+    "    vec4 p = vec4(gl_Vertex.xyz, 1.0);\n"
+    "    vec3 pos = vec3(dot(r0, p), dot(r1, p), dot(r2, p));\n"
+    "    vec3 nrm = inverse(mat3(r0.xyz, r1.xyz, r2.xyz)) * gl_Normal;\n"
+    "    vec3 n = normalize(gl_NormalMatrix * nrm);\n"
+    "    vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+    "    float diffuse = abs(dot(n, l));\n"
+    "    color = picking ? pick_color : vec4(c.rgb * (0.2 + 0.8 * diffuse), c.a);\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 1.0);\n"
+    "}\n";
+
+// the weighted color and the coverage of the sweep program for the order independent transparency pass
+static const char* instances_fragment_shader =
+    "#version 150 compatibility\n"
+    "uniform bool oit;\n"
+    "in vec4 color;\n"
+    "void main() {\n"
+    "    if(!oit) {\n"
+    "        gl_FragData[0] = color;\n"
+    "        return;\n"
+    "    }\n"
+    "    float a = color.a;\n"
+    "    float d = 1.0 - 0.9 * gl_FragCoord.z;\n"
+    "    float w = clamp(pow(min(1.0, 10.0 * a) + 0.01, 3.0) * 1e8 * d * d * d, 1e-2, 3e3);\n"
+    "    gl_FragData[0] = vec4(color.rgb * a, a) * w;\n"
+    "    gl_FragData[1] = vec4(a);\n"
+    "}\n";
+
+static osg::Program* create_instances_program() {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, instances_vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, instances_fragment_shader));
+    return program;
+}
+
+// shared by the batches of all the kinds
+static osg::Program* instances_program() {
+
+    static osg::ref_ptr<osg::Program> program = create_instances_program();
+    return program.get();
+}
+
+// four vertices per face for the flat normals, the faces are counter clockwise from the outside
+static void create_unit_cube(osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::DrawElementsUShort* elements) {
+
+    const osg::Vec3 x(1.0f, 0.0f, 0.0f), y(0.0f, 1.0f, 0.0f), z(0.0f, 0.0f, 1.0f);
+    // normal, u and v of every face with u x v = normal
+    const osg::Vec3 faces[6][3] = {
+        {  x, y, z }, { -x, z, y },
+        {  y, z, x }, { -y, x, z },
+        {  z, x, y }, { -z, y, x }
+    };
+    for(int f = 0; f < 6; ++f) {
+        const osg::Vec3& n = faces[f][0];
+        const osg::Vec3& u = faces[f][1];
+        const osg::Vec3& v = faces[f][2];
+        unsigned short first = static_cast<unsigned short>(vertices->size());
+        vertices->push_back(n - u - v);
+        vertices->push_back(n + u - v);
+        vertices->push_back(n + u + v);
+        vertices->push_back(n - u + v);
+        for(int i = 0; i < 4; ++i) normals->push_back(n);
+        const unsigned short quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for(int i = 0; i < 6; ++i) elements->push_back(static_cast<unsigned short>(first + quad[i]));
+    }
+}
+
+// subdivided icosahedron, the normals are the vertices
+static void create_unit_sphere(osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::DrawElementsUShort* elements) {
+
+    const float t = 0.5f * (1.0f + std::sqrt(5.0f));
+    const float ico_vertices[12][3] = {
+        { -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+        {  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+        {  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 }
+    };
+    const unsigned short ico_faces[60] = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+    };
+    for(int i = 0; i < 12; ++i) {
+        osg::Vec3 p(ico_vertices[i][0], ico_vertices[i][1], ico_vertices[i][2]);
+        p.normalize();
+        vertices->push_back(p);
+    }
+    std::vector<unsigned short> triangles(ico_faces, ico_faces + 60);
+
+    // Step-1: every edge is split once at its midpoint on the sphere
+    for(int s = 0; s < sphere_subdivisions; ++s) {
+        std::map<std::pair<unsigned short, unsigned short>, unsigned short> midpoints;
+        auto midpoint = [&](unsigned short a, unsigned short b) {
+            std::pair<unsigned short, unsigned short> key(std::min(a, b), std::max(a, b));
+            auto it = midpoints.find(key);
+            if(it != midpoints.end()) return it->second;
+            osg::Vec3 p = (*vertices)[a] + (*vertices)[b];
+            p.normalize();
+            unsigned short index = static_cast<unsigned short>(vertices->size());
+            vertices->push_back(p);
+            midpoints[key] = index;
+            return index;
+        };
+        std::vector<unsigned short> subdivided;
+        subdivided.reserve(4 * triangles.size());
+        for(size_t k = 0; k < triangles.size(); k += 3) {
+            unsigned short a = triangles[k], b = triangles[k + 1], c = triangles[k + 2];
+            unsigned short ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            const unsigned short split[12] = { a, ab, ca,  ab, b, bc,  ca, bc, c,  ab, bc, ca };
+            subdivided.insert(subdivided.end(), split, split + 12);
+        }
+        triangles.swap(subdivided);
+    }
+
+    // Step-2: the normals of the unit sphere
+    normals->assign(vertices->begin(), vertices->end());
+    elements->assign(triangles.begin(), triangles.end());
+}
+
+// the union of the transformed unit cubes, which also bound the unit spheres
+struct instances_bounding_box_callback : public osg::Drawable::ComputeBoundingBoxCallback {
+    explicit instances_bounding_box_callback(const PrimitiveInstances* instances) : m_instances(instances) { }
+    osg::BoundingBox computeBound(const osg::Drawable&) const override {
+        return m_instances->ComputeBoundingBox();
+    }
+    const PrimitiveInstances* m_instances;
+};
+
+PrimitiveInstances::PrimitiveInstances(primitive_kind kind) :
+    m_kind(kind),
+    m_mesh(new osg::Geometry),
+    m_batch(new osg::Geometry),
+    m_elements(new osg::DrawElementsUShort(GL_TRIANGLES)),
+    m_geode(new osg::Geode),
+    m_image(new osg::Image),
+    m_texture(new osg::Texture2D) {
+
+    // Step-1: the unit mesh, one instance of it for the proxies
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::DrawElementsUShort> elements = new osg::DrawElementsUShort(GL_TRIANGLES);
+    if(kind == primitive_kind::cuboid) create_unit_cube(vertices.get(), normals.get(), elements.get());
+    else                               create_unit_sphere(vertices.get(), normals.get(), elements.get());
+    m_mesh->setUseDisplayList(false);
+    m_mesh->setUseVertexBufferObjects(true);
+    m_mesh->setVertexArray(vertices.get());
+    m_mesh->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    m_mesh->addPrimitiveSet(elements.get());
+
+    // Step-2: instance texture, one row per instance
+    m_image->allocateImage(instance_texels, initial_capacity, 1, GL_RGBA, GL_FLOAT);
+    m_image->setInternalTextureFormat(GL_RGBA32F_ARB);
+    std::memset(m_image->data(), 0, m_image->getTotalSizeInBytes());
+    m_texture->setDataVariance(osg::Object::DYNAMIC);
+    m_texture->setResizeNonPowerOfTwoHint(false);
+    m_texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    m_texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    m_texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    m_texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    m_texture->setImage(m_image.get());
+
+    // Step-3: the batch draws the arrays of the unit mesh once per instance
+    m_elements->assign(elements->begin(), elements->end());
+    m_batch->setUseDisplayList(false);
+    m_batch->setUseVertexBufferObjects(true);
+    m_batch->setDataVariance(osg::Object::DYNAMIC);
+    m_batch->setVertexArray(vertices.get());
+    m_batch->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    m_batch->setComputeBoundingBoxCallback(new instances_bounding_box_callback(this));
+
+    // protected from the flat programs of the pickers and of the transparency pass
+    osg::StateSet* ss = m_batch->getOrCreateStateSet();
+    ss->setDataVariance(osg::Object::DYNAMIC);
+    ss->setAttributeAndModes(instances_program(), osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    ss->setTextureAttribute(0, m_texture.get());
+    ss->addUniform(new osg::Uniform("instances", 0));
+
+    m_geode->addDrawable(m_batch.get());
+    m_geode->setNodeMask(0x1);
+    m_geode->setName(kind == primitive_kind::cuboid ? "cuboid_instances" : "sphere_instances");
+}
+
+PrimitiveInstances::~PrimitiveInstances() {
+
+    m_batch->setComputeBoundingBoxCallback(nullptr);
+    m_geode->setNodeMask(0x0);
+}
+
+osg::Node* PrimitiveInstances::GetNode() {
+    return m_geode.get();
+}
+
+osg::Geometry* PrimitiveInstances::GetUnitMesh() {
+    return m_mesh.get();
+}
+
+unsigned int PrimitiveInstances::GetNumInstances() const {
+    return static_cast<unsigned int>(m_handles.size());
+}
+
+unsigned int PrimitiveInstances::Add(const osg::Matrixd& mat, const osg::Vec4& color) {
+
+    // Step-1: grow the texture by doubling its rows
+    unsigned int row = static_cast<unsigned int>(m_handles.size());
+    unsigned int rows = static_cast<unsigned int>(m_image->t());
+    if(row >= rows) {
+        osg::ref_ptr<osg::Image> image = new osg::Image;
+        image->allocateImage(instance_texels, 2 * rows, 1, GL_RGBA, GL_FLOAT);
+        image->setInternalTextureFormat(GL_RGBA32F_ARB);
+        std::memset(image->data(), 0, image->getTotalSizeInBytes());
+        std::memcpy(image->data(), m_image->data(), m_image->getTotalSizeInBytes());
+        m_image = image;
+        m_texture->setImage(m_image.get());
+        m_texture->dirtyTextureObject();
+    }
+
+    // Step-2: a released handle or a new one
+    unsigned int handle;
+    if(!m_free.empty()) {
+        handle = m_free.back();
+        m_free.pop_back();
+        m_rows[handle] = row;
+    }
+    else {
+        handle = static_cast<unsigned int>(m_rows.size());
+        m_rows.push_back(row);
+    }
+    m_handles.push_back(handle);
+    write_row(row, mat, color);
+    update_instances();
+    return handle;
+}
+
+void PrimitiveInstances::Remove(unsigned int instance) {
+
+    // the last row fills the removed one
+    unsigned int row = m_rows[instance];
+    unsigned int last = static_cast<unsigned int>(m_handles.size()) - 1;
+    if(row != last) {
+        copy_row(last, row);
+        m_handles[row] = m_handles[last];
+        m_rows[m_handles[row]] = row;
+    }
+    m_handles.pop_back();
+    m_free.push_back(instance);
+    update_instances();
+}
+
+void PrimitiveInstances::Update(unsigned int instance, const osg::Matrixd& mat, const osg::Vec4& color) {
+
+    write_row(m_rows[instance], mat, color);
+    m_image->dirty();
+    m_batch->dirtyBound();
+}
+
+osg::BoundingBox PrimitiveInstances::ComputeBoundingBox() const {
+
+    // the extent of the unit cube along an axis is the sum of the absolute values of the row
+    osg::BoundingBox bb;
+    for(unsigned int row = 0; row < m_handles.size(); ++row) {
+        const float* r = reinterpret_cast<const float*>(m_image->data(0, row));
+        osg::Vec3 ctr(r[3], r[7], r[11]);
+        osg::Vec3 ext(std::fabs(r[0]) + std::fabs(r[1]) + std::fabs(r[2]),
+                      std::fabs(r[4]) + std::fabs(r[5]) + std::fabs(r[6]),
+                      std::fabs(r[8]) + std::fabs(r[9]) + std::fabs(r[10]));
+        bb.expandBy(ctr - ext);
+        bb.expandBy(ctr + ext);
+    }
+    return bb;
+}
+
+void PrimitiveInstances::write_row(unsigned int row, const osg::Matrixd& mat, const osg::Vec4& color) {
+
+    // the rows of the column vector form, the osg matrices transform row vectors
+    float* r = reinterpret_cast<float*>(m_image->data(0, row));
+    for(int j = 0; j < 3; ++j)
+        for(int i = 0; i < 4; ++i)
+            r[4 * j + i] = static_cast<float>(mat(i, j));
+    for(int i = 0; i < 4; ++i)
+        r[12 + i] = color[i];
+}
+
+void PrimitiveInstances::copy_row(unsigned int from, unsigned int to) {
+
+    std::memcpy(m_image->data(0, to), m_image->data(0, from), instance_texels * 4 * sizeof(float));
+}
+
+void PrimitiveInstances::update_instances() {
+
+    // zero instances would be drawn as a plain draw call
+    unsigned int num_instances = GetNumInstances();
+    m_elements->setNumInstances(num_instances);
+    m_batch->removePrimitiveSet(0, m_batch->getNumPrimitiveSets());
+    if(num_instances > 0) m_batch->addPrimitiveSet(m_elements.get());
+    m_image->dirty();
+    m_batch->dirtyBound();
+}
@@ -0,0 +1,78 @@
+#ifndef PRIMITIVE_INSTANCES_HPP
+#define PRIMITIVE_INSTANCES_HPP
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Image>
+#include <osg/Matrixd>
+#include <osg/Texture2D>
+#include <vector>
+
+enum class primitive_kind : unsigned char {
+    cuboid,     // the cube [-1, 1]^3
+    sphere      // the unit sphere
+};
+
+/*
+ * Instanced display of the primitive components (see PrimitiveComponent).
+ *
+ * There is one batch per kind of primitive and per model, owned by the modeller of the frame (see
+ * ImageModeller::GetPrimitiveInstances), thus the batch of a frame is only drawn by its own canvas
+ * and its GL objects are released with its model. The components keep their batch alive, e.g.
+ * while they are held by the model history. The unit mesh of the kind is shared by all of its
+ * components and the batch draws it once per component in a single instanced draw call (the
+ * elements of the unit mesh with the number of instances). The affine transformation and the
+ * color of an instance are the texels of its row in a float texture, the vertex shader fetches
+ * them with gl_InstanceID as the sweep of the generalized cylinders fetches its sections. A
+ * component adds an instance and updates its row, a removed instance is replaced by the last one
+ * so that the rows of the instances stay contiguous; the handles of the instances do not change.
+ *
+ * The batch is display only (node mask 0x1), a shared node of the model (see
+ * OsgComponentHierarchy::AddSharedNode) that the main camera and the passes rendering the model
+ * draw. The components keep the unit mesh itself under their transformation for the
+ * intersections, the id buffer of the picking and the export: these proxies have the node mask
+ * proxy_node_mask, which the main camera does not draw, as the frozen components. The batches are
+ * created and edited by the UI thread.
+ */
+class PrimitiveInstances {
+public:
+    static const unsigned int proxy_node_mask = 0x2;
+
+    explicit PrimitiveInstances(primitive_kind kind);
+    // the model may still refer to the batch until it is replaced
+    ~PrimitiveInstances();
+
+    primitive_kind GetKind() const { return m_kind; }
+
+    // the batch of all the instances
+    osg::Node* GetNode();
+    // the unit mesh, shared by the batch and by the proxies of the components
+    osg::Geometry* GetUnitMesh();
+    // the handle of the new instance
+    unsigned int Add(const osg::Matrixd& mat, const osg::Vec4& color);
+    void Remove(unsigned int instance);
+    void Update(unsigned int instance, const osg::Matrixd& mat, const osg::Vec4& color);
+    unsigned int GetNumInstances() const;
+    osg::BoundingBox ComputeBoundingBox() const;
+
+private:
+    PrimitiveInstances(const PrimitiveInstances&) = delete;
+    PrimitiveInstances& operator=(const PrimitiveInstances&) = delete;
+
+    primitive_kind m_kind;
+    osg::ref_ptr<osg::Geometry> m_mesh;                 // a single instance, for the proxies
+    osg::ref_ptr<osg::Geometry> m_batch;                // the same arrays, all the instances
+    osg::ref_ptr<osg::DrawElementsUShort> m_elements;   // of the batch
+    osg::ref_ptr<osg::Geode> m_geode;
+    osg::ref_ptr<osg::Image> m_image;                   // one row per instance
+    osg::ref_ptr<osg::Texture2D> m_texture;
+    std::vector<unsigned int> m_rows;                   // row of each handle
+    std::vector<unsigned int> m_handles;                // handle of each row
+    std::vector<unsigned int> m_free;                   // released handles
+
+    void write_row(unsigned int row, const osg::Matrixd& mat, const osg::Vec4& color);
+    void copy_row(unsigned int from, unsigned int to);
+    void update_instances();
+};
+
+#endif // PRIMITIVE_INSTANCES_HPP
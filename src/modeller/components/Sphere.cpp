@@ -1,3 +1,30 @@
 #include "Sphere.hpp"
 
-Sphere::Sphere(unsigned int component_id, const osg::Vec4& color) : ComponentBase(component_id) { }
+// the poles of the unit sphere onto the up vector
+static osg::Matrixd sphere_matrix(const osg::Vec3d& center, double radius, const osg::Vec3d& up) {
+
+    return osg::Matrixd::scale(radius, radius, radius) * osg::Matrixd::rotate(osg::Vec3d(0.0, 0.0, 1.0), up) * osg::Matrixd::translate(center);
+}
+
+Sphere::Sphere(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Vec3d& center, double radius,
+               const osg::Vec3d& up, const osg::Vec4& color) :
+    PrimitiveComponent(component_id, instances, sphere_matrix(center, radius, up), color) { }
+
+void Sphere::Set(const osg::Vec3d& center, double radius) {
+
+    // the orientation of the poles is kept
+    osg::Vec3d up = osg::Matrixd::transform3x3(osg::Vec3d(0.0, 0.0, 1.0), GetMatrix());
+    up.normalize();
+    SetMatrix(sphere_matrix(center, radius, up));
+}
+
+osg::Vec3d Sphere::GetCenter() const {
+    return GetMatrix().getTrans();
+}
+
+double Sphere::GetRadius() const {
+
+    // a similarity, any row is the radius
+    const osg::Matrixd& mat = GetMatrix();
+    return osg::Vec3d(mat(0, 0), mat(0, 1), mat(0, 2)).length();
+}
@@ -1,11 +1,18 @@
 #ifndef SPHERE_HPP
 #define SPHERE_HPP
 
-#include "ComponentBase.hpp"
+#include "PrimitiveComponent.hpp"
 
-class Sphere : public ComponentBase {
+/*
+ * Sphere, the axis of the component is the diameter along the up vector given (the poles).
+ */
+class Sphere : public PrimitiveComponent {
 public:
-    Sphere(unsigned int component_id, const osg::Vec4& color);
+    Sphere(unsigned int component_id, const std::shared_ptr<PrimitiveInstances>& instances, const osg::Vec3d& center, double radius, const osg::Vec3d& up = osg::Vec3d(0.0, 1.0, 0.0),
+           const osg::Vec4& color = osg::Vec4(1.0f,1.0f,0.0f,0.2f));
+    void Set(const osg::Vec3d& center, double radius);
+    osg::Vec3d GetCenter() const;
+    double GetRadius() const;
 };
 
 #endif // SPHERE_HPP
@@ -1,7 +1,6 @@
 #include "ComponentRelationsDialog.hpp"
 #include "../../wx/WxGuiId.hpp"
 #include "../../osg/OsgWxFrame.hpp"
-#include "../optimization/ModelSolver.hpp"
 #include <wx/panel.h>
 #include <wx/statbox.h>
 #include <wx/checkbox.h>
@@ -82,8 +81,7 @@ void ComponentRelationsDialog::OnApply(wxCommandEvent& event) {
     get_enabled_constraints(gsc);
 
     // update the constraints between the selected components
-    ModelSolver* solver = m_parent->UsrGetModelSolver();
-    solver->UpdateOrCreateConstraints(selected_components[0], selected_components[1], gsc);
+    m_parent->UsrSetGeosemanticConstraints(selected_components[0], selected_components[1], gsc);
 }
 
 void ComponentRelationsDialog::OnClose(wxCommandEvent& event) {
@@ -0,0 +1,72 @@
+#include "GradientDisplayDialog.hpp"
+#include "../../wx/WxGuiId.hpp"
+#include "../../osg/OsgWxFrame.hpp"
+#include "../../osg/OsgGradientShader.hpp"
+#include <wx/panel.h>
+#include <wx/checkbox.h>
+#include <wx/sizer.h>
+#include <wx/slider.h>
+#include <wx/stattext.h>
+#include <wx/button.h>
+
+#include <cmath>
+#include <iostream>
+
+// the gain slider is in quarter steps, the threshold slider in percent
+static const int gain_steps = 4;
+static const int max_gain_value = 64 * gain_steps;
+
+BEGIN_EVENT_TABLE(GradientDisplayDialog, wxDialog)
+EVT_SLIDER(wxID_GRADIENT_DISPLAY_GAIN_SLIDER, GradientDisplayDialog::OnChange)
+EVT_SLIDER(wxID_GRADIENT_DISPLAY_THRESHOLD_SLIDER, GradientDisplayDialog::OnChange)
+EVT_CHECKBOX(wxID_GRADIENT_DISPLAY_EDGES_CHECKBOX, GradientDisplayDialog::OnChange)
+EVT_BUTTON(wxID_GRADIENT_DISPLAY_CLOSE_BUTTON, GradientDisplayDialog::OnClose)
+END_EVENT_TABLE()
+
+GradientDisplayDialog::GradientDisplayDialog(wxWindow* parent, const wxString& title, OsgGradientShader* shader) :
+    wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(280, 220)),
+    m_shader(shader) {
+
+    m_parent = dynamic_cast<OsgWxFrame*>(parent);
+    if(!m_parent)
+        std::cout << "ERROR: dynamic cast error" << std::endl;
+
+    wxBoxSizer* vmainbox = new wxBoxSizer(wxVERTICAL);
+    wxPanel* panel = new wxPanel(this);
+    wxBoxSizer* vbox = new wxBoxSizer(wxVERTICAL);
+    int gain = static_cast<int>(std::lround(m_shader->GetGain() * gain_steps));
+    int threshold = static_cast<int>(std::lround(m_shader->GetEdgeThreshold() * 100.0f));
+    vbox->Add(new wxStaticText(panel, wxID_ANY, wxT("Gain")));
+    m_gain = new wxSlider(panel, wxID_GRADIENT_DISPLAY_GAIN_SLIDER, gain, 1, max_gain_value, wxDefaultPosition, wxSize(250, -1));
+    vbox->Add(m_gain);
+    m_edges = new wxCheckBox(panel, wxID_GRADIENT_DISPLAY_EDGES_CHECKBOX, wxT("Display edges"));
+    m_edges->SetValue(m_shader->IsEdgeDisplay());
+    vbox->Add(m_edges);
+    vbox->Add(new wxStaticText(panel, wxID_ANY, wxT("Edge threshold (%)")));
+    m_edge_threshold = new wxSlider(panel, wxID_GRADIENT_DISPLAY_THRESHOLD_SLIDER, threshold, 0, 100, wxDefaultPosition, wxSize(250, -1), wxSL_HORIZONTAL | wxSL_LABELS);
+    vbox->Add(m_edge_threshold);
+    panel->SetSizer(vbox);
+
+    vmainbox->Add(panel, 1, wxALL, 5);
+    wxButton* close_button = new wxButton(this, wxID_GRADIENT_DISPLAY_CLOSE_BUTTON, wxT("Close"), wxDefaultPosition, wxSize(70, 30));
+    vmainbox->Add(close_button, 0, wxALIGN_RIGHT | wxALL, 5);
+    SetSizer(vmainbox);
+}
+
+void GradientDisplayDialog::OnChange(wxCommandEvent& event) {
+
+    // the uniforms are set by the update traversal, the draw thread may be reading them
+    OsgGradientShader* shader = m_shader;
+    float gain = static_cast<float>(m_gain->GetValue()) / gain_steps;
+    float threshold = static_cast<float>(m_edge_threshold->GetValue()) / 100.0f;
+    bool edges = m_edges->IsChecked();
+    m_parent->UsrEnqueueSceneUpdate([shader, gain, threshold, edges]() {
+        shader->SetGain(gain);
+        shader->SetEdgeThreshold(threshold);
+        shader->SetEdgeDisplay(edges);
+    });
+}
+
+void GradientDisplayDialog::OnClose(wxCommandEvent& event) {
+    Hide();
+}
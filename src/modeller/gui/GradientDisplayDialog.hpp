@@ -0,0 +1,27 @@
+#ifndef GRADIENT_DISPLAY_DIALOG_HPP
+#define GRADIENT_DISPLAY_DIALOG_HPP
+
+#include <wx/dialog.h>
+
+class wxCheckBox;
+class wxSlider;
+class wxCommandEvent;
+class OsgGradientShader;
+class OsgWxFrame;
+
+// live parameters of the shader gradient display, every change is drawn with the next frame
+class GradientDisplayDialog : public wxDialog {
+public:
+    GradientDisplayDialog(wxWindow* parent, const wxString& title, OsgGradientShader* shader);
+private:
+    OsgWxFrame* m_parent;
+    OsgGradientShader* m_shader;
+    wxSlider* m_gain;
+    wxSlider* m_edge_threshold;
+    wxCheckBox* m_edges;
+    void OnChange(wxCommandEvent& event);
+    void OnClose(wxCommandEvent& event);
+    DECLARE_EVENT_TABLE()
+};
+
+#endif // GRADIENT_DISPLAY_DIALOG_HPP
@@ -10,8 +10,7 @@
 
 // PUBLIC METHODS
 
-/*
-// Method-1: Needed to solve a nonlinear optimization problem for estimating the orientation of the circles
+// Method-1: the orientations of the circles are the normals of the planes that cut the cone in circles
 void CircleEstimator::estimate_3d_circles_with_fixed_depth_method1(const Ellipse2D& ellipse, Circle3D* circles, ProjectionParameters const * const pp, double desired_depth) {
 
     if(desired_depth > -pp->near || desired_depth < -pp->far) {
@@ -46,7 +45,6 @@ void CircleEstimator::estimate_3d_circles_with_fixed_radius_method1(const Ellips
         }
     }
 }
-*/
 
 // Method-2: Based on analytical solution
 int CircleEstimator::estimate_3d_circles_with_fixed_depth(const Ellipse2D& ellipse, Circle3D* circles, const ProjectionParameters* const pp, double desired_depth) {
@@ -121,17 +119,17 @@ void CircleEstimator::estimate_3d_circles_under_orthographic_projection(const El
 
 
 // PRIVATE METHODS
-/*
 void CircleEstimator::estimate_unit_3d_circles_method1(const Ellipse2D& ellipse, Circle3D* circles, const ProjectionParameters* const pp) {
 
     // we need to negate the near value, because in opengl near and far values are positive. We need the actual value
     // in mathemetical calculations.
 
     double near = -pp->near;
+    const double* coeff = ellipse.get_coefficients();
     Eigen::Matrix3d M;
-    M << ellipse.coeff[0],          ellipse.coeff[1]/2.0,      ellipse.coeff[3]/(2*near),
-         ellipse.coeff[1]/2.0,      ellipse.coeff[2],          ellipse.coeff[4]/(2*near),
-         ellipse.coeff[3]/(2*near), ellipse.coeff[4]/(2*near), ellipse.coeff[5]/(near*near);
+    M << coeff[0],          coeff[1]/2.0,      coeff[3]/(2*near),
+         coeff[1]/2.0,      coeff[2],          coeff[4]/(2*near),
+         coeff[3]/(2*near), coeff[4]/(2*near), coeff[5]/(near*near);
 
     Eigen::Vector3d n1, n2;
     solve_for_normals(M, n1, n2);
@@ -195,7 +193,6 @@ void CircleEstimator::construct_change_of_basis_matrix(Eigen::Matrix3d& mat, con
     mat(1, 2) = vec2(1);
     mat(2, 2) = vec2(2);
 }
-*/
 
 int CircleEstimator::estimate_unit_3d_circles(const Ellipse2D& ellipse, Circle3D* circles, const ProjectionParameters *const pp) {
 
@@ -209,10 +206,11 @@ int CircleEstimator::estimate_unit_3d_circles(const Ellipse2D& ellipse, Circle3D
      */
 
     double near = -pp->near;
+    const double* coeff = ellipse.get_coefficients();
     Eigen::Matrix3d Q;
-    Q << ellipse.coeff[0],          ellipse.coeff[1]/2.0,      ellipse.coeff[3]/(2*near),
-         ellipse.coeff[1]/2.0,      ellipse.coeff[2],          ellipse.coeff[4]/(2*near),
-         ellipse.coeff[3]/(2*near), ellipse.coeff[4]/(2*near), ellipse.coeff[5]/(near*near);
+    Q << coeff[0],          coeff[1]/2.0,      coeff[3]/(2*near),
+         coeff[1]/2.0,      coeff[2],          coeff[4]/(2*near),
+         coeff[3]/(2*near), coeff[4]/(2*near), coeff[5]/(near*near);
 
     // Step-2: Find the eigenvalues and eigenvectors of the matrix Q.
     /*
@@ -227,10 +225,16 @@ int CircleEstimator::estimate_unit_3d_circles(const Ellipse2D& ellipse, Circle3D
     if(eigensolver.info() != Eigen::Success)
         std::cout << "ERROR: Eigen solver is not successful!" << std::endl;
 
-    if(!check_eigenvalue_constraints(eigensolver.eigenvalues())) {
-        Q *= -1;
-        eigensolver = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>(Q);
-        if(!check_eigenvalue_constraints(eigensolver.eigenvalues()))
+    return unit_circles_from_eigen_decomposition(eigensolver.eigenvalues(), eigensolver.eigenvectors(), circles);
+}
+
+int CircleEstimator::unit_circles_from_eigen_decomposition(Eigen::Vector3d eigenvalues, Eigen::Matrix3d eigenvectors, Circle3D* circles) {
+
+    // eigenvalues of -Q are the negated eigenvalues of Q in reverse order with the same eigenvectors
+    if(!check_eigenvalue_constraints(eigenvalues)) {
+        eigenvalues = -eigenvalues.reverse().eval();
+        eigenvectors = eigenvectors.rowwise().reverse().eval();
+        if(!check_eigenvalue_constraints(eigenvalues))
             std::cout << "ERROR: Eigenvales does not macth with the ellipse constraints" << std::endl;
     }
 
@@ -254,18 +258,18 @@ int CircleEstimator::estimate_unit_3d_circles(const Ellipse2D& ellipse, Circle3D
     */
 
     Eigen::Matrix3d P;
-    P.col(0) << eigensolver.eigenvectors().col(1);
-    double lambda_1 = eigensolver.eigenvalues()(1);
+    P.col(0) << eigenvectors.col(1);
+    double lambda_1 = eigenvalues(1);
 
-    P.col(1) << eigensolver.eigenvectors().col(2);
-    double lambda_2 = eigensolver.eigenvalues()(2);
+    P.col(1) << eigenvectors.col(2);
+    double lambda_2 = eigenvalues(2);
 
-    P.col(2) << eigensolver.eigenvectors().col(0);
-    double lambda_3 = eigensolver.eigenvalues()(0);
+    P.col(2) << eigenvectors.col(0);
+    double lambda_3 = eigenvalues(0);
 
     if(P.determinant() < 0) {
-        P.col(0) << eigensolver.eigenvectors().col(2);
-        P.col(1) << eigensolver.eigenvectors().col(1);
+        P.col(0) << eigenvectors.col(2);
+        P.col(1) << eigenvectors.col(1);
         std::swap(lambda_1, lambda_2);
     }
 
@@ -1,13 +1,21 @@
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include "ComponentSolver.hpp"
 #include "../../geometry/Plane3D.hpp"
 #include "../../geometry/Ray3D.hpp"
+#include "../../utility/Logger.hpp"
+#include "../../utility/Profiler.hpp"
 #include "../../utility/Utility.hpp"
 #include "../components/GeneralizedCylinderGeometry.hpp"
 #include "../components/GeneralizedCylinder.hpp"
+#include <osg/Timer>
+#include <random>
 
 void ComponentSolver::SolveForSingleCircle(osg::Vec2dArray const * const proj, Circle3D& circle) {
 
+    Profiler::Scope scope("ComponentSolver::SolveForSingleCircle");
+
     // initialize the optimization parameters
     double center[3] = { circle.center[0], circle.center[1], circle.center[2] };
     double depths[2];
@@ -20,10 +28,12 @@ void ComponentSolver::SolveForSingleCircle(osg::Vec2dArray const * const proj, C
     depths[1] = p.z();
 
     ceres::Problem problem;
-    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctor_1, 4, 3, 2>(new CostFunctor_1(proj, circle, n));
+    ceres::CostFunction* cost_function = nullptr;
+    if(m_analytic_jacobians) cost_function = new CostFunction_1_Analytic(proj, circle, n);
+    else                     cost_function = new ceres::AutoDiffCostFunction<CostFunctor_1, 4, 3, 2>(new CostFunctor_1(proj, circle, n));
     problem.AddResidualBlock(cost_function, NULL, center, depths);
     ceres::Solve(options, &problem, &summary);
-    std::cout << summary.BriefReport() << "\n";
+    LogLine(log_level::debug) << summary.BriefReport();
 
     // update the circle
     circle.center[0] = center[0];
@@ -39,58 +49,577 @@ void ComponentSolver::SolveForSingleCircle(osg::Vec2dArray const * const proj, C
     circle.normal[2] = nrm.z();
 }
 
-void ComponentSolver::SolveGeneralizedCylinder(GeneralizedCylinder* gcyl) {
+bool ComponentSolver::RefineCircleToEdges(const std::vector<osg::Vec2d>& points, double outlier_scale, Circle3D& circle) const {
 
+    Profiler::Scope scope("ComponentSolver::RefineCircleToEdges");
+    // at least the 5 points of a conic
+    if(points.size() < 5) return false;
+
+    double params[6] = { circle.center[0], circle.center[1], circle.center[2], circle.normal[0], circle.normal[1], circle.normal[2] };
     ceres::Problem problem;
-    // initialize the lambdas
+    problem.AddResidualBlock(new SampsonCircleCostFunction(points, circle.radius, n, outlier_scale), NULL, params);
+    ceres::Solver::Options refine_options = options;
+    refine_options.linear_solver_type = ceres::DENSE_QR;
+    ceres::Solver::Summary refine_summary;
+    ceres::Solve(refine_options, &problem, &refine_summary);
+    LogLine(log_level::debug) << refine_summary.BriefReport();
+    if(!refine_summary.IsSolutionUsable()) return false;
 
-    GeneralizedCylinderGeometry* geom = gcyl->GetGeometry();
-    std::vector<double> lambdas(geom->GetNumberOfSections() - 1, 1.0);
+    Eigen::Vector3d normal(params[3], params[4], params[5]);
+    if(normal.norm() == 0.0) return false;
+    circle.center = Eigen::Vector3d(params[0], params[1], params[2]);
+    circle.normal = normal.normalized();
+    return true;
+}
 
-    for(int i = 0; i < lambdas.size(); ++i)
-        std::cout << lambdas[i] << std::endl;
-    std::cout << "----------------" << std::endl;
+void ComponentSolver::SolveGeneralizedCylinder(GeneralizedCylinder* gcyl) {
+
+    Profiler::Scope scope("ComponentSolver::SolveGeneralizedCylinder");
 
-    ceres::DynamicAutoDiffCostFunction<CostFunctor_2, 4>* cost_function =
-            new ceres::DynamicAutoDiffCostFunction<CostFunctor_2, 4>(new CostFunctor_2(geom->GetSections()));
+    // Step-1: the session of the generalized cylinder
+    std::unique_ptr<GeneralizedCylinderSolverSession>& session = m_sessions[gcyl->GetComponentId()];
+    if(!session) session.reset(new GeneralizedCylinderSolverSession(m_analytic_jacobians));
 
-    std::vector<double*> parameters;
-    for(int i = 0; i < lambdas.size(); ++i) {
-        parameters.push_back(&lambdas[i]);
-        cost_function->AddParameterBlock(1);
+    // Step-2: the normal equations are tridiagonal, a sparse factorization is linear in the number of sections
+    ceres::Solver::Options gc_options = options;
+    if(ceres::IsSparseLinearAlgebraLibraryTypeAvailable(gc_options.sparse_linear_algebra_library_type)) {
+        gc_options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+    }
+    else {
+        gc_options.linear_solver_type = ceres::CGNR;
+        gc_options.preconditioner_type = ceres::JACOBI;
     }
-    cost_function->SetNumResiduals(geom->GetNumberOfSections() - 1);
 
-    problem.AddResidualBlock(cost_function, NULL, parameters);
-    ceres::Solve(options, &problem, &summary);
-    std::cout << summary.BriefReport() << "\n";
+    // Step-3: re-solve the modified part and update the generalized cylinder
+    SectionStore& sections = gcyl->GetGeometry()->GetSections();
+    if(!session->Solve(sections, gc_options, summary)) return;
+    LogLine(log_level::debug) << summary.BriefReport();
+    gcyl->Recalculate();
+}
 
-    for(int i = 0; i < lambdas.size(); ++i)
-        std::cout << lambdas[i] << std::endl;
+void ComponentSolver::SolveGeneralizedCylinder(GeneralizedCylinder* gcyl, section_constraints constraint) {
 
-    // update the generalized cylinder
-    std::vector<Circle3D>& sections = geom->GetSections();
-    for(int i = 1; i < sections.size(); ++i) {
-        sections[i].center *= lambdas[i-1];
-        sections[i].radius *= lambdas[i-1];
+    double cost = 0.0;
+    SectionStore& sections = gcyl->GetGeometry()->GetSections();
+    switch(constraint) {
+    case section_constraints::none:
+        SolveGeneralizedCylinder(gcyl);
+        return;
+    case section_constraints::constant:
+        cost = SolveSectionProfile<section_constraints::constant>(sections);
+        break;
+    case section_constraints::linear_scaling:
+        cost = SolveSectionProfile<section_constraints::linear_scaling>(sections);
+        break;
     }
+    if(cost < 0.0) return;
+    LogLine(log_level::debug) << "Section profile cost: " << cost;
     gcyl->Recalculate();
 }
 
+/*
+ * With the scale l_i of the section i, the residual of the pair (i-1, i) is the vector
+ * v_i = l_{i-1} * (n_i x C_{i-1}) - l_i * (n_i x C_i), the norm of which is CostFunctor_2. Under a
+ * section constraint the scaled radius l_i * r_i is the profile r_0 * (1 + slope * w(t_i)), thus
+ * l_i = a_i + slope * b_i with a_i = r_0 / r_i and b_i = r_0 * w(t_i) / r_i, and v_i = u_i + slope * z_i
+ * is affine in the slope. The sum of the squared residuals is minimized in closed form, instead of
+ * the problem with a free scale per section. The first section is fixed (t_0 = 0, l_0 = 1), the cost
+ * is returned, -1 if there is nothing to solve.
+ */
+template <section_constraints constraint>
+double ComponentSolver::SolveSectionProfile(SectionStore& sections) {
+
+    typedef section_profile<constraint> profile;
+    Profiler::Scope scope("ComponentSolver::SolveSectionProfile");
+    size_t num_sections = sections.size();
+    if(num_sections < 2 || sections.radius(0) <= 0.0) return -1.0;
+
+    // Step-1: normalized chord length of the axis before the scaling
+    std::vector<double> t(num_sections, 0.0);
+    for(size_t i = 1; i < num_sections; ++i)
+        t[i] = t[i-1] + (Eigen::Map<const Eigen::Vector3d>(sections.center(i)) - Eigen::Map<const Eigen::Vector3d>(sections.center(i-1))).norm();
+    for(size_t i = 1; i < num_sections; ++i)
+        t[i] = (t.back() > 0.0) ? t[i] / t.back() : static_cast<double>(i) / static_cast<double>(num_sections - 1);
+
+    // Step-2: the scales as affine functions of the slope
+    double r0 = sections.radius(0);
+    std::vector<double> a(num_sections), b(num_sections);
+    for(size_t i = 0; i < num_sections; ++i) {
+        a[i] = r0 / sections.radius(i);
+        b[i] = r0 * profile::slope_weight(t[i]) / sections.radius(i);
+    }
+
+    // Step-3: least squares of the slope over all the pairs, one normal equation
+    double uz = 0.0, zz = 0.0, uu = 0.0;
+    for(size_t i = 1; i < num_sections; ++i) {
+        Eigen::Map<const Eigen::Vector3d> n1(sections.normal(i));
+        Eigen::Vector3d A = n1.cross(Eigen::Map<const Eigen::Vector3d>(sections.center(i-1)));
+        Eigen::Vector3d B = n1.cross(Eigen::Map<const Eigen::Vector3d>(sections.center(i)));
+        Eigen::Vector3d u = a[i-1] * A - a[i] * B;
+        Eigen::Vector3d z = b[i-1] * A - b[i] * B;
+        uz += u.dot(z);
+        zz += z.squaredNorm();
+        uu += u.squaredNorm();
+    }
+    double slope = (profile::num_parameters > 0 && zz > 0.0) ? -uz / zz : 0.0;
+
+    // Step-4: scale the sections
+    for(size_t i = 1; i < num_sections; ++i)
+        sections.scale(i, a[i] + slope * b[i]);
+    return 0.5 * (uu + 2.0 * slope * uz + slope * slope * zz);
+}
+
+template double ComponentSolver::SolveSectionProfile<section_constraints::constant>(SectionStore& sections);
+template double ComponentSolver::SolveSectionProfile<section_constraints::linear_scaling>(SectionStore& sections);
+
 void ComponentSolver::SolveDepth(const Circle3D& C0, Circle3D& C1) {
 
-    // initialize the optimization parameters
-    double s = 1;
+    // initialize the optimization parameters with the previous solution
+    Circle3D solved = C1;
+    double cost = SolveDepth(C0, solved, m_depth_scale, &summary);
+    LogLine(log_level::debug) << summary.BriefReport();
+    if(cost < 0.0) return;
+    m_depth_scale = solved.radius / C1.radius;
+    C1 = solved;
+}
+
+double ComponentSolver::SolveDepth(const Circle3D& C0, Circle3D& C1, double initial_scale, ceres::Solver::Summary* depth_summary) const {
+
+    Profiler::Scope scope("ComponentSolver::SolveDepth");
+    double s = initial_scale;
     ceres::Problem problem;
-    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctor_Depth, 1, 1>(new CostFunctor_Depth(C0, C1));
+    ceres::CostFunction* cost_function = nullptr;
+    if(m_analytic_jacobians) cost_function = new CostFunction_Depth_Analytic(C0, C1);
+    else                     cost_function = new ceres::AutoDiffCostFunction<CostFunctor_Depth, 1, 1>(new CostFunctor_Depth(C0, C1));
     problem.AddResidualBlock(cost_function, NULL, &s);
-    ceres::Solve(options, &problem, &summary);
-    std::cout << summary.BriefReport() << "\n";
+    ceres::Solver::Summary local_summary;
+    if(depth_summary == nullptr) depth_summary = &local_summary;
+    ceres::Solve(options, &problem, depth_summary);
+    if(!depth_summary->IsSolutionUsable()) return -1.0;
 
     // scale the circle
     C1.center *= s;
     C1.radius *= s;
+    return depth_summary->final_cost;
+}
+
+void ComponentSolver::ForgetComponent(unsigned int component_id) {
+    m_sessions.erase(component_id);
+}
+
+void ComponentSolver::ForgetAllComponents() {
+    m_sessions.clear();
+    m_depth_scale = 1.0;
+}
+
+void ComponentSolver::SetAnalyticJacobians(bool flag) {
+
+    // the existing sessions keep their cost functions
+    m_analytic_jacobians = flag;
+}
+
+// evaluates the two cost functions at the same point, returns the largest relative difference of the jacobians
+static double compare_cost_functions(const ceres::CostFunction& f1, const ceres::CostFunction& f2, double const* const* parameters) {
+
+    const auto& sizes = f1.parameter_block_sizes();
+    int num_residuals = f1.num_residuals();
+    std::vector<double> r1(num_residuals), r2(num_residuals);
+    std::vector<std::vector<double>> j1(sizes.size()), j2(sizes.size());
+    std::vector<double*> jp1(sizes.size()), jp2(sizes.size());
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        j1[i].resize(num_residuals * sizes[i]);
+        j2[i].resize(num_residuals * sizes[i]);
+        jp1[i] = j1[i].data();
+        jp2[i] = j2[i].data();
+    }
+    f1.Evaluate(parameters, r1.data(), jp1.data());
+    f2.Evaluate(parameters, r2.data(), jp2.data());
+
+    double max_diff = 0.0;
+    for(int i = 0; i < num_residuals; ++i)
+        max_diff = std::max(max_diff, std::abs(r1[i] - r2[i]) / (1.0 + std::abs(r1[i])));
+    for(size_t i = 0; i < sizes.size(); ++i)
+        for(size_t k = 0; k < j1[i].size(); ++k)
+            max_diff = std::max(max_diff, std::abs(j1[i][k] - j2[i][k]) / (1.0 + std::abs(j1[i][k])));
+    return max_diff;
+}
+
+// the seconds for num_samples evaluations with jacobians
+static double time_cost_function(const ceres::CostFunction& f, double const* const* parameters, int num_samples) {
+
+    const auto& sizes = f.parameter_block_sizes();
+    std::vector<double> residuals(f.num_residuals());
+    std::vector<std::vector<double>> jac(sizes.size());
+    std::vector<double*> jp(sizes.size());
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        jac[i].resize(f.num_residuals() * sizes[i]);
+        jp[i] = jac[i].data();
+    }
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for(int i = 0; i < num_samples; ++i)
+        f.Evaluate(parameters, residuals.data(), jp.data());
+    return osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+}
+
+bool ComponentSolver::CheckAnalyticJacobians(int num_samples, double tolerance) {
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    auto random_circle = [&]() {
+        return Circle3D(Eigen::Vector3d(uniform(rng), uniform(rng), uniform(rng) - 3.0),
+                        Eigen::Vector3d(uniform(rng), uniform(rng), uniform(rng)), uniform(rng) + 2.0);
+    };
+
+    // Step-1: the largest differences over random inputs
+    double diff_1 = 0.0, diff_2 = 0.0, diff_depth = 0.0;
+    double time_auto[3] = { 0.0, 0.0, 0.0 }, time_analytic[3] = { 0.0, 0.0, 0.0 };
+    int num_points = std::max(1, num_samples / 100);
+    for(int i = 0; i < num_points; ++i) {
+        osg::ref_ptr<osg::Vec2dArray> proj = new osg::Vec2dArray;
+        proj->push_back(osg::Vec2d(uniform(rng), uniform(rng)));
+        proj->push_back(osg::Vec2d(uniform(rng), uniform(rng)));
+        Circle3D c0 = random_circle(), c1 = random_circle();
+        SectionStore pair(c0);
+        pair.push_back(c1);
+        double near = -1.0 - std::abs(uniform(rng));
+        double center[3] = { uniform(rng), uniform(rng), uniform(rng) - 3.0 };
+        double depths[2] = { uniform(rng) - 3.0, uniform(rng) - 3.0 };
+        double lambdas[2] = { uniform(rng) + 1.5, uniform(rng) + 1.5 };
+        double const* params_1[2] = { center, depths };
+        double const* params_2[2] = { &lambdas[0], &lambdas[1] };
+        double const* params_depth[1] = { &lambdas[0] };
+
+        ceres::AutoDiffCostFunction<CostFunctor_1, 4, 3, 2> auto_1(new CostFunctor_1(proj.get(), c0, near));
+        CostFunction_1_Analytic analytic_1(proj.get(), c0, near);
+        ceres::AutoDiffCostFunction<CostFunctor_2, 1, 1, 1> auto_2(new CostFunctor_2(pair, 1));
+        CostFunction_2_Analytic analytic_2(pair, 1);
+        ceres::AutoDiffCostFunction<CostFunctor_Depth, 1, 1> auto_depth(new CostFunctor_Depth(c0, c1));
+        CostFunction_Depth_Analytic analytic_depth(c0, c1);
+
+        diff_1 = std::max(diff_1, compare_cost_functions(auto_1, analytic_1, params_1));
+        diff_2 = std::max(diff_2, compare_cost_functions(auto_2, analytic_2, params_2));
+        diff_depth = std::max(diff_depth, compare_cost_functions(auto_depth, analytic_depth, params_depth));
+
+        // Step-2: the evaluation times
+        time_auto[0] += time_cost_function(auto_1, params_1, 100);
+        time_analytic[0] += time_cost_function(analytic_1, params_1, 100);
+        time_auto[1] += time_cost_function(auto_2, params_2, 100);
+        time_analytic[1] += time_cost_function(analytic_2, params_2, 100);
+        time_auto[2] += time_cost_function(auto_depth, params_depth, 100);
+        time_analytic[2] += time_cost_function(analytic_depth, params_depth, 100);
+    }
+
+    const char* names[3] = { "CostFunctor_1", "CostFunctor_2", "CostFunctor_Depth" };
+    double diffs[3] = { diff_1, diff_2, diff_depth };
+    bool passed = true;
+    for(int i = 0; i < 3; ++i) {
+        std::cout << "INFO: " << names[i] << " max difference: " << diffs[i]
+                  << ", autodiff: " << 1e9 * time_auto[i] / (100 * num_points) << " ns"
+                  << ", analytic: " << 1e9 * time_analytic[i] / (100 * num_points) << " ns" << std::endl;
+        if(!(diffs[i] <= tolerance)) {
+            std::cout << "ERROR: Analytic jacobian of " << names[i] << " does not match autodiff" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+bool CostFunction_1_Analytic::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {
+
+    const double* c = parameters[0];
+    const double* d = parameters[1];
+    double x0 = m_proj->at(0).x(), y0 = m_proj->at(0).y();
+    double x1 = m_proj->at(1).x(), y1 = m_proj->at(1).y();
+    Eigen::Vector3d C(c[0], c[1], c[2]);
+    Eigen::Vector3d e0(x0, y0, 1.0), e1(x1, y1, 1.0);
+    Eigen::Vector3d a = C - d[0] * e0;
+    Eigen::Vector3d b = C - d[1] * e1;
+    Eigen::Vector3d N = a.cross(b);
+    Eigen::Vector3d w = m_circle.center - C;
+    Eigen::Vector3d q = N.cross(w);
+    // same as vec1 and vec2 of CostFunctor_1
+    double v1 = 2.0 * x0 * x0 + n * n;
+    double v2 = 2.0 * x1 * x1 + n * n;
+    double r2 = m_circle.radius * m_circle.radius;
+
+    residuals[0] = (x1 * d[1] - x0 * d[0]) * c[0] + (y1 * d[1] - y0 * d[0]) * c[1] + n * (d[1] - d[0]) * c[2] +
+                   (d[0] * d[0] * v1 - d[1] * d[1] * v2) / (2.0 * n);
+    residuals[1] = q.squaredNorm();
+    residuals[2] = r2 - a.squaredNorm();
+    residuals[3] = r2 - b.squaredNorm();
+    if(jacobians == nullptr) return true;
+
+    // row major, 4x3 for the center and 4x2 for the depths
+    if(jacobians[0] != nullptr) {
+        double* J = jacobians[0];
+        J[0] = x1 * d[1] - x0 * d[0];
+        J[1] = y1 * d[1] - y0 * d[0];
+        J[2] = n * (d[1] - d[0]);
+        Eigen::Vector3d ba = b - a;
+        for(int k = 0; k < 3; ++k) {
+            Eigen::Vector3d u = Eigen::Vector3d::Unit(k);
+            J[3 + k] = 2.0 * q.dot(u.cross(ba).cross(w) - N.cross(u));
+            J[6 + k] = -2.0 * a[k];
+            J[9 + k] = -2.0 * b[k];
+        }
+    }
+    if(jacobians[1] != nullptr) {
+        double* J = jacobians[1];
+        J[0] = -x0 * c[0] - y0 * c[1] - n * c[2] + d[0] * v1 / n;
+        J[1] =  x1 * c[0] + y1 * c[1] + n * c[2] - d[1] * v2 / n;
+        J[2] = -2.0 * q.dot(e0.cross(b).cross(w));
+        J[3] = -2.0 * q.dot(a.cross(e1).cross(w));
+        J[4] = 2.0 * a.dot(e0);
+        J[5] = 0.0;
+        J[6] = 0.0;
+        J[7] = 2.0 * b.dot(e1);
+    }
+    return true;
+}
+
+SampsonCircleCostFunction::SampsonCircleCostFunction(const std::vector<osg::Vec2d>& points, double radius, double near, double outlier_scale) :
+    m_num_points(points.size()),
+    m_radius(radius),
+    m_outlier_scale(outlier_scale),
+    n(near) {
+
+    // the padding repeats the last point, its residuals are not written
+    size_t padded = (m_num_points + chunk_size - 1) / chunk_size * chunk_size;
+    m_x.resize(padded, points.empty() ? 0.0 : points.back().x());
+    m_y.resize(padded, points.empty() ? 0.0 : points.back().y());
+    for(size_t i = 0; i < m_num_points; ++i) {
+        m_x[i] = points[i].x();
+        m_y[i] = points[i].y();
+    }
+    set_num_residuals(static_cast<int>(m_num_points) + 1);
+    mutable_parameter_block_sizes()->push_back(6);
+}
+
+void SampsonCircleCostFunction::circle_conic(const Eigen::Vector3d& C, const Eigen::Vector3d& N, double radius, Eigen::Matrix3d& Q, Eigen::Matrix3d* D) {
+
+    // the derivatives by the center, the normal and the radius, all symmetric 3x3
+    double d = N.dot(C);
+    double k = C.squaredNorm() - radius * radius;
+    Eigen::Matrix3d S = C * N.transpose() + N * C.transpose();
+    Q = d * d * Eigen::Matrix3d::Identity() - d * S + k * N * N.transpose();
+    if(!D) return;
+    for(int j = 0; j < 3; ++j) {
+        Eigen::Vector3d e = Eigen::Vector3d::Unit(j);
+        D[j] = 2.0 * d * N[j] * Eigen::Matrix3d::Identity() - N[j] * S - d * (e * N.transpose() + N * e.transpose()) + 2.0 * C[j] * N * N.transpose();
+        D[3 + j] = 2.0 * d * C[j] * Eigen::Matrix3d::Identity() - C[j] * S - d * (C * e.transpose() + e * C.transpose()) + k * (e * N.transpose() + N * e.transpose());
+    }
+    D[6] = -2.0 * radius * N * N.transpose();
+}
+
+void SampsonCircleCostFunction::evaluate_points(const Eigen::Matrix3d& Q, const Eigen::Matrix3d* D, int num_derivatives,
+                                                double* residuals, double* const* columns, const int* strides) const {
+
+    // the points chunk by chunk, the inner loops over a chunk have no dependencies
+    for(size_t first = 0; first < m_num_points; first += chunk_size) {
+        const double* x = &m_x[first];
+        const double* y = &m_y[first];
+        double qx[chunk_size], qy[chunk_size], F[chunk_size], inv_g[chunk_size], r[chunk_size], w[chunk_size];
+        for(int i = 0; i < chunk_size; ++i) {
+            // Q p, F = p^T Q p and the gradient 2 (Q p)_xy
+            qx[i] = Q(0,0) * x[i] + Q(0,1) * y[i] + Q(0,2) * n;
+            qy[i] = Q(1,0) * x[i] + Q(1,1) * y[i] + Q(1,2) * n;
+            double qz = Q(2,0) * x[i] + Q(2,1) * y[i] + Q(2,2) * n;
+            F[i] = x[i] * qx[i] + y[i] * qy[i] + n * qz;
+            double g = std::sqrt(qx[i] * qx[i] + qy[i] * qy[i]);
+            inv_g[i] = (g > 0.0) ? 1.0 / g : 0.0;
+            r[i] = 0.5 * F[i] * inv_g[i];
+        }
+
+        // the Cauchy loss of each point, r' = w r with the factor w of the jacobians, 1 at r = 0
+        double robust[chunk_size];
+        for(int i = 0; i < chunk_size; ++i) {
+            robust[i] = r[i];
+            w[i] = 1.0;
+            if(m_outlier_scale <= 0.0 || r[i] == 0.0) continue;
+            double c2 = m_outlier_scale * m_outlier_scale;
+            double s = r[i] * r[i];
+            robust[i] = std::copysign(std::sqrt(c2 * std::log1p(s / c2)), r[i]);
+            w[i] = r[i] / (robust[i] * (1.0 + s / c2));
+        }
+        size_t count = std::min(static_cast<size_t>(chunk_size), m_num_points - first);
+        for(size_t i = 0; i < count; ++i)
+            residuals[first + i] = robust[i];
+        if(!D) continue;
+
+        // r = F / (2 g): dr = dF / (2 g) - r * dg / g with dg = (qx dqx + qy dqy) / g
+        for(int j = 0; j < num_derivatives; ++j) {
+            if(!columns[j]) continue;
+            const Eigen::Matrix3d& Dj = D[j];
+            double J[chunk_size];
+            for(int i = 0; i < chunk_size; ++i) {
+                double dqx = Dj(0,0) * x[i] + Dj(0,1) * y[i] + Dj(0,2) * n;
+                double dqy = Dj(1,0) * x[i] + Dj(1,1) * y[i] + Dj(1,2) * n;
+                double dqz = Dj(2,0) * x[i] + Dj(2,1) * y[i] + Dj(2,2) * n;
+                double dF = x[i] * dqx + y[i] * dqy + n * dqz;
+                double dg = (qx[i] * dqx + qy[i] * dqy) * inv_g[i];
+                J[i] = w[i] * (0.5 * dF * inv_g[i] - r[i] * dg * inv_g[i]);
+            }
+            for(size_t i = 0; i < count; ++i)
+                columns[j][strides[j] * (first + i)] = J[i];
+        }
+    }
+}
+
+bool SampsonCircleCostFunction::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {
+
+    // Step-1: the conic and its derivatives by the 6 parameters
+    Eigen::Map<const Eigen::Vector3d> N(parameters[0] + 3);
+    bool with_jacobians = (jacobians != nullptr && jacobians[0] != nullptr);
+    Eigen::Matrix3d Q, D[7];
+    circle_conic(Eigen::Map<const Eigen::Vector3d>(parameters[0]), N, m_radius, Q, with_jacobians ? D : nullptr);
+
+    // Step-2: the points, row major 6 per residual
+    double* columns[6];
+    int strides[6];
+    for(int j = 0; j < 6; ++j) {
+        columns[j] = with_jacobians ? jacobians[0] + j : nullptr;
+        strides[j] = 6;
+    }
+    evaluate_points(Q, with_jacobians ? D : nullptr, 6, residuals, columns, strides);
+
+    // Step-3: the scale of the normal
+    residuals[m_num_points] = N.squaredNorm() - 1.0;
+    if(with_jacobians) {
+        for(int j = 0; j < 6; ++j)
+            jacobians[0][6 * m_num_points + j] = (j < 3) ? 0.0 : 2.0 * N[j - 3];
+    }
+    return true;
 }
 
+bool CostFunction_2_Analytic::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {
 
+    // r = |l0 * A - l1 * B| with A = n1 x C0 and B = n1 x C1
+    Eigen::Map<const Eigen::Vector3d> C0(m_sections.center(m_index - 1));
+    Eigen::Map<const Eigen::Vector3d> C1(m_sections.center(m_index));
+    Eigen::Map<const Eigen::Vector3d> n1(m_sections.normal(m_index));
+    Eigen::Vector3d A = n1.cross(C0);
+    Eigen::Vector3d B = n1.cross(C1);
+    Eigen::Vector3d v = parameters[0][0] * A - parameters[1][0] * B;
+    double r = v.norm();
+    residuals[0] = r;
+    if(jacobians == nullptr) return true;
 
+    // the norm is not differentiable at zero, the residual is already minimal there
+    double inv = (r > 0.0) ? 1.0 / r : 0.0;
+    if(jacobians[0] != nullptr) jacobians[0][0] =  v.dot(A) * inv;
+    if(jacobians[1] != nullptr) jacobians[1][0] = -v.dot(B) * inv;
+    return true;
+}
+
+bool CostFunction_Depth_Analytic::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {
+
+    const Eigen::Vector3d& C1 = m_circle_1.center;
+    Eigen::Vector3d diff = parameters[0][0] * C1 - m_circle_0.center;
+    Eigen::Vector3d g0 = diff.cross(m_circle_0.normal);
+    Eigen::Vector3d g1 = diff.cross(m_circle_1.normal);
+    residuals[0] = 20.0 * g0.squaredNorm() + g1.squaredNorm();
+    if(jacobians != nullptr && jacobians[0] != nullptr)
+        jacobians[0][0] = 40.0 * g0.dot(C1.cross(m_circle_0.normal)) + 2.0 * g1.dot(C1.cross(m_circle_1.normal));
+    return true;
+}
+
+// the scales within this distance of a modified section are re-solved
+static const size_t session_window = 2;
+
+static ceres::Problem::Options session_problem_options() {
+
+    ceres::Problem::Options options;
+    options.enable_fast_removal = true;
+    return options;
+}
+
+GeneralizedCylinderSolverSession::GeneralizedCylinderSolverSession(bool analytic_jacobians) :
+    m_problem(session_problem_options()),
+    m_unit_scale(1.0),
+    m_analytic_jacobians(analytic_jacobians),
+    m_solved(false) {
+
+    m_problem.AddParameterBlock(&m_unit_scale, 1);
+    m_problem.SetParameterBlockConstant(&m_unit_scale);
+}
+
+bool GeneralizedCylinderSolverSession::Solve(SectionStore& sections, const ceres::Solver::Options& options, ceres::Solver::Summary& summary) {
+
+    // Step-1: synchronize with the geometry, the deleted sections are removed from the end
+    while(m_measured.size() > sections.size())
+        remove_last_section();
+    std::vector<bool> modified(sections.size(), false);
+    for(size_t i = 0; i < m_measured.size(); ++i) {
+        if(is_same(sections, m_written, i)) continue;
+        // an edited section is measured again
+        m_measured[i] = sections[i];
+        m_written[i] = sections[i];
+        if(i > 0) m_lambdas[i-1] = 1.0;
+        modified[i] = true;
+    }
+    for(size_t i = m_measured.size(); i < sections.size(); ++i) {
+        add_section(sections[i]);
+        modified[i] = true;
+    }
+    if(m_lambdas.empty()) return false;
+
+    // Step-2: only the scales around the modified sections are variable
+    bool any = false;
+    for(size_t i = 1; i < sections.size(); ++i) {
+        size_t first = (i > session_window) ? i - session_window : 0;
+        size_t last = std::min(i + session_window, sections.size() - 1);
+        bool variable = !m_solved;
+        for(size_t j = first; j <= last && !variable; ++j)
+            variable = modified[j];
+        if(variable) m_problem.SetParameterBlockVariable(&m_lambdas[i-1]);
+        else         m_problem.SetParameterBlockConstant(&m_lambdas[i-1]);
+        any = any || variable;
+    }
+    if(!any) return false;
+
+    // Step-3: solve and write the scaled sections back
+    ceres::Solve(options, &m_problem, &summary);
+    m_solved = true;
+    for(size_t i = 1; i < sections.size(); ++i) {
+        m_written[i] = m_measured[i];
+        m_written.scale(i, m_lambdas[i-1]);
+        sections[i] = m_written[i];
+    }
+    return true;
+}
+
+void GeneralizedCylinderSolverSession::add_section(const Circle3D& circle) {
+
+    m_measured.push_back(circle);
+    m_written.push_back(circle);
+    if(m_measured.size() == 1) return;
+
+    // the cost functors read the store by index, the deque keeps the parameter blocks valid
+    double* previous_lambda = (m_measured.size() == 2) ? &m_unit_scale : &m_lambdas.back();
+    m_lambdas.push_back(1.0);
+    size_t i = m_measured.size() - 1;
+    ceres::CostFunction* cost_function = nullptr;
+    if(m_analytic_jacobians) cost_function = new CostFunction_2_Analytic(m_measured, i);
+    else                     cost_function = new ceres::AutoDiffCostFunction<CostFunctor_2, 1, 1, 1>(new CostFunctor_2(m_measured, i));
+    m_problem.AddResidualBlock(cost_function, NULL, previous_lambda, &m_lambdas.back());
+}
+
+void GeneralizedCylinderSolverSession::remove_last_section() {
+
+    // removing the scale removes its residual blocks
+    if(!m_lambdas.empty()) {
+        m_problem.RemoveParameterBlock(&m_lambdas.back());
+        m_lambdas.pop_back();
+    }
+    m_measured.pop_back();
+    m_written.pop_back();
+}
+
+bool GeneralizedCylinderSolverSession::is_same(const SectionStore& s1, const SectionStore& s2, size_t i) {
+
+    static const double eps = 1e-12;
+    SectionStore::const_reference c1 = s1[i], c2 = s2[i];
+    return std::abs(c1.radius - c2.radius) <= eps * std::abs(c2.radius) &&
+           (c1.center - c2.center).squaredNorm() <= eps * c2.center.squaredNorm() &&
+           (c1.normal - c2.normal).squaredNorm() <= eps;
+}
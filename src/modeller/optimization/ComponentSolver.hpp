@@ -1,10 +1,16 @@
 #ifndef COMPONENT_SOLVER_HPP
 #define COMPONENT_SOLVER_HPP
 
+#include "Constraints.hpp"
 #include "OptimizationUtility.hpp"
 #include "../../geometry/Circle3D.hpp"
+#include "../../geometry/SectionStore.hpp"
 #include <osg/Array>
 #include <ceres/ceres.h>
+#include <deque>
+#include <vector>
+#include <map>
+#include <memory>
 
 class GeneralizedCylinder;
 
@@ -49,34 +55,30 @@ struct CostFunctor_1 {
     double n;
 };
 
+// residual of a neighbour pair of sections: the scaled centers are aligned with the normal of the second
+// section, a residual block per pair keeps the jacobian banded. The sections index-1 and index are read
+// from the raw arrays of the store, n1 x C0 and n1 x C1 do not depend on the scales.
 struct CostFunctor_2 {
 
-    CostFunctor_2(const std::vector<Circle3D>& circular_sections) : sections(circular_sections) { }
+    CostFunctor_2(const SectionStore& sections, size_t index) : m_sections(sections), m_index(index) { }
 
     template <typename T>
-    Vector3D<T> get_normal(size_t index) const {
-        return Vector3D<T>(T(sections[index].normal[0]), T(sections[index].normal[1]), T(sections[index].normal[2]));
-    }
-
-    template <typename T>
-    Vector3D<T> get_center(size_t index) const {
-        return Vector3D<T>(T(sections[index].center[0]), T(sections[index].center[1]), T(sections[index].center[2]));
-    }
-
-    template <typename T>
-    bool operator()(T const* const* parameters, T* residuals) const {
-
-        // residual-0
-        residuals[0] = (get_normal<T>(1).cross(get_center<T>(0) - parameters[0][0]*get_center<T>(1))).norm();
-
-        // rest of the residuals:
-        for(int i = 2; i < sections.size(); ++i)
-            residuals[i-1] = (get_normal<T>(i).cross(parameters[0][i-2]*get_center<T>(i-1) - parameters[0][i-1]*get_center<T>(i))).norm();
-
+    bool operator()(const T* const previous_lambda, const T* const lambda, T* residual) const {
+
+        const double* C0 = m_sections.center(m_index - 1);
+        const double* C1 = m_sections.center(m_index);
+        const double* n1 = m_sections.normal(m_index);
+        T v[3];
+        for(int k = 0; k < 3; ++k) {
+            int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+            v[k] = previous_lambda[0] * T(n1[k1] * C0[k2] - n1[k2] * C0[k1]) - lambda[0] * T(n1[k1] * C1[k2] - n1[k2] * C1[k1]);
+        }
+        residual[0] = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
         return true;
     }
     private:
-    const std::vector<Circle3D>& sections;
+    const SectionStore& m_sections;
+    size_t m_index;
 };
 
 struct CostFunctor_Depth {
@@ -100,20 +102,137 @@ struct CostFunctor_Depth {
 };
 
 
+/*
+ * Closed form jacobians of the functors above, the residuals are identical. The autodiff functors
+ * are kept as the reference, see ComponentSolver::CheckAnalyticJacobians.
+ */
+class CostFunction_1_Analytic : public ceres::SizedCostFunction<4, 3, 2> {
+public:
+    CostFunction_1_Analytic(osg::Vec2dArray const * const proj, const Circle3D& circle, double near) :
+        m_proj(proj), m_circle(circle), n(near) { }
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override;
+private:
+    osg::Vec2dArray const * const m_proj;
+    const Circle3D& m_circle;
+    double n;
+};
+
+class CostFunction_2_Analytic : public ceres::SizedCostFunction<1, 1, 1> {
+public:
+    CostFunction_2_Analytic(const SectionStore& sections, size_t index) : m_sections(sections), m_index(index) { }
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override;
+private:
+    const SectionStore& m_sections;
+    size_t m_index;
+};
+
+class CostFunction_Depth_Analytic : public ceres::SizedCostFunction<1, 1> {
+public:
+    CostFunction_Depth_Analytic(const Circle3D& c0, const Circle3D& c1) : m_circle_0(c0), m_circle_1(c1) { }
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override;
+private:
+    const Circle3D& m_circle_0;
+    const Circle3D& m_circle_1;
+};
+
+/*
+ * Sampson distances of edge points to the projection of a circle, all the points in one residual block.
+ *
+ * The circle (center C, normal N, radius r) projects to the conic p^T Q p = 0 of the points
+ * p = (x, y, near) of the projection plane, Q = d^2 I - d (C N^T + N C^T) + (|C|^2 - r^2) N N^T with
+ * d = N.C. Q is homogeneous in N, the norm of N is held by one more residual, the radius is constant
+ * (it fixes the scale along the rays). The residual of a point is F / |grad F| with F = p^T Q p, the
+ * first order distance to the conic. The points are stored as structure of arrays and evaluated in
+ * fixed-size chunks with closed form jacobians, instead of one residual block (and one virtual call
+ * and jacobian block) per point. Parameters: the center and the normal.
+ *
+ * A loss function of the block would scale all the points by their total cost, thus an outlier
+ * would never be down-weighted alone. With an outlier scale c the residual of each point is
+ * robustified by the Cauchy loss rho(s) = c^2 log(1 + s / c^2) instead: r' = sign(r) sqrt(rho(r^2))
+ * and dr' = rho'(r^2) r / r' dr, the block is added without a loss. The residual of the norm of N is
+ * not robustified.
+ */
+class SampsonCircleCostFunction : public ceres::CostFunction {
+public:
+    static const int chunk_size = 8;
+
+    // an outlier scale of 0 for the squared distances
+    SampsonCircleCostFunction(const std::vector<osg::Vec2d>& points, double radius, double near, double outlier_scale = 0.0);
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override;
+protected:
+    // the conic Q of the circle and, if D is given, its 7 derivatives by the center, the normal and the radius
+    static void circle_conic(const Eigen::Vector3d& C, const Eigen::Vector3d& N, double radius, Eigen::Matrix3d& Q, Eigen::Matrix3d* D);
+    // the residuals of the points, the derivatives of the point i by D[j] are written to columns[j][strides[j] * i]
+    // unless the column is null, without D only the residuals
+    void evaluate_points(const Eigen::Matrix3d& Q, const Eigen::Matrix3d* D, int num_derivatives,
+                         double* residuals, double* const* columns, const int* strides) const;
+
+    std::vector<double> m_x, m_y;      // padded to a multiple of the chunk size
+    size_t m_num_points;
+    double m_radius;
+    double m_outlier_scale;
+    double n;
+};
+
+/*
+ * Persistent problem of the section scales of one generalized cylinder.
+ *
+ * The session keeps the measured sections, the scales and the residual blocks between the solves.
+ * The sections that are appended or edited since the previous solve are found by comparing the
+ * geometry with the sections written by the session, only the scales within a window around them
+ * are variable and the rest of the blocks are held constant at their previous solution. The first
+ * solve is a full solve.
+ */
+class GeneralizedCylinderSolverSession {
+public:
+    GeneralizedCylinderSolverSession(bool analytic_jacobians);
+    // returns false if there is nothing to solve
+    bool Solve(SectionStore& sections, const ceres::Solver::Options& options, ceres::Solver::Summary& summary);
+private:
+    ceres::Problem m_problem;
+    SectionStore m_measured;            // sections before the scaling, read by the cost functors by index
+    SectionStore m_written;             // scaled sections as written to the geometry
+    std::deque<double> m_lambdas;       // scale of the section i + 1
+    double m_unit_scale;                // constant scale of the first section
+    bool m_analytic_jacobians;
+    bool m_solved;
+
+    void add_section(const Circle3D& circle);
+    void remove_last_section();
+    static bool is_same(const SectionStore& s1, const SectionStore& s2, size_t i);
+};
+
 class ComponentSolver {
 public:
-    ComponentSolver(double near) : n(near) {
+    ComponentSolver(double near) : n(near), m_depth_scale(1.0), m_analytic_jacobians(true) {
         options.max_num_iterations = 100;
         options.linear_solver_type = ceres::DENSE_QR;
         options.minimizer_progress_to_stdout = false;
     }
     void SolveForSingleCircle(osg::Vec2dArray const * const proj, Circle3D& circle);
+    // the circle is moved so that it projects onto the edge points (projected coordinates), the
+    // radius is kept; the residuals beyond the outlier scale are down weighted
+    bool RefineCircleToEdges(const std::vector<osg::Vec2d>& points, double outlier_scale, Circle3D& circle) const;
     void SolveGeneralizedCylinder(GeneralizedCylinder* gcyl);
+    // the scales of the sections reduced to the parameters of the radius profile of the constraint
+    void SolveGeneralizedCylinder(GeneralizedCylinder* gcyl, section_constraints constraint);
+    template <section_constraints constraint>
+    static double SolveSectionProfile(SectionStore& sections);
     void SolveDepth(const Circle3D& C0, Circle3D& C1);
+    // thread safe version of SolveDepth for the multi-start search, returns the final cost
+    double SolveDepth(const Circle3D& C0, Circle3D& C1, double initial_scale, ceres::Solver::Summary* depth_summary = nullptr) const;
+    void ForgetComponent(unsigned int component_id);
+    void ForgetAllComponents();
+    void SetAnalyticJacobians(bool flag);
+    // compares the analytic jacobians with the autodiff ones at random points and times both
+    static bool CheckAnalyticJacobians(int num_samples = 1000, double tolerance = 1e-6);
 private:
     ceres::Solver::Options options;
     ceres::Solver::Summary summary;
     double n;
+    double m_depth_scale;   // previous solution of the depth scale, the initial value of the next one
+    bool m_analytic_jacobians;
+    std::map<unsigned int, std::unique_ptr<GeneralizedCylinderSolverSession>> m_sessions;
 };
 
 #endif // COMPONENT_SOLVER_HPP
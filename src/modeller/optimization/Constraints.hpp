@@ -13,6 +13,34 @@ enum class geosemantic_constraints : unsigned char {
     coplanar_axes
 };
 
+enum class section_constraints : unsigned char {
+    none,             // no constraint
+    constant,         // same size
+    linear_scaling    // linear scaling
+};
+
+/*
+ * Radius profile of the sections under a section constraint, the reduced parameters of the solver.
+ *
+ * The radius at the normalized chord length t of the axis is r0 * (1 + slope * t) with the radius
+ * r0 of the first section: the constant sections have no free parameter, the linearly scaled ones
+ * the slope. ComponentSolver::SolveGeneralizedCylinder is specialized on the constraint.
+ */
+template <section_constraints constraint>
+struct section_profile;
+
+template <>
+struct section_profile<section_constraints::constant> {
+    static const int num_parameters = 0;
+    static double slope_weight(double t) { return 0.0; }
+};
+
+template <>
+struct section_profile<section_constraints::linear_scaling> {
+    static const int num_parameters = 1;
+    static double slope_weight(double t) { return t; }
+};
+
 std::string to_string(geosemantic_constraints c);
 int to_int(geosemantic_constraints c);
 
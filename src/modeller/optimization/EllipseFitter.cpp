@@ -0,0 +1,253 @@
+#include "EllipseFitter.hpp"
+#include "../../geometry/Ellipse2D.hpp"
+#include "../../utility/Utility.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static const size_t sample_size = 5;
+static const double success_probability = 0.99;
+
+EllipseFitter::EllipseFitter(double inlier_threshold, int max_iterations, double min_inlier_ratio) :
+    m_inlier_threshold(inlier_threshold),
+    m_max_iterations(max_iterations),
+    m_min_inlier_ratio(min_inlier_ratio),
+    m_num_inliers(0),
+    m_num_iterations(0) { }
+
+size_t EllipseFitter::GetNumberOfInliers() const {
+    return m_num_inliers;
+}
+
+int EllipseFitter::GetNumberOfIterations() const {
+    return m_num_iterations;
+}
+
+bool EllipseFitter::Fit(const std::vector<osg::Vec2d>& points, double* coeff) {
+
+    m_num_inliers = 0;
+    m_num_iterations = 0;
+    size_t n = points.size();
+    if(n < sample_size) {
+        std::cout << "ERROR: At least " << sample_size << " points are required to fit an ellipse" << std::endl;
+        return false;
+    }
+
+    // Step-1: normalize the points
+    double mx, my, scale;
+    normalize(points, mx, my, scale);
+    double threshold = m_inlier_threshold / scale;
+
+    // Step-2: RANSAC over the minimal samples, the samples of every fit restart from the global seed
+    // so that the same points give the same ellipse on any thread and in any order
+    m_rng.seed(RandomNumberGenerator::GetGlobalSeed());
+    m_rng.initialize_uniform_int_distributor(0, static_cast<int>(n) - 1);
+    size_t indices[sample_size];
+    double hypothesis[6], best[6];
+    size_t best_count = 0;
+    int num_iterations = m_max_iterations;
+    for(m_num_iterations = 0; m_num_iterations < num_iterations; ++m_num_iterations) {
+        sample(indices);
+        if(!fit_direct(indices, sample_size, hypothesis)) continue;
+        size_t count = evaluate(hypothesis, threshold, m_inliers);
+        if(count > best_count) {
+            best_count = count;
+            std::copy(hypothesis, hypothesis + 6, best);
+            m_best_inliers.swap(m_inliers);
+
+            // adapt the number of iterations to the inlier ratio
+            double w = static_cast<double>(count) / n;
+            double p = 1.0 - std::pow(w, static_cast<double>(sample_size));
+            if(p <= 0.0) break;
+            double required = std::log(1.0 - success_probability) / std::log(p);
+            num_iterations = static_cast<int>(std::min(static_cast<double>(m_max_iterations), std::ceil(required)));
+        }
+    }
+
+    if(best_count < std::max(sample_size, static_cast<size_t>(m_min_inlier_ratio * n))) {
+        std::cout << "ERROR: Ellipse fitting failed, " << best_count << " of " << n << " points are inliers" << std::endl;
+        return false;
+    }
+
+    // Step-3: refit to the inliers of the best hypothesis, repeated while the consensus grows
+    std::vector<size_t> inlier_indices;
+    for(int refit = 0; refit < 3; ++refit) {
+        inlier_indices.clear();
+        for(size_t i = 0; i < n; ++i)
+            if(m_best_inliers[i]) inlier_indices.push_back(i);
+        if(!fit_direct(inlier_indices.data(), inlier_indices.size(), hypothesis)) break;
+        size_t count = evaluate(hypothesis, threshold, m_inliers);
+        if(count < best_count) break;
+        best_count = count;
+        std::copy(hypothesis, hypothesis + 6, best);
+        m_best_inliers.swap(m_inliers);
+    }
+    m_num_inliers = best_count;
+
+    // Step-4: transform the conic back to the input coordinates, x' = (x - mx) / scale
+    const double& a = best[0]; const double& b = best[1]; const double& c = best[2];
+    const double& d = best[3]; const double& e = best[4]; const double& f = best[5];
+    coeff[0] = a;
+    coeff[1] = b;
+    coeff[2] = c;
+    coeff[3] = d * scale - 2.0 * a * mx - b * my;
+    coeff[4] = e * scale - 2.0 * c * my - b * mx;
+    coeff[5] = a * mx * mx + b * mx * my + c * my * my - scale * (d * mx + e * my) + f * scale * scale;
+    return true;
+}
+
+bool EllipseFitter::ConicToEllipse(const double* coeff, Ellipse2D& ellipse) {
+
+    // the quadratic part is made positive definite
+    double sign = (coeff[0] + coeff[2] < 0.0) ? -1.0 : 1.0;
+    double a = sign * coeff[0], b = sign * coeff[1], c = sign * coeff[2];
+    double d = sign * coeff[3], e = sign * coeff[4], f = sign * coeff[5];
+
+    double det = 4.0 * a * c - b * b;
+    if(det <= 0.0) return false;
+
+    // Step-1: center, the gradient of the conic vanishes
+    double x0 = (b * e - 2.0 * c * d) / det;
+    double y0 = (b * d - 2.0 * a * e) / det;
+    double f0 = 0.5 * (d * x0 + e * y0) + f;        // value of the conic at the center
+    if(f0 >= 0.0) return false;
+
+    // Step-2: eigenvalues of [a b/2; b/2 c], the smaller one belongs to the major axis
+    double h = 0.5 * (a + c);
+    double r = std::sqrt(0.25 * (a - c) * (a - c) + 0.25 * b * b);
+    double l_mj = h - r;
+    double l_mn = h + r;
+    if(l_mj <= 0.0) return false;
+
+    ellipse.center = osg::Vec2d(x0, y0);
+    ellipse.smj_axis = std::sqrt(-f0 / l_mj);
+    ellipse.smn_axis = std::sqrt(-f0 / l_mn);
+
+    // rot angle [-PI, PI), the direction of the larger eigenvalue is 0.5 * atan2(b, a - c)
+    double theta = 0.5 * std::atan2(b, a - c) + HALF_PI;
+    if(theta >= PI) theta -= 2.0 * PI;
+    ellipse.rot_angle = theta;
+    ellipse.calculate_coefficients_from_parameters();
+    return true;
+}
+
+void EllipseFitter::normalize(const std::vector<osg::Vec2d>& points, double& mx, double& my, double& scale) {
+
+    size_t n = points.size();
+    mx = 0.0; my = 0.0;
+    for(const osg::Vec2d& p : points) {
+        mx += p.x();
+        my += p.y();
+    }
+    mx /= n; my /= n;
+
+    scale = 0.0;
+    for(const osg::Vec2d& p : points)
+        scale += std::sqrt((p.x() - mx) * (p.x() - mx) + (p.y() - my) * (p.y() - my));
+    scale /= n;
+    if(scale <= 0.0) scale = 1.0;
+
+    m_x.resize(n); m_y.resize(n);
+    m_xx.resize(n); m_xy.resize(n); m_yy.resize(n);
+    m_inliers.resize(n); m_best_inliers.resize(n);
+    for(size_t i = 0; i < n; ++i) {
+        double x = (points[i].x() - mx) / scale;
+        double y = (points[i].y() - my) / scale;
+        m_x[i] = x;
+        m_y[i] = y;
+        m_xx[i] = x * x;
+        m_xy[i] = x * y;
+        m_yy[i] = y * y;
+    }
+}
+
+bool EllipseFitter::fit_direct(const size_t* indices, size_t num, double* coeff) const {
+
+    // Step-1: scatter matrix blocks, D1 = [x^2 xy y^2], D2 = [x y 1]
+    Eigen::Matrix3d S1 = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d S2 = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d S3 = Eigen::Matrix3d::Zero();
+    for(size_t k = 0; k < num; ++k) {
+        size_t i = indices[k];
+        Eigen::Vector3d d1(m_xx[i], m_xy[i], m_yy[i]);
+        Eigen::Vector3d d2(m_x[i], m_y[i], 1.0);
+        S1 += d1 * d1.transpose();
+        S2 += d1 * d2.transpose();
+        S3 += d2 * d2.transpose();
+    }
+
+    // Step-2: the linear part is eliminated, a2 = T * a1
+    Eigen::Matrix3d S3_inv;
+    bool invertible = false;
+    S3.computeInverseWithCheck(S3_inv, invertible, 1e-12);
+    if(!invertible) return false;
+    Eigen::Matrix3d T = -S3_inv * S2.transpose();
+    Eigen::Matrix3d M = S1 + S2 * T;
+
+    // Step-3: premultiply by the inverse of the constraint matrix C1 = [0 0 2; 0 -1 0; 2 0 0]
+    Eigen::Matrix3d R;
+    R.row(0) = 0.5 * M.row(2);
+    R.row(1) = -M.row(1);
+    R.row(2) = 0.5 * M.row(0);
+
+    // Step-4: the eigenvector satisfying the ellipse constraint 4ac - b^2 > 0
+    Eigen::EigenSolver<Eigen::Matrix3d> solver(R);
+    if(solver.info() != Eigen::Success) return false;
+    int selected = -1;
+    double best_constraint = 0.0;
+    for(int i = 0; i < 3; ++i) {
+        Eigen::Vector3d v = solver.eigenvectors().col(i).real();
+        double constraint = 4.0 * v(0) * v(2) - v(1) * v(1);
+        if(constraint > best_constraint) {
+            best_constraint = constraint;
+            selected = i;
+        }
+    }
+    if(selected < 0) return false;
+
+    Eigen::Vector3d a1 = solver.eigenvectors().col(selected).real();
+    Eigen::Vector3d a2 = T * a1;
+    for(int i = 0; i < 3; ++i) {
+        coeff[i] = a1(i);
+        coeff[i + 3] = a2(i);
+    }
+    return true;
+}
+
+size_t EllipseFitter::evaluate(const double* coeff, double threshold, std::vector<unsigned char>& inliers) const {
+
+    // a point is an inlier if its Sampson distance F^2 / |grad F|^2 is below the threshold,
+    // the loop has no branches and no divisions and is vectorized by the compiler
+    const double a = coeff[0], b = coeff[1], c = coeff[2], d = coeff[3], e = coeff[4], f = coeff[5];
+    const double t2 = threshold * threshold;
+    const double* x = m_x.data();
+    const double* y = m_y.data();
+    const double* xx = m_xx.data();
+    const double* xy = m_xy.data();
+    const double* yy = m_yy.data();
+    unsigned char* in = inliers.data();
+    size_t n = m_x.size();
+    size_t count = 0;
+    for(size_t i = 0; i < n; ++i) {
+        double F = a * xx[i] + b * xy[i] + c * yy[i] + d * x[i] + e * y[i] + f;
+        double gx = 2.0 * a * x[i] + b * y[i] + d;
+        double gy = b * x[i] + 2.0 * c * y[i] + e;
+        unsigned char inlier = (F * F <= t2 * (gx * gx + gy * gy)) ? 1 : 0;
+        in[i] = inlier;
+        count += inlier;
+    }
+    return count;
+}
+
+void EllipseFitter::sample(size_t* indices) {
+
+    // distinct indices, the number of points is not smaller than the sample size
+    for(size_t k = 0; k < sample_size; ++k) {
+        bool unique = false;
+        while(!unique) {
+            indices[k] = static_cast<size_t>(m_rng.generate_int());
+            unique = std::find(indices, indices + k, indices[k]) == indices + k;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef ELLIPSE_FITTER_HPP
+#define ELLIPSE_FITTER_HPP
+
+#include "../../utility/RandomNumberGenerator.hpp"
+#include <osg/Vec2d>
+#include <vector>
+
+class Ellipse2D;
+
+/*
+ * Robust ellipse fitting to edge points.
+ *
+ * The conic fit is the direct least squares fit of Fitzgibbon et al. in the numerically stable
+ * form of Halir and Flusser: the scatter matrix is split into its quadratic and linear parts and
+ * the ellipse constraint 4ac - b^2 = 1 leaves a 3x3 eigenproblem. The fit is always an ellipse.
+ *
+ * The fit runs inside a RANSAC loop over minimal samples of 5 points, the number of iterations
+ * is adapted to the best inlier ratio. The residual of a point is the Sampson distance
+ * |F(x,y)| / |grad F(x,y)| to the conic, it is evaluated for all of the points of a hypothesis
+ * in one batch over structure of arrays buffers with the monomials x^2, xy, y^2 precomputed.
+ * The best hypothesis is refitted to all of its inliers.
+ *
+ * The points are centered and scaled to unit mean distance before the fit, the coefficients
+ * are returned in the input coordinates.
+ */
+class EllipseFitter {
+public:
+    EllipseFitter(double inlier_threshold = 1.5, int max_iterations = 500, double min_inlier_ratio = 0.5);
+
+    // coeff: ax^2 + bxy + cy^2 + dx + ey + f = 0 in the order of Ellipse2D::coeff
+    bool Fit(const std::vector<osg::Vec2d>& points, double* coeff);
+    // the center, semi-axes and rotation of the fitted conic, the end points are not updated
+    static bool ConicToEllipse(const double* coeff, Ellipse2D& ellipse);
+
+    size_t GetNumberOfInliers() const;
+    int GetNumberOfIterations() const;
+
+private:
+    double m_inlier_threshold;                  // in the units of the points
+    int m_max_iterations;
+    double m_min_inlier_ratio;
+    size_t m_num_inliers;
+    int m_num_iterations;
+    RandomNumberGenerator m_rng;
+
+    // normalized points and their monomials
+    std::vector<double> m_x, m_y, m_xx, m_xy, m_yy;
+    std::vector<unsigned char> m_inliers, m_best_inliers;
+
+    void normalize(const std::vector<osg::Vec2d>& points, double& mx, double& my, double& scale);
+    bool fit_direct(const size_t* indices, size_t num, double* coeff) const;
+    size_t evaluate(const double* coeff, double threshold, std::vector<unsigned char>& inliers) const;
+    void sample(size_t* indices);
+};
+
+#endif // ELLIPSE_FITTER_HPP
@@ -1,22 +1,137 @@
 #include "ModelSolver.hpp"
 #include "../components/ComponentBase.hpp"
+#include "../../utility/Profiler.hpp"
 #include <iostream>
 #include <algorithm>
+#include <map>
+
+// weights of the residuals, the priors are weak compared to the constraints
+static const double rotation_prior_weight = 0.1;
+static const double translation_prior_weight = 0.1;
+static const double scale_prior_weight = 0.01;
+static const double constraint_weight = 1.0;
+
+ModelSolver::ModelSolver() {
+
+    m_options.max_num_iterations = 100;
+    m_options.minimizer_progress_to_stdout = false;
+    // the constraints only couple pairs of components, the schur complement over the
+    // components is sparse, the elimination ordering is computed by ceres
+    if(ceres::IsSparseLinearAlgebraLibraryTypeAvailable(m_options.sparse_linear_algebra_library_type))
+        m_options.linear_solver_type = ceres::SPARSE_SCHUR;
+    else
+        m_options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+}
 
 void ModelSolver::AddComponent(ComponentBase* component) {
-    m_components.push_back(component);
+    m_components[component->GetComponentId()] = component;
 }
 
 // Precondition: Geosemantic constraints must have been defined before calling this function.
 void ModelSolver::Solve() {
-    // step-1: construct the objective function
 
+    std::shared_ptr<Snapshot> snapshot = TakeSnapshot();
+    if(snapshot && SolveSnapshot(*snapshot))
+        ApplySolution(*snapshot);
+}
+
+std::shared_ptr<ModelSolver::Snapshot> ModelSolver::TakeSnapshot() const {
+
+    if(m_constraints.empty()) {
+        std::cout << "INFO: There are no geosemantic constraints to solve" << std::endl;
+        return std::shared_ptr<Snapshot>();
+    }
+
+    // parameter blocks for the components with an axis, initialized to the identity
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    snapshot->params.reserve(m_components.size());
+    for(auto& item : m_components) {
+        ComponentBase* comp = item.second;
+        std::vector<osg::Vec3d> pts;
+        if(!comp->GetAxisPoints(pts)) continue;
+        component_parameters cp;
+        cp.component_id = item.first;
+        cp.axis.first = pts.front();
+        cp.axis.last = pts.back();
+        cp.axis.middle = pts[pts.size() / 2];
+        cp.axis.length = 0.0;
+        for(size_t i = 1; i < pts.size(); ++i)
+            cp.axis.length += (pts[i] - pts[i-1]).length();
+        if(cp.axis.length <= 0.0) continue;
+        std::fill(cp.rotation, cp.rotation + 3, 0.0);
+        std::fill(cp.translation, cp.translation + 3, 0.0);
+        cp.scale = 1.0;
+        cp.constrained = false;
+        snapshot->params.push_back(cp);
+    }
+    GetAllConstraints(snapshot->constraints);
+    snapshot->options = m_options;
+    snapshot->solved = false;
+    return snapshot;
+}
+
+bool ModelSolver::SolveSnapshot(Snapshot& snapshot, const CancellationToken& token) {
+
+    Profiler::Scope scope("ModelSolver::Solve");
+    // Step-1: the objective function, a prior for each component and the relations between them
+    ceres::Problem problem;
+    int num_residual_blocks = construct_geosemantic_constraints(problem, snapshot.constraints, snapshot.params);
+    if(num_residual_blocks == 0) {
+        std::cout << "INFO: None of the geosemantic constraints could be constructed" << std::endl;
+        return false;
+    }
+    for(component_parameters& cp : snapshot.params) {
+        if(!problem.HasParameterBlock(cp.rotation)) continue;
+        ceres::CostFunction* prior = new ceres::AutoDiffCostFunction<CostFunctor_Prior, 7, 3, 3, 1>(
+                    new CostFunctor_Prior(rotation_prior_weight, translation_prior_weight, scale_prior_weight, cp.axis.length));
+        problem.AddResidualBlock(prior, NULL, cp.rotation, cp.translation, &cp.scale);
+        problem.SetParameterLowerBound(&cp.scale, 0, 0.1);
+    }
+
+    // Step-2: solve, the parameters of the snapshot hold the solution
+    cancellation_callback callback(token);
+    ceres::Solver::Options options = snapshot.options;
+    options.callbacks.push_back(&callback);
+    ceres::Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+    std::cout << summary.BriefReport() << std::endl;
+    if(token.IsCancelled()) {
+        std::cout << "INFO: Model solver is cancelled" << std::endl;
+        return false;
+    }
+    if(!summary.IsSolutionUsable()) {
+        std::cout << "ERROR: Model solver failed: " << summary.message << std::endl;
+        return false;
+    }
+    for(component_parameters& cp : snapshot.params)
+        cp.constrained = problem.HasParameterBlock(cp.rotation);
+    snapshot.solved = true;
+    return true;
+}
+
+void ModelSolver::ApplySolution(const Snapshot& snapshot, std::vector<std::pair<unsigned int, osg::Matrixd>>* transforms) {
+
+    if(!snapshot.solved) return;
+    for(const component_parameters& cp : snapshot.params) {
+        // deleted while the snapshot was being solved
+        auto it = m_components.find(cp.component_id);
+        if(!cp.constrained || it == m_components.end()) continue;
+        osg::Vec3d axis(cp.rotation[0], cp.rotation[1], cp.rotation[2]);
+        double angle = axis.normalize();
+        osg::Matrixd rotation = (angle > 0.0) ? osg::Matrixd::rotate(angle, axis) : osg::Matrixd::identity();
+        osg::Vec3d translation(cp.translation[0], cp.translation[1], cp.translation[2]);
+        osg::Matrixd mat = osg::Matrixd::translate(-cp.axis.middle) * rotation *
+                           osg::Matrixd::translate(cp.axis.middle + translation) * osg::Matrixd::scale(cp.scale, cp.scale, cp.scale);
+        it->second->ApplyTransform(mat);
+        if(transforms) transforms->push_back(std::make_pair(cp.component_id, mat));
+    }
 }
 
 void ModelSolver::DeleteAllComponents() {
 
     m_components.clear();
     m_constraints.clear();
+    m_incidence.clear();
 }
 
 void ModelSolver::DeleteSelectedComponents(std::vector<int>& id_vector) {
@@ -24,119 +139,150 @@ void ModelSolver::DeleteSelectedComponents(std::vector<int>& id_vector) {
     if(m_components.empty())
         return;
 
-    bool found = false;
     for(int i : id_vector) {
-        found = false;
-        for(auto it = m_components.begin(); it != m_components.end(); ++it) {
-            if((*it)->GetComponentId() == static_cast<unsigned int>(i)) {
-                m_components.erase(it);
-                delete_constraints_with_id(static_cast<unsigned int>(i));
-                found = true;
-                break;
-            }
+        auto it = m_components.find(static_cast<unsigned int>(i));
+        if(it != m_components.end()) {
+            m_components.erase(it);
+            delete_constraints_with_id(static_cast<unsigned int>(i));
         }
-        if(!found)
+        else {
             std::cout << "ERROR: Component with id: " << i << " could not be found" << std::endl;
+        }
     }
 }
 
 void ModelSolver::Print() const {
 
     std::cout << "Num components: " << m_components.size() << std::endl;
-    for(auto comp : m_components)
-        comp->Print();
+    for(auto& item : m_components)
+        item.second->Print();
 
     std::cout << "Num constraints: " << num_constraints() << std::endl;
-    for(auto c : m_constraints)
-        std::cout << c << std::endl;
+    for(auto& item : m_constraints)
+        std::cout << item.second << std::endl;
 }
 
 void ModelSolver::UpdateOrCreateConstraints(const unsigned int cp1, const unsigned int cp2, const std::vector<geosemantic_constraints>& gsc) {
 
+    unsigned long long key = pair_key(cp1, cp2);
     if(gsc.empty()) {
-        for(auto it = m_constraints.begin(); it != m_constraints.end(); ++it) {
-            if((it->component_1 == cp1 && it->component_2 == cp2) || (it->component_1 == cp2 && it->component_2 == cp1)) {
-                m_constraints.erase(it);
-                break;
-            }
+        if(m_constraints.erase(key) != 0) {
+            m_incidence[cp1].erase(cp2);
+            m_incidence[cp2].erase(cp1);
         }
         return;
     }
+
+    auto it = m_constraints.find(key);
+    if(it != m_constraints.end()) {
+        it->second.constraints = gsc;
+    }
     else {
-        bool updated = false;
-        for(auto it = m_constraints.begin(); it != m_constraints.end(); ++it) {
-            if((it->component_1 == cp1 && it->component_2 == cp2) || (it->component_1 == cp2 && it->component_2 == cp1)) {
-                it->constraints.clear();
-                std::copy(gsc.begin(), gsc.end(), std::back_inserter(it->constraints));
-                updated = true;
-                break;
-            }
-        }
-        if(!updated)
-            m_constraints.push_back(geosemcon(cp1, cp2, gsc));
+        m_constraints.emplace(key, geosemcon(cp1, cp2, gsc));
+        m_incidence[cp1].insert(cp2);
+        m_incidence[cp2].insert(cp1);
     }
 }
 
 void ModelSolver::GetConstraints(const unsigned int cp1, const unsigned int cp2, std::vector<geosemantic_constraints>& gsc) const {
 
-    for(auto c : m_constraints) {
-        if((c.component_1 == cp1 && c.component_2 == cp2) || (c.component_1 == cp2 && c.component_2 == cp1)) {
-            std::copy(c.constraints.begin(), c.constraints.end(), std::back_inserter(gsc));
-            break;
-        }
-    }
+    auto it = m_constraints.find(pair_key(cp1, cp2));
+    if(it != m_constraints.end())
+        std::copy(it->second.constraints.begin(), it->second.constraints.end(), std::back_inserter(gsc));
+}
+
+void ModelSolver::GetAllConstraints(std::vector<geosemcon>& constraints) const {
+
+    constraints.reserve(constraints.size() + m_constraints.size());
+    for(auto& item : m_constraints)
+        constraints.push_back(item.second);
+}
+
+void ModelSolver::GetComponents(std::vector<ComponentBase*>& components) const {
+
+    components.reserve(components.size() + m_components.size());
+    for(auto& item : m_components)
+        components.push_back(item.second);
+}
+
+ComponentBase* ModelSolver::GetComponent(unsigned int id) const {
+
+    auto it = m_components.find(id);
+    return (it != m_components.end()) ? it->second : nullptr;
 }
 
 int ModelSolver::num_constraints() const {
 
     int count = 0;
-    for(auto c : m_constraints)
-        count += c.constraints.size();
+    for(auto& item : m_constraints)
+        count += item.second.constraints.size();
     return count;
 }
 
+unsigned long long ModelSolver::pair_key(unsigned int cp1, unsigned int cp2) {
+
+    if(cp1 > cp2) std::swap(cp1, cp2);
+    return (static_cast<unsigned long long>(cp1) << 32) | cp2;
+}
+
 void ModelSolver::delete_constraints_with_id(unsigned int comp_id) {
 
-    if(m_constraints.empty()) { return; }
-    bool found = false;
-    for(auto it = m_constraints.begin(); it != m_constraints.end(); ++it) {
-        if(it->component_1 == comp_id || it->component_2 == comp_id) {
-            m_constraints.erase(it);
-            found = true;
-            break;
-        }
+    auto it = m_incidence.find(comp_id);
+    if(it == m_incidence.end()) return;
+    for(unsigned int other : it->second) {
+        m_constraints.erase(pair_key(comp_id, other));
+        m_incidence[other].erase(comp_id);
     }
-    if(found)
-        delete_constraints_with_id(comp_id);
+    m_incidence.erase(it);
 }
 
-void ModelSolver::construct_geosemantic_constraints() {
+int ModelSolver::construct_geosemantic_constraints(ceres::Problem& problem, const std::vector<geosemcon>& constraints, std::vector<component_parameters>& params) {
+
+    std::map<unsigned int, component_parameters*> index;
+    for(component_parameters& cp : params)
+        index[cp.component_id] = &cp;
 
-    for(auto it1 = m_constraints.begin(); it1 != m_constraints.end(); ++it1) {
-        for(auto it2 = it1->constraints.begin(); it2 != it1->constraints.end(); ++it2) {
+    int count = 0;
+    for(const geosemcon& con : constraints) {
+        auto c1 = index.find(con.component_1);
+        auto c2 = index.find(con.component_2);
+        if(c1 == index.end() || c2 == index.end()) {
+            std::cout << "ERROR: Components " << con.component_1 << " and " << con.component_2 << " do not have an axis" << std::endl;
+            continue;
+        }
+        if(c1->second == c2->second) continue;
+        component_parameters& p1 = *c1->second;
+        component_parameters& p2 = *c2->second;
+        const component_axis& a1 = p1.axis;
+        const component_axis& a2 = p2.axis;
+        for(auto it2 = con.constraints.begin(); it2 != con.constraints.end(); ++it2) {
+            ceres::CostFunction* cost_function = nullptr;
             switch(*it2) {
             case geosemantic_constraints::parallel:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_Parallel, 3, 3, 3, 1, 3, 3, 1>(new CostFunctor_Parallel(a1, a2, constraint_weight));
                 break;
             case geosemantic_constraints::orthogonal:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_Orthogonal, 1, 3, 3, 1, 3, 3, 1>(new CostFunctor_Orthogonal(a1, a2, constraint_weight));
                 break;
             case geosemantic_constraints::collinear_axis_endpoints:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_CollinearEndpoints, 6, 3, 3, 1, 3, 3, 1>(new CostFunctor_CollinearEndpoints(a1, a2, constraint_weight));
                 break;
             case geosemantic_constraints::overlapping_axis_endpoints:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_OverlappingEndpoints, 3, 3, 3, 1, 3, 3, 1>(new CostFunctor_OverlappingEndpoints(a1, a2, constraint_weight));
                 break;
             case geosemantic_constraints::coplanar_axis_endpoints:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_CoplanarEndpoints, 1, 3, 3, 1, 3, 3, 1>(new CostFunctor_CoplanarEndpoints(a1, a2, constraint_weight));
                 break;
             case geosemantic_constraints::coplanar_axes:
-                std::cout << "Not Implemented!" << std::endl;
+                cost_function = new ceres::AutoDiffCostFunction<CostFunctor_CoplanarAxes, 2, 3, 3, 1, 3, 3, 1>(new CostFunctor_CoplanarAxes(a1, a2, constraint_weight));
                 break;
             default:
                 break;
             }
+            if(cost_function == nullptr) continue;
+            problem.AddResidualBlock(cost_function, NULL, p1.rotation, p1.translation, &p1.scale, p2.rotation, p2.translation, &p2.scale);
+            ++count;
         }
     }
+    return count;
 }
-
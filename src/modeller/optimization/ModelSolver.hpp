@@ -2,32 +2,268 @@
 #define MODEL_SOLVER_HPP
 
 #include "Constraints.hpp"
+#include "OptimizationUtility.hpp"
+#include "../../utility/ThreadPool.hpp"
+#include <osg/Matrixd>
+#include <osg/Vec3d>
+#include <ceres/ceres.h>
+#include <ceres/rotation.h>
 #include <memory>
 #include <vector>
-#include <list>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 class ComponentBase;
 class ProjectionParameters;
 
+/*
+ * Each component is moved by a similarity transformation x' = s * (R * (x - p) + p + t) where p is the
+ * middle point of its axis, R is an angle-axis rotation, t a translation and s a scale about the camera
+ * center. The scale keeps the image of the component, the rotation and translation priors keep the
+ * component close to its estimate from the image. The rotation, translation and scale of every
+ * component are separate parameter blocks and the geosemantic constraints are residual blocks between
+ * the blocks of two components.
+ */
+struct component_axis {
+
+    osg::Vec3d first, middle, last;     // the ends and the middle point of the axis
+    double length;                      // normalizes the residuals of the component
+
+    template <typename T>
+    Vector3D<T> transform(const T* const rotation, const T* const translation, const T* const scale, const osg::Vec3d& pt) const {
+
+        T x[3] = { T(pt.x() - middle.x()), T(pt.y() - middle.y()), T(pt.z() - middle.z()) };
+        T rx[3];
+        ceres::AngleAxisRotatePoint(rotation, x, rx);
+        return Vector3D<T>(scale[0] * (rx[0] + T(middle.x()) + translation[0]),
+                           scale[0] * (rx[1] + T(middle.y()) + translation[1]),
+                           scale[0] * (rx[2] + T(middle.z()) + translation[2]));
+    }
+
+    template <typename T>
+    Vector3D<T> direction(const T* const rotation) const {
+
+        osg::Vec3d dir = last - first;
+        dir.normalize();
+        T d[3] = { T(dir.x()), T(dir.y()), T(dir.z()) };
+        T rd[3];
+        ceres::AngleAxisRotatePoint(rotation, d, rd);
+        return Vector3D<T>(rd[0], rd[1], rd[2]);
+    }
+};
+
+// keeps a component close to its initial estimate, the weak scale prior fixes the global scale
+struct CostFunctor_Prior {
+
+    CostFunctor_Prior(double rotation_weight, double translation_weight, double scale_weight, double length) :
+        wr(rotation_weight), wt(translation_weight / length), ws(scale_weight) { }
+
+    template <typename T>
+    bool operator()(const T* const rotation, const T* const translation, const T* const scale, T* residuals) const {
+
+        for(int i = 0; i < 3; ++i) {
+            residuals[i] = T(wr) * rotation[i];
+            residuals[i+3] = T(wt) * translation[i];
+        }
+        residuals[6] = T(ws) * (scale[0] - T(1));
+        return true;
+    }
+    private:
+    double wr, wt, ws;
+};
+
+// the residuals of the relations between two components, the parameters are the rotation,
+// translation and scale blocks of the first and of the second component
+struct CostFunctor_Relation {
+
+    CostFunctor_Relation(const component_axis& a1, const component_axis& a2, double weight) :
+        m_a1(a1), m_a2(a2), w(weight / (0.5 * (a1.length + a2.length))) {
+
+        // the closest ends of the two axes
+        double min_dist = -1.0;
+        for(int i = 0; i < 2; ++i) {
+            for(int j = 0; j < 2; ++j) {
+                double dist = ((i == 0 ? a1.first : a1.last) - (j == 0 ? a2.first : a2.last)).length2();
+                if(min_dist < 0.0 || dist < min_dist) {
+                    min_dist = dist;
+                    m_end_1 = (i == 0 ? a1.first : a1.last);
+                    m_end_2 = (j == 0 ? a2.first : a2.last);
+                }
+            }
+        }
+    }
+
+    protected:
+    component_axis m_a1;
+    component_axis m_a2;
+    osg::Vec3d m_end_1;
+    osg::Vec3d m_end_2;
+    double w;
+};
+
+struct CostFunctor_Parallel : public CostFunctor_Relation {
+
+    CostFunctor_Parallel(const component_axis& a1, const component_axis& a2, double weight) :
+        CostFunctor_Relation(a1, a2, weight * 0.5 * (a1.length + a2.length)) { }
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        Vector3D<T> c = m_a1.direction(r1).cross(m_a2.direction(r2));
+        residuals[0] = T(w) * c.x;
+        residuals[1] = T(w) * c.y;
+        residuals[2] = T(w) * c.z;
+        return true;
+    }
+};
+
+struct CostFunctor_Orthogonal : public CostFunctor_Relation {
+
+    CostFunctor_Orthogonal(const component_axis& a1, const component_axis& a2, double weight) :
+        CostFunctor_Relation(a1, a2, weight * 0.5 * (a1.length + a2.length)) { }
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        residuals[0] = T(w) * m_a1.direction(r1).dot(m_a2.direction(r2));
+        return true;
+    }
+};
+
+// both ends of the second axis lie on the line of the first axis
+struct CostFunctor_CollinearEndpoints : public CostFunctor_Relation {
+
+    using CostFunctor_Relation::CostFunctor_Relation;
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        Vector3D<T> p1 = m_a1.transform(r1, t1, s1, m_a1.first);
+        Vector3D<T> d1 = m_a1.direction(r1);
+        Vector3D<T> c0 = (m_a2.transform(r2, t2, s2, m_a2.first) - p1).cross(d1);
+        Vector3D<T> c1 = (m_a2.transform(r2, t2, s2, m_a2.last) - p1).cross(d1);
+        residuals[0] = T(w) * c0.x;
+        residuals[1] = T(w) * c0.y;
+        residuals[2] = T(w) * c0.z;
+        residuals[3] = T(w) * c1.x;
+        residuals[4] = T(w) * c1.y;
+        residuals[5] = T(w) * c1.z;
+        return true;
+    }
+};
+
+// the closest ends of the axes coincide
+struct CostFunctor_OverlappingEndpoints : public CostFunctor_Relation {
+
+    using CostFunctor_Relation::CostFunctor_Relation;
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        Vector3D<T> diff = m_a1.transform(r1, t1, s1, m_end_1) - m_a2.transform(r2, t2, s2, m_end_2);
+        residuals[0] = T(w) * diff.x;
+        residuals[1] = T(w) * diff.y;
+        residuals[2] = T(w) * diff.z;
+        return true;
+    }
+};
+
+// the four ends of the axes lie in a plane
+struct CostFunctor_CoplanarEndpoints : public CostFunctor_Relation {
+
+    using CostFunctor_Relation::CostFunctor_Relation;
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        Vector3D<T> p0 = m_a1.transform(r1, t1, s1, m_a1.first);
+        Vector3D<T> e1 = m_a1.transform(r1, t1, s1, m_a1.last) - p0;
+        Vector3D<T> e2 = m_a2.transform(r2, t2, s2, m_a2.first) - p0;
+        Vector3D<T> e3 = m_a2.transform(r2, t2, s2, m_a2.last) - p0;
+        // the volume of the tetrahedron over the area of its base
+        Vector3D<T> nrm = e1.cross(e2);
+        residuals[0] = T(w) * nrm.dot(e3) / (nrm.norm() + T(1e-9));
+        return true;
+    }
+};
+
+// the axis of the second component lies in the plane of the first axis and the middle of the second axis
+struct CostFunctor_CoplanarAxes : public CostFunctor_Relation {
+
+    using CostFunctor_Relation::CostFunctor_Relation;
+
+    template <typename T>
+    bool operator()(const T* const r1, const T* const t1, const T* const s1,
+                    const T* const r2, const T* const t2, const T* const s2, T* residuals) const {
+
+        Vector3D<T> p0 = m_a1.transform(r1, t1, s1, m_a1.middle);
+        Vector3D<T> nrm = m_a1.direction(r1).cross(m_a2.transform(r2, t2, s2, m_a2.middle) - p0);
+        T len = nrm.norm() + T(1e-9);
+        residuals[0] = T(w) * nrm.dot(m_a2.transform(r2, t2, s2, m_a2.first) - p0) / len;
+        residuals[1] = T(w) * nrm.dot(m_a2.transform(r2, t2, s2, m_a2.last) - p0) / len;
+        return true;
+    }
+};
+
+/*
+ * Solve runs in three steps that the GUI splits between the threads: the snapshot of the axes and of
+ * the constraints is taken on the UI thread, the snapshot is solved on a worker (the components are
+ * not touched, a cancelled token aborts the iterations) and the solution is applied to the components
+ * that still exist on the UI thread.
+ */
 class ModelSolver {
 public:
-    ModelSolver() { }
+    // parameter blocks of a component
+    struct component_parameters {
+        unsigned int component_id;
+        component_axis axis;
+        double rotation[3];
+        double translation[3];
+        double scale;
+        bool constrained;               // the component is moved by the solution
+    };
+
+    struct Snapshot {
+        std::vector<component_parameters> params;
+        std::vector<geosemcon> constraints;
+        ceres::Solver::Options options;
+        bool solved;
+    };
+
+    ModelSolver();
     void Solve();
+    std::shared_ptr<Snapshot> TakeSnapshot() const;
+    static bool SolveSnapshot(Snapshot& snapshot, const CancellationToken& token = CancellationToken());
+    // the transformations applied to the components are appended to transforms if it is given
+    void ApplySolution(const Snapshot& snapshot, std::vector<std::pair<unsigned int, osg::Matrixd>>* transforms = nullptr);
     void AddComponent(ComponentBase* component);
     void DeleteAllComponents();
     void DeleteSelectedComponents(std::vector<int>& id_vector);
     void UpdateOrCreateConstraints(const unsigned int cp1, const unsigned int cp2, const std::vector<geosemantic_constraints>& gsc);
     void GetConstraints(const unsigned int cp1, const unsigned int cp2, std::vector<geosemantic_constraints>& gsc) const;
+    void GetAllConstraints(std::vector<geosemcon>& constraints) const;
+    void GetComponents(std::vector<ComponentBase*>& components) const;
+    // nullptr if there is no component with this id
+    ComponentBase* GetComponent(unsigned int id) const;
     void Print() const;
 
 private:
-    std::list<ComponentBase*> m_components;
-    std::list<geosemcon> m_constraints;
+    std::map<unsigned int, ComponentBase*> m_components;                             // by component id
+    std::unordered_map<unsigned long long, geosemcon> m_constraints;                // by the unordered pair of the ids
+    std::unordered_map<unsigned int, std::unordered_set<unsigned int>> m_incidence;  // related components of a component
     std::shared_ptr<ProjectionParameters> m_pp;
+    ceres::Solver::Options m_options;
 
     inline int num_constraints() const;
+    static inline unsigned long long pair_key(unsigned int cp1, unsigned int cp2);
     void delete_constraints_with_id(unsigned int comp_id);
-    void construct_geosemantic_constraints();
+    static int construct_geosemantic_constraints(ceres::Problem& problem, const std::vector<geosemcon>& constraints, std::vector<component_parameters>& params);
 };
 
 #endif // MODEL_SOLVER_HPP
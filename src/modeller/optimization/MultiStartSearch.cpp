@@ -0,0 +1,89 @@
+#include "MultiStartSearch.hpp"
+#include "../../utility/ThreadPool.hpp"
+#include <limits>
+
+MultiStartSearch::MultiStartSearch(const pair_solver& solver, double good_enough_cost) :
+    m_solver(solver),
+    m_good_enough_cost(good_enough_cost),
+    m_best_cost(std::numeric_limits<double>::max()),
+    m_stop(false),
+    m_num_solves(0),
+    m_num_pruned(0) { }
+
+double MultiStartSearch::Search(const std::vector<std::vector<Circle3D>>& candidates, std::vector<Circle3D>& solution, std::vector<size_t>& choice) {
+
+    m_best_cost = std::numeric_limits<double>::max();
+    m_best_solution.clear();
+    m_best_choice.clear();
+    m_stop = false;
+    m_num_solves = 0;
+    m_num_pruned = 0;
+    if(candidates.empty()) return m_best_cost;
+
+    // Step-1: a task of the thread pool for each candidate of the first section, the first section is
+    // not solved; a search run by a worker runs the branches meanwhile
+    std::vector<Job<bool>> tasks;
+    for(size_t i = 0; i < candidates[0].size(); ++i) {
+        tasks.push_back(ThreadPool::Instance().Submit([this, &candidates, i](const CancellationToken&) {
+            std::vector<Circle3D> partial_solution(1, candidates[0][i]);
+            std::vector<size_t> partial_choice(1, i);
+            search(candidates, partial_solution, partial_choice, 0.0);
+            return true;
+        }));
+    }
+    for(const Job<bool>& task : tasks)
+        task.Wait();
+
+    // Step-2: the best of all of the branches
+    solution = m_best_solution;
+    choice = m_best_choice;
+    return m_best_cost;
+}
+
+size_t MultiStartSearch::GetNumberOfSolves() const {
+    return m_num_solves;
+}
+
+size_t MultiStartSearch::GetNumberOfPrunedBranches() const {
+    return m_num_pruned;
+}
+
+double MultiStartSearch::best_cost() {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_best_cost;
+}
+
+void MultiStartSearch::search(const std::vector<std::vector<Circle3D>>& candidates, std::vector<Circle3D>& solution, std::vector<size_t>& choice, double cost) {
+
+    if(m_stop) return;
+
+    // a complete combination
+    size_t section = solution.size();
+    if(section == candidates.size()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(cost < m_best_cost) {
+            m_best_cost = cost;
+            m_best_solution = solution;
+            m_best_choice = choice;
+            if(cost <= m_good_enough_cost) m_stop = true;
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < candidates[section].size() && !m_stop; ++i) {
+        Circle3D circle = candidates[section][i];
+        double pair_cost = m_solver(solution.back(), circle);
+        ++m_num_solves;
+        // the costs are non-negative, the partial cost is a lower bound of the complete one
+        if(cost + pair_cost >= best_cost()) {
+            ++m_num_pruned;
+            continue;
+        }
+        solution.push_back(circle);
+        choice.push_back(i);
+        search(candidates, solution, choice, cost + pair_cost);
+        solution.pop_back();
+        choice.pop_back();
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef MULTI_START_SEARCH_HPP
+#define MULTI_START_SEARCH_HPP
+
+#include "../../geometry/Circle3D.hpp"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+ * Searches the combination of circle candidates with the lowest cost.
+ *
+ * The ambiguous sections of a generalized cylinder have two candidate circles each and the
+ * candidates of a section are solved after the solved previous section, the cost of a combination
+ * is the sum of the non-negative pair costs. The combinations are searched depth first, the
+ * branches of the first section run in parallel on the ThreadPool and share the best cost: a partial combination
+ * that costs more than the best complete one is pruned, and the search stops early when a
+ * combination reaches the good enough cost.
+ */
+class MultiStartSearch {
+public:
+    // solves the current circle in place after the previous one and returns the cost
+    typedef std::function<double(const Circle3D& previous, Circle3D& current)> pair_solver;
+
+    MultiStartSearch(const pair_solver& solver, double good_enough_cost = 0.0);
+    // returns the lowest cost, the solved circles and the index of the selected candidate of each section
+    double Search(const std::vector<std::vector<Circle3D>>& candidates, std::vector<Circle3D>& solution, std::vector<size_t>& choice);
+    size_t GetNumberOfSolves() const;
+    size_t GetNumberOfPrunedBranches() const;
+
+private:
+    pair_solver m_solver;
+    double m_good_enough_cost;
+    std::mutex m_mutex;                 // guards the best solution
+    double m_best_cost;
+    std::vector<Circle3D> m_best_solution;
+    std::vector<size_t> m_best_choice;
+    std::atomic<bool> m_stop;
+    std::atomic<size_t> m_num_solves;
+    std::atomic<size_t> m_num_pruned;
+
+    double best_cost();
+    void search(const std::vector<std::vector<Circle3D>>& candidates, std::vector<Circle3D>& solution, std::vector<size_t>& choice, double cost);
+};
+
+#endif // MULTI_START_SEARCH_HPP
@@ -0,0 +1,322 @@
+#include "MultiViewSolver.hpp"
+#include "../CameraView.hpp"
+#include "../../utility/Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <set>
+
+// samples of a section circle, of the search of the depth scale and of the edge points
+static const int num_circle_samples = 72;
+static const int num_support_samples = 16;
+static const int num_scale_samples = 48;
+// edge points farther than the band from the projection are not collected, in pixels
+static const double edge_band = 3.0;
+// outlier scale of the residuals in pixels and the weights of the smoothness of the neighbour sections
+static const double outlier_scale = 2.0;
+static const double normal_smoothness_weight = 0.1;
+static const double radius_smoothness_weight = 0.1;
+// the edge points are collected and the sections solved this many times
+static const int num_rounds = 2;
+
+// the normals and the radii of the neighbour sections change slowly, the radii relative to their mean
+struct CostFunctor_SectionSmoothness {
+
+    CostFunctor_SectionSmoothness(double mean_radius) : m_inv_radius(1.0 / mean_radius) { }
+
+    template <typename T>
+    bool operator()(const T* const s0, const T* const r0, const T* const s1, const T* const r1, T* residuals) const {
+
+        for(int k = 0; k < 3; ++k)
+            residuals[k] = T(normal_smoothness_weight) * (s1[3 + k] - s0[3 + k]);
+        residuals[3] = T(radius_smoothness_weight * m_inv_radius) * (r1[0] - r0[0]);
+        return true;
+    }
+    private:
+    double m_inv_radius;
+};
+
+// size of a pixel of the view in projected coordinates
+static double pixel_size(const CameraView& view) {
+
+    const ProjectionParameters& pp = *view.GetProjectionParameters();
+    return 2.0 * pp.near * std::tan(deg2rad(pp.fovy / 2.0)) / static_cast<double>(pp.height);
+}
+
+MultiViewCircleCostFunction::MultiViewCircleCostFunction(const std::vector<osg::Vec2d>& points, const CameraView& view, double outlier_scale) :
+    SampsonCircleCostFunction(points, 0.0, -view.GetProjectionParameters()->near, outlier_scale),
+    m_rotation(view.GetRotation()),
+    m_translation(view.GetTranslation()) {
+
+    mutable_parameter_block_sizes()->push_back(1);
+}
+
+bool MultiViewCircleCostFunction::Evaluate(double const* const* parameters, double* residuals, double** jacobians) const {
+
+    // Step-1: the conic in the camera frame of the view, the derivatives by the world frame parameters
+    Eigen::Map<const Eigen::Vector3d> C(parameters[0]);
+    Eigen::Map<const Eigen::Vector3d> N(parameters[0] + 3);
+    double* center_normal = jacobians ? jacobians[0] : nullptr;
+    double* radius = jacobians ? jacobians[1] : nullptr;
+    bool with_jacobians = (center_normal != nullptr || radius != nullptr);
+    Eigen::Matrix3d Q, Dc[7], D[7];
+    circle_conic(m_rotation * C + m_translation, m_rotation * N, parameters[1][0], Q, with_jacobians ? Dc : nullptr);
+    if(with_jacobians) {
+        for(int j = 0; j < 3; ++j) {
+            D[j] = m_rotation(0,j) * Dc[0] + m_rotation(1,j) * Dc[1] + m_rotation(2,j) * Dc[2];
+            D[3 + j] = m_rotation(0,j) * Dc[3] + m_rotation(1,j) * Dc[4] + m_rotation(2,j) * Dc[5];
+        }
+        D[6] = Dc[6];
+    }
+
+    // Step-2: the points, row major 6 per residual for the center and the normal, 1 for the radius
+    double* columns[7];
+    int strides[7];
+    for(int j = 0; j < 6; ++j) {
+        columns[j] = center_normal ? center_normal + j : nullptr;
+        strides[j] = 6;
+    }
+    columns[6] = radius;
+    strides[6] = 1;
+    evaluate_points(Q, with_jacobians ? D : nullptr, 7, residuals, columns, strides);
+
+    // Step-3: the scale of the normal, |R N| = |N|
+    residuals[m_num_points] = N.squaredNorm() - 1.0;
+    if(center_normal) {
+        for(int j = 0; j < 6; ++j)
+            center_normal[6 * m_num_points + j] = (j < 3) ? 0.0 : 2.0 * N[j - 3];
+    }
+    if(radius) radius[m_num_points] = 0.0;
+    return true;
+}
+
+MultiViewSolver::MultiViewSolver(const std::vector<std::shared_ptr<CameraView>>& views) : m_views(views) {
+
+    m_options.max_num_iterations = 50;
+    m_options.minimizer_progress_to_stdout = false;
+    m_options.num_threads = static_cast<int>(ThreadPool::Instance().GetNumThreads());
+    // the normal equations are banded by the smoothness of the neighbour sections
+    if(ceres::IsSparseLinearAlgebraLibraryTypeAvailable(m_options.sparse_linear_algebra_library_type)) {
+        m_options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+    }
+    else {
+        m_options.linear_solver_type = ceres::CGNR;
+        m_options.preconditioner_type = ceres::JACOBI;
+    }
+}
+
+bool MultiViewSolver::PrepareViews(const CancellationToken& token) {
+
+    Profiler::Scope scope("MultiViewSolver::PrepareViews");
+    std::vector<char> prepared(m_views.size(), 0);
+    ThreadPool::Instance().ParallelFor(0, m_views.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t v = begin; v < end && !token.IsCancelled(); ++v)
+            prepared[v] = m_views[v]->Prepare() ? 1 : 0;
+    });
+    std::vector<std::shared_ptr<CameraView>> views;
+    for(size_t v = 0; v < m_views.size(); ++v)
+        if(prepared[v]) views.push_back(m_views[v]);
+    m_views.swap(views);
+    if(m_views.size() < 2) {
+        std::cout << "ERROR: At least two views with gradient images are needed" << std::endl;
+        return false;
+    }
+    return !token.IsCancelled();
+}
+
+bool MultiViewSolver::Solve(SectionStore& sections, const CancellationToken& token) {
+
+    Profiler::Scope scope("MultiViewSolver::Solve");
+    if(sections.size() < 2 || m_views.size() < 2) return false;
+
+    // Step-1: the depth of the sections, scaled about the center of the reference camera
+    double scale = find_depth_scale(sections);
+    if(scale <= 0.0) {
+        std::cout << "ERROR: Sections are not supported by the edges of the views" << std::endl;
+        return false;
+    }
+    for(size_t i = 0; i < sections.size(); ++i)
+        sections.scale(i, scale);
+    std::cout << "INFO: Depth scale of the sections in the views: " << scale << std::endl;
+
+    // Step-2: the joint refinement, the edge points are collected again around the refined sections
+    for(int round = 0; round < num_rounds; ++round) {
+        if(token.IsCancelled()) return false;
+        if(!solve_sections(sections, token)) return round > 0;
+    }
+    return true;
+}
+
+double MultiViewSolver::edge_support(const SectionStore& sections, double scale) const {
+
+    // mean distance of the projected circle points to the edges of the views, clamped at the band
+    std::vector<double> sums(m_views.size(), 0.0);
+    ThreadPool::Instance().ParallelFor(0, m_views.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t v = begin; v < end; ++v) {
+            const CameraView& view = *m_views[v];
+            double sum = 0.0;
+            for(size_t i = 0; i < sections.size(); ++i) {
+                Circle3D circle = sections[i];
+                Eigen::Vector3d u = circle.normal.unitOrthogonal();
+                Eigen::Vector3d w = circle.normal.cross(u);
+                for(int k = 0; k < num_support_samples; ++k) {
+                    double t = TWO_PI * k / num_support_samples;
+                    Eigen::Vector3d pt = scale * (circle.center + circle.radius * (std::cos(t) * u + std::sin(t) * w));
+                    osg::Vec2d prj;
+                    Point2D<int> pixel;
+                    float dist = -1.0f;
+                    if(view.Project(pt, prj) && view.ProjectedToPixel(prj, pixel))
+                        dist = view.GetEdgeMap().DistanceToEdge(pixel.x, pixel.y);
+                    sum += (dist < 0.0f || dist > 4.0 * edge_band) ? 4.0 * edge_band : dist;
+                }
+            }
+            sums[v] = sum;
+        }
+    });
+    double sum = 0.0;
+    for(double s : sums)
+        sum += s;
+    return sum / static_cast<double>(m_views.size() * sections.size() * num_support_samples);
+}
+
+double MultiViewSolver::find_depth_scale(const SectionStore& sections) const {
+
+    // Step-1: the scales within the clipping planes of the reference view, log spaced
+    const ProjectionParameters& pp = *m_views.front()->GetProjectionParameters();
+    double depth = 0.0;
+    for(size_t i = 0; i < sections.size(); ++i)
+        depth = std::max(depth, -sections.center(i)[2]);
+    if(depth <= 0.0) return -1.0;
+    double log_min = std::log(pp.near / depth), log_max = std::log(pp.far / depth);
+
+    // Step-2: the best sample, then a finer search between its neighbours
+    double step = (log_max - log_min) / (num_scale_samples - 1);
+    double best = log_min, best_support = std::numeric_limits<double>::max();
+    for(int pass = 0; pass < 2; ++pass) {
+        double first = (pass == 0) ? log_min : best - step;
+        double last = (pass == 0) ? log_max : best + step;
+        step = (last - first) / (num_scale_samples - 1);
+        for(int k = 0; k < num_scale_samples; ++k) {
+            double s = first + k * step;
+            double support = edge_support(sections, std::exp(s));
+            if(support < best_support) {
+                best_support = support;
+                best = s;
+            }
+        }
+    }
+    return (best_support < 4.0 * edge_band) ? std::exp(best) : -1.0;
+}
+
+void MultiViewSolver::collect_points(const CameraView& view, const SectionStore& sections, std::vector<section_points>& points) const {
+
+    const EdgeMap& edges = view.GetEdgeMap();
+    points.assign(sections.size(), section_points());
+    for(size_t i = 0; i < sections.size(); ++i) {
+
+        // Step-1: the image of the axis at the section, across it the contour points
+        osg::Vec2d c, prev, next;
+        if(!view.Project(Eigen::Map<const Eigen::Vector3d>(sections.center(i)), c) ||
+           !view.Project(Eigen::Map<const Eigen::Vector3d>(sections.center(i > 0 ? i - 1 : i)), prev) ||
+           !view.Project(Eigen::Map<const Eigen::Vector3d>(sections.center(i + 1 < sections.size() ? i + 1 : i)), next)) continue;
+        osg::Vec2d across(-(next - prev).y(), (next - prev).x());
+        if(across.normalize() == 0.0) continue;
+
+        // Step-2: the extremes of the ellipse across the axis, all the points for the rims of the ends
+        Circle3D circle = sections[i];
+        Eigen::Vector3d u = circle.normal.unitOrthogonal();
+        Eigen::Vector3d w = circle.normal.cross(u);
+        bool rim = (i == 0 || i + 1 == sections.size());
+        Point2D<int> extremes[2];
+        double extent[2] = { -std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+        std::set<std::pair<int, int>> visited;
+        for(int k = 0; k < num_circle_samples; ++k) {
+            double t = TWO_PI * k / num_circle_samples;
+            osg::Vec2d prj;
+            Point2D<int> pixel;
+            if(!view.Project(circle.center + circle.radius * (std::cos(t) * u + std::sin(t) * w), prj) || !view.ProjectedToPixel(prj, pixel)) continue;
+            double a = (prj - c) * across;
+            if(a > extent[0]) { extent[0] = a; extremes[0] = pixel; }
+            if(a < extent[1]) { extent[1] = a; extremes[1] = pixel; }
+            Point2D<int> edge;
+            if(!rim || !edges.NearestEdge(pixel.x, pixel.y, edge) || edges.DistanceToEdge(pixel.x, pixel.y) > edge_band) continue;
+            if(!visited.insert(std::make_pair(edge.x, edge.y)).second) continue;
+            points[i].rim.push_back(osg::Vec2d());
+            view.PixelToProjected(edge.x, edge.y, points[i].rim.back());
+        }
+        if(points[i].rim.size() < 5) points[i].rim.clear();
+        for(int e = 0; e < 2 && extent[1] < extent[0]; ++e) {
+            Point2D<int> edge;
+            if(!edges.NearestEdge(extremes[e].x, extremes[e].y, edge) || edges.DistanceToEdge(extremes[e].x, extremes[e].y) > edge_band) continue;
+            points[i].contour.push_back(osg::Vec2d());
+            view.PixelToProjected(edge.x, edge.y, points[i].contour.back());
+        }
+    }
+}
+
+bool MultiViewSolver::solve_sections(SectionStore& sections, const CancellationToken& token) const {
+
+    // Step-1: the edge points of every view, in parallel
+    std::vector<std::vector<section_points>> points(m_views.size());
+    ThreadPool::Instance().ParallelFor(0, m_views.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t v = begin; v < end; ++v)
+            collect_points(*m_views[v], sections, points[v]);
+    });
+
+    // Step-2: the parameters, the center and the normal then the radius of every section
+    size_t num_sections = sections.size();
+    std::vector<double> params(7 * num_sections);
+    double mean_radius = 0.0;
+    for(size_t i = 0; i < num_sections; ++i) {
+        std::copy(sections.center(i), sections.center(i) + 3, &params[7 * i]);
+        std::copy(sections.normal(i), sections.normal(i) + 3, &params[7 * i + 3]);
+        params[7 * i + 6] = sections.radius(i);
+        mean_radius += sections.radius(i) / static_cast<double>(num_sections);
+    }
+    if(mean_radius <= 0.0) return false;
+
+    // Step-3: a residual block per view and section, the smoothness between the neighbour sections
+    ceres::Problem problem;
+    int num_blocks = 0;
+    for(size_t v = 0; v < m_views.size(); ++v) {
+        double scale = outlier_scale * pixel_size(*m_views[v]);
+        for(size_t i = 0; i < num_sections; ++i) {
+            const section_points& pts = points[v][i];
+            for(const std::vector<osg::Vec2d>* p : { &pts.contour, &pts.rim }) {
+                if(p->empty()) continue;
+                problem.AddResidualBlock(new MultiViewCircleCostFunction(*p, *m_views[v], scale), NULL, &params[7 * i], &params[7 * i + 6]);
+                ++num_blocks;
+            }
+        }
+    }
+    if(num_blocks == 0) return false;
+    for(size_t i = 1; i < num_sections; ++i) {
+        if(!problem.HasParameterBlock(&params[7 * (i - 1)]) || !problem.HasParameterBlock(&params[7 * i])) continue;
+        ceres::CostFunction* smoothness = new ceres::AutoDiffCostFunction<CostFunctor_SectionSmoothness, 4, 6, 1, 6, 1>(
+                    new CostFunctor_SectionSmoothness(mean_radius));
+        problem.AddResidualBlock(smoothness, NULL, &params[7 * (i - 1)], &params[7 * (i - 1) + 6], &params[7 * i], &params[7 * i + 6]);
+    }
+    for(size_t i = 0; i < num_sections; ++i)
+        if(problem.HasParameterBlock(&params[7 * i + 6])) problem.SetParameterLowerBound(&params[7 * i + 6], 0, 0.0);
+
+    // Step-4: solve and write the sections that have been observed
+    cancellation_callback callback(token);
+    ceres::Solver::Options options = m_options;
+    options.callbacks.push_back(&callback);
+    ceres::Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+    std::cout << summary.BriefReport() << std::endl;
+    if(token.IsCancelled() || !summary.IsSolutionUsable()) return false;
+    for(size_t i = 0; i < num_sections; ++i) {
+        if(!problem.HasParameterBlock(&params[7 * i])) continue;
+        Eigen::Map<const Eigen::Vector3d> normal(&params[7 * i + 3]);
+        if(normal.norm() == 0.0) continue;
+        SectionStore::reference section = sections[i];
+        section.center = Eigen::Map<const Eigen::Vector3d>(&params[7 * i]);
+        section.normal = normal.normalized();
+        section.radius = params[7 * i + 6];
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef MULTI_VIEW_SOLVER_HPP
+#define MULTI_VIEW_SOLVER_HPP
+
+#include "ComponentSolver.hpp"
+#include "../../geometry/SectionStore.hpp"
+#include "../../utility/ThreadPool.hpp"
+#include <memory>
+#include <vector>
+
+class CameraView;
+
+/*
+ * Sampson distances of edge points of a view to the projection of a section given in the world frame.
+ * The center and the normal are mapped to the camera frame of the view (C_c = R C + t, N_c = R N)
+ * and the jacobians by the camera frame parameters are chained with R. Unlike in the single image,
+ * where the radius fixes the scale along the rays, the radius is a parameter: the views fix the
+ * scale. The points are robustified one by one with the outlier scale, in projected coordinates of
+ * the view (see SampsonCircleCostFunction). Parameters: the center and the normal, the radius.
+ */
+class MultiViewCircleCostFunction : public SampsonCircleCostFunction {
+public:
+    MultiViewCircleCostFunction(const std::vector<osg::Vec2d>& points, const CameraView& view, double outlier_scale);
+    bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override;
+private:
+    Eigen::Matrix3d m_rotation;
+    Eigen::Vector3d m_translation;
+};
+
+/*
+ * Joint refinement of a generalized cylinder in several calibrated views (see CameraView).
+ *
+ * The sections are modelled in the reference view, their depth along the rays of the reference
+ * camera is only known up to the scale of the single image modelling. The scale about the reference
+ * camera center that keeps the image of the reference view is found first, as the one whose
+ * projections in the other views are closest to their edges. Then the edge points around the
+ * projections of the sections are collected in every view and the sections are refined in one
+ * problem:
+ *
+ *  - silhouette residuals: the contour of the sweep is the envelope of the images of its sections,
+ *    the contour points of a view at the two extremes of the ellipse of a section across the image
+ *    of the axis lie on that ellipse,
+ *  - circle residuals: the rims of the two end sections, the edge points all around their ellipses,
+ *  - a weak smoothness of the normals and of the radii of the neighbour sections.
+ *
+ * There is one residual block per view and section, Ceres evaluates them in parallel with
+ * num_threads. The edge points are collected again around the refined sections and the problem is
+ * solved once more, as the correspondences of the first solve are those of the initial estimate.
+ */
+class MultiViewSolver {
+public:
+    explicit MultiViewSolver(const std::vector<std::shared_ptr<CameraView>>& views);
+    // the gradient images and the edge maps of the views, in parallel; false if less than two views are usable
+    bool PrepareViews(const CancellationToken& token = CancellationToken());
+    // refines the sections in place, false if the views do not support them
+    bool Solve(SectionStore& sections, const CancellationToken& token = CancellationToken());
+
+private:
+    struct section_points {
+        std::vector<osg::Vec2d> contour;    // projected coordinates of the view
+        std::vector<osg::Vec2d> rim;        // only for the end sections
+    };
+
+    std::vector<std::shared_ptr<CameraView>> m_views;   // the prepared ones after PrepareViews
+    ceres::Solver::Options m_options;
+
+    double edge_support(const SectionStore& sections, double scale) const;
+    double find_depth_scale(const SectionStore& sections) const;
+    void collect_points(const CameraView& view, const SectionStore& sections, std::vector<section_points>& points) const;
+    bool solve_sections(SectionStore& sections, const CancellationToken& token) const;
+};
+
+#endif // MULTI_VIEW_SOLVER_HPP
@@ -1,6 +1,8 @@
 #ifndef OPTIMIZATIONUTILITY_HPP
 #define OPTIMIZATIONUTILITY_HPP
 
+#include "../../utility/ThreadPool.hpp"
+#include <ceres/ceres.h>
 #include <iostream>
 #include <cmath>
 
@@ -130,4 +132,14 @@ Vector3D<T> operator*(T left, const Vector3D<T>& right) {
     return Vector3D<T>(right.x * left, right.y * left, right.z * left);
 }
 
+// aborts the iterations of a solve once its token is cancelled
+struct cancellation_callback : public ceres::IterationCallback {
+
+    explicit cancellation_callback(const CancellationToken& t) : token(t) { }
+    ceres::CallbackReturnType operator()(const ceres::IterationSummary& summary) override {
+        return token.IsCancelled() ? ceres::SOLVER_ABORT : ceres::SOLVER_CONTINUE;
+    }
+    CancellationToken token;
+};
+
 #endif // OPTIMIZATIONUTILITY_HPP
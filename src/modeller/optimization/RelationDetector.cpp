@@ -0,0 +1,140 @@
+#include "RelationDetector.hpp"
+#include "../components/ComponentBase.hpp"
+#include <osg/Math>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+// a component covering more cells than this is tested against all the others
+static const int max_cells_per_component = 512;
+
+static inline uint64_t cell_key(int x, int y, int z) {
+
+    // 21 bits per coordinate, the model spans far less than 2^21 median components
+    return (static_cast<uint64_t>(x & 0x1fffff) << 42) | (static_cast<uint64_t>(y & 0x1fffff) << 21) | static_cast<uint64_t>(z & 0x1fffff);
+}
+
+static inline double distance_to_line(const osg::Vec3d& pt, const osg::Vec3d& origin, const osg::Vec3d& dir) {
+    return ((pt - origin) ^ dir).length();
+}
+
+RelationDetector::RelationDetector(double angle_tolerance, double distance_tolerance) :
+    m_cos_parallel(std::cos(osg::DegreesToRadians(angle_tolerance))),
+    m_cos_orthogonal(std::sin(osg::DegreesToRadians(angle_tolerance))),
+    m_distance(distance_tolerance) { }
+
+void RelationDetector::Detect(const std::vector<ComponentBase*>& components, std::vector<geosemcon>& proposals) const {
+
+    proposals.clear();
+
+    // Step-1: the axes and the bounds grown by the distance tolerance of the component
+    std::vector<component_axis> axes;
+    axes.reserve(components.size());
+    std::vector<osg::Vec3d> points;
+    for(ComponentBase* comp : components) {
+        points.clear();
+        if(!comp->GetAxisPoints(points) || points.size() < 2) continue;
+        component_axis axis;
+        axis.id = comp->GetComponentId();
+        axis.first = points.front();
+        axis.last = points.back();
+        axis.dir = axis.last - axis.first;
+        axis.length = axis.dir.normalize();
+        if(axis.length <= 0.0) continue;
+        axis.bound = comp->getBound();
+        if(!axis.bound.valid()) continue;
+        axis.bound.radius() += m_distance * axis.length;
+        axes.push_back(axis);
+    }
+    if(axes.size() < 2) return;
+
+    // Step-2: the cell size is the median diameter of the bounds
+    std::vector<double> diameters;
+    diameters.reserve(axes.size());
+    for(const component_axis& axis : axes)
+        diameters.push_back(2.0 * axis.bound.radius());
+    std::nth_element(diameters.begin(), diameters.begin() + diameters.size() / 2, diameters.end());
+    double cell = diameters[diameters.size() / 2];
+    if(cell <= 0.0) return;
+
+    // Step-3: the components are inserted in the cells they cover
+    std::unordered_map<uint64_t, std::vector<unsigned int>> grid;
+    std::vector<unsigned int> oversized;
+    for(unsigned int i = 0; i < axes.size(); ++i) {
+        component_axis& axis = axes[i];
+        int num_cells = 1;
+        for(int k = 0; k < 3; ++k) {
+            axis.lo[k] = static_cast<int>(std::floor((axis.bound.center()[k] - axis.bound.radius()) / cell));
+            axis.hi[k] = static_cast<int>(std::floor((axis.bound.center()[k] + axis.bound.radius()) / cell));
+            num_cells *= std::min(axis.hi[k] - axis.lo[k] + 1, max_cells_per_component + 1);
+        }
+        if(num_cells > max_cells_per_component) {
+            oversized.push_back(i);
+            continue;
+        }
+        for(int x = axis.lo[0]; x <= axis.hi[0]; ++x)
+            for(int y = axis.lo[1]; y <= axis.hi[1]; ++y)
+                for(int z = axis.lo[2]; z <= axis.hi[2]; ++z)
+                    grid[cell_key(x, y, z)].push_back(i);
+    }
+
+    // Step-4: the pairs with overlapping bounds, each in the first cell the two components share
+    std::vector<std::pair<unsigned int, unsigned int>> pairs;
+    for(const auto& item : grid) {
+        const std::vector<unsigned int>& members = item.second;
+        for(size_t m = 0; m < members.size(); ++m) {
+            for(size_t n = m + 1; n < members.size(); ++n) {
+                const component_axis& a = axes[members[m]];
+                const component_axis& b = axes[members[n]];
+                uint64_t first = cell_key(std::max(a.lo[0], b.lo[0]), std::max(a.lo[1], b.lo[1]), std::max(a.lo[2], b.lo[2]));
+                if(first == item.first && a.bound.intersects(b.bound))
+                    pairs.push_back(std::make_pair(members[m], members[n]));
+            }
+        }
+    }
+    for(size_t m = 0; m < oversized.size(); ++m) {
+        const component_axis& a = axes[oversized[m]];
+        for(unsigned int j = 0; j < axes.size(); ++j) {
+            // the pairs of two oversized components once
+            if(j == oversized[m] || (std::find(oversized.begin(), oversized.begin() + m, j) != oversized.begin() + m)) continue;
+            if(a.bound.intersects(axes[j].bound))
+                pairs.push_back(std::make_pair(oversized[m], j));
+        }
+    }
+
+    // Step-5: the proposals
+    std::vector<geosemantic_constraints> gsc;
+    for(const auto& pair : pairs) {
+        const component_axis* a = &axes[pair.first];
+        const component_axis* b = &axes[pair.second];
+        if(a->id > b->id) std::swap(a, b);
+        gsc.clear();
+        if(classify(*a, *b, gsc))
+            proposals.push_back(geosemcon(a->id, b->id, gsc));
+    }
+    std::sort(proposals.begin(), proposals.end(), [](const geosemcon& p, const geosemcon& q) {
+        return (p.component_1 != q.component_1) ? p.component_1 < q.component_1 : p.component_2 < q.component_2;
+    });
+}
+
+bool RelationDetector::classify(const component_axis& a, const component_axis& b, std::vector<geosemantic_constraints>& gsc) const {
+
+    double tolerance = m_distance * 0.5 * (a.length + b.length);
+    double cos = std::abs(a.dir * b.dir);
+    if(cos >= m_cos_parallel) {
+        bool coaxial = distance_to_line(b.first, a.first, a.dir) <= tolerance && distance_to_line(b.last, a.first, a.dir) <= tolerance &&
+                       distance_to_line(a.first, b.first, b.dir) <= tolerance && distance_to_line(a.last, b.first, b.dir) <= tolerance;
+        gsc.push_back(coaxial ? geosemantic_constraints::collinear_axis_endpoints : geosemantic_constraints::parallel);
+    }
+    else if(cos <= m_cos_orthogonal) {
+        gsc.push_back(geosemantic_constraints::orthogonal);
+    }
+
+    double closest = std::min(std::min((a.first - b.first).length(), (a.first - b.last).length()),
+                              std::min((a.last - b.first).length(), (a.last - b.last).length()));
+    if(closest <= tolerance)
+        gsc.push_back(geosemantic_constraints::overlapping_axis_endpoints);
+    return !gsc.empty();
+}
@@ -0,0 +1,52 @@
+#ifndef RELATION_DETECTOR_HPP
+#define RELATION_DETECTOR_HPP
+
+#include "Constraints.hpp"
+#include <osg/BoundingSphere>
+#include <osg/Vec3d>
+#include <vector>
+
+class ComponentBase;
+
+/*
+ * Proposals of geosemantic constraints between the nearby components of a model, for the operator
+ * to confirm instead of entering them pair by pair.
+ *
+ * The components are indexed by their bounds in a uniform grid hashed by the cell coordinates. The
+ * cell size is the median diameter of the bounds, so that a component covers a few cells and a cell
+ * holds a few components, and the bounds are grown by the distance tolerance so that the touching
+ * components share a cell. The pairs of a cell are tested once, in the first cell of the overlap of
+ * their ranges of cells: near linear in the number of components instead of all the pairs. The few
+ * components much larger than the cells are tested against all the others.
+ *
+ * A pair is classified by the axes of the components (ComponentBase::GetAxisPoints), the section
+ * planes of the generalized cylinders are orthogonal to their axes:
+ *  - coaxial, parallel and each end of an axis on the line of the other: collinear_axis_endpoints,
+ *  - otherwise parallel or orthogonal within the angle tolerance,
+ *  - touching, the closest ends of the axes within the distance tolerance: overlapping_axis_endpoints.
+ * The distance tolerance is relative to the mean length of the two axes.
+ */
+class RelationDetector {
+public:
+    // the angle tolerance in degrees, the distance tolerance relative to the length of the axes
+    RelationDetector(double angle_tolerance = 5.0, double distance_tolerance = 0.1);
+    // the proposals ordered by the component ids, the first id is the smaller one
+    void Detect(const std::vector<ComponentBase*>& components, std::vector<geosemcon>& proposals) const;
+
+private:
+    struct component_axis {
+        unsigned int id;
+        osg::Vec3d first, last, dir;
+        double length;
+        osg::BoundingSphere bound;
+        int lo[3], hi[3];       // range of cells
+    };
+
+    double m_cos_parallel;      // bound of |cos| of the parallel axes
+    double m_cos_orthogonal;    // bound of |cos| of the orthogonal axes
+    double m_distance;
+
+    bool classify(const component_axis& a, const component_axis& b, std::vector<geosemantic_constraints>& gsc) const;
+};
+
+#endif // RELATION_DETECTOR_HPP
@@ -0,0 +1,679 @@
+#include "CompactModel.hpp"
+#include "OsgStateSetPool.hpp"
+#include "../modeller/components/GeneralizedCylinder.hpp"
+#include "../modeller/components/PrimitiveComponent.hpp"
+#include "../geometry/MeshDecimator.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Transform>
+#include <osg/TriangleIndexFunctor>
+#include <osgDB/FileNameUtils>
+#include <osgDB/WriteFile>
+#include <osg/Image>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static const size_t vertex_record_size = 3 * sizeof(float) + 3 * sizeof(int16_t);
+static const size_t face_record_size = 1 + 3 * sizeof(uint32_t);
+static const size_t component_record_size = 3 * sizeof(uint32_t) + 4;
+static const size_t max_header_size = 1024;
+static const float snorm16_scale = 32767.0f;
+static const unsigned int no_component_id = 0xffffffff;
+static const uint32_t invalid_index = 0xffffffff;
+
+struct compact_component {
+    uint32_t id;
+    uint32_t first_face;
+    uint32_t num_faces;
+    uint8_t color[4];
+};
+
+struct compact_mesh {
+    std::vector<float> positions;                 // x, y, z for each vertex
+    std::vector<int16_t> normals;                 // snorm16 x, y, z for each vertex
+    std::vector<uint32_t> triangles;              // 3 indices for each face
+    std::vector<compact_component> components;    // consecutive face ranges
+};
+
+struct vertex_key {
+    float p[3];
+    int16_t n[3];
+
+    bool operator==(const vertex_key& other) const {
+        return std::memcmp(p, other.p, sizeof(p)) == 0 && std::memcmp(n, other.n, sizeof(n)) == 0;
+    }
+};
+
+struct vertex_key_hash {
+    size_t operator()(const vertex_key& key) const {
+
+        // FNV-1a over the bytes of the key
+        unsigned char bytes[sizeof(key.p) + sizeof(key.n)];
+        std::memcpy(bytes, key.p, sizeof(key.p));
+        std::memcpy(bytes + sizeof(key.p), key.n, sizeof(key.n));
+        uint64_t h = 14695981039346656037ull;
+        for(unsigned char b : bytes) {
+            h ^= b;
+            h *= 1099511628211ull;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+// area weighted normals of the triangles
+static osg::Vec3Array* triangle_normals(const osg::Vec3Array* vertices, const std::vector<unsigned int>& triangles) {
+
+    osg::Vec3Array* normals = new osg::Vec3Array(vertices->size());
+    for(size_t k = 0; k + 2 < triangles.size(); k += 3) {
+        const osg::Vec3& p0 = (*vertices)[triangles[k]];
+        osg::Vec3 n = ((*vertices)[triangles[k + 1]] - p0) ^ ((*vertices)[triangles[k + 2]] - p0);
+        for(int j = 0; j < 3; ++j)
+            (*normals)[triangles[k + j]] += n;
+    }
+    return normals;
+}
+
+struct triangle_collector {
+    std::vector<unsigned int>* triangles;
+
+    void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+        triangles->push_back(i1);
+        triangles->push_back(i2);
+        triangles->push_back(i3);
+    }
+};
+
+static bool host_is_little_endian() {
+
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+static int16_t quantize_normal(float value) {
+
+    return static_cast<int16_t>(std::lround(std::max(-1.0f, std::min(1.0f, value)) * snorm16_scale));
+}
+
+static uint8_t quantize_color(float value) {
+
+    return static_cast<uint8_t>(std::lround(std::max(0.0f, std::min(1.0f, value)) * 255.0f));
+}
+
+/*
+ * Collects the triangles of the components in world coordinates. Generalized cylinders are
+ * exported as closed surfaces from their sections, the section and vertex normal switches are
+ * not traversed, the primitives as their transformed unit meshes. Any other geometry with
+ * triangles is exported as it is drawn. With a maximum error the generalized cylinders are
+ * simplified on their sections and the other geometries are decimated in world coordinates.
+ */
+class compact_model_collector : public osg::NodeVisitor {
+public:
+    compact_model_collector(compact_mesh& mesh, double max_error = 0.0) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        m_mesh(mesh),
+        m_component_id(no_component_id),
+        m_max_error(max_error) {
+
+        // the display only nodes, e.g. the merged geometry of the frozen components
+        setTraversalMask(~0x1);
+    }
+
+    void apply(osg::Group& group) override {
+
+        ComponentBase* component = dynamic_cast<ComponentBase*>(&group);
+        if(component == nullptr) {
+            traverse(group);
+            return;
+        }
+
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(component);
+        if(gcyl) {
+            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+            osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+            std::vector<unsigned int> triangles;
+            if(m_max_error > 0.0) gcyl->GetGeometry()->GetSimplifiedTriangleMesh(m_max_error, vertices.get(), normals.get(), triangles);
+            else gcyl->GetGeometry()->GetTriangleMesh(vertices.get(), normals.get(), triangles);
+            begin_component(gcyl->GetComponentId(), gcyl->GetGeometry()->GetColor());
+            add_triangles(vertices.get(), normals.get(), triangles, osg::computeLocalToWorld(getNodePath()));
+            end_component();
+            return;
+        }
+
+        // the proxies of the primitives have no color, the mesh is transformed as it is drawn by its batch
+        PrimitiveComponent* primitive = dynamic_cast<PrimitiveComponent*>(component);
+        if(primitive) {
+            osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+            osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+            std::vector<unsigned int> triangles;
+            primitive->GetTriangleMesh(vertices.get(), normals.get(), triangles);
+            begin_component(primitive->GetComponentId(), primitive->GetColor());
+            add_triangles(vertices.get(), normals.get(), triangles, osg::computeLocalToWorld(getNodePath()));
+            end_component();
+            return;
+        }
+
+        unsigned int parent_id = m_component_id;
+        m_component_id = component->GetComponentId();
+        traverse(group);
+        m_component_id = parent_id;
+    }
+
+    void apply(osg::Geode& geode) override {
+
+        osg::Matrix mat = osg::computeLocalToWorld(getNodePath());
+        for(unsigned int i = 0; i < geode.getNumDrawables(); ++i) {
+            osg::Geometry* geom = geode.getDrawable(i)->asGeometry();
+            if(geom == nullptr) continue;
+            const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geom->getVertexArray());
+            if(vertices == nullptr || vertices->empty()) continue;
+
+            std::vector<unsigned int> triangles;
+            osg::TriangleIndexFunctor<triangle_collector> functor;
+            functor.triangles = &triangles;
+            geom->accept(functor);
+            if(triangles.empty()) continue;
+
+            // a color array or the shared state of the color
+            const osg::Vec4Array* colors = dynamic_cast<const osg::Vec4Array*>(geom->getColorArray());
+            osg::Vec4 color(1.0f, 1.0f, 1.0f, 1.0f);
+            if(colors && !colors->empty()) color = colors->front();
+            else StateSetPool::GetColor(geom->getStateSet(), color);
+            begin_component(m_component_id, color);
+
+            // decimated in world coordinates, the normals of the decimated triangles
+            if(m_max_error > 0.0) {
+                osg::ref_ptr<osg::Vec3Array> world = new osg::Vec3Array(vertices->size());
+                for(size_t k = 0; k < vertices->size(); ++k)
+                    (*world)[k] = (*vertices)[k] * mat;
+                MeshDecimator(m_max_error).Decimate(world.get(), triangles);
+                osg::ref_ptr<osg::Vec3Array> normals = triangle_normals(world.get(), triangles);
+                add_triangles(world.get(), normals.get(), triangles, osg::Matrix::identity());
+                end_component();
+                continue;
+            }
+
+            // normals of shaded geometry or area weighted normals of the triangles
+            osg::ref_ptr<osg::Vec3Array> normals = dynamic_cast<osg::Vec3Array*>(geom->getNormalArray());
+            if(!normals.valid() || geom->getNormalBinding() != osg::Geometry::BIND_PER_VERTEX || normals->size() != vertices->size())
+                normals = triangle_normals(vertices, triangles);
+            add_triangles(vertices, normals.get(), triangles, mat);
+            end_component();
+        }
+    }
+
+private:
+    compact_mesh& m_mesh;
+    unsigned int m_component_id;      // id of the component being traversed
+    double m_max_error;               // of the simplification, 0 for the full resolution
+    std::unordered_map<vertex_key, uint32_t, vertex_key_hash> m_welded;
+
+    void begin_component(unsigned int id, const osg::Vec4& color) {
+
+        compact_component component;
+        component.id = id;
+        component.first_face = static_cast<uint32_t>(m_mesh.triangles.size() / 3);
+        component.num_faces = 0;
+        for(int i = 0; i < 4; ++i)
+            component.color[i] = quantize_color(color[i]);
+        m_mesh.components.push_back(component);
+        m_welded.clear();
+    }
+
+    void end_component() {
+
+        compact_component& component = m_mesh.components.back();
+        component.num_faces = static_cast<uint32_t>(m_mesh.triangles.size() / 3) - component.first_face;
+        if(component.num_faces == 0) m_mesh.components.pop_back();
+    }
+
+    void add_triangles(const osg::Vec3Array* vertices, const osg::Vec3Array* normals, const std::vector<unsigned int>& triangles, const osg::Matrix& mat) {
+
+        // Step-1: transform, quantize and weld the referenced vertices
+        osg::Matrix inv = osg::Matrix::inverse(mat);
+        std::vector<uint32_t> remap(vertices->size(), invalid_index);
+        for(unsigned int idx : triangles) {
+            if(remap[idx] != invalid_index) continue;
+
+            osg::Vec3 p = (*vertices)[idx] * mat;
+            osg::Vec3 n = osg::Matrix::transform3x3(inv, (*normals)[idx]);
+            n.normalize();
+            vertex_key key;
+            for(int k = 0; k < 3; ++k) {
+                key.p[k] = p[k];
+                key.n[k] = quantize_normal(n[k]);
+            }
+
+            auto it = m_welded.find(key);
+            if(it == m_welded.end()) {
+                uint32_t welded_idx = static_cast<uint32_t>(m_mesh.positions.size() / 3);
+                it = m_welded.insert(std::make_pair(key, welded_idx)).first;
+                m_mesh.positions.insert(m_mesh.positions.end(), key.p, key.p + 3);
+                m_mesh.normals.insert(m_mesh.normals.end(), key.n, key.n + 3);
+            }
+            remap[idx] = it->second;
+        }
+
+        // Step-2: triangles, the ones that collapse after the welding are dropped
+        for(size_t k = 0; k + 2 < triangles.size(); k += 3) {
+            uint32_t a = remap[triangles[k]], b = remap[triangles[k + 1]], c = remap[triangles[k + 2]];
+            if(a == b || b == c || a == c) continue;
+            m_mesh.triangles.push_back(a);
+            m_mesh.triangles.push_back(b);
+            m_mesh.triangles.push_back(c);
+        }
+    }
+};
+
+struct textured_component {
+    unsigned int id;
+    osg::Vec4 color;
+    osg::ref_ptr<osg::Image> texture;           // nullptr for the flat colored components
+    std::vector<unsigned int> triangles;        // into the shared arrays
+};
+
+struct textured_mesh {
+    osg::ref_ptr<osg::Vec3Array> positions = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;    // (0, 0) for the flat colored components
+    std::vector<textured_component> components;
+};
+
+/*
+ * Collects the modelled components for the textured export in world coordinates: the generalized
+ * cylinders with a baked texture with their texture coordinates, the other ones as in the compact
+ * export without welding. Geometries that are not components, e.g. of a loaded model, are skipped.
+ * With a maximum error the untextured generalized cylinders are simplified on their sections, the
+ * textures are parameterized by all the sections.
+ */
+class textured_model_collector : public osg::NodeVisitor {
+public:
+    textured_model_collector(textured_mesh& mesh, double max_error = 0.0) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        m_mesh(mesh),
+        m_max_error(max_error) {
+
+        setTraversalMask(~0x1);
+    }
+
+    void apply(osg::Group& group) override {
+
+        ComponentBase* component = dynamic_cast<ComponentBase*>(&group);
+        if(component == nullptr) {
+            traverse(group);
+            return;
+        }
+
+        textured_component item;
+        item.id = component->GetComponentId();
+        size_t first = m_mesh.positions->size();
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(component);
+        PrimitiveComponent* primitive = dynamic_cast<PrimitiveComponent*>(component);
+        if(gcyl && gcyl->GetTexture()) {
+            item.color = gcyl->GetGeometry()->GetColor();
+            item.texture = gcyl->GetTexture();
+            gcyl->GetGeometry()->GetTexturedMesh(m_mesh.positions.get(), m_mesh.normals.get(), m_mesh.texcoords.get(), item.triangles);
+        }
+        else if(gcyl) {
+            item.color = gcyl->GetGeometry()->GetColor();
+            if(m_max_error > 0.0) gcyl->GetGeometry()->GetSimplifiedTriangleMesh(m_max_error, m_mesh.positions.get(), m_mesh.normals.get(), item.triangles);
+            else gcyl->GetGeometry()->GetTriangleMesh(m_mesh.positions.get(), m_mesh.normals.get(), item.triangles);
+        }
+        else if(primitive) {
+            item.color = primitive->GetColor();
+            primitive->GetTriangleMesh(m_mesh.positions.get(), m_mesh.normals.get(), item.triangles);
+        }
+        else {
+            traverse(group);
+            return;
+        }
+
+        // the meshes are appended to the shared arrays, the texture coordinates are padded
+        m_mesh.texcoords->resize(m_mesh.positions->size());
+        osg::Matrix mat = osg::computeLocalToWorld(getNodePath());
+        osg::Matrix inv = osg::Matrix::inverse(mat);
+        for(size_t i = first; i < m_mesh.positions->size(); ++i) {
+            (*m_mesh.positions)[i] = (*m_mesh.positions)[i] * mat;
+            (*m_mesh.normals)[i] = osg::Matrix::transform3x3(inv, (*m_mesh.normals)[i]);
+            (*m_mesh.normals)[i].normalize();
+        }
+        if(!item.triangles.empty()) m_mesh.components.push_back(item);
+    }
+
+private:
+    textured_mesh& m_mesh;
+    double m_max_error;
+};
+
+static bool write_textured_obj(osg::Node& model, const std::string& path, double max_error) {
+
+    // Step-1: the components and the names of the side files next to the model file
+    textured_mesh mesh;
+    textured_model_collector collector(mesh, max_error);
+    model.accept(collector);
+    if(mesh.components.empty()) {
+        std::cout << "ERROR: No components to export" << std::endl;
+        return false;
+    }
+    std::string dir = osgDB::getFilePath(path);
+    std::string name = osgDB::getStrippedName(path);
+    std::string prefix = dir.empty() ? std::string() : dir + "/";
+    std::ofstream obj(path.c_str()), mtl((prefix + name + ".mtl").c_str());
+    if(!obj.good() || !mtl.good()) {
+        std::cout << "ERROR: Cannot write the model file: " << path << std::endl;
+        return false;
+    }
+
+    // Step-2: the shared arrays, one texture coordinate per vertex
+    obj << "# cvm textured model\n" << "mtllib " << name << ".mtl\n";
+    for(const osg::Vec3& p : *mesh.positions)
+        obj << "v " << p.x() << " " << p.y() << " " << p.z() << "\n";
+    for(const osg::Vec2& t : *mesh.texcoords)
+        obj << "vt " << t.x() << " " << t.y() << "\n";
+    for(const osg::Vec3& n : *mesh.normals)
+        obj << "vn " << n.x() << " " << n.y() << " " << n.z() << "\n";
+
+    // Step-3: a material per component, the baked textures as PNG files
+    size_t num_textured = 0;
+    for(const textured_component& component : mesh.components) {
+        std::string material = "component_" + std::to_string(component.id);
+        mtl << "newmtl " << material << "\n"
+            << "Kd " << component.color.r() << " " << component.color.g() << " " << component.color.b() << "\n"
+            << "d " << component.color.a() << "\n";
+        if(component.texture.valid()) {
+            std::string texture = name + "_" + std::to_string(component.id) + ".png";
+            if(osgDB::writeImageFile(*component.texture, prefix + texture)) {
+                mtl << "Kd 1 1 1\n" << "d 1\n" << "map_Kd " << texture << "\n";
+                ++num_textured;
+            }
+            else {
+                std::cout << "ERROR: Cannot write the texture of component " << component.id << std::endl;
+            }
+        }
+        obj << "o " << material << "\n" << "usemtl " << material << "\n";
+        for(size_t k = 0; k + 2 < component.triangles.size(); k += 3) {
+            obj << "f";
+            for(int j = 0; j < 3; ++j) {
+                unsigned int idx = component.triangles[k + j] + 1;
+                obj << " " << idx << "/" << idx << "/" << idx;
+            }
+            obj << "\n";
+        }
+    }
+    std::cout << "INFO: Exporting " << mesh.positions->size() << " vertices of " << mesh.components.size() << " components, "
+              << num_textured << " textured" << std::endl;
+    if(!obj.good() || !mtl.good()) {
+        std::cout << "ERROR: Cannot write the model file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static std::string compact_ply_header(size_t num_vertices, size_t num_faces, size_t num_components, bool little_endian) {
+
+    std::ostringstream ss;
+    ss << "ply\n"
+       << "format " << (little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+       << "comment cvm compact model, snorm16 normals\n"
+       << "element vertex " << num_vertices << "\n"
+       << "property float x\n"
+       << "property float y\n"
+       << "property float z\n"
+       << "property short nx\n"
+       << "property short ny\n"
+       << "property short nz\n"
+       << "element face " << num_faces << "\n"
+       << "property list uchar uint vertex_indices\n"
+       << "element component " << num_components << "\n"
+       << "property uint id\n"
+       << "property uint first_face\n"
+       << "property uint num_faces\n"
+       << "property uchar red\n"
+       << "property uchar green\n"
+       << "property uchar blue\n"
+       << "property uchar alpha\n"
+       << "end_header\n";
+    return ss.str();
+}
+
+static bool write_compact_ply(const compact_mesh& mesh, const std::string& path) {
+
+    // Step-1: the whole file is assembled in memory and written at once, in the byte order of the host
+    size_t num_vertices = mesh.positions.size() / 3;
+    size_t num_faces = mesh.triangles.size() / 3;
+    std::string header = compact_ply_header(num_vertices, num_faces, mesh.components.size(), host_is_little_endian());
+    std::vector<char> buffer(header.size() + num_vertices * vertex_record_size + num_faces * face_record_size +
+                             mesh.components.size() * component_record_size);
+    char* ptr = &buffer[0];
+    std::memcpy(ptr, header.data(), header.size());
+    ptr += header.size();
+
+    // Step-2: vertices, faces and components
+    for(size_t i = 0; i < num_vertices; ++i) {
+        std::memcpy(ptr, &mesh.positions[3 * i], 3 * sizeof(float));
+        std::memcpy(ptr + 3 * sizeof(float), &mesh.normals[3 * i], 3 * sizeof(int16_t));
+        ptr += vertex_record_size;
+    }
+    for(size_t i = 0; i < num_faces; ++i) {
+        *ptr = 3;
+        std::memcpy(ptr + 1, &mesh.triangles[3 * i], 3 * sizeof(uint32_t));
+        ptr += face_record_size;
+    }
+    for(const compact_component& component : mesh.components) {
+        std::memcpy(ptr, &component.id, sizeof(uint32_t));
+        std::memcpy(ptr + 4, &component.first_face, sizeof(uint32_t));
+        std::memcpy(ptr + 8, &component.num_faces, sizeof(uint32_t));
+        std::memcpy(ptr + 12, component.color, 4);
+        ptr += component_record_size;
+    }
+
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if(!out.write(&buffer[0], buffer.size())) {
+        std::cout << "ERROR: Cannot write the model file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static osg::Vec4 component_color(const compact_component& component) {
+    return osg::Vec4(component.color[0], component.color[1], component.color[2], component.color[3]) / 255.0f;
+}
+
+// arrays shared by the geometries of all the components, the normals stay quantized
+static void create_shared_arrays(const compact_mesh& mesh, osg::ref_ptr<osg::Vec3Array>& vertices, osg::ref_ptr<osg::Vec3sArray>& normals) {
+
+    size_t num_vertices = mesh.positions.size() / 3;
+    vertices = new osg::Vec3Array(num_vertices);
+    normals = new osg::Vec3sArray(num_vertices);
+    if(num_vertices > 0) {
+        std::memcpy(&(*vertices)[0], &mesh.positions[0], 3 * num_vertices * sizeof(float));
+        std::memcpy(&(*normals)[0], &mesh.normals[0], 3 * num_vertices * sizeof(int16_t));
+    }
+    normals->setNormalize(true);
+}
+
+static osg::Node* create_compact_model_node(const compact_mesh& mesh) {
+
+    osg::ref_ptr<osg::Vec3Array> vertices;
+    osg::ref_ptr<osg::Vec3sArray> normals;
+    create_shared_arrays(mesh, vertices, normals);
+
+    osg::Group* group = new osg::Group;
+    for(const compact_component& component : mesh.components) {
+        osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(GL_TRIANGLES,
+                mesh.triangles.begin() + 3 * component.first_face, mesh.triangles.begin() + 3 * (component.first_face + component.num_faces));
+
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray(vertices.get());
+        geom->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geom->setStateSet(StateSetPool::Instance().Get(render_state(component_color(component))));
+        geom->addPrimitiveSet(indices.get());
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        if(component.id != no_component_id)
+            geode->setName("component_" + std::to_string(component.id));
+        geode->addDrawable(geom.get());
+        group->addChild(geode.get());
+    }
+    return group;
+}
+
+static osg::Node* create_merged_node(const compact_mesh& mesh) {
+
+    // Step-1: the shared arrays and the component id of every vertex, the vertices are welded per component
+    osg::ref_ptr<osg::Vec3Array> vertices;
+    osg::ref_ptr<osg::Vec3sArray> normals;
+    create_shared_arrays(mesh, vertices, normals);
+    osg::ref_ptr<osg::FloatArray> ids = new osg::FloatArray(vertices->size());
+    std::map<uint32_t, osg::ref_ptr<osg::DrawElementsUInt>> batches;     // by the packed color
+    for(const compact_component& component : mesh.components) {
+        uint32_t color;
+        std::memcpy(&color, component.color, 4);
+        osg::ref_ptr<osg::DrawElementsUInt>& batch = batches[color];
+        if(!batch.valid()) batch = new osg::DrawElementsUInt(GL_TRIANGLES);
+        auto first = mesh.triangles.begin() + 3 * component.first_face;
+        auto last = first + 3 * component.num_faces;
+        batch->insert(batch->end(), first, last);
+        for(auto it = first; it != last; ++it)
+            (*ids)[*it] = static_cast<float>(component.id);
+    }
+
+    // Step-2: a geometry for each color over the shared arrays
+    osg::Geode* geode = new osg::Geode;
+    for(auto& batch : batches) {
+        compact_component component;
+        std::memcpy(component.color, &batch.first, 4);
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray(vertices.get());
+        geom->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geom->setVertexAttribArray(component_id_attribute, ids.get(), osg::Array::BIND_PER_VERTEX);
+        geom->setStateSet(StateSetPool::Instance().Get(render_state(component_color(component))));
+        geom->addPrimitiveSet(batch.second.get());
+        geode->addDrawable(geom.get());
+    }
+    return geode;
+}
+
+osg::Node* create_merged_model(const std::vector<osg::Node*>& components) {
+
+    compact_mesh mesh;
+    compact_model_collector collector(mesh);
+    for(osg::Node* node : components)
+        node->accept(collector);
+    return create_merged_node(mesh);
+}
+
+bool write_model_file(osg::Node& model, const std::string& path, double max_error) {
+
+    std::string ext = osgDB::getLowerCaseFileExtension(path);
+    if(ext == "ply" || ext == "osgb")
+        return write_compact_model(model, path, max_error);
+    if(ext == "obj")
+        return write_textured_obj(model, path, max_error);
+    return osgDB::writeNodeFile(model, path);
+}
+
+bool write_compact_model(osg::Node& model, const std::string& path, double max_error) {
+
+    compact_mesh mesh;
+    compact_model_collector collector(mesh, max_error);
+    model.accept(collector);
+    if(mesh.triangles.empty()) {
+        std::cout << "ERROR: No triangles to export" << std::endl;
+        return false;
+    }
+    std::cout << "INFO: Exporting " << mesh.positions.size() / 3 << " vertices, " << mesh.triangles.size() / 3 << " triangles of "
+              << mesh.components.size() << " components" << std::endl;
+
+    if(osgDB::getLowerCaseFileExtension(path) == "ply")
+        return write_compact_ply(mesh, path);
+    osg::ref_ptr<osg::Node> node = create_compact_model_node(mesh);
+    return osgDB::writeNodeFile(*node, path);
+}
+
+osg::Node* read_compact_model(const std::string& path) {
+
+    // Step-1: map the file
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return nullptr;
+    const char* data = static_cast<const char*>(map);
+
+    // Step-2: the header must be the one written for the element counts, in the byte order of the host
+    osg::Node* node = nullptr;
+    const char* tag = "end_header\n";
+    const char* limit = data + std::min(size, max_header_size);
+    const char* header_end = std::search(data, limit, tag, tag + std::strlen(tag));
+    std::string header(data, (header_end == limit) ? data : header_end + std::strlen(tag));
+    size_t pv = header.find("element vertex "), pf = header.find("element face "), pc = header.find("element component ");
+    unsigned long num_vertices = 0, num_faces = 0, num_components = 0;
+    if(pv != std::string::npos && pf != std::string::npos && pc != std::string::npos &&
+       std::sscanf(header.c_str() + pv, "element vertex %lu", &num_vertices) == 1 &&
+       std::sscanf(header.c_str() + pf, "element face %lu", &num_faces) == 1 &&
+       std::sscanf(header.c_str() + pc, "element component %lu", &num_components) == 1 &&
+       header == compact_ply_header(num_vertices, num_faces, num_components, host_is_little_endian()) &&
+       size == header.size() + num_vertices * vertex_record_size + num_faces * face_record_size + num_components * component_record_size) {
+
+        // Step-3: vertices, faces and components
+        compact_mesh mesh;
+        mesh.positions.resize(3 * num_vertices);
+        mesh.normals.resize(3 * num_vertices);
+        mesh.triangles.resize(3 * num_faces);
+        mesh.components.resize(num_components);
+        const char* ptr = data + header.size();
+        for(size_t i = 0; i < num_vertices; ++i) {
+            std::memcpy(&mesh.positions[3 * i], ptr, 3 * sizeof(float));
+            std::memcpy(&mesh.normals[3 * i], ptr + 3 * sizeof(float), 3 * sizeof(int16_t));
+            ptr += vertex_record_size;
+        }
+        bool valid = true;
+        for(size_t i = 0; i < num_faces && valid; ++i) {
+            std::memcpy(&mesh.triangles[3 * i], ptr + 1, 3 * sizeof(uint32_t));
+            valid = (*ptr == 3) && mesh.triangles[3 * i] < num_vertices && mesh.triangles[3 * i + 1] < num_vertices &&
+                    mesh.triangles[3 * i + 2] < num_vertices;
+            ptr += face_record_size;
+        }
+        for(size_t i = 0; i < num_components && valid; ++i) {
+            compact_component& component = mesh.components[i];
+            std::memcpy(&component.id, ptr, sizeof(uint32_t));
+            std::memcpy(&component.first_face, ptr + 4, sizeof(uint32_t));
+            std::memcpy(&component.num_faces, ptr + 8, sizeof(uint32_t));
+            std::memcpy(component.color, ptr + 12, 4);
+            valid = static_cast<size_t>(component.first_face) + component.num_faces <= num_faces;
+            ptr += component_record_size;
+        }
+        // a corrupt file is left to the general reader for the error reporting
+        if(valid) node = create_compact_model_node(mesh);
+    }
+
+    munmap(map, size);
+    return node;
+}
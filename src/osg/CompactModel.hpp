@@ -0,0 +1,43 @@
+#ifndef COMPACT_MODEL_HPP
+#define COMPACT_MODEL_HPP
+
+#include <osg/Node>
+#include <string>
+#include <vector>
+
+// vertex attribute of the merged geometries, the component id of each vertex as a float
+static const unsigned int component_id_attribute = 6;
+
+/*
+ * Compact binary export of the modelled components.
+ *
+ * All the components are triangulated (independent of their rendering type, generalized
+ * cylinders are closed with caps) and merged into one vertex buffer in world coordinates.
+ * Equal vertices of a component are welded, normals are quantized to signed 16 bit integers.
+ * A PLY file holds the vertices, the triangles and a "component" element with the id, the face
+ * range and the color of every component; a .osgb file holds one geometry per component over
+ * the shared arrays. An OBJ file holds the modelled components with a material each, the baked
+ * textures of the generalized cylinders (see OsgTextureBaker) are written as PNG files next to it.
+ * Other extensions are written with osgDB as they are.
+ *
+ * A positive maximum error simplifies the exported surfaces within that distance (in the model
+ * coordinates): the generalized cylinders merge their sections and reduce their rings (see
+ * SectionSimplifier), the geometries without sections, e.g. of a merged or loaded model, are
+ * decimated (see MeshDecimator). The textured generalized cylinders and the primitives are exported
+ * as they are, as is the display of the frozen components.
+ *
+ * create_merged_model batches the components in memory the same way for the display of the frozen
+ * components (see OsgFrozenComponents).
+ *
+ * read_compact_model maps a PLY file that has exactly the layout written here (in the byte
+ * order of the host) and returns nullptr for any other file, which is then left to the general
+ * PLY reader.
+ */
+bool write_model_file(osg::Node& model, const std::string& path, double max_error = 0.0);
+bool write_compact_model(osg::Node& model, const std::string& path, double max_error = 0.0);
+osg::Node* read_compact_model(const std::string& path);
+// the triangles of the components merged as for the export, in the coordinates of the components'
+// parent: one geometry per color over shared arrays with the component ids as a vertex attribute
+osg::Node* create_merged_model(const std::vector<osg::Node*>& components);
+
+#endif // COMPACT_MODEL_HPP
@@ -0,0 +1,629 @@
+#include "ModelLoader.hpp"
+#include "CompactModel.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/MatrixTransform>
+#include <osgDB/FileNameUtils>
+#include <osgDB/ReadFile>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const size_t read_buffer_size = 1 << 22;
+static const size_t chunk_size = 1 << 20;          // vertices of a point cloud chunk, triangles of a mesh chunk
+static const size_t cancel_check_period = 1 << 16; // elements
+// the float vertices of a model farther from the origin are relative to its first vertex, the
+// spacing of the floats there is 1e-4 of a unit
+static const double local_origin_distance = 1024.0;
+
+enum class ply_format : unsigned char {
+    ascii,
+    binary_little_endian,
+    binary_big_endian
+};
+
+enum class ply_type : unsigned char {
+    invalid,
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    float32,
+    float64
+};
+
+struct ply_property {
+    std::string name;
+    ply_type type;          // type of the value or of the list entries
+    ply_type count_type;    // type of the list size
+    bool list;
+};
+
+struct ply_element {
+    std::string name;
+    size_t count;
+    std::vector<ply_property> properties;
+};
+
+static ply_type parse_ply_type(const std::string& str) {
+
+    if(str == "char"   || str == "int8")    return ply_type::int8;
+    if(str == "uchar"  || str == "uint8")   return ply_type::uint8;
+    if(str == "short"  || str == "int16")   return ply_type::int16;
+    if(str == "ushort" || str == "uint16")  return ply_type::uint16;
+    if(str == "int"    || str == "int32")   return ply_type::int32;
+    if(str == "uint"   || str == "uint32")  return ply_type::uint32;
+    if(str == "float"  || str == "float32") return ply_type::float32;
+    if(str == "double" || str == "float64") return ply_type::float64;
+    return ply_type::invalid;
+}
+
+static size_t ply_type_size(ply_type type) {
+
+    switch(type) {
+    case ply_type::int8:
+    case ply_type::uint8:   return 1;
+    case ply_type::int16:
+    case ply_type::uint16:  return 2;
+    case ply_type::int32:
+    case ply_type::uint32:
+    case ply_type::float32: return 4;
+    case ply_type::float64: return 8;
+    default:                return 0;
+    }
+}
+
+static bool host_is_little_endian() {
+
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+static bool parse_ply_header(std::istream& in, ply_format& format, std::vector<ply_element>& elements) {
+
+    std::string line;
+    if(!std::getline(in, line) || line.compare(0, 3, "ply") != 0) return false;
+
+    bool has_format = false;
+    while(std::getline(in, line)) {
+        if(!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        std::istringstream ss(line);
+        std::string keyword;
+        ss >> keyword;
+
+        if(keyword == "format") {
+            std::string str;
+            ss >> str;
+            if(str == "ascii")                     format = ply_format::ascii;
+            else if(str == "binary_little_endian") format = ply_format::binary_little_endian;
+            else if(str == "binary_big_endian")    format = ply_format::binary_big_endian;
+            else return false;
+            has_format = true;
+        }
+        else if(keyword == "element") {
+            ply_element element;
+            if(!(ss >> element.name >> element.count)) return false;
+            elements.push_back(element);
+        }
+        else if(keyword == "property") {
+            if(elements.empty()) return false;
+            ply_property property;
+            std::string type;
+            ss >> type;
+            if(type == "list") {
+                std::string count_type, value_type;
+                ss >> count_type >> value_type >> property.name;
+                property.list = true;
+                property.count_type = parse_ply_type(count_type);
+                property.type = parse_ply_type(value_type);
+                if(property.count_type == ply_type::invalid) return false;
+            }
+            else {
+                ss >> property.name;
+                property.list = false;
+                property.count_type = ply_type::invalid;
+                property.type = parse_ply_type(type);
+            }
+            if(property.type == ply_type::invalid) return false;
+            elements.back().properties.push_back(property);
+        }
+        else if(keyword == "end_header") {
+            return has_format;
+        }
+        // comments and obj_info lines are ignored
+    }
+    return false;
+}
+
+// buffered reader of the PLY body, counts the consumed bytes for the progress
+class ply_stream {
+public:
+    ply_stream(std::istream& in, ply_format format, std::atomic<unsigned long long>& bytes_read) :
+        m_in(in),
+        m_format(format),
+        m_swap(format != ply_format::ascii && (format == ply_format::binary_little_endian) != host_is_little_endian()),
+        m_bytes_read(bytes_read),
+        m_buffer(read_buffer_size),
+        m_pos(0),
+        m_len(0) { }
+
+    bool read(ply_type type, double& value) {
+
+        if(m_format == ply_format::ascii) return read_ascii(value);
+
+        unsigned char bytes[8];
+        size_t size = ply_type_size(type);
+        if(!read_bytes(bytes, size)) return false;
+        if(m_swap) std::reverse(bytes, bytes + size);
+
+        switch(type) {
+        case ply_type::int8:    { int8_t v;   std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::uint8:   { uint8_t v;  std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::int16:   { int16_t v;  std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::uint16:  { uint16_t v; std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::int32:   { int32_t v;  std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::uint32:  { uint32_t v; std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::float32: { float v;    std::memcpy(&v, bytes, size); value = v; break; }
+        case ply_type::float64: { double v;   std::memcpy(&v, bytes, size); value = v; break; }
+        default: return false;
+        }
+        return true;
+    }
+
+private:
+    std::istream& m_in;
+    ply_format m_format;
+    bool m_swap;
+    std::atomic<unsigned long long>& m_bytes_read;
+    std::vector<char> m_buffer;
+    size_t m_pos;
+    size_t m_len;
+
+    bool fill() {
+
+        m_in.read(m_buffer.data(), m_buffer.size());
+        m_len = static_cast<size_t>(m_in.gcount());
+        m_pos = 0;
+        m_bytes_read += m_len;
+        return m_len > 0;
+    }
+
+    bool get(char& c) {
+
+        if(m_pos == m_len && !fill()) return false;
+        c = m_buffer[m_pos++];
+        return true;
+    }
+
+    bool read_bytes(unsigned char* dst, size_t size) {
+
+        if(m_pos + size <= m_len) {
+            std::memcpy(dst, &m_buffer[m_pos], size);
+            m_pos += size;
+            return true;
+        }
+        char c;
+        for(size_t i = 0; i < size; ++i) {
+            if(!get(c)) return false;
+            dst[i] = static_cast<unsigned char>(c);
+        }
+        return true;
+    }
+
+    bool read_ascii(double& value) {
+
+        char c;
+        do {
+            if(!get(c)) return false;
+        } while(std::isspace(static_cast<unsigned char>(c)));
+
+        char token[64];
+        size_t len = 0;
+        do {
+            if(len < sizeof(token) - 1) token[len++] = c;
+        } while(get(c) && !std::isspace(static_cast<unsigned char>(c)));
+        token[len] = '\0';
+
+        char* end = nullptr;
+        value = std::strtod(token, &end);
+        return end != token;
+    }
+};
+
+// reads one element, the scalar values are stored by property index, the entries of the given list are appended
+static bool read_ply_element(ply_stream& stream, const ply_element& element, int list_property,
+                             std::vector<double>& values, std::vector<unsigned int>& list) {
+
+    values.resize(element.properties.size());
+    list.clear();
+    for(size_t i = 0; i < element.properties.size(); ++i) {
+        const ply_property& property = element.properties[i];
+        if(!property.list) {
+            if(!stream.read(property.type, values[i])) return false;
+            continue;
+        }
+
+        double count;
+        if(!stream.read(property.count_type, count) || count < 0) return false;
+        values[i] = count;
+        for(size_t k = 0; k < static_cast<size_t>(count); ++k) {
+            double value;
+            if(!stream.read(property.type, value)) return false;
+            if(static_cast<int>(i) == list_property) list.push_back(static_cast<unsigned int>(value));
+        }
+    }
+    return true;
+}
+
+static int find_ply_property(const ply_element& element, const std::string& name) {
+
+    for(size_t i = 0; i < element.properties.size(); ++i)
+        if(element.properties[i].name == name) return static_cast<int>(i);
+    return -1;
+}
+
+// the double matrix of the transform keeps the offset precise, the modelview of the chunk is composed
+// in double precision by the cull traversal
+static osg::Node* create_chunk(osg::Vec3Array* vertices, osg::Vec3Array* normals, osg::Vec4Array* colors, osg::PrimitiveSet* primitives,
+                               const osg::Vec3d& offset) {
+
+    osg::Geometry* geom = new osg::Geometry;
+    geom->setUseDisplayList(false);
+    geom->setUseVertexBufferObjects(true);
+    geom->setVertexArray(vertices);
+    if(normals) geom->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    if(colors) {
+        geom->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+    }
+    else {
+        osg::ref_ptr<osg::Vec4Array> color = new osg::Vec4Array;
+        color->push_back(osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        geom->setColorArray(color.get(), osg::Array::BIND_OVERALL);
+    }
+    geom->addPrimitiveSet(primitives);
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geom);
+    if(!normals) geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    if(offset == osg::Vec3d()) return geode;
+
+    osg::MatrixTransform* transform = new osg::MatrixTransform(osg::Matrixd::translate(offset));
+    transform->addChild(geode);
+    return transform;
+}
+
+ModelLoader::ModelLoader() :
+    m_running(false),
+    m_success(false),
+    m_build_kdtrees(true),
+    m_bytes_read(0),
+    m_file_size(0) { }
+
+ModelLoader::~ModelLoader() {
+
+    Cancel();
+    Join();
+}
+
+bool ModelLoader::Start(const std::string& path) {
+
+    if(m_running) {
+        std::cout << "ERROR: A model is already being loaded" << std::endl;
+        return false;
+    }
+    Join();
+
+    if(!std::ifstream(path.c_str()).good()) {
+        std::cout << "ERROR: Model file cannot be opened: " << path << std::endl;
+        return false;
+    }
+
+    m_cancel = CancellationToken();
+    m_success = false;
+    m_bytes_read = 0;
+    m_file_size = 0;
+    m_chunks.clear();
+    m_running = true;
+    // the job is not cancelled with the token, load has to run to reset m_running
+    m_job = ThreadPool::Instance().Submit([this, path](const CancellationToken&) {
+        load(path);
+        return true;
+    });
+    return true;
+}
+
+void ModelLoader::Cancel() {
+    m_cancel.Cancel();
+}
+
+bool ModelLoader::IsRunning() const {
+    return m_running;
+}
+
+bool ModelLoader::IsCancelled() const {
+    return m_cancel.IsCancelled();
+}
+
+bool ModelLoader::Succeeded() const {
+    return m_success;
+}
+
+float ModelLoader::GetProgress() const {
+
+    unsigned long long size = m_file_size;
+    if(size == 0) return -1.0f;
+    return std::min(1.0f, static_cast<float>(static_cast<double>(m_bytes_read) / size));
+}
+
+void ModelLoader::TakeChunks(std::vector<osg::ref_ptr<osg::Node>>& chunks) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    chunks.insert(chunks.end(), m_chunks.begin(), m_chunks.end());
+    m_chunks.clear();
+}
+
+void ModelLoader::SetBuildKdTrees(bool flag) {
+    m_build_kdtrees = flag;
+}
+
+void ModelLoader::Join() {
+
+    if(m_job.IsValid()) m_job.Wait();
+}
+
+void ModelLoader::load(const std::string& path) {
+
+    bool success = false;
+    if(osgDB::getLowerCaseFileExtension(path) == "ply") {
+        // the compact models are mapped and read in one piece, any other PLY file is streamed
+        osg::ref_ptr<osg::Node> node = read_compact_model(path);
+        success = node.valid() || load_ply(path);
+        if(node.valid() && !m_cancel.IsCancelled()) publish(node.get());
+    }
+    else {
+        // no progress for the osgDB plugins, a cancelled result is discarded
+        osg::ref_ptr<osg::Node> node = osgDB::readNodeFile(path);
+        success = node.valid();
+        if(success && !m_cancel.IsCancelled()) publish(node.get());
+    }
+    m_success = success && !m_cancel.IsCancelled();
+    m_running = false;
+}
+
+bool ModelLoader::load_ply(const std::string& path) {
+
+    // Step-1: header
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in) return false;
+    in.seekg(0, std::ios::end);
+    m_file_size = static_cast<unsigned long long>(in.tellg());
+    in.seekg(0, std::ios::beg);
+
+    ply_format format = ply_format::ascii;
+    std::vector<ply_element> elements;
+    if(!parse_ply_header(in, format, elements)) {
+        std::cout << "ERROR: Invalid PLY header: " << path << std::endl;
+        return false;
+    }
+    m_bytes_read = static_cast<unsigned long long>(in.tellg());
+    ply_stream stream(in, format, m_bytes_read);
+
+    bool has_faces = false;
+    for(const ply_element& element : elements)
+        if(element.name == "face" && element.count > 0) has_faces = true;
+
+    osg::ref_ptr<osg::Vec3Array> vertices;
+    osg::ref_ptr<osg::Vec3Array> normals;
+    osg::ref_ptr<osg::Vec4Array> colors;
+    osg::Vec3d offset;
+    std::vector<double> values;
+    std::vector<unsigned int> list;
+
+    for(const ply_element& element : elements) {
+
+        // Step-2: vertices, a point cloud is published chunk by chunk
+        if(element.name == "vertex") {
+            int ix = find_ply_property(element, "x"), iy = find_ply_property(element, "y"), iz = find_ply_property(element, "z");
+            int inx = find_ply_property(element, "nx"), iny = find_ply_property(element, "ny"), inz = find_ply_property(element, "nz");
+            int ir = find_ply_property(element, "red"), ig = find_ply_property(element, "green"), ib = find_ply_property(element, "blue");
+            int ia = find_ply_property(element, "alpha");
+            if(ix < 0 || iy < 0 || iz < 0) {
+                std::cout << "ERROR: PLY vertices without coordinates: " << path << std::endl;
+                return false;
+            }
+            bool has_normals = (inx >= 0 && iny >= 0 && inz >= 0);
+            bool has_colors = (ir >= 0 && ig >= 0 && ib >= 0);
+            double color_scale = (has_colors && element.properties[ir].type == ply_type::uint8) ? 1.0 / 255.0 : 1.0;
+            float normal_scale = 1.0f;
+            if(has_normals && element.properties[inx].type == ply_type::int8)  normal_scale = 1.0f / 127.0f;
+            if(has_normals && element.properties[inx].type == ply_type::int16) normal_scale = 1.0f / 32767.0f;
+            size_t reserve = has_faces ? element.count : std::min(element.count, chunk_size);
+
+            vertices = new osg::Vec3Array;
+            vertices->reserve(reserve);
+            if(has_normals) { normals = new osg::Vec3Array; normals->reserve(reserve); }
+            if(has_colors)  { colors = new osg::Vec4Array;  colors->reserve(reserve); }
+
+            for(size_t i = 0; i < element.count; ++i) {
+                if(i % cancel_check_period == 0 && m_cancel.IsCancelled()) return false;
+                if(!read_ply_element(stream, element, -1, values, list)) {
+                    std::cout << "ERROR: Unexpected end of the PLY file: " << path << std::endl;
+                    return false;
+                }
+                // the coordinates are converted to float once, relative to the offset
+                osg::Vec3d point(values[ix], values[iy], values[iz]);
+                if(i == 0 && point.length() > local_origin_distance) offset = point;
+                vertices->push_back(osg::Vec3(point - offset));
+                if(has_normals) normals->push_back(osg::Vec3(values[inx], values[iny], values[inz]) * normal_scale);
+                if(has_colors)  colors->push_back(osg::Vec4(values[ir] * color_scale, values[ig] * color_scale, values[ib] * color_scale,
+                                                            (ia >= 0) ? values[ia] * color_scale : 1.0));
+
+                if(!has_faces && vertices->size() == chunk_size) {
+                    publish(create_chunk(vertices.get(), normals.get(), colors.get(), new osg::DrawArrays(GL_POINTS, 0, vertices->size()), offset));
+                    vertices = new osg::Vec3Array;
+                    vertices->reserve(chunk_size);
+                    if(has_normals) { normals = new osg::Vec3Array; normals->reserve(chunk_size); }
+                    if(has_colors)  { colors = new osg::Vec4Array;  colors->reserve(chunk_size); }
+                }
+            }
+            if(!has_faces && !vertices->empty())
+                publish(create_chunk(vertices.get(), normals.get(), colors.get(), new osg::DrawArrays(GL_POINTS, 0, vertices->size()), offset));
+        }
+
+        // Step-3: faces, the chunks share the vertex arrays
+        else if(element.name == "face" && vertices.valid()) {
+            int il = find_ply_property(element, "vertex_indices");
+            if(il < 0) il = find_ply_property(element, "vertex_index");
+            if(il < 0 || !element.properties[il].list) {
+                std::cout << "ERROR: PLY faces without vertex indices: " << path << std::endl;
+                return false;
+            }
+
+            // without normals the chunks are held back until the normals are computed
+            bool compute_normals = !normals.valid();
+            if(compute_normals) normals = new osg::Vec3Array(vertices->size());
+            std::vector<osg::ref_ptr<osg::DrawElementsUInt>> pending;
+            osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+            const unsigned int num_vertices = static_cast<unsigned int>(vertices->size());
+
+            for(size_t i = 0; i < element.count; ++i) {
+                if(i % cancel_check_period == 0 && m_cancel.IsCancelled()) return false;
+                if(!read_ply_element(stream, element, il, values, list)) {
+                    std::cout << "ERROR: Unexpected end of the PLY file: " << path << std::endl;
+                    return false;
+                }
+                if(list.size() < 3 || *std::max_element(list.begin(), list.end()) >= num_vertices) continue;
+
+                // polygons are triangulated as fans
+                for(size_t k = 1; k + 1 < list.size(); ++k) {
+                    triangles->push_back(list[0]);
+                    triangles->push_back(list[k]);
+                    triangles->push_back(list[k + 1]);
+                    if(compute_normals) {
+                        const osg::Vec3& p0 = (*vertices)[list[0]];
+                        osg::Vec3 n = ((*vertices)[list[k]] - p0) ^ ((*vertices)[list[k + 1]] - p0);
+                        (*normals)[list[0]] += n;
+                        (*normals)[list[k]] += n;
+                        (*normals)[list[k + 1]] += n;
+                    }
+                }
+
+                if(triangles->size() >= 3 * chunk_size) {
+                    if(compute_normals) pending.push_back(triangles);
+                    else                publish(create_chunk(vertices.get(), normals.get(), colors.get(), triangles.get(), offset));
+                    triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+                }
+            }
+            if(!triangles->empty()) pending.push_back(triangles);
+
+            if(compute_normals)
+                for(size_t i = 0; i < normals->size(); ++i)
+                    (*normals)[i].normalize();
+            for(size_t i = 0; i < pending.size(); ++i)
+                publish(create_chunk(vertices.get(), normals.get(), colors.get(), pending[i].get(), offset));
+        }
+
+        // Step-4: other elements are skipped
+        else {
+            for(size_t i = 0; i < element.count; ++i) {
+                if(i % cancel_check_period == 0 && m_cancel.IsCancelled()) return false;
+                if(!read_ply_element(stream, element, -1, values, list)) {
+                    std::cout << "ERROR: Unexpected end of the PLY file: " << path << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    m_bytes_read = m_file_size.load();
+    return true;
+}
+
+bool ModelLoader::ReadPlyPoints(const std::string& path, const point_sink& sink, const CancellationToken& token,
+                                std::atomic<unsigned long long>& bytes_read, std::atomic<unsigned long long>& file_size) {
+
+    // Step-1: header
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in) return false;
+    in.seekg(0, std::ios::end);
+    file_size = static_cast<unsigned long long>(in.tellg());
+    in.seekg(0, std::ios::beg);
+
+    ply_format format = ply_format::ascii;
+    std::vector<ply_element> elements;
+    if(!parse_ply_header(in, format, elements)) {
+        std::cout << "ERROR: Invalid PLY header: " << path << std::endl;
+        return false;
+    }
+    bytes_read = static_cast<unsigned long long>(in.tellg());
+    ply_stream stream(in, format, bytes_read);
+    std::vector<double> values;
+    std::vector<unsigned int> list;
+
+    // Step-2: the vertices chunk by chunk, the elements after them are not read
+    for(const ply_element& element : elements) {
+        if(element.name != "vertex") {
+            for(size_t i = 0; i < element.count; ++i) {
+                if(i % cancel_check_period == 0 && token.IsCancelled()) return false;
+                if(!read_ply_element(stream, element, -1, values, list)) return false;
+            }
+            continue;
+        }
+
+        int ix = find_ply_property(element, "x"), iy = find_ply_property(element, "y"), iz = find_ply_property(element, "z");
+        int ir = find_ply_property(element, "red"), ig = find_ply_property(element, "green"), ib = find_ply_property(element, "blue");
+        if(ix < 0 || iy < 0 || iz < 0) {
+            std::cout << "ERROR: PLY vertices without coordinates: " << path << std::endl;
+            return false;
+        }
+        bool has_colors = (ir >= 0 && ig >= 0 && ib >= 0);
+        double color_scale = (has_colors && element.properties[ir].type != ply_type::uint8) ? 255.0 : 1.0;
+
+        osg::ref_ptr<osg::Vec3dArray> points = new osg::Vec3dArray;
+        osg::ref_ptr<osg::Vec4ubArray> colors = has_colors ? new osg::Vec4ubArray : nullptr;
+        points->reserve(std::min(element.count, chunk_size));
+        if(has_colors) colors->reserve(points->capacity());
+        for(size_t i = 0; i < element.count; ++i) {
+            if(i % cancel_check_period == 0 && token.IsCancelled()) return false;
+            if(!read_ply_element(stream, element, -1, values, list)) {
+                std::cout << "ERROR: Unexpected end of the PLY file: " << path << std::endl;
+                return false;
+            }
+            points->push_back(osg::Vec3d(values[ix], values[iy], values[iz]));
+            if(has_colors) {
+                auto channel = [&](int k) { return static_cast<unsigned char>(std::max(0.0, std::min(255.0, values[k] * color_scale))); };
+                colors->push_back(osg::Vec4ub(channel(ir), channel(ig), channel(ib), 255));
+            }
+            if(points->size() == chunk_size || i + 1 == element.count) {
+                if(!sink(*points, colors.get())) return false;
+                points->clear();
+                if(has_colors) colors->clear();
+            }
+        }
+        bytes_read = file_size.load();
+        return true;
+    }
+    std::cout << "ERROR: PLY file without vertices: " << path << std::endl;
+    return false;
+}
+
+void ModelLoader::publish(osg::Node* node) {
+
+    // the chunks are not modified after they are published, their kd-trees stay valid
+    if(m_build_kdtrees) {
+        osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+        node->accept(*builder);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunks.push_back(node);
+}
@@ -0,0 +1,67 @@
+#ifndef MODEL_LOADER_HPP
+#define MODEL_LOADER_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Array>
+#include <osg/Group>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Loads a model file on a worker of the shared thread pool.
+ *
+ * PLY files are parsed by a streaming reader (ascii and binary, little and big endian) that
+ * reports its progress and publishes the model in chunks: a point cloud chunk as soon as its
+ * vertices are read, a mesh chunk as soon as its faces are read (once all the vertices are
+ * known). Meshes without vertex normals are published at the end, after the normals are
+ * computed. Integer normals are scaled to unit length. The vertices are parsed in double precision
+ * and stored as floats; the vertices of a model far from the origin are relative to its first vertex,
+ * the chunks are under a transform of that offset. The compact models written by
+ * write_compact_model are mapped and read in one piece. Other formats are read with osgDB in
+ * one piece.
+ *
+ * The loading can be cancelled at any time; the chunks are collected on the UI thread with
+ * TakeChunks. The kd-trees of the chunks for the picking are built on the loading thread before
+ * they are published (see SetBuildKdTrees).
+ *
+ * ReadPlyPoints streams the vertices of a PLY file in double precision with the same reader, for
+ * the point clouds too large to be loaded (see PointCloudOctree).
+ */
+class ModelLoader {
+public:
+    ModelLoader();
+    ~ModelLoader();
+    bool Start(const std::string& path);
+    void Cancel();
+    bool IsRunning() const;
+    bool IsCancelled() const;
+    bool Succeeded() const;
+    float GetProgress() const;                                 // [0,1], or -1 if unknown
+    void TakeChunks(std::vector<osg::ref_ptr<osg::Node>>& chunks);
+    void SetBuildKdTrees(bool flag);
+    void Join();
+
+    // the sink receives the chunks of the points and their colors (null without colors), false stops the reading
+    typedef std::function<bool(const osg::Vec3dArray& points, const osg::Vec4ubArray* colors)> point_sink;
+    static bool ReadPlyPoints(const std::string& path, const point_sink& sink, const CancellationToken& token,
+                              std::atomic<unsigned long long>& bytes_read, std::atomic<unsigned long long>& file_size);
+private:
+    Job<bool> m_job;
+    CancellationToken m_cancel;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_success;
+    std::atomic<bool> m_build_kdtrees;
+    std::atomic<unsigned long long> m_bytes_read;
+    std::atomic<unsigned long long> m_file_size;               // 0 if the progress is unknown
+    std::mutex m_mutex;
+    std::vector<osg::ref_ptr<osg::Node>> m_chunks;             // published and not taken yet
+
+    void load(const std::string& path);
+    bool load_ply(const std::string& path);
+    void publish(osg::Node* node);
+};
+
+#endif // MODEL_LOADER_HPP
@@ -0,0 +1,173 @@
+#include "OsgColorIdPicker.hpp"
+
+#include <osg/PolygonMode>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+#include <osg/ValueObject>
+#include <algorithm>
+#include <set>
+
+// larger regions are rendered at a lower resolution
+static const int max_pick_size = 512;
+
+static const char* pick_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* pick_fragment_shader =
+    "#version 120\n"
+    "uniform vec4 pick_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = pick_color;\n"
+    "}\n";
+
+// the selectable nodes, their subgraphs are not traversed
+class selectable_node_collector : public osg::NodeVisitor {
+public:
+    selectable_node_collector(std::vector<osg::ref_ptr<osg::Node>>& nodes) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        m_nodes(nodes) {
+
+        setTraversalMask(~0x1);
+    }
+
+    void apply(osg::Node& node) override {
+
+        bool selection = false;
+        if(node.getUserValue("Selection", selection)) m_nodes.push_back(&node);
+        else traverse(node);
+    }
+private:
+    std::vector<osg::ref_ptr<osg::Node>>& m_nodes;
+};
+
+OsgColorIdPicker::OsgColorIdPicker() :
+    m_pick_root(new osg::Group),
+    m_image(new osg::Image),
+    m_drawn(new drawn_callback),
+    m_pending(false) {
+
+    create_camera();
+}
+
+osg::Camera* OsgColorIdPicker::GetPickCamera() {
+    return m_camera.get();
+}
+
+bool OsgColorIdPicker::IsPending() const {
+    return m_pending;
+}
+
+bool OsgColorIdPicker::Request(osg::Camera* cam, int x, int y, int width, int height) {
+
+    if(m_pending || cam->getViewport() == nullptr) return false;
+
+    // Step-1: a color for each selectable node, 0 is the background
+    m_nodes.clear();
+    m_pick_root->removeChildren(0, m_pick_root->getNumChildren());
+    selectable_node_collector collector(m_nodes);
+    cam->accept(collector);
+    if(m_nodes.empty()) return false;
+    for(size_t i = 0; i < m_nodes.size(); ++i) {
+        unsigned int id = static_cast<unsigned int>(i + 1);
+        osg::ref_ptr<osg::Group> group = new osg::Group;
+        group->getOrCreateStateSet()->addUniform(new osg::Uniform("pick_color",
+                osg::Vec4((id & 0xff) / 255.0f, ((id >> 8) & 0xff) / 255.0f, ((id >> 16) & 0xff) / 255.0f, 1.0f)));
+        group->addChild(m_nodes[i].get());
+        m_pick_root->addChild(group.get());
+    }
+
+    // Step-2: the projection of the main camera restricted to the region (in window coordinates)
+    const osg::Viewport* vp = cam->getViewport();
+    double x0 = std::max(static_cast<double>(std::min(x, x + width - 1)), vp->x());
+    double y0 = std::max(static_cast<double>(std::min(y, y + height - 1)), vp->y());
+    double x1 = std::min(static_cast<double>(std::max(x, x + width - 1)) + 1.0, vp->x() + vp->width());
+    double y1 = std::min(static_cast<double>(std::max(y, y + height - 1)) + 1.0, vp->y() + vp->height());
+    if(x1 <= x0 || y1 <= y0) return false;
+    double cx = 2.0 * (0.5 * (x0 + x1) - vp->x()) / vp->width() - 1.0;
+    double cy = 2.0 * (0.5 * (y0 + y1) - vp->y()) / vp->height() - 1.0;
+    osg::Matrixd pick = osg::Matrixd::translate(-cx, -cy, 0.0) * osg::Matrixd::scale(vp->width() / (x1 - x0), vp->height() / (y1 - y0), 1.0);
+    m_camera->setViewMatrix(cam->getViewMatrix());
+    m_camera->setProjectionMatrix(cam->getProjectionMatrix() * pick);
+
+    // Step-3: the region is rendered into an image of its size
+    int w = std::min(static_cast<int>(x1 - x0), max_pick_size);
+    int h = std::min(static_cast<int>(y1 - y0), max_pick_size);
+    if(m_image->s() != w || m_image->t() != h) {
+        m_image = new osg::Image;
+        m_image->allocateImage(w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        m_camera->detach(osg::Camera::COLOR_BUFFER);
+        m_camera->attach(osg::Camera::COLOR_BUFFER, m_image.get());
+        m_camera->dirtyAttachmentMap();
+    }
+    m_camera->setViewport(0, 0, w, h);
+
+    m_drawn->drawn = false;
+    m_camera->setNodeMask(~0x1);
+    m_pending = true;
+    return true;
+}
+
+bool OsgColorIdPicker::Collect(std::vector<osg::ref_ptr<osg::Node>>& nodes) {
+
+    if(!m_pending || !m_drawn->drawn) return false;
+
+    // Step-1: the ids in the region
+    std::set<unsigned int> ids;
+    const unsigned char* data = m_image->data();
+    size_t num_pixels = static_cast<size_t>(m_image->s()) * m_image->t();
+    for(size_t i = 0; i < num_pixels; ++i) {
+        const unsigned char* px = data + 4 * i;
+        unsigned int id = px[0] | (px[1] << 8) | (px[2] << 16);
+        if(id > 0 && id <= m_nodes.size()) ids.insert(id);
+    }
+    for(unsigned int id : ids)
+        nodes.push_back(m_nodes[id - 1]);
+
+    // Step-2: the pick camera is disabled until the next request
+    m_camera->setNodeMask(0);
+    m_pick_root->removeChildren(0, m_pick_root->getNumChildren());
+    m_nodes.clear();
+    m_pending = false;
+    return true;
+}
+
+void OsgColorIdPicker::create_camera() {
+
+    m_camera = new osg::Camera;
+    m_camera->setNodeMask(0);
+    m_camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    m_camera->setRenderOrder(osg::Camera::PRE_RENDER);
+    m_camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    m_camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    m_camera->setAllowEventFocus(false);
+    // the frozen components that the main camera skips are picked as well, the display only nodes
+    // (e.g. the normals with their protected program) are not
+    m_camera->setInheritanceMask(m_camera->getInheritanceMask() & ~osg::CullSettings::CULL_MASK);
+    m_camera->setCullMask(~0x1u);
+    m_camera->attach(osg::Camera::DEPTH_BUFFER, GL_DEPTH_COMPONENT24);
+    m_image->allocateImage(1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    m_camera->attach(osg::Camera::COLOR_BUFFER, m_image.get());
+    m_camera->setViewport(0, 0, 1, 1);
+    m_camera->setPostDrawCallback(m_drawn.get());
+    m_camera->addChild(m_pick_root.get());
+
+    // flat colors, the programs of the procedural geometries are protected and handle the picking themselves
+    osg::ref_ptr<osg::Program> program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, pick_vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, pick_fragment_shader));
+    osg::StateSet* ss = m_camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(program.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("picking", true), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    // filled polygons in every render mode, as the ray intersections
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_MULTISAMPLE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_DITHER, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+}
@@ -0,0 +1,47 @@
+#ifndef OSG_COLOR_ID_PICKER_HPP
+#define OSG_COLOR_ID_PICKER_HPP
+
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/Image>
+#include <atomic>
+#include <vector>
+
+/*
+ * Picking with an id buffer.
+ *
+ * A pre-render camera draws every selectable node (the nodes with a "Selection" user value)
+ * with a unique flat color into a framebuffer object. The projection of the pick camera is
+ * restricted to the picked window region and its viewport has the size of the region, so only
+ * the pixels that are read back are rendered and the culling discards everything outside of
+ * the region. The cost is independent of the number of triangles of the region and a rectangle
+ * costs as much as a single click.
+ *
+ * The pick is rendered with the next frame of the viewer and collected afterwards, Collect
+ * returns false until the draw thread has read the pixels back.
+ */
+class OsgColorIdPicker {
+public:
+    OsgColorIdPicker();
+    osg::Camera* GetPickCamera();
+    bool Request(osg::Camera* cam, int x, int y, int width = 1, int height = 1);
+    bool IsPending() const;
+    bool Collect(std::vector<osg::ref_ptr<osg::Node>>& nodes);
+private:
+    struct drawn_callback : public osg::Camera::DrawCallback {
+        mutable std::atomic<bool> drawn;
+        drawn_callback() : drawn(false) { }
+        void operator()(osg::RenderInfo& render_info) const override { drawn = true; }
+    };
+
+    osg::ref_ptr<osg::Camera> m_camera;
+    osg::ref_ptr<osg::Group> m_pick_root;                // a group for each node with its color
+    osg::ref_ptr<osg::Image> m_image;                    // read back pixels of the region
+    osg::ref_ptr<drawn_callback> m_drawn;
+    std::vector<osg::ref_ptr<osg::Node>> m_nodes;        // node of the color id i + 1
+    bool m_pending;
+
+    void create_camera();
+};
+
+#endif // OSG_COLOR_ID_PICKER_HPP
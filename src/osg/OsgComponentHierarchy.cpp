@@ -0,0 +1,184 @@
+#include "OsgComponentHierarchy.hpp"
+
+#include <osgUtil/CullVisitor>
+
+#include <unordered_set>
+
+class OsgComponentHierarchy::update_callback : public osg::NodeCallback {
+public:
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override {
+
+        static_cast<OsgComponentHierarchy*>(node)->synchronize();
+        traverse(node, nv);
+    }
+};
+
+OsgComponentHierarchy::OsgComponentHierarchy() :
+    m_root(-1),
+    m_synchronized(true) {
+
+    setUpdateCallback(new update_callback);
+}
+
+osg::BoundingSphere OsgComponentHierarchy::computeBound() const {
+
+    m_synchronized = false;
+    return osg::Group::computeBound();
+}
+
+void OsgComponentHierarchy::traverse(osg::NodeVisitor& nv) {
+
+    // the tree refers to the children of the last update, a changed group is traversed flat
+    if(nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR && m_root >= 0 && m_synchronized && _boundingSphereComputed)
+        traverse_tree(nv);
+    else
+        osg::Group::traverse(nv);
+    for(const osg::ref_ptr<osg::Node>& node : m_shared)
+        node->accept(nv);
+}
+
+void OsgComponentHierarchy::AddSharedNode(osg::Node* node) {
+    m_shared.push_back(node);
+}
+
+void OsgComponentHierarchy::traverse_tree(osg::NodeVisitor& nv) {
+
+    osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(&nv);
+    std::vector<int> stack(1, m_root);
+    stack.reserve(64);
+    while(!stack.empty()) {
+        const tree_node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        // Step-1: the subtrees outside of the frustum or below the small feature size are skipped
+        if(cv->isCulled(node.sphere)) continue;
+
+        // Step-2: the leaves are traversed as children of the group, the inner nodes are not part of the node path
+        if(node.child != nullptr) {
+            node.child->accept(nv);
+        }
+        else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+void OsgComponentHierarchy::synchronize() {
+
+    if(m_synchronized && _boundingSphereComputed) return;
+
+    // Step-1: the removed children are unlinked
+    std::unordered_set<const osg::Node*> children;
+    for(const osg::ref_ptr<osg::Node>& child : _children)
+        children.insert(child.get());
+    for(auto it = m_leaves.begin(); it != m_leaves.end(); ) {
+        if(children.count(it->first) == 0) {
+            remove_leaf(it->second);
+            it = m_leaves.erase(it);
+        }
+        else ++it;
+    }
+
+    // Step-2: the new children are inserted, the edited ones are refitted
+    for(const osg::ref_ptr<osg::Node>& child : _children) {
+        auto it = m_leaves.find(child.get());
+        if(it == m_leaves.end()) {
+            insert_leaf(child.get());
+            continue;
+        }
+        tree_node& leaf = m_nodes[it->second];
+        const osg::BoundingSphere& bs = child->getBound();
+        if(bs.center() != leaf.sphere.center() || bs.radius() != leaf.sphere.radius()) {
+            leaf.sphere = bs;
+            refit(leaf.parent);
+        }
+    }
+
+    getBound();
+    m_synchronized = true;
+}
+
+int OsgComponentHierarchy::allocate_node() {
+
+    if(!m_free.empty()) {
+        int index = m_free.back();
+        m_free.pop_back();
+        return index;
+    }
+    m_nodes.push_back(tree_node());
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void OsgComponentHierarchy::insert_leaf(osg::Node* child) {
+
+    int leaf = allocate_node();
+    tree_node& node = m_nodes[leaf];
+    node.sphere = child->getBound();
+    node.parent = node.left = node.right = -1;
+    node.child = child;
+    m_leaves[child] = leaf;
+    if(m_root < 0) {
+        m_root = leaf;
+        return;
+    }
+
+    // Step-1: descend into the child whose sphere grows the least
+    osg::BoundingSphere sphere = m_nodes[leaf].sphere;
+    int sibling = m_root;
+    while(m_nodes[sibling].child == nullptr) {
+        int left = m_nodes[sibling].left, right = m_nodes[sibling].right;
+        osg::BoundingSphere l = m_nodes[left].sphere, r = m_nodes[right].sphere;
+        l.expandBy(sphere);
+        r.expandBy(sphere);
+        float grow_l = l.radius() - m_nodes[left].sphere.radius();
+        float grow_r = r.radius() - m_nodes[right].sphere.radius();
+        sibling = (grow_l <= grow_r) ? left : right;
+    }
+
+    // Step-2: a new inner node replaces the sibling
+    int inner = allocate_node();
+    int parent = m_nodes[sibling].parent;
+    m_nodes[inner].parent = parent;
+    m_nodes[inner].left = sibling;
+    m_nodes[inner].right = leaf;
+    m_nodes[inner].child = nullptr;
+    m_nodes[sibling].parent = inner;
+    m_nodes[leaf].parent = inner;
+    if(parent < 0) m_root = inner;
+    else if(m_nodes[parent].left == sibling) m_nodes[parent].left = inner;
+    else m_nodes[parent].right = inner;
+    refit(inner);
+}
+
+void OsgComponentHierarchy::remove_leaf(int leaf) {
+
+    // the sibling takes the place of the parent
+    int parent = m_nodes[leaf].parent;
+    m_nodes[leaf].child = nullptr;
+    m_free.push_back(leaf);
+    if(parent < 0) {
+        m_root = -1;
+        return;
+    }
+    int sibling = (m_nodes[parent].left == leaf) ? m_nodes[parent].right : m_nodes[parent].left;
+    int grand_parent = m_nodes[parent].parent;
+    m_nodes[sibling].parent = grand_parent;
+    m_free.push_back(parent);
+    if(grand_parent < 0) {
+        m_root = sibling;
+        return;
+    }
+    if(m_nodes[grand_parent].left == parent) m_nodes[grand_parent].left = sibling;
+    else m_nodes[grand_parent].right = sibling;
+    refit(grand_parent);
+}
+
+void OsgComponentHierarchy::refit(int node) {
+
+    for(; node >= 0; node = m_nodes[node].parent) {
+        tree_node& inner = m_nodes[node];
+        inner.sphere = m_nodes[inner.left].sphere;
+        inner.sphere.expandBy(m_nodes[inner.right].sphere);
+    }
+}
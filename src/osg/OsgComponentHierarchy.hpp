@@ -0,0 +1,66 @@
+#ifndef OSG_COMPONENT_HIERARCHY_HPP
+#define OSG_COMPONENT_HIERARCHY_HPP
+
+#include <osg/Group>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Model group with a bounding volume hierarchy over its children for the cull traversal.
+ *
+ * The children stay a flat list of components: the frame, the selection and the solver add, find
+ * and remove them as with any group. Only the cull traversal differs: the cull visitor descends a
+ * binary tree of bounding spheres over the children and skips a whole subtree whose sphere is
+ * outside of the frustum or smaller than the small feature threshold of the camera, instead of
+ * testing every component. The other visitors traverse the flat list, the intersectors of the
+ * pickers work in the frame of the camera they are cloned for and already reject a missed component
+ * by its bounding sphere.
+ *
+ * The tree is updated incrementally by the update traversal, whenever adding, removing or editing
+ * a child has dirtied the bound of the group: a new child is inserted next to the subtree whose
+ * sphere grows the least, a removed one is unlinked and the spheres of the changed children are
+ * refitted up to the root. Until then the flat list is traversed.
+ *
+ * The shared nodes are drawn for several children at once, e.g. the batches of the instanced
+ * primitives (see PrimitiveInstances). They are not children, thus the frame, the selection and the
+ * solver never see them, but every visitor traverses them after the children and the passes that
+ * render the model draw them as well.
+ */
+class OsgComponentHierarchy : public osg::Group {
+public:
+    // components smaller than that many pixels are not drawn
+    static constexpr float small_feature_pixel_size = 2.0f;
+
+    OsgComponentHierarchy();
+    void traverse(osg::NodeVisitor& nv) override;
+    // any change of the children dirties the bound, the tree is synchronized by the next update traversal
+    osg::BoundingSphere computeBound() const override;
+    void AddSharedNode(osg::Node* node);
+
+private:
+    class update_callback;
+
+    struct tree_node {
+        osg::BoundingSphere sphere;
+        int parent;
+        int left, right;                        // -1 for the leaves
+        osg::Node* child;                       // the leaf child, owned by the group
+    };
+
+    std::vector<tree_node> m_nodes;
+    std::vector<int> m_free;                    // released node slots
+    std::unordered_map<const osg::Node*, int> m_leaves;
+    std::vector<osg::ref_ptr<osg::Node>> m_shared;
+    int m_root;
+    mutable std::atomic<bool> m_synchronized;
+
+    void synchronize();
+    void insert_leaf(osg::Node* child);
+    void remove_leaf(int leaf);
+    void refit(int node);
+    int allocate_node();
+    void traverse_tree(osg::NodeVisitor& nv);
+};
+
+#endif // OSG_COMPONENT_HIERARCHY_HPP
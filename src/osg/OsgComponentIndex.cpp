@@ -0,0 +1,83 @@
+#include "OsgComponentIndex.hpp"
+#include "../modeller/components/ComponentBase.hpp"
+
+#include <osg/Group>
+#include <algorithm>
+
+void OsgComponentIndex::Add(unsigned int component_id, osg::Node* node) {
+
+    // a component that is added again replaces its previous node
+    Remove(component_id);
+    component_entry& entry = m_entries[component_id];
+    entry.node = node;
+    entry.component = dynamic_cast<ComponentBase*>(node->asGroup());
+    entry.selection_box = -1;
+    m_ids[node] = component_id;
+}
+
+void OsgComponentIndex::Remove(unsigned int component_id) {
+
+    auto it = m_entries.find(component_id);
+    if(it == m_entries.end()) return;
+    m_ids.erase(it->second.node.get());
+    m_selected.erase(component_id);
+    m_entries.erase(it);
+}
+
+void OsgComponentIndex::Clear() {
+
+    m_entries.clear();
+    m_ids.clear();
+    m_selected.clear();
+}
+
+osg::Node* OsgComponentIndex::Find(unsigned int component_id) const {
+
+    auto it = m_entries.find(component_id);
+    return (it != m_entries.end()) ? it->second.node.get() : nullptr;
+}
+
+ComponentBase* OsgComponentIndex::FindComponent(unsigned int component_id) const {
+
+    auto it = m_entries.find(component_id);
+    return (it != m_entries.end()) ? it->second.component : nullptr;
+}
+
+bool OsgComponentIndex::FindComponentId(osg::Node* node, unsigned int& component_id) const {
+
+    // the picked drawables are a few levels below their components
+    while(node != nullptr) {
+        auto it = m_ids.find(node);
+        if(it != m_ids.end()) {
+            component_id = it->second;
+            return true;
+        }
+        node = (node->getNumParents() != 0) ? node->getParent(0) : nullptr;
+    }
+    return false;
+}
+
+void OsgComponentIndex::SetSelectionBox(unsigned int component_id, int selection_box) {
+
+    auto it = m_entries.find(component_id);
+    if(it == m_entries.end()) return;
+    it->second.selection_box = selection_box;
+    if(selection_box >= 0) m_selected.insert(component_id);
+    else                   m_selected.erase(component_id);
+}
+
+int OsgComponentIndex::GetSelectionBox(unsigned int component_id) const {
+
+    auto it = m_entries.find(component_id);
+    return (it != m_entries.end()) ? it->second.selection_box : -1;
+}
+
+void OsgComponentIndex::GetSelectedComponentIds(std::vector<unsigned int>& ids) const {
+
+    ids.insert(ids.end(), m_selected.begin(), m_selected.end());
+    std::sort(ids.end() - static_cast<long>(m_selected.size()), ids.end());
+}
+
+size_t OsgComponentIndex::Size() const {
+    return m_entries.size();
+}
@@ -0,0 +1,48 @@
+#ifndef OSG_COMPONENT_INDEX_HPP
+#define OSG_COMPONENT_INDEX_HPP
+
+#include <osg/Node>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class ComponentBase;
+
+/*
+ * Index of the selectable components of the model by component id.
+ *
+ * The frame used to find a component by looping over the children of the model and comparing their
+ * Component_Id user values, deleting the selected components was quadratic. The index keeps for every
+ * id the component node, the component registered to the solver (the same object, see
+ * OsgWxFrame::UsrAddSelectableComponent) and the selection box of the selection handler, and the set
+ * of the selected ids. The user values of the nodes are kept as well, the color id picker and the
+ * headless view use them.
+ */
+class OsgComponentIndex {
+public:
+    struct component_entry {
+        osg::ref_ptr<osg::Node> node;       // kept until the component is removed from the model
+        ComponentBase* component;           // component of the model solver
+        int selection_box;                  // child of the selection box switch, -1 if not selected
+    };
+
+    void Add(unsigned int component_id, osg::Node* node);
+    void Remove(unsigned int component_id);
+    void Clear();
+    osg::Node* Find(unsigned int component_id) const;
+    ComponentBase* FindComponent(unsigned int component_id) const;
+    // the component id of the node or of the nearest ancestor that is a component
+    bool FindComponentId(osg::Node* node, unsigned int& component_id) const;
+    void SetSelectionBox(unsigned int component_id, int selection_box);
+    int GetSelectionBox(unsigned int component_id) const;
+    // in increasing order of the ids
+    void GetSelectedComponentIds(std::vector<unsigned int>& ids) const;
+    size_t Size() const;
+
+private:
+    std::unordered_map<unsigned int, component_entry> m_entries;
+    std::unordered_map<const osg::Node*, unsigned int> m_ids;
+    std::unordered_set<unsigned int> m_selected;
+};
+
+#endif // OSG_COMPONENT_INDEX_HPP
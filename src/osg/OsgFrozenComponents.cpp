@@ -0,0 +1,77 @@
+#include "OsgFrozenComponents.hpp"
+#include "CompactModel.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+
+// the geometries of the merged node share their arrays, each has the indices of a color
+static size_t merged_byte_size(osg::Node* merged) {
+
+    osg::Geode* geode = merged ? merged->asGeode() : nullptr;
+    if(geode == nullptr || geode->getNumDrawables() == 0) return 0;
+    size_t bytes = 0;
+    const osg::Geometry* first = geode->getDrawable(0)->asGeometry();
+    if(first) {
+        if(first->getVertexArray()) bytes += first->getVertexArray()->getTotalDataSize();
+        if(first->getNormalArray()) bytes += first->getNormalArray()->getTotalDataSize();
+        for(unsigned int i = 0; i < first->getNumVertexAttribArrays(); ++i) {
+            if(first->getVertexAttribArray(i)) bytes += first->getVertexAttribArray(i)->getTotalDataSize();
+        }
+    }
+    for(unsigned int i = 0; i < geode->getNumDrawables(); ++i) {
+        const osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+        if(geometry == nullptr) continue;
+        for(unsigned int j = 0; j < geometry->getNumPrimitiveSets(); ++j)
+            bytes += geometry->getPrimitiveSet(j)->getTotalDataSize();
+    }
+    return bytes;
+}
+
+OsgFrozenComponents::OsgFrozenComponents(osg::Camera* main_camera, osg::Group* model) :
+    m_model(model),
+    m_memory(memory_category::geometry) {
+
+    main_camera->setCullMask(main_camera->getCullMask() & ~frozen_node_mask);
+}
+
+OsgFrozenComponents::~OsgFrozenComponents() {
+    Thaw();
+}
+
+void OsgFrozenComponents::Freeze(const std::vector<osg::Node*>& components) {
+
+    Thaw();
+    if(components.empty()) return;
+
+    // Step-1: the merged geometry in the frame of the model
+    m_merged = create_merged_model(components);
+    m_merged->setName("frozen_components");
+    m_merged->setDataVariance(osg::Object::STATIC);
+    m_merged->setNodeMask(0x1);
+    m_model->addChild(m_merged.get());
+    m_memory.Set(merged_byte_size(m_merged.get()));
+
+    // Step-2: the components are only drawn by the picking
+    for(osg::Node* node : components) {
+        node->setNodeMask(frozen_node_mask);
+        m_frozen.push_back(node);
+    }
+}
+
+void OsgFrozenComponents::Thaw() {
+
+    for(osg::ref_ptr<osg::Node>& node : m_frozen)
+        node->setNodeMask(~0u);
+    m_frozen.clear();
+    if(m_merged.valid()) m_model->removeChild(m_merged.get());
+    m_merged = nullptr;
+    m_memory.Set(0);
+}
+
+unsigned int OsgFrozenComponents::GetNumFrozen() const {
+    return static_cast<unsigned int>(m_frozen.size());
+}
+
+size_t OsgFrozenComponents::GetByteSize() const {
+    return m_memory.Get();
+}
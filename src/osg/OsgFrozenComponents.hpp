@@ -0,0 +1,48 @@
+#ifndef OSG_FROZEN_COMPONENTS_HPP
+#define OSG_FROZEN_COMPONENTS_HPP
+
+#include "../utility/MemoryRegistry.hpp"
+#include <osg/Camera>
+#include <osg/Group>
+#include <vector>
+
+/*
+ * Finished components drawn as merged static geometry.
+ *
+ * Every component is a chain of groups, geodes and geometries with primitive sets per section, a
+ * model of a thousand components is a thousand drawables with their own bounds and state. Freezing
+ * merges the triangles of the given components into one geometry per color over shared arrays (see
+ * create_merged_model), the vertex attribute component_id_attribute keeps the component of every
+ * vertex. The merged node is a child of the model, thus the passes that render the model (the
+ * reprojection error, the order independent transparency) draw it as well.
+ *
+ * The frozen components stay in the model with the node mask frozen_node_mask, which the main camera
+ * (and the cameras that inherit its cull mask) does not draw. The intersections and the id buffer of
+ * the picking still visit them and the selection, the export and the solver see the components as
+ * before; the merged node has the display only mask 0x1 and is skipped by all of them. A frozen
+ * component is not updated in the merged geometry: the components are thawed before they are edited,
+ * deleted or solved.
+ *
+ * The merged arrays are a second copy of the geometry of the components, reported to the
+ * MemoryRegistry; the owner thaws the components to release them over the memory budget.
+ */
+class OsgFrozenComponents {
+public:
+    static const unsigned int frozen_node_mask = 0x2;
+
+    OsgFrozenComponents(osg::Camera* main_camera, osg::Group* model);
+    ~OsgFrozenComponents();
+    // replaces the frozen components, the components must be children of the model
+    void Freeze(const std::vector<osg::Node*>& components);
+    void Thaw();
+    unsigned int GetNumFrozen() const;
+    // of the merged arrays and indices
+    size_t GetByteSize() const;
+private:
+    osg::ref_ptr<osg::Group> m_model;
+    osg::ref_ptr<osg::Node> m_merged;
+    std::vector<osg::ref_ptr<osg::Node>> m_frozen;
+    MemoryRegistry::Allocation m_memory;
+};
+
+#endif // OSG_FROZEN_COMPONENTS_HPP
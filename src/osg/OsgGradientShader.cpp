@@ -0,0 +1,113 @@
+#include "OsgGradientShader.hpp"
+
+#include <osg/Shader>
+#include <algorithm>
+
+// a gradient magnitude of 1/4 of the intensity range, a strong edge, is displayed white
+const float OsgGradientShader::default_gain = 4.0f;
+const float OsgGradientShader::default_edge_threshold = 0.25f;
+
+static const char* gradient_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* gradient_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D image;\n"
+    "uniform float gain;\n"
+    "uniform float edge_threshold;\n"
+    "uniform bool edges;\n"
+    "float intensity(vec2 uv) {\n"
+    "    vec3 c = texture2D(image, uv).rgb;\n"
+    "    return (c.r + c.g + c.b) / 3.0;\n"
+    "}\n"
+    "vec2 gradient(vec2 uv, vec2 dx, vec2 dy) {\n"
+    "    return 0.5 * vec2(intensity(uv + dx) - intensity(uv - dx), intensity(uv + dy) - intensity(uv - dy));\n"
+    "}\n"
+    "void main() {\n"
+    "    vec2 uv = gl_TexCoord[0].st;\n"
+    "    vec2 dx = dFdx(uv);\n"
+    "    vec2 dy = dFdy(uv);\n"
+    "    vec2 g = gradient(uv, dx, dy);\n"
+    "    float m = length(g);\n"
+    "    float v = clamp(m * gain, 0.0, 1.0);\n"
+    "    if(edges && m > 0.0 && v >= edge_threshold) {\n"
+    "        vec2 n = floor(g / m + 0.5);\n"
+    "        vec2 d = n.x * dx + n.y * dy;\n"
+    "        if(m >= length(gradient(uv + d, dx, dy)) && m > length(gradient(uv - d, dx, dy))) {\n"
+    "            gl_FragColor = vec4(1.0, 0.0, 0.0, 1.0);\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    gl_FragColor = vec4(v, v, v, 1.0);\n"
+    "}\n";
+
+OsgGradientShader::OsgGradientShader() :
+    m_program(new osg::Program),
+    m_image(new osg::Uniform("image", 0)),
+    m_gain(new osg::Uniform("gain", default_gain)),
+    m_edge_threshold(new osg::Uniform("edge_threshold", default_edge_threshold)),
+    m_edges(new osg::Uniform("edges", false)) {
+
+    m_program->addShader(new osg::Shader(osg::Shader::VERTEX, gradient_vertex_shader));
+    m_program->addShader(new osg::Shader(osg::Shader::FRAGMENT, gradient_fragment_shader));
+
+    // the parameters change while the image is displayed
+    m_gain->setDataVariance(osg::Object::DYNAMIC);
+    m_edge_threshold->setDataVariance(osg::Object::DYNAMIC);
+    m_edges->setDataVariance(osg::Object::DYNAMIC);
+}
+
+void OsgGradientShader::Apply(osg::StateSet* stateset) {
+
+    stateset->setAttributeAndModes(m_program.get(), osg::StateAttribute::ON);
+    stateset->addUniform(m_image.get());
+    stateset->addUniform(m_gain.get());
+    stateset->addUniform(m_edge_threshold.get());
+    stateset->addUniform(m_edges.get());
+}
+
+void OsgGradientShader::Remove(osg::StateSet* stateset) {
+
+    stateset->removeAttribute(m_program.get());
+    stateset->removeUniform(m_image.get());
+    stateset->removeUniform(m_gain.get());
+    stateset->removeUniform(m_edge_threshold.get());
+    stateset->removeUniform(m_edges.get());
+}
+
+void OsgGradientShader::SetGain(float gain) {
+    m_gain->set(std::max(gain, 0.0f));
+}
+
+float OsgGradientShader::GetGain() const {
+
+    float gain = 0.0f;
+    m_gain->get(gain);
+    return gain;
+}
+
+void OsgGradientShader::SetEdgeThreshold(float threshold) {
+    m_edge_threshold->set(std::min(std::max(threshold, 0.0f), 1.0f));
+}
+
+float OsgGradientShader::GetEdgeThreshold() const {
+
+    float threshold = 0.0f;
+    m_edge_threshold->get(threshold);
+    return threshold;
+}
+
+void OsgGradientShader::SetEdgeDisplay(bool flag) {
+    m_edges->set(flag);
+}
+
+bool OsgGradientShader::IsEdgeDisplay() const {
+
+    bool flag = false;
+    m_edges->get(flag);
+    return flag;
+}
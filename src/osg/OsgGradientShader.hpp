@@ -0,0 +1,47 @@
+#ifndef OSG_GRADIENT_SHADER_HPP
+#define OSG_GRADIENT_SHADER_HPP
+
+#include <osg/Program>
+#include <osg/StateSet>
+#include <osg/Uniform>
+
+/*
+ * Gradient display of the background image computed by a fragment shader from the texture already
+ * uploaded for the image, no gradient image is read or uploaded.
+ *
+ * The intensity is the mean of the color channels and the gradient its central differences, as the
+ * gradient of GradientMagnitudeImage. The neighbours are sampled one displayed pixel apart (the screen
+ * space derivatives of the texture coordinates), thus a texel for the image displayed in its size,
+ * also for the tiles of OsgTiledImage. The magnitude is scaled by the gain instead of the maximum of
+ * the whole image. The edges are the local maxima of the magnitude along the gradient direction above
+ * the edge threshold, drawn in red over the gradient.
+ *
+ * The uniforms are shared by the state sets the shader is applied to, the parameters take effect with
+ * the next frame. The draw thread may still read the uniforms of the last frame: they are dynamic, and
+ * they are set and the shader applied or removed by the update traversal, see
+ * OsgWxFrame::UsrEnqueueSceneUpdate.
+ */
+class OsgGradientShader {
+public:
+    static const float default_gain;
+    static const float default_edge_threshold;
+    OsgGradientShader();
+    // the texture of the image is the one of unit 0
+    void Apply(osg::StateSet* stateset);
+    void Remove(osg::StateSet* stateset);
+    void SetGain(float gain);
+    float GetGain() const;
+    // in [0, 1], the scaled magnitude of the weakest edge
+    void SetEdgeThreshold(float threshold);
+    float GetEdgeThreshold() const;
+    void SetEdgeDisplay(bool flag);
+    bool IsEdgeDisplay() const;
+private:
+    osg::ref_ptr<osg::Program> m_program;
+    osg::ref_ptr<osg::Uniform> m_image;
+    osg::ref_ptr<osg::Uniform> m_gain;
+    osg::ref_ptr<osg::Uniform> m_edge_threshold;
+    osg::ref_ptr<osg::Uniform> m_edges;
+};
+
+#endif // OSG_GRADIENT_SHADER_HPP
@@ -0,0 +1,270 @@
+#include "OsgOffscreenRenderer.hpp"
+#include "OsgUtility.hpp"
+#include "../modeller/ProjectionParameters.hpp"
+
+#include <osg/BufferObject>
+#include <osg/GLExtensions>
+#include <osg/GraphicsContext>
+#include <osgDB/WriteFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+/*
+ * Final draw callback of the background camera, the last one drawn: the read of the frame into a
+ * pixel buffer object does not wait for the draw to complete, the pixel buffer object read in the
+ * frame before is mapped instead. A frame without a target only maps the last read.
+ */
+class OsgOffscreenRenderer::readback_callback : public osg::Camera::DrawCallback {
+public:
+    explicit readback_callback(int max_size) : m_max_size(max_size), m_index(0) {
+        m_pbo[0] = m_pbo[1] = 0;
+    }
+
+    // the target of the next frame, set by the render thread between the frames
+    void SetTarget(const readback_target& target) { m_next = target; }
+    void SetDelivery(std::function<void(osg::ref_ptr<osg::Image>, const std::string&)> deliver) { m_deliver = deliver; }
+
+    void operator()(osg::RenderInfo& render_info) const override {
+
+        osg::GLExtensions* ext = render_info.getState()->get<osg::GLExtensions>();
+        if(m_pbo[0] == 0) {
+            ext->glGenBuffers(2, m_pbo);
+            for(int i = 0; i < 2; ++i) {
+                ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, m_pbo[i]);
+                ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, static_cast<GLsizeiptr>(m_max_size) * m_max_size * 4, nullptr, GL_STREAM_READ_ARB);
+            }
+        }
+
+        // Step-1: the read of this frame into the current buffer
+        if(!m_next.output_path.empty()) {
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, m_pbo[m_index]);
+            glReadBuffer(GL_FRONT);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, m_next.width, m_next.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        m_pending[m_index] = m_next;
+        m_next = readback_target();
+
+        // Step-2: the frame before is copied out of the other buffer
+        int other = 1 - m_index;
+        const readback_target& done = m_pending[other];
+        if(!done.output_path.empty()) {
+            ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, m_pbo[other]);
+            const void* pixels = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+            if(pixels != nullptr) {
+                osg::ref_ptr<osg::Image> image = new osg::Image;
+                image->allocateImage(done.width, done.height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+                std::memcpy(image->data(), pixels, static_cast<size_t>(done.width) * done.height * 4);
+                ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+                if(m_deliver) m_deliver(image, done.output_path);
+            }
+            else {
+                std::cout << "ERROR: Thumbnail cannot be read back: " << done.output_path << std::endl;
+            }
+            m_pending[other] = readback_target();
+        }
+        ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+        m_index = other;
+    }
+
+    bool HasPending() const {
+        return !m_pending[0].output_path.empty() || !m_pending[1].output_path.empty();
+    }
+
+private:
+    int m_max_size;
+    mutable GLuint m_pbo[2];
+    mutable int m_index;
+    mutable readback_target m_next;
+    mutable readback_target m_pending[2];
+    std::function<void(osg::ref_ptr<osg::Image>, const std::string&)> m_deliver;
+};
+
+OsgOffscreenRenderer::OsgOffscreenRenderer(int max_size) :
+    m_max_size(std::max(max_size, 16)),
+    m_started(false),
+    m_stopping(false),
+    m_num_written(0),
+    m_bg_width(0),
+    m_bg_height(0) { }
+
+OsgOffscreenRenderer::~OsgOffscreenRenderer() {
+    Finish();
+}
+
+bool OsgOffscreenRenderer::Start() {
+
+    if(m_started) return true;
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    m_stopping = false;
+    m_thread = std::thread([this, &started]() { run(started); });
+    m_started = result.get();
+    if(!m_started) m_thread.join();
+    return m_started;
+}
+
+void OsgOffscreenRenderer::Submit(osg::Node* model, const std::string& image_path, const ProjectionParameters& pp, const std::string& output_path) {
+
+    render_request request;
+    request.model = model;
+    request.image_path = image_path;
+    request.fovy = pp.fovy;
+    request.near = pp.near;
+    request.far = pp.far;
+    request.output_path = output_path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(request);
+    }
+    m_cv.notify_one();
+}
+
+unsigned int OsgOffscreenRenderer::Finish() {
+
+    if(m_started) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+        m_started = false;
+    }
+
+    // the writes of the last thumbnails
+    std::vector<Job<bool>> writes;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        writes.swap(m_writes);
+    }
+    for(const Job<bool>& job : writes)
+        if(job.Get()) ++m_num_written;
+    return m_num_written;
+}
+
+void OsgOffscreenRenderer::run(std::promise<bool>& started) {
+
+    // the context is current on this thread only
+    bool created = create_viewer();
+    started.set_value(created);
+    if(!created) return;
+
+    std::deque<render_request> batch;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_requests.empty() || m_stopping; });
+            if(m_requests.empty()) break;
+            batch.swap(m_requests);
+        }
+
+        // every request waiting is rendered before the next wait, one frame each
+        for(const render_request& request : batch)
+            render(request);
+        batch.clear();
+    }
+
+    // a frame of the last background without a target maps the last read
+    if(m_readback->HasPending() && m_bgcam.valid()) {
+        m_root->removeChildren(0, m_root->getNumChildren());
+        m_root->addChild(m_bgcam.get());
+        m_viewer->frame();
+    }
+    m_viewer = nullptr;
+}
+
+bool OsgOffscreenRenderer::create_viewer() {
+
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+    traits->readDISPLAY();
+    traits->setUndefinedScreenDetailsToDefaultScreen();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = m_max_size;
+    traits->height = m_max_size;
+    traits->red = traits->green = traits->blue = traits->alpha = 8;
+    traits->depth = 24;
+    traits->windowDecoration = false;
+    traits->doubleBuffer = false;
+    traits->pbuffer = true;
+    osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if(!gc.valid()) {
+        std::cout << "ERROR: Offscreen graphics context cannot be created" << std::endl;
+        return false;
+    }
+
+    m_root = new osg::Group;
+    m_readback = new readback_callback(m_max_size);
+    m_readback->SetDelivery([this](osg::ref_ptr<osg::Image> image, const std::string& path) { write(image, path); });
+
+    m_viewer = new osgViewer::Viewer;
+    m_viewer->setThreadingModel(osgViewer::ViewerBase::SingleThreaded);
+    m_viewer->setLightingMode(osg::View::HEADLIGHT);
+    osg::Camera* camera = m_viewer->getCamera();
+    camera->setGraphicsContext(gc.get());
+    camera->setViewport(0, 0, m_max_size, m_max_size);
+    camera->setDrawBuffer(GL_FRONT);
+    camera->setReadBuffer(GL_FRONT);
+    camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setViewMatrix(osg::Matrixd::identity());
+    m_viewer->setSceneData(m_root.get());
+    m_viewer->realize();
+    return m_viewer->isRealized();
+}
+
+void OsgOffscreenRenderer::render(const render_request& request) {
+
+    if(!set_background(request.image_path)) return;
+
+    // Step-1: the thumbnail has the aspect ratio of the image
+    double scale = std::min(1.0, static_cast<double>(m_max_size) / std::max(m_bg_width, m_bg_height));
+    int width = std::max(1, static_cast<int>(std::lround(m_bg_width * scale)));
+    int height = std::max(1, static_cast<int>(std::lround(m_bg_height * scale)));
+    osg::Camera* camera = m_viewer->getCamera();
+    camera->setViewport(0, 0, width, height);
+    camera->setProjectionMatrixAsPerspective(request.fovy, static_cast<double>(m_bg_width) / m_bg_height, request.near, request.far);
+    m_bgcam->setViewport(0, 0, width, height);
+
+    // Step-2: the model of the previous request is released by this frame
+    m_root->removeChildren(0, m_root->getNumChildren());
+    m_root->addChild(request.model.get());
+    m_root->addChild(m_bgcam.get());
+
+    readback_target target;
+    target.output_path = request.output_path;
+    target.width = width;
+    target.height = height;
+    m_readback->SetTarget(target);
+    m_viewer->frame();
+}
+
+bool OsgOffscreenRenderer::set_background(const std::string& image_path) {
+
+    // consecutive models of the same image share the quad
+    if(m_bgcam.valid() && image_path == m_bg_path) return true;
+    osg::ref_ptr<osg::Image> image = read_image(image_path, true);
+    if(!image.valid()) {
+        std::cout << "ERROR: Image of the thumbnail cannot be read: " << image_path << std::endl;
+        return false;
+    }
+    osg::Geode* quad = create_textured_quad(image.get(), m_bg_width, m_bg_height);
+    m_bgcam = create_background_camera(0, m_bg_width, 0, m_bg_height);
+    m_bgcam->addChild(quad);
+    m_bgcam->setFinalDrawCallback(m_readback.get());
+    m_bg_path = image_path;
+    return true;
+}
+
+void OsgOffscreenRenderer::write(osg::ref_ptr<osg::Image> image, const std::string& output_path) {
+
+    Job<bool> job = ThreadPool::Instance().Submit([image, output_path](const CancellationToken&) {
+        bool written = osgDB::writeImageFile(*image, output_path);
+        if(!written) std::cout << "ERROR: Thumbnail cannot be written: " << output_path << std::endl;
+        return written;
+    });
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writes.push_back(job);
+}
@@ -0,0 +1,90 @@
+#ifndef OSG_OFFSCREEN_RENDERER_HPP
+#define OSG_OFFSCREEN_RENDERER_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Camera>
+#include <osg/Image>
+#include <osg/Node>
+#include <osgViewer/Viewer>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProjectionParameters;
+
+/*
+ * Thumbnails of the models over their source images, rendered without a window, e.g. for the
+ * quality checks of the models of cvm_batch.
+ *
+ * The renderer owns a pbuffer graphics context of the windowing system OpenSceneGraph is built
+ * for (a GLX pbuffer, or an EGL one for the headless builds) and a single threaded viewer on its
+ * render thread. The submitted models are queued and rendered one frame each on the same context,
+ * the background quad is kept for the models of the same image. A thumbnail has the aspect ratio
+ * of the image and the given maximum size; the model is rendered with the camera of the modelling
+ * (identity view, perspective of the projection parameters) and the image behind it as in the GUI.
+ *
+ * The frames are read back asynchronously: the final draw callback starts the read of the frame
+ * into one of two pixel buffer objects and maps the other one, the frame before, which is complete
+ * by then. The thumbnail files are written on the thread pool.
+ */
+class OsgOffscreenRenderer {
+public:
+    static const int default_thumbnail_size = 512;
+
+    explicit OsgOffscreenRenderer(int max_size = default_thumbnail_size);
+    ~OsgOffscreenRenderer();
+
+    // creates the context on the render thread, false if there is no offscreen context
+    bool Start();
+    // the model is rendered over the image and written to the output file, the model must not be
+    // modified later
+    void Submit(osg::Node* model, const std::string& image_path, const ProjectionParameters& pp, const std::string& output_path);
+    // waits until every submitted thumbnail is written and stops the render thread, the number of
+    // the written thumbnails
+    unsigned int Finish();
+
+private:
+    struct render_request {
+        osg::ref_ptr<osg::Node> model;
+        std::string image_path;
+        double fovy, near, far;
+        std::string output_path;
+    };
+
+    struct readback_target {
+        std::string output_path;
+        int width, height;
+        readback_target() : width(0), height(0) { }
+    };
+
+    class readback_callback;
+
+    int m_max_size;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<render_request> m_requests;
+    bool m_started, m_stopping;
+    std::vector<Job<bool>> m_writes;
+    unsigned int m_num_written;
+
+    // owned by the render thread
+    osg::ref_ptr<osgViewer::Viewer> m_viewer;
+    osg::ref_ptr<osg::Group> m_root;
+    osg::ref_ptr<osg::Camera> m_bgcam;
+    osg::ref_ptr<readback_callback> m_readback;
+    std::string m_bg_path;
+    int m_bg_width, m_bg_height;
+
+    void run(std::promise<bool>& started);
+    bool create_viewer();
+    void render(const render_request& request);
+    bool set_background(const std::string& image_path);
+    void write(osg::ref_ptr<osg::Image> image, const std::string& output_path);
+};
+
+#endif // OSG_OFFSCREEN_RENDERER_HPP
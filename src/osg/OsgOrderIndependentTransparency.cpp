@@ -0,0 +1,200 @@
+#include "OsgOrderIndependentTransparency.hpp"
+
+#include <osg/BlendFunc>
+#include <osg/BlendFunci>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PolygonMode>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+#include <osgUtil/CullVisitor>
+
+// diffuse shading as the sweep program of the generalized cylinders, the color of the shared state
+// of the component (see StateSetPool) or the vertex color of the other geometries (alpha < 0)
+static const char* accumulation_vertex_shader =
+    "#version 120\n"
+    "uniform vec4 component_color;\n"
+    "void main() {\n"
+    "    vec4 color = (component_color.a < 0.0) ? gl_Color : component_color;\n"
+    "    vec3 n = normalize(gl_NormalMatrix * gl_Normal);\n"
+    "    vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+    "    float diffuse = abs(dot(n, l));\n"
+    "    gl_FrontColor = vec4(color.rgb * (0.2 + 0.8 * diffuse), color.a);\n"
+    "    gl_BackColor = gl_FrontColor;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+// the weight of McGuire and Bavoil, the nearer and the more opaque fragments dominate the average
+static const char* accumulation_fragment_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    float a = gl_Color.a;\n"
+    "    float d = 1.0 - 0.9 * gl_FragCoord.z;\n"
+    "    float w = clamp(pow(min(1.0, 10.0 * a) + 0.01, 3.0) * 1e8 * d * d * d, 1e-2, 3e3);\n"
+    "    gl_FragData[0] = vec4(gl_Color.rgb * a, a) * w;\n"
+    "    gl_FragData[1] = vec4(a);\n"
+    "}\n";
+
+static const char* quad_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* composite_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D accumulation;\n"
+    "uniform sampler2D coverage;\n"
+    "void main() {\n"
+    "    float c = texture2D(coverage, gl_TexCoord[0].st).r;\n"
+    "    if(c <= 0.0) discard;\n"
+    "    vec4 accum = texture2D(accumulation, gl_TexCoord[0].st);\n"
+    "    gl_FragColor = vec4(accum.rgb / clamp(accum.a, 1e-4, 5e4), c);\n"
+    "}\n";
+
+static osg::Program* create_program(const char* vertex_shader, const char* fragment_shader) {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragment_shader));
+    return program;
+}
+
+static osg::Texture2D* create_target(int width, int height) {
+
+    osg::Texture2D* texture = new osg::Texture2D;
+    texture->setTextureSize(width, height);
+    texture->setInternalFormat(GL_RGBA16F_ARB);
+    texture->setSourceFormat(GL_RGBA);
+    texture->setSourceType(GL_FLOAT);
+    texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    texture->setResizeNonPowerOfTwoHint(false);
+    return texture;
+}
+
+// traverses the model for every camera but the main one
+class OsgOrderIndependentTransparency::model_cull_callback : public osg::NodeCallback {
+public:
+    explicit model_cull_callback(osg::Camera* main_camera) : m_main_camera(main_camera) { }
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override {
+
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+        if(cv != nullptr && cv->getCurrentCamera() == m_main_camera.get()) return;
+        traverse(node, nv);
+    }
+private:
+    osg::observer_ptr<osg::Camera> m_main_camera;
+};
+
+OsgOrderIndependentTransparency::OsgOrderIndependentTransparency() :
+    m_root(new osg::Switch),
+    m_width(0),
+    m_height(0) {
+
+    m_root->setCullingActive(false);
+    m_root->setNodeMask(0x1);
+}
+
+osg::Node* OsgOrderIndependentTransparency::GetRoot() {
+    return m_root.get();
+}
+
+void OsgOrderIndependentTransparency::Initialize(osg::Camera* main_camera, osg::Group* model, int width, int height) {
+
+    // the previous model is drawn by the main camera again
+    SetEnabled(false);
+    m_root->removeChildren(0, m_root->getNumChildren());
+    m_width = width;
+    m_height = height;
+    m_model = model;
+    m_cull_callback = new model_cull_callback(main_camera);
+
+    create_accumulation_camera(model);
+    create_composite_camera();
+    SetEnabled(false);
+}
+
+void OsgOrderIndependentTransparency::SetEnabled(bool flag) {
+
+    if(flag) m_root->setAllChildrenOn();
+    else     m_root->setAllChildrenOff();
+    if(m_model.valid()) m_model->setCullCallback(flag ? m_cull_callback.get() : nullptr);
+}
+
+bool OsgOrderIndependentTransparency::IsEnabled() const {
+    return m_root->getNumChildren() > 0 && m_root->getValue(0);
+}
+
+void OsgOrderIndependentTransparency::create_accumulation_camera(osg::Group* model) {
+
+    m_accumulation = create_target(m_width, m_height);
+    m_coverage = create_target(m_width, m_height);
+
+    // relative to the main camera with identity matrices: the view and the projection of the main camera
+    m_accumulation_camera = new osg::Camera;
+    m_accumulation_camera->setReferenceFrame(osg::Transform::RELATIVE_RF);
+    m_accumulation_camera->setViewMatrix(osg::Matrix::identity());
+    m_accumulation_camera->setProjectionMatrix(osg::Matrix::identity());
+    m_accumulation_camera->setRenderOrder(osg::Camera::PRE_RENDER, 0);
+    m_accumulation_camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    m_accumulation_camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_accumulation_camera->setClearMask(GL_COLOR_BUFFER_BIT);
+    m_accumulation_camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    m_accumulation_camera->setViewport(0, 0, m_width, m_height);
+    m_accumulation_camera->setAllowEventFocus(false);
+    m_accumulation_camera->attach(osg::Camera::COLOR_BUFFER0, m_accumulation.get());
+    m_accumulation_camera->attach(osg::Camera::COLOR_BUFFER1, m_coverage.get());
+    m_accumulation_camera->addChild(model);
+
+    // one unsorted pass: the blending of the two targets commutes, the protected sweep programs
+    // of the procedural geometries write the same targets for the oit uniform
+    osg::StateSet* ss = m_accumulation_camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(create_program(accumulation_vertex_shader, accumulation_fragment_shader), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("oit", true), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("component_color", osg::Vec4(0.0f, 0.0f, 0.0f, -1.0f)));
+    ss->setAttributeAndModes(new osg::BlendFunci(0, GL_ONE, GL_ONE), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setAttributeAndModes(new osg::BlendFunci(1, GL_ONE, GL_ONE_MINUS_SRC_COLOR), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_BLEND, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_MULTISAMPLE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setRenderBinDetails(0, "RenderBin", osg::StateSet::OVERRIDE_RENDERBIN_DETAILS);
+    m_root->addChild(m_accumulation_camera.get());
+}
+
+void OsgOrderIndependentTransparency::create_composite_camera() {
+
+    // after the background camera, blended over the image
+    m_composite_camera = new osg::Camera;
+    m_composite_camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    m_composite_camera->setProjectionMatrix(osg::Matrix::ortho2D(0.0, 1.0, 0.0, 1.0));
+    m_composite_camera->setViewMatrix(osg::Matrix::identity());
+    m_composite_camera->setViewport(0, 0, m_width, m_height);
+    m_composite_camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    m_composite_camera->setRenderOrder(osg::Camera::POST_RENDER, 1);
+    m_composite_camera->setClearMask(0);
+    m_composite_camera->setCullingActive(false);
+    m_composite_camera->setAllowEventFocus(false);
+
+    osg::ref_ptr<osg::Geode> quad = new osg::Geode;
+    quad->addDrawable(osg::createTexturedQuadGeometry(osg::Vec3(0.0f, 0.0f, 0.0f), osg::Vec3(1.0f, 0.0f, 0.0f), osg::Vec3(0.0f, 1.0f, 0.0f)));
+    m_composite_camera->addChild(quad.get());
+
+    osg::StateSet* ss = m_composite_camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(create_program(quad_vertex_shader, composite_fragment_shader), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setTextureAttributeAndModes(0, m_accumulation.get(), osg::StateAttribute::ON);
+    ss->setTextureAttributeAndModes(1, m_coverage.get(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("accumulation", 0));
+    ss->addUniform(new osg::Uniform("coverage", 1));
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+    m_root->addChild(m_composite_camera.get());
+}
@@ -0,0 +1,50 @@
+#ifndef OSG_ORDER_INDEPENDENT_TRANSPARENCY_HPP
+#define OSG_ORDER_INDEPENDENT_TRANSPARENCY_HPP
+
+#include <osg/Camera>
+#include <osg/Switch>
+#include <osg/Texture2D>
+
+/*
+ * Weighted blended order independent transparency for the translucent components of the model.
+ *
+ * The model is rendered in a single unsorted pass instead of the depth sorted transparent bin:
+ *  - the accumulation camera renders the model with the view and the projection of the main camera
+ *    into two floating point targets, the sum of the premultiplied colors weighted by alpha and depth
+ *    (blended ONE, ONE) and the revealage, the product of (1 - alpha) of all fragments of the pixel,
+ *    kept as the coverage 1 - revealage (alpha blended ONE, ONE_MINUS_SRC_COLOR over a cleared 0),
+ *    the depth is neither tested nor written,
+ *  - the composite camera draws the average color accum.rgb / accum.a with the coverage as alpha
+ *    over the background image.
+ * The result does not depend on the order of the fragments, intersecting tubes blend correctly and the
+ * cull traversal does not sort the drawables.
+ *
+ * While enabled the main camera skips the model: the cull callback of the model traverses it only for
+ * the other cameras. The cameras are masked out of the intersections (node mask 0x1, as the selection
+ * box) thus the picking still finds each component once, through the model node. The accumulation pass
+ * has no depth buffer, the opaque geometry outside of the model does not occlude the components.
+ */
+class OsgOrderIndependentTransparency {
+public:
+    OsgOrderIndependentTransparency();
+    osg::Node* GetRoot();
+    void Initialize(osg::Camera* main_camera, osg::Group* model, int width, int height);
+    void SetEnabled(bool flag);
+    bool IsEnabled() const;
+private:
+    class model_cull_callback;
+
+    osg::ref_ptr<osg::Switch> m_root;
+    osg::ref_ptr<osg::Camera> m_accumulation_camera;
+    osg::ref_ptr<osg::Camera> m_composite_camera;
+    osg::ref_ptr<osg::Texture2D> m_accumulation;        // weighted premultiplied colors and alphas
+    osg::ref_ptr<osg::Texture2D> m_coverage;            // 1 - product of (1 - alpha)
+    osg::ref_ptr<osg::Group> m_model;
+    osg::ref_ptr<osg::NodeCallback> m_cull_callback;
+    int m_width, m_height;                              // viewport size
+
+    void create_accumulation_camera(osg::Group* model);
+    void create_composite_camera();
+};
+
+#endif // OSG_ORDER_INDEPENDENT_TRANSPARENCY_HPP
@@ -0,0 +1,276 @@
+#include "OsgReprojectionErrorMap.hpp"
+
+#include <osg/BlendFunc>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PolygonMode>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+#include <cmath>
+
+static const char* mask_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* mask_fragment_shader =
+    "#version 120\n"
+    "uniform vec4 pick_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = pick_color;\n"
+    "}\n";
+
+static const char* quad_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+// (1 - g, 1) for the contour pixels of the silhouette, g is the strongest gradient around the pixel
+static const char* error_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D silhouette;\n"
+    "uniform sampler2D gradient;\n"
+    "uniform vec2 texel;\n"
+    "void main() {\n"
+    "    vec2 uv = gl_FragCoord.xy * texel;\n"
+    "    float inside = texture2D(silhouette, uv).r;\n"
+    "    float outside = 1.0 - texture2D(silhouette, uv + vec2(texel.x, 0.0)).r;\n"
+    "    outside = max(outside, 1.0 - texture2D(silhouette, uv - vec2(texel.x, 0.0)).r);\n"
+    "    outside = max(outside, 1.0 - texture2D(silhouette, uv + vec2(0.0, texel.y)).r);\n"
+    "    outside = max(outside, 1.0 - texture2D(silhouette, uv - vec2(0.0, texel.y)).r);\n"
+    "    float contour = step(0.5, inside) * step(0.5, outside);\n"
+    "    float g = 0.0;\n"
+    "    for(int i = -1; i <= 1; ++i)\n"
+    "        for(int j = -1; j <= 1; ++j)\n"
+    "            g = max(g, texture2D(gradient, uv + vec2(float(i), float(j)) * texel).r);\n"
+    "    gl_FragColor = vec4(contour * (1.0 - g), contour, 0.0, 1.0);\n"
+    "}\n";
+
+// the quad covers the whole error texture and the viewport is a single pixel: the top mip level
+static const char* reduction_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D error;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(error, gl_TexCoord[0].st, 1.0);\n"
+    "}\n";
+
+static const char* overlay_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D error;\n"
+    "uniform vec2 texel;\n"
+    "void main() {\n"
+    "    vec4 e = texture2D(error, gl_FragCoord.xy * texel);\n"
+    "    gl_FragColor = vec4(e.r, e.g - e.r, 0.0, e.g);\n"
+    "}\n";
+
+static int next_power_of_two(int n) {
+
+    int p = 1;
+    while(p < n) p <<= 1;
+    return p;
+}
+
+// a unit quad under an orthographic camera of the given viewport
+static osg::Camera* create_quad_camera(int width, int height, osg::Program* program) {
+
+    osg::Camera* camera = new osg::Camera;
+    camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    camera->setProjectionMatrix(osg::Matrix::ortho2D(0.0, 1.0, 0.0, 1.0));
+    camera->setViewMatrix(osg::Matrix::identity());
+    camera->setViewport(0, 0, width, height);
+    camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setCullingActive(false);
+    camera->setAllowEventFocus(false);
+
+    osg::ref_ptr<osg::Geode> quad = new osg::Geode;
+    quad->addDrawable(osg::createTexturedQuadGeometry(osg::Vec3(0.0f, 0.0f, 0.0f), osg::Vec3(1.0f, 0.0f, 0.0f), osg::Vec3(0.0f, 1.0f, 0.0f)));
+    camera->addChild(quad.get());
+
+    osg::StateSet* ss = camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(program, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    return camera;
+}
+
+static osg::Program* create_program(const char* vertex_shader, const char* fragment_shader) {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragment_shader));
+    return program;
+}
+
+OsgReprojectionErrorMap::OsgReprojectionErrorMap() :
+    m_root(new osg::Switch),
+    m_drawn(new drawn_callback),
+    m_width(0),
+    m_height(0),
+    m_error_width(0),
+    m_error_height(0) {
+
+    m_root->setCullingActive(false);
+}
+
+osg::Node* OsgReprojectionErrorMap::GetRoot() {
+    return m_root.get();
+}
+
+void OsgReprojectionErrorMap::Initialize(osg::Node* model, osg::Texture2D* gradient, int width, int height) {
+
+    m_root->removeChildren(0, m_root->getNumChildren());
+    m_width = width;
+    m_height = height;
+    m_error_width = next_power_of_two(width);
+    m_error_height = next_power_of_two(height);
+
+    create_silhouette_camera(model);
+    create_error_camera(gradient);
+    create_reduction_camera();
+    create_overlay_camera();
+    SetEnabled(false);
+}
+
+void OsgReprojectionErrorMap::SetGradientTexture(osg::Texture2D* gradient) {
+
+    if(m_error_camera.valid())
+        m_error_camera->getOrCreateStateSet()->setTextureAttributeAndModes(1, gradient, osg::StateAttribute::ON);
+}
+
+void OsgReprojectionErrorMap::SetEnabled(bool flag) {
+
+    if(flag) m_root->setAllChildrenOn();
+    else     m_root->setAllChildrenOff();
+    m_drawn->drawn = false;
+}
+
+bool OsgReprojectionErrorMap::IsEnabled() const {
+    return m_root->getNumChildren() > 0 && m_root->getValue(0);
+}
+
+bool OsgReprojectionErrorMap::GetScore(double& error, unsigned int& num_contour_pixels) {
+
+    if(!IsEnabled() || !m_drawn->drawn) return false;
+    m_drawn->drawn = false;
+
+    // the mean of the error texture times its number of texels
+    const float* px = reinterpret_cast<const float*>(m_reduced->data());
+    double num_texels = static_cast<double>(m_error_width) * m_error_height;
+    double misfit = px[0] * num_texels;
+    double contour = px[1] * num_texels;
+    num_contour_pixels = static_cast<unsigned int>(std::round(contour));
+    error = (num_contour_pixels > 0) ? misfit / contour : 0.0;
+    return true;
+}
+
+void OsgReprojectionErrorMap::create_silhouette_camera(osg::Node* model) {
+
+    m_silhouette = new osg::Texture2D;
+    m_silhouette->setTextureSize(m_width, m_height);
+    m_silhouette->setInternalFormat(GL_RGBA);
+    m_silhouette->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    m_silhouette->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    m_silhouette->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    m_silhouette->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    m_silhouette->setResizeNonPowerOfTwoHint(false);
+
+    // relative to the main camera with identity matrices: the view and the projection of the main camera
+    m_silhouette_camera = new osg::Camera;
+    m_silhouette_camera->setReferenceFrame(osg::Transform::RELATIVE_RF);
+    m_silhouette_camera->setViewMatrix(osg::Matrix::identity());
+    m_silhouette_camera->setProjectionMatrix(osg::Matrix::identity());
+    m_silhouette_camera->setRenderOrder(osg::Camera::PRE_RENDER, 0);
+    m_silhouette_camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    m_silhouette_camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_silhouette_camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_silhouette_camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    m_silhouette_camera->setViewport(0, 0, m_width, m_height);
+    m_silhouette_camera->setAllowEventFocus(false);
+    m_silhouette_camera->attach(osg::Camera::DEPTH_BUFFER, GL_DEPTH_COMPONENT24);
+    m_silhouette_camera->attach(osg::Camera::COLOR_BUFFER, m_silhouette.get());
+    m_silhouette_camera->addChild(model);
+
+    // a flat mask, the protected programs of the procedural geometries write the pick color
+    osg::StateSet* ss = m_silhouette_camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(create_program(mask_vertex_shader, mask_fragment_shader), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("picking", true), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("pick_color", osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f)), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_MULTISAMPLE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    m_root->addChild(m_silhouette_camera.get());
+}
+
+void OsgReprojectionErrorMap::create_error_camera(osg::Texture2D* gradient) {
+
+    // nearest filtering of the mip levels, the top level is read by the reduction and level 0 by the overlay
+    m_error = new osg::Texture2D;
+    m_error->setTextureSize(m_error_width, m_error_height);
+    m_error->setInternalFormat(GL_RGBA32F_ARB);
+    m_error->setSourceFormat(GL_RGBA);
+    m_error->setSourceType(GL_FLOAT);
+    m_error->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST_MIPMAP_NEAREST);
+    m_error->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    m_error->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    m_error->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+    // the whole texture is cleared, only the image region is drawn
+    m_error_camera = create_quad_camera(m_width, m_height, create_program(quad_vertex_shader, error_fragment_shader));
+    m_error_camera->setRenderOrder(osg::Camera::PRE_RENDER, 1);
+    m_error_camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    m_error_camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_error_camera->setClearMask(GL_COLOR_BUFFER_BIT);
+    m_error_camera->attach(osg::Camera::COLOR_BUFFER, m_error.get(), 0, 0, true);
+
+    osg::StateSet* ss = m_error_camera->getOrCreateStateSet();
+    ss->setTextureAttributeAndModes(0, m_silhouette.get(), osg::StateAttribute::ON);
+    ss->setTextureAttributeAndModes(1, gradient, osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("silhouette", 0));
+    ss->addUniform(new osg::Uniform("gradient", 1));
+    ss->addUniform(new osg::Uniform("texel", osg::Vec2(1.0f / m_width, 1.0f / m_height)));
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    m_root->addChild(m_error_camera.get());
+}
+
+void OsgReprojectionErrorMap::create_reduction_camera() {
+
+    // a floating point render buffer for the read back
+    m_reduced = new osg::Image;
+    m_reduced->allocateImage(1, 1, 1, GL_RGBA, GL_FLOAT);
+    m_reduced->setInternalTextureFormat(GL_RGBA32F_ARB);
+
+    m_reduction_camera = create_quad_camera(1, 1, create_program(quad_vertex_shader, reduction_fragment_shader));
+    m_reduction_camera->setRenderOrder(osg::Camera::PRE_RENDER, 2);
+    m_reduction_camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    m_reduction_camera->setClearMask(0);
+    m_reduction_camera->attach(osg::Camera::COLOR_BUFFER, m_reduced.get());
+    m_reduction_camera->setPostDrawCallback(m_drawn.get());
+
+    osg::StateSet* ss = m_reduction_camera->getOrCreateStateSet();
+    ss->setTextureAttributeAndModes(0, m_error.get(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("error", 0));
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    m_root->addChild(m_reduction_camera.get());
+}
+
+void OsgReprojectionErrorMap::create_overlay_camera() {
+
+    // after the background camera, blended over the image and the model
+    m_overlay_camera = create_quad_camera(m_width, m_height, create_program(quad_vertex_shader, overlay_fragment_shader));
+    m_overlay_camera->setRenderOrder(osg::Camera::POST_RENDER, 1);
+    m_overlay_camera->setClearMask(0);
+
+    osg::StateSet* ss = m_overlay_camera->getOrCreateStateSet();
+    ss->setTextureAttributeAndModes(0, m_error.get(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("error", 0));
+    ss->addUniform(new osg::Uniform("texel", osg::Vec2(1.0f / m_error_width, 1.0f / m_error_height)));
+    ss->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+    m_root->addChild(m_overlay_camera.get());
+}
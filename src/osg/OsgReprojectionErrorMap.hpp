@@ -0,0 +1,64 @@
+#ifndef OSG_REPROJECTION_ERROR_MAP_HPP
+#define OSG_REPROJECTION_ERROR_MAP_HPP
+
+#include <osg/Camera>
+#include <osg/Switch>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <atomic>
+
+/*
+ * Reprojection error of the model against the gradient image, computed on the GPU.
+ *
+ * Three pre-render cameras run with every frame of the viewer:
+ *  - the silhouette camera renders the model with the view and the projection of the main camera
+ *    as a flat mask into a texture of the image size,
+ *  - the error pass marks the contour pixels of the mask (inside with a neighbour outside) and
+ *    writes (1 - g, 1) for them into a floating point texture, g is the strongest gradient in the
+ *    3x3 window of the pixel, every other pixel is 0,
+ *  - the mipmaps of the error texture are generated and the reduction camera reads its top level
+ *    (the mean of all pixels) back into a 1x1 image.
+ * The error texture has power of two dimensions so that the top level is the exact mean, the sum
+ * of the two channels is the mean times the number of texels.
+ *
+ * The score is the mean misfit of the contour pixels, 0 if every contour lies on a maximal gradient
+ * and 1 if there is no edge near the contour at all. The overlay camera draws the error texture over
+ * the background image, the contour pixels are colored from green (on an edge) to red (no edge).
+ *
+ * GetScore returns false until the draw thread has read a new score back.
+ */
+class OsgReprojectionErrorMap {
+public:
+    OsgReprojectionErrorMap();
+    osg::Node* GetRoot();
+    void Initialize(osg::Node* model, osg::Texture2D* gradient, int width, int height);
+    void SetGradientTexture(osg::Texture2D* gradient);
+    void SetEnabled(bool flag);
+    bool IsEnabled() const;
+    bool GetScore(double& error, unsigned int& num_contour_pixels);
+private:
+    struct drawn_callback : public osg::Camera::DrawCallback {
+        mutable std::atomic<bool> drawn;
+        drawn_callback() : drawn(false) { }
+        void operator()(osg::RenderInfo& render_info) const override { drawn = true; }
+    };
+
+    osg::ref_ptr<osg::Switch> m_root;
+    osg::ref_ptr<osg::Camera> m_silhouette_camera;
+    osg::ref_ptr<osg::Camera> m_error_camera;
+    osg::ref_ptr<osg::Camera> m_reduction_camera;
+    osg::ref_ptr<osg::Camera> m_overlay_camera;
+    osg::ref_ptr<osg::Texture2D> m_silhouette;          // mask of the model, image size
+    osg::ref_ptr<osg::Texture2D> m_error;               // misfit and contour, power of two size
+    osg::ref_ptr<osg::Image> m_reduced;                 // top mip level of the error texture
+    osg::ref_ptr<drawn_callback> m_drawn;
+    int m_width, m_height;                              // image size
+    int m_error_width, m_error_height;                  // error texture size
+
+    void create_silhouette_camera(osg::Node* model);
+    void create_error_camera(osg::Texture2D* gradient);
+    void create_reduction_camera();
+    void create_overlay_camera();
+};
+
+#endif // OSG_REPROJECTION_ERROR_MAP_HPP
@@ -4,10 +4,19 @@
 #include <osg/Geode>
 #include <osg/ShapeDrawable>
 #include <osg/PolygonMode>
+#include <osg/ComputeBoundsVisitor>
 #include <osg/ValueObject>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 
-void OsgSelectionHandler::HandleSelection(osg::Camera* cam, int x, int y) {
+bool OsgSelectionHandler::HandleSelection(osg::Camera* cam, int x, int y) {
+
+    if(m_picking_mode == picking_mode::color_id) {
+        GetOrCreatePickCamera();
+        m_picker->Request(cam, x, y);
+        return false;
+    }
 
     osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector =
             new osgUtil::LineSegmentIntersector(
@@ -17,6 +26,7 @@ void OsgSelectionHandler::HandleSelection(osg::Camera* cam, int x, int y) {
 
     osgUtil::IntersectionVisitor iv(intersector.get());
     iv.setTraversalMask(~0x1);
+    iv.setUseKdTreeWhenAvailable(m_use_kdtrees);
     cam->accept(iv);
 
     if(intersector->containsIntersections())
@@ -40,7 +50,79 @@ void OsgSelectionHandler::HandleSelection(osg::Camera* cam, int x, int y) {
                 std::cout << "ERROR: Active selection box error!" << std::endl;
             }
         }
+        return true;
+    }
+    return false;
+}
+
+bool OsgSelectionHandler::HandleRectangleSelection(osg::Camera* cam, int x0, int y0, int x1, int y1) {
+
+    // a rectangle is only supported by the id buffer
+    if(m_picking_mode != picking_mode::color_id)
+        return HandleSelection(cam, x1, y1);
+
+    GetOrCreatePickCamera();
+    m_picker->Request(cam, std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1);
+    return false;
+}
+
+bool OsgSelectionHandler::UpdatePendingSelection() {
+
+    std::vector<osg::ref_ptr<osg::Node>> nodes;
+    if(!m_picker || !m_picker->Collect(nodes))
+        return false;
+
+    for(auto& node : nodes)
+        toggle_selection(node.get());
+    return !nodes.empty();
+}
+
+bool OsgSelectionHandler::IsSelectionPending() const {
+    return m_picker && m_picker->IsPending();
+}
+
+void OsgSelectionHandler::SetPickingMode(picking_mode mode) {
+    m_picking_mode = mode;
+}
+
+osg::Camera* OsgSelectionHandler::GetOrCreatePickCamera() {
+
+    if(!m_picker)
+        m_picker.reset(new OsgColorIdPicker);
+    return m_picker->GetPickCamera();
+}
+
+void OsgSelectionHandler::toggle_selection(osg::Node* node) {
+
+    auto selection_box_id = process_selections(node);
+    if(selection_box_id == -1) return;
+
+    osg::MatrixTransform* active_selection_box = dynamic_cast<osg::MatrixTransform*>(m_selection_boxes->getChild(selection_box_id));
+    if(!active_selection_box) {
+        std::cout << "ERROR: Active selection box error!" << std::endl;
+        return;
+    }
+
+    // the bounds of the node in its parent frame, the node path ends with the node itself
+    osg::ComputeBoundsVisitor cbv;
+    node->accept(cbv);
+    const osg::BoundingBox& bb = cbv.getBoundingBox();
+    osg::NodePathList paths = node->getParentalNodePaths();
+    osg::Matrix local_to_world;
+    if(!paths.empty()) {
+        paths[0].pop_back();
+        local_to_world = osg::computeLocalToWorld(paths[0]);
     }
+    osg::Vec3 worldCenter = bb.center() * local_to_world;
+    active_selection_box->setMatrix(osg::Matrix::scale(bb.xMax() - bb.xMin(), bb.yMax() - bb.yMin(), bb.zMax() - bb.zMin()) * osg::Matrix::translate(worldCenter));
+}
+
+void OsgSelectionHandler::SetUseKdTrees(bool flag) {
+    m_use_kdtrees = flag;
+}
+
+OsgComponentIndex* OsgSelectionHandler::GetComponentIndex() {
+    return &m_index;
 }
 
 osg::Switch* OsgSelectionHandler::GetOrCreateSelectionBoxSwitch() {
@@ -58,6 +140,8 @@ int OsgSelectionHandler::process_selections(osg::Node* node) {
         // invert the selection
         selection = !selection;
         int selection_box_id = -1;
+        unsigned int component_id = 0;
+        bool component = m_index.FindComponentId(node, component_id);
         if(selection) {
             // select the node
             node->setUserValue("Selection", selection);
@@ -65,6 +149,7 @@ int OsgSelectionHandler::process_selections(osg::Node* node) {
             node->setUserValue("Selection_Box_Id", selection_box_id);
             m_selection_boxes->setValue(static_cast<unsigned int>(selection_box_id), selection);
             m_selection_boxes->getChild(static_cast<unsigned int>(selection_box_id))->setUserValue("Free", !selection);
+            if(component) m_index.SetSelectionBox(component_id, selection_box_id);
             return selection_box_id;
         }
         else {
@@ -74,6 +159,7 @@ int OsgSelectionHandler::process_selections(osg::Node* node) {
                 node->setUserValue("Selection_Box_Id", -1);
                 m_selection_boxes->setValue(static_cast<unsigned int>(selection_box_id), selection);
                 m_selection_boxes->getChild(static_cast<unsigned int>(selection_box_id))->setUserValue("Free", !selection);
+                if(component) m_index.SetSelectionBox(component_id, -1);
             }
             else {
                 std::cout << "ERROR: This node does not have Selection_Box_Id" << std::endl;
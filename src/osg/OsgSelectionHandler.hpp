@@ -1,16 +1,38 @@
 #ifndef OSG_SELECTION_HANDLER_HPP
 #define OSG_SELECTION_HANDLER_HPP
 
+#include "OsgColorIdPicker.hpp"
+#include "OsgComponentIndex.hpp"
 #include <osg/Switch>
 #include <osg/Camera>
+#include <memory>
+
+enum class picking_mode : unsigned char {
+    ray_intersection,   // immediate, intersects the geometries on the cpu
+    color_id            // rendered with the next frame, see OsgColorIdPicker
+};
 
 class OsgSelectionHandler {
 public:
-    OsgSelectionHandler() { }
+    OsgSelectionHandler() : m_use_kdtrees(true), m_picking_mode(picking_mode::ray_intersection) { }
     osg::Switch* GetOrCreateSelectionBoxSwitch();
-    void HandleSelection(osg::Camera* cam, int x, int y);
+    osg::Camera* GetOrCreatePickCamera();
+    // the components of the model and their selection boxes
+    OsgComponentIndex* GetComponentIndex();
+    // returns true if the selection has changed, false if there is no hit or the pick is pending
+    bool HandleSelection(osg::Camera* cam, int x, int y);
+    bool HandleRectangleSelection(osg::Camera* cam, int x0, int y0, int x1, int y1);
+    bool UpdatePendingSelection();
+    bool IsSelectionPending() const;
+    void SetUseKdTrees(bool flag);
+    void SetPickingMode(picking_mode mode);
 private:
     osg::ref_ptr<osg::Switch> m_selection_boxes;
+    std::unique_ptr<OsgColorIdPicker> m_picker;
+    bool m_use_kdtrees;     // intersect the kd-trees of the static geometries instead of their triangles
+    picking_mode m_picking_mode;
+    OsgComponentIndex m_index;
+    void toggle_selection(osg::Node* node);
     unsigned int create_selection_box(int num);
     int process_selections(osg::Node* node);
     inline bool is_free(osg::Node* node);
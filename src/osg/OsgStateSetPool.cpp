@@ -0,0 +1,65 @@
+#include "OsgStateSetPool.hpp"
+
+#include <osg/BlendFunc>
+#include <osg/LineWidth>
+#include <osg/Material>
+#include <osg/PolygonMode>
+#include <osg/Uniform>
+#include <tuple>
+
+bool render_state::operator<(const render_state& other) const {
+
+    return std::tie(colored, color, blend, polygon_mode, line_width) <
+           std::tie(other.colored, other.color, other.blend, other.polygon_mode, other.line_width);
+}
+
+StateSetPool& StateSetPool::Instance() {
+
+    static StateSetPool pool;
+    return pool;
+}
+
+osg::StateSet* StateSetPool::Get(const render_state& state) {
+
+    // the components of the batch jobs are created in parallel
+    std::lock_guard<std::mutex> lock(m_mutex);
+    osg::ref_ptr<osg::StateSet>& stateset = m_state_sets[state];
+    if(!stateset.valid())
+        stateset = create_state_set(state);
+    return stateset.get();
+}
+
+bool StateSetPool::GetColor(const osg::StateSet* stateset, osg::Vec4& color) {
+
+    const osg::Uniform* uniform = stateset ? stateset->getUniform("component_color") : nullptr;
+    return uniform && uniform->get(color);
+}
+
+osg::StateSet* StateSetPool::create_state_set(const render_state& state) {
+
+    osg::StateSet* ss = new osg::StateSet;
+    ss->setDataVariance(osg::Object::STATIC);
+
+    // Step-1: the color, the vertex color of the default material of the viewer is replaced by the material
+    if(state.colored) {
+        osg::ref_ptr<osg::Material> material = new osg::Material;
+        material->setColorMode(osg::Material::OFF);
+        material->setAmbient(osg::Material::FRONT_AND_BACK, state.color);
+        material->setDiffuse(osg::Material::FRONT_AND_BACK, state.color);
+        ss->setAttributeAndModes(material.get(), osg::StateAttribute::ON);
+        ss->addUniform(new osg::Uniform("component_color", state.color));
+    }
+
+    // Step-2: the blending and the rasterization
+    if(state.blend) {
+        ss->setAttributeAndModes(new osg::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), osg::StateAttribute::ON);
+        ss->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+    }
+    if(state.polygon_mode != 0)
+        ss->setAttribute(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, static_cast<osg::PolygonMode::Mode>(state.polygon_mode)));
+    if(state.line_width > 0.0f) {
+        ss->setAttributeAndModes(new osg::LineWidth(state.line_width), osg::StateAttribute::ON);
+        ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    }
+    return ss;
+}
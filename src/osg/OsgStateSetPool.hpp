@@ -0,0 +1,59 @@
+#ifndef OSG_STATE_SET_POOL_HPP
+#define OSG_STATE_SET_POOL_HPP
+
+#include <osg/StateSet>
+#include <osg/Vec4>
+#include <map>
+#include <mutex>
+
+/*
+ * Render state of a component geometry, the key of the shared state sets.
+ *
+ * The color is the material of the lit geometry and the component_color uniform of the programs
+ * (the sweep of the generalized cylinders, the order independent transparency), the geometries do
+ * not have color arrays. A state without a color inherits it, e.g. the transparent groups of
+ * GeneralizedCylinder::MakeTransparent. A polygon mode of 0 and a line width of 0 are inherited from
+ * the scene (see OsgWxFrame::usrSetPolygonMode), the lines are drawn unlit with their vertex colors.
+ */
+struct render_state {
+    bool colored;
+    osg::Vec4 color;
+    bool blend;                 // alpha blended in the transparent bin
+    int polygon_mode;           // osg::PolygonMode::Mode for both faces
+    float line_width;
+
+    render_state() : colored(false), blend(false), polygon_mode(0), line_width(0.0f) { }
+    explicit render_state(const osg::Vec4& c, bool b = false) : colored(true), color(c), blend(b), polygon_mode(0), line_width(0.0f) { }
+    bool operator<(const render_state& other) const;
+};
+
+/*
+ * State sets shared by the geometries with the same render state.
+ *
+ * Every component used to create its own state set, thus a large model had as many state sets as
+ * drawables and the render bins could not group them. The pool returns one state set per render
+ * state: the geometries of the same color share it, the cull traversal sorts the drawables by state
+ * set and the draw traversal applies the state once per group. The shared state sets are static,
+ * a geometry that changes its color switches to the state set of the new color instead of modifying
+ * the shared one. The state sets are never released, there are a few per distinct color.
+ */
+class StateSetPool {
+public:
+    static StateSetPool& Instance();
+
+    osg::StateSet* Get(const render_state& state);
+    // the color of a state set of the pool, false if it is not colored
+    static bool GetColor(const osg::StateSet* stateset, osg::Vec4& color);
+
+private:
+    StateSetPool() { }
+    StateSetPool(const StateSetPool&) = delete;
+    StateSetPool& operator=(const StateSetPool&) = delete;
+
+    static osg::StateSet* create_state_set(const render_state& state);
+
+    std::mutex m_mutex;
+    std::map<render_state, osg::ref_ptr<osg::StateSet>> m_state_sets;
+};
+
+#endif // OSG_STATE_SET_POOL_HPP
@@ -0,0 +1,257 @@
+#include "OsgTextureBaker.hpp"
+#include "../modeller/ProjectionParameters.hpp"
+#include "../modeller/components/GeneralizedCylinder.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PolygonMode>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Uniform>
+#include <utility>
+
+static const char* depth_vertex_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char* depth_fragment_shader =
+    "#version 120\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(1.0);\n"
+    "}\n";
+
+// the texture coordinates are the position in the texture, the point of the surface is projected into the image,
+// the normals by the inverse transpose of the model matrix (n M^-1 is M^-T n) for the scaled components
+static const char* bake_vertex_shader =
+    "#version 120\n"
+    "uniform mat4 model_matrix;\n"
+    "uniform mat4 model_inverse_matrix;\n"
+    "uniform mat4 image_matrix;\n"
+    "varying vec4 image_position;\n"
+    "varying vec3 world_position;\n"
+    "varying vec3 world_normal;\n"
+    "void main() {\n"
+    "    vec4 world = model_matrix * gl_Vertex;\n"
+    "    world_position = world.xyz;\n"
+    "    world_normal = (vec4(gl_Normal, 0.0) * model_inverse_matrix).xyz;\n"
+    "    image_position = image_matrix * world;\n"
+    "    gl_Position = vec4(gl_MultiTexCoord0.xy * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// the camera of the image is at the origin, the depths are compared along its rays
+static const char* bake_fragment_shader =
+    "#version 120\n"
+    "uniform sampler2D image;\n"
+    "uniform sampler2D depth;\n"
+    "uniform vec4 component_color;\n"
+    "uniform vec2 depth_range;\n"
+    "uniform bool flip_image;\n"
+    "varying vec4 image_position;\n"
+    "varying vec3 world_position;\n"
+    "varying vec3 world_normal;\n"
+    "float eye_depth(float d) {\n"
+    "    float n = depth_range.x, f = depth_range.y;\n"
+    "    return 2.0 * n * f / (f + n - (2.0 * d - 1.0) * (f - n));\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 ndc = image_position.xyz / image_position.w;\n"
+    "    vec2 uv = ndc.xy * 0.5 + 0.5;\n"
+    "    float visible = step(0.0, image_position.w) * step(0.0, uv.x) * step(uv.x, 1.0) * step(0.0, uv.y) * step(uv.y, 1.0);\n"
+    "    visible *= step(0.1, dot(normalize(world_normal), normalize(-world_position)));\n"
+    "    visible *= step(eye_depth(ndc.z * 0.5 + 0.5), 1.01 * eye_depth(texture2D(depth, uv).r));\n"
+    "    vec2 st = flip_image ? vec2(uv.x, 1.0 - uv.y) : uv;\n"
+    "    gl_FragColor = vec4(mix(component_color.rgb, texture2D(image, st).rgb, visible), 1.0);\n"
+    "}\n";
+
+static osg::Program* create_program(const char* vertex_shader, const char* fragment_shader) {
+
+    osg::Program* program = new osg::Program;
+    program->addShader(new osg::Shader(osg::Shader::VERTEX, vertex_shader));
+    program->addShader(new osg::Shader(osg::Shader::FRAGMENT, fragment_shader));
+    return program;
+}
+
+OsgTextureBaker::OsgTextureBaker(osg::Texture2D* image, const ProjectionParameters& pp, int texture_size) :
+    m_root(new osg::Group),
+    m_image(image),
+    m_program(create_program(bake_vertex_shader, bake_fragment_shader)),
+    m_drawn(new drawn_callback),
+    m_projection(osg::Matrixd::perspective(pp.fovy, pp.aspect, pp.near, pp.far)),
+    m_width(pp.width),
+    m_height(pp.height),
+    m_texture_size(texture_size),
+    m_near(pp.near),
+    m_far(pp.far) {
+
+    m_root->setCullingActive(false);
+}
+
+osg::Node* OsgTextureBaker::GetRoot() {
+    return m_root.get();
+}
+
+bool OsgTextureBaker::Bake(osg::Node* model, const std::vector<GeneralizedCylinder*>& components, const executor_type& scene_update) {
+
+    if(IsBaking()) return false;
+
+    // Step-1: the depth of the model from the camera of the image
+    m_passes.clear();
+    m_drawn->drawn = false;
+    std::vector<osg::ref_ptr<osg::Camera>> cameras(1, create_depth_camera(model));
+
+    // Step-2: a texture for each component with a side surface, read back by its camera
+    for(GeneralizedCylinder* gcyl : components) {
+        if(gcyl->GetGeometry()->GetNumberOfSections() < 2) continue;
+        bake_pass pass;
+        pass.component = gcyl;
+        pass.texture = new osg::Image;
+        pass.texture->allocateImage(m_texture_size, m_texture_size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        osg::Camera* camera = create_bake_camera(gcyl, pass.texture.get(), static_cast<int>(m_passes.size()) + 1);
+        if(!camera) continue;
+        cameras.push_back(camera);
+        m_passes.push_back(pass);
+    }
+    if(m_passes.empty()) return false;
+
+    // Step-3: the passes are added to the scene by its update traversal
+    cameras.back()->setPostDrawCallback(m_drawn.get());
+    osg::ref_ptr<osg::Group> root = m_root;
+    scene_update([root, cameras]() {
+        root->removeChildren(0, root->getNumChildren());
+        for(const osg::ref_ptr<osg::Camera>& camera : cameras)
+            root->addChild(camera.get());
+    });
+    return true;
+}
+
+bool OsgTextureBaker::IsBaking() const {
+    return !m_passes.empty();
+}
+
+int OsgTextureBaker::Collect(const executor_type& scene_update) {
+
+    if(!IsBaking() || !m_drawn->drawn) return -1;
+
+    // the components deleted while baking are skipped
+    std::vector<std::pair<osg::ref_ptr<GeneralizedCylinder>, osg::ref_ptr<osg::Image>>> textured;
+    for(bake_pass& pass : m_passes) {
+        osg::ref_ptr<GeneralizedCylinder> gcyl;
+        if(pass.component.lock(gcyl)) textured.push_back(std::make_pair(gcyl, pass.texture));
+    }
+    m_passes.clear();
+    m_drawn->drawn = false;
+
+    // the textures are applied and the passes removed by the update traversal
+    osg::ref_ptr<osg::Group> root = m_root;
+    scene_update([root, textured]() {
+        for(const auto& component : textured)
+            component.first->SetTexture(component.second.get());
+        root->removeChildren(0, root->getNumChildren());
+    });
+    return static_cast<int>(textured.size());
+}
+
+osg::Camera* OsgTextureBaker::create_depth_camera(osg::Node* model) {
+
+    m_depth = new osg::Texture2D;
+    m_depth->setTextureSize(m_width, m_height);
+    m_depth->setInternalFormat(GL_DEPTH_COMPONENT24);
+    m_depth->setSourceFormat(GL_DEPTH_COMPONENT);
+    m_depth->setSourceType(GL_FLOAT);
+    m_depth->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+    m_depth->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+    m_depth->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    m_depth->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    m_depth->setResizeNonPowerOfTwoHint(false);
+
+    // the camera of the image, independent of the navigation of the main camera
+    osg::Camera* camera = new osg::Camera;
+    camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    camera->setViewMatrix(osg::Matrixd::identity());
+    camera->setProjectionMatrix(m_projection);
+    camera->setRenderOrder(osg::Camera::PRE_RENDER, 0);
+    camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    camera->setClearMask(GL_DEPTH_BUFFER_BIT);
+    camera->setDrawBuffer(GL_NONE);
+    camera->setReadBuffer(GL_NONE);
+    camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setViewport(0, 0, m_width, m_height);
+    camera->setAllowEventFocus(false);
+    camera->attach(osg::Camera::DEPTH_BUFFER, m_depth.get());
+    camera->addChild(model);
+
+    // the protected programs of the procedural geometries write the pick color and their depth
+    osg::StateSet* ss = camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(create_program(depth_vertex_shader, depth_fragment_shader), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("picking", true), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->addUniform(new osg::Uniform("pick_color", osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f)), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    return camera;
+}
+
+osg::Camera* OsgTextureBaker::create_bake_camera(GeneralizedCylinder* component, osg::Image* texture, int order) {
+
+    // Step-1: the textured mesh in the coordinates of the component
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+    std::vector<unsigned int> triangles;
+    component->GetGeometry()->GetTexturedMesh(vertices.get(), normals.get(), texcoords.get(), triangles);
+    if(triangles.empty()) return nullptr;
+
+    // the caps are textured with their rings, only the side surface covers the texture
+    size_t num_side = 6 * static_cast<size_t>(component->GetGeometry()->GetNumberOfPointsPerSection()) * (component->GetGeometry()->GetNumberOfSections() - 1);
+    osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+    geom->setUseDisplayList(false);
+    geom->setUseVertexBufferObjects(true);
+    geom->setVertexArray(vertices.get());
+    geom->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    geom->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+    geom->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, triangles.begin(), triangles.begin() + num_side));
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geom.get());
+
+    // Step-2: the texture space is the viewport, the vertex shader places the texels
+    osg::Camera* camera = new osg::Camera;
+    camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+    camera->setViewMatrix(osg::Matrixd::identity());
+    camera->setProjectionMatrix(osg::Matrixd::identity());
+    camera->setRenderOrder(osg::Camera::PRE_RENDER, order);
+    camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    osg::Vec4 color = component->GetGeometry()->GetColor();
+    camera->setClearColor(osg::Vec4(color.r(), color.g(), color.b(), 1.0f));
+    camera->setClearMask(GL_COLOR_BUFFER_BIT);
+    camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    camera->setCullingActive(false);
+    camera->setViewport(0, 0, m_texture_size, m_texture_size);
+    camera->setAllowEventFocus(false);
+    camera->attach(osg::Camera::COLOR_BUFFER, texture);
+    camera->addChild(geode.get());
+
+    osg::Matrixd model_matrix;
+    if(!component->getParentalNodePaths().empty())
+        model_matrix = osg::computeLocalToWorld(component->getParentalNodePaths().front());
+    const osg::Image* image = m_image->getImage();
+    osg::StateSet* ss = camera->getOrCreateStateSet();
+    ss->setAttributeAndModes(m_program.get(), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setTextureAttributeAndModes(0, m_image.get(), osg::StateAttribute::ON);
+    ss->setTextureAttributeAndModes(1, m_depth.get(), osg::StateAttribute::ON);
+    ss->addUniform(new osg::Uniform("image", 0));
+    ss->addUniform(new osg::Uniform("depth", 1));
+    ss->addUniform(new osg::Uniform("model_matrix", osg::Matrixf(model_matrix)));
+    ss->addUniform(new osg::Uniform("model_inverse_matrix", osg::Matrixf(osg::Matrixd::inverse(model_matrix))));
+    ss->addUniform(new osg::Uniform("image_matrix", osg::Matrixf(m_projection)));
+    ss->addUniform(new osg::Uniform("component_color", color));
+    ss->addUniform(new osg::Uniform("depth_range", osg::Vec2(m_near, m_far)));
+    ss->addUniform(new osg::Uniform("flip_image", image != nullptr && image->getOrigin() == osg::Image::TOP_LEFT));
+    ss->setAttributeAndModes(new osg::PolygonMode(osg::PolygonMode::FRONT_AND_BACK, osg::PolygonMode::FILL), osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    ss->setMode(GL_BLEND, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    return camera;
+}
@@ -0,0 +1,73 @@
+#ifndef OSG_TEXTURE_BAKER_HPP
+#define OSG_TEXTURE_BAKER_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/observer_ptr>
+#include <atomic>
+#include <vector>
+
+class GeneralizedCylinder;
+struct ProjectionParameters;
+
+/*
+ * Textures of the generalized cylinders baked from the oriented image on the GPU.
+ *
+ * The texture of a component is parameterized by the ring angle (u) and the section index (v) of
+ * GeneralizedCylinderGeometry::GetTexturedMesh. The passes run once, with the next frame of the
+ * viewer:
+ *  - the depth camera renders the model with the camera of the image (the identity view and the
+ *    perspective projection of the modelling) into a depth texture of the image size,
+ *  - the bake camera of each component rasterizes its textured mesh in the texture space, every
+ *    texel interpolates its point on the surface, projects it into the image and samples it. The
+ *    texels whose point is hidden by the depth texture, or faces away from the camera, keep the
+ *    color of the component. The texture is read back into an image.
+ * A texel costs a texture fetch on the GPU, the lookup of the image colors per vertex on the CPU
+ * would have to trace every vertex against the model for the same visibility.
+ *
+ * Collect applies the textures to the components that still exist once the passes are drawn and
+ * removes them from the scene. Both are called by the UI thread and modify the scene through the
+ * executor given, the update traversal of the frame (see OsgWxFrame::UsrEnqueueSceneUpdate), as the
+ * draw thread may still traverse the passes and the components.
+ */
+class OsgTextureBaker {
+public:
+    OsgTextureBaker(osg::Texture2D* image, const ProjectionParameters& pp, int texture_size);
+    osg::Node* GetRoot();
+    // the passes of the components under the model, false if there is nothing to bake
+    bool Bake(osg::Node* model, const std::vector<GeneralizedCylinder*>& components, const executor_type& scene_update);
+    bool IsBaking() const;
+    // the number of textured components once the passes are drawn, -1 before
+    int Collect(const executor_type& scene_update);
+
+private:
+    struct drawn_callback : public osg::Camera::DrawCallback {
+        mutable std::atomic<bool> drawn;
+        drawn_callback() : drawn(false) { }
+        void operator()(osg::RenderInfo& render_info) const override { drawn = true; }
+    };
+
+    struct bake_pass {
+        osg::observer_ptr<GeneralizedCylinder> component;
+        osg::ref_ptr<osg::Image> texture;
+    };
+
+    osg::ref_ptr<osg::Group> m_root;
+    osg::ref_ptr<osg::Texture2D> m_image;
+    osg::ref_ptr<osg::Texture2D> m_depth;               // of the model, image size
+    osg::ref_ptr<osg::Program> m_program;
+    osg::ref_ptr<drawn_callback> m_drawn;
+    osg::Matrixd m_projection;                          // of the image
+    std::vector<bake_pass> m_passes;
+    int m_width, m_height;                              // image size
+    int m_texture_size;
+    double m_near, m_far;
+
+    osg::Camera* create_depth_camera(osg::Node* model);
+    osg::Camera* create_bake_camera(GeneralizedCylinder* component, osg::Image* texture, int order);
+};
+
+#endif // OSG_TEXTURE_BAKER_HPP
@@ -0,0 +1,316 @@
+#include "OsgTextureCompressor.hpp"
+#include "../image/algorithms/GradientCache.hpp"
+
+#include <osg/Texture>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_LUMINANCE_LATC1_EXT
+#define GL_COMPRESSED_LUMINANCE_LATC1_EXT 0x8C70
+#endif
+
+static const char texture_cache_magic[8] = { 'C', 'V', 'M', 'B', 'L', 'K', '0', '1' };
+static const size_t texture_cache_header_size = 24;     // magic, format, width, height, origin
+static const size_t block_size = 8;                     // bytes of a BC1 or LATC1 block
+static const size_t block_rows_per_task = 16;
+
+static void write_uint32(unsigned char* dst, uint32_t value) {
+
+    for(int i = 0; i < 4; ++i)
+        dst[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+static uint32_t read_uint32(const unsigned char* src) {
+
+    return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+           (static_cast<uint32_t>(src[2]) << 16) | (static_cast<uint32_t>(src[3]) << 24);
+}
+
+static uint16_t pack_565(const int c[3]) {
+
+    return static_cast<uint16_t>(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+static void unpack_565(uint16_t v, int c[3]) {
+
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// the end points on the diagonal of the bounding box that follows the correlation of the channels
+static void encode_bc1(const unsigned char px[16][3], unsigned char* out) {
+
+    // Step-1: the bounding box, inset by 1/16 of its size against the outliers
+    int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 }, mean[3] = { 0, 0, 0 };
+    for(int i = 0; i < 16; ++i) {
+        for(int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], static_cast<int>(px[i][k]));
+            hi[k] = std::max(hi[k], static_cast<int>(px[i][k]));
+            mean[k] += px[i][k];
+        }
+    }
+    int cov[3] = { 0, 0, 0 };     // of the green and the blue with the red
+    for(int i = 0; i < 16; ++i) {
+        int r = 16 * px[i][0] - mean[0];
+        cov[1] += r * (16 * px[i][1] - mean[1]);
+        cov[2] += r * (16 * px[i][2] - mean[2]);
+    }
+    for(int k = 0; k < 3; ++k) {
+        int inset = (hi[k] - lo[k]) >> 4;
+        lo[k] += inset;
+        hi[k] -= inset;
+    }
+    for(int k = 1; k < 3; ++k)
+        if(cov[k] < 0) std::swap(lo[k], hi[k]);
+
+    // Step-2: the four color mode needs the first end point to be the larger one
+    uint16_t c0 = pack_565(hi), c1 = pack_565(lo);
+    if(c0 < c1) std::swap(c0, c1);
+    out[0] = static_cast<unsigned char>(c0);
+    out[1] = static_cast<unsigned char>(c0 >> 8);
+    out[2] = static_cast<unsigned char>(c1);
+    out[3] = static_cast<unsigned char>(c1 >> 8);
+    std::memset(out + 4, 0, 4);
+    if(c0 == c1) return;
+
+    // Step-3: the nearest color of the decoded palette for each texel
+    int pal[4][3];
+    unpack_565(c0, pal[0]);
+    unpack_565(c1, pal[1]);
+    for(int k = 0; k < 3; ++k) {
+        pal[2][k] = (2 * pal[0][k] + pal[1][k]) / 3;
+        pal[3][k] = (pal[0][k] + 2 * pal[1][k]) / 3;
+    }
+    uint32_t indices = 0;
+    for(int i = 0; i < 16; ++i) {
+        int best = 0, best_dist = 0x7fffffff;
+        for(int j = 0; j < 4; ++j) {
+            int dist = 0;
+            for(int k = 0; k < 3; ++k) {
+                int d = px[i][k] - pal[j][k];
+                dist += d * d;
+            }
+            if(dist < best_dist) {
+                best_dist = dist;
+                best = j;
+            }
+        }
+        indices |= static_cast<uint32_t>(best) << (2 * i);
+    }
+    write_uint32(out + 4, indices);
+}
+
+// the eight value mode between the extremes of the block
+static void encode_latc1(const unsigned char px[16], unsigned char* out) {
+
+    int lo = 255, hi = 0;
+    for(int i = 0; i < 16; ++i) {
+        lo = std::min(lo, static_cast<int>(px[i]));
+        hi = std::max(hi, static_cast<int>(px[i]));
+    }
+    out[0] = static_cast<unsigned char>(hi);
+    out[1] = static_cast<unsigned char>(lo);
+    std::memset(out + 2, 0, 6);
+    if(hi == lo) return;
+
+    // the codes 0 and 1 are the end points, 2 to 7 the interpolations from the first to the second
+    uint64_t indices = 0;
+    for(int i = 0; i < 16; ++i) {
+        int t = ((hi - px[i]) * 14 + (hi - lo)) / (2 * (hi - lo));    // rounded step from hi, 0 to 7
+        int code = (t == 0) ? 0 : (t == 7) ? 1 : t + 1;
+        indices |= static_cast<uint64_t>(code) << (3 * i);
+    }
+    for(int i = 0; i < 6; ++i)
+        out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+OsgTextureCompressor& OsgTextureCompressor::Instance() {
+
+    static OsgTextureCompressor instance;
+    return instance;
+}
+
+OsgTextureCompressor::OsgTextureCompressor() : m_enabled(false) { }
+
+void OsgTextureCompressor::SetEnabled(bool flag) {
+    m_enabled = flag;
+}
+
+bool OsgTextureCompressor::IsEnabled() const {
+    return m_enabled;
+}
+
+void OsgTextureCompressor::Compress(osg::Texture2D* texture, const std::string& path, executor_type executor) {
+
+    const osg::Image* source = texture->getImage();
+    if(source == nullptr || source->isCompressed()) return;
+
+    // Step-1: the image another frame has compressed, or a compression of the same file that is running
+    osg::ref_ptr<osg::Texture2D> target(texture);
+    osg::ref_ptr<osg::Image> image(const_cast<osg::Image*>(source));
+    if(!path.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        osg::ref_ptr<osg::Image> compressed;
+        if(m_images[path].lock(compressed)) {
+            apply(texture, compressed.get());
+            return;
+        }
+        std::vector<osg::observer_ptr<osg::Texture2D>>& pending = m_pending[path];
+        pending.push_back(texture);
+        if(pending.size() > 1) return;
+    }
+
+    // Step-2: the cached blocks or a new compression, on the thread pool
+    Job<osg::ref_ptr<osg::Image>> job = ThreadPool::Instance().Submit([image, path](const CancellationToken&) {
+        std::string cache_path = path.empty() ? std::string() : GradientCache::Instance().GetCacheFilePath(path, ".blk");
+        osg::ref_ptr<osg::Image> compressed = cache_path.empty() ? nullptr : read_cache(cache_path);
+        if(!compressed.valid()) {
+            compressed = CompressImage(*image);
+            if(compressed.valid() && !cache_path.empty() && !write_cache(*compressed, cache_path))
+                std::cout << "WARNING: Compressed texture is not cached: " << path << std::endl;
+        }
+        return compressed;
+    });
+
+    // Step-3: the textures that still exist switch to the compressed image
+    job.Then([this, target, path](const osg::ref_ptr<osg::Image>& compressed) {
+        if(path.empty()) {
+            if(compressed.valid()) apply(target.get(), compressed.get());
+            return;
+        }
+        std::vector<osg::observer_ptr<osg::Texture2D>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pending.swap(m_pending[path]);
+            m_pending.erase(path);
+            if(compressed.valid()) m_images[path] = compressed.get();
+        }
+        if(!compressed.valid()) return;
+        for(osg::observer_ptr<osg::Texture2D>& item : pending) {
+            osg::ref_ptr<osg::Texture2D> tex;
+            if(item.lock(tex)) apply(tex.get(), compressed.get());
+        }
+    }, executor);
+}
+
+osg::Image* OsgTextureCompressor::CompressImage(const osg::Image& image) {
+
+    // Step-1: the formats of the background images and of the baked textures
+    GLenum format = image.getPixelFormat();
+    GLenum type = image.getDataType();
+    int channels = 0;
+    bool bgr = (format == GL_BGR || format == GL_BGRA);
+    if(type == GL_UNSIGNED_BYTE && (format == GL_RGB || format == GL_BGR)) channels = 3;
+    else if(type == GL_UNSIGNED_BYTE && (format == GL_RGBA || format == GL_BGRA)) channels = 4;
+    else if((type == GL_UNSIGNED_BYTE || type == GL_FLOAT) && (format == GL_LUMINANCE || format == GL_RED)) channels = 1;
+    if(channels == 0 || image.s() <= 0 || image.t() <= 0 || image.r() != 1) return nullptr;
+
+    // Step-2: the blocks from the first row of the image on, the texels of the partial blocks are clamped
+    int width = image.s(), height = image.t();
+    size_t num_bx = (static_cast<size_t>(width) + 3) / 4, num_by = (static_cast<size_t>(height) + 3) / 4;
+    unsigned char* blocks = new unsigned char[num_bx * num_by * block_size];
+    ThreadPool::Instance().ParallelFor(0, num_by, block_rows_per_task, [&](size_t first, size_t last) {
+        unsigned char color[16][3], luminance[16];
+        for(size_t by = first; by < last; ++by) {
+            for(size_t bx = 0; bx < num_bx; ++bx) {
+                for(int i = 0; i < 16; ++i) {
+                    int x = std::min(static_cast<int>(4 * bx) + (i & 3), width - 1);
+                    int y = std::min(static_cast<int>(4 * by) + (i >> 2), height - 1);
+                    const unsigned char* px = image.data(x, y);
+                    if(channels == 1) {
+                        if(type == GL_FLOAT) {
+                            float v = *reinterpret_cast<const float*>(px);
+                            luminance[i] = static_cast<unsigned char>(std::max(0.0f, std::min(1.0f, v)) * 255.0f + 0.5f);
+                        }
+                        else {
+                            luminance[i] = px[0];
+                        }
+                    }
+                    else {
+                        for(int k = 0; k < 3; ++k)
+                            color[i][k] = px[bgr ? 2 - k : k];
+                    }
+                }
+                unsigned char* out = blocks + (by * num_bx + bx) * block_size;
+                if(channels == 1) encode_latc1(luminance, out);
+                else              encode_bc1(color, out);
+            }
+        }
+    });
+
+    GLenum compressed_format = (channels == 1) ? GL_COMPRESSED_LUMINANCE_LATC1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    osg::Image* compressed = new osg::Image;
+    compressed->setImage(width, height, 1, compressed_format, compressed_format, GL_UNSIGNED_BYTE, blocks, osg::Image::USE_NEW_DELETE);
+    compressed->setOrigin(image.getOrigin());
+    return compressed;
+}
+
+osg::Image* OsgTextureCompressor::read_cache(const std::string& cache_path) {
+
+    std::ifstream file(cache_path.c_str(), std::ios::in | std::ios::binary);
+    if(!file.good()) return nullptr;
+    unsigned char header[texture_cache_header_size];
+    if(!file.read(reinterpret_cast<char*>(header), texture_cache_header_size) ||
+       std::memcmp(header, texture_cache_magic, sizeof(texture_cache_magic)) != 0)
+        return nullptr;
+
+    GLenum format = read_uint32(header + 8);
+    int width = static_cast<int>(read_uint32(header + 12));
+    int height = static_cast<int>(read_uint32(header + 16));
+    uint32_t origin = read_uint32(header + 20);
+    if((format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && format != GL_COMPRESSED_LUMINANCE_LATC1_EXT) || width <= 0 || height <= 0)
+        return nullptr;
+    size_t size = ((static_cast<size_t>(width) + 3) / 4) * ((static_cast<size_t>(height) + 3) / 4) * block_size;
+    unsigned char* blocks = new unsigned char[size];
+    if(!file.read(reinterpret_cast<char*>(blocks), size)) {
+        delete[] blocks;
+        std::cout << "WARNING: Compressed texture cache entry is corrupt, the image is compressed again: " << cache_path << std::endl;
+        return nullptr;
+    }
+    osg::Image* image = new osg::Image;
+    image->setImage(width, height, 1, format, format, GL_UNSIGNED_BYTE, blocks, osg::Image::USE_NEW_DELETE);
+    image->setOrigin(origin ? osg::Image::TOP_LEFT : osg::Image::BOTTOM_LEFT);
+    return image;
+}
+
+bool OsgTextureCompressor::write_cache(const osg::Image& image, const std::string& cache_path) {
+
+    if(!GradientCache::Instance().MakeCacheDirectory()) return false;
+
+    // write to a temporary file first, then rename: other threads never read a partially written entry
+    std::string tmp_path = cache_path + "_" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!file.good()) return false;
+    unsigned char header[texture_cache_header_size];
+    std::memcpy(header, texture_cache_magic, sizeof(texture_cache_magic));
+    write_uint32(header + 8, static_cast<uint32_t>(image.getPixelFormat()));
+    write_uint32(header + 12, static_cast<uint32_t>(image.s()));
+    write_uint32(header + 16, static_cast<uint32_t>(image.t()));
+    write_uint32(header + 20, image.getOrigin() == osg::Image::TOP_LEFT ? 1u : 0u);
+    file.write(reinterpret_cast<const char*>(header), texture_cache_header_size);
+    file.write(reinterpret_cast<const char*>(image.data()), image.getTotalSizeInBytes());
+    file.close();
+    if(file.fail() || std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void OsgTextureCompressor::apply(osg::Texture2D* texture, osg::Image* image) {
+
+    // the blocks have no mipmaps, the background is drawn at the image size
+    texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+    texture->setImage(image);
+}
@@ -0,0 +1,59 @@
+#ifndef OSG_TEXTURE_COMPRESSOR_HPP
+#define OSG_TEXTURE_COMPRESSOR_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/observer_ptr>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Block compression of the background images and of the baked textures of the components.
+ *
+ * The color images are compressed to BC1 (DXT1, 4 bits per texel), the single channel ones, e.g. the
+ * gradient images, to LATC1 (the BC4 blocks sampled as luminance, 4 bits per texel): a 6x smaller
+ * texture than RGB and 2x smaller than a luminance texture, uploaded as it is. The blocks keep the
+ * row order of the image, thus its origin. The image of a texture is replaced by the compressed one
+ * once it is ready, the texture objects of the frames stay the same.
+ *
+ * The compression runs once on the thread pool. The compressed images are shared by the frames of
+ * the same source file and stored in the cache directory of the gradient images (see GradientCache),
+ * keyed by the content of the source file: any later window, or run, uploads the cached blocks. The
+ * images without a file, e.g. the baked textures, are compressed without the cache.
+ */
+class OsgTextureCompressor {
+public:
+    static OsgTextureCompressor& Instance();
+
+    void SetEnabled(bool flag);
+    bool IsEnabled() const;
+
+    // the image of the texture replaced by the compressed one, at once if it is cached and by the
+    // executor after the compression otherwise, the one of the scene updates of the frame as the image
+    // may be uploaded by the draw thread; path is the source file of the image, or empty
+    void Compress(osg::Texture2D* texture, const std::string& path, executor_type executor);
+
+    // BC1 for the 8 bit RGB(A) images, LATC1 for the luminance ones (8 bit or float in [0, 1]),
+    // nullptr for the other formats
+    static osg::Image* CompressImage(const osg::Image& image);
+
+private:
+    OsgTextureCompressor();
+    OsgTextureCompressor(const OsgTextureCompressor&) = delete;
+    OsgTextureCompressor& operator=(const OsgTextureCompressor&) = delete;
+
+    static osg::Image* read_cache(const std::string& cache_path);
+    static bool write_cache(const osg::Image& image, const std::string& cache_path);
+    static void apply(osg::Texture2D* texture, osg::Image* image);
+
+    std::atomic<bool> m_enabled;
+    std::mutex m_mutex;
+    std::map<std::string, osg::observer_ptr<osg::Image>> m_images;                 // compressed, by the source path
+    std::map<std::string, std::vector<osg::observer_ptr<osg::Texture2D>>> m_pending;    // waiting for their source path
+};
+
+#endif // OSG_TEXTURE_COMPRESSOR_HPP
@@ -0,0 +1,302 @@
+#include "OsgTiledImage.hpp"
+#include "../image/algorithms/ImageRepository.hpp"
+
+#include <osg/Geometry>
+#include <osg/Texture2D>
+#include <osgUtil/CullVisitor>
+
+#include <algorithm>
+#include <cmath>
+
+static const unsigned int idle_frames = 300;            // a tile not drawn for that many frames is released
+static const unsigned int max_resident_tiles = 192;     // budget of the resident tiles, 3 MB each
+static const int max_samples = 4;                       // samples per side of a texel of a coarse level
+
+class OsgTiledImage::tile_node : public osg::Group {
+public:
+    tile_node(int lvl, int x0, int y0, int x1, int y1, int image_height) :
+        level(lvl), x0(x0), y0(y0), x1(x1), y1(y1), last_frame(0), requested(false), resident(false), bytes(0) {
+
+        // the image rows are top down, the quads bottom up
+        osg::Vec3 center(0.5f * (x0 + x1), image_height - 0.5f * (y0 + y1), 0.0f);
+        m_bound = osg::BoundingSphere(center, 0.5f * std::sqrt(static_cast<float>((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0))));
+        m_corner = osg::Vec3(x0, image_height - y1, 0.0f);
+        setCullingActive(true);
+    }
+
+    osg::BoundingSphere computeBound() const override { return m_bound; }
+
+    void traverse(osg::NodeVisitor& nv) override {
+
+        osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(&nv);
+        if(cv == nullptr) osg::Group::traverse(nv);
+        else              cull(*cv);
+    }
+
+    void attach(osg::Image* image) {
+
+        osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D(image);
+        texture->setResizeNonPowerOfTwoHint(false);
+        texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+        // dynamic: the tile may be released while the draw thread still renders the previous frame
+        osg::Geometry* quad = osg::createTexturedQuadGeometry(m_corner, osg::Vec3(x1 - x0, 0.0f, 0.0f), osg::Vec3(0.0f, y1 - y0, 0.0f));
+        quad->setDataVariance(osg::Object::DYNAMIC);
+        geode = new osg::Geode;
+        geode->addDrawable(quad);
+        osg::StateSet* stateset = geode->getOrCreateStateSet();
+        stateset->setDataVariance(osg::Object::DYNAMIC);
+        stateset->setTextureAttributeAndModes(0, texture.get(), osg::StateAttribute::ON);
+        bytes = image->getTotalSizeInBytes();
+        resident = true;
+    }
+
+    void detach() {
+
+        resident = false;
+        bytes = 0;
+        geode = nullptr;
+    }
+
+    int level;
+    int x0, y0, x1, y1;                                 // image pixels, the top row is 0
+    std::atomic<unsigned int> last_frame;               // last frame that needed the tile
+    std::atomic<bool> requested;                        // by the cull traversal
+    std::atomic<bool> resident;
+    std::atomic<size_t> bytes;                          // of the image, 0 unless resident
+    osg::ref_ptr<osg::Geode> geode;
+    Job<osg::ref_ptr<osg::Image>> job;
+
+private:
+    osg::BoundingSphere m_bound;
+    osg::Vec3 m_corner;
+
+    // draws the tile, or its children if they have a higher and needed resolution
+    void cull(osgUtil::CullVisitor& cv) {
+
+        unsigned int frame = cv.getFrameStamp() ? cv.getFrameStamp()->getFrameNumber() : 0;
+        last_frame = frame;
+
+        // Step-1: a texel of the tile is 2^level image pixels, the children are needed if it covers more than a viewport pixel
+        osg::Matrix mvp = (*cv.getModelViewMatrix()) * (*cv.getProjectionMatrix());
+        double pixels_per_unit = 0.5 * cv.getViewport()->width() * std::sqrt(mvp(0,0) * mvp(0,0) + mvp(1,0) * mvp(1,0));
+        if(getNumChildren() > 0 && (1 << level) * pixels_per_unit > 1.0) {
+
+            // Step-2: the visible children, drawn only once all of them are resident
+            bool ready = true;
+            for(unsigned int i = 0; i < getNumChildren(); ++i) {
+                tile_node* child = static_cast<tile_node*>(getChild(i));
+                if(cv.isCulled(child->getBound()) || child->resident) continue;
+                child->last_frame = frame;
+                child->requested = true;
+                ready = false;
+            }
+            if(ready) {
+                for(unsigned int i = 0; i < getNumChildren(); ++i) {
+                    tile_node* child = static_cast<tile_node*>(getChild(i));
+                    if(!cv.isCulled(child->getBound())) child->cull(cv);
+                }
+                return;
+            }
+        }
+
+        // Step-3: the tile itself, meanwhile the coarser parent is drawn
+        if(!resident) {
+            requested = true;
+            return;
+        }
+        geode->accept(cv);
+    }
+};
+
+class OsgTiledImage::update_callback : public osg::NodeCallback {
+public:
+    explicit update_callback(OsgTiledImage* owner) : m_owner(owner) { }
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override {
+        if(nv->getFrameStamp()) m_owner->update(nv->getFrameStamp()->getFrameNumber());
+    }
+private:
+    OsgTiledImage* m_owner;
+};
+
+bool OsgTiledImage::IsTiled(const SharedImage& image) {
+    return std::max(image.GetWidth(), image.GetHeight()) > max_single_texture_size;
+}
+
+OsgTiledImage::OsgTiledImage(const std::shared_ptr<const SharedImage>& image, int tile_size) :
+    m_image(image),
+    m_tile_size(tile_size),
+    m_num_resident(0),
+    m_frame_number(0),
+    m_evict_bytes(0),
+    m_memory(memory_category::textures) {
+
+    // the coarsest level fits into a single tile
+    int level = 0;
+    while((m_tile_size << level) < std::max(image->GetWidth(), image->GetHeight()))
+        ++level;
+    m_root = create_tile(level, 0, 0, image->GetWidth(), image->GetHeight());
+    m_root->setUpdateCallback(new update_callback(this));
+    m_evictor = MemoryRegistry::Instance().RegisterEvictor(eviction_order::image_tiles, [this](size_t bytes) { return evict(bytes); });
+}
+
+OsgTiledImage::~OsgTiledImage() {
+
+    // the root may outlive the pyramid in the scene graph
+    MemoryRegistry::Instance().UnregisterEvictor(m_evictor);
+    m_root->setUpdateCallback(nullptr);
+    for(tile_node* tile : m_tiles)
+        tile->job.Cancel();
+}
+
+osg::Node* OsgTiledImage::GetRoot() {
+    return m_root.get();
+}
+
+int OsgTiledImage::GetWidth() const {
+    return m_image->GetWidth();
+}
+
+int OsgTiledImage::GetHeight() const {
+    return m_image->GetHeight();
+}
+
+unsigned int OsgTiledImage::GetNumResidentTiles() const {
+    return m_num_resident;
+}
+
+bool OsgTiledImage::HasPendingTiles() const {
+
+    if(m_evict_bytes > 0) return true;
+    for(const tile_node* tile : m_tiles) {
+        if(tile->requested || tile->job.IsValid()) return true;
+    }
+    return false;
+}
+
+OsgTiledImage::tile_node* OsgTiledImage::create_tile(int level, int x0, int y0, int x1, int y1) {
+
+    tile_node* tile = new tile_node(level, x0, y0, x1, y1, m_image->GetHeight());
+    m_tiles.push_back(tile);
+    if(level == 0) return tile;
+
+    // the children split the tile at the pixel boundaries of the next level
+    int half = m_tile_size << (level - 1);
+    for(int y = y0; y < y1; y += half) {
+        for(int x = x0; x < x1; x += half)
+            tile->addChild(create_tile(level - 1, x, y, std::min(x + half, x1), std::min(y + half, y1)));
+    }
+    return tile;
+}
+
+void OsgTiledImage::update(unsigned int frame_number) {
+
+    std::vector<tile_node*> resident;
+    for(tile_node* tile : m_tiles) {
+
+        // Step-1: attach the tiles whose images are ready
+        if(tile->job.IsValid()) {
+            if(!tile->job.IsReady()) continue;
+            osg::ref_ptr<osg::Image> image = tile->job.Get();
+            tile->job.Reset();
+            if(image.valid()) {
+                tile->attach(image.get());
+                ++m_num_resident;
+            }
+        }
+
+        // Step-2: the requested tiles are created on the thread pool
+        else if(tile->requested && !tile->resident) {
+            std::shared_ptr<const SharedImage> pixels = m_image;
+            int level = tile->level, x0 = tile->x0, y0 = tile->y0, x1 = tile->x1, y1 = tile->y1;
+            tile->job = ThreadPool::Instance().Submit([pixels, level, x0, y0, x1, y1](const CancellationToken&) {
+                return create_tile_image(*pixels, level, x0, y0, x1, y1);
+            });
+        }
+        tile->requested = false;
+        if(tile->resident && tile != m_root.get()) resident.push_back(tile);
+    }
+
+    // Step-3: release the idle tiles and the least recently needed ones beyond the budget
+    // (the tiles needed by the last frame are kept even beyond the budget)
+    std::sort(resident.begin(), resident.end(), [](const tile_node* a, const tile_node* b) { return a->last_frame > b->last_frame; });
+    for(size_t i = 0; i < resident.size(); ++i) {
+        unsigned int idle = frame_number - resident[i]->last_frame;
+        if(idle > idle_frames || (i >= max_resident_tiles && idle > 1)) {
+            resident[i]->detach();
+            --m_num_resident;
+        }
+    }
+
+    // Step-4: the bytes evicted by the memory budget, the least recently needed tiles first
+    size_t evict_bytes = m_evict_bytes.exchange(0);
+    for(size_t i = resident.size(); i > 0 && evict_bytes > 0; --i) {
+        tile_node* tile = resident[i - 1];
+        if(!tile->resident || frame_number - tile->last_frame <= 1) continue;
+        evict_bytes -= std::min(evict_bytes, tile->bytes.load());
+        tile->detach();
+        --m_num_resident;
+    }
+
+    size_t bytes = 0;
+    for(const tile_node* tile : m_tiles)
+        bytes += tile->bytes;
+    m_memory.Set(bytes);
+    m_frame_number = frame_number;
+}
+
+size_t OsgTiledImage::evict(size_t bytes) {
+
+    // the bytes of the tiles the next update is going to release, not the ones of the last frame
+    unsigned int frame_number = m_frame_number;
+    size_t releasable = 0;
+    for(const tile_node* tile : m_tiles) {
+        if(tile != m_root.get() && tile->resident && frame_number - tile->last_frame > 1)
+            releasable += tile->bytes;
+    }
+    size_t scheduled = std::min(bytes, releasable);
+    m_evict_bytes += scheduled;
+    return scheduled;
+}
+
+osg::ref_ptr<osg::Image> OsgTiledImage::create_tile_image(const SharedImage& image, int level, int x0, int y0, int x1, int y1) {
+
+    // Step-1: a texel is the mean of up to max_samples x max_samples pixels of its 2^level x 2^level block
+    int step = 1 << level;
+    int width = (x1 - x0 + step - 1) / step;
+    int height = (y1 - y0 + step - 1) / step;
+    int num_samples = std::min(step, max_samples);
+    osg::ref_ptr<osg::Image> tile = new osg::Image;
+    tile->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, 1);
+    const unsigned char* src = image.GetData();
+    size_t stride = 3 * static_cast<size_t>(image.GetWidth());
+
+    for(int j = 0; j < height; ++j) {
+        // Step-2: the rows of the texture are bottom up
+        unsigned char* dst = tile->data(0, height - 1 - j);
+        int by0 = y0 + j * step;
+        int by1 = std::min(by0 + step, y1);
+        for(int i = 0; i < width; ++i, dst += 3) {
+            int bx0 = x0 + i * step;
+            int bx1 = std::min(bx0 + step, x1);
+            unsigned int sum[3] = { 0, 0, 0 };
+            unsigned int count = 0;
+            for(int sy = 0; sy < num_samples; ++sy) {
+                const unsigned char* row = src + static_cast<size_t>(by0 + (sy * (by1 - by0)) / num_samples) * stride;
+                for(int sx = 0; sx < num_samples; ++sx) {
+                    const unsigned char* px = row + 3 * static_cast<size_t>(bx0 + (sx * (bx1 - bx0)) / num_samples);
+                    sum[0] += px[0];
+                    sum[1] += px[1];
+                    sum[2] += px[2];
+                    ++count;
+                }
+            }
+            for(int c = 0; c < 3; ++c)
+                dst[c] = static_cast<unsigned char>((sum[c] + count / 2) / count);
+        }
+    }
+    return tile;
+}
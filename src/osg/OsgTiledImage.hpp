@@ -0,0 +1,72 @@
+#ifndef OSG_TILED_IMAGE_HPP
+#define OSG_TILED_IMAGE_HPP
+
+#include "../utility/MemoryRegistry.hpp"
+#include "../utility/ThreadPool.hpp"
+#include <osg/Group>
+#include <osg/Geode>
+#include <osg/Image>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class SharedImage;
+
+/*
+ * Background image as a quadtree of texture tiles for images larger than a single texture.
+ *
+ * The quadtree is a mipmap pyramid: a tile of level k covers 2^k x tile_size image pixels on each side,
+ * the root is the coarsest level that fits into one tile and the leaves are the full resolution tiles.
+ * The cull traversal descends into the children of a tile only as long as a texel of the tile is larger
+ * than a pixel of the viewport, and only into the children within the view frustum. A tile that is
+ * needed but not resident yet is requested and its parent is drawn until it is ready. With the current
+ * fixed view of the whole image the level follows the size of the viewport; with zoom and pan the
+ * frustum and the level select the visible tiles at the needed resolution.
+ *
+ * The update traversal pages the tiles: the requested tile images are downsampled from the shared pixels
+ * on the thread pool and attached once they are ready, the tiles not drawn for a while (or the least
+ * recently drawn ones beyond the budget) are detached, which releases their textures. The root tile is
+ * never released. The image coordinates of the quads are the ones of create_textured_quad, (0,0) is the
+ * bottom left corner of the image.
+ *
+ * The resident tiles are reported to the MemoryRegistry. Its budget evicts the least recently drawn
+ * tiles (the coarse levels as well as the full resolution ones) by the next update traversal, the ones
+ * needed by the last frame are kept.
+ */
+class OsgTiledImage {
+public:
+    static const int default_tile_size = 1024;
+    static const int max_single_texture_size = 4096;     // larger images are tiled
+    static bool IsTiled(const SharedImage& image);
+
+    explicit OsgTiledImage(const std::shared_ptr<const SharedImage>& image, int tile_size = default_tile_size);
+    ~OsgTiledImage();
+    osg::Node* GetRoot();
+    int GetWidth() const;
+    int GetHeight() const;
+    unsigned int GetNumResidentTiles() const;
+    // tiles requested, being created or evicted, the frames are rendered on demand and a frame attaches
+    // (or releases) them
+    bool HasPendingTiles() const;
+
+private:
+    class tile_node;
+    class update_callback;
+
+    std::shared_ptr<const SharedImage> m_image;
+    int m_tile_size;
+    osg::ref_ptr<tile_node> m_root;
+    std::vector<tile_node*> m_tiles;                    // all tiles, owned by the quadtree
+    unsigned int m_num_resident;
+    std::atomic<unsigned int> m_frame_number;           // of the last update
+    std::atomic<size_t> m_evict_bytes;                  // released by the next update
+    MemoryRegistry::Allocation m_memory;                // bytes of the resident tile images
+    int m_evictor;
+
+    tile_node* create_tile(int level, int x0, int y0, int x1, int y1);
+    void update(unsigned int frame_number);
+    size_t evict(size_t bytes);
+    static osg::ref_ptr<osg::Image> create_tile_image(const SharedImage& image, int level, int x0, int y0, int x1, int y1);
+};
+
+#endif // OSG_TILED_IMAGE_HPP
@@ -0,0 +1,32 @@
+#include "OsgUpdateQueue.hpp"
+
+void OsgUpdateQueue::Enqueue(std::function<void()> mutation) {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back(std::move(mutation));
+}
+
+bool OsgUpdateQueue::HasPending() const {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pending.empty();
+}
+
+executor_type OsgUpdateQueue::GetExecutor() {
+
+    osg::ref_ptr<OsgUpdateQueue> queue(this);
+    return [queue](std::function<void()> f) { queue->Enqueue(std::move(f)); };
+}
+
+void OsgUpdateQueue::operator()(osg::Node* node, osg::NodeVisitor* nv) {
+
+    // the mutations may enqueue others, they are taken out of the lock
+    std::vector<std::function<void()>> mutations;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        mutations.swap(m_pending);
+    }
+    for(auto& mutation : mutations)
+        mutation();
+    traverse(node, nv);
+}
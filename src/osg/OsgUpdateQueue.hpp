@@ -0,0 +1,35 @@
+#ifndef OSG_UPDATE_QUEUE_HPP
+#define OSG_UPDATE_QUEUE_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/NodeCallback>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+ * Mutations of the scene graph applied by the update traversal.
+ *
+ * With the multi-threaded models of the viewer (DrawThreadPerContext and
+ * CullThreadPerCameraDrawThreadPerContext) the draw thread of a frame may still be dispatching the
+ * geometries when the wx event handlers run, modifying a geometry of the modeller there races with
+ * it. The viewer only synchronizes the update traversal: it starts after the dynamic objects of the
+ * previous frame are drawn. Thus the event handlers and the background jobs enqueue their mutations
+ * and the queue, the update callback of the root node, applies them in order at the start of the
+ * update traversal, on the thread calling frame() (the UI thread). A mutation enqueued during the
+ * update is applied by the next frame, the owner requests a redraw after enqueueing.
+ */
+class OsgUpdateQueue : public osg::NodeCallback {
+public:
+    void Enqueue(std::function<void()> mutation);
+    bool HasPending() const;
+    // continuations of the ThreadPool jobs applied by the update traversal
+    executor_type GetExecutor();
+    void operator()(osg::Node* node, osg::NodeVisitor* nv) override;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::function<void()>> m_pending;
+};
+
+#endif // OSG_UPDATE_QUEUE_HPP
@@ -1,5 +1,7 @@
 #include "OsgUtility.hpp"
+#include "OsgStateSetPool.hpp"
 #include "../geometry/Circle3D.hpp"
+#include "../image/algorithms/ImageRepository.hpp"
 
 #include <osg/MatrixTransform>
 #include <osgViewer/View>
@@ -7,9 +9,7 @@
 #include <osg/Depth>
 #include <osg/Texture2D>
 #include <osg/ShapeDrawable>
-#include <osg/LineWidth>
-
-#include <wx/gdicmn.h>
+#include <osg/TexMat>
 
 #include <Eigen/Dense>
 
@@ -30,29 +30,72 @@ osg::Camera* create_background_camera(int left, int right, int bottom, int top)
     return camera;
 }
 
-osg::Geode* create_textured_quad( osg::Image* image, wxSize& size) {
-
-    size.x = image->s();
-    size.y = image->t();
-
-    // Create the geometry
-    osg::Vec3 pos_vec = osg::Vec3(0.0f, 0.0f, 0.0f);
-    osg::Vec3 width_vec(image->s(), 0.0f, 0.0);
-    osg::Vec3 height_vec(0.0, image->t(), 0.0);
-    osg::Geometry* quad = osg::createTexturedQuadGeometry(pos_vec, width_vec, height_vec);
+osg::Geode* create_textured_quad(osg::Image* image, int& width, int& height) {
 
     // Add texture to the geometry
     osg::Texture2D* texture = new osg::Texture2D();
     texture->setResizeNonPowerOfTwoHint(false);
     texture->setImage(image);
+    return create_textured_quad(texture, width, height);
+}
+
+osg::Geode* create_textured_quad(osg::Texture2D* texture, int& width, int& height) {
+
+    const osg::Image* image = texture->getImage();
+    width = image->s();
+    height = image->t();
+    osg::Geode* tex_geode = create_textured_quad(width, height);
+    set_quad_texture(tex_geode->getOrCreateStateSet(), texture);
+    return tex_geode;
+}
+
+osg::Geode* create_textured_quad(int width, int height) {
+
+    // Create the geometry
+    osg::Vec3 pos_vec = osg::Vec3(0.0f, 0.0f, 0.0f);
+    osg::Vec3 width_vec(width, 0.0f, 0.0);
+    osg::Vec3 height_vec(0.0, height, 0.0);
+    osg::Geometry* quad = osg::createTexturedQuadGeometry(pos_vec, width_vec, height_vec);
 
     osg::Geode* tex_geode = new osg::Geode;
     tex_geode->addDrawable(quad);
-    osg::StateSet* stateset = tex_geode->getOrCreateStateSet();
-    stateset->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
     return tex_geode;
 }
 
+void set_quad_texture(osg::StateSet* stateset, osg::Texture2D* texture) {
+
+    stateset->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+    const osg::Image* image = texture->getImage();
+    if(image != nullptr && image->getOrigin() == osg::Image::TOP_LEFT)
+        stateset->setTextureAttribute(0, new osg::TexMat(osg::Matrix::scale(1.0, -1.0, 1.0) * osg::Matrix::translate(0.0, 1.0, 0.0)));
+    else
+        stateset->removeTextureAttribute(0, osg::StateAttribute::TEXMAT);
+}
+
+// keeps the shared pixels of an osg::Image alive
+struct shared_image_holder : public osg::Referenced {
+    explicit shared_image_holder(const std::shared_ptr<const SharedImage>& img) : image(img) { }
+    std::shared_ptr<const SharedImage> image;
+};
+
+osg::Image* create_image_view(const std::shared_ptr<const SharedImage>& image) {
+
+    // the rows are tightly packed, the texture is uploaded with an unpack alignment of 1
+    osg::Image* view = new osg::Image;
+    view->setImage(image->GetWidth(), image->GetHeight(), 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
+                   const_cast<unsigned char*>(image->GetData()), osg::Image::NO_DELETE, 1);
+    view->setOrigin(osg::Image::TOP_LEFT);
+    view->setUserData(new shared_image_holder(image));
+    return view;
+}
+
+osg::Image* read_image(const std::string& path, bool shared_pixels) {
+
+    if(!shared_pixels) return osgDB::readImageFile(path);
+    std::shared_ptr<const SharedImage> image = ImageRepository::Instance().Acquire(path);
+    return image ? create_image_view(image) : nullptr;
+}
+
 osg::Geometry* create_3D_circle(const Circle3D& circle, int approx) {
 
     osg::Geometry* circleGeom = new osg::Geometry();
@@ -106,10 +149,10 @@ osg::Geode* display_lines(osg::Vec3Array* vertices, const osg::Vec4d& color) {
     geom->setColorBinding(osg::Geometry::BIND_OVERALL);
     geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINES, 0, vertices->size()));
     geode->addDrawable(geom.release());
-    osg::LineWidth* linewidth = new osg::LineWidth();
-    linewidth->setWidth(0.3);
-    geode->getOrCreateStateSet()->setAttributeAndModes(linewidth, osg::StateAttribute::ON);
-    geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    // the normals of all the sections share the line state
+    render_state lines;
+    lines.line_width = 0.3f;
+    geode->setStateSet(StateSetPool::Instance().Get(lines));
     return geode.release();
 }
 
@@ -124,59 +167,34 @@ osg::Geode* display_point(const osg::Vec3d& pt, const osg::Vec4d& color) {
 }
 
 
-// given two 3D circles, this function calculates the
-// transformation matrix that transforms circle1 to circle2.
-void calculate_transformation_matrix(const Circle3D& circle1, const Circle3D& circle2, osg::Matrixd& mat) {
-
-    // 1) translate to the origin
-    osg::Matrixd mat_org = osg::Matrixd::identity();
-    mat_org(0,3) = -circle1.center[0];
-    mat_org(1,3) = -circle1.center[1];
-    mat_org(2,3) = -circle1.center[2];
-
-    // 2) scaling
-    double scale = circle2.radius / circle1.radius;
-    osg::Matrixd mat_scale = osg::Matrixd::identity();
-    mat_scale(0,0) = scale;
-    mat_scale(1,1) = scale;
-    mat_scale(2,2) = scale;
+// the transformation that moves circle1 to the origin, scales it by s, rotates it by R and moves it to the
+// center of circle2, in column vector format: [s R | c2 - s R c1], composed directly instead of as the
+// product of four 4x4 matrices. The rotation is the one of osg::Matrixd::rotate, transposed.
+static void compose_circle_transformation(const Circle3D& circle1, const Circle3D& circle2, double scale, osg::Matrixd& mat) {
 
-    // 3) rotation
     Eigen::Vector3d rot_axis = circle1.normal.cross(circle2.normal);
     osg::Matrixd mat_rotate = osg::Matrixd::rotate(acos(circle1.normal.dot(circle2.normal)), rot_axis[0], rot_axis[1], rot_axis[2]);
-    transpose(mat_rotate, 4); // since osg uses row vector format
+    mat = osg::Matrixd::identity();
+    for(int i = 0; i < 3; ++i) {
+        double t = circle2.center[i];
+        for(int j = 0; j < 3; ++j) {
+            mat(i,j) = scale * mat_rotate(j,i);
+            t -= mat(i,j) * circle1.center[j];
+        }
+        mat(i,3) = t;
+    }
+}
 
-    // 4) translate to the position of the circle-2
-    osg::Matrixd mat_trans = osg::Matrixd::identity();
-    mat_trans(0,3) = circle2.center[0];
-    mat_trans(1,3) = circle2.center[1];
-    mat_trans(2,3) = circle2.center[2];
+// given two 3D circles, this function calculates the
+// transformation matrix that transforms circle1 to circle2.
+void calculate_transformation_matrix(const Circle3D& circle1, const Circle3D& circle2, osg::Matrixd& mat) {
 
-    // 5) combined transformation matrix
-    mat = mat_trans * mat_rotate * mat_scale * mat_org;
+    compose_circle_transformation(circle1, circle2, circle2.radius / circle1.radius, mat);
 }
 
 void calculate_transformation_matrix_without_scale(const Circle3D& circle1, const Circle3D& circle2, osg::Matrixd& mat) {
 
-    // 1) translation matrix to translate circle-1 to the origin
-    osg::Matrixd mat_org = osg::Matrixd::identity();
-    mat_org(0,3) = -circle1.center[0];
-    mat_org(1,3) = -circle1.center[1];
-    mat_org(2,3) = -circle1.center[2];
-
-    // 2) rotation matrix to align circle-1 normal to circle-2 normal
-    Eigen::Vector3d rot_axis = circle1.normal.cross(circle2.normal);
-    osg::Matrixd mat_rotate = osg::Matrixd::rotate(acos(circle1.normal.dot(circle2.normal)), rot_axis[0], rot_axis[1], rot_axis[2]);
-    transpose(mat_rotate, 4);
-
-    // 3) translation matrix to transalte circle-1 to the center of circle-2
-    osg::Matrixd mat_trans = osg::Matrixd::identity();
-    mat_trans(0,3) = circle2.center[0];
-    mat_trans(1,3) = circle2.center[1];
-    mat_trans(2,3) = circle2.center[2];
-
-    // 4) combined transformation matrix
-    mat = mat_trans * mat_rotate * mat_org;
+    compose_circle_transformation(circle1, circle2, 1.0, mat);
 }
 
 double squared_distance(const osg::Vec3d& pt1, const osg::Vec3d& pt2) {
@@ -187,7 +205,7 @@ void print_3x4_camera_projection_matrix(const osg::Camera * const cam) {
 
     std::cout << "3x4 camera  projection matrix when column vector format is used:" << std::endl;
     osg::Matrixd mat = cam->getProjectionMatrix();
-    transpose(mat, 4);
+    transpose<4>(mat);
     osg::Matrix3x4d mat_proj;
     for(size_t i = 0; i < 2; ++i)
         for(size_t j = 0; j < 4; ++j)
@@ -202,7 +220,7 @@ void print_camera_projection_matrix(const osg::Camera* const cam) {
 
     std::cout << "Projection matrix when column vector format is used:" << std::endl;
     osg::Matrixd mat_transposed;
-    transpose(cam->getProjectionMatrix(), mat_transposed, 4);
+    transpose<4, 4>(cam->getProjectionMatrix(), mat_transposed);
     print_matrix(mat_transposed, 4, 4);
 }
 
@@ -210,7 +228,7 @@ void print_camera_modelview_matrix(const osg::Camera* const cam) {
 
     std::cout << "Model-view matrix when column vector format is used:" << std::endl;
     osg::Matrixd mat_transposed;
-    transpose(cam->getViewMatrix(), mat_transposed, 4);
+    transpose<4, 4>(cam->getViewMatrix(), mat_transposed);
     print_matrix(mat_transposed, 4, 4);
 }
 
@@ -218,7 +236,7 @@ void print_camera_viewport_mapping_matrix(const osg::Camera * const cam) {
 
     std::cout << "viewport mapping matrix when column vector format is used:" << std::endl;
     osg::Matrixd mat_transposed;
-    transpose(cam->getViewport()->computeWindowMatrix(), mat_transposed, 4);
+    transpose<4, 4>(cam->getViewport()->computeWindowMatrix(), mat_transposed);
     print_matrix(mat_transposed, 4, 4);
 }
 
@@ -256,7 +274,7 @@ void print_camera_manipulator_matrix(osgGA::CameraManipulator* manipulator) {
 
     std::cout << "Camera manipulator matrix: " << std::endl;
     osg::Matrixd mat_transposed;
-    transpose(manipulator->getMatrix(), mat_transposed, 4);
+    transpose<4, 4>(manipulator->getMatrix(), mat_transposed);
     print_matrix(mat_transposed, 4, 4);
 }
 
@@ -2,14 +2,26 @@
 #define OSGUTILIY_HPP
 
 #include <iostream>
+#include <utility>
 #include <osg/Camera>
+#include <osg/Texture2D>
 #include <osgGA/CameraManipulator>
+#include <memory>
 
-class wxSize;
 class Circle3D;
+class SharedImage;
 
 osg::Camera* create_background_camera(int left, int right, int bottom, int top);
-osg::Geode* create_textured_quad(osg::Image* image, wxSize& size);
+osg::Geode* create_textured_quad(osg::Image* image, int& width, int& height);
+osg::Geode* create_textured_quad(osg::Texture2D* texture, int& width, int& height);
+// a quad of the image size without a texture, see set_quad_texture
+osg::Geode* create_textured_quad(int width, int height);
+// the texture of a quad, the rows of a top-left origin image are flipped by a texture matrix
+void set_quad_texture(osg::StateSet* stateset, osg::Texture2D* texture);
+// an image on the pixels of the shared image (top-left origin), the image keeps the pixels alive
+osg::Image* create_image_view(const std::shared_ptr<const SharedImage>& image);
+// the view of the ImageRepository or, for the other files (e.g. the gradient images), osgDB::readImageFile
+osg::Image* read_image(const std::string& path, bool shared_pixels);
 osg::Geometry* create_3D_circle(const Circle3D& circle, int approx);
 osg::MatrixTransform* display_vector3d(const osg::Vec3d& pt, const osg::Vec3d& vec, const osg::Vec4d& color);
 osg::Geode* display_lines(osg::Vec3Array* vertices, const osg::Vec4d& color);
@@ -87,4 +99,25 @@ void multiply(const Matrix1& mat1, int r1, int c1, const Matrix2& mat2, int r2,
     }
 }
 
+/*
+ * Fixed size versions of transpose: the dimensions are template arguments, thus the loops of the
+ * 4x4 camera and transformation matrices are unrolled by the compiler. The versions above with the
+ * sizes at run time are kept for the other shapes.
+ */
+template<int Size, typename Matrix>
+void transpose(Matrix& mat) {
+
+    for(int i = 0; i < Size; ++i)
+        for(int j = i + 1; j < Size; ++j)
+            std::swap(mat(i,j), mat(j,i));
+}
+
+template<int Rows, int Cols, typename Matrix1, typename Matrix2>
+void transpose(const Matrix1& mat1, Matrix2& mat2) {
+
+    for(int i = 0; i < Rows; ++i)
+        for(int j = 0; j < Cols; ++j)
+            mat2(i,j) = mat1(j,i);
+}
+
 #endif // OSGUTILIY_HPP
@@ -1,40 +1,86 @@
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <unordered_set>
 
 #include "../geometry/Circle3D.hpp"
 #include "OsgWxFrame.hpp"
+#include "CompactModel.hpp"
 #include "OsgWxGLCanvas.hpp"
 #include "OsgWxGraphicsWindow.hpp"
 #include "OsgUtility.hpp"
+#include "OsgComponentHierarchy.hpp"
+#include "OsgComponentIndex.hpp"
+#include "OsgFrozenComponents.hpp"
+#include "OsgGradientShader.hpp"
+#include "OsgOrderIndependentTransparency.hpp"
+#include "OsgReprojectionErrorMap.hpp"
+#include "OsgTextureBaker.hpp"
+#include "OsgTextureCompressor.hpp"
+#include "OsgTiledImage.hpp"
+#include "PointCloudOctree.hpp"
+#include "SharedViewer.hpp"
 #include "../MainFrame.hpp"
 #include "../wx/WxUtility.hpp"
 #include "../wx/WxGuiId.hpp"
+#include "../modeller/CameraView.hpp"
 #include "../modeller/ImageModeller.hpp"
+#include "../modeller/ProjectFile.hpp"
 #include "../modeller/ProjectionParameters.hpp"
+#include "../modeller/components/PrimitiveComponent.hpp"
 #include "../modeller/gui/ComponentRelationsDialog.hpp"
+#include "../modeller/gui/GradientDisplayDialog.hpp"
 #include "../modeller/optimization/ModelSolver.hpp"
+#include "../modeller/optimization/MultiViewSolver.hpp"
+#include "../modeller/optimization/RelationDetector.hpp"
+#include "../image/algorithms/GradientCache.hpp"
+#include "../image/algorithms/ImageRepository.hpp"
+#include "../batch/InteractionTrace.hpp"
 
 #include <wx/menu.h>
+#include <wx/choicdlg.h>
+#include <wx/textdlg.h>
 #include <wx/filedlg.h>
+#include <wx/filefn.h>
 
 #include <osg/ValueObject>
+#include <osg/KdTree>
 #include <osg/Group>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
-#include <osgDB/WriteFile>
 #include <osg/MatrixTransform>
 #include <osgGA/TrackballManipulator>
 #include <osgViewer/ViewerEventHandlers>
 #include <osg/Image>
 
-// #include <OriLight/Orientation.hpp>
+static const double job_poll_period = 0.05;         // seconds
+static const double pick_poll_period = 0.005;       // seconds
+static const double limited_frame_rate = 30.0;      // frames per second
+static const double project_component_budget = 0.01; // seconds of an idle event spent on the components of a project
+// projection of an image without calibration and the clipping planes of the main camera
+static const int baked_texture_size = 1024;         // texels of a baked texture along the ring and the axis
+
+static const double default_fovy = 45.0;
+static const double default_near = 1.0;
+static const double default_far = 100.0;
 
 BEGIN_EVENT_TABLE(OsgWxFrame, wxFrame)
 EVT_IDLE(OsgWxFrame::OnIdle)
+EVT_TIMER(wxID_OSG_FRAME_TIMER, OsgWxFrame::OnFrameTimer)
 EVT_CLOSE(OsgWxFrame::OnClose)
 EVT_MENU(wxID_EXIT, OsgWxFrame::OnExit)
 EVT_MENU(wxID_OSG_OPEN_MODEL, OsgWxFrame::OnOpenModel)
+EVT_MENU(wxID_OSG_CANCEL_LOADING, OsgWxFrame::OnCancelLoading)
 EVT_MENU(wxID_OSG_OPEN_IMAGE, OsgWxFrame::OnOpenOrientedImage)
+EVT_MENU(wxID_OSG_OPEN_PROJECT, OsgWxFrame::OnOpenProject)
 EVT_MENU(wxID_MODES_PERSPECTIVE_PROJECTION, OsgWxFrame::OnToggleProjectionMode)
 EVT_MENU(wxID_MODES_ORTHOGRAPHIC_PROJECTION, OsgWxFrame::OnToggleProjectionMode)
+EVT_MENU(wxID_MODES_LIMIT_FRAME_RATE, OsgWxFrame::OnToggleFrameRateLimit)
+EVT_MENU(wxID_MODES_KDTREE_PICKING, OsgWxFrame::OnToggleKdTreePicking)
+EVT_MENU(wxID_MODES_COLOR_ID_PICKING, OsgWxFrame::OnToggleColorIdPicking)
+EVT_MENU(wxID_MODES_COMPRESS_TEXTURES, OsgWxFrame::OnToggleTextureCompression)
+EVT_MENU(wxID_MODES_ORDER_INDEPENDENT_TRANSPARENCY, OsgWxFrame::OnToggleOrderIndependentTransparency)
 EVT_MENU(wxID_MODES_RENDER_MODE_POINT, OsgWxFrame::OnToggleRenderMode)
 EVT_MENU(wxID_MODES_RENDER_MODE_WIREFRAME, OsgWxFrame::OnToggleRenderMode)
 EVT_MENU(wxID_MODES_RENDER_MODE_FILL, OsgWxFrame::OnToggleRenderMode)
@@ -45,8 +91,11 @@ EVT_MENU(wxID_MODES_RENDER_PLANAR_SECTIONS, OsgWxFrame::OnToggleRenderType)
 EVT_MENU(wxID_MODES_RENDER_PLANAR_AND_VERTICAL_SECTIONS, OsgWxFrame::OnToggleRenderType)
 EVT_MENU(wxID_MODES_RENDER_TRIANGLE_STRIP, OsgWxFrame::OnToggleRenderType)
 EVT_MENU(wxID_MODES_RENDER_TRIANGLE_FAN, OsgWxFrame::OnToggleRenderType)
+EVT_MENU(wxID_MODES_RENDER_PROCEDURAL_SWEEP, OsgWxFrame::OnToggleProceduralSweep)
 EVT_MENU(wxID_PRINT_PROJECTION_AND_MODEL_VIEW_MATRICES, OsgWxFrame::OnPrintProjectionMatrix)
 EVT_MENU(wxID_EDIT_CLEAR_VIEW, OsgWxFrame::OnDeleteModel)
+EVT_MENU(wxID_EDIT_UNDO, OsgWxFrame::OnUndo)
+EVT_MENU(wxID_EDIT_REDO, OsgWxFrame::OnUndo)
 EVT_MENU(wxID_MODEL_CONSTRAINTS_NO_AXIS_CONSTRAINT, OsgWxFrame::OnToggleModellingConstraints)
 EVT_MENU(wxID_MODEL_CONSTRAINTS_LINEAR_AXIS, OsgWxFrame::OnToggleModellingConstraints)
 EVT_MENU(wxID_MODEL_CONSTRAINTS_PLANAR_AXIS, OsgWxFrame::OnToggleModellingConstraints)
@@ -54,22 +103,40 @@ EVT_MENU(wxID_MODEL_CONSTRAINTS_CONSTANT_DEPTH, OsgWxFrame::OnToggleModellingCon
 EVT_MENU(wxID_MODEL_CONSTRAINTS_NO_SECTION_CONSTRAINTS, OsgWxFrame::OnToggleModellingConstraints)
 EVT_MENU(wxID_MODEL_CONSTRAINTS_CONSTANT_SECTIONS, OsgWxFrame::OnToggleModellingConstraints)
 EVT_MENU(wxID_MODEL_CONSTRAINTS_LINEARLY_SCALED_SECTIONS, OsgWxFrame::OnToggleModellingConstraints)
+EVT_MENU(wxID_MODEL_COMPONENT_GENERALIZED_CYLINDER, OsgWxFrame::OnToggleComponentType)
+EVT_MENU(wxID_MODEL_COMPONENT_CUBOID, OsgWxFrame::OnToggleComponentType)
+EVT_MENU(wxID_MODEL_COMPONENT_SPHERE, OsgWxFrame::OnToggleComponentType)
 EVT_MENU(wxID_MODEL_AXIS_DRAWING_MODE_CONTINUOUS, OsgWxFrame::OnToggleAxisDrawingMode)
 EVT_MENU(wxID_MODEL_AXIS_DRAWING_MODE_PIECEWISE_LINEAR, OsgWxFrame::OnToggleAxisDrawingMode)
 EVT_MENU(wxID_MODEL_SYMMETRIC_2D_PROFILES, OsgWxFrame::OnToggleSymmetricProfile)
+EVT_MENU(wxID_MODEL_SNAP_PROFILES_TO_EDGES, OsgWxFrame::OnToggleEdgeSnapping)
+EVT_MENU(wxID_MODEL_FIT_ELLIPSES_TO_EDGES, OsgWxFrame::OnToggleEllipseFitting)
+EVT_MENU(wxID_MODEL_SUBPIXEL_PROFILE_SNAPPING, OsgWxFrame::OnToggleSubpixelSnapping)
 EVT_MENU(wxID_MODEL_DOUBLE_CIRCLE_FOR_LINEAR_AXIS, OsgWxFrame::OnToggleDoubleCircleDrawingForLinearAxis)
+EVT_MENU(wxID_MODEL_MULTI_START_SOLVING, OsgWxFrame::OnToggleMultiStartSolving)
+EVT_MENU(wxID_MODEL_RECORD_INTERACTION_TRACE, OsgWxFrame::OnRecordInteractionTrace)
 EVT_MENU(wxID_MODEL_SAVE_COMPONENT, OsgWxFrame::OnSaveLastComponent)
 EVT_MENU(wxID_MODEL_SAVE_MODEL, OsgWxFrame::OnSaveModel)
+EVT_MENU(wxID_MODEL_SAVE_PROJECT, OsgWxFrame::OnSaveProject)
 EVT_MENU(wxID_MODEL_DELETE_SELECTED_COMPONENTS, OsgWxFrame::OnDeleteSelectedComponents)
 EVT_MENU(wxID_MODEL_DELETE_MODEL, OsgWxFrame::OnDeleteModel)
 EVT_MENU(wxID_MODEL_SOLVE, OsgWxFrame::OnSolveModel)
+EVT_MENU(wxID_MODEL_SOLVE_IN_ALL_VIEWS, OsgWxFrame::OnSolveInAllViews)
+EVT_MENU(wxID_MODEL_DETECT_RELATIONS, OsgWxFrame::OnDetectRelations)
+EVT_MENU(wxID_MODEL_BAKE_TEXTURES, OsgWxFrame::OnBakeTextures)
+EVT_MENU(wxID_MODEL_FREEZE_COMPONENTS, OsgWxFrame::OnFreezeComponents)
+EVT_MENU(wxID_MODEL_UNFREEZE_COMPONENTS, OsgWxFrame::OnFreezeComponents)
+EVT_MENU(wxID_MODEL_FIT_AXIS_SPLINES, OsgWxFrame::OnFitAxisSplines)
 EVT_MENU(wxID_VIEW_DISPLAY_LOCAL_FRAMES, OsgWxFrame::OnDisplayLocalFrames)
 EVT_MENU(wxID_VIEW_DISPLAY_COORDINATE_FRAME, OsgWxFrame::OnDisplayWorldCoordinateFrame)
 EVT_MENU(wxID_VIEW_DISPLAY_VERTEX_NORMALS, OsgWxFrame::OnDisplayVertexNormals)
 EVT_MENU(wxID_VIEW_DISPLAY_SECTION_NORMALS, OsgWxFrame::OnDisplaySectionNormals)
 EVT_MENU(wxID_VIEW_DISPLAY_IMAGE, OsgWxFrame::OnToggleImageDisplay)
 EVT_MENU(wxID_VIEW_DISPLAY_GRADIENT_IMAGE, OsgWxFrame::OnToggleImageDisplay)
+EVT_MENU(wxID_VIEW_DISPLAY_SHADER_GRADIENT_IMAGE, OsgWxFrame::OnToggleImageDisplay)
+EVT_MENU(wxID_VIEW_GRADIENT_DISPLAY_SETTINGS, OsgWxFrame::OnGradientDisplaySettings)
 EVT_MENU(wxID_VIEW_DISPLAY_RAY_CAST, OsgWxFrame::OnEnableRayCastDisplay)
+EVT_MENU(wxID_VIEW_DISPLAY_REPROJECTION_ERROR, OsgWxFrame::OnDisplayReprojectionError)
 EVT_MENU(wxID_WINDOWS_COMPONENT_RELATIONS, OsgWxFrame::OnDisplayComponentRelationsDialog)
 EVT_MENU(wxID_MODES_OPERATION_MODE_DISPLAY, OsgWxFrame::OnToggleUIOperationMode)
 EVT_MENU(wxID_MODES_OPERATION_MODE_MODELLING, OsgWxFrame::OnToggleUIOperationMode)
@@ -81,7 +148,10 @@ OsgWxFrame::OsgWxFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size,
     m_render_mode(osg::PolygonMode::FILL), m_render_face(osg::PolygonMode::FRONT_AND_BACK),
     m_uiopmode(md), m_component_relations_win(new ComponentRelationsDialog(this, wxT("Component Relations"))),
     m_pp(nullptr), m_bgcam(nullptr), m_bgeode(nullptr), m_model(nullptr), m_world_frame(nullptr), m_id(-1),
-    m_imgdisp_mode(background_image_display_mode::image){
+    m_imgdisp_mode(background_image_display_mode::image), m_frame_timer(this, wxID_OSG_FRAME_TIMER),
+    m_last_frame_tick(0), m_max_frame_rate(0.0), m_shared(SharedViewer::IsEnabled()), m_project_next(0), m_export_error(0.0),
+    m_gradient_shader(new OsgGradientShader), m_texture_memory(memory_category::textures), m_frozen_evictor(-1),
+    m_thaw_pending(false) {
 
     m_parent = dynamic_cast<MainFrame*>(parent);
     if(!m_parent) utilityShowMessageDialog(message_type::ERROR, wxT("Dynamic cast error"));
@@ -108,16 +178,40 @@ OsgWxFrame::OsgWxFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size,
     m_canvas->UsrSetGraphicsWindow(m_graphics_window);
 
     m_root = new osg::Group;
+    m_update_queue = new OsgUpdateQueue;
+    m_root->setUpdateCallback(m_update_queue.get());
     usrSetPolygonMode(m_root.get());
+
+    // the merged geometry is a copy of the frozen components, they are drawn one by one again over the budget;
+    // the bytes are counted once, the next ticks of the timer until the update traversal do not thaw again
+    m_frozen_evictor = MemoryRegistry::Instance().RegisterEvictor(eviction_order::frozen_components, [this](size_t bytes) {
+        size_t freed = (m_frozen && !m_thaw_pending) ? m_frozen->GetByteSize() : 0;
+        if(freed == 0) return freed;
+        m_thaw_pending = true;
+        UsrEnqueueSceneUpdate([this]() {
+            if(m_frozen) m_frozen->Thaw();
+            m_thaw_pending = false;
+        });
+        return freed;
+    });
     m_root->addChild(m_canvas->UsrGetSelectionBoxes());
+    m_root->addChild(m_canvas->UsrGetPickCamera());
 
-    m_viewer = new osgViewer::Viewer;
+    // a view of the shared viewer or an own viewer
+    if(m_shared) {
+        m_viewer = new osgViewer::View;
+    }
+    else {
+        osgViewer::Viewer* viewer = new osgViewer::Viewer;
+        // the scene is modified by the update traversal only (see OsgUpdateQueue), the draw may run in its own thread
+        viewer->setThreadingModel(osgViewer::Viewer::AutomaticSelection);
+        m_viewer = viewer;
+    }
     m_viewer->getCamera()->setGraphicsContext(m_graphics_window);
     m_viewer->getCamera()->setViewport(0, 0, client_size.GetWidth(), client_size.GetHeight());
     m_viewer->addEventHandler(new osgViewer::StatsHandler);
-    // m_viewer->setThreadingModel(osgViewer::Viewer::SingleThreaded);
-    m_viewer->setThreadingModel(osgViewer::Viewer::AutomaticSelection);
     m_viewer->setSceneData(m_root.get());
+    if(m_shared) SharedViewer::Instance().AddView(m_viewer.get());
 
     if(m_uiopmode == operation_mode::displaying) {
         m_camera_manipulator = new osgGA::TrackballManipulator();
@@ -130,10 +224,16 @@ OsgWxFrame::OsgWxFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size,
         usrEnableModellingMenus(true);
 }
 
+OsgWxFrame::~OsgWxFrame() {
+
+    MemoryRegistry::Instance().UnregisterEvictor(m_frozen_evictor);
+    usrCancelJobs();
+}
+
 // Public Member Functions:
 bool OsgWxFrame::UsrOpenOrientedImageFile() {
 
-    wxFileDialog open_filedialog(this, wxT("Open Image"), wxT(""), wxT(""), wxT("*.xml"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    wxFileDialog open_filedialog(this, wxT("Open Oriented Images"), wxT(""), wxT(""), wxT("*.cvmviews"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
     if(open_filedialog.ShowModal() == wxID_CANCEL) return false;
     if(usrLoadOrientationFile(open_filedialog.GetPath())) {
         m_path = open_filedialog.GetPath();
@@ -151,14 +251,33 @@ bool OsgWxFrame::UsrOpenOrientedImageFile() {
 
 bool OsgWxFrame::UsrOpenModelFile() {
 
-    wxFileDialog open_filedialog(this, wxT("Open Model"), wxT(""), wxT(""), wxT("*.osg;*.obj;*.ply"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    wxFileDialog open_filedialog(this, wxT("Open Model"), wxT(""), wxT(""), wxT("*.osg;*.osgb;*.obj;*.ply"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
     if(open_filedialog.ShowModal() == wxID_CANCEL) return false;
 
     if(usrLoadModelFile(open_filedialog.GetPath())) {
         SetTitle(open_filedialog.GetFilename());
         m_path = open_filedialog.GetPath();
         usrUpdateFileTree('m');
-        std::cout << "\t-Model file: " << open_filedialog.GetPath().char_str() << " is opened successfully" << std::endl;
+        std::cout << "\t-Model file: " << open_filedialog.GetPath().char_str() << " is being loaded" << std::endl;
+        return true;
+    }
+    else {
+        std::stringstream ss;
+        ss << "\t-File open error: " << open_filedialog.GetPath().char_str();
+        UsrLogErrorMessage(ss.str());
+        return false;
+    }
+}
+
+bool OsgWxFrame::UsrOpenPointCloudFile() {
+
+    wxFileDialog open_filedialog(this, wxT("Open Point Cloud"), wxT(""), wxT(""), wxT("*.ply;*.pco"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if(open_filedialog.ShowModal() == wxID_CANCEL) return false;
+
+    if(usrLoadPointCloudFile(open_filedialog.GetPath())) {
+        SetTitle(open_filedialog.GetFilename());
+        m_path = open_filedialog.GetPath();
+        usrUpdateFileTree('p');
         return true;
     }
     else {
@@ -189,6 +308,36 @@ bool OsgWxFrame::UsrOpenImageFile(){
     }
 }
 
+bool OsgWxFrame::UsrOpenProjectFile() {
+
+    wxFileDialog open_filedialog(this, wxT("Open Project"), wxT(""), wxT(""), wxT("*.cvmproj"), wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+    if(open_filedialog.ShowModal() == wxID_CANCEL) return false;
+
+    // the image with the projection parameters and the gradient image of the project, the
+    // components are created from the mapped file by the next idle events
+    std::unique_ptr<ProjectFile> project(new ProjectFile);
+    std::string image_path;
+    if(project->Open(open_filedialog.GetPath().ToStdString())) {
+        image_path = project->GetImagePath();
+        if(usrLoadImageFile(wxString(image_path.c_str()), project.get())) {
+            SetTitle(open_filedialog.GetFilename());
+            m_path = wxString(image_path.c_str());
+            usrUpdateFileTree('m');
+            m_project = std::move(project);
+            m_project_next = 0;
+            usrScheduleIdle(0.0);
+            std::cout << "\t-Project file: " << open_filedialog.GetPath().char_str() << " is opened with "
+                      << m_project->GetNumberOfComponents() << " components" << std::endl;
+            return true;
+        }
+    }
+    std::stringstream ss;
+    ss << "\t-File open error: " << open_filedialog.GetPath().char_str();
+    if(!image_path.empty()) ss << ", image: " << image_path;
+    UsrLogErrorMessage(ss.str());
+    return false;
+}
+
 void OsgWxFrame::UsrSetPerspectiveProjectionMatrix(double fovy, double aspect, double near, double far) {
 
     m_viewer->getCamera()->setProjectionMatrixAsPerspective(fovy, aspect, near, far);
@@ -205,6 +354,7 @@ void OsgWxFrame::UsrAddSelectableComponent(osg::Node* node, unsigned int compone
     node->setUserValue("Selection_Box_Id", -1);
     node->setUserValue("Component_Id", static_cast<int>(component_id));
     m_model->addChild(node);
+    m_canvas->UsrGetComponentIndex()->Add(component_id, node);
 }
 
 osg::Camera* OsgWxFrame::UsrGetMainCamera() {
@@ -243,7 +393,7 @@ void OsgWxFrame::UsrSetUIOperationMode(operation_mode mode) {
 
         // disable camera manipulator
         m_camera_manipulator->setByMatrix(osg::Matrixd::identity());
-        m_viewer->updateTraversal();
+        m_viewer->getCamera()->setViewMatrix(m_camera_manipulator->getInverseMatrix());
         m_viewer->setCameraManipulator(nullptr);
 
         // enable drawing menus, disable displaying menus
@@ -262,22 +412,8 @@ void OsgWxFrame::UsrDisplayComponentRelationsDialog() {
 
 void OsgWxFrame::UsrGetSelectedComponentIds(std::vector<unsigned int>& ids) {
 
-    bool selected = false;
-    int id = 0;
-    for(int i = 0; i < m_model->getNumChildren(); ++i) {
-        osg::Node* child = m_model->getChild(i);
-        if(child->getUserValue("Selection", selected)) {
-            if(selected) {
-                if(child->getUserValue("Component_Id", id))
-                    ids.push_back(static_cast<unsigned int>(id));
-                else
-                    UsrLogErrorMessage("Component_Id could not be found!");
-            }
-        }
-        else {
-            UsrLogErrorMessage("Selection could not be found!");
-        }
-    }
+    // the frozen components are not selectable, the merged node is not a component
+    m_canvas->UsrGetComponentIndex()->GetSelectedComponentIds(ids);
 }
 
 ModelSolver* OsgWxFrame::UsrGetModelSolver() {
@@ -298,6 +434,10 @@ void OsgWxFrame::UsrUpdateGeosemanticConstraints() {
     }
 }
 
+void OsgWxFrame::UsrSetGeosemanticConstraints(unsigned int cp1, unsigned int cp2, const std::vector<geosemantic_constraints>& gsc) {
+    m_canvas->UsrGetModeller()->SetConstraints(cp1, cp2, gsc);
+}
+
 // Private Member Functions:
 void OsgWxFrame::usrInitMenubar() {
 
@@ -306,11 +446,16 @@ void OsgWxFrame::usrInitMenubar() {
     wxMenu* open = new wxMenu;
     open->Append(wxID_OSG_OPEN_MODEL, wxT("Model"));
     open->Append(wxID_OSG_OPEN_IMAGE, wxT("Oriented Image"));
+    open->Append(wxID_OSG_OPEN_PROJECT, wxT("Project"));
     file->AppendSubMenu(open, wxT("&Open"));
+    file->Append(wxID_OSG_CANCEL_LOADING, wxT("Cancel Loading"));
     file->Append(wxID_EXIT, wxT("Exit"));
     menubar->Append(file, wxT("&File"));
 
     wxMenu* edit = new wxMenu;
+    edit->Append(wxID_EDIT_UNDO, wxT("Undo\tCtrl+Z"));
+    edit->Append(wxID_EDIT_REDO, wxT("Redo\tCtrl+Y"));
+    edit->AppendSeparator();
     edit->Append(wxID_EDIT_CLEAR_VIEW, wxT("Clear Models"));
     menubar->Append(edit, wxT("&Edit"));
 
@@ -321,9 +466,12 @@ void OsgWxFrame::usrInitMenubar() {
     disp->AppendCheckItem(wxID_VIEW_DISPLAY_VERTEX_NORMALS, wxT("Display Vertex Normals"));
     disp->AppendSeparator();
     disp->AppendCheckItem(wxID_VIEW_DISPLAY_RAY_CAST, wxT("Enable Ray Cast Display"));
+    disp->AppendCheckItem(wxID_VIEW_DISPLAY_REPROJECTION_ERROR, wxT("Display Reprojection Error"));
     disp->AppendSeparator();
     disp->AppendRadioItem(wxID_VIEW_DISPLAY_IMAGE, wxT("Image"));
     disp->AppendRadioItem(wxID_VIEW_DISPLAY_GRADIENT_IMAGE, wxT("Gradient Image"));
+    disp->AppendRadioItem(wxID_VIEW_DISPLAY_SHADER_GRADIENT_IMAGE, wxT("Gradient Image (Shader)"));
+    disp->Append(wxID_VIEW_GRADIENT_DISPLAY_SETTINGS, wxT("Gradient Display Settings..."));
     menubar->Append(disp, wxT("&Display"));
 
     wxMenu* modes = new wxMenu;
@@ -340,6 +488,9 @@ void OsgWxFrame::usrInitMenubar() {
     render_mode->AppendRadioItem(wxID_MODES_RENDER_TRIANGLE_FAN, wxT("Triangle Fan"));
     render_mode->AppendRadioItem(wxID_MODES_RENDER_PLANAR_SECTIONS, wxT("Planar Sections"));
     render_mode->AppendRadioItem(wxID_MODES_RENDER_PLANAR_AND_VERTICAL_SECTIONS, wxT("Planar and Vertical Sections"));
+    render_mode->AppendSeparator();
+    render_mode->AppendCheckItem(wxID_MODES_RENDER_PROCEDURAL_SWEEP, wxT("Sweep Sections on the GPU"));
+    render_mode->AppendCheckItem(wxID_MODES_ORDER_INDEPENDENT_TRANSPARENCY, wxT("Order Independent Transparency"));
     modes->AppendSubMenu(render_mode, wxT("Render Mode"));
 
     wxMenu* op_modes = new wxMenu;
@@ -357,20 +508,39 @@ void OsgWxFrame::usrInitMenubar() {
     projection_mode->AppendRadioItem(wxID_MODES_PERSPECTIVE_PROJECTION, wxT("Perspective"));
     projection_mode->AppendRadioItem(wxID_MODES_ORTHOGRAPHIC_PROJECTION, wxT("Othographic"));
     modes->AppendSubMenu(projection_mode, wxT("Projection Mode"));
+    modes->AppendCheckItem(wxID_MODES_LIMIT_FRAME_RATE, wxT("Limit Frame Rate (30 FPS)"));
+    modes->AppendCheckItem(wxID_MODES_KDTREE_PICKING, wxT("Accelerate Picking with KD-Trees"));
+    modes->AppendCheckItem(wxID_MODES_COLOR_ID_PICKING, wxT("Pick with Color IDs"));
+    // the compression is shared by all the frames
+    modes->AppendCheckItem(wxID_MODES_COMPRESS_TEXTURES, wxT("Compress Textures"));
+    modes->Check(wxID_MODES_COMPRESS_TEXTURES, OsgTextureCompressor::Instance().IsEnabled());
 
     menubar->Append(modes, wxT("&Modes"));
 
     wxMenu* model = new wxMenu;
     model->Append(wxID_MODEL_SOLVE, wxT("Solve"));
+    model->Append(wxID_MODEL_SOLVE_IN_ALL_VIEWS, wxT("Solve Selected Components in All Views"));
+    model->Append(wxID_MODEL_DETECT_RELATIONS, wxT("Detect Relations"));
+    model->Append(wxID_MODEL_BAKE_TEXTURES, wxT("Bake Textures from the Image"));
     wxMenu* model_save = new wxMenu;
     model_save->Append(wxID_MODEL_SAVE_MODEL, wxT("Save Model"));
     model_save->Append(wxID_MODEL_SAVE_COMPONENT, wxT("Save Last Component"));
+    model_save->Append(wxID_MODEL_SAVE_PROJECT, wxT("Save Project"));
     model->AppendSubMenu(model_save, wxT("Save"));
 
     wxMenu* model_delete = new wxMenu;
     model_delete->Append(wxID_MODEL_DELETE_SELECTED_COMPONENTS, wxT("Delete Selected Components"));
     model_delete->Append(wxID_MODEL_DELETE_MODEL, wxT("Delete Model"));
     model->AppendSubMenu(model_delete, wxT("Delete"));
+    model->Append(wxID_MODEL_FREEZE_COMPONENTS, wxT("Freeze Finished Components"));
+    model->Append(wxID_MODEL_UNFREEZE_COMPONENTS, wxT("Unfreeze Components"));
+    model->Append(wxID_MODEL_FIT_AXIS_SPLINES, wxT("Fit Axis Splines to Selected Components"));
+
+    wxMenu* component_types = new wxMenu;
+    component_types->AppendRadioItem(wxID_MODEL_COMPONENT_GENERALIZED_CYLINDER, wxT("Generalized Cylinder"));
+    component_types->AppendRadioItem(wxID_MODEL_COMPONENT_CUBOID, wxT("Cuboid"));
+    component_types->AppendRadioItem(wxID_MODEL_COMPONENT_SPHERE, wxT("Sphere"));
+    model->AppendSubMenu(component_types, wxT("Component Type"));
 
     wxMenu* spncstrnts = new wxMenu;
     spncstrnts->AppendRadioItem(wxID_MODEL_CONSTRAINTS_PLANAR_AXIS, wxT("Planar Axis"));
@@ -393,8 +563,14 @@ void OsgWxFrame::usrInitMenubar() {
     model->AppendSubMenu(axis_drawing_mode, wxT("Axis Drawing Mode"));
 
     model->AppendCheckItem(wxID_MODEL_SYMMETRIC_2D_PROFILES, wxT("Symmetric Profiles"));
+    model->AppendCheckItem(wxID_MODEL_SNAP_PROFILES_TO_EDGES, wxT("Snap Profiles to Edges"));
+    model->AppendCheckItem(wxID_MODEL_FIT_ELLIPSES_TO_EDGES, wxT("Fit Ellipses to Edges"));
+    model->AppendCheckItem(wxID_MODEL_SUBPIXEL_PROFILE_SNAPPING, wxT("Sub-pixel Profile Snapping"));
     model->AppendCheckItem(wxID_MODEL_DOUBLE_CIRCLE_FOR_LINEAR_AXIS, wxT("Double Circle Drawing for Linear Axis Prior"));
+    model->AppendCheckItem(wxID_MODEL_MULTI_START_SOLVING, wxT("Solve All Circle Orientations"));
     model->AppendCheckItem(wxID_MODEL_RIGHT_GENERALIZED_CYLINDER, wxT("Right Generalized Cylinder Constraint"));
+    model->AppendSeparator();
+    model->AppendCheckItem(wxID_MODEL_RECORD_INTERACTION_TRACE, wxT("Record Interaction Trace"));
     menubar->Append(model, wxT("Model"));
 
     wxMenu* windows = new wxMenu;
@@ -409,6 +585,8 @@ void OsgWxFrame::usrInitMenubar() {
 
     menubar->FindItem(wxID_MODES_RENDER_MODE_FILL)->Check(true);
     menubar->FindItem(wxID_MODES_RENDER_FACE_FRONT_AND_BACK)->Check(true);
+    menubar->FindItem(wxID_OSG_CANCEL_LOADING)->Enable(false);
+    menubar->FindItem(wxID_MODES_KDTREE_PICKING)->Check(true);
 
     if(m_uiopmode == operation_mode::modelling)       usrEnableModellingMenus(true);
     else if(m_uiopmode == operation_mode::displaying) usrEnableModellingMenus(false);
@@ -417,70 +595,213 @@ void OsgWxFrame::usrInitMenubar() {
 
 bool OsgWxFrame::usrLoadModelFile(const wxString& fpath) {
 
-    // load the scene.
-    osg::ref_ptr<osg::Node> loadedModel = osgDB::readNodeFile(std::string(fpath.mb_str()));
-    if (!loadedModel) { return false; }
-    loadedModel->setUserValue("Selection", false);
-    loadedModel->setUserValue("Selection_Box_Id", -1);
-    m_root->addChild(loadedModel.get());
+    // load the scene in the background, the chunks are attached to the model node by OnIdle
+    if(!m_model_loader) m_model_loader.reset(new ModelLoader);
+    m_model_loader->SetBuildKdTrees(GetMenuBar()->FindItem(wxID_MODES_KDTREE_PICKING)->IsChecked());
+    if(!m_model_loader->Start(std::string(fpath.mb_str()))) return false;
+
+    m_loaded_model = new osg::Group;
+    m_loaded_model->setUserValue("Selection", false);
+    m_loaded_model->setUserValue("Selection_Box_Id", -1);
+    m_root->addChild(m_loaded_model.get());
+    GetMenuBar()->FindItem(wxID_OSG_CANCEL_LOADING)->Enable(true);
     return true;
 }
 
-bool OsgWxFrame::usrLoadOrientationFile(const wxString& fpath) {
+bool OsgWxFrame::usrLoadPointCloudFile(const wxString& fpath) {
 
-    /*
-    std::shared_ptr<Orientation> ori(new Orientation());
-    if(ori->Read(fpath.ToStdString())) {
-        return true;
+    // Step-1: an octree or a PLY file converted before
+    std::string path(fpath.mb_str());
+    if(osgDB::getLowerCaseFileExtension(path) == "pco") return usrShowPointCloud(path);
+    std::string index_path = PointCloudOctree::GetIndexPath(path);
+    if(osgDB::fileExists(index_path)) {
+        std::cout << "\t-Octree of the point cloud: " << index_path << std::endl;
+        return usrShowPointCloud(index_path);
     }
-    */
-    return false;
+    if(m_octree_job.IsValid()) {
+        std::cout << "INFO: A point cloud is already being converted" << std::endl;
+        return false;
+    }
+
+    // Step-2: the conversion reads the file twice, the octree is shown once it is written
+    std::shared_ptr<std::atomic<float>> progress = std::make_shared<std::atomic<float>>(0.0f);
+    m_octree_progress = progress;
+    m_octree_job = ThreadPool::Instance().Submit([path, index_path, progress](const CancellationToken& token) {
+        return PointCloudOctree::Build(path, index_path, token, *progress);
+    });
+    m_octree_job.Then([this, index_path](const bool& built) {
+        m_octree_job.Reset();
+        m_octree_progress.reset();
+        SetStatusText(wxT(""), 1);
+        if(built) usrShowPointCloud(index_path);
+        else      UsrLogErrorMessage("Point cloud cannot be converted into an octree");
+    }, utilityUIExecutor());
+    std::cout << "\t-Point cloud is being converted into an octree: " << index_path << std::endl;
+    usrScheduleIdle(job_poll_period);
+    return true;
+}
+
+bool OsgWxFrame::usrShowPointCloud(const std::string& index_path) {
 
+    osg::ref_ptr<osg::Node> cloud = PointCloudOctree::Open(index_path);
+    if(!cloud.valid()) return false;
+    UsrEnqueueSceneUpdate([this, cloud]() {
+        m_root->addChild(cloud.get());
+        if(m_camera_manipulator.valid()) m_viewer->home();
+    });
+    return true;
 }
 
-bool OsgWxFrame::usrLoadImageFile(const wxString& fpath) {
+void OsgWxFrame::usrScheduleIdle(double seconds) {
+
+    // a running timer is only restarted to fire earlier
+    int ms = std::max(1, static_cast<int>(std::ceil(1000.0 * seconds)));
+    if(m_frame_timer.IsRunning() && m_frame_timer.GetInterval() <= ms) return;
+    m_frame_timer.Start(ms, wxTIMER_ONE_SHOT);
+}
+
+void OsgWxFrame::usrCreateProjectComponents() {
+
+    if(!m_project) return;
+
+    // a share of the idle event, the frame stays responsive while a large project is opened
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    size_t num_components = m_project->GetNumberOfComponents();
+    ImageModeller* modeller = m_canvas->UsrGetModeller();
+    while(m_project_next < num_components && osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick()) < project_component_budget)
+        modeller->AddProjectComponent(*m_project, m_project_next++);
+    UsrRequestRedraw();
+
+    if(m_project_next < num_components) {
+        SetStatusText(wxString::Format(wxT("Opening the project: %d%%"), static_cast<int>(100 * m_project_next / num_components)), 1);
+        usrScheduleIdle(0.0);
+        return;
+    }
+    SetStatusText(wxEmptyString, 1);
+    UsrUpdateGeosemanticConstraints();
+    m_project.reset();
+}
+
+void OsgWxFrame::usrCollectLoadedModel() {
+
+    if(!m_model_loader || !m_loaded_model.valid()) return;
+
+    // Step-1: attach the chunks loaded so far
+    bool running = m_model_loader->IsRunning();
+    std::vector<osg::ref_ptr<osg::Node>> chunks;
+    m_model_loader->TakeChunks(chunks);
+    bool first_chunk = (m_loaded_model->getNumChildren() == 0 && !chunks.empty());
+    if(!chunks.empty()) {
+        osg::ref_ptr<osg::Group> loaded_model = m_loaded_model;
+        bool home = first_chunk && m_camera_manipulator.valid();
+        UsrEnqueueSceneUpdate([this, loaded_model, chunks, home]() {
+            for(size_t i = 0; i < chunks.size(); ++i)
+                loaded_model->addChild(chunks[i].get());
+            if(home) m_viewer->home();
+        });
+    }
+
+    if(running) {
+        float progress = m_model_loader->GetProgress();
+        if(progress < 0) SetStatusText(wxT("Loading..."), 1);
+        else             SetStatusText(wxString::Format(wxT("Loading: %d%%"), static_cast<int>(100.0f * progress)), 1);
+        return;
+    }
+
+    // Step-2: completed, cancelled or failed
+    m_model_loader->Join();
+    if(m_model_loader->Succeeded()) {
+        if(m_camera_manipulator.valid()) m_viewer->home();
+        std::cout << "\t-Model file: " << m_path.char_str() << " is loaded" << std::endl;
+    }
+    else {
+        osg::ref_ptr<osg::Group> loaded_model = m_loaded_model;
+        UsrEnqueueSceneUpdate([this, loaded_model]() { m_root->removeChild(loaded_model.get()); });
+        if(m_model_loader->IsCancelled()) std::cout << "\t-Model loading is cancelled" << std::endl;
+        else                              UsrLogErrorMessage("Model file cannot be loaded");
+    }
+    m_loaded_model = nullptr;
+    UsrRequestRedraw();
+    SetStatusText(wxT(""), 1);
+    GetMenuBar()->FindItem(wxID_OSG_CANCEL_LOADING)->Enable(false);
+}
+
+bool OsgWxFrame::usrLoadOrientationFile(const wxString& fpath) {
+
+    // the first view is modelled with its calibration, the others are used by the multi-view solves
+    std::vector<std::shared_ptr<CameraView>> views;
+    if(!ReadCameraViews(fpath.ToStdString(), default_near, default_far, views)) return false;
+    if(!usrLoadImageFile(wxString(views.front()->GetImagePath().c_str()), nullptr, views.front().get())) return false;
+    m_views.swap(views);
+    std::cout << "\t-" << m_views.size() << " oriented images, the first one is modelled" << std::endl;
+    return true;
+}
+
+bool OsgWxFrame::usrLoadImageFile(const wxString& fpath, const ProjectFile* project, const CameraView* view) {
+
+    // the components of a project still being opened belong to the previous modeller, the
+    // views belong to the previous image
+    m_project.reset();
+    m_multi_view_job.Cancel();
+    m_multi_view_job.Reset();
+    m_views.clear();
 
     // delete the current background camera and the node
     if(m_bgcam.valid())  m_bgcam = nullptr;
     if(m_bgeode.valid()) m_bgeode = nullptr;
+    m_tiled_image.reset();
 
     // create a textured quad with the given image as texture
     wxSize img_size;
     osg::Geode* bg_image;
-    if(m_imgdisp_mode == background_image_display_mode::image) {
-        osg::Image* image = osgDB::readImageFile(fpath.ToStdString());
-        if(!image) {
-            std::cout << "Image file cannot be opened!" << std::endl;
-            return false;
-        }
-        bg_image = create_textured_quad(image, img_size);
+    osg::ref_ptr<osg::Texture2D> texture;
+    bool shared_pixels = false;
+    if(m_imgdisp_mode == background_image_display_mode::gradient_image) {
+
+        // if the gradient image is not cached yet, the plain image is displayed until it is generated
+        std::string grad_img_path = GradientCache::Instance().GetCacheFilePath(fpath.ToStdString());
+        if(!grad_img_path.empty() && wxFileExists(grad_img_path))
+            texture = usrGetBackgroundTexture(grad_img_path);
+    }
+    else if(m_imgdisp_mode != background_image_display_mode::image && m_imgdisp_mode != background_image_display_mode::shader_gradient_image) {
+        std::cerr << "Image display mode error" << std::endl;
+        return false;
+    }
+
+    // an image larger than a single texture is displayed by the tiles of the visible region,
+    // the quad is kept for the gradient image
+    if(!texture.valid()) {
+        std::shared_ptr<const SharedImage> img = ImageRepository::Instance().Acquire(fpath.ToStdString());
+        if(img && OsgTiledImage::IsTiled(*img))
+            m_tiled_image.reset(new OsgTiledImage(img));
     }
-    else if(m_imgdisp_mode == background_image_display_mode::gradient_image) {
 
-        // if gradient image does not exist, generate the gradient image
-        std::string grad_img_path = utilityInsertAfter(fpath, wxT('.'), wxT("_grad"));
-        std::ifstream infile(grad_img_path);
-        if(!infile.good()) {
-            OtbFloatVectorImageType::Pointer img = LoadImage<OtbFloatVectorImageType>(fpath.ToStdString());
-            OtbImageType::Pointer gimg = GradientMagnitudeImage(img);
-            SaveImage<OtbImageType>(gimg, grad_img_path);
+    if(m_tiled_image) {
+        img_size.x = m_tiled_image->GetWidth();
+        img_size.y = m_tiled_image->GetHeight();
+        bg_image = create_textured_quad(img_size.x, img_size.y);
+    }
+    else {
+        if(!texture.valid()) {
+            texture = usrGetBackgroundTexture(fpath.ToStdString(), true);
+            shared_pixels = true;
         }
 
-        osg::Image* grad_image = osgDB::readImageFile(grad_img_path);
-        if(!grad_image) {
+        if(!texture.valid()) {
             std::cout << "Image file cannot be opened!" << std::endl;
             return false;
         }
-        bg_image = create_textured_quad(grad_image, img_size);
-    }
-    else {
-        std::cerr << "Image display mode error" << std::endl;
-        return false;
+        bg_image = create_textured_quad(texture.get(), img_size.x, img_size.y);
     }
+    usrReportTextureMemory(texture.get(), shared_pixels);
 
     // create the back ground camera and and the textured quad under this camera
     m_bgcam = create_background_camera(0, img_size.x, 0, img_size.y);
     m_bgcam->addChild(bg_image);
+    if(m_tiled_image) {
+        m_bgcam->addChild(m_tiled_image->GetRoot());
+        usrShowTiledImage();
+    }
 
     // crete the node for 2D user drawings on the image
     m_bgeode = new osg::Geode;
@@ -488,6 +809,7 @@ bool OsgWxFrame::usrLoadImageFile(const wxString& fpath) {
 
     // set the polygon render mode for the background camera
     usrSetCustomPolygonMode(m_bgcam.get(), osg::PolygonMode::FILL, osg::PolygonMode::FRONT_AND_BACK);
+    if(m_imgdisp_mode == background_image_display_mode::shader_gradient_image) usrApplyGradientShader(true);
 
     // add background camera to the root node
     m_root->addChild(m_bgcam.get());
@@ -495,9 +817,19 @@ bool OsgWxFrame::usrLoadImageFile(const wxString& fpath) {
     // set client size to the image size
     SetClientSize(img_size);
 
-    // perspective projection parameters of the main camera
-    // m_pp = std::shared_ptr<ProjectionParameters>(new ProjectionParameters(45.0, img_size.x, img_size.y, 1.0, 100.0));
-    m_pp = std::shared_ptr<ProjectionParameters>(new ProjectionParameters(45, img_size.x, img_size.y, 1.0, 100.0));
+    // perspective projection parameters of the main camera, of the calibration if the image has one
+    m_pp = std::shared_ptr<ProjectionParameters>(new ProjectionParameters(default_fovy, img_size.x, img_size.y, default_near, default_far));
+    if(view) {
+        const ProjectionParameters& vpp = *view->GetProjectionParameters();
+        if(vpp.width != img_size.x || vpp.height != img_size.y)
+            std::cout << "WARNING: Image size differs from the size of its calibration" << std::endl;
+        m_pp = std::shared_ptr<ProjectionParameters>(new ProjectionParameters(vpp.fovy, img_size.x, img_size.y, vpp.near, vpp.far));
+    }
+    if(project) {
+        if(project->GetWidth() != img_size.x || project->GetHeight() != img_size.y)
+            std::cout << "WARNING: Image size differs from the size the project is modelled with" << std::endl;
+        m_pp = std::shared_ptr<ProjectionParameters>(new ProjectionParameters(project->GetFovy(), img_size.x, img_size.y, project->GetNear(), project->GetFar()));
+    }
 
     // set the properties of the main camera
 
@@ -505,12 +837,38 @@ bool OsgWxFrame::usrLoadImageFile(const wxString& fpath) {
     m_viewer->getCamera()->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
     m_viewer->getCamera()->setViewMatrix(osg::Matrixd::identity());
     m_viewer->getCamera()->setProjectionMatrixAsPerspective(m_pp->fovy, m_pp->aspect, m_pp->near, m_pp->far);
+    m_viewer->getCamera()->setCullingMode(m_viewer->getCamera()->getCullingMode() | osg::CullSettings::SMALL_FEATURE_CULLING);
+    m_viewer->getCamera()->setSmallFeatureCullingPixelSize(OsgComponentHierarchy::small_feature_pixel_size);
+    // the primitives are drawn by their batches, their proxies only by the picking
+    m_viewer->getCamera()->setCullMask(m_viewer->getCamera()->getCullMask() & ~PrimitiveInstances::proxy_node_mask);
 
     // initialize the modeller: this must be executed after the initialization of the m_bgeode.
     m_canvas->UsrInitializeModeller(m_pp, fpath);
+    if(project) m_canvas->UsrGetModeller()->RestoreProject(*project);
+
+    // the profiles are snapped on the gradient tiles around the drawing at once, the gradient image is
+    // generated in the background, the one of an image larger than a texture only once it is displayed
+    if(!m_canvas->UsrGetModeller()->HasGradientImage()) {
+        std::shared_ptr<const SharedImage> img = ImageRepository::Instance().Acquire(fpath.ToStdString());
+        m_canvas->UsrGetModeller()->SetLazyGradientImage(LazyGradientImage::Create(img));
+        if(img && OsgTiledImage::IsTiled(*img)) {
+            std::cout << "INFO: Gradient is computed by tiles around the drawing" << std::endl;
+        }
+        else {
+            std::cout << "INFO: Gradient image is being generated in the background" << std::endl;
+            usrStartGradientJob(fpath.ToStdString());
+        }
+    }
 
     // create the model node and add it to the root node
-    m_model = new osg::Group;
+    m_frozen.reset();
+    if(m_texture_baker) m_root->removeChild(m_texture_baker->GetRoot());
+    m_texture_baker.reset();
+    m_canvas->UsrGetComponentIndex()->Clear();
+    osg::ref_ptr<OsgComponentHierarchy> model = new OsgComponentHierarchy;
+    model->AddSharedNode(m_canvas->UsrGetModeller()->GetPrimitiveInstances(primitive_kind::cuboid)->GetNode());
+    model->AddSharedNode(m_canvas->UsrGetModeller()->GetPrimitiveInstances(primitive_kind::sphere)->GetNode());
+    m_model = model;
     m_root->addChild(m_model.get());
 
     return true;
@@ -558,13 +916,70 @@ void OsgWxFrame::usrEnableModellingMenus(bool flag) {
 // Event Handlers:
 void OsgWxFrame::OnIdle(wxIdleEvent& event) {
 
-    if(!m_viewer->isRealized()) return;
-    m_viewer->frame();
-    event.RequestMore();
+    // Step-1: the chunks of the model being loaded, polled at a low rate
+    // (the other background jobs post their results to the UI thread)
+    usrCollectLoadedModel();
+    usrCreateProjectComponents();
+    if(m_loaded_model.valid())
+        usrScheduleIdle(job_poll_period);
+    if(m_octree_progress) {
+        SetStatusText(wxString::Format(wxT("Building the octree: %d%%"), static_cast<int>(100.0f * m_octree_progress->load())), 1);
+        usrScheduleIdle(job_poll_period);
+    }
+
+    // the tiles of the background image are attached by the update traversal of a frame
+    if(m_tiled_image && m_tiled_image->HasPendingTiles()) {
+        UsrRequestRedraw();
+        usrScheduleIdle(job_poll_period);
+    }
+
+    // a color id pick is read back by the draw thread after the next frame
+    if(m_canvas->UsrUpdatePendingSelection()) {
+        UsrUpdateGeosemanticConstraints();
+        UsrRequestRedraw();
+    }
+    if(m_canvas->UsrIsSelectionPending())
+        usrScheduleIdle(pick_poll_period);
+    usrCollectReprojectionError();
+    usrCollectBakedTextures();
+    if(m_update_queue->HasPending())
+        UsrRequestRedraw();
+
+    // Step-2: a frame only if the scene is dirty or there are events for the viewer
+    // (a frame of the shared viewer renders all of its views)
+    osgViewer::ViewerBase* viewer = usrGetViewerBase();
+    osg::Timer_t& last_frame_tick = m_shared ? SharedViewer::Instance().GetLastFrameTick() : m_last_frame_tick;
+    if(!viewer->isRealized() || !viewer->checkNeedToDoFrame()) return;
+    osg::Timer_t now = osg::Timer::instance()->tick();
+    if(m_max_frame_rate > 0.0) {
+        double wait = 1.0 / m_max_frame_rate - osg::Timer::instance()->delta_s(last_frame_tick, now);
+        if(wait > 0.0) {
+            usrScheduleIdle(wait);
+            return;
+        }
+    }
+    last_frame_tick = now;
+    viewer->frame();
+
+    // the reprojection error and the baked textures of the frame are read back by the draw thread
+    if((m_error_map && m_error_map->IsEnabled()) || (m_texture_baker && m_texture_baker->IsBaking()))
+        usrScheduleIdle(pick_poll_period);
+
+    // Step-3: continuous updates, e.g. a thrown trackball
+    if(viewer->checkNeedToDoFrame()) {
+        if(m_max_frame_rate > 0.0) usrScheduleIdle(1.0 / m_max_frame_rate);
+        else                       event.RequestMore();
+    }
+}
+
+void OsgWxFrame::OnFrameTimer(wxTimerEvent& event) {
+    wxWakeUpIdle();
 }
 
 void OsgWxFrame::OnClose(wxCloseEvent& event) {
 
+    usrCancelJobs();
+    if(m_shared) SharedViewer::Instance().RemoveView(m_viewer.get());
     m_parent->UsrFrameClosedMessage(m_id);
     std::cout << "\t-Model File: " << GetTitle().char_str() << " is closed." << std::endl;
     Destroy();
@@ -578,10 +993,19 @@ void OsgWxFrame::OnOpenOrientedImage(wxCommandEvent& event) {
     UsrOpenOrientedImageFile();
 }
 
+void OsgWxFrame::OnOpenProject(wxCommandEvent& event) {
+    UsrOpenProjectFile();
+}
+
 void OsgWxFrame::OnOpenModel(wxCommandEvent& event) {
     UsrOpenModelFile();
 }
 
+void OsgWxFrame::OnCancelLoading(wxCommandEvent& event) {
+
+    if(m_model_loader) m_model_loader->Cancel();
+}
+
 void OsgWxFrame::OnToggleRenderType(wxCommandEvent& event) {
 
     rendering_type rtype;
@@ -616,6 +1040,95 @@ void OsgWxFrame::OnToggleRenderType(wxCommandEvent& event) {
     m_root->dirtyBound();
 }
 
+void OsgWxFrame::OnToggleProceduralSweep(wxCommandEvent& event) {
+
+    bool sweep = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrGetModeller()->SetProceduralSweep(sweep);
+
+    for(size_t i = 0; i < m_model->getNumChildren(); ++i) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_model->getChild(i)->asGroup());
+        if(gcyl) gcyl->SetProceduralSweep(sweep);
+    }
+    m_root->dirtyBound();
+    if(sweep) std::cout << "\t-Generalized cylinders are swept in the vertex shader" << std::endl;
+    else      std::cout << "\t-Generalized cylinders are swept on the CPU" << std::endl;
+}
+
+void OsgWxFrame::OnToggleFrameRateLimit(wxCommandEvent& event) {
+
+    bool limit = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    UsrSetMaxFrameRate(limit ? limited_frame_rate : 0.0);
+    if(limit) std::cout << "\t-Frame rate is limited to " << limited_frame_rate << " FPS" << std::endl;
+    else      std::cout << "\t-Frame rate is not limited" << std::endl;
+}
+
+void OsgWxFrame::OnToggleKdTreePicking(wxCommandEvent& event) {
+
+    bool kdtrees = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrUseKdTreesForPicking(kdtrees);
+    if(m_model_loader) m_model_loader->SetBuildKdTrees(kdtrees);
+
+    // the loaded models are static, the kd-trees are built once for the ones loaded so far
+    if(kdtrees) {
+        osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+        for(unsigned int i = 0; i < m_root->getNumChildren(); ++i) {
+            osg::Node* child = m_root->getChild(i);
+            bool selected = false;
+            if(child != m_model.get() && child != m_loaded_model.get() && child->getUserValue("Selection", selected))
+                child->accept(*builder);
+        }
+    }
+    if(kdtrees) std::cout << "\t-Picking uses the kd-trees of the loaded models" << std::endl;
+    else        std::cout << "\t-Picking intersects all the triangles" << std::endl;
+}
+
+void OsgWxFrame::OnToggleColorIdPicking(wxCommandEvent& event) {
+
+    bool color_ids = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrUseColorIdsForPicking(color_ids);
+    if(color_ids) std::cout << "\t-Picking reads back an id buffer, ctrl + drag selects a rectangle" << std::endl;
+    else          std::cout << "\t-Picking intersects the geometries" << std::endl;
+}
+
+void OsgWxFrame::OnToggleTextureCompression(wxCommandEvent& event) {
+
+    bool compress = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    OsgTextureCompressor::Instance().SetEnabled(compress);
+    if(compress) {
+        usrCompressTextures();
+        std::cout << "\t-Background and baked textures are block compressed" << std::endl;
+    }
+    else {
+        std::cout << "\t-New textures are not compressed" << std::endl;
+    }
+}
+
+void OsgWxFrame::OnToggleOrderIndependentTransparency(wxCommandEvent& event) {
+
+    wxMenuItem* item = GetMenuBar()->FindItem(event.GetId());
+    if(!item->IsChecked()) {
+        if(m_oit) m_oit->SetEnabled(false);
+        std::cout << "\t-Transparent components are blended in the depth sorted bin" << std::endl;
+        UsrRequestRedraw();
+        return;
+    }
+    if(!m_model.valid() || !m_pp) {
+        std::cout << "INFO: Open an image before enabling the order independent transparency" << std::endl;
+        item->Check(false);
+        return;
+    }
+
+    // the passes are created once for the image and rendered with every frame
+    if(!m_oit) {
+        m_oit.reset(new OsgOrderIndependentTransparency);
+        m_oit->Initialize(m_viewer->getCamera(), m_model.get(), m_pp->width, m_pp->height);
+        m_root->addChild(m_oit->GetRoot());
+    }
+    m_oit->SetEnabled(true);
+    std::cout << "\t-Components are blended in a single unsorted pass" << std::endl;
+    UsrRequestRedraw();
+}
+
 void OsgWxFrame::OnToggleProjectionMode(wxCommandEvent& event) {
 
     switch (event.GetId()) {
@@ -734,6 +1247,30 @@ void OsgWxFrame::OnToggleModellingConstraints(wxCommandEvent& event) {
     }
 }
 
+void OsgWxFrame::OnToggleComponentType(wxCommandEvent& event) {
+
+    ImageModeller* modeller = m_canvas->UsrGetModeller();
+    // an ongoing drawing is of the previous type
+    modeller->EscapeKeyPressed();
+    switch (event.GetId()) {
+    case wxID_MODEL_COMPONENT_GENERALIZED_CYLINDER:
+        modeller->comp_type = component_type::generalized_cylinder;
+        std::cout << "\t-Generalized cylinders are modelled" << std::endl;
+        break;
+    case wxID_MODEL_COMPONENT_CUBOID:
+        modeller->comp_type = component_type::cuboid;
+        std::cout << "\t-Cuboids are modelled" << std::endl;
+        break;
+    case wxID_MODEL_COMPONENT_SPHERE:
+        modeller->comp_type = component_type::sphere;
+        std::cout << "\t-Spheres are modelled" << std::endl;
+        break;
+    default:
+        UsrLogErrorMessage("Id match error when setting component type");
+        break;
+    }
+}
+
 void OsgWxFrame::OnToggleAxisDrawingMode(wxCommandEvent& event) {
 
     ImageModeller* modeller = m_canvas->UsrGetModeller();
@@ -752,20 +1289,28 @@ void OsgWxFrame::OnToggleAxisDrawingMode(wxCommandEvent& event) {
 
 void OsgWxFrame::OnToggleImageDisplay(wxCommandEvent& event) {
 
+    background_image_display_mode mode = m_imgdisp_mode;
     switch (event.GetId()) {
     case wxID_VIEW_DISPLAY_IMAGE:
-        if(m_imgdisp_mode == background_image_display_mode::gradient_image) {
-            usrChangeBackgroundImage(background_image_display_mode::image);
-            m_imgdisp_mode = background_image_display_mode::image;
-        }
+        mode = background_image_display_mode::image;
         break;
     case wxID_VIEW_DISPLAY_GRADIENT_IMAGE:
-        if(m_imgdisp_mode == background_image_display_mode::image) {
-            usrChangeBackgroundImage(background_image_display_mode::gradient_image);
-            m_imgdisp_mode = background_image_display_mode::gradient_image;
-        }
+        mode = background_image_display_mode::gradient_image;
+        break;
+    case wxID_VIEW_DISPLAY_SHADER_GRADIENT_IMAGE:
+        mode = background_image_display_mode::shader_gradient_image;
         break;
     }
+    if(mode == m_imgdisp_mode) return;
+    if(m_bgcam.valid()) usrChangeBackgroundImage(mode);
+    m_imgdisp_mode = mode;
+}
+
+void OsgWxFrame::OnGradientDisplaySettings(wxCommandEvent& event) {
+
+    if(!m_gradient_display_win)
+        m_gradient_display_win.reset(new GradientDisplayDialog(this, wxT("Gradient Display"), m_gradient_shader.get()));
+    m_gradient_display_win->Show(!m_gradient_display_win->IsShown());
 }
 
 void OsgWxFrame::OnToggleSymmetricProfile(wxCommandEvent& event) {
@@ -776,6 +1321,14 @@ void OsgWxFrame::OnToggleSymmetricProfile(wxCommandEvent& event) {
     else    std::cout << "\t-Symmetric profiles are off" << std::endl;
 }
 
+void OsgWxFrame::OnToggleEdgeSnapping(wxCommandEvent& event) {
+
+    bool edge = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrGetModeller()->SetProfileSnappingMode(edge ? profile_snapping_mode::nearest_edge : profile_snapping_mode::gradient_maximum);
+    if(edge) std::cout << "\t-Profiles are snapped to the edge map" << std::endl;
+    else     std::cout << "\t-Profiles are snapped to the gradient maxima" << std::endl;
+}
+
 void OsgWxFrame::OnToggleRightCylinderConstraint(wxCommandEvent& event) {
 
     bool rgc = GetMenuBar()->FindItem(event.GetId())->IsChecked();
@@ -792,43 +1345,294 @@ void OsgWxFrame::OnToggleDoubleCircleDrawingForLinearAxis(wxCommandEvent& event)
     else   std::cout << "\t-Double circle drawing for lienar axis prior is disabled" << std::endl;
 }
 
+void OsgWxFrame::OnToggleEllipseFitting(wxCommandEvent& event) {
+
+    bool fit = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrGetModeller()->SetEllipseFitting(fit);
+    if(fit) std::cout << "\t-Drawn ellipses are fitted to the edges of the gradient image" << std::endl;
+    else   std::cout << "\t-Drawn ellipses are not fitted to the edges" << std::endl;
+}
+
+void OsgWxFrame::OnToggleSubpixelSnapping(wxCommandEvent& event) {
+
+    bool sp = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrGetModeller()->SetSubpixelSnapping(sp);
+    if(sp) std::cout << "\t-Profiles are snapped to the sub-pixel gradient maxima" << std::endl;
+    else   std::cout << "\t-Profiles are snapped to the pixels of the gradient maxima" << std::endl;
+}
+
+void OsgWxFrame::OnToggleMultiStartSolving(wxCommandEvent& event) {
+
+    bool ms = GetMenuBar()->FindItem(event.GetId())->IsChecked();
+    m_canvas->UsrGetModeller()->SetMultiStartSolving(ms);
+    if(ms) std::cout << "\t-Every orientation of the ambiguous circles is solved, the best one is kept" << std::endl;
+    else   std::cout << "\t-The circle orientations are selected by the mouse position" << std::endl;
+}
+
+void OsgWxFrame::OnRecordInteractionTrace(wxCommandEvent& event) {
+
+    InteractionTraceRecorder* recorder = m_canvas->UsrGetTraceRecorder();
+    if(GetMenuBar()->FindItem(event.GetId())->IsChecked()) {
+        // the trace starts with the current settings of the modeller
+        ImageModeller* modeller = m_canvas->UsrGetModeller();
+        wxMenuBar* menubar = GetMenuBar();
+        if(modeller == nullptr) {
+            UsrLogErrorMessage("An image should be opened to record an interaction trace");
+            menubar->FindItem(event.GetId())->Check(false);
+            return;
+        }
+        BatchJob settings;
+        settings.image_path = m_path.ToStdString();
+        settings.ax_constraints = modeller->ax_constraints;
+        settings.sc_constraints = modeller->sc_constraints;
+        settings.symmetric_profiles = menubar->FindItem(wxID_MODEL_SYMMETRIC_2D_PROFILES)->IsChecked();
+        settings.snap_to_edges = menubar->FindItem(wxID_MODEL_SNAP_PROFILES_TO_EDGES)->IsChecked();
+        settings.fit_ellipses = menubar->FindItem(wxID_MODEL_FIT_ELLIPSES_TO_EDGES)->IsChecked();
+        settings.subpixel_snapping = menubar->FindItem(wxID_MODEL_SUBPIXEL_PROFILE_SNAPPING)->IsChecked();
+        settings.multi_start = menubar->FindItem(wxID_MODEL_MULTI_START_SOLVING)->IsChecked();
+        settings.right_cylinder = menubar->FindItem(wxID_MODEL_RIGHT_GENERALIZED_CYLINDER)->IsChecked();
+        settings.double_circle = menubar->FindItem(wxID_MODEL_DOUBLE_CIRCLE_FOR_LINEAR_AXIS)->IsChecked();
+        recorder->Start(settings);
+        std::cout << "\t-Recording the interaction trace" << std::endl;
+        return;
+    }
+
+    recorder->Stop();
+    std::cout << "\t-Interaction trace is recorded with " << recorder->GetTrace().events.size() << " inputs" << std::endl;
+    wxFileDialog dialog(this, wxT("Save the interaction trace"), wxEmptyString, wxEmptyString, wxT("*.cvmjob"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if(dialog.ShowModal() == wxID_CANCEL) return;
+    WriteBatchJob(dialog.GetPath().ToStdString(), recorder->GetTrace());
+}
+
 void OsgWxFrame::OnEnableRayCastDisplay(wxCommandEvent& event) {
 
     m_canvas->UsrGetModeller()->EnableRayCastDisplay(GetMenuBar()->FindItem(event.GetId())->IsChecked());
 }
 
+void OsgWxFrame::OnDisplayReprojectionError(wxCommandEvent& event) {
+
+    wxMenuItem* item = GetMenuBar()->FindItem(event.GetId());
+    if(!item->IsChecked()) {
+        if(m_error_map) m_error_map->SetEnabled(false);
+        SetStatusText(wxT(""), 1);
+        std::cout << "\t-Reprojection error display is disabled" << std::endl;
+        UsrRequestRedraw();
+        return;
+    }
+
+    // Step-1: the model is compared against the cached gradient image
+    if(!m_model.valid() || !m_pp) {
+        std::cout << "INFO: Open an image before displaying the reprojection error" << std::endl;
+        item->Check(false);
+        return;
+    }
+    std::string grad_img_path = GradientCache::Instance().GetCacheFilePath(m_path.ToStdString());
+    osg::ref_ptr<osg::Texture2D> gradient;
+    if(!grad_img_path.empty() && wxFileExists(grad_img_path))
+        gradient = usrGetBackgroundTexture(grad_img_path);
+    if(!gradient.valid()) {
+        std::cout << "INFO: Gradient image is not ready yet" << std::endl;
+        usrStartGradientJob(m_path.ToStdString());
+        item->Check(false);
+        return;
+    }
+
+    // Step-2: the passes are created once for the image and rendered with every frame
+    if(!m_error_map) {
+        m_error_map.reset(new OsgReprojectionErrorMap);
+        m_error_map->Initialize(m_model.get(), gradient.get(), m_pp->width, m_pp->height);
+        m_root->addChild(m_error_map->GetRoot());
+    }
+    else {
+        m_error_map->SetGradientTexture(gradient.get());
+    }
+    m_error_map->SetEnabled(true);
+    std::cout << "\t-Contours of the model are compared with the gradient image" << std::endl;
+    UsrRequestRedraw();
+}
+
 void OsgWxFrame::usrChangeBackgroundImage(background_image_display_mode mode) {
 
     if(mode == m_imgdisp_mode) return;
+    if(m_imgdisp_mode == background_image_display_mode::shader_gradient_image) usrApplyGradientShader(false);
 
-    osg::Image* image;
-    if(mode == background_image_display_mode::image)
-        image = osgDB::readImageFile(m_path.ToStdString());
+    // the shader reads the texture of the image, switching from or to the image is a state change
+    osg::ref_ptr<osg::Texture2D> texture;
+    if(mode == background_image_display_mode::image || mode == background_image_display_mode::shader_gradient_image) {
+        if(m_imgdisp_mode == background_image_display_mode::gradient_image) {
+            if(m_tiled_image) usrShowTiledImage();
+            else              texture = usrGetBackgroundTexture(m_path.ToStdString(), true);
+            if(texture.valid()) usrSetBackgroundTexture(texture.get(), true);
+        }
+        if(mode == background_image_display_mode::shader_gradient_image) usrApplyGradientShader(true);
+        UsrRequestRedraw();
+        return;
+    }
     else if(mode == background_image_display_mode::gradient_image) {
-         std::string grad_img_path = utilityInsertAfter(m_path, wxT('.'), wxT("_grad"));
-         std::ifstream infile(grad_img_path);
-         if(!infile.good()) {
-             OtbFloatVectorImageType::Pointer img = LoadImage<OtbFloatVectorImageType>(m_path.ToStdString());
-             OtbImageType::Pointer gimg = GradientMagnitudeImage(img);
-             SaveImage<OtbImageType>(gimg, grad_img_path);
-         }
-         image = osgDB::readImageFile(grad_img_path);
+        std::string grad_img_path = GradientCache::Instance().GetCacheFilePath(m_path.ToStdString());
+        if(grad_img_path.empty() || !wxFileExists(grad_img_path)) {
+            // displayed by usrOnGradientImageReady once the generation is completed
+            std::cout << "INFO: Gradient image is not ready yet" << std::endl;
+            usrStartGradientJob(m_path.ToStdString());
+            return;
+        }
+        texture = usrGetBackgroundTexture(grad_img_path);
     }
 
-    if(!image) {
+    if(!texture.valid()) {
         std::cout << "Image file cannot be opened!" << std::endl;
         return;
     }
+    usrSetBackgroundTexture(texture.get(), false);
+}
+
+void OsgWxFrame::usrSetBackgroundTexture(osg::Texture2D* texture, bool shared_pixels) {
+
+    osg::Node* quad = m_bgcam->getChild(0);
+    set_quad_texture(quad->asGeode()->getOrCreateStateSet(), texture);
+    quad->setNodeMask(~0u);
+    if(m_tiled_image) m_tiled_image->GetRoot()->setNodeMask(0);
+    usrReportTextureMemory(texture, shared_pixels);
+}
+
+void OsgWxFrame::usrReportTextureMemory(osg::Texture2D* texture, bool shared_pixels) {
+
+    // the image of the texture views the pixels of the repository, those are accounted once as images
+    const osg::Image* image = texture ? texture->getImage() : nullptr;
+    m_texture_memory.Set((shared_pixels || image == nullptr) ? 0 : image->getTotalSizeInBytes());
+}
+
+void OsgWxFrame::usrApplyGradientShader(bool flag) {
+
+    // the quad, or the tiles under the root of the tiled image, its state set may be being drawn
+    osg::ref_ptr<osg::Node> node = m_tiled_image ? m_tiled_image->GetRoot() : m_bgcam->getChild(0);
+    OsgGradientShader* shader = m_gradient_shader.get();
+    UsrEnqueueSceneUpdate([node, shader, flag]() {
+        if(flag) shader->Apply(node->getOrCreateStateSet());
+        else if(node->getStateSet()) shader->Remove(node->getStateSet());
+    });
+}
+
+void OsgWxFrame::usrShowTiledImage() {
+
+    // the quad has no texture of the image, only the gradient image
+    m_bgcam->getChild(0)->setNodeMask(0);
+    m_tiled_image->GetRoot()->setNodeMask(~0u);
+    m_texture_memory.Set(0);
+    UsrRequestRedraw();
+}
+
+osg::Texture2D* OsgWxFrame::usrGetBackgroundTexture(const std::string& path, bool shared_pixels) {
 
+    // frames of the shared viewer share the textures of the same image
+    if(m_shared) {
+        osg::Texture2D* texture = SharedViewer::Instance().GetTexture(path, shared_pixels);
+        if(texture && OsgTextureCompressor::Instance().IsEnabled())
+            OsgTextureCompressor::Instance().Compress(texture, path, usrSceneUpdateExecutor());
+        return texture;
+    }
+
+    osg::Image* image = read_image(path, shared_pixels);
+    if(!image) return nullptr;
     osg::Texture2D* texture = new osg::Texture2D();
     texture->setResizeNonPowerOfTwoHint(false);
     texture->setImage(image);
-    osg::StateSet* stateset = m_bgcam->getChild(0)->asGeode()->getOrCreateStateSet();
-    stateset->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+    if(OsgTextureCompressor::Instance().IsEnabled())
+        OsgTextureCompressor::Instance().Compress(texture, path, usrSceneUpdateExecutor());
+    return texture;
+}
+
+osgViewer::ViewerBase* OsgWxFrame::usrGetViewerBase() {
+
+    if(m_shared) return SharedViewer::Instance().GetViewer();
+    return static_cast<osgViewer::Viewer*>(m_viewer.get());
+}
+
+void OsgWxFrame::usrStartGradientJob(const std::string& img_path) {
+
+    // one generation at a time, the result is posted to the UI thread
+    if(m_gradient_job.IsValid()) return;
+    m_gradient_job = GradientCache::Instance().LoadAsync(img_path);
+    m_gradient_job.Then([this](const OtbImageType::Pointer& gimg) {
+        m_gradient_job.Reset();
+        usrOnGradientImageReady(gimg);
+        UsrRequestRedraw();
+    }, utilityUIExecutor());
+}
+
+void OsgWxFrame::usrCancelJobs() {
+
+    // the results of the jobs are not delivered to the frame after this
+    m_gradient_job.Cancel();
+    m_solve_job.Cancel();
+    m_multi_view_job.Cancel();
+    m_octree_job.Cancel();
+    if(m_model_loader) m_model_loader->Cancel();
+}
+
+void OsgWxFrame::usrOnGradientImageReady(OtbImageType::Pointer gimg) {
+
+    if(gimg.IsNull()) {
+        UsrLogErrorMessage("ERROR: Gradient image cannot be generated");
+        return;
+    }
+
+    if(m_canvas->UsrGetModeller() != nullptr)
+        m_canvas->UsrGetModeller()->SetGradientImage(gimg);
+    std::cout << "INFO: Gradient image is ready" << std::endl;
+
+    if(m_imgdisp_mode == background_image_display_mode::gradient_image && m_bgcam.valid()) {
+        osg::ref_ptr<osg::Texture2D> texture = usrGetBackgroundTexture(GradientCache::Instance().GetCacheFilePath(m_path.ToStdString()));
+        if(texture.valid()) usrSetBackgroundTexture(texture.get(), false);
+    }
+}
+
+void OsgWxFrame::usrCollectReprojectionError() {
+
+    double error = 0.0;
+    unsigned int num_contour_pixels = 0;
+    if(!m_error_map || !m_error_map->GetScore(error, num_contour_pixels)) return;
+    if(num_contour_pixels == 0) SetStatusText(wxT("Reprojection error: no contour"), 1);
+    else                        SetStatusText(wxString::Format(wxT("Reprojection error: %.3f (%u contour pixels)"), error, num_contour_pixels), 1);
+}
+
+void OsgWxFrame::usrCollectBakedTextures() {
+
+    if(!m_texture_baker) return;
+    int num_textured = m_texture_baker->Collect(usrSceneUpdateExecutor());
+    if(num_textured < 0) return;
+    SetStatusText(wxT(""), 1);
+    std::cout << "\t-Textures of " << num_textured << " components are baked from the image" << std::endl;
+    if(OsgTextureCompressor::Instance().IsEnabled()) usrCompressTextures();
+    UsrRequestRedraw();
+}
+
+void OsgWxFrame::usrCompressTextures() {
+
+    // the displayed background, the compressed textures are skipped
+    OsgTextureCompressor& compressor = OsgTextureCompressor::Instance();
+    if(m_bgcam.valid() && m_bgcam->getNumChildren() > 0) {
+        osg::StateSet* ss = m_bgcam->getChild(0)->getStateSet();
+        osg::Texture2D* texture = ss ? dynamic_cast<osg::Texture2D*>(ss->getTextureAttribute(0, osg::StateAttribute::TEXTURE)) : nullptr;
+        std::string path = (m_imgdisp_mode == background_image_display_mode::gradient_image) ?
+                           GradientCache::Instance().GetCacheFilePath(m_path.ToStdString()) : m_path.ToStdString();
+        if(texture) compressor.Compress(texture, path, usrSceneUpdateExecutor());
+    }
+    if(!m_model.valid()) return;
+    for(unsigned int i = 0; i < m_model->getNumChildren(); ++i) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_model->getChild(i));
+        if(gcyl && gcyl->GetTextureObject())
+            compressor.Compress(gcyl->GetTextureObject(), std::string(), usrSceneUpdateExecutor());
+    }
 }
 
 void OsgWxFrame::OnDisplayLocalFrames(wxCommandEvent& event) {
-    UsrLogErrorMessage("Not implemented yet");
+
+    for(size_t i = 0; i < m_model->getNumChildren(); ++i) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_model->getChild(i)->asGroup());
+        if(gcyl) gcyl->DisplayLocalFrames(GetMenuBar()->FindItem(event.GetId())->IsChecked());
+    }
+    m_root->dirtyBound();
 }
 
 void OsgWxFrame::OnDisplayWorldCoordinateFrame(wxCommandEvent& event) {
@@ -873,51 +1677,101 @@ void OsgWxFrame::OnDisplayComponentRelationsDialog(wxCommandEvent& event) {
 
 void OsgWxFrame::OnSaveLastComponent(wxCommandEvent& event) {
 
-    wxFileDialog dialog(this, wxT("Save the model"), wxEmptyString, wxEmptyString, wxT("*.osg"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    wxFileDialog dialog(this, wxT("Save the model"), wxEmptyString, wxEmptyString, wxT("*.ply;*.osgb;*.osg;*.obj"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
     if(dialog.ShowModal() == wxID_CANCEL) return;
     m_canvas->UsrSaveModel(dialog.GetPath());
 }
 
 void OsgWxFrame::OnSaveModel(wxCommandEvent& event) {
 
-    wxFileDialog dialog(this, wxT("Save the model"), wxEmptyString, wxEmptyString, wxT("*.osg"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    wxFileDialog dialog(this, wxT("Save the model"), wxEmptyString, wxEmptyString, wxT("*.ply;*.osgb;*.osg;*.obj"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
     if(dialog.ShowModal() == wxID_CANCEL) return;
-    osgDB::writeNodeFile(*m_model, dialog.GetPath().ToStdString());
+
+    // the maximum error of the simplified surfaces in the model coordinates, the last one is proposed
+    wxTextEntryDialog error_dialog(this, wxT("Maximum geometric error of the exported surfaces (0 keeps the full resolution)"),
+                                   wxT("Simplify the Model"), wxString::Format(wxT("%g"), m_export_error));
+    if(error_dialog.ShowModal() == wxID_CANCEL) return;
+    double max_error = 0.0;
+    if(!error_dialog.GetValue().ToDouble(&max_error) || max_error < 0.0) {
+        UsrLogErrorMessage("Invalid maximum error");
+        return;
+    }
+    m_export_error = max_error;
+    write_model_file(*m_model, dialog.GetPath().ToStdString(), max_error);
+}
+
+void OsgWxFrame::OnSaveProject(wxCommandEvent& event) {
+
+    if(!m_canvas->UsrGetModeller()) return;
+    if(m_project) {
+        UsrLogErrorMessage("Project is still being opened");
+        return;
+    }
+    wxFileDialog dialog(this, wxT("Save the project"), wxEmptyString, wxEmptyString, wxT("*.cvmproj"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if(dialog.ShowModal() == wxID_CANCEL) return;
+    m_canvas->UsrGetModeller()->SaveProject(dialog.GetPath().ToStdString());
 }
 
 void OsgWxFrame::OnDeleteModel(wxCommandEvent& event) {
 
+    m_project.reset();
+    if(m_frozen) m_frozen->Thaw();
     m_model->removeChildren(0, m_model->getNumChildren());
+    m_canvas->UsrGetComponentIndex()->Clear();
     m_canvas->UsrGetModeller()->DeleteModel();
     osg::Switch* selection_boxes = m_canvas->UsrGetSelectionBoxes();
     selection_boxes->removeChildren(0, selection_boxes->getNumChildren());
 }
 
+void OsgWxFrame::OnUndo(wxCommandEvent& event) {
+
+    ImageModeller* modeller = m_canvas->UsrGetModeller();
+    if(!modeller) return;
+    if(m_project) {
+        UsrLogErrorMessage("Project is still being opened");
+        return;
+    }
+
+    // the sections are patched by the update traversal as the other edits of the scene
+    bool redo = (event.GetId() == wxID_EDIT_REDO);
+    UsrEnqueueSceneUpdate([this, modeller, redo]() {
+        if(m_canvas->UsrGetModeller() != modeller) return;
+        bool done = redo ? modeller->Redo() : modeller->Undo();
+        if(done) UsrUpdateGeosemanticConstraints();
+    });
+    UsrRequestRedraw();
+}
+
 void OsgWxFrame::OnDeleteSelectedComponents(wxCommandEvent& event) {
 
     std::vector<unsigned int> _selections;
     UsrGetSelectedComponentIds(_selections);
     if(_selections.empty()) return;
+    if(m_frozen) m_frozen->Thaw();
 
     std::vector<int> selections;
     std::for_each(_selections.begin(), _selections.end(), [&selections](unsigned int i) {
         selections.push_back(static_cast<int>(i));
     });
-    int id = 0;
-    for(int i = 0; i < selections.size(); ++i) {
-        for(int j = 0; j < m_model->getNumChildren(); ++j) {
-            osg::Node* child = m_model->getChild(j);
-            if(child->getUserValue("Component_Id", id)) {
-                if(id == selections[i]) {
-                    m_model->removeChild(j);
-                    break;
-                }
-            }
-            else {
-                UsrLogErrorMessage("Component_Id could not be found!");
-            }
-        }
+
+    // one pass over the children instead of a search per selected component
+    OsgComponentIndex* index = m_canvas->UsrGetComponentIndex();
+    std::unordered_set<const osg::Node*> deleted;
+    for(unsigned int id : _selections) {
+        osg::Node* node = index->Find(id);
+        if(node) deleted.insert(node);
+        else UsrLogErrorMessage("Component_Id could not be found!");
     }
+    std::vector<osg::ref_ptr<osg::Node>> kept;
+    kept.reserve(m_model->getNumChildren());
+    for(unsigned int i = 0; i < m_model->getNumChildren(); ++i)
+        if(deleted.count(m_model->getChild(i)) == 0)
+            kept.push_back(m_model->getChild(i));
+    m_model->removeChildren(0, m_model->getNumChildren());
+    for(auto& child : kept)
+        m_model->addChild(child.get());
+    for(unsigned int id : _selections)
+        index->Remove(id);
 
     osg::Switch* selection_boxes = m_canvas->UsrGetSelectionBoxes();
     selection_boxes->removeChildren(0, selection_boxes->getNumChildren());
@@ -926,7 +1780,236 @@ void OsgWxFrame::OnDeleteSelectedComponents(wxCommandEvent& event) {
 
 void OsgWxFrame::OnSolveModel(wxCommandEvent& event) {
 
-    m_canvas->UsrGetModeller()->GetModelSolver()->Solve();
+    if(m_solve_job.IsValid()) {
+        std::cout << "INFO: Model is already being solved" << std::endl;
+        return;
+    }
+
+    // Step-1: the snapshot of the components is taken here, the solve runs on the thread pool
+    // (the solution moves the components, the frozen ones are drawn from their own geometries again)
+    if(m_frozen) m_frozen->Thaw();
+    std::shared_ptr<ModelSolver::Snapshot> snapshot = m_canvas->UsrGetModeller()->GetModelSolver()->TakeSnapshot();
+    if(!snapshot) return;
+    m_solve_job = ThreadPool::Instance().Submit([snapshot](const CancellationToken& token) {
+        return ModelSolver::SolveSnapshot(*snapshot, token);
+    });
+    SetStatusText(wxT("Solving..."), 1);
+
+    // Step-2: the components that still exist are moved on the UI thread
+    m_solve_job.Then([this, snapshot](const bool& solved) {
+        m_solve_job.Reset();
+        SetStatusText(wxT(""), 1);
+        if(!solved) return;
+        std::vector<std::pair<unsigned int, osg::Matrixd>> transforms;
+        m_canvas->UsrGetModeller()->GetModelSolver()->ApplySolution(*snapshot, &transforms);
+        m_canvas->UsrGetModeller()->RecordComponentTransforms(transforms);
+    }, usrSceneUpdateExecutor());
+}
+
+void OsgWxFrame::OnSolveInAllViews(wxCommandEvent& event) {
+
+    if(m_views.size() < 2) {
+        UsrLogErrorMessage("Open at least two oriented images to solve in all views");
+        return;
+    }
+    if(m_multi_view_job.IsValid()) {
+        std::cout << "INFO: Components are already being solved in all views" << std::endl;
+        return;
+    }
+
+    // Step-1: the sections of the selected generalized cylinders, or of the active one, are copied here
+    typedef std::vector<std::pair<unsigned int, SectionStore>> section_list;
+    std::shared_ptr<section_list> components = std::make_shared<section_list>();
+    std::vector<unsigned int> ids;
+    UsrGetSelectedComponentIds(ids);
+    GeneralizedCylinder* active = m_canvas->UsrGetModeller()->GetActiveComponent();
+    if(ids.empty() && active) ids.push_back(active->GetComponentId());
+    for(unsigned int id : ids) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_canvas->UsrGetComponentIndex()->FindComponent(id));
+        if(gcyl) components->push_back(std::make_pair(id, gcyl->GetGeometry()->GetSections()));
+    }
+    if(components->empty()) {
+        std::cout << "INFO: There is no generalized cylinder to solve" << std::endl;
+        return;
+    }
+
+    // Step-2: the views are prepared and the components solved on the thread pool
+    std::vector<std::shared_ptr<CameraView>> views = m_views;
+    m_multi_view_job = ThreadPool::Instance().Submit([views, components](const CancellationToken& token) {
+        MultiViewSolver solver(views);
+        if(!solver.PrepareViews(token)) return false;
+        bool solved = false;
+        for(auto& item : *components) {
+            if(token.IsCancelled()) return false;
+            if(solver.Solve(item.second, token)) solved = true;
+            else                                 item.second = SectionStore();
+        }
+        return solved;
+    });
+    SetStatusText(wxT("Solving in all views..."), 1);
+
+    // Step-3: the sections of the components that still exist are replaced on the UI thread
+    ImageModeller* modeller = m_canvas->UsrGetModeller();
+    m_multi_view_job.Then([this, modeller, components](const bool& solved) {
+        m_multi_view_job.Reset();
+        SetStatusText(wxT(""), 1);
+        if(!solved || m_canvas->UsrGetModeller() != modeller) return;
+        for(const auto& item : *components) {
+            if(item.second.empty()) continue;
+            if(modeller->ReplaceSections(item.first, item.second))
+                std::cout << "\t-Component " << item.first << " is solved in " << m_views.size() << " views" << std::endl;
+        }
+    }, usrSceneUpdateExecutor());
+}
+
+void OsgWxFrame::OnDetectRelations(wxCommandEvent& event) {
+
+    // Step-1: the proposals that add a constraint to the ones the pairs already have
+    ModelSolver* solver = UsrGetModelSolver();
+    std::vector<ComponentBase*> components;
+    solver->GetComponents(components);
+    std::vector<geosemcon> detected, proposals;
+    RelationDetector().Detect(components, detected);
+    for(const geosemcon& rel : detected) {
+        std::vector<geosemantic_constraints> gsc;
+        solver->GetConstraints(rel.component_1, rel.component_2, gsc);
+        for(geosemantic_constraints c : rel.constraints) {
+            if(std::find(gsc.begin(), gsc.end(), c) == gsc.end()) {
+                proposals.push_back(rel);
+                break;
+            }
+        }
+    }
+    if(proposals.empty()) {
+        std::cout << "INFO: No new relations are detected between " << components.size() << " components" << std::endl;
+        return;
+    }
+
+    // Step-2: the operator confirms the proposals, all of them are checked
+    wxArrayString choices;
+    wxArrayInt selections;
+    for(size_t i = 0; i < proposals.size(); ++i) {
+        wxString text = wxString::Format(wxT("%u - %u: "), proposals[i].component_1, proposals[i].component_2);
+        for(size_t k = 0; k < proposals[i].constraints.size(); ++k)
+            text += (k ? wxT(", ") : wxT("")) + wxString(to_string(proposals[i].constraints[k]));
+        choices.Add(text);
+        selections.Add(static_cast<int>(i));
+    }
+    wxMultiChoiceDialog dialog(this, wxT("Relations proposed between the nearby components"), wxT("Detect Relations"), choices);
+    dialog.SetSelections(selections);
+    if(dialog.ShowModal() != wxID_OK) return;
+
+    // Step-3: the confirmed ones are added as one step of the history
+    std::vector<geosemcon> accepted;
+    selections = dialog.GetSelections();
+    for(size_t i = 0; i < selections.GetCount(); ++i)
+        accepted.push_back(proposals[selections[i]]);
+    m_canvas->UsrGetModeller()->AddConstraints(accepted);
+    UsrUpdateGeosemanticConstraints();
+    std::cout << "\t-" << accepted.size() << " of " << proposals.size() << " proposed relations are added" << std::endl;
+}
+
+void OsgWxFrame::OnBakeTextures(wxCommandEvent& event) {
+
+    if(!m_model.valid() || !m_pp) {
+        std::cout << "INFO: Open an image before baking the textures" << std::endl;
+        return;
+    }
+    if(m_texture_baker && m_texture_baker->IsBaking()) {
+        std::cout << "INFO: Textures are already being baked" << std::endl;
+        return;
+    }
+
+    // Step-1: the selected generalized cylinders, or all of them
+    std::vector<unsigned int> ids;
+    UsrGetSelectedComponentIds(ids);
+    std::vector<GeneralizedCylinder*> components;
+    for(unsigned int i = 0; i < m_model->getNumChildren(); ++i) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_model->getChild(i));
+        if(gcyl && (ids.empty() || std::find(ids.begin(), ids.end(), gcyl->GetComponentId()) != ids.end()))
+            components.push_back(gcyl);
+    }
+    if(components.empty()) {
+        std::cout << "INFO: There is no generalized cylinder to texture" << std::endl;
+        return;
+    }
+
+    // Step-2: the passes are rendered by the next frame with the image, not the displayed gradient image
+    if(!m_texture_baker) {
+        osg::ref_ptr<osg::Texture2D> image = usrGetBackgroundTexture(m_path.ToStdString(), true);
+        if(!image.valid()) {
+            UsrLogErrorMessage("Image cannot be loaded as a single texture for the baking");
+            return;
+        }
+        m_texture_baker.reset(new OsgTextureBaker(image.get(), *m_pp, baked_texture_size));
+        osg::ref_ptr<osg::Node> baker_root = m_texture_baker->GetRoot();
+        UsrEnqueueSceneUpdate([this, baker_root]() {
+            // unless another image is opened meanwhile, the update traversal runs on the UI thread
+            if(m_texture_baker && m_texture_baker->GetRoot() == baker_root.get()) m_root->addChild(baker_root.get());
+        });
+    }
+    if(!m_texture_baker->Bake(m_model.get(), components, usrSceneUpdateExecutor())) {
+        std::cout << "INFO: The components have no side surface to texture" << std::endl;
+        return;
+    }
+    SetStatusText(wxT("Baking textures..."), 1);
+    UsrRequestRedraw();
+}
+
+void OsgWxFrame::OnFreezeComponents(wxCommandEvent& event) {
+
+    if(event.GetId() == wxID_MODEL_UNFREEZE_COMPONENTS) {
+        if(m_frozen && m_frozen->GetNumFrozen() > 0) {
+            std::cout << "\t-" << m_frozen->GetNumFrozen() << " components are unfrozen" << std::endl;
+            m_frozen->Thaw();
+            UsrRequestRedraw();
+        }
+        return;
+    }
+    if(!m_model.valid()) return;
+
+    // Step-1: the components that are neither selected nor being modelled
+    osg::Node* active = m_canvas->UsrGetModeller()->GetActiveComponent();
+    std::vector<osg::Node*> finished;
+    bool selected = false;
+    for(unsigned int i = 0; i < m_model->getNumChildren(); ++i) {
+        osg::Node* child = m_model->getChild(i);
+        // the primitives are already drawn by one batch per kind, the textured components keep their texture
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(child);
+        if(child == active || child->getNodeMask() == 0x1 || dynamic_cast<PrimitiveComponent*>(child) || (gcyl && gcyl->GetTexture())) continue;
+        if(child->getUserValue("Selection", selected) && !selected)
+            finished.push_back(child);
+    }
+
+    // Step-2: the previously frozen components are merged again with the new ones
+    if(!m_frozen) m_frozen.reset(new OsgFrozenComponents(m_viewer->getCamera(), m_model.get()));
+    m_frozen->Freeze(finished);
+    std::cout << "\t-" << finished.size() << " components are merged into static geometry" << std::endl;
+    UsrRequestRedraw();
+}
+
+void OsgWxFrame::OnFitAxisSplines(wxCommandEvent& event) {
+
+    // a center may deviate 5% of its radius, the spline is sampled with two sections per control point
+    const double tolerance = 0.05;
+    const size_t sections_per_control_point = 2;
+
+    std::vector<unsigned int> ids;
+    UsrGetSelectedComponentIds(ids);
+    for(unsigned int id : ids) {
+        GeneralizedCylinder* gcyl = dynamic_cast<GeneralizedCylinder*>(m_canvas->UsrGetComponentIndex()->FindComponent(id));
+        if(!gcyl) continue;
+        size_t num_sections = gcyl->GetGeometry()->GetNumberOfSections();
+        if(!gcyl->FitAxisSpline(tolerance)) {
+            std::cout << "	-Component " << id << " has too few sections for a spline" << std::endl;
+            continue;
+        }
+        size_t num_samples = std::min(num_sections, sections_per_control_point * gcyl->GetAxisSpline().GetNumControlPoints());
+        osg::ref_ptr<GeneralizedCylinder> component(gcyl);
+        UsrEnqueueSceneUpdate([component, num_samples]() { component->SampleAxisSpline(num_samples); });
+        std::cout << "	-Component " << id << ": " << num_sections << " sections, " << gcyl->GetAxisSpline().GetNumControlPoints()
+                  << " control points, sampled with " << num_samples << " sections" << std::endl;
+    }
 }
 
 void OsgWxFrame::OnPrintProjectionMatrix(wxCommandEvent& event) {
@@ -957,3 +2040,46 @@ void OsgWxFrame::OnPrintProjectionMatrix(wxCommandEvent& event) {
 void OsgWxFrame::UsrLogErrorMessage(const std::string& str) const {
     m_parent->UsrLogErrorMessage(str);
 }
+
+void OsgWxFrame::UsrRequestRedraw() {
+
+    if(m_viewer.valid()) m_viewer->requestRedraw();
+    wxWakeUpIdle();
+}
+
+void OsgWxFrame::UsrEnqueueSceneUpdate(std::function<void()> mutation) {
+
+    m_update_queue->Enqueue(std::move(mutation));
+    UsrRequestRedraw();
+}
+
+executor_type OsgWxFrame::UsrGetSceneUpdateExecutor() {
+    return usrSceneUpdateExecutor();
+}
+
+executor_type OsgWxFrame::usrSceneUpdateExecutor() {
+
+    // called by the workers: the redraw is requested without touching the frame
+    executor_type enqueue = m_update_queue->GetExecutor();
+    osg::observer_ptr<osgViewer::View> viewer(m_viewer.get());
+    return [enqueue, viewer](std::function<void()> f) {
+        enqueue(std::move(f));
+        osg::ref_ptr<osgViewer::View> view;
+        if(viewer.lock(view)) view->requestRedraw();
+        wxWakeUpIdle();
+    };
+}
+
+void OsgWxFrame::UsrSetMaxFrameRate(double fps) {
+
+    m_max_frame_rate = (fps > 0.0) ? fps : 0.0;
+    UsrRequestRedraw();
+}
+
+bool OsgWxFrame::ProcessEvent(wxEvent& event) {
+
+    // every menu command may change the scene
+    bool processed = wxFrame::ProcessEvent(event);
+    if(event.GetEventType() == wxEVT_COMMAND_MENU_SELECTED) UsrRequestRedraw();
+    return processed;
+}
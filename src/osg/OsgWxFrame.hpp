@@ -2,9 +2,18 @@
 #define _OSG_WX_FRAME_HPP
 
 #include "OsgUtility.hpp"
+#include "ModelLoader.hpp"
+#include "OsgUpdateQueue.hpp"
+#include "../image/algorithms/Algorithms.hpp"
+#include "../modeller/optimization/Constraints.hpp"
+#include "../utility/MemoryRegistry.hpp"
+#include "../utility/ThreadPool.hpp"
 #include <wx/frame.h>
+#include <wx/timer.h>
 #include <osgViewer/Viewer>
 #include <osg/PolygonMode>
+#include <osg/Timer>
+#include <atomic>
 #include <memory>
 
 class MainFrame;
@@ -12,7 +21,16 @@ class OsgWxGLCanvas;
 class OsgWxGraphicsWindow;
 class ProjectionParameters;
 class ComponentRelationsDialog;
+class GradientDisplayDialog;
 class ModelSolver;
+class OsgFrozenComponents;
+class OsgGradientShader;
+class OsgOrderIndependentTransparency;
+class OsgReprojectionErrorMap;
+class OsgTextureBaker;
+class OsgTiledImage;
+class ProjectFile;
+class CameraView;
 
 enum class operation_mode : unsigned char {
     displaying,
@@ -21,7 +39,8 @@ enum class operation_mode : unsigned char {
 
 enum class background_image_display_mode : unsigned char {
     image,
-    gradient_image
+    gradient_image,         // the cached gradient image
+    shader_gradient_image   // the gradient of the image computed by OsgGradientShader
 };
 
 class OsgWxFrame : public wxFrame {
@@ -33,8 +52,10 @@ private:
     wxString m_path;
     osg::ref_ptr<osgGA::CameraManipulator> m_camera_manipulator;
 
-    osg::ref_ptr<osgViewer::Viewer> m_viewer;       // viewer
+    osg::ref_ptr<osgViewer::View> m_viewer;         // own osgViewer::Viewer, or a view of the shared viewer
+    bool m_shared;                                  // rendered by the SharedViewer
     osg::ref_ptr<osg::Group> m_root;                // root of the scene graph
+    osg::ref_ptr<OsgUpdateQueue> m_update_queue;    // mutations applied by the update traversal of the root
     osg::ref_ptr<osg::Group> m_model;               // parent node that keeps all the model
     osg::ref_ptr<osg::Camera> m_bgcam;              // to render background image
     osg::ref_ptr<osg::Geode> m_bgeode;              // to draw on the screen
@@ -48,14 +69,48 @@ private:
     background_image_display_mode m_imgdisp_mode;
     std::shared_ptr<ProjectionParameters> m_pp;
     std::unique_ptr<ComponentRelationsDialog> m_component_relations_win;
+    Job<OtbImageType::Pointer> m_gradient_job;          // background generation of the gradient image
+    Job<bool> m_solve_job;                              // geosemantic constraints solved in the background
+    Job<bool> m_multi_view_job;                         // sections refined in all the views in the background
+    std::vector<std::shared_ptr<CameraView>> m_views;   // oriented images, the first one is modelled
+    Job<bool> m_octree_job;                             // conversion of a point cloud into an octree
+    std::shared_ptr<std::atomic<float>> m_octree_progress;
+    std::unique_ptr<ModelLoader> m_model_loader;        // background loading of the model files
+    osg::ref_ptr<osg::Group> m_loaded_model;            // model being loaded, the chunks are attached by OnIdle
+    std::unique_ptr<OsgReprojectionErrorMap> m_error_map;  // heat map of the model against the gradient image
+    std::unique_ptr<OsgTextureBaker> m_texture_baker;   // textures of the components from the image
+    std::unique_ptr<OsgTiledImage> m_tiled_image;       // background image larger than a single texture
+    std::unique_ptr<OsgOrderIndependentTransparency> m_oit;  // unsorted blending of the translucent components
+    std::unique_ptr<OsgFrozenComponents> m_frozen;      // finished components drawn as merged geometry
+    std::unique_ptr<OsgGradientShader> m_gradient_shader;       // gradient display without a gradient image
+    std::unique_ptr<GradientDisplayDialog> m_gradient_display_win;
+    std::unique_ptr<ProjectFile> m_project;             // project being opened, the components are created by OnIdle
+    size_t m_project_next;                              // next component of the project to create
+    double m_export_error;                              // maximum error of the simplified export, 0 for the full resolution
+    MemoryRegistry::Allocation m_texture_memory;        // background texture unless it is a view of the shared pixels
+    int m_frozen_evictor;                               // thaws the frozen components over the memory budget
+    bool m_thaw_pending;                                // until the update traversal has thawed them
+
+    /*
+     * Frames are rendered on demand: OnIdle renders a frame only if a redraw is requested or the
+     * viewer has pending events (camera manipulation), and does not ask for more idle events
+     * otherwise. The timer wakes the idle handler up for the capped frames and for polling the
+     * background jobs.
+     */
+    wxTimer m_frame_timer;
+    osg::Timer_t m_last_frame_tick;
+    double m_max_frame_rate;                            // frames per second, 0 for no limit
 
 public:
 
     OsgWxFrame(wxWindow* parent, const wxPoint& pos, const wxSize& size, operation_mode md);
+    ~OsgWxFrame();
     void UsrSetFrameId(int id) { m_id = id; }
     bool UsrOpenModelFile();
+    bool UsrOpenPointCloudFile();
     bool UsrOpenOrientedImageFile();
     bool UsrOpenImageFile();
+    bool UsrOpenProjectFile();
     void UsrSetPerspectiveProjectionMatrix(double fovy, double aspect, double near, double far);
     void UsrSetOrthographicProjectionMatrix(double left, double right, double bottom, double top, double near, double far);
     void UsrAddSelectableComponent(osg::Node* node, unsigned int component_id);
@@ -68,38 +123,82 @@ public:
     void UsrGetSelectedComponentIds(std::vector<unsigned int>& ids);
     ModelSolver* UsrGetModelSolver();
     void UsrUpdateGeosemanticConstraints();
+    // the constraints between two components, the change can be undone
+    void UsrSetGeosemanticConstraints(unsigned int cp1, unsigned int cp2, const std::vector<geosemantic_constraints>& gsc);
     void UsrLogErrorMessage(const std::string& str) const;
+    void UsrRequestRedraw();
+    // applies the mutation of the scene by the update traversal of the next frame
+    void UsrEnqueueSceneUpdate(std::function<void()> mutation);
+    // the same from any thread, e.g. for the continuations of the jobs
+    executor_type UsrGetSceneUpdateExecutor();
+    void UsrSetMaxFrameRate(double fps);
+    bool ProcessEvent(wxEvent& event) override;
 private:
 
     // Member functions
     bool usrLoadModelFile(const wxString& fpath);
+    bool usrLoadPointCloudFile(const wxString& fpath);
+    bool usrShowPointCloud(const std::string& index_path);
     bool usrLoadOrientationFile(const wxString& fpath);
-    bool usrLoadImageFile(const wxString& fpath);
+    bool usrLoadImageFile(const wxString& fpath, const ProjectFile* project = nullptr, const CameraView* view = nullptr);
     void usrInitMenubar();
     void usrSetPolygonMode(osg::Node* node);
     void usrSetCustomPolygonMode(osg::Node* node, osg::PolygonMode::Mode mode, osg::PolygonMode::Face face);
     void usrUpdateFileTree(char type);
     void usrEnableModellingMenus(bool flag);
     void usrChangeBackgroundImage(background_image_display_mode mode);
+    void usrSetBackgroundTexture(osg::Texture2D* texture, bool shared_pixels);
+    void usrReportTextureMemory(osg::Texture2D* texture, bool shared_pixels);
+    void usrShowTiledImage();
+    void usrApplyGradientShader(bool flag);
+    osg::Texture2D* usrGetBackgroundTexture(const std::string& path, bool shared_pixels = false);
+    osgViewer::ViewerBase* usrGetViewerBase();
+    void usrStartGradientJob(const std::string& img_path);
+    void usrOnGradientImageReady(OtbImageType::Pointer gimg);
+    void usrCancelJobs();
+    void usrCollectLoadedModel();
+    void usrCreateProjectComponents();
+    void usrScheduleIdle(double seconds);
+    executor_type usrSceneUpdateExecutor();
+    void usrCollectReprojectionError();
+    void usrCollectBakedTextures();
+    void usrCompressTextures();
 
     // Event handlers
     void OnIdle(wxIdleEvent& event);
+    void OnFrameTimer(wxTimerEvent& event);
     void OnClose(wxCloseEvent& event);
     void OnOpenModel(wxCommandEvent& event);
+    void OnCancelLoading(wxCommandEvent& event);
     void OnOpenOrientedImage(wxCommandEvent& event);
+    void OnOpenProject(wxCommandEvent& event);
     void OnExit(wxCommandEvent& event);
     void OnToggleProjectionMode(wxCommandEvent& event);
+    void OnToggleFrameRateLimit(wxCommandEvent& event);
+    void OnToggleKdTreePicking(wxCommandEvent& event);
+    void OnToggleColorIdPicking(wxCommandEvent& event);
+    void OnToggleTextureCompression(wxCommandEvent& event);
+    void OnToggleOrderIndependentTransparency(wxCommandEvent& event);
     void OnToggleRenderMode(wxCommandEvent& event);
     void OnToggleRenderFaceMode(wxCommandEvent& event);
     void OnToggleRenderType(wxCommandEvent& event);
+    void OnToggleProceduralSweep(wxCommandEvent& event);
     void OnToggleUIOperationMode(wxCommandEvent& event);
     void OnToggleModellingConstraints(wxCommandEvent& event);
+    void OnToggleComponentType(wxCommandEvent& event);
     void OnToggleAxisDrawingMode(wxCommandEvent& event);
     void OnToggleImageDisplay(wxCommandEvent& event);
+    void OnGradientDisplaySettings(wxCommandEvent& event);
     void OnToggleSymmetricProfile(wxCommandEvent& event);
+    void OnToggleEdgeSnapping(wxCommandEvent& event);
+    void OnToggleEllipseFitting(wxCommandEvent& event);
+    void OnToggleSubpixelSnapping(wxCommandEvent& event);
     void OnToggleRightCylinderConstraint(wxCommandEvent& event);
     void OnToggleDoubleCircleDrawingForLinearAxis(wxCommandEvent& event);
+    void OnToggleMultiStartSolving(wxCommandEvent& event);
+    void OnRecordInteractionTrace(wxCommandEvent& event);
     void OnEnableRayCastDisplay(wxCommandEvent& event);
+    void OnDisplayReprojectionError(wxCommandEvent& event);
     void OnDisplayLocalFrames(wxCommandEvent& event);
     void OnDisplayWorldCoordinateFrame(wxCommandEvent& event);
     void OnDisplayVertexNormals(wxCommandEvent& event);
@@ -108,9 +207,16 @@ private:
     void OnPrintProjectionMatrix(wxCommandEvent& event);
     void OnSaveLastComponent(wxCommandEvent& event);
     void OnSaveModel(wxCommandEvent& event);
+    void OnSaveProject(wxCommandEvent& event);
     void OnDeleteModel(wxCommandEvent& event);
+    void OnUndo(wxCommandEvent& event);
     void OnDeleteSelectedComponents(wxCommandEvent& event);
     void OnSolveModel(wxCommandEvent& event);
+    void OnSolveInAllViews(wxCommandEvent& event);
+    void OnDetectRelations(wxCommandEvent& event);
+    void OnBakeTextures(wxCommandEvent& event);
+    void OnFreezeComponents(wxCommandEvent& event);
+    void OnFitAxisSplines(wxCommandEvent& event);
     DECLARE_EVENT_TABLE()
 };
 
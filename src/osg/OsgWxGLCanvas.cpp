@@ -5,11 +5,13 @@
 #include "../modeller/ImageModeller.hpp"
 #include "../modeller/ProjectionParameters.hpp"
 #include "../geometry/Primitives.hpp"
+#include "../batch/InteractionTrace.hpp"
 #include <wx/dcclient.h>
 #include <wx/image.h>
 
 #include <osg/MatrixTransform>
 #include <osg/ShapeDrawable>
+#include <cstdlib>
 
 BEGIN_EVENT_TABLE(OsgWxGLCanvas, wxGLCanvas)
 EVT_SIZE(OsgWxGLCanvas::OnSize)
@@ -30,8 +32,11 @@ END_EVENT_TABLE()
 
 OsgWxGLCanvas::OsgWxGLCanvas(wxWindow *parent, wxWindowID id, int *attributes, const wxPoint& pos, const wxSize& size, long style, const wxString& name) :
     wxGLCanvas(parent, id, attributes, pos, size, style|wxFULL_REPAINT_ON_RESIZE, name),
+    m_parent(nullptr),
+    m_modeller(nullptr),
+    m_modeller_generation(0),
     m_selection_handler(new OsgSelectionHandler()),
-    m_modeller(nullptr) {
+    m_trace_recorder(new InteractionTraceRecorder()) {
 
     // initialize the graphics context
     m_context = new wxGLContext(this);
@@ -74,7 +79,8 @@ void OsgWxGLCanvas::UsrInitializeModeller(const std::shared_ptr<ProjectionParame
         delete m_modeller;
         m_modeller = nullptr;
     }
-    m_modeller = new ImageModeller(fpath, pp, this);
+    ++m_modeller_generation;
+    m_modeller = new ImageModeller(fpath.ToStdString(), pp, this);
     m_modeller->Initialize2DDrawingInterface(m_parent->UsrGetBackgroundNode());
 }
 
@@ -82,14 +88,46 @@ ImageModeller* OsgWxGLCanvas::UsrGetModeller() {
     return m_modeller;
 }
 
+InteractionTraceRecorder* OsgWxGLCanvas::UsrGetTraceRecorder() {
+    return m_trace_recorder.get();
+}
+
 osg::Switch* OsgWxGLCanvas::UsrGetSelectionBoxes() {
     return m_selection_handler->GetOrCreateSelectionBoxSwitch();
 }
 
+OsgComponentIndex* OsgWxGLCanvas::UsrGetComponentIndex() {
+    return m_selection_handler->GetComponentIndex();
+}
+
+void OsgWxGLCanvas::UsrUseKdTreesForPicking(bool flag) {
+    m_selection_handler->SetUseKdTrees(flag);
+}
+
+void OsgWxGLCanvas::UsrUseColorIdsForPicking(bool flag) {
+    m_selection_handler->SetPickingMode(flag ? picking_mode::color_id : picking_mode::ray_intersection);
+}
+
+osg::Camera* OsgWxGLCanvas::UsrGetPickCamera() {
+    return m_selection_handler->GetOrCreatePickCamera();
+}
+
+bool OsgWxGLCanvas::UsrUpdatePendingSelection() {
+    return m_selection_handler->UpdatePendingSelection();
+}
+
+bool OsgWxGLCanvas::UsrIsSelectionPending() const {
+    return m_selection_handler->IsSelectionPending();
+}
+
 const osg::Camera* const OsgWxGLCanvas::UsrGetMainCamera() const {
     return m_parent->UsrGetMainCamera();
 }
 
+executor_type OsgWxGLCanvas::UsrGetModellingExecutor() {
+    return m_parent->UsrGetSceneUpdateExecutor();
+}
+
 void OsgWxGLCanvas::UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id) {
     m_parent->UsrAddSelectableComponent(node, component_id);
 }
@@ -128,10 +166,14 @@ void OsgWxGLCanvas::UsrSaveModel(const wxString& path) const {
 }
 
 void OsgWxGLCanvas::OnPaint(wxPaintEvent& event) {
+
     wxPaintDC dc(this);
+    if(m_parent) m_parent->UsrRequestRedraw();
 }
 
 void OsgWxGLCanvas::OnSize(wxSizeEvent& event) {
+
+    if(m_parent) m_parent->UsrRequestRedraw();
     //    if (m_graphics_window.valid()) {
     //        wxSize size = m_parent->GetClientSize();
     //        m_graphics_window->getEventQueue()->windowResize(
@@ -153,10 +195,14 @@ void OsgWxGLCanvas::OnChar(wxKeyEvent &event) {
 #endif
 
     if(m_parent->UsrGetUIOperationMode() == operation_mode::modelling) {
-        if(key == WXK_ESCAPE)
-            m_modeller->EscapeKeyPressed();
-        else if (key == WXK_SPACE)
-            m_modeller->DeleteLastSection();
+        if(key == WXK_ESCAPE) {
+            m_trace_recorder->Record(batch_event_type::escape);
+            usrEnqueueModelling([](ImageModeller* modeller) { modeller->EscapeKeyPressed(); });
+        }
+        else if (key == WXK_SPACE) {
+            m_trace_recorder->Record(batch_event_type::delete_last_section);
+            usrEnqueueModelling([](ImageModeller* modeller) { modeller->DeleteLastSection(); });
+        }
     }
 
     if(key == 't' || key == 'T') {
@@ -171,6 +217,7 @@ void OsgWxGLCanvas::OnChar(wxKeyEvent &event) {
 
     if(m_graphics_window.valid())
         m_graphics_window->getEventQueue()->keyPress(key);
+    m_parent->UsrRequestRedraw();
 
     // If this key event is not processed here, we should call
     // event.Skip() to allow processing to continue.
@@ -196,6 +243,9 @@ void OsgWxGLCanvas::OnMouseEnter(wxMouseEvent& event) {
 
 void OsgWxGLCanvas::OnMouseDown(wxMouseEvent &event) {
 
+    if(event.ControlDown())
+        m_selection_start = usrDeviceToLogical(event.GetPosition());
+
     operation_mode uiop_mode = m_parent->UsrGetUIOperationMode();
     if(uiop_mode == operation_mode::modelling) {
 
@@ -203,14 +253,20 @@ void OsgWxGLCanvas::OnMouseDown(wxMouseEvent &event) {
 
         // clicked point
         wxPoint pt = usrDeviceToLogical(event.GetPosition());
+        double x = static_cast<double>(pt.x), y = static_cast<double>(pt.y);
 
         // Left click
-        if(event.GetButton() == 1)
-            m_modeller->OnLeftClick(static_cast<double>(pt.x), static_cast<double>(pt.y));
+        if(event.GetButton() == 1) {
+            m_trace_recorder->Record(batch_event_type::left_click, pt.x, pt.y);
+            usrEnqueueModelling([x, y](ImageModeller* modeller) { modeller->OnLeftClick(x, y); });
+        }
 
         // Right click
-        if(event.GetButton() == 3)
-            m_modeller->OnRightClick(static_cast<double>(pt.x), static_cast<double>(pt.y));
+        if(event.GetButton() == 3) {
+            m_trace_recorder->Record(batch_event_type::right_click, pt.x, pt.y);
+            usrEnqueueModelling([x, y](ImageModeller* modeller) { modeller->OnRightClick(x, y); });
+        }
+        m_parent->UsrRequestRedraw();
     }
     else {
         if(m_graphics_window.valid())
@@ -222,8 +278,14 @@ void OsgWxGLCanvas::OnMouseUp(wxMouseEvent& event) {
 
     if(event.ControlDown()) {
         wxPoint pt = usrDeviceToLogical(event.GetPosition());
-        m_selection_handler->HandleSelection(m_parent->UsrGetMainCamera(), pt.x, pt.y);
-        m_parent->UsrUpdateGeosemanticConstraints();
+        bool changed = false;
+        // a drag selects every component in the rectangle, the color id picks are collected by the frame
+        if(std::abs(pt.x - m_selection_start.x) > 3 || std::abs(pt.y - m_selection_start.y) > 3)
+            changed = m_selection_handler->HandleRectangleSelection(m_parent->UsrGetMainCamera(), m_selection_start.x, m_selection_start.y, pt.x, pt.y);
+        else
+            changed = m_selection_handler->HandleSelection(m_parent->UsrGetMainCamera(), pt.x, pt.y);
+        if(changed) m_parent->UsrUpdateGeosemanticConstraints();
+        m_parent->UsrRequestRedraw();
     }
 
     if(m_graphics_window.valid()) {
@@ -237,7 +299,10 @@ void OsgWxGLCanvas::OnMouseMotion(wxMouseEvent& event) {
 
         if(m_modeller == nullptr) return;
         wxPoint pt = usrDeviceToLogical(event.GetPosition());
-        m_modeller->OnMouseMove(static_cast<double>(pt.x), static_cast<double>(pt.y));
+        m_trace_recorder->Record(batch_event_type::move, pt.x, pt.y);
+        double x = static_cast<double>(pt.x), y = static_cast<double>(pt.y);
+        usrEnqueueModelling([x, y](ImageModeller* modeller) { modeller->OnMouseMove(x, y); });
+        m_parent->UsrRequestRedraw();
     }
     else if(m_parent->UsrGetUIOperationMode() == operation_mode::displaying) {
         if (m_graphics_window.valid()) {
@@ -251,8 +316,10 @@ void OsgWxGLCanvas::OnMouseMotion(wxMouseEvent& event) {
 void OsgWxGLCanvas::OnMouseWheel(wxMouseEvent& event) {
     int delta = event.GetWheelRotation() / event.GetWheelDelta() * event.GetLinesPerAction();
     if(m_parent->UsrGetUIOperationMode() == operation_mode::modelling) {
-        if(delta > 0) m_modeller->IncrementScaleFactor();
-        else m_modeller->DecrementScaleFactor();
+        m_trace_recorder->Record(delta > 0 ? batch_event_type::scale_up : batch_event_type::scale_down);
+        if(delta > 0) usrEnqueueModelling([](ImageModeller* modeller) { modeller->IncrementScaleFactor(); });
+        else usrEnqueueModelling([](ImageModeller* modeller) { modeller->DecrementScaleFactor(); });
+        m_parent->UsrRequestRedraw();
     }
     else if(m_parent->UsrGetUIOperationMode() == operation_mode::displaying) {
         if (m_graphics_window.valid())
@@ -260,6 +327,17 @@ void OsgWxGLCanvas::OnMouseWheel(wxMouseEvent& event) {
     }
 }
 
+void OsgWxGLCanvas::usrEnqueueModelling(std::function<void(ImageModeller*)> input) {
+
+    // the modeller edits its geometries and overlays, the draw thread may still be drawing them
+    // the generation, not the pointer: a new modeller may be allocated at the address of the deleted one
+    if(m_modeller == nullptr) return;
+    unsigned int generation = m_modeller_generation;
+    m_parent->UsrEnqueueSceneUpdate([this, generation, input]() {
+        if(m_modeller != nullptr && m_modeller_generation == generation) input(m_modeller);
+    });
+}
+
 void OsgWxGLCanvas::UsrLogErrorMessage(const std::string& str) const {
     m_parent->UsrLogErrorMessage(str);
 }
@@ -2,19 +2,23 @@
 #define _OSG_WX_CANVAS_HPP
 
 #include "../modeller/components/GeneralizedCylinderGeometry.hpp"
+#include "../modeller/ModellerView.hpp"
 
 #include <wx/glcanvas.h>
 #include <osgViewer/Viewer>
+#include <functional>
 #include <memory>
 
 class OsgWxFrame;
 class ImageModeller;
 class ProjectionParameters;
 class OsgSelectionHandler;
+class OsgComponentIndex;
+class InteractionTraceRecorder;
 
 template <typename T> class Point2D;
 
-class OsgWxGLCanvas : public wxGLCanvas {
+class OsgWxGLCanvas : public wxGLCanvas, public ModellerView {
 
 private:
     osg::ref_ptr<osgViewer::GraphicsWindow> m_graphics_window;
@@ -22,7 +26,10 @@ private:
     wxCursor m_oldCursor;
     OsgWxFrame* m_parent;
     ImageModeller* m_modeller;
+    unsigned int m_modeller_generation;     // incremented once the modeller is replaced, for the enqueued inputs
     std::unique_ptr<OsgSelectionHandler> m_selection_handler;
+    wxPoint m_selection_start;      // logical position of the ctrl + mouse down
+    std::unique_ptr<InteractionTraceRecorder> m_trace_recorder;  // inputs forwarded to the modeller
 
 public:
 
@@ -32,23 +39,34 @@ public:
     void UsrUseCursor(bool value);
     void UsrMakeContextCurrent();
     void UsrInitializeModeller(const std::shared_ptr<ProjectionParameters>& pp, const wxString& fpath);
-    void UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id);
+    void UsrAddSelectableNodeToDisplay(osg::Node* node, unsigned int component_id) override;
     void UsrAddToBackgroundDisplay(osg::Geometry* geom);
 
-    void UsrDeviceToLogical(Point2D<int>& pt) const;
+    void UsrDeviceToLogical(Point2D<int>& pt) const override;
     void UsrDeviceToLogical(wxPoint& p) const;
-    void UsrDeviceToLogical(osg::Vec2d& p) const;
+    void UsrDeviceToLogical(osg::Vec2d& p) const override;
 
     void UsrSaveModel(const wxString& path) const;
     void UsrLogErrorMessage(const std::string& str) const;
     void UsrSetRenderingType(rendering_type rtype);
     ImageModeller* UsrGetModeller();
     osg::Switch* UsrGetSelectionBoxes();
-    const osg::Camera* const UsrGetMainCamera() const;
+    OsgComponentIndex* UsrGetComponentIndex();
+    void UsrUseKdTreesForPicking(bool flag);
+    void UsrUseColorIdsForPicking(bool flag);
+    osg::Camera* UsrGetPickCamera();
+    bool UsrUpdatePendingSelection();
+    bool UsrIsSelectionPending() const;
+    const osg::Camera* const UsrGetMainCamera() const override;
+    // the update traversal of the frame, as the inputs of usrEnqueueModelling
+    executor_type UsrGetModellingExecutor() override;
+    InteractionTraceRecorder* UsrGetTraceRecorder();
 
 private:
 
     inline wxPoint usrDeviceToLogical(const wxPoint& p) const;
+    // applied to the current modeller by the update traversal, dropped if the modeller is replaced by then
+    void usrEnqueueModelling(std::function<void(ImageModeller*)> input);
 
     // Event handlers
     void OnPaint(wxPaintEvent& event);
@@ -0,0 +1,401 @@
+#include "PointCloudOctree.hpp"
+#include "ModelLoader.hpp"
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/PagedLOD>
+#include <osg/Point>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/ReaderWriter>
+#include <osgDB/Registry>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// a point of a node file, the alpha byte is the level of the point in the bucket files
+struct point_record {
+    float x, y, z;
+    unsigned char r, g, b, a;
+};
+static_assert(sizeof(point_record) == 16, "point records are written as they are");
+
+static const unsigned int max_level = 20;
+static const unsigned int grid_bits = 21;              // bits of the quantized coordinates, enough for max_level
+static const size_t memory_points = 1 << 23;          // points of the upper levels distributed in memory
+static const unsigned int bucket_level = 2;           // 64 bucket files for the deeper levels
+static const size_t slice_points = 1 << 22;           // points of a bucket grouped at once
+static const size_t bucket_buffer_size = 1 << 12;     // records buffered per bucket
+
+struct octree_index {
+    osg::Vec3d offset;                                // the points of the node files are relative to it
+    osg::Vec3f origin;                                // corner of the cube relative to the offset
+    float size;
+    unsigned long long num_points;
+    std::map<std::string, unsigned long long> nodes;  // point count by path
+};
+
+static uint64_t splitmix64(uint64_t x) {
+
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// points of the levels [0, level], the capacity of a level is four times the one of its parent
+static unsigned long long cumulative_capacity(unsigned int level) {
+
+    unsigned long long total = 0, capacity = PointCloudOctree::node_capacity;
+    for(unsigned int l = 0; l <= level; ++l, capacity *= 4)
+        total += capacity;
+    return total;
+}
+
+static std::string node_path(const octree_index& index, const point_record& p, unsigned int level) {
+
+    // the digit of a level is the octant of the point in the cube of its ancestor, x as the high bit
+    const double scale = static_cast<double>(1u << grid_bits) / index.size;
+    uint32_t q[3];
+    const float c[3] = { p.x - index.origin.x(), p.y - index.origin.y(), p.z - index.origin.z() };
+    for(int k = 0; k < 3; ++k)
+        q[k] = static_cast<uint32_t>(std::max(0.0, std::min(static_cast<double>((1u << grid_bits) - 1), c[k] * scale)));
+
+    std::string path(1, 'r');
+    for(unsigned int l = 1; l <= level; ++l) {
+        unsigned int bit = grid_bits - l;
+        path.push_back(static_cast<char>('0' + ((((q[0] >> bit) & 1u) << 2) | (((q[1] >> bit) & 1u) << 1) | ((q[2] >> bit) & 1u))));
+    }
+    return path;
+}
+
+static bool write_index(const std::string& path, const octree_index& index) {
+
+    std::ofstream out(path.c_str());
+    if(!out) return false;
+    out.precision(17);
+    out << "cvm_point_octree 1\n";
+    out << "offset " << index.offset.x() << " " << index.offset.y() << " " << index.offset.z() << "\n";
+    out << "cube " << index.origin.x() << " " << index.origin.y() << " " << index.origin.z() << " " << index.size << "\n";
+    out << "points " << index.num_points << "\n";
+    out << "nodes " << index.nodes.size() << "\n";
+    for(auto& node : index.nodes)
+        out << node.first << " " << node.second << "\n";
+    return static_cast<bool>(out);
+}
+
+static bool read_index(const std::string& path, octree_index& index) {
+
+    std::ifstream in(path.c_str());
+    std::string keyword;
+    int version = 0;
+    size_t num_nodes = 0;
+    if(!(in >> keyword >> version) || keyword != "cvm_point_octree" || version != 1) return false;
+    in >> keyword >> index.offset.x() >> index.offset.y() >> index.offset.z();
+    in >> keyword >> index.origin.x() >> index.origin.y() >> index.origin.z() >> index.size;
+    in >> keyword >> index.num_points;
+    in >> keyword >> num_nodes;
+    std::string node;
+    unsigned long long count = 0;
+    for(size_t i = 0; i < num_nodes && (in >> node >> count); ++i)
+        index.nodes[node] = count;
+    return static_cast<bool>(in) && index.nodes.count("r") != 0;
+}
+
+static bool append_records(const std::string& path, const point_record* records, size_t count) {
+
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    if(!file) return false;
+    bool written = std::fwrite(records, sizeof(point_record), count, file) == count;
+    return (std::fclose(file) == 0) && written;
+}
+
+std::string PointCloudOctree::GetIndexPath(const std::string& ply_path) {
+
+    return osgDB::concatPaths(osgDB::getNameLessExtension(ply_path) + ".octree", "cloud.pco");
+}
+
+bool PointCloudOctree::Build(const std::string& ply_path, const std::string& index_path, const CancellationToken& token, std::atomic<float>& progress) {
+
+    std::atomic<unsigned long long> bytes_read(0), file_size(0);
+    auto read_progress = [&](float first, float last) {
+        unsigned long long size = file_size;
+        return first + (last - first) * ((size > 0) ? std::min(1.0f, static_cast<float>(static_cast<double>(bytes_read) / size)) : 0.0f);
+    };
+
+    // Step-1: the bounds, the first pass over the file
+    osg::BoundingBoxd bounds;
+    unsigned long long num_points = 0;
+    bool read = ModelLoader::ReadPlyPoints(ply_path, [&](const osg::Vec3dArray& points, const osg::Vec4ubArray*) {
+        for(const osg::Vec3d& p : points) bounds.expandBy(p);
+        num_points += points.size();
+        progress = read_progress(0.0f, 0.4f);
+        return true;
+    }, token, bytes_read, file_size);
+    if(!read || num_points == 0 || token.IsCancelled()) return false;
+
+    // Step-2: a fresh directory, the index is written last thus an incomplete octree has none
+    const std::string dir = osgDB::getFilePath(index_path);
+    if(!osgDB::makeDirectory(dir)) {
+        std::cout << "ERROR: Octree directory cannot be created: " << dir << std::endl;
+        return false;
+    }
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(dir);
+    for(const std::string& name : contents) {
+        std::string extension = osgDB::getLowerCaseFileExtension(name);
+        if(extension == "pcn" || extension == "pco" || extension == "tmp")
+            std::remove(osgDB::concatPaths(dir, name).c_str());
+    }
+
+    octree_index index;
+    index.offset = bounds.center();
+    double extent = std::max(bounds.xMax() - bounds.xMin(), std::max(bounds.yMax() - bounds.yMin(), bounds.zMax() - bounds.zMin()));
+    index.size = static_cast<float>(std::max(extent * 1.0001, 1e-6));
+    index.origin = osg::Vec3f(-0.5f * index.size, -0.5f * index.size, -0.5f * index.size);
+    index.num_points = num_points;
+
+    // the levels of the random subsamples, the upper ones fit in memory
+    unsigned int mem_levels = 1;
+    while(mem_levels < max_level && cumulative_capacity(mem_levels) <= memory_points) ++mem_levels;
+    std::vector<unsigned long long> level_ends;
+    for(unsigned int l = 0; l < max_level; ++l) {
+        level_ends.push_back(cumulative_capacity(l));
+        if(level_ends.back() >= num_points) break;
+    }
+    level_ends.back() = num_points;
+
+    // Step-3: the distribution of the points, the second pass over the file
+    std::unordered_map<std::string, std::vector<point_record>> memory_nodes;
+    std::vector<std::FILE*> buckets(1u << (3 * bucket_level), nullptr);
+    std::vector<std::vector<point_record>> bucket_buffers(buckets.size());
+    auto bucket_path = [&dir](size_t b) { return osgDB::concatPaths(dir, "bucket_" + std::to_string(b) + ".tmp"); };
+    bool written = true;
+    auto flush_bucket = [&](size_t b) {
+        if(bucket_buffers[b].empty()) return;
+        if(!buckets[b]) buckets[b] = std::fopen(bucket_path(b).c_str(), "wb");
+        if(!buckets[b] || std::fwrite(bucket_buffers[b].data(), sizeof(point_record), bucket_buffers[b].size(), buckets[b]) != bucket_buffers[b].size())
+            written = false;
+        bucket_buffers[b].clear();
+    };
+
+    unsigned long long point_index = 0;
+    read = ModelLoader::ReadPlyPoints(ply_path, [&](const osg::Vec3dArray& points, const osg::Vec4ubArray* colors) {
+        for(size_t i = 0; i < points.size(); ++i, ++point_index) {
+            osg::Vec3d p = points[i] - index.offset;
+            point_record record = { static_cast<float>(p.x()), static_cast<float>(p.y()), static_cast<float>(p.z()), 255, 255, 255, 0 };
+            if(colors) {
+                record.r = (*colors)[i].r();
+                record.g = (*colors)[i].g();
+                record.b = (*colors)[i].b();
+            }
+
+            // a random rank of the point, its level is the first one whose capacity covers the rank
+            double u = static_cast<double>(splitmix64(point_index) >> 11) * (1.0 / 9007199254740992.0);
+            unsigned long long rank = static_cast<unsigned long long>(u * num_points);
+            unsigned int level = static_cast<unsigned int>(std::upper_bound(level_ends.begin(), level_ends.end(), rank) - level_ends.begin());
+            level = std::min(level, static_cast<unsigned int>(level_ends.size()) - 1);
+            if(level < mem_levels) {
+                memory_nodes[node_path(index, record, level)].push_back(record);
+                continue;
+            }
+            record.a = static_cast<unsigned char>(level);
+            const std::string bucket = node_path(index, record, bucket_level);
+            size_t b = 0;
+            for(size_t k = 1; k < bucket.size(); ++k) b = 8 * b + static_cast<size_t>(bucket[k] - '0');
+            bucket_buffers[b].push_back(record);
+            if(bucket_buffers[b].size() == bucket_buffer_size) flush_bucket(b);
+        }
+        progress = read_progress(0.4f, 0.8f);
+        return written;
+    }, token, bytes_read, file_size);
+    for(size_t b = 0; b < buckets.size(); ++b) {
+        flush_bucket(b);
+        if(buckets[b] && std::fclose(buckets[b]) != 0) written = false;
+    }
+    if(!read || !written || token.IsCancelled()) {
+        for(size_t b = 0; b < buckets.size(); ++b) std::remove(bucket_path(b).c_str());
+        if(read && !written) std::cout << "ERROR: Octree buckets cannot be written: " << dir << std::endl;
+        return false;
+    }
+
+    // Step-4: the nodes of the upper levels
+    for(auto& node : memory_nodes) {
+        if(!append_records(osgDB::concatPaths(dir, node.first + ".pcn"), node.second.data(), node.second.size())) written = false;
+        index.nodes[node.first] = node.second.size();
+    }
+    memory_nodes.clear();
+
+    // Step-5: the nodes of the deeper levels, a bucket is grouped by node slice by slice
+    std::vector<point_record> slice;
+    for(size_t b = 0; b < buckets.size() && written; ++b) {
+        if(token.IsCancelled()) break;
+        std::FILE* file = std::fopen(bucket_path(b).c_str(), "rb");
+        if(!file) continue;
+        slice.resize(slice_points);
+        size_t count = 0;
+        while(written && (count = std::fread(slice.data(), sizeof(point_record), slice.size(), file)) > 0) {
+            std::unordered_map<std::string, std::vector<point_record>> nodes;
+            for(size_t i = 0; i < count; ++i) {
+                point_record record = slice[i];
+                unsigned int level = record.a;
+                record.a = 255;
+                nodes[node_path(index, record, level)].push_back(record);
+            }
+            for(auto& node : nodes) {
+                if(!append_records(osgDB::concatPaths(dir, node.first + ".pcn"), node.second.data(), node.second.size())) written = false;
+                index.nodes[node.first] += node.second.size();
+            }
+        }
+        std::fclose(file);
+        std::remove(bucket_path(b).c_str());
+        progress = 0.8f + 0.2f * static_cast<float>(b + 1) / buckets.size();
+    }
+    if(!written || token.IsCancelled()) {
+        for(size_t b = 0; b < buckets.size(); ++b) std::remove(bucket_path(b).c_str());
+        if(!written) std::cout << "ERROR: Octree nodes cannot be written: " << dir << std::endl;
+        return false;
+    }
+
+    // a sparse cube may have points at a level and none at the level above, its empty ancestors
+    // are kept in the index (without a file) to reach it
+    std::vector<std::string> paths;
+    for(auto& node : index.nodes) paths.push_back(node.first);
+    for(const std::string& path : paths)
+        for(size_t n = 1; n < path.size(); ++n)
+            index.nodes.insert(std::make_pair(path.substr(0, n), 0ull));
+    if(!write_index(index_path, index)) {
+        std::cout << "ERROR: Octree index cannot be written: " << index_path << std::endl;
+        return false;
+    }
+    progress = 1.0f;
+    std::cout << "INFO: Octree of " << num_points << " points in " << index.nodes.size() << " nodes: " << index_path << std::endl;
+    return true;
+}
+
+// the indices of the opened clouds, shared by the page in requests of the pager thread
+static std::mutex s_index_mutex;
+static std::map<std::string, std::shared_ptr<const octree_index>> s_indices;
+
+static std::shared_ptr<const octree_index> find_index(const std::string& index_path, bool reload) {
+
+    std::lock_guard<std::mutex> lock(s_index_mutex);
+    auto it = s_indices.find(index_path);
+    if(it != s_indices.end() && !reload) return it->second;
+
+    std::shared_ptr<octree_index> index = std::make_shared<octree_index>();
+    if(!read_index(index_path, *index)) return nullptr;
+    s_indices[index_path] = index;
+    return index;
+}
+
+static osg::Node* create_node(const octree_index& index, const std::string& dir, const std::string& path) {
+
+    auto it = index.nodes.find(path);
+    if(it == index.nodes.end()) return nullptr;
+
+    // Step-1: the points of the node
+    std::vector<point_record> records(static_cast<size_t>(it->second));
+    if(!records.empty()) {
+        std::FILE* file = std::fopen(osgDB::concatPaths(dir, path + ".pcn").c_str(), "rb");
+        size_t count = file ? std::fread(records.data(), sizeof(point_record), records.size(), file) : 0;
+        if(file) std::fclose(file);
+        records.resize(count);
+    }
+    osg::Group* group = new osg::Group;
+    if(!records.empty()) {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(records.size());
+        osg::ref_ptr<osg::Vec4ubArray> colors = new osg::Vec4ubArray(records.size());
+        colors->setNormalize(true);
+        for(size_t i = 0; i < records.size(); ++i) {
+            (*vertices)[i].set(records[i].x, records[i].y, records[i].z);
+            (*colors)[i].set(records[i].r, records[i].g, records[i].b, 255);
+        }
+        osg::ref_ptr<osg::Geometry> geom = new osg::Geometry;
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        geom->setVertexArray(vertices.get());
+        geom->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+        geom->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, static_cast<GLsizei>(records.size())));
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(geom.get());
+        group->addChild(geode.get());
+    }
+
+    // Step-2: the children are paged in by their screen space error
+    const float refine_pixels = PointCloudOctree::max_screen_space_error * std::sqrt(static_cast<float>(PointCloudOctree::node_capacity));
+    float cell = index.size / static_cast<float>(1u << (path.size() - 1));
+    osg::Vec3f corner = index.origin;
+    for(size_t l = 1; l < path.size(); ++l) {
+        int digit = path[l] - '0';
+        float half = index.size / static_cast<float>(1u << l);
+        corner += osg::Vec3f((digit & 4) ? half : 0.0f, (digit & 2) ? half : 0.0f, (digit & 1) ? half : 0.0f);
+    }
+    for(int digit = 0; digit < 8; ++digit) {
+        std::string child = path + static_cast<char>('0' + digit);
+        if(index.nodes.count(child) == 0) continue;
+        float half = 0.5f * cell;
+        osg::Vec3f child_corner = corner + osg::Vec3f((digit & 4) ? half : 0.0f, (digit & 2) ? half : 0.0f, (digit & 1) ? half : 0.0f);
+        osg::ref_ptr<osg::PagedLOD> lod = new osg::PagedLOD;
+        lod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        lod->setCenter(child_corner + osg::Vec3f(0.5f * half, 0.5f * half, 0.5f * half));
+        lod->setRadius(0.5f * half * std::sqrt(3.0f));
+        lod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+        lod->setFileName(0, osgDB::concatPaths(dir, child + ".pcn"));
+        lod->setRange(0, refine_pixels, FLT_MAX);
+        group->addChild(lod.get());
+    }
+    return group;
+}
+
+// reads the node files requested by the PagedLOD nodes, the index is next to them
+class ReaderWriterPointOctree : public osgDB::ReaderWriter {
+public:
+    ReaderWriterPointOctree() { supportsExtension("pcn", "Node of a point cloud octree"); }
+    const char* className() const override { return "Point cloud octree node reader"; }
+
+    ReadResult readNode(const std::string& file, const osgDB::ReaderWriter::Options*) const override {
+
+        if(!acceptsExtension(osgDB::getLowerCaseFileExtension(file))) return ReadResult::FILE_NOT_HANDLED;
+        const std::string dir = osgDB::getFilePath(file);
+        std::shared_ptr<const octree_index> index = find_index(osgDB::concatPaths(dir, "cloud.pco"), false);
+        if(!index) return ReadResult::ERROR_IN_READING_FILE;
+        osg::Node* node = create_node(*index, dir, osgDB::getStrippedName(file));
+        return node ? ReadResult(node) : ReadResult(ReadResult::FILE_NOT_FOUND);
+    }
+};
+
+osg::Node* PointCloudOctree::Open(const std::string& index_path) {
+
+    static std::once_flag registered;
+    std::call_once(registered, []() { osgDB::Registry::instance()->addReaderWriter(new ReaderWriterPointOctree); });
+
+    // a rebuilt cloud replaces the cached index
+    std::shared_ptr<const octree_index> index = find_index(index_path, true);
+    if(!index) {
+        std::cout << "ERROR: Invalid point cloud octree: " << index_path << std::endl;
+        return nullptr;
+    }
+    osg::ref_ptr<osg::Node> root = create_node(*index, osgDB::getFilePath(index_path), "r");
+    if(!root.valid()) return nullptr;
+
+    // the float coordinates of the nodes are relative to the offset
+    osg::MatrixTransform* cloud = new osg::MatrixTransform(osg::Matrix::translate(index->offset));
+    cloud->addChild(root.get());
+    cloud->setNodeMask(0x1);
+    osg::StateSet* ss = cloud->getOrCreateStateSet();
+    ss->setAttributeAndModes(new osg::Point(2.0f), osg::StateAttribute::ON);
+    ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    std::cout << "INFO: Point cloud of " << index->num_points << " points in " << index->nodes.size() << " nodes" << std::endl;
+    return cloud;
+}
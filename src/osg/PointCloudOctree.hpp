@@ -0,0 +1,38 @@
+#ifndef POINT_CLOUD_OCTREE_HPP
+#define POINT_CLOUD_OCTREE_HPP
+
+#include "../utility/ThreadPool.hpp"
+#include <osg/Node>
+#include <atomic>
+#include <string>
+
+/*
+ * Out-of-core octree of a point cloud, paged in by the database pager of the viewer.
+ *
+ * A cloud of hundreds of millions of points does not fit in memory as a single geometry. Build
+ * converts a PLY point cloud into a directory next to it: the index file cloud.pco (the offset, the
+ * cube, the point counts of the nodes) and one file per node named by its path from the root (r,
+ * r0, r07, ...) with the raw points of the node, float coordinates relative to the offset and RGBA
+ * colors. As in Potree the levels are additive: every level is a random subsample of the cloud,
+ * about node_capacity points for the root and four times more for each level below (the points of
+ * a surface), thus a node and its ancestors together are a uniform subsample of its cube. The
+ * conversion needs two passes over the file: the bounds, then the distribution of the points into
+ * the nodes, the upper levels in memory, the deeper ones through buckets on the disk.
+ *
+ * Open returns the root of the cloud: the points of a node are always drawn, the child nodes are
+ * osg::PagedLOD nodes loaded by the pager once the spacing of their points (their projected size
+ * divided by the square root of the node capacity) exceeds max_screen_space_error pixels, and
+ * expired by the pager when they are no longer visited. The cloud is display only (node mask 0x1).
+ */
+class PointCloudOctree {
+public:
+    static const unsigned int node_capacity = 1 << 16;     // points of the root node
+    static constexpr float max_screen_space_error = 1.5f;  // pixels between the points of a node
+
+    // <directory of the PLY file>/<name>.octree/cloud.pco
+    static std::string GetIndexPath(const std::string& ply_path);
+    static bool Build(const std::string& ply_path, const std::string& index_path, const CancellationToken& token, std::atomic<float>& progress);
+    static osg::Node* Open(const std::string& index_path);
+};
+
+#endif // POINT_CLOUD_OCTREE_HPP
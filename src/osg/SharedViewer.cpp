@@ -0,0 +1,68 @@
+#include "SharedViewer.hpp"
+#include "OsgUtility.hpp"
+
+#include <iostream>
+
+bool SharedViewer::s_enabled = false;
+
+SharedViewer& SharedViewer::Instance() {
+
+    static SharedViewer instance;
+    return instance;
+}
+
+bool SharedViewer::IsEnabled() {
+    return s_enabled;
+}
+
+void SharedViewer::SetEnabled(bool flag) {
+    s_enabled = flag;
+}
+
+SharedViewer::SharedViewer() :
+    m_viewer(new osgViewer::CompositeViewer),
+    m_last_frame_tick(0) {
+
+    m_viewer->setThreadingModel(osgViewer::ViewerBase::CullThreadPerCameraDrawThreadPerContext);
+}
+
+void SharedViewer::AddView(osgViewer::View* view) {
+
+    // the composite viewer stops and restarts its threads itself
+    m_viewer->addView(view);
+    std::cout << "INFO: Shared viewer renders " << m_viewer->getNumViews() << " views" << std::endl;
+}
+
+void SharedViewer::RemoveView(osgViewer::View* view) {
+
+    m_viewer->removeView(view);
+
+    // drop the expired cache entries
+    for(auto it = m_textures.begin(); it != m_textures.end(); ) {
+        if(it->second.valid()) ++it;
+        else it = m_textures.erase(it);
+    }
+}
+
+osgViewer::CompositeViewer* SharedViewer::GetViewer() {
+    return m_viewer.get();
+}
+
+osg::Timer_t& SharedViewer::GetLastFrameTick() {
+    return m_last_frame_tick;
+}
+
+osg::Texture2D* SharedViewer::GetTexture(const std::string& path, bool shared_pixels) {
+
+    auto it = m_textures.find(path);
+    if(it != m_textures.end() && it->second.valid())
+        return it->second.get();
+
+    osg::ref_ptr<osg::Image> image = read_image(path, shared_pixels);
+    if(!image.valid()) return nullptr;
+    osg::Texture2D* texture = new osg::Texture2D;
+    texture->setResizeNonPowerOfTwoHint(false);
+    texture->setImage(image.get());
+    m_textures[path] = texture;
+    return texture;
+}
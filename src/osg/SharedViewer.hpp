@@ -0,0 +1,49 @@
+#ifndef SHARED_VIEWER_HPP
+#define SHARED_VIEWER_HPP
+
+#include <osg/Texture2D>
+#include <osg/Timer>
+#include <osg/observer_ptr>
+#include <osgViewer/CompositeViewer>
+#include <map>
+#include <string>
+
+/*
+ * One osgViewer::CompositeViewer for the scene graph frames that are opened in the shared mode.
+ *
+ * The frames own an osgViewer::View each and the idle handler of any frame renders all of the
+ * views in one frame loop, with a cull thread per camera and a draw thread per context. The
+ * background textures are cached by the path of the image, frames that display the same image
+ * share the osg::Image and the osg::Texture2D (the image files are views of the ImageRepository). The GL contexts of the frames are not shared
+ * (the draw threads would race on the same texture objects), thus the texture is still uploaded
+ * once per context. The cache only holds weak references, an image is released together with
+ * the last frame that displays it.
+ *
+ * SetEnabled applies to the frames that are opened afterwards.
+ */
+class SharedViewer {
+public:
+
+    static SharedViewer& Instance();
+    static bool IsEnabled();
+    static void SetEnabled(bool flag);
+
+    void AddView(osgViewer::View* view);
+    void RemoveView(osgViewer::View* view);
+    osgViewer::CompositeViewer* GetViewer();
+    osg::Timer_t& GetLastFrameTick();
+    osg::Texture2D* GetTexture(const std::string& path, bool shared_pixels = false);
+
+private:
+
+    SharedViewer();
+    SharedViewer(const SharedViewer&) = delete;
+    SharedViewer& operator=(const SharedViewer&) = delete;
+
+    static bool s_enabled;
+    osg::ref_ptr<osgViewer::CompositeViewer> m_viewer;
+    osg::Timer_t m_last_frame_tick;
+    std::map<std::string, osg::observer_ptr<osg::Texture2D>> m_textures;
+};
+
+#endif // SHARED_VIEWER_HPP
@@ -1,4 +1,5 @@
 #include "AlgebraicKernel.hpp"
+#include "PolynomialSolver.hpp"
 
 AlgebraicKernel::AlgebraicKernel() :
     ak(),
@@ -8,6 +9,14 @@ AlgebraicKernel::AlgebraicKernel() :
 
 void AlgebraicKernel::solve(const std::vector<double>& coefficients, std::vector<double>& roots, const error_type etype, int error_bound) {
 
+    // floating point path, the exact solver is used only for ill-conditioned polynomials
+    if(SolvePolynomial(coefficients, roots))
+        return;
+    solve_exact(coefficients, roots, etype, error_bound);
+}
+
+void AlgebraicKernel::solve_exact(const std::vector<double>& coefficients, std::vector<double>& roots, const error_type etype, int error_bound) {
+
     // coefficients must be ordered from lower to higher degree for this
     // implementation. For client interface the order is from higher
     // to lower.
@@ -21,15 +30,15 @@ void AlgebraicKernel::solve(const std::vector<double>& coefficients, std::vector
     if(etype == error_type::relative) {
         Approximate_relative_1 approx_r = ak.approximate_relative_1_object();
         for(auto it = m_roots.begin(); it != m_roots.end(); ++it) {
-            for(auto it = m_roots.begin(); it != m_roots.end(); ++it) {
-                roots.push_back(((approx_r(it->first, error_bound).first + approx_r(it->first, error_bound).second)/2.0).to_double());
-            }
+            std::pair<Bound, Bound> bounds = approx_r(it->first, error_bound);
+            roots.push_back(((bounds.first + bounds.second)/2.0).to_double());
         }
     }
     else if(etype == error_type::absolute) {
         Approximate_absolute_1 approx_a = ak.approximate_absolute_1_object();
         for(auto it = m_roots.begin(); it != m_roots.end(); ++it) {
-            roots.push_back(((approx_a(it->first, error_bound).first + approx_a(it->first, error_bound).second)/2.0).to_double());
+            std::pair<Bound, Bound> bounds = approx_a(it->first, error_bound);
+            roots.push_back(((bounds.first + bounds.second)/2.0).to_double());
         }
     }
     m_roots.clear();
@@ -42,12 +51,12 @@ void AlgebraicKernel::construct_polynomial(const std::vector<CGAL::Gmpq>& coeffi
         std::cerr << "ERROR: [algebraic_kernel::construct_polynomial]: "
                   << "Polynomial degree below zero!" << std::endl;
         std::cerr << "ERROR: Degree: " << degree << std::endl;
+        return;
     }
+    // Horner scheme instead of building every power of x
+    poly = Polynomial_1(coefficients[degree]);
     while(degree > 0) {
-        Polynomial_1 p = x;
-        for(int i = 0; i < degree-1; i++) { p *= x; }
-        poly += coefficients[degree] * p;
         --degree;
+        poly = poly * x + coefficients[degree];
     }
-    poly += coefficients[0];
 }
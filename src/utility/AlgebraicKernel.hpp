@@ -23,7 +23,10 @@ public:
     };
 
     AlgebraicKernel();
+    // floating point solver with a fallback to the exact one for ill-conditioned polynomials
     void solve(const std::vector<double>& coefficients, std::vector<double>& roots, const error_type etype = error_type::relative, int error_bound = 50);
+    // always isolates the roots with exact arithmetic
+    void solve_exact(const std::vector<double>& coefficients, std::vector<double>& roots, const error_type etype = error_type::relative, int error_bound = 50);
 private:
     AK ak;
     Solver_1 solver;
@@ -0,0 +1,29 @@
+#include "LatencyProbe.hpp"
+
+static thread_local LatencySample* attached_sample = nullptr;
+static thread_local int open_scopes[3] = { 0, 0, 0 };
+
+void LatencyProbe::Attach(LatencySample* sample) {
+    attached_sample = sample;
+}
+
+void LatencyProbe::Detach() {
+    attached_sample = nullptr;
+}
+
+LatencyProbe::Scope::Scope(latency_stage stage, const char* name) : m_profile(name), m_sample(attached_sample), m_stage(static_cast<int>(stage)), m_counted(false) {
+
+    // only the outermost scope of a stage is timed, the inner ones are only counted
+    if(m_sample == nullptr) return;
+    m_counted = true;
+    if(open_scopes[m_stage]++ > 0) m_sample = nullptr;
+    else m_start = std::chrono::steady_clock::now();
+}
+
+LatencyProbe::Scope::~Scope() {
+
+    if(!m_counted) return;
+    --open_scopes[m_stage];
+    if(m_sample != nullptr)
+        m_sample->stage[m_stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+}
@@ -0,0 +1,47 @@
+#ifndef LATENCY_PROBE_HPP
+#define LATENCY_PROBE_HPP
+
+#include "Profiler.hpp"
+#include <chrono>
+
+enum class latency_stage : unsigned char {
+    model_update = 0,
+    ray_cast = 1,
+    geometry_update = 2
+};
+
+// seconds spent in each stage
+struct LatencySample {
+    double stage[3];
+    LatencySample() : stage{0.0, 0.0, 0.0} { }
+};
+
+/*
+ * Time of the stages of the interactive loop, for the replay of the interaction traces.
+ *
+ * The probed functions open a Scope for their stage. The scopes of a thread add their times into
+ * the sample attached to the thread, nested scopes of the same stage are counted once. Without an
+ * attached sample a scope only reads a thread local pointer, the GUI does not pay for the clock.
+ * A scope is a Profiler scope of its name as well.
+ */
+class LatencyProbe {
+public:
+    static void Attach(LatencySample* sample);
+    static void Detach();
+
+    class Scope {
+    public:
+        Scope(latency_stage stage, const char* name);
+        ~Scope();
+    private:
+        Profiler::Scope m_profile;
+        LatencySample* m_sample;
+        int m_stage;
+        bool m_counted;
+        std::chrono::steady_clock::time_point m_start;
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+};
+
+#endif // LATENCY_PROBE_HPP
@@ -0,0 +1,263 @@
+#include "Logger.hpp"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+const size_t Logger::capacity;
+
+// records of a batch of the drain thread
+static const size_t batch_size = 256;
+// the drain thread sleeps at most this long while the buffer is empty
+static const std::chrono::milliseconds drain_period(20);
+
+static unsigned int thread_id() {
+
+    static std::atomic<unsigned int> next_id(0);
+    static thread_local unsigned int id = next_id++;
+    return id;
+}
+
+static log_level level_of(const std::string& line, log_level level) {
+
+    // the prefixes of the messages: "ERROR: ...", "WARNING: ...", "INFO: ..."
+    if(line.compare(0, 5, "ERROR") == 0)   return log_level::error;
+    if(line.compare(0, 7, "WARNING") == 0) return log_level::warning;
+    if(line.compare(0, 5, "DEBUG") == 0)   return log_level::debug;
+    if(line.compare(0, 4, "INFO") == 0)    return log_level::info;
+    return level;
+}
+
+static const char* level_name(log_level level) {
+
+    switch(level) {
+    case log_level::debug:   return "debug";
+    case log_level::info:    return "info";
+    case log_level::warning: return "warning";
+    case log_level::error:   return "error";
+    }
+    return "";
+}
+
+Logger::Logger() :
+    m_cells(new cell[capacity]),
+    m_enqueue_pos(0),
+    m_dequeue_pos(0),
+    m_num_logged(0),
+    m_num_drained(0),
+    m_num_dropped(0),
+    m_level(log_level::info),
+    m_epoch(std::chrono::steady_clock::now()),
+    m_console(false),
+    m_cout_buffer(std::cout.rdbuf()),
+    m_cerr_buffer(std::cerr.rdbuf()),
+    m_cout_lines(0, log_level::info),
+    m_cerr_lines(1, log_level::error),
+    m_running(true) {
+
+    for(size_t i = 0; i < capacity; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    m_thread = std::thread(&Logger::drain, this);
+}
+
+Logger::~Logger() {
+
+    RestoreStandardStreams();
+    m_running = false;
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+Logger& Logger::Instance() {
+
+    static Logger logger;
+    return logger;
+}
+
+void Logger::Log(log_level level, std::string message) {
+
+    if(!IsEnabled(level)) return;
+
+    // Step-1: claim a cell, the cell of position pos is free when its sequence is pos
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    cell* c = nullptr;
+    for(;;) {
+        c = &m_cells[pos & (capacity - 1)];
+        size_t sequence = c->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if(diff == 0) {
+            if(m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if(diff < 0) {
+            // the buffer is full: debug and info records are dropped rather than blocking the
+            // caller, warnings and errors wait for the drain thread
+            if(level < log_level::warning) {
+                ++m_num_dropped;
+                return;
+            }
+            m_wake.notify_one();
+            std::this_thread::yield();
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+        else {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Step-2: fill the cell and publish it to the drain thread
+    c->record.level = level;
+    c->record.thread = thread_id();
+    c->record.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+    c->record.message = std::move(message);
+    c->sequence.store(pos + 1, std::memory_order_release);
+    ++m_num_logged;
+    m_wake.notify_one();
+}
+
+bool Logger::try_pop(LogRecord& record) {
+
+    // single consumer: a published cell has the sequence pos + 1
+    cell& c = m_cells[m_dequeue_pos & (capacity - 1)];
+    if(c.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1) return false;
+    record = std::move(c.record);
+    c.sequence.store(m_dequeue_pos + capacity, std::memory_order_release);
+    ++m_dequeue_pos;
+    return true;
+}
+
+void Logger::drain() {
+
+    std::vector<LogRecord> records;
+    records.reserve(batch_size + 1);
+    for(;;) {
+        records.clear();
+        LogRecord record;
+        while(records.size() < batch_size && try_pop(record))
+            records.push_back(std::move(record));
+
+        size_t num_dropped = m_num_dropped.exchange(0);
+        if(num_dropped > 0) {
+            LogRecord warning = { log_level::warning, thread_id(), 0.0, "WARNING: " + std::to_string(num_dropped) + " log messages are dropped" };
+            warning.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_epoch).count();
+            records.push_back(warning);
+        }
+
+        if(records.empty()) {
+            if(!m_running) return;
+            std::unique_lock<std::mutex> lock(m_wake_mutex);
+            m_wake.wait_for(lock, drain_period);
+            continue;
+        }
+
+        write(records);
+        m_num_drained += records.size() - ((num_dropped > 0) ? 1 : 0);
+    }
+}
+
+void Logger::write(const std::vector<LogRecord>& records) {
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    if(m_file.is_open()) {
+        for(const LogRecord& record : records)
+            m_file << std::fixed << std::setprecision(3) << std::setw(10) << record.time << " [" << level_name(record.level)
+                   << "] " << record.message << "\n";
+        m_file.flush();
+    }
+    if(m_console) {
+        for(const LogRecord& record : records) {
+            std::streambuf* buffer = (record.level == log_level::error) ? m_cerr_buffer : m_cout_buffer;
+            buffer->sputn(record.message.data(), record.message.size());
+            buffer->sputc('\n');
+        }
+        m_cout_buffer->pubsync();
+        m_cerr_buffer->pubsync();
+    }
+    if(m_sink) m_sink(records);
+}
+
+void Logger::SetLevel(log_level level) {
+    m_level.store(level, std::memory_order_relaxed);
+}
+
+void Logger::SetSink(sink_type sink) {
+
+    // a running batch is finished with the old sink
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    m_sink = sink;
+}
+
+bool Logger::SetLogFile(const std::string& path) {
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    if(m_file.is_open()) m_file.close();
+    m_file.clear();
+    if(path.empty()) return true;
+    m_file.open(path.c_str(), std::ios::out | std::ios::app);
+    if(!m_file.good()) {
+        std::string message = "ERROR: Log file cannot be opened: " + path + "\n";
+        m_cerr_buffer->sputn(message.data(), message.size());
+        return false;
+    }
+    return true;
+}
+
+void Logger::SetConsoleOutput(bool flag) {
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    m_console = flag;
+}
+
+void Logger::RedirectStandardStreams() {
+
+    std::cout.rdbuf(&m_cout_lines);
+    std::cerr.rdbuf(&m_cerr_lines);
+}
+
+void Logger::RestoreStandardStreams() {
+
+    if(std::cout.rdbuf() == &m_cout_lines) std::cout.rdbuf(m_cout_buffer);
+    if(std::cerr.rdbuf() == &m_cerr_lines) std::cerr.rdbuf(m_cerr_buffer);
+}
+
+void Logger::Flush() {
+
+    size_t num_logged = m_num_logged.load();
+    while(m_num_drained.load() < num_logged) {
+        m_wake.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// the pending lines of a thread, one per redirected stream
+static thread_local std::string pending_lines[2];
+
+void Logger::line_buffer::append(const char* s, size_t n) {
+
+    std::string& line = pending_lines[m_stream];
+    while(n > 0) {
+        const char* end = static_cast<const char*>(std::memchr(s, '\n', n));
+        if(end == nullptr) {
+            line.append(s, n);
+            return;
+        }
+        line.append(s, end - s);
+        Logger::Instance().Log(level_of(line, m_level), std::move(line));
+        line.clear();
+        n -= (end - s) + 1;
+        s = end + 1;
+    }
+}
+
+Logger::line_buffer::int_type Logger::line_buffer::overflow(int_type c) {
+
+    if(traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    char ch = traits_type::to_char_type(c);
+    append(&ch, 1);
+    return c;
+}
+
+std::streamsize Logger::line_buffer::xsputn(const char* s, std::streamsize n) {
+
+    append(s, static_cast<size_t>(n));
+    return n;
+}
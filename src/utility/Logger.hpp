@@ -0,0 +1,139 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class log_level : unsigned char {
+    debug,
+    info,
+    warning,
+    error
+};
+
+struct LogRecord {
+    log_level level;
+    unsigned int thread;                // sequential id of the logging thread
+    double time;                        // seconds from the start of the logger
+    std::string message;                // a single line, without the new line
+};
+
+/*
+ * Asynchronous logger.
+ *
+ * Log does not block: the record is moved into a bounded lock-free ring buffer (a multi producer
+ * queue with a sequence number per cell) and the background thread drains it in batches into the
+ * log file, the console and the sink. A debug or info record that does not fit into a full buffer
+ * is dropped and counted, the drain thread reports the number of the dropped records. Only the
+ * warnings and the errors wait for a free cell.
+ *
+ * RedirectStandardStreams replaces the buffers of std::cout and std::cerr, every line written to
+ * them becomes a record, a line starting with ERROR or WARNING gets that level. Lines are collected
+ * per thread, so the lines of concurrent threads are not mixed.
+ *
+ * The sink is called on the drain thread, a GUI sink marshals the records to the UI thread.
+ */
+class Logger {
+public:
+    typedef std::function<void(const std::vector<LogRecord>&)> sink_type;
+
+    static Logger& Instance();
+    ~Logger();
+
+    void Log(log_level level, std::string message);
+    bool IsEnabled(log_level level) const { return level >= m_level.load(std::memory_order_relaxed); }
+    void SetLevel(log_level level);
+
+    void SetSink(sink_type sink);
+    // an empty path closes the log file
+    bool SetLogFile(const std::string& path);
+    // the records are written to the standard output of the process
+    void SetConsoleOutput(bool flag);
+    void RedirectStandardStreams();
+    void RestoreStandardStreams();
+    // waits until the records logged so far are drained
+    void Flush();
+
+private:
+    static const size_t capacity = 1 << 15;    // power of two
+
+    struct cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    class line_buffer : public std::streambuf {
+    public:
+        line_buffer(int stream, log_level level) : m_stream(stream), m_level(level) { }
+    protected:
+        int_type overflow(int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+    private:
+        int m_stream;                           // index of the pending line of the thread
+        log_level m_level;                      // level of the lines without a prefix
+        void append(const char* s, size_t n);
+    };
+
+    std::unique_ptr<cell[]> m_cells;
+    std::atomic<size_t> m_enqueue_pos;
+    size_t m_dequeue_pos;                       // drain thread only
+    std::atomic<size_t> m_num_logged;
+    std::atomic<size_t> m_num_drained;
+    std::atomic<size_t> m_num_dropped;
+    std::atomic<log_level> m_level;
+    std::chrono::steady_clock::time_point m_epoch;
+
+    std::mutex m_output_mutex;                  // sink, file and console, held while a batch is written
+    sink_type m_sink;
+    std::ofstream m_file;
+    bool m_console;
+
+    std::streambuf* m_cout_buffer;              // original buffers of the standard streams
+    std::streambuf* m_cerr_buffer;
+    line_buffer m_cout_lines;
+    line_buffer m_cerr_lines;
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+
+    Logger();
+    Logger(const Logger&);
+    Logger& operator=(const Logger&);
+    bool try_pop(LogRecord& record);
+    void drain();
+    void write(const std::vector<LogRecord>& records);
+};
+
+/*
+ * A log line built with the stream operators, logged at the end of the statement:
+ *
+ *   LogLine(log_level::info) << "Model is solved in " << iterations << " iterations";
+ */
+class LogLine {
+public:
+    explicit LogLine(log_level level) : m_level(level), m_enabled(Logger::Instance().IsEnabled(level)) { }
+    ~LogLine() { if(m_enabled) Logger::Instance().Log(m_level, m_stream.str()); }
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        if(m_enabled) m_stream << value;
+        return *this;
+    }
+private:
+    log_level m_level;
+    bool m_enabled;
+    std::ostringstream m_stream;
+};
+
+#endif // LOGGER_HPP
@@ -0,0 +1,129 @@
+#include "MemoryRegistry.hpp"
+
+#include <algorithm>
+
+const size_t MemoryRegistry::num_categories;
+const double MemoryRegistry::eviction_target = 0.9;
+
+MemoryRegistry::Allocation::Allocation(memory_category category) : m_category(category), m_bytes(0) {
+
+    // the registry is constructed first, thus destroyed after the static owners of allocations
+    MemoryRegistry::Instance();
+}
+
+MemoryRegistry::Allocation::Allocation(const Allocation& other) : m_category(other.m_category), m_bytes(0) { }
+
+MemoryRegistry::Allocation& MemoryRegistry::Allocation::operator=(const Allocation&) {
+    // the assignment keeps the category and the bytes of this allocation, its owner reports its own buffers
+    return *this;
+}
+
+MemoryRegistry::Allocation::~Allocation() {
+    Set(0);
+}
+
+void MemoryRegistry::Allocation::Set(size_t bytes) {
+
+    size_t old_bytes = m_bytes.exchange(bytes);
+    if(old_bytes != bytes) Instance().update(m_category, old_bytes, bytes);
+}
+
+MemoryRegistry::MemoryRegistry() : m_total(0), m_peak(0), m_evicted(0), m_budget(0), m_next_id(0) {
+
+    for(size_t i = 0; i < num_categories; ++i)
+        m_bytes[i].store(0);
+}
+
+MemoryRegistry& MemoryRegistry::Instance() {
+
+    static MemoryRegistry registry;
+    return registry;
+}
+
+const char* MemoryRegistry::GetCategoryName(memory_category category) {
+
+    static const char* names[num_categories] = { "Images", "Gradients", "Textures", "Geometry" };
+    return names[static_cast<size_t>(category)];
+}
+
+size_t MemoryRegistry::GetBytes(memory_category category) const {
+    return m_bytes[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+}
+
+size_t MemoryRegistry::GetTotalBytes() const {
+    return m_total.load(std::memory_order_relaxed);
+}
+
+size_t MemoryRegistry::GetPeakBytes() const {
+    return m_peak.load(std::memory_order_relaxed);
+}
+
+size_t MemoryRegistry::GetEvictedBytes() const {
+    return m_evicted.load(std::memory_order_relaxed);
+}
+
+void MemoryRegistry::SetBudget(size_t bytes) {
+    m_budget.store(bytes, std::memory_order_relaxed);
+}
+
+size_t MemoryRegistry::GetBudget() const {
+    return m_budget.load(std::memory_order_relaxed);
+}
+
+int MemoryRegistry::RegisterEvictor(eviction_order order, evictor_type evictor) {
+
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    evictor_entry entry;
+    entry.id = m_next_id++;
+    entry.order = order;
+    entry.evictor = std::move(evictor);
+    m_evictors.push_back(std::move(entry));
+    return m_evictors.back().id;
+}
+
+void MemoryRegistry::UnregisterEvictor(int id) {
+
+    // waits for an Enforce of another thread, the evictor is not called once this returns
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    m_evictors.erase(std::remove_if(m_evictors.begin(), m_evictors.end(), [id](const evictor_entry& e) { return e.id == id; }), m_evictors.end());
+}
+
+size_t MemoryRegistry::Enforce() {
+
+    size_t budget = GetBudget();
+    size_t total = GetTotalBytes();
+    if(budget == 0 || total <= budget) return 0;
+
+    // Step-1: the evictors in order, a copy since an evictor may unregister the others
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    std::vector<evictor_entry> evictors = m_evictors;
+    std::stable_sort(evictors.begin(), evictors.end(), [](const evictor_entry& a, const evictor_entry& b) { return a.order < b.order; });
+
+    // Step-2: down to the target, the next cache only if the colder ones are not enough
+    size_t excess = total - static_cast<size_t>(eviction_target * budget);
+    size_t freed = 0;
+    for(const evictor_entry& entry : evictors) {
+        if(freed >= excess) break;
+        bool registered = std::any_of(m_evictors.begin(), m_evictors.end(), [&entry](const evictor_entry& e) { return e.id == entry.id; });
+        if(registered) freed += entry.evictor(excess - freed);
+    }
+    m_evicted.fetch_add(freed, std::memory_order_relaxed);
+    return freed;
+}
+
+void MemoryRegistry::update(memory_category category, size_t old_bytes, size_t new_bytes) {
+
+    std::atomic<size_t>& bytes = m_bytes[static_cast<size_t>(category)];
+    size_t total;
+    if(new_bytes >= old_bytes) {
+        bytes.fetch_add(new_bytes - old_bytes, std::memory_order_relaxed);
+        total = m_total.fetch_add(new_bytes - old_bytes, std::memory_order_relaxed) + (new_bytes - old_bytes);
+    }
+    else {
+        bytes.fetch_sub(old_bytes - new_bytes, std::memory_order_relaxed);
+        total = m_total.fetch_sub(old_bytes - new_bytes, std::memory_order_relaxed) - (old_bytes - new_bytes);
+    }
+
+    size_t peak = m_peak.load(std::memory_order_relaxed);
+    while(total > peak && !m_peak.compare_exchange_weak(peak, total, std::memory_order_relaxed)) { }
+}
@@ -0,0 +1,100 @@
+#ifndef MEMORY_REGISTRY_HPP
+#define MEMORY_REGISTRY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+enum class memory_category : unsigned char {
+    images = 0,         // decoded pixels, wx images and their pyramids
+    gradients = 1,      // gradient images, orientations, edge maps and gradient tiles
+    textures = 2,       // background textures and tiles
+    geometry = 3        // vertex arrays of the components and of the frozen components
+};
+
+// the caches are evicted in this order, the cheapest to restore first
+enum class eviction_order : unsigned char {
+    gradient_tiles = 0,     // recomputed around the next ray casts
+    pyramid_levels = 1,     // the display image is scaled from the full image
+    image_tiles = 2,        // downsampled again from the shared pixels once they are viewed
+    frozen_components = 3   // the components are drawn one by one again
+};
+
+/*
+ * Bytes held by the images, the gradients, the textures and the geometry of all the frames.
+ *
+ * An owner reports its bytes through an Allocation member, which subtracts them once it is
+ * destroyed; the counters are atomic and may be set by any thread, e.g. by the thread pool tasks
+ * that fill a cache. The totals are shown on the profiler page of the main frame.
+ *
+ * The caches that can be rebuilt register an evictor. With a budget, Enforce evicts the caches in
+ * eviction_order down to eviction_target of the budget once the total exceeds it. The owner of the
+ * session calls Enforce (the timer of the main frame), not the
+ * allocations: the evictors take the locks of their caches, which the allocating threads may hold.
+ * An evictor runs on the calling thread and must not block on it; the scenes are modified by their
+ * update traversal, thus the evictor of a scene graph cache schedules its release and returns the
+ * bytes it is going to release.
+ */
+class MemoryRegistry {
+public:
+    static const size_t num_categories = 4;
+    static const double eviction_target;
+
+    // frees up to the given bytes, the least recently used first, returns the bytes freed
+    typedef std::function<size_t(size_t)> evictor_type;
+
+    class Allocation {
+    public:
+        explicit Allocation(memory_category category);
+        // a copy reports its own bytes, none until it is set
+        Allocation(const Allocation& other);
+        Allocation& operator=(const Allocation& other);
+        ~Allocation();
+        void Set(size_t bytes);
+        size_t Get() const { return m_bytes.load(std::memory_order_relaxed); }
+    private:
+        memory_category m_category;
+        std::atomic<size_t> m_bytes;
+    };
+
+    static MemoryRegistry& Instance();
+    static const char* GetCategoryName(memory_category category);
+
+    size_t GetBytes(memory_category category) const;
+    size_t GetTotalBytes() const;
+    size_t GetPeakBytes() const;
+    size_t GetEvictedBytes() const;
+    void SetBudget(size_t bytes);           // 0 for no budget
+    size_t GetBudget() const;
+
+    // the id to unregister the evictor with, before its cache is destroyed
+    int RegisterEvictor(eviction_order order, evictor_type evictor);
+    void UnregisterEvictor(int id);
+    // the bytes freed, 0 if the total is within the budget
+    size_t Enforce();
+
+private:
+    struct evictor_entry {
+        int id;
+        eviction_order order;
+        evictor_type evictor;
+    };
+
+    std::atomic<size_t> m_bytes[num_categories];
+    std::atomic<size_t> m_total;
+    std::atomic<size_t> m_peak;
+    std::atomic<size_t> m_evicted;
+    std::atomic<size_t> m_budget;
+    std::recursive_mutex m_mutex;           // an evictor may release the owner of another evictor
+    std::vector<evictor_entry> m_evictors;
+    int m_next_id;
+
+    MemoryRegistry();
+    MemoryRegistry(const MemoryRegistry&) = delete;
+    MemoryRegistry& operator=(const MemoryRegistry&) = delete;
+    void update(memory_category category, size_t old_bytes, size_t new_bytes);
+};
+
+#endif // MEMORY_REGISTRY_HPP
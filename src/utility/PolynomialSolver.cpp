@@ -0,0 +1,202 @@
+#include "PolynomialSolver.hpp"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+typedef std::complex<double> complex_d;
+
+// two roots closer than this (relative) are treated as a multiple root
+static const double separation_tolerance = 1e-7;
+// a root with a smaller relative imaginary part is real
+static const double real_tolerance = 1e-9;
+// a root with a relative imaginary part in [real_tolerance, ambiguity_tolerance] cannot be classified
+static const double ambiguity_tolerance = 1e-6;
+static const int max_newton_iterations = 10;
+
+// c is monic: z^n + c[1] z^(n-1) + ... + c[n]
+static void evaluate(const double* c, int n, const complex_d& z, complex_d& p, complex_d& dp) {
+
+    p = 1.0;
+    dp = 0.0;
+    for(int i = 1; i <= n; ++i) {
+        dp = dp * z + p;
+        p = p * z + c[i];
+    }
+}
+
+static void polish(const double* c, int n, complex_d& z) {
+
+    complex_d p, dp;
+    for(int it = 0; it < max_newton_iterations; ++it) {
+        evaluate(c, n, z, p, dp);
+        if(dp == 0.0) return;
+        complex_d step = p / dp;
+        z -= step;
+        if(std::abs(step) <= 1e-15 * std::max(1.0, std::abs(z))) return;
+    }
+}
+
+static void solve_quadratic(const complex_d& b, const complex_d& c, complex_d* z) {
+
+    complex_d d = std::sqrt(b*b - 4.0*c);
+    // avoid the cancellation in b + d
+    if(std::real(std::conj(b) * d) < 0) d = -d;
+    complex_d q = -0.5 * (b + d);
+    z[0] = q;
+    z[1] = (q != 0.0) ? c / q : 0.0;
+}
+
+static void solve_cubic(const complex_d& a, const complex_d& b, const complex_d& c, complex_d* z) {
+
+    // depressed cubic t^3 + p t + q with z = t - a/3
+    complex_d p = b - a*a / 3.0;
+    complex_d q = 2.0*a*a*a / 27.0 - a*b / 3.0 + c;
+    complex_d shift = -a / 3.0;
+
+    complex_d d = std::sqrt(q*q / 4.0 + p*p*p / 27.0);
+    complex_d u3 = -q / 2.0 + d;
+    complex_d v3 = -q / 2.0 - d;
+    if(std::abs(v3) > std::abs(u3)) u3 = v3;
+
+    if(u3 == 0.0) { // p = q = 0: triple root
+        z[0] = z[1] = z[2] = shift;
+        return;
+    }
+
+    const complex_d omega(-0.5, std::sqrt(3.0) / 2.0);
+    complex_d u = std::pow(u3, 1.0 / 3.0);
+    for(int k = 0; k < 3; ++k) {
+        z[k] = u - p / (3.0 * u) + shift;
+        u *= omega;
+    }
+}
+
+static void solve_quartic(double a, double b, double c, double d, complex_d* z) {
+
+    // depressed quartic y^4 + p y^2 + q y + r with z = y - a/4
+    double a2 = a*a;
+    double p = b - 3.0*a2 / 8.0;
+    double q = c - a*b / 2.0 + a2*a / 8.0;
+    double r = d - a*c / 4.0 + a2*b / 16.0 - 3.0*a2*a2 / 256.0;
+    double shift = -a / 4.0;
+
+    // Ferrari: any non-zero root of the resolvent cubic m^3 + p m^2 + (p^2/4 - r) m - q^2/8
+    complex_d m[3];
+    solve_cubic(p, p*p / 4.0 - r, -q*q / 8.0, m);
+    complex_d mm = m[0];
+    for(int i = 1; i < 3; ++i)
+        if(std::abs(m[i]) > std::abs(mm)) mm = m[i];
+
+    if(mm == 0.0) { // p = q = r = 0: quadruple root
+        z[0] = z[1] = z[2] = z[3] = shift;
+        return;
+    }
+
+    complex_d s = std::sqrt(2.0 * mm);
+    for(int i = 0; i < 2; ++i) {
+        double sign = (i == 0) ? 1.0 : -1.0;
+        complex_d w = std::sqrt(-(2.0*p + 2.0*mm + sign * 2.0*q / s));
+        z[2*i]     = (sign * s + w) / 2.0 + shift;
+        z[2*i + 1] = (sign * s - w) / 2.0 + shift;
+    }
+}
+
+// polishes the roots and keeps the real ones; returns -1 if the result is not reliable
+static int select_real_roots(const double* c, int n, complex_d* z, double* roots) {
+
+    for(int i = 0; i < n; ++i) {
+        polish(c, n, z[i]);
+        if(!std::isfinite(z[i].real()) || !std::isfinite(z[i].imag())) return -1;
+    }
+
+    for(int i = 0; i < n; ++i)
+        for(int j = i + 1; j < n; ++j)
+            if(std::abs(z[i] - z[j]) <= separation_tolerance * std::max(1.0, std::max(std::abs(z[i]), std::abs(z[j]))))
+                return -1;
+
+    int num_roots = 0;
+    for(int i = 0; i < n; ++i) {
+        double scale = std::max(1.0, std::abs(z[i]));
+        double im = std::abs(z[i].imag());
+        if(im <= real_tolerance * scale)
+            roots[num_roots++] = z[i].real();
+        else if(im <= ambiguity_tolerance * scale)
+            return -1;
+    }
+    std::sort(roots, roots + num_roots);
+    return num_roots;
+}
+
+int SolvePolynomial(const double* coefficients, int degree, double* roots) {
+
+    // skip the vanishing leading coefficients
+    while(degree > 0 && coefficients[0] == 0.0) {
+        ++coefficients;
+        --degree;
+    }
+    if(degree <= 0) return 0;
+
+    for(int i = 0; i <= degree; ++i)
+        if(!std::isfinite(coefficients[i])) return -1;
+
+    if(degree == 1) {
+        roots[0] = -coefficients[1] / coefficients[0];
+        return 1;
+    }
+
+    // monic coefficients, c[0] = 1
+    const int max_closed_form_degree = 4;
+    double c_fixed[max_closed_form_degree + 1];
+    std::vector<double> c_dynamic;
+    double* c = c_fixed;
+    if(degree > max_closed_form_degree) {
+        c_dynamic.resize(degree + 1);
+        c = c_dynamic.data();
+    }
+    c[0] = 1.0;
+    for(int i = 1; i <= degree; ++i)
+        c[i] = coefficients[i] / coefficients[0];
+
+    complex_d z_fixed[max_closed_form_degree];
+    switch(degree) {
+    case 2:
+        solve_quadratic(c[1], c[2], z_fixed);
+        return select_real_roots(c, degree, z_fixed, roots);
+    case 3:
+        solve_cubic(c[1], c[2], c[3], z_fixed);
+        return select_real_roots(c, degree, z_fixed, roots);
+    case 4:
+        solve_quartic(c[1], c[2], c[3], c[4], z_fixed);
+        return select_real_roots(c, degree, z_fixed, roots);
+    default:
+        break;
+    }
+
+    // eigenvalues of the companion matrix
+    Eigen::MatrixXd companion = Eigen::MatrixXd::Zero(degree, degree);
+    for(int i = 0; i < degree; ++i) {
+        companion(0, i) = -c[i + 1];
+        if(i > 0) companion(i, i - 1) = 1.0;
+    }
+    Eigen::EigenSolver<Eigen::MatrixXd> solver(companion, false);
+    if(solver.info() != Eigen::Success) return -1;
+
+    std::vector<complex_d> z(degree);
+    for(int i = 0; i < degree; ++i)
+        z[i] = solver.eigenvalues()[i];
+    return select_real_roots(c, degree, z.data(), roots);
+}
+
+bool SolvePolynomial(const std::vector<double>& coefficients, std::vector<double>& roots) {
+
+    if(coefficients.empty()) return true;
+
+    size_t first = roots.size();
+    int degree = static_cast<int>(coefficients.size()) - 1;
+    roots.resize(first + degree);
+    int num_roots = SolvePolynomial(coefficients.data(), degree, roots.data() + first);
+    roots.resize(first + std::max(num_roots, 0));
+    return num_roots >= 0;
+}
@@ -0,0 +1,25 @@
+#ifndef POLYNOMIAL_SOLVER_HPP
+#define POLYNOMIAL_SOLVER_HPP
+
+#include <vector>
+
+/*
+ * Floating point real root solver, the fast path of AlgebraicKernel::solve.
+ *
+ * Degree <= 4 polynomials are solved in closed form (quadratic formula, Cardano, Ferrari)
+ * without any allocation, higher degrees through the eigenvalues of the companion matrix.
+ * Every root is polished with Newton iterations on the original polynomial.
+ *
+ * The result is rejected as ill-conditioned if two roots almost coincide (multiple roots)
+ * or if it cannot be decided whether a root is real. The clients are expected to fall back
+ * to the exact solver in that case.
+ */
+
+// coefficients from higher to lower degree, distinct real roots in ascending order
+// returns the number of roots, -1 if ill-conditioned
+int SolvePolynomial(const double* coefficients, int degree, double* roots);
+
+// same as above, the roots are appended; returns false if ill-conditioned
+bool SolvePolynomial(const std::vector<double>& coefficients, std::vector<double>& roots);
+
+#endif // POLYNOMIAL_SOLVER_HPP
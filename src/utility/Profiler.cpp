@@ -0,0 +1,134 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+std::atomic<bool> Profiler::s_enabled(false);
+const size_t Profiler::capacity;
+
+static unsigned int thread_id() {
+
+    static std::atomic<unsigned int> next_id(0);
+    static thread_local unsigned int id = next_id++;
+    return id;
+}
+
+Profiler::Profiler() : m_epoch(clock::now()), m_events(capacity), m_next(0), m_size(0) { }
+
+Profiler& Profiler::Instance() {
+
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::SetEnabled(bool flag) {
+    s_enabled.store(flag, std::memory_order_relaxed);
+}
+
+void Profiler::Record(const char* name, clock::time_point start, clock::time_point end) {
+
+    // the clock is read by the scope, only the copy into the buffer is serialized
+    Event event;
+    event.name = name;
+    event.thread = thread_id();
+    event.start = std::chrono::duration<double>(start - m_epoch).count();
+    event.duration = std::chrono::duration<double>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events[m_next] = event;
+    m_next = (m_next + 1) % capacity;
+    m_size = std::min(m_size + 1, capacity);
+}
+
+void Profiler::Clear() {
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_next = 0;
+    m_size = 0;
+}
+
+void Profiler::copy_events(std::vector<Event>& events) const {
+
+    // oldest first
+    std::lock_guard<std::mutex> lock(m_mutex);
+    events.clear();
+    events.reserve(m_size);
+    size_t first = (m_next + capacity - m_size) % capacity;
+    for(size_t i = 0; i < m_size; ++i)
+        events.push_back(m_events[(first + i) % capacity]);
+}
+
+void Profiler::GetStatistics(double window, std::vector<Statistics>& statistics) const {
+
+    std::vector<Event> events;
+    copy_events(events);
+    double now = std::chrono::duration<double>(clock::now() - m_epoch).count();
+
+    // the names are literals, scopes with the same name in different files are merged by value
+    std::map<std::string, Statistics> scopes;
+    for(const Event& event : events) {
+        if(event.start + event.duration < now - window) continue;
+        double ms = 1000.0 * event.duration;
+        std::map<std::string, Statistics>::iterator it = scopes.find(event.name);
+        if(it == scopes.end()) {
+            Statistics s = { event.name, 0, 0.0, 0.0, 0.0, 0.0 };
+            it = scopes.insert(std::make_pair(std::string(event.name), s)).first;
+        }
+        Statistics& s = it->second;
+        ++s.calls;
+        s.last = ms;
+        s.max = std::max(s.max, ms);
+        s.total += ms;
+    }
+
+    statistics.clear();
+    for(std::map<std::string, Statistics>::iterator it = scopes.begin(); it != scopes.end(); ++it) {
+        it->second.mean = it->second.total / it->second.calls;
+        statistics.push_back(it->second);
+    }
+    std::sort(statistics.begin(), statistics.end(), [](const Statistics& s1, const Statistics& s2) { return s1.total > s2.total; });
+}
+
+static void write_json_string(std::ostream& out, const char* str) {
+
+    out << '"';
+    for(const char* c = str; *c != '\0'; ++c) {
+        if(*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) const {
+
+    std::vector<Event> events;
+    copy_events(events);
+
+    std::ofstream file(path);
+    if(!file.good()) {
+        std::cout << "ERROR: Trace file cannot be written: " << path << std::endl;
+        return false;
+    }
+
+    // complete events ("ph": "X"), the times are in microseconds
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    file.setf(std::ios::fixed);
+    file.precision(3);
+    for(size_t i = 0; i < events.size(); ++i) {
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(file, events[i].name);
+        file << ",\"cat\":\"cvm\",\"ph\":\"X\",\"pid\":1,\"tid\":" << events[i].thread
+             << ",\"ts\":" << 1e6 * events[i].start << ",\"dur\":" << 1e6 * events[i].duration << "}";
+    }
+    file << "\n]}\n";
+
+    file.close();
+    if(file.fail()) {
+        std::cout << "ERROR: Trace file cannot be written: " << path << std::endl;
+        return false;
+    }
+    std::cout << "INFO: " << events.size() << " profiler events are written to " << path << std::endl;
+    return true;
+}
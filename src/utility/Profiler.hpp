@@ -0,0 +1,78 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Scoped timers of the hot paths.
+ *
+ * A Scope records its begin and end into a bounded ring buffer of the last events, the names are
+ * string literals. The profiler is off by default: a disabled scope reads one atomic flag and
+ * touches neither the clock nor the buffer. The events are summarized over a rolling window for
+ * the profiler page of the main frame and exported as Chrome trace JSON (chrome://tracing or
+ * https://ui.perfetto.dev).
+ */
+class Profiler {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    struct Event {
+        const char* name;
+        unsigned int thread;            // sequential id of the recording thread
+        double start;                   // seconds from the start of the profiler
+        double duration;
+    };
+
+    // events of a scope within the window, times in milliseconds
+    struct Statistics {
+        const char* name;
+        unsigned int calls;
+        double last, mean, max, total;
+    };
+
+    class Scope {
+    public:
+        explicit Scope(const char* name) : m_name(IsEnabled() ? name : nullptr) {
+            if(m_name != nullptr) m_start = clock::now();
+        }
+        ~Scope() {
+            if(m_name != nullptr) Instance().Record(m_name, m_start, clock::now());
+        }
+    private:
+        const char* m_name;
+        clock::time_point m_start;
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+    };
+
+    static Profiler& Instance();
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void SetEnabled(bool flag);
+
+    void Record(const char* name, clock::time_point start, clock::time_point end);
+    void Clear();
+    // the scopes of the events that have ended in the last window seconds, by decreasing total time
+    void GetStatistics(double window, std::vector<Statistics>& statistics) const;
+    bool WriteChromeTrace(const std::string& path) const;
+
+private:
+    static std::atomic<bool> s_enabled;
+    static const size_t capacity = 1 << 16;
+
+    mutable std::mutex m_mutex;
+    clock::time_point m_epoch;
+    std::vector<Event> m_events;        // ring buffer of the last events
+    size_t m_next;                      // next slot of the ring buffer
+    size_t m_size;
+
+    Profiler();
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+    void copy_events(std::vector<Event>& events) const;
+};
+
+#endif // PROFILER_HPP
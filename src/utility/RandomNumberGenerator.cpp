@@ -1,50 +1,183 @@
 #include "RandomNumberGenerator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
-RandomNumberGenerator::RandomNumberGenerator() {
-    m_int_distribution = std::uniform_int_distribution<int>(1,100);
-    m_real_distribution = std::uniform_real_distribution<double>(0.0, 1.0);
-    m_normal_distribution = std::normal_distribution<double>(0.0, 1.0);
-    m_engine =  std::default_random_engine(std::random_device()());
+// the seed of the generators without an explicit one, fixed so that the runs are reproducible
+static const uint64_t default_global_seed = 0x2545F4914F6CDD1Dull;
+static std::atomic<uint64_t> global_seed(default_global_seed);
+
+static const double two_pi = 6.28318530717958647692;
+
+static inline uint64_t splitmix64(uint64_t& x) {
+
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// the upper 53 bits as a double in [0, 1)
+static inline double to_unit(uint64_t x) {
+    return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+RandomNumberGenerator::RandomNumberGenerator() : RandomNumberGenerator(GetGlobalSeed(), 0) { }
+
+RandomNumberGenerator::RandomNumberGenerator(uint64_t seed, uint64_t stream) {
+
+    initialize_uniform_int_distributor(1, 100);
+    initialize_uniform_double_distributor(0.0, 1.0);
+    initialize_normal_distributibutor(0.0, 1.0);
+    this->seed(seed, stream);
+}
+
+void RandomNumberGenerator::seed(uint64_t seed, uint64_t stream) {
+
+    // the splitmix64 sequence of the seed mixed with the stream, the states are never all zero
+    uint64_t x = seed;
+    uint64_t mixed = splitmix64(x) ^ stream;
+    x = splitmix64(mixed);
+    for(int k = 0; k < 4; ++k)
+        m_state[k] = splitmix64(x);
+    for(int k = 0; k < 4; ++k)
+        for(int l = 0; l < num_lanes; ++l)
+            m_lanes[k][l] = splitmix64(x);
+    m_has_spare_normal = false;
+}
+
+void RandomNumberGenerator::SetGlobalSeed(uint64_t seed) {
+    global_seed = seed;
+}
+
+uint64_t RandomNumberGenerator::GetGlobalSeed() {
+    return global_seed;
 }
 
 void RandomNumberGenerator::initialize_uniform_int_distributor(int lower_bound, int heigher_bound) {
-    m_int_distribution = std::uniform_int_distribution<int>(lower_bound, heigher_bound);
+
+    m_int_lower = lower_bound;
+    m_int_range = static_cast<uint32_t>(static_cast<int64_t>(heigher_bound) - lower_bound);
 }
 
 void RandomNumberGenerator::initialize_uniform_double_distributor(double lower_bound, double heigher_bound) {
-    m_real_distribution = std::uniform_real_distribution<double>(lower_bound, heigher_bound);
+
+    m_real_lower = lower_bound;
+    m_real_scale = heigher_bound - lower_bound;
 }
 
 void RandomNumberGenerator::initialize_normal_distributibutor(double mean, double stddev) {
-    m_normal_distribution = std::normal_distribution<double>(mean, stddev);
+
+    m_mean = mean;
+    m_stddev = stddev;
+    m_has_spare_normal = false;
+}
+
+int RandomNumberGenerator::scale_int(uint64_t value) {
+
+    // Lemire's multiply and shift of the upper 32 bits, the few biased products are drawn again
+    uint64_t count = static_cast<uint64_t>(m_int_range) + 1;
+    uint64_t m = (value >> 32) * count;
+    uint32_t low = static_cast<uint32_t>(m);
+    if(low < count) {
+        uint32_t threshold = static_cast<uint32_t>((0x100000000ull - count) % count);
+        while(low < threshold) {
+            m = ((*this)() >> 32) * count;
+            low = static_cast<uint32_t>(m);
+        }
+    }
+    return static_cast<int>(static_cast<int64_t>(m_int_lower) + static_cast<int64_t>(m >> 32));
 }
 
 int RandomNumberGenerator::generate_int() {
-    return m_int_distribution(m_engine);
+    return scale_int((*this)());
 }
 
 double RandomNumberGenerator::generate_double() {
-    return m_real_distribution(m_engine);
+    return m_real_lower + m_real_scale * to_unit((*this)());
 }
 
 double RandomNumberGenerator::generate_double_with_normal_distribution() {
-    return m_normal_distribution(m_engine);
+
+    // Box-Muller, the second value of the pair is kept for the next call
+    if(m_has_spare_normal) {
+        m_has_spare_normal = false;
+        return m_mean + m_stddev * m_spare_normal;
+    }
+    double r = std::sqrt(-2.0 * std::log(1.0 - to_unit((*this)())));
+    double t = two_pi * to_unit((*this)());
+    m_spare_normal = r * std::sin(t);
+    m_has_spare_normal = true;
+    return m_mean + m_stddev * r * std::cos(t);
+}
+
+void RandomNumberGenerator::next_block(uint64_t* values) {
+
+    // xoshiro256+ on every lane, the lanes are independent
+    uint64_t* s0 = m_lanes[0];
+    uint64_t* s1 = m_lanes[1];
+    uint64_t* s2 = m_lanes[2];
+    uint64_t* s3 = m_lanes[3];
+    for(int l = 0; l < num_lanes; ++l) {
+        values[l] = s0[l] + s3[l];
+        uint64_t t = s1[l] << 17;
+        s2[l] ^= s0[l];
+        s3[l] ^= s1[l];
+        s1[l] ^= s2[l];
+        s0[l] ^= s3[l];
+        s2[l] ^= t;
+        s3[l] = (s3[l] << 45) | (s3[l] >> 19);
+    }
 }
 
 void RandomNumberGenerator::generate_int(std::vector<int>& vec, int num) {
-    for(int i = 0; i < num; ++i) {
-        vec.push_back(m_int_distribution(m_engine));
+
+    size_t first = vec.size();
+    vec.resize(first + static_cast<size_t>(std::max(num, 0)));
+    uint64_t block[num_lanes];
+    for(size_t i = first; i < vec.size(); i += num_lanes) {
+        next_block(block);
+        for(size_t l = 0; l < num_lanes && i + l < vec.size(); ++l)
+            vec[i + l] = scale_int(block[l]);
     }
 }
 
 void RandomNumberGenerator::generate_double(std::vector<double>& vec, int num) {
-    for(int i = 0; i < num; ++i) {
-        vec.push_back(m_real_distribution(m_engine));
+
+    size_t first = vec.size();
+    vec.resize(first + static_cast<size_t>(std::max(num, 0)));
+    double* out = vec.data();
+    uint64_t block[num_lanes];
+    size_t i = first;
+    for(; i + num_lanes <= vec.size(); i += num_lanes) {
+        next_block(block);
+        for(int l = 0; l < num_lanes; ++l)
+            out[i + l] = m_real_lower + m_real_scale * to_unit(block[l]);
+    }
+    if(i < vec.size()) {
+        next_block(block);
+        for(int l = 0; i < vec.size(); ++i, ++l)
+            out[i] = m_real_lower + m_real_scale * to_unit(block[l]);
     }
 }
 
 void RandomNumberGenerator::generate_double_with_normal_distribution(std::vector<double>& vec, int num) {
-    for(int i = 0; i < num; ++i) {
-        vec.push_back(m_normal_distribution(m_engine));
+
+    // Box-Muller on the pairs of lanes, both values of a pair are used
+    size_t first = vec.size();
+    vec.resize(first + static_cast<size_t>(std::max(num, 0)));
+    double* out = vec.data();
+    uint64_t block[num_lanes];
+    double normals[num_lanes];
+    for(size_t i = first; i < vec.size(); i += num_lanes) {
+        next_block(block);
+        for(int l = 0; l < num_lanes; l += 2) {
+            double r = std::sqrt(-2.0 * std::log(1.0 - to_unit(block[l])));
+            double t = two_pi * to_unit(block[l + 1]);
+            normals[l] = m_mean + m_stddev * r * std::cos(t);
+            normals[l + 1] = m_mean + m_stddev * r * std::sin(t);
+        }
+        for(size_t l = 0; l < num_lanes && i + l < vec.size(); ++l)
+            out[i + l] = normals[l];
     }
 }
@@ -1,12 +1,44 @@
 #ifndef RANDOM_NUMBER_GENERATOR_HPP
 #define RANDOM_NUMBER_GENERATOR_HPP
 
-#include <random>
+#include <cstdint>
 #include <vector>
 
+/*
+ * Seedable, reproducible pseudo random numbers.
+ *
+ * A generator is a stream of the global seed (or of an explicit seed): the state of the stream is
+ * expanded from the seed and the stream index with splitmix64, so that the streams of different
+ * indices are independent for any practical purpose and the same seed and stream give the same
+ * numbers on any platform and standard library. The scalar values come from xoshiro256**, the
+ * distributions are computed here rather than by <random>, whose distributions differ between the
+ * standard libraries.
+ *
+ * The vector overloads fill the vector in bulk from four interleaved xoshiro256+ lanes (the variant
+ * for floating point values, the upper bits are used) kept in structure of arrays layout, the
+ * loops over the lanes have no dependencies and vectorize. They continue their own sequence, the
+ * scalar and the bulk values of a stream do not interleave.
+ *
+ * A task of a ThreadPool takes a stream keyed by its work item, e.g. RandomNumberGenerator(seed, item),
+ * or reseeds its own generator: with work stealing the tasks of a worker are not fixed, a stream per
+ * worker would make the results depend on the number of threads.
+ */
 class RandomNumberGenerator {
 public:
+    // a UniformRandomBitGenerator, e.g. for std::shuffle
+    typedef uint64_t result_type;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~static_cast<result_type>(0); }
+
+    // stream 0 of the global seed
     RandomNumberGenerator();
+    RandomNumberGenerator(uint64_t seed, uint64_t stream);
+    void seed(uint64_t seed, uint64_t stream = 0);
+    inline result_type operator()();
+
+    static void SetGlobalSeed(uint64_t seed);
+    static uint64_t GetGlobalSeed();
+
     void initialize_uniform_int_distributor(int lower_bound, int heigher_bound);
     void initialize_uniform_double_distributor(double lower_bound, double heigher_bound);
     void initialize_normal_distributibutor(double mean, double stddev);
@@ -17,9 +49,34 @@ public:
     void generate_double(std::vector<double>& vec, int num);
     void generate_double_with_normal_distribution(std::vector<double>& vec, int num);
 private:
-    std::uniform_int_distribution<int> m_int_distribution;
-    std::uniform_real_distribution<double> m_real_distribution;
-    std::normal_distribution<double> m_normal_distribution;
-    std::default_random_engine m_engine;
+    static const int num_lanes = 4;
+
+    uint64_t m_state[4];                        // xoshiro256**
+    uint64_t m_lanes[4][num_lanes];             // xoshiro256+, word k of the lane l at [k][l]
+    int m_int_lower;
+    uint32_t m_int_range;                       // number of values - 1
+    double m_real_lower, m_real_scale;
+    double m_mean, m_stddev;
+    double m_spare_normal;
+    bool m_has_spare_normal;
+
+    int scale_int(uint64_t value);
+    void next_block(uint64_t* values);
 };
+
+inline RandomNumberGenerator::result_type RandomNumberGenerator::operator()() {
+
+    uint64_t* s = m_state;
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
 #endif // RANDOM_NUMBER_GENERATOR_HPP
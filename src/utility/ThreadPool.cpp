@@ -0,0 +1,120 @@
+#include "ThreadPool.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// the pool and the queue of the current thread, if it is a worker
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local unsigned int current_queue = 0;
+
+ThreadPool& ThreadPool::Instance() {
+
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int num_threads) : m_num_pending(0), m_next_queue(0), m_stop(false) {
+
+    // at least two workers, a long task (e.g. a model file) does not hold the others back
+    if(num_threads == 0) num_threads = std::max(2u, std::thread::hardware_concurrency());
+    for(unsigned int i = 0; i < num_threads; ++i)
+        m_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue));
+    for(unsigned int i = 0; i < num_threads; ++i)
+        m_threads.push_back(std::thread(&ThreadPool::run, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+
+    // the pending tasks are completed, their owners may wait for them
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(std::thread& t : m_threads)
+        t.join();
+}
+
+unsigned int ThreadPool::GetNumThreads() const {
+    return static_cast<unsigned int>(m_threads.size());
+}
+
+void ThreadPool::push(std::function<void()> task) {
+
+    // counted before it is queued, the count never drops below the number of the queued tasks
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_num_pending;
+    }
+    unsigned int index = (current_pool == this) ? current_queue : m_next_queue++ % m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::report_failure(const std::exception_ptr& error) {
+
+    try {
+        std::rethrow_exception(error);
+    }
+    catch(const std::exception& e) {
+        LogLine(log_level::error) << "Task of the thread pool failed: " << e.what();
+    }
+    catch(...) {
+        LogLine(log_level::error) << "Task of the thread pool failed with an unknown exception";
+    }
+}
+
+bool ThreadPool::RunPendingTask() {
+
+    std::function<void()> task;
+    if(current_pool == nullptr || !current_pool->pop(current_queue, task)) return false;
+    task();
+    return true;
+}
+
+bool ThreadPool::pop(unsigned int index, std::function<void()>& task) {
+
+    // Step-1: the most recent task of the own queue
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        std::deque<std::function<void()>>& tasks = m_queues[index]->tasks;
+        if(!tasks.empty()) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+            --m_num_pending;
+            return true;
+        }
+    }
+
+    // Step-2: the oldest task of another queue
+    for(size_t k = 1; k < m_queues.size(); ++k) {
+        worker_queue& victim = *m_queues[(index + k) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --m_num_pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(unsigned int index) {
+
+    current_pool = this;
+    current_queue = index;
+    while(true) {
+        std::function<void()> task;
+        if(pop(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]() { return m_stop || m_num_pending > 0; });
+        if(m_stop && m_num_pending == 0) return;
+    }
+}
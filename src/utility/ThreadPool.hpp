@@ -0,0 +1,281 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Cancellation flag shared by a job and its owner, the copies of a token share the same flag.
+ */
+class CancellationToken {
+public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) { }
+    void Cancel() const { m_cancelled->store(true); }
+    bool IsCancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+// runs a function on another thread, e.g. the UI thread, see utilityUIExecutor in WxUtility.hpp
+typedef std::function<void(std::function<void()>)> executor_type;
+
+/*
+ * Future of the result of a task submitted to the ThreadPool.
+ *
+ * The continuation attached with Then is executed once, with the result, by the executor or, without
+ * an executor, by the thread that completes the task. It is not executed if the token of the job is
+ * cancelled by then: the executor checks the token right before the call, thus an owner that cancels
+ * the token on the UI thread never receives a result after that. A cancelled task that has not been
+ * started is skipped and its result is the default value.
+ *
+ * A task that throws, e.g. a reader of the image library, completes with the default value as well
+ * and the exception is kept by the job and logged by the pool: Get and the continuation receive the
+ * default value, HasFailed and GetError tell a failed job from a default result.
+ */
+template <typename T>
+class Job {
+public:
+    Job() { }
+    bool IsValid() const { return static_cast<bool>(m_state); }
+    bool IsReady() const;
+    void Wait() const;
+    const T& Get() const;                         // blocks until the result is ready
+    bool HasFailed() const;                       // the task has thrown, blocks until the result is ready
+    std::exception_ptr GetError() const;
+    void Cancel() const;
+    CancellationToken GetToken() const;
+    const Job& Then(std::function<void(const T&)> continuation, executor_type executor = executor_type()) const;
+    void Reset() { m_state.reset(); }
+
+private:
+    friend class ThreadPool;
+    struct state {
+        std::mutex mutex;
+        std::condition_variable ready_cv;
+        bool ready = false;
+        T value;
+        std::exception_ptr error;
+        std::function<void(const T&)> continuation;
+        executor_type executor;
+        CancellationToken token;
+    };
+    std::shared_ptr<state> m_state;
+
+    static void complete(const std::shared_ptr<state>& s, T&& value, std::exception_ptr error);
+    static void dispatch(const std::shared_ptr<state>& s, std::function<void(const T&)> continuation, executor_type executor);
+};
+
+/*
+ * Shared pool of worker threads for the long operations, e.g. the gradient images, the model files
+ * and the solves of the GUI.
+ *
+ * Every worker owns a deque of tasks. A task submitted by a worker is pushed to the back of its own
+ * deque and the worker pops from the back, the most recent task whose data is still in the cache. An
+ * idle worker steals from the front of the other deques. The tasks submitted by the other threads are
+ * distributed round robin. A worker waiting for a job runs the queued tasks meanwhile, thus a task
+ * may wait for the jobs it submits. A task is a function of the cancellation token of its job, long
+ * tasks poll the token and return early.
+ */
+class ThreadPool {
+public:
+    static ThreadPool& Instance();
+
+    explicit ThreadPool(unsigned int num_threads = 0);    // 0: the number of cores
+    ~ThreadPool();
+    unsigned int GetNumThreads() const;
+
+    // runs a queued task if the calling thread is a worker of a pool, a waiting worker helps instead of blocking
+    static bool RunPendingTask();
+
+    template <typename F>
+    Job<typename std::result_of<F(const CancellationToken&)>::type> Submit(F task, CancellationToken token = CancellationToken());
+
+    // body(first, last) over [begin, end) split into ranges of at least grain_size indices, the calling thread
+    // runs the first range and returns once all of them are done
+    template <typename F>
+    void ParallelFor(size_t begin, size_t end, size_t grain_size, F body);
+
+private:
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker_queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_num_pending;
+    std::atomic<unsigned int> m_next_queue;
+    bool m_stop;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void push(std::function<void()> task);
+    static void report_failure(const std::exception_ptr& error);
+    bool pop(unsigned int index, std::function<void()>& task);
+    void run(unsigned int index);
+};
+
+template <typename T>
+bool Job<T>::IsReady() const {
+
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->ready;
+}
+
+template <typename T>
+void Job<T>::Wait() const {
+
+    // a worker that waits for a job may hold the only thread that could run it
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    while(!m_state->ready) {
+        lock.unlock();
+        bool helped = ThreadPool::RunPendingTask();
+        lock.lock();
+        if(!helped && !m_state->ready)
+            m_state->ready_cv.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+template <typename T>
+const T& Job<T>::Get() const {
+
+    Wait();
+    return m_state->value;
+}
+
+template <typename T>
+bool Job<T>::HasFailed() const {
+    return static_cast<bool>(GetError());
+}
+
+template <typename T>
+std::exception_ptr Job<T>::GetError() const {
+
+    Wait();
+    return m_state->error;
+}
+
+template <typename T>
+void Job<T>::Cancel() const {
+    if(m_state) m_state->token.Cancel();
+}
+
+template <typename T>
+CancellationToken Job<T>::GetToken() const {
+    return m_state->token;
+}
+
+template <typename T>
+const Job<T>& Job<T>::Then(std::function<void(const T&)> continuation, executor_type executor) const {
+
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if(!m_state->ready) {
+            m_state->continuation = std::move(continuation);
+            m_state->executor = std::move(executor);
+            return *this;
+        }
+    }
+    dispatch(m_state, std::move(continuation), std::move(executor));
+    return *this;
+}
+
+template <typename T>
+void Job<T>::complete(const std::shared_ptr<state>& s, T&& value, std::exception_ptr error) {
+
+    std::function<void(const T&)> continuation;
+    executor_type executor;
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->value = std::move(value);
+        s->error = error;
+        s->ready = true;
+        continuation.swap(s->continuation);
+        executor.swap(s->executor);
+    }
+    s->ready_cv.notify_all();
+    if(continuation) dispatch(s, std::move(continuation), std::move(executor));
+}
+
+template <typename T>
+void Job<T>::dispatch(const std::shared_ptr<state>& s, std::function<void(const T&)> continuation, executor_type executor) {
+
+    // the value is not modified once the job is ready
+    std::function<void()> call = [s, continuation]() {
+        if(!s->token.IsCancelled()) continuation(s->value);
+    };
+    if(executor) executor(std::move(call));
+    else         call();
+}
+
+template <typename F>
+Job<typename std::result_of<F(const CancellationToken&)>::type> ThreadPool::Submit(F task, CancellationToken token) {
+
+    typedef typename std::result_of<F(const CancellationToken&)>::type result_type;
+    Job<result_type> job;
+    job.m_state = std::make_shared<typename Job<result_type>::state>();
+    job.m_state->token = token;
+    std::shared_ptr<typename Job<result_type>::state> s = job.m_state;
+    push([s, task]() mutable {
+        // an exception would terminate the worker and leave the job pending forever
+        result_type value = result_type();
+        std::exception_ptr error;
+        try {
+            if(!s->token.IsCancelled()) value = task(s->token);
+        }
+        catch(...) {
+            error = std::current_exception();
+            report_failure(error);
+        }
+        Job<result_type>::complete(s, std::move(value), error);
+    });
+    return job;
+}
+
+template <typename F>
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain_size, F body) {
+
+    if(end <= begin) return;
+
+    // a few ranges per worker balance the load, the body is shared by reference until the ranges are done,
+    // thus the ranges are waited for before an exception of a range is rethrown on the calling thread
+    grain_size = std::max<size_t>(grain_size, 1);
+    size_t num_ranges = std::min((end - begin + grain_size - 1) / grain_size, 4 * static_cast<size_t>(GetNumThreads()));
+    size_t step = (end - begin + num_ranges - 1) / num_ranges;
+    std::vector<Job<bool>> jobs;
+    for(size_t first = begin + step; first < end; first += step) {
+        size_t last = std::min(first + step, end);
+        jobs.push_back(Submit([&body, first, last](const CancellationToken&) {
+            body(first, last);
+            return true;
+        }));
+    }
+    std::exception_ptr error;
+    try {
+        body(begin, std::min(begin + step, end));
+    }
+    catch(...) {
+        error = std::current_exception();
+    }
+    for(const Job<bool>& job : jobs) {
+        job.Wait();
+        if(!error) error = job.GetError();
+    }
+    if(error) std::rethrow_exception(error);
+}
+
+#endif // THREAD_POOL_HPP
@@ -14,6 +14,7 @@
 #define wxID_MODE_DEFAULT                IMAGE_FRAME_FIRST_ID + 7
 #define wxID_MODE_REGION_GROWING         IMAGE_FRAME_FIRST_ID + 8
 #define wxID_VIEW_GRAIDENT_IMAGE         IMAGE_FRAME_FIRST_ID + 9
+#define wxID_IMAGE_PANEL_REFINE_TIMER    IMAGE_FRAME_FIRST_ID + 14
 // #define wxID_MODE_DRAWING                IMAGE_FRAME_FIRST_ID + 9
 // #define wxID_DRAWING_MODE_CUBOID         IMAGE_FRAME_FIRST_ID + 10
 // #define wxID_DRAWING_MODE_CYLIDER        IMAGE_FRAME_FIRST_ID + 11
@@ -27,6 +28,12 @@
 #define wxID_OPEN_MODEL                  MAIN_FRAME_FIRST_ID + 3
 #define wxID_EDIT_CLEAR_LOG              MAIN_FRAME_FIRST_ID + 4
 #define wxID_MODEL_IMAGE                 MAIN_FRAME_FIRST_ID + 5
+#define wxID_MODEL_SHARED_VIEWER         MAIN_FRAME_FIRST_ID + 6
+#define wxID_PROFILER_ENABLE             MAIN_FRAME_FIRST_ID + 7
+#define wxID_PROFILER_CLEAR              MAIN_FRAME_FIRST_ID + 8
+#define wxID_PROFILER_EXPORT             MAIN_FRAME_FIRST_ID + 9
+#define wxID_PROFILER_TIMER              MAIN_FRAME_FIRST_ID + 10
+#define wxID_MEMORY_BUDGET               MAIN_FRAME_FIRST_ID + 11
 
 // Scene Graph Frame Ids
 #define SCENE_GRAPH_FRAME_FIRST_ID                      wxID_HIGHEST + 200
@@ -41,14 +48,26 @@
 #define wxID_MODES_RENDER_PLANAR_AND_VERTICAL_SECTIONS  SCENE_GRAPH_FRAME_FIRST_ID + 8
 #define wxID_MODES_RENDER_TRIANGLE_STRIP                SCENE_GRAPH_FRAME_FIRST_ID + 9
 #define wxID_MODES_RENDER_TRIANGLE_FAN                  SCENE_GRAPH_FRAME_FIRST_ID + 10
+#define wxID_MODES_RENDER_PROCEDURAL_SWEEP              SCENE_GRAPH_FRAME_FIRST_ID + 47
 #define wxID_OSG_OPEN_MODEL                             SCENE_GRAPH_FRAME_FIRST_ID + 11
 #define wxID_OSG_OPEN_IMAGE                             SCENE_GRAPH_FRAME_FIRST_ID + 12
+#define wxID_OSG_CANCEL_LOADING                         SCENE_GRAPH_FRAME_FIRST_ID + 48
+#define wxID_OSG_OPEN_PROJECT                           SCENE_GRAPH_FRAME_FIRST_ID + 61
 #define wxID_PRINT_PROJECTION_AND_MODEL_VIEW_MATRICES   SCENE_GRAPH_FRAME_FIRST_ID + 13
 #define wxID_EDIT_CLEAR_VIEW                            SCENE_GRAPH_FRAME_FIRST_ID + 14
+#define wxID_EDIT_UNDO                                  SCENE_GRAPH_FRAME_FIRST_ID + 63
+#define wxID_EDIT_REDO                                  SCENE_GRAPH_FRAME_FIRST_ID + 64
 #define wxID_MODEL_AXIS_DRAWING_MODE_CONTINUOUS         SCENE_GRAPH_FRAME_FIRST_ID + 15
 #define wxID_MODEL_AXIS_DRAWING_MODE_PIECEWISE_LINEAR   SCENE_GRAPH_FRAME_FIRST_ID + 16
 #define wxID_MODEL_SAVE_COMPONENT                       SCENE_GRAPH_FRAME_FIRST_ID + 17
 #define wxID_MODEL_SAVE_MODEL                           SCENE_GRAPH_FRAME_FIRST_ID + 18
+#define wxID_MODEL_SAVE_PROJECT                         SCENE_GRAPH_FRAME_FIRST_ID + 62
+#define wxID_MODEL_SOLVE_IN_ALL_VIEWS                   SCENE_GRAPH_FRAME_FIRST_ID + 65
+#define wxID_MODEL_COMPONENT_GENERALIZED_CYLINDER       SCENE_GRAPH_FRAME_FIRST_ID + 66
+#define wxID_MODEL_COMPONENT_CUBOID                     SCENE_GRAPH_FRAME_FIRST_ID + 67
+#define wxID_MODEL_COMPONENT_SPHERE                     SCENE_GRAPH_FRAME_FIRST_ID + 68
+#define wxID_MODEL_DETECT_RELATIONS                     SCENE_GRAPH_FRAME_FIRST_ID + 69
+#define wxID_MODEL_BAKE_TEXTURES                        SCENE_GRAPH_FRAME_FIRST_ID + 70
 #define wxID_MODEL_DELETE_SELECTED_COMPONENTS           SCENE_GRAPH_FRAME_FIRST_ID + 19
 #define wxID_MODEL_DELETE_MODEL                         SCENE_GRAPH_FRAME_FIRST_ID + 20
 #define wxID_VIEW_DISPLAY_LOCAL_FRAMES                  SCENE_GRAPH_FRAME_FIRST_ID + 21
@@ -58,6 +77,9 @@
 #define wxID_VIEW_DISPLAY_IMAGE                         SCENE_GRAPH_FRAME_FIRST_ID + 25
 #define wxID_VIEW_DISPLAY_GRADIENT_IMAGE                SCENE_GRAPH_FRAME_FIRST_ID + 26
 #define wxID_VIEW_DISPLAY_RAY_CAST                      SCENE_GRAPH_FRAME_FIRST_ID + 27
+#define wxID_VIEW_DISPLAY_REPROJECTION_ERROR            SCENE_GRAPH_FRAME_FIRST_ID + 55
+#define wxID_VIEW_DISPLAY_SHADER_GRADIENT_IMAGE         SCENE_GRAPH_FRAME_FIRST_ID + 72
+#define wxID_VIEW_GRADIENT_DISPLAY_SETTINGS             SCENE_GRAPH_FRAME_FIRST_ID + 73
 #define wxID_WINDOWS_COMPONENT_RELATIONS                SCENE_GRAPH_FRAME_FIRST_ID + 28
 #define wxID_MODES_OPERATION_MODE_DISPLAY               SCENE_GRAPH_FRAME_FIRST_ID + 29
 #define wxID_MODES_OPERATION_MODE_MODELLING             SCENE_GRAPH_FRAME_FIRST_ID + 30
@@ -76,15 +98,33 @@
 
 // 2d profile fitting
 #define wxID_MODEL_SYMMETRIC_2D_PROFILES                SCENE_GRAPH_FRAME_FIRST_ID + 41
+#define wxID_MODEL_SNAP_PROFILES_TO_EDGES               SCENE_GRAPH_FRAME_FIRST_ID + 46
+#define wxID_MODEL_FIT_ELLIPSES_TO_EDGES                SCENE_GRAPH_FRAME_FIRST_ID + 54
+#define wxID_MODEL_SUBPIXEL_PROFILE_SNAPPING            SCENE_GRAPH_FRAME_FIRST_ID + 74
 
 // double circle drawing for linear axis constraint
 #define wxID_MODEL_DOUBLE_CIRCLE_FOR_LINEAR_AXIS        SCENE_GRAPH_FRAME_FIRST_ID + 42
 #define wxID_MODEL_RIGHT_GENERALIZED_CYLINDER           SCENE_GRAPH_FRAME_FIRST_ID + 43
+#define wxID_MODEL_MULTI_START_SOLVING                  SCENE_GRAPH_FRAME_FIRST_ID + 53
+#define wxID_MODEL_RECORD_INTERACTION_TRACE             SCENE_GRAPH_FRAME_FIRST_ID + 56
+#define wxID_MODEL_FREEZE_COMPONENTS                    SCENE_GRAPH_FRAME_FIRST_ID + 58
+#define wxID_MODEL_UNFREEZE_COMPONENTS                  SCENE_GRAPH_FRAME_FIRST_ID + 59
+#define wxID_MODEL_FIT_AXIS_SPLINES                     SCENE_GRAPH_FRAME_FIRST_ID + 60
 
 #define wxID_MODES_PERSPECTIVE_PROJECTION               SCENE_GRAPH_FRAME_FIRST_ID + 44
 #define wxID_MODES_ORTHOGRAPHIC_PROJECTION              SCENE_GRAPH_FRAME_FIRST_ID + 45
+#define wxID_MODES_LIMIT_FRAME_RATE                     SCENE_GRAPH_FRAME_FIRST_ID + 49
+#define wxID_OSG_FRAME_TIMER                            SCENE_GRAPH_FRAME_FIRST_ID + 50
+#define wxID_MODES_KDTREE_PICKING                       SCENE_GRAPH_FRAME_FIRST_ID + 51
+#define wxID_MODES_COLOR_ID_PICKING                     SCENE_GRAPH_FRAME_FIRST_ID + 52
+#define wxID_MODES_COMPRESS_TEXTURES                    SCENE_GRAPH_FRAME_FIRST_ID + 71
+#define wxID_MODES_ORDER_INDEPENDENT_TRANSPARENCY       SCENE_GRAPH_FRAME_FIRST_ID + 57
 
 #define wxID_COMPONENT_RELATIONS_APPLY_BUTTON           wxID_HIGHEST + 400
 #define wxID_COMPONENT_RELATIONS_CLOSE_BUTTON           wxID_HIGHEST + 401
+#define wxID_GRADIENT_DISPLAY_GAIN_SLIDER               wxID_HIGHEST + 402
+#define wxID_GRADIENT_DISPLAY_THRESHOLD_SLIDER          wxID_HIGHEST + 403
+#define wxID_GRADIENT_DISPLAY_EDGES_CHECKBOX            wxID_HIGHEST + 404
+#define wxID_GRADIENT_DISPLAY_CLOSE_BUTTON              wxID_HIGHEST + 405
 
 #endif // WXGUIID_HPP
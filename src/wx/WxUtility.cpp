@@ -1,5 +1,6 @@
 #include "WxUtility.hpp"
 #include <wx/msgdlg.h>
+#include <wx/app.h>
 #include <cmath>
 #include <iostream>
 
@@ -111,3 +112,11 @@ bool utilityIsXml(const wxString& fname) {
     wxString extension = fname.AfterLast('.');
     return (extension == wxT("xml") || extension == wxT("XML"));
 }
+
+executor_type utilityUIExecutor() {
+
+    return [](std::function<void()> f) {
+        // the application is gone after OnExit, the remaining results are dropped
+        if(wxTheApp != nullptr) wxTheApp->CallAfter(f);
+    };
+}
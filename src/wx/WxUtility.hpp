@@ -1,6 +1,7 @@
 #ifndef _WX_UTILITY_HPP
 #define _WX_UTILITY_HPP
 
+#include "../utility/ThreadPool.hpp"
 #include <string>
 #include <wx/unichar.h>
 
@@ -51,5 +52,7 @@ wxString utilityToString(const std::string& str, const wxSize& s);
 std::string utilityInsertAfter(const wxString& fpath, const wxUniChar& after, const wxString& str);
 void utilityPrintDisplayMode(image_display_mode md);
 bool utilityIsXml(const wxString& fname);
+// posts the continuations of the jobs to the UI thread (wxApp::CallAfter)
+executor_type utilityUIExecutor();
 
 #endif // WXUTILITY_HPP